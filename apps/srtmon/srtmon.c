@@ -0,0 +1,222 @@
+/*
+
+  srtmon.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/* srtmon - live statistics viewer
+
+   Usage: srtmon <filepath>
+
+   Attaches to a running process that has called silc_stat_export_start
+   with the same `filepath' and renders its statistics once a second,
+   showing the absolute value and the per-second rate of every counter
+   the process exports. */
+
+#include "silcruntime.h"
+
+#define SRTMON_MAX_COUNTERS 512
+
+typedef struct {
+  char name[128];
+  SilcUInt64 value;		    /* Latest value */
+  SilcUInt64 prev;		    /* Value one interval ago */
+  unsigned int seen : 1;	    /* Present in the latest dump */
+} SrtMonCounter;
+
+typedef struct {
+  SilcSchedule schedule;
+  SilcStream stream;
+  SilcBuffer inbuf;		    /* Partial dump */
+  SrtMonCounter counters[SRTMON_MAX_COUNTERS];
+  SilcUInt32 num_counters;
+  const char *filepath;
+} SrtMon;
+
+/* Finds or creates a counter slot */
+
+static SrtMonCounter *srtmon_counter(SrtMon *mon, const char *name)
+{
+  SilcUInt32 i;
+
+  for (i = 0; i < mon->num_counters; i++)
+    if (!strcmp(mon->counters[i].name, name))
+      return &mon->counters[i];
+
+  if (mon->num_counters == SRTMON_MAX_COUNTERS)
+    return NULL;
+
+  silc_snprintf(mon->counters[mon->num_counters].name,
+		sizeof(mon->counters[0].name), "%s", name);
+  return &mon->counters[mon->num_counters++];
+}
+
+/* Renders the latest values with per-second rates */
+
+static void srtmon_render(SrtMon *mon)
+{
+  SrtMonCounter *c;
+  SilcUInt32 i;
+
+  /* Clear screen and home */
+  printf("\033[2J\033[H");
+  printf("srtmon: %s\n\n", mon->filepath);
+  printf("%-40s %15s %12s\n", "counter", "value", "per second");
+
+  for (i = 0; i < mon->num_counters; i++) {
+    c = &mon->counters[i];
+    if (!c->seen)
+      continue;
+    printf("%-40s %15llu %12lld\n", c->name,
+	   (unsigned long long)c->value,
+	   (long long)(c->value - c->prev));
+    c->prev = c->value;
+    c->seen = FALSE;
+  }
+
+  fflush(stdout);
+}
+
+/* Parses one complete dump */
+
+static void srtmon_parse(SrtMon *mon, char *dump)
+{
+  SrtMonCounter *c;
+  char *line, *next, name[160];
+  unsigned long long value;
+
+  for (line = dump; line; line = next) {
+    next = strchr(line, '\n');
+    if (next)
+      *next++ = '\0';
+
+    if (!strcmp(line, "END"))
+      break;
+
+    /* Lines are "stat <name> <value>" or "sched <name> <value>" */
+    if (sscanf(line, "stat %127s %llu", name, &value) == 2 ||
+	sscanf(line, "sched %127s %llu", name, &value) == 2) {
+      c = srtmon_counter(mon, name);
+      if (c) {
+	c->value = value;
+	c->seen = TRUE;
+      }
+    }
+  }
+
+  srtmon_render(mon);
+}
+
+/* Stream IO; accumulates the dump until the END line */
+
+static void srtmon_io(SilcStream stream, SilcStreamStatus status,
+		      void *context)
+{
+  SrtMon *mon = context;
+  unsigned char buf[8192];
+  int len;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  while ((len = silc_stream_read(stream, buf, sizeof(buf))) > 0) {
+    if (silc_buffer_taillen(mon->inbuf) < (SilcUInt32)len + 1)
+      if (!silc_buffer_realloc(mon->inbuf,
+			       silc_buffer_truelen(mon->inbuf) + len + 1))
+	return;
+    memcpy(mon->inbuf->tail, buf, len);
+    silc_buffer_pull_tail(mon->inbuf, len);
+  }
+
+  if (len == 0 || len == -2) {
+    fprintf(stderr, "srtmon: connection closed\n");
+    silc_schedule_stop(mon->schedule);
+    return;
+  }
+
+  /* Complete dump ends with the END line */
+  *mon->inbuf->tail = '\0';
+  if (strstr((char *)silc_buffer_data(mon->inbuf), "END\n")) {
+    srtmon_parse(mon, (char *)silc_buffer_data(mon->inbuf));
+    silc_buffer_reset(mon->inbuf);
+  }
+}
+
+/* Once a second, request a new dump */
+
+SILC_TASK_CALLBACK(srtmon_poll)
+{
+  SrtMon *mon = context;
+
+  if (mon->stream)
+    silc_stream_write(mon->stream, (unsigned char *)"S\n", 2);
+
+  silc_schedule_task_add_timeout(mon->schedule, srtmon_poll, mon, 1, 0);
+}
+
+/* Connected to the monitored process */
+
+static void srtmon_connected(SilcResult status, SilcStream stream,
+			     void *context)
+{
+  SrtMon *mon = context;
+
+  if (status != SILC_OK) {
+    fprintf(stderr, "srtmon: cannot connect: %s\n",
+	    silc_errno_string(status));
+    silc_schedule_stop(mon->schedule);
+    return;
+  }
+
+  mon->stream = stream;
+  silc_stream_set_notifier(stream, mon->schedule, srtmon_io, mon);
+  silc_schedule_task_add_timeout(mon->schedule, srtmon_poll, mon, 0, 0);
+}
+
+int main(int argc, char **argv)
+{
+  SrtMon mon;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: srtmon <filepath>\n");
+    return 1;
+  }
+
+  memset(&mon, 0, sizeof(mon));
+  mon.filepath = argv[1];
+
+  silc_runtime_init();
+
+  mon.schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!mon.schedule) {
+    fprintf(stderr, "srtmon: cannot create scheduler\n");
+    return 1;
+  }
+  silc_schedule_set_global(mon.schedule);
+
+  mon.inbuf = silc_buffer_alloc(8192);
+  if (!mon.inbuf)
+    return 1;
+  silc_buffer_reset(mon.inbuf);
+
+  silc_local_net_connect(mon.filepath, mon.schedule, srtmon_connected, &mon);
+
+  silc_schedule(mon.schedule);
+  silc_schedule_uninit(mon.schedule);
+  silc_runtime_uninit();
+
+  return 0;
+}
@@ -0,0 +1,358 @@
+/*
+
+  srtperf.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/* srtperf - runtime toolkit load generator and capacity tester
+
+   Echo server:  srtperf -s [-u] [-p port]
+   Client:       srtperf -c <host> [-u] [-p port] [-n conns] [-m msgsize]
+                         [-t seconds]
+
+   The client opens the requested number of connections, keeps one
+   message of the requested size in flight on each and measures the
+   echo round trip of every message; at the end it reports throughput
+   and latency percentiles from the timer histograms.  Every scheduler
+   change is validated with this before rollout. */
+
+#include "silcruntime.h"
+
+#define SRTPERF_MAX_MSG (1024 * 1024)
+
+typedef struct {
+  SilcSchedule schedule;	    /* Scheduler */
+  SilcTimerStatsStruct lat;	    /* Echo round trip latencies, nsec */
+  SilcUInt64 bytes;		    /* Payload bytes echoed back */
+  SilcUInt64 msgs;		    /* Messages echoed back */
+  SilcUInt32 num_conns;		    /* Client connection target */
+  SilcUInt32 connected;		    /* Established connections */
+  SilcUInt32 failed;		    /* Failed connections */
+  SilcUInt32 msg_size;		    /* Message size */
+  SilcUInt32 duration;		    /* Test duration, seconds */
+  int port;			    /* Port */
+  char *host;			    /* Client target host */
+  unsigned int server : 1;	    /* Server mode */
+  unsigned int udp    : 1;	    /* UDP instead of TCP */
+  unsigned int done   : 1;	    /* Test finished */
+} SrtPerf;
+
+/* Per-connection client state */
+typedef struct {
+  SrtPerf *perf;
+  SilcStream stream;
+  SilcUInt64 sent_at;		    /* Monotonic nsec of last send */
+  SilcUInt32 recvd;		    /* Bytes of the echo received so far */
+  unsigned char *msg;		    /* The message */
+} SrtPerfConn;
+
+/************************** Echo server *************************************/
+
+/* Server connection IO; echo everything back */
+
+static void srtperf_server_io(SilcStream stream, SilcStreamStatus status,
+			      void *context)
+{
+  unsigned char buf[65536];
+  int len, ret, off;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  for (;;) {
+    len = silc_stream_read(stream, buf, sizeof(buf));
+    if (len == 0 || len == -2) {
+      silc_stream_destroy(stream);
+      return;
+    }
+    if (len == -1)
+      return;
+
+    for (off = 0; off < len; off += ret) {
+      ret = silc_stream_write(stream, buf + off, len - off);
+      if (ret <= 0)
+	return;
+    }
+  }
+}
+
+/* New server connection */
+
+static void srtperf_server_accept(SilcResult status, SilcStream stream,
+				  void *context)
+{
+  SrtPerf *perf = context;
+
+  if (status != SILC_OK)
+    return;
+
+  silc_stream_set_notifier(stream, perf->schedule, srtperf_server_io, perf);
+}
+
+/* UDP echo server IO */
+
+static void srtperf_server_udp_io(SilcStream stream, SilcStreamStatus status,
+				  void *context)
+{
+  unsigned char buf[65536];
+  char ip[64];
+  int port, len;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  while ((len = silc_net_udp_receive(stream, ip, sizeof(ip), &port, buf,
+				     sizeof(buf))) > 0)
+    silc_net_udp_send(stream, ip, port, buf, len);
+}
+
+/************************** Load client *************************************/
+
+static void srtperf_client_io(SilcStream stream, SilcStreamStatus status,
+			      void *context);
+
+/* Sends the next message on the connection */
+
+static void srtperf_send(SrtPerfConn *conn)
+{
+  SrtPerf *perf = conn->perf;
+  int ret, off = 0;
+
+  conn->recvd = 0;
+  conn->sent_at = silc_time_monotonic_nsec();
+
+  while (off < (int)perf->msg_size) {
+    ret = silc_stream_write(conn->stream, conn->msg + off,
+			    perf->msg_size - off);
+    if (ret == -1)
+      return;			       /* Rest goes when writable */
+    if (ret <= 0)
+      return;
+    off += ret;
+  }
+}
+
+/* Client connection IO; account the echo and send the next message */
+
+static void srtperf_client_io(SilcStream stream, SilcStreamStatus status,
+			      void *context)
+{
+  SrtPerfConn *conn = context;
+  SrtPerf *perf = conn->perf;
+  unsigned char buf[65536];
+  int len;
+
+  if (perf->done)
+    return;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  for (;;) {
+    len = silc_stream_read(stream, buf, sizeof(buf));
+    if (len == 0 || len == -2)
+      return;
+    if (len == -1)
+      return;
+
+    conn->recvd += len;
+    perf->bytes += len;
+
+    if (conn->recvd >= perf->msg_size) {
+      /* Full echo back; record the round trip */
+      silc_timer_stats_record(&perf->lat,
+			      silc_time_monotonic_nsec() - conn->sent_at);
+      perf->msgs++;
+      srtperf_send(conn);
+    }
+  }
+}
+
+/* Connection established */
+
+static void srtperf_client_connected(SilcResult status, SilcStream stream,
+				     void *context)
+{
+  SrtPerfConn *conn = context;
+  SrtPerf *perf = conn->perf;
+
+  if (status != SILC_OK) {
+    perf->failed++;
+    fprintf(stderr, "srtperf: connect failed: %s\n",
+	    silc_errno_string(status));
+    return;
+  }
+
+  perf->connected++;
+  conn->stream = stream;
+  silc_stream_set_notifier(stream, perf->schedule, srtperf_client_io, conn);
+  srtperf_send(conn);
+}
+
+/* Test duration elapsed; report and stop */
+
+SILC_TASK_CALLBACK(srtperf_finish)
+{
+  SrtPerf *perf = context;
+  double secs = (double)perf->duration;
+
+  perf->done = TRUE;
+
+  printf("srtperf: %u/%u connections, %llu messages, %.2f MB/s\n",
+	 perf->connected, perf->num_conns,
+	 (unsigned long long)perf->msgs,
+	 (double)perf->bytes / (1024.0 * 1024.0) / secs);
+  if (perf->lat.count)
+    printf("latency usec: min %llu p50 %llu p90 %llu p99 %llu max %llu\n",
+	   (unsigned long long)perf->lat.min / 1000,
+	   (unsigned long long)silc_timer_stats_percentile(&perf->lat,
+							   50) / 1000,
+	   (unsigned long long)silc_timer_stats_percentile(&perf->lat,
+							   90) / 1000,
+	   (unsigned long long)silc_timer_stats_percentile(&perf->lat,
+							   99) / 1000,
+	   (unsigned long long)perf->lat.max / 1000);
+
+  silc_schedule_stop(perf->schedule);
+}
+
+/******************************** Main **************************************/
+
+static void srtperf_usage(void)
+{
+  fprintf(stderr,
+	  "usage: srtperf -s [-u] [-p port]\n"
+	  "       srtperf -c host [-u] [-p port] [-n conns] [-m msgsize] "
+	  "[-t seconds]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  SrtPerf perf;
+  SilcUInt32 i;
+  int opt;
+
+  memset(&perf, 0, sizeof(perf));
+  perf.port = 7777;
+  perf.num_conns = 1;
+  perf.msg_size = 1024;
+  perf.duration = 10;
+  silc_timer_stats_init(&perf.lat);
+
+  while ((opt = getopt(argc, argv, "sc:up:n:m:t:h")) != -1) {
+    switch (opt) {
+    case 's':
+      perf.server = TRUE;
+      break;
+    case 'c':
+      perf.host = optarg;
+      break;
+    case 'u':
+      perf.udp = TRUE;
+      break;
+    case 'p':
+      perf.port = atoi(optarg);
+      break;
+    case 'n':
+      perf.num_conns = atoi(optarg);
+      break;
+    case 'm':
+      perf.msg_size = atoi(optarg);
+      break;
+    case 't':
+      perf.duration = atoi(optarg);
+      break;
+    default:
+      srtperf_usage();
+    }
+  }
+
+  if ((!perf.server && !perf.host) || perf.msg_size < 1 ||
+      perf.msg_size > SRTPERF_MAX_MSG)
+    srtperf_usage();
+
+  silc_runtime_init();
+
+  perf.schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!perf.schedule) {
+    fprintf(stderr, "srtperf: cannot create scheduler\n");
+    return 1;
+  }
+  silc_schedule_set_global(perf.schedule);
+
+  if (perf.server) {
+    /* Echo server */
+    if (perf.udp) {
+      SilcStream udp = silc_net_udp_connect("0.0.0.0", perf.port, NULL, 0,
+					    perf.schedule);
+      if (!udp) {
+	fprintf(stderr, "srtperf: cannot bind UDP port %d\n", perf.port);
+	return 1;
+      }
+      silc_stream_set_notifier(udp, perf.schedule, srtperf_server_udp_io,
+			       &perf);
+      printf("srtperf: UDP echo server on port %d\n", perf.port);
+    } else {
+      SilcNetListener l =
+	silc_net_tcp_create_listener(NULL, 0, perf.port, FALSE, FALSE,
+				     perf.schedule, srtperf_server_accept,
+				     &perf);
+      if (!l) {
+	fprintf(stderr, "srtperf: cannot listen on port %d\n", perf.port);
+	return 1;
+      }
+      printf("srtperf: TCP echo server on port %d\n", perf.port);
+    }
+  } else {
+    /* Load client */
+    printf("srtperf: %u connections to %s:%d, %u byte messages, %us\n",
+	   perf.num_conns, perf.host, perf.port, perf.msg_size,
+	   perf.duration);
+
+    for (i = 0; i < perf.num_conns; i++) {
+      SrtPerfConn *conn = silc_calloc(1, sizeof(*conn));
+      if (!conn)
+	break;
+      conn->perf = &perf;
+      conn->msg = silc_malloc(perf.msg_size);
+      if (!conn->msg)
+	break;
+      memset(conn->msg, 'S', perf.msg_size);
+
+      if (perf.udp) {
+	SilcStream udp = silc_net_udp_connect(NULL, 0, perf.host, perf.port,
+					      perf.schedule);
+	if (udp)
+	  srtperf_client_connected(SILC_OK, udp, conn);
+	else
+	  perf.failed++;
+      } else {
+	silc_net_tcp_connect(NULL, perf.host, perf.port, perf.schedule,
+			     srtperf_client_connected, conn);
+      }
+    }
+
+    silc_schedule_task_add_timeout(perf.schedule, srtperf_finish, &perf,
+				   perf.duration, 0);
+  }
+
+  silc_schedule(perf.schedule);
+  silc_schedule_uninit(perf.schedule);
+  silc_runtime_uninit();
+
+  return 0;
+}
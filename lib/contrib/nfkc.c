@@ -605,12 +605,85 @@ decompose_hangul (gunichar s, gunichar * r, gsize * result_len)
 }
 
 /* returns a pointer to a null-terminated UTF-8 string */
+/* Two-level index over decomp_table, built once on first use: a page
+   table indexed by ch >> 8 pointing to 256-slot pages of decomp_table
+   indices (offset by one, zero meaning no decomposition).  Turns the
+   per-character binary search into two array fetches. */
+
+static guint16 **decomp_index = NULL;
+static int decomp_index_pages = 0;
+
+static void
+build_decomp_index (void)
+{
+  int n = G_N_ELEMENTS (decomp_table);
+  int pages = (decomp_table[n - 1].ch >> 8) + 1;
+  guint16 **index;
+  int i, page;
+
+  index = (guint16 **) g_malloc (pages * sizeof (guint16 *));
+  if (!index)
+    return;
+  memset (index, 0, pages * sizeof (guint16 *));
+
+  for (i = 0; i < n; i++)
+    {
+      page = decomp_table[i].ch >> 8;
+      if (!index[page])
+	{
+	  index[page] = (guint16 *) g_malloc (256 * sizeof (guint16));
+	  if (!index[page])
+	    {
+	      for (page = 0; page < pages; page++)
+		g_free (index[page]);
+	      g_free (index);
+	      return;
+	    }
+	  memset (index[page], 0, 256 * sizeof (guint16));
+	}
+      index[page][decomp_table[i].ch & 0xff] = i + 1;
+    }
+
+  /* Publish last; a lost race at worst leaks one index */
+  decomp_index_pages = pages;
+  decomp_index = index;
+}
+
 static const gchar *
 find_decomposition (gunichar ch, gboolean compat)
 {
   int start = 0;
   int end = G_N_ELEMENTS (decomp_table);
 
+  if (!decomp_index)
+    build_decomp_index ();
+
+  if (decomp_index)
+    {
+      int offset, i;
+
+      if ((int) (ch >> 8) >= decomp_index_pages ||
+	  !decomp_index[ch >> 8] ||
+	  !(i = decomp_index[ch >> 8][ch & 0xff]))
+	return NULL;
+      i--;
+
+      if (compat)
+	{
+	  offset = decomp_table[i].compat_offset;
+	  if (offset == G_UNICODE_NOT_PRESENT_OFFSET)
+	    offset = decomp_table[i].canon_offset;
+	}
+      else
+	{
+	  offset = decomp_table[i].canon_offset;
+	  if (offset == G_UNICODE_NOT_PRESENT_OFFSET)
+	    return NULL;
+	}
+
+      return &(decomp_expansion_string[offset]);
+    }
+
   if (ch >= decomp_table[start].ch && ch <= decomp_table[end - 1].ch)
     {
       while (TRUE)
@@ -919,6 +992,45 @@ g_utf8_normalize (const gchar * str, gssize len, GNormalizeMode mode)
   return result;
 }
 
+/* Returns TRUE if the string is already in NFKC form.  A character is
+   inert when it has combining class zero, no compatibility
+   decomposition, cannot appear as the second character of a
+   composition and is not a Hangul V/T jamo; a string of inert
+   characters cannot be changed by decomposition, reordering or
+   composition.  One scan, no decomposition buffers. */
+
+static gboolean
+nfkc_quick_check (const gchar * str, gssize max_len)
+{
+  const gchar *p = str;
+  gunichar wc;
+
+  while ((max_len < 0 || p < str + max_len) && *p)
+    {
+      if (!(*p & 0x80))
+	{
+	  p++;
+	  continue;
+	}
+
+      wc = g_utf8_get_char (p);
+
+      if (COMBINING_CLASS (wc) != 0)
+	return FALSE;
+      if (find_decomposition (wc, TRUE))
+	return FALSE;
+      if (COMPOSE_INDEX (wc) >= COMPOSE_SECOND_START)
+	return FALSE;
+      if ((wc >= VBase && wc < VBase + VCount) ||
+	  (wc >= TBase && wc < TBase + TCount))
+	return FALSE;
+
+      p = g_utf8_next_char (p);
+    }
+
+  return TRUE;
+}
+
 /* Public Libidn API starts here. */
 
 /**
@@ -1026,6 +1138,20 @@ stringprep_ucs4_to_utf8 (const uint32_t * str, ssize_t len,
 char *
 stringprep_utf8_nfkc_normalize (const char *str, ssize_t len)
 {
+  /* Already normalized strings are the common case; verify and copy */
+  if (nfkc_quick_check (str, len))
+    {
+      size_t n = len < 0 ? strlen (str) : strnlen (str, len);
+      char *result = g_malloc (n + 1);
+
+      if (result)
+	{
+	  memcpy (result, str, n);
+	  result[n] = '\0';
+	}
+      return result;
+    }
+
   return g_utf8_normalize (str, len, G_NORMALIZE_NFKC);
 }
 
@@ -20,6 +20,164 @@
 #include "silcruntime.h"
 #include "silchttpphp.h"
 
+#ifndef SILC_WIN32
+
+/* Persistent PHP worker pool.  Instead of fork+exec and interpreter
+   startup per request, a few PHP processes stay alive running a small
+   harness loop that includes script files fed over a pipe and returns
+   length-prefixed output. */
+
+#define SILC_HTTP_PHP_WORKERS 4
+
+/* The harness loop run inside each worker */
+#define SILC_HTTP_PHP_HARNESS \
+  "while (($f = fgets(STDIN)) !== false) { $f = trim($f); ob_start(); " \
+  "include $f; $o = ob_get_clean(); echo strlen($o), \"\\n\", $o; " \
+  "fflush(STDOUT); }"
+
+typedef struct {
+  FILE *in;			       /* Worker stdin */
+  FILE *out;			       /* Worker stdout */
+  int pid;			       /* Worker process */
+  unsigned int busy : 1;
+} SilcHttpPhpWorker;
+
+static SilcHttpPhpWorker php_workers[SILC_HTTP_PHP_WORKERS];
+static SilcMutex php_workers_lock = NULL;
+
+/* Spawns one worker process */
+
+static SilcBool silc_http_php_spawn(SilcHttpPhpWorker *w)
+{
+  int inpipe[2], outpipe[2];
+  pid_t pid;
+
+  if (pipe(inpipe) < 0)
+    return FALSE;
+  if (pipe(outpipe) < 0) {
+    close(inpipe[0]);
+    close(inpipe[1]);
+    return FALSE;
+  }
+
+  pid = fork();
+  if (pid < 0) {
+    close(inpipe[0]);
+    close(inpipe[1]);
+    close(outpipe[0]);
+    close(outpipe[1]);
+    return FALSE;
+  }
+
+  if (pid == 0) {
+    /* Worker process */
+    dup2(inpipe[0], 0);
+    dup2(outpipe[1], 1);
+    close(inpipe[0]);
+    close(inpipe[1]);
+    close(outpipe[0]);
+    close(outpipe[1]);
+    execlp("php", "php", "-r", SILC_HTTP_PHP_HARNESS, (char *)NULL);
+    _exit(127);
+  }
+
+  close(inpipe[0]);
+  close(outpipe[1]);
+  w->in = fdopen(inpipe[1], "w");
+  w->out = fdopen(outpipe[0], "r");
+  w->pid = pid;
+  if (!w->in || !w->out) {
+    if (w->in)
+      fclose(w->in);
+    if (w->out)
+      fclose(w->out);
+    w->pid = 0;
+    return FALSE;
+  }
+
+  SILC_LOG_DEBUG(("Spawned PHP worker %d", pid));
+
+  return TRUE;
+}
+
+/* Kills a broken worker */
+
+static void silc_http_php_kill(SilcHttpPhpWorker *w)
+{
+  if (w->in)
+    fclose(w->in);
+  if (w->out)
+    fclose(w->out);
+  w->in = w->out = NULL;
+  w->pid = 0;
+}
+
+/* Executes `filename' in a pooled worker.  Returns NULL if no worker
+   could be used; the caller falls back to the one-shot path. */
+
+static SilcBuffer silc_http_php_pooled(const char *filename)
+{
+  SilcHttpPhpWorker *w = NULL;
+  SilcBuffer ret = NULL;
+  char line[32];
+  unsigned long len, n;
+  int i;
+
+  if (!php_workers_lock)
+    if (!silc_mutex_alloc(&php_workers_lock))
+      return NULL;
+
+  /* Reserve a worker, spawning one if needed */
+  silc_mutex_lock(php_workers_lock);
+  for (i = 0; i < SILC_HTTP_PHP_WORKERS; i++)
+    if (!php_workers[i].busy) {
+      w = &php_workers[i];
+      if (!w->pid && !silc_http_php_spawn(w)) {
+	w = NULL;
+	continue;
+      }
+      w->busy = TRUE;
+      break;
+    }
+  silc_mutex_unlock(php_workers_lock);
+
+  if (!w)
+    return NULL;
+
+  /* Feed the script and read the length-prefixed result */
+  if (fprintf(w->in, "%s\n", filename) < 0 || fflush(w->in) != 0)
+    goto err;
+  if (!fgets(line, sizeof(line), w->out))
+    goto err;
+  len = strtoul(line, NULL, 10);
+
+  ret = silc_buffer_alloc(len + 1);
+  if (!ret)
+    goto err;
+  silc_buffer_reset(ret);
+
+  n = fread(ret->head, 1, len, w->out);
+  if (n != len)
+    goto err;
+  silc_buffer_pull_tail(ret, len);
+
+  silc_mutex_lock(php_workers_lock);
+  w->busy = FALSE;
+  silc_mutex_unlock(php_workers_lock);
+
+  return ret;
+
+ err:
+  silc_buffer_free(ret);
+  silc_mutex_lock(php_workers_lock);
+  silc_http_php_kill(w);
+  w->busy = FALSE;
+  silc_mutex_unlock(php_workers_lock);
+  return NULL;
+}
+
+#endif /* !SILC_WIN32 */
+
 /* Executes PHP code and returns result */
 
 SilcBuffer silc_http_php(char *php_data)
@@ -65,6 +223,14 @@ SilcBuffer silc_http_php_file(const char *filename)
 
   SILC_LOG_DEBUG(("Executing PHP"));
 
+#ifndef SILC_WIN32
+  /* Try the persistent worker pool first */
+  ret = silc_http_php_pooled(filename);
+  if (ret)
+    return ret;
+  ret = NULL;
+#endif /* !SILC_WIN32 */
+
   memset(tmp, 0, sizeof(tmp));
   silc_snprintf(tmp, sizeof(tmp) - 1, "php -f %s", filename);
 
@@ -23,20 +23,63 @@
 /************************** Types and definitions ***************************/
 
 #define SILC_HTTP_SERVER_TIMEOUT  120   /* Connection timeout */
+#define SILC_HTTP_SERVER_FD_CACHE 32	/* Max cached open files */
 #define SILC_HTTP_SERVER_CONNS    2	/* Default number of connections */
 #define SILC_HTTP_SERVER_BUFLEN   1024  /* Default data buffer length */
 #define SILC_HTTP_SERVER_HEADER   "HTTP/1.1 200 OK\r\nServer: SILCHTTP/1.0\r\n"
 
+/* Cached open file */
+typedef struct SilcHttpServerFileStruct {
+  struct SilcHttpServerFileStruct *next;
+  struct SilcHttpServerFileStruct *prev;
+  char *filename;		    /* The file */
+  SilcUInt64 size;		    /* File size */
+  int fd;			    /* Open fd */
+} *SilcHttpServerFile;
+
 /* HTTP server context */
 struct SilcHttpServerStruct {
   SilcNetListener listener;	    /* Server listener */
   SilcSchedule schedule;	    /* Scheduler */
   SilcList allconns;		    /* All connections */
   SilcList conns;		    /* Connection free list */
+  SilcList fdcache;		    /* Open file cache, LRU order */
   SilcHttpServerCallback callback;  /* Requset callback */
   void *context;		    /* Request callback context */
+  char date_string[40];		    /* Cached RFC 1123 date string */
+  SilcInt64 date_time;		    /* Second the date string renders */
 };
 
+/* Returns the RFC 1123 date string for the current time.  The string
+   is re-rendered at most once per second; every response carries it in
+   the Date and Last-Modified headers. */
+
+static const char *silc_http_server_date(SilcHttpServer httpd)
+{
+  static const char *days[] = { "Sun", "Mon", "Tue", "Wed", "Thu",
+				"Fri", "Sat" };
+  static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May",
+				  "Jun", "Jul", "Aug", "Sep", "Oct",
+				  "Nov", "Dec" };
+  SilcInt64 now = silc_time();
+  time_t t = (time_t)now;
+  struct tm *tm;
+
+  if (now != httpd->date_time) {
+    tm = gmtime(&t);
+    if (tm) {
+      silc_snprintf(httpd->date_string, sizeof(httpd->date_string),
+		    "%s, %02d %s %04d %02d:%02d:%02d GMT",
+		    days[tm->tm_wday], tm->tm_mday, months[tm->tm_mon],
+		    tm->tm_year + 1900, tm->tm_hour, tm->tm_min,
+		    tm->tm_sec);
+      httpd->date_time = now;
+    }
+  }
+
+  return httpd->date_string;
+}
+
 /* HTTP connection context */
 struct SilcHttpConnectionStruct {
   struct SilcHttpConnectionStruct *next;
@@ -51,9 +94,34 @@ struct SilcHttpConnectionStruct {
   unsigned char *hptr;		    /* Pointer to start of headers */
   char *method;			    /* Method */
   char *uri;			    /* URI */
+  SilcUInt32 req_len;		    /* Length of the current request */
+  SilcStream file_stream;	    /* File being sent, if any */
+  SilcUInt64 file_offset;	    /* Send offset in the file */
+  SilcUInt64 file_size;		    /* Size of the file */
   unsigned int keepalive    : 1;    /* Keep alive */
+  unsigned int sending_file : 1;    /* Set while streaming a file */
+  unsigned int chunked      : 1;    /* Chunked response in progress */
 };
 
+static SilcBool silc_http_server_parse(SilcHttpServer httpd,
+				       SilcHttpConnection conn);
+static void silc_http_server_close_connection(SilcHttpConnection conn);
+
+/* Parse a pipelined request left in the input buffer */
+
+SILC_TASK_CALLBACK(silc_http_server_pipeline)
+{
+  SilcHttpConnection conn = context;
+
+  if (!conn->stream)
+    return;
+
+  if (!silc_http_server_parse(conn->httpd, conn)) {
+    conn->keepalive = FALSE;
+    silc_http_server_close_connection(conn);
+  }
+}
+
 /************************ Static utility functions **************************/
 
 /* Close HTTP connection */
@@ -68,22 +136,65 @@ static void silc_http_server_close_connection(SilcHttpConnection conn)
     silc_mime_free(conn->curheaders);
     conn->curheaders = NULL;
   }
+  if (conn->keepalive && conn->req_len &&
+      silc_buffer_len(conn->inbuf) > conn->req_len) {
+    /* A pipelined request follows the one just completed; move it to
+       the buffer start and parse it on the next scheduler tick. */
+    SilcUInt32 rest = silc_buffer_len(conn->inbuf) - conn->req_len;
+    memmove(conn->inbuf->head,
+	    silc_buffer_data(conn->inbuf) + conn->req_len, rest);
+    silc_buffer_reset(conn->inbuf);
+    silc_buffer_pull_tail(conn->inbuf, rest);
+    silc_buffer_clear(conn->outbuf);
+    silc_buffer_reset(conn->outbuf);
+    conn->hptr = NULL;
+    conn->method = conn->uri = NULL;
+    conn->req_len = 0;
+    silc_schedule_task_add_timeout(conn->httpd->schedule,
+				   silc_http_server_pipeline, conn, 0, 0);
+    return;
+  }
+
   silc_buffer_clear(conn->inbuf);
   silc_buffer_clear(conn->outbuf);
   silc_buffer_reset(conn->inbuf);
   silc_buffer_reset(conn->outbuf);
   conn->hptr = conn->method = conn->uri = NULL;
+  conn->req_len = 0;
 
   if (conn->keepalive)
     return;
 
   SILC_LOG_DEBUG(("Closing HTTP connection %p", conn));
 
+  /* A file send aborted mid-stream (peer close, timeout) leaves the
+     file stream open; release it so the pooled connection does not
+     stream the remainder into the next client's response. */
+  if (conn->file_stream) {
+    silc_stream_destroy(conn->file_stream);
+    conn->file_stream = NULL;
+  }
+  conn->sending_file = FALSE;
+  conn->file_offset = 0;
+  conn->file_size = 0;
+
+  /* Likewise a chunked response that died mid-stream; a recycled
+     connection with the flag set would never complete later
+     non-chunked responses. */
+  conn->chunked = FALSE;
+
   silc_schedule_task_del_by_context(conn->httpd->schedule, conn);
   silc_stream_set_notifier(conn->stream, conn->httpd->schedule, NULL, NULL);
   silc_stream_destroy(conn->stream);
   conn->stream = NULL;
 
+  /* Shrink buffers that grew during the connection so idle pooled
+     connections do not pin large buffers. */
+  if (silc_buffer_truelen(conn->inbuf) > 4 * SILC_HTTP_SERVER_BUFLEN)
+    silc_buffer_realloc(conn->inbuf, SILC_HTTP_SERVER_BUFLEN);
+  if (silc_buffer_truelen(conn->outbuf) > 4 * SILC_HTTP_SERVER_BUFLEN)
+    silc_buffer_realloc(conn->outbuf, SILC_HTTP_SERVER_BUFLEN);
+
   /* Add to free list */
   silc_list_add(conn->httpd->conns, conn);
 }
@@ -115,6 +226,10 @@ static SilcBool silc_http_server_parse(SilcHttpServer httpd,
   if (i == data_len)
     return TRUE;
 
+  /* Remember where this request ends; anything after it is a pipelined
+     request parsed after this one completes. */
+  conn->req_len = i + 4;
+
   SILC_LOG_HEXDUMP(("HTTP data"), silc_buffer_data(conn->inbuf),
 		   silc_buffer_len(conn->inbuf));
 
@@ -204,6 +319,7 @@ static SilcBool silc_http_server_parse(SilcHttpServer httpd,
       }
     }
 
+    conn->req_len = (tmp - data) + data_len;
     silc_buffer_set(&postdata, tmp, data_len);
     SILC_LOG_HEXDUMP(("HTTP POST data"), tmp, data_len);
 
@@ -296,6 +412,93 @@ static SilcHttpConnection silc_http_server_alloc_connection(void)
   return conn;
 }
 
+/* Looks up `filename' from the open file cache, opening and caching it
+   if not there.  The least recently used entry is evicted when the
+   cache is full. */
+
+static SilcHttpServerFile silc_http_server_get_file(SilcHttpServer httpd,
+						    const char *filename)
+{
+  SilcHttpServerFile file;
+  struct stat st;
+  int fd;
+
+  silc_list_start(httpd->fdcache);
+  while ((file = silc_list_get(httpd->fdcache)))
+    if (!strcmp(file->filename, filename)) {
+      /* Move to the tail, most recently used */
+      silc_list_del(httpd->fdcache, file);
+      silc_list_add(httpd->fdcache, file);
+      return file;
+    }
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    silc_set_errno_posix(errno);
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    silc_set_errno(SILC_ERR_BAD_ADDRESS);
+    return NULL;
+  }
+
+  file = silc_calloc(1, sizeof(*file));
+  if (!file) {
+    close(fd);
+    return NULL;
+  }
+  file->filename = silc_strdup(filename);
+  file->fd = fd;
+  file->size = (SilcUInt64)st.st_size;
+
+  /* Evict the least recently used entry */
+  if (silc_list_count(httpd->fdcache) >= SILC_HTTP_SERVER_FD_CACHE) {
+    SilcHttpServerFile evict;
+    silc_list_start(httpd->fdcache);
+    evict = silc_list_get(httpd->fdcache);
+    if (evict) {
+      silc_list_del(httpd->fdcache, evict);
+      close(evict->fd);
+      silc_free(evict->filename);
+      silc_free(evict);
+    }
+  }
+
+  silc_list_add(httpd->fdcache, file);
+
+  return file;
+}
+
+/* Streams more of the file being sent.  Called when the stream can be
+   written. */
+
+static void silc_http_server_pump_file(SilcHttpConnection conn)
+{
+  int ret;
+
+  while (conn->file_offset < conn->file_size) {
+    ret = silc_socket_stream_sendfile(conn->stream, conn->file_stream,
+				      &conn->file_offset,
+				      (SilcUInt32)(conn->file_size -
+						   conn->file_offset));
+    if (ret == -1)
+      /* Continues when the stream is writable again */
+      return;
+    if (ret == 0 || ret == -2) {
+      conn->keepalive = FALSE;
+      break;
+    }
+  }
+
+  conn->sending_file = FALSE;
+  silc_stream_destroy(conn->file_stream);
+  conn->file_stream = NULL;
+
+  SILC_LOG_DEBUG(("File sent %p", conn));
+  silc_http_server_close_connection(conn);
+}
+
 /* Check if connection has timedout */
 
 SILC_TASK_CALLBACK(silc_http_server_connection_timeout)
@@ -390,6 +593,16 @@ static void silc_http_server_io(SilcStream stream, SilcStreamStatus status,
       silc_buffer_pull(conn->outbuf, ret);
     }
 
+    /* Continue streaming a file response */
+    if (conn->sending_file) {
+      silc_http_server_pump_file(conn);
+      break;
+    }
+
+    /* A chunked response is still in progress; more chunks will come */
+    if (conn->chunked)
+      break;
+
     /* Data sent, close connection */
     SILC_LOG_DEBUG(("Data sent"));
     silc_http_server_close_connection(conn);
@@ -484,6 +697,8 @@ SilcHttpServer silc_http_server_alloc(const char *ip, SilcUInt16 port,
 
   silc_list_init(httpd->conns, struct SilcHttpConnectionStruct, next);
   silc_list_init(httpd->allconns, struct SilcHttpConnectionStruct, next2);
+  silc_list_init_prev(httpd->fdcache, struct SilcHttpServerFileStruct,
+		      next, prev);
 
   /* Allocate connections list */
   for (i = 0; i < SILC_HTTP_SERVER_CONNS; i++) {
@@ -500,6 +715,27 @@ SilcHttpServer silc_http_server_alloc(const char *ip, SilcUInt16 port,
   return httpd;
 }
 
+/* Set connection pool size */
+
+SilcBool silc_http_server_set_conns(SilcHttpServer httpd,
+				    SilcUInt32 num_conns)
+{
+  SilcHttpConnection conn;
+  SilcUInt32 i, count = silc_list_count(httpd->allconns);
+
+  /* Pre-allocate connection contexts up to `num_conns' */
+  for (i = count; i < num_conns; i++) {
+    conn = silc_http_server_alloc_connection();
+    if (!conn)
+      return FALSE;
+    silc_list_add(httpd->conns, conn);
+    silc_list_add(httpd->allconns, conn);
+    conn->httpd = httpd;
+  }
+
+  return TRUE;
+}
+
 /* Free HTTP server */
 
 void silc_http_server_free(SilcHttpServer httpd)
@@ -519,6 +755,17 @@ void silc_http_server_free(SilcHttpServer httpd)
   if (httpd->listener)
     silc_net_close_listener(httpd->listener);
 
+  /* Free the open file cache */
+  {
+    SilcHttpServerFile file;
+    silc_list_start(httpd->fdcache);
+    while ((file = silc_list_get(httpd->fdcache))) {
+      close(file->fd);
+      silc_free(file->filename);
+      silc_free(file);
+    }
+  }
+
   silc_free(httpd);
 }
 
@@ -531,34 +778,353 @@ SilcBool silc_http_server_send(SilcHttpServer httpd,
   SilcBufferStruct h;
   unsigned char *headers, tmp[16];
   SilcUInt32 headers_len;
-  SilcBool ret;
+  SilcStreamIOVec iov[3];
+  SilcUInt32 i, total;
+  int wret;
 
   SILC_LOG_DEBUG(("Sending HTTP data"));
 
   conn->touched = silc_time();
 
-  /* Write headers */
-  silc_buffer_set(&h, SILC_HTTP_SERVER_HEADER,
-		  strlen(SILC_HTTP_SERVER_HEADER));
-  ret = silc_http_server_send_internal(httpd, conn, &h, TRUE);
-  if (!ret) {
+  if (!conn->headers) {
+    conn->headers = silc_mime_alloc();
+    if (!conn->headers) {
+      conn->keepalive = FALSE;
+      silc_http_server_close_connection(conn);
+      return FALSE;
+    }
+  }
+
+  silc_mime_add_field(conn->headers, "Date",
+		      silc_http_server_date(httpd));
+  silc_mime_add_field(conn->headers, "Last-Modified",
+		      silc_http_server_date(httpd));
+  silc_snprintf(tmp, sizeof(tmp), "%d", (int)silc_buffer_len(data));
+  silc_mime_add_field(conn->headers, "Content-Length", tmp);
+  if (conn->keepalive) {
+    silc_mime_add_field(conn->headers, "Connection", "keep-alive");
+    silc_snprintf(tmp, sizeof(tmp), "%d", (int)SILC_HTTP_SERVER_TIMEOUT);
+    silc_mime_add_field(conn->headers, "Keep-alive", tmp);
+  }
+
+  headers = silc_mime_encode(conn->headers, &headers_len);
+  if (!headers) {
     conn->keepalive = FALSE;
     silc_http_server_close_connection(conn);
     return FALSE;
   }
 
-  if (!conn->headers) {
-    conn->headers = silc_mime_alloc();
+  /* Send the status line, the headers and the body as one gather list
+     instead of three separate writes. */
+  iov[0].data = (unsigned char *)SILC_HTTP_SERVER_HEADER;
+  iov[0].data_len = strlen(SILC_HTTP_SERVER_HEADER);
+  iov[1].data = headers;
+  iov[1].data_len = headers_len;
+  iov[2].data = silc_buffer_data(data);
+  iov[2].data_len = silc_buffer_len(data);
+  total = iov[0].data_len + iov[1].data_len + iov[2].data_len;
+
+  wret = silc_stream_writev(conn->stream, iov, 3);
+  if (wret == 0 || wret == -2) {
+    silc_free(headers);
+    conn->keepalive = FALSE;
+    silc_http_server_close_connection(conn);
+    return FALSE;
+  }
+  if (wret == -1)
+    wret = 0;
+
+  if ((SilcUInt32)wret < total) {
+    /* Queue the unwritten remainder; sent when the stream is writable */
+    for (i = 0; i < 3; i++) {
+      SilcUInt32 skip = wret < iov[i].data_len ? wret : iov[i].data_len;
+      iov[i].data += skip;
+      iov[i].data_len -= skip;
+      wret -= skip;
+      if (!iov[i].data_len)
+	continue;
+      silc_buffer_set(&h, iov[i].data, iov[i].data_len);
+      if (!silc_http_server_send_internal(httpd, conn, &h, TRUE)) {
+	silc_free(headers);
+	conn->keepalive = FALSE;
+	silc_http_server_close_connection(conn);
+	return FALSE;
+      }
+    }
+    silc_free(headers);
+    return TRUE;
+  }
+
+  silc_free(headers);
+
+  /* All data sent */
+  silc_http_server_close_connection(conn);
+  return TRUE;
+}
+
+/* Send HTTP data with a precomputed header block */
+
+SilcBool silc_http_server_send_static(SilcHttpServer httpd,
+				      SilcHttpConnection conn,
+				      const char *header_block,
+				      SilcBuffer data)
+{
+  SilcBufferStruct h;
+  unsigned char dyn[256];
+  SilcStreamIOVec iov[4];
+  SilcUInt32 i, total, dyn_len;
+  int wret;
+
+  SILC_LOG_DEBUG(("Sending HTTP data with precomputed headers"));
+
+  if (!conn || !conn->stream || !data) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  conn->touched = silc_time();
+
+  /* Only the per-request header lines are rendered; the registered
+     block is concatenated as is. */
+  if (conn->keepalive)
+    dyn_len = silc_snprintf((char *)dyn, sizeof(dyn),
+			    "Date: %s\r\nContent-Length: %d\r\n"
+			    "Connection: keep-alive\r\n"
+			    "Keep-alive: %d\r\n\r\n",
+			    silc_http_server_date(httpd),
+			    (int)silc_buffer_len(data),
+			    (int)SILC_HTTP_SERVER_TIMEOUT);
+  else
+    dyn_len = silc_snprintf((char *)dyn, sizeof(dyn),
+			    "Date: %s\r\nContent-Length: %d\r\n\r\n",
+			    silc_http_server_date(httpd),
+			    (int)silc_buffer_len(data));
+
+  iov[0].data = (unsigned char *)SILC_HTTP_SERVER_HEADER;
+  iov[0].data_len = strlen(SILC_HTTP_SERVER_HEADER);
+  iov[1].data = (unsigned char *)(header_block ? header_block : "");
+  iov[1].data_len = header_block ? strlen(header_block) : 0;
+  iov[2].data = dyn;
+  iov[2].data_len = dyn_len;
+  iov[3].data = silc_buffer_data(data);
+  iov[3].data_len = silc_buffer_len(data);
+  total = iov[0].data_len + iov[1].data_len + iov[2].data_len +
+    iov[3].data_len;
+
+  wret = silc_stream_writev(conn->stream, iov, 4);
+  if (wret == 0 || wret == -2) {
+    conn->keepalive = FALSE;
+    silc_http_server_close_connection(conn);
+    return FALSE;
+  }
+  if (wret == -1)
+    wret = 0;
+
+  if ((SilcUInt32)wret < total) {
+    /* Queue the unwritten remainder; sent when the stream is writable */
+    for (i = 0; i < 4; i++) {
+      SilcUInt32 skip = wret < iov[i].data_len ? wret : iov[i].data_len;
+      iov[i].data += skip;
+      iov[i].data_len -= skip;
+      wret -= skip;
+      if (!iov[i].data_len)
+	continue;
+      silc_buffer_set(&h, iov[i].data, iov[i].data_len);
+      if (!silc_http_server_send_internal(httpd, conn, &h, TRUE)) {
+	conn->keepalive = FALSE;
+	silc_http_server_close_connection(conn);
+	return FALSE;
+      }
+    }
+    return TRUE;
+  }
+
+  /* All data sent */
+  silc_http_server_close_connection(conn);
+  return TRUE;
+}
+
+/* Send error reply */
+
+/* Send one chunk of a chunked response */
+
+SilcBool silc_http_server_send_chunk(SilcHttpServer httpd,
+				     SilcHttpConnection conn,
+				     SilcBuffer data)
+{
+  SilcBufferStruct h;
+  SilcStreamIOVec iov[3];
+  unsigned char *headers, sizeline[16], tmp[16];
+  SilcUInt32 headers_len, i, total;
+  int wret;
+
+  conn->touched = silc_time();
+
+  if (!conn->chunked) {
+    /* First chunk; send the headers with chunked transfer encoding.
+       HTTP/1.0 peers get an unframed body delimited by connection
+       close. */
     if (!conn->headers) {
+      conn->headers = silc_mime_alloc();
+      if (!conn->headers)
+	goto err;
+    }
+
+    silc_mime_add_field(conn->headers, "Date",
+			silc_http_server_date(httpd));
+    silc_mime_add_field(conn->headers, "Last-Modified",
+			silc_http_server_date(httpd));
+    if (conn->keepalive) {
+      silc_mime_add_field(conn->headers, "Transfer-Encoding", "chunked");
+      silc_mime_add_field(conn->headers, "Connection", "keep-alive");
+      silc_snprintf(tmp, sizeof(tmp), "%d", (int)SILC_HTTP_SERVER_TIMEOUT);
+      silc_mime_add_field(conn->headers, "Keep-alive", tmp);
+    }
+
+    silc_buffer_set(&h, (unsigned char *)SILC_HTTP_SERVER_HEADER,
+		    strlen(SILC_HTTP_SERVER_HEADER));
+    if (!silc_http_server_send_internal(httpd, conn, &h, TRUE))
+      goto err;
+
+    headers = silc_mime_encode(conn->headers, &headers_len);
+    if (headers) {
+      silc_buffer_set(&h, headers, headers_len);
+      if (!silc_http_server_send_internal(httpd, conn, &h, TRUE)) {
+	silc_free(headers);
+	goto err;
+      }
+      silc_free(headers);
+    }
+
+    conn->chunked = TRUE;
+  }
+
+  if (!data || !silc_buffer_len(data))
+    return TRUE;
+
+  if (!conn->keepalive) {
+    /* Unframed body */
+    return silc_http_server_send_internal(httpd, conn, data, TRUE);
+  }
+
+  /* Chunk header, data and trailer as one gather list */
+  silc_snprintf((char *)sizeline, sizeof(sizeline), "%x\r\n",
+		(unsigned int)silc_buffer_len(data));
+  iov[0].data = sizeline;
+  iov[0].data_len = strlen((char *)sizeline);
+  iov[1].data = silc_buffer_data(data);
+  iov[1].data_len = silc_buffer_len(data);
+  iov[2].data = (unsigned char *)"\r\n";
+  iov[2].data_len = 2;
+  total = iov[0].data_len + iov[1].data_len + iov[2].data_len;
+
+  wret = silc_stream_writev(conn->stream, iov, 3);
+  if (wret == 0 || wret == -2)
+    goto err;
+  if (wret == -1)
+    wret = 0;
+
+  /* Queue the unwritten remainder */
+  for (i = 0; i < 3 && (SilcUInt32)wret < total; i++) {
+    SilcUInt32 skip = (SilcUInt32)wret < iov[i].data_len ?
+      (SilcUInt32)wret : iov[i].data_len;
+    iov[i].data += skip;
+    iov[i].data_len -= skip;
+    wret -= skip;
+    if (!iov[i].data_len)
+      continue;
+    silc_buffer_set(&h, iov[i].data, iov[i].data_len);
+    if (!silc_http_server_send_internal(httpd, conn, &h, TRUE))
+      goto err;
+  }
+
+  return TRUE;
+
+ err:
+  conn->chunked = FALSE;
+  conn->keepalive = FALSE;
+  silc_http_server_close_connection(conn);
+  return FALSE;
+}
+
+/* End a chunked response */
+
+SilcBool silc_http_server_send_end(SilcHttpServer httpd,
+				   SilcHttpConnection conn)
+{
+  SilcBufferStruct h;
+  SilcBool chunked = conn->chunked;
+
+  conn->touched = silc_time();
+  conn->chunked = FALSE;
+
+  if (chunked && conn->keepalive) {
+    /* Last chunk */
+    silc_buffer_set(&h, (unsigned char *)"0\r\n\r\n", 5);
+    if (!silc_http_server_send_internal(httpd, conn, &h, TRUE)) {
       conn->keepalive = FALSE;
       silc_http_server_close_connection(conn);
       return FALSE;
     }
   }
 
+  if (!silc_buffer_len(conn->outbuf)) {
+    /* Everything sent */
+    if (!chunked || !conn->keepalive)
+      conn->keepalive = FALSE;
+    silc_http_server_close_connection(conn);
+  }
+
+  return TRUE;
+}
+
+/* Send file as HTTP response */
+
+SilcBool silc_http_server_send_file(SilcHttpServer httpd,
+				    SilcHttpConnection conn,
+				    const char *filename)
+{
+  SilcHttpServerFile file;
+  SilcBufferStruct h;
+  unsigned char *headers, tmp[32];
+  SilcUInt32 headers_len;
+  int fd;
+
+  SILC_LOG_DEBUG(("Sending file %s", filename));
+
+  conn->touched = silc_time();
+
+  file = silc_http_server_get_file(httpd, filename);
+  if (!file)
+    return FALSE;
+
+  /* The cached fd is shared; the response streams through its own
+     duplicate so the cache entry stays open. */
+  fd = dup(file->fd);
+  if (fd < 0) {
+    silc_set_errno_posix(errno);
+    return FALSE;
+  }
+  conn->file_stream = silc_fd_stream_create(fd, NULL);
+  if (!conn->file_stream) {
+    close(fd);
+    return FALSE;
+  }
+  conn->file_offset = 0;
+  conn->file_size = file->size;
+
+  /* Send the headers */
+  if (!conn->headers) {
+    conn->headers = silc_mime_alloc();
+    if (!conn->headers)
+      goto err;
+  }
+  silc_mime_add_field(conn->headers, "Date",
+		      silc_http_server_date(httpd));
   silc_mime_add_field(conn->headers, "Last-Modified",
-		      silc_time_string(conn->touched));
-  silc_snprintf(tmp, sizeof(tmp), "%d", (int)silc_buffer_len(data));
+		      silc_http_server_date(httpd));
+  silc_snprintf(tmp, sizeof(tmp), "%llu",
+		(unsigned long long)file->size);
   silc_mime_add_field(conn->headers, "Content-Length", tmp);
   if (conn->keepalive) {
     silc_mime_add_field(conn->headers, "Connection", "keep-alive");
@@ -566,22 +1132,36 @@ SilcBool silc_http_server_send(SilcHttpServer httpd,
     silc_mime_add_field(conn->headers, "Keep-alive", tmp);
   }
 
+  silc_buffer_set(&h, (unsigned char *)SILC_HTTP_SERVER_HEADER,
+		  strlen(SILC_HTTP_SERVER_HEADER));
+  if (!silc_http_server_send_internal(httpd, conn, &h, TRUE))
+    goto err;
+
   headers = silc_mime_encode(conn->headers, &headers_len);
   if (headers) {
     silc_buffer_set(&h, headers, headers_len);
     if (!silc_http_server_send_internal(httpd, conn, &h, TRUE)) {
-      conn->keepalive = FALSE;
-      silc_http_server_close_connection(conn);
-      return FALSE;
+      silc_free(headers);
+      goto err;
     }
     silc_free(headers);
   }
 
-  /* Write the page data */
-  return silc_http_server_send_internal(httpd, conn, data, FALSE);
-}
+  conn->sending_file = TRUE;
 
-/* Send error reply */
+  /* Stream the body now if the headers went out in full */
+  if (!silc_buffer_len(conn->outbuf))
+    silc_http_server_pump_file(conn);
+
+  return TRUE;
+
+ err:
+  silc_stream_destroy(conn->file_stream);
+  conn->file_stream = NULL;
+  conn->keepalive = FALSE;
+  silc_http_server_close_connection(conn);
+  return FALSE;
+}
 
 SilcBool silc_http_server_send_error(SilcHttpServer httpd,
 				     SilcHttpConnection conn,
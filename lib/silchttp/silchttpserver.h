@@ -153,6 +153,113 @@ SilcBool silc_http_server_send(SilcHttpServer httpd,
 			       SilcHttpConnection conn,
 			       SilcBuffer data);
 
+/****f* silchttp/silc_http_server_send_static
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_http_server_send_static(SilcHttpServer httpd,
+ *                                          SilcHttpConnection conn,
+ *                                          const char *header_block,
+ *                                          SilcBuffer data);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_http_server_send but takes the response headers as the
+ *    precomputed `header_block', complete "Field: value\r\n" lines the
+ *    application has rendered once for a hot route (for example its
+ *    Content-Type and cache headers).  Only the Date, Content-Length
+ *    and connection headers are rendered per request; everything is
+ *    sent as one gather list without building a header structure.  The
+ *    Date header string itself is cached and re-rendered at most once
+ *    per second.
+ *
+ ***/
+SilcBool silc_http_server_send_static(SilcHttpServer httpd,
+				      SilcHttpConnection conn,
+				      const char *header_block,
+				      SilcBuffer data);
+
+/****f* silchttp/silc_http_server_set_conns
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_http_server_set_conns(SilcHttpServer httpd,
+ *                                        SilcUInt32 num_conns);
+ *
+ * DESCRIPTION
+ *
+ *    Pre-allocates connection contexts so that the server can serve
+ *    `num_conns' concurrent connections without allocating contexts on
+ *    the accept path.  By default only a couple of contexts are
+ *    pre-allocated and the pool grows by allocation.  Returns FALSE on
+ *    allocation error.
+ *
+ ***/
+SilcBool silc_http_server_set_conns(SilcHttpServer httpd,
+				    SilcUInt32 num_conns);
+
+/****f* silchttp/silc_http_server_send_chunk
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_http_server_send_chunk(SilcHttpServer httpd,
+ *                                         SilcHttpConnection conn,
+ *                                         SilcBuffer data);
+ *
+ * DESCRIPTION
+ *
+ *    Sends one piece of a streamed response to `conn'.  The first call
+ *    sends the response headers with chunked transfer encoding; each
+ *    call then sends `data' as one chunk, so a response of unbounded
+ *    size streams with bounded memory.  To HTTP/1.0 clients the body is
+ *    sent unframed and delimited by connection close.  The response is
+ *    completed with silc_http_server_send_end.  Returns FALSE on send
+ *    error, in which case the connection has been closed.
+ *
+ ***/
+SilcBool silc_http_server_send_chunk(SilcHttpServer httpd,
+				     SilcHttpConnection conn,
+				     SilcBuffer data);
+
+/****f* silchttp/silc_http_server_send_end
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_http_server_send_end(SilcHttpServer httpd,
+ *                                       SilcHttpConnection conn);
+ *
+ * DESCRIPTION
+ *
+ *    Ends a streamed response started with silc_http_server_send_chunk,
+ *    sending the last-chunk marker and completing the request.
+ *
+ ***/
+SilcBool silc_http_server_send_end(SilcHttpServer httpd,
+				   SilcHttpConnection conn);
+
+/****f* silchttp/silc_http_server_send_file
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_http_server_send_file(SilcHttpServer httpd,
+ *                                        SilcHttpConnection conn,
+ *                                        const char *filename);
+ *
+ * DESCRIPTION
+ *
+ *    Sends the contents of the file `filename' as the HTTP response to
+ *    the `conn'.  The file is streamed to the connection with zero-copy
+ *    sendfile where available instead of being read into a buffer, so
+ *    large files are served with bounded memory.  Open files and their
+ *    sizes are cached in the server, least recently used evicted.
+ *    Returns FALSE if the file cannot be opened (the caller should then
+ *    send an error response) or if sending fails.
+ *
+ ***/
+SilcBool silc_http_server_send_file(SilcHttpServer httpd,
+				    SilcHttpConnection conn,
+				    const char *filename);
+
 /****f* silchttp/silc_http_server_send_error
  *
  * SYNOPSIS
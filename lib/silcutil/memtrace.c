@@ -88,6 +88,8 @@ static SilcBool no_free = FALSE;
 static SilcBool dump_mem = FALSE;
 static SilcBool no_allocated = FALSE;
 static SilcUInt32 pg = 0;
+static SilcUInt32 sample_rate = 0;
+static SilcUInt32 sample_counter = 0;
 static SilcMutex lock = NULL;
 
 #ifdef SILC_DEBUG
@@ -107,6 +109,7 @@ typedef struct SilcStBlockStruct {
   SilcUInt16 free_line;		/* Free line in program */
   SilcUInt16 depth;		/* Depth of stack trace */
   SilcUInt16 dumpped;		/* Block is dumpped */
+  SilcUInt16 sampled;		/* Block is in the block tree */
   SilcUInt32 bound;		/* Top bound */
 } *SilcStBlock;
 
@@ -240,6 +243,12 @@ void silc_st_memtrace_init(void)
   if (var && *var == '1')
     dump_mem = TRUE;
 
+  /* Sampling mode; only every Nth allocation is traced, making the
+     tracing cheap enough to leave enabled in deployment. */
+  var = silc_getenv("SILC_MALLOC_SAMPLE");
+  if (var && atoi(var) > 0)
+    sample_rate = atoi(var);
+
   var = silc_getenv("SILC_MALLOC_PROTECT");
   if (var && *var == '1') {
     struct sigaction sa;
@@ -308,12 +317,21 @@ void *silc_st_malloc(size_t size, const char *file, int line)
   stack->line = line;
   stack->size = size;
   stack->bound = SILC_ST_TOP_BOUND;
-  stack->depth = backtrace(stack->stack, SILC_ST_DEPTH);
 
-  silc_mutex_lock(lock);
-  silc_tree_add(st_blocks, stack);
-  st_num_malloc++;
-  silc_mutex_unlock(lock);
+  /* In sampling mode only every Nth allocation takes the stack trace
+     and enters the block tree; the rest pay only for the header. */
+  stack->sampled = (!sample_rate ||
+		    (++sample_counter % sample_rate) == 0);
+  if (stack->sampled) {
+    stack->depth = backtrace(stack->stack, SILC_ST_DEPTH);
+
+    silc_mutex_lock(lock);
+    silc_tree_add(st_blocks, stack);
+    st_num_malloc++;
+    silc_mutex_unlock(lock);
+  } else {
+    stack->depth = 0;
+  }
 
   if (!pg)
     *SILC_ST_GET_BOUND(stack, size) = SILC_ST_BOTTOM_BOUND;
@@ -384,18 +402,20 @@ void silc_st_free(void *ptr, const char *file, int line)
 		    stack);
   }
 
-  silc_mutex_lock(lock);
+  if (stack->sampled) {
+    silc_mutex_lock(lock);
 
-  /* Check if we have ever made this allocation */
-  if (!no_allocated && !silc_tree_find(st_blocks, stack))
-    silc_st_abort(NULL, file, line,
-		  "SILC_MALLOC: %p was never allocated\n", stack);
+    /* Check if we have ever made this allocation */
+    if (!no_allocated && !silc_tree_find(st_blocks, stack))
+      silc_st_abort(NULL, file, line,
+		    "SILC_MALLOC: %p was never allocated\n", stack);
 
-  if (!silc_tree_del(st_blocks, stack))
-    silc_st_abort(NULL, file, line,
-		  "SILC_MALLOC: %p was never allocated\n", stack);
+    if (!silc_tree_del(st_blocks, stack))
+      silc_st_abort(NULL, file, line,
+		    "SILC_MALLOC: %p was never allocated\n", stack);
 
-  silc_mutex_unlock(lock);
+    silc_mutex_unlock(lock);
+  }
 
   stack->free_file = file;
   stack->free_line = line;
@@ -432,6 +452,66 @@ void *silc_st_strdup(const char *string, const char *file, int line)
   return silc_st_memdup(string, strlen(string), file, line);
 }
 
+/* Dumps the current live allocations to stderr as a histogram grouped
+   by allocation site.  Unlike silc_st_dump this may be called at any
+   time at runtime; with sampling enabled the counts are the sampled
+   subset. */
+
+void silc_st_dump_live(void)
+{
+  SilcStBlock stack, s;
+  unsigned long total_blocks = 0, total_bytes = 0, blocks, bytes;
+
+  silc_mutex_lock(lock);
+
+  for (stack = silc_tree_enumerate(st_blocks, NULL); stack != NULL;
+       stack = silc_tree_enumerate(st_blocks, stack))
+    stack->dumpped = 0;
+
+  for (stack = silc_tree_enumerate(st_blocks, NULL); stack != NULL;
+       stack = silc_tree_enumerate(st_blocks, stack)) {
+    if (stack->dumpped)
+      continue;
+
+    blocks = 0;
+    bytes = 0;
+    for (s = stack; s; s = silc_tree_enumerate_duplicates(st_blocks, s)) {
+      if (s->file == stack->file && s->line == stack->line) {
+	s->dumpped = 1;
+	blocks++;
+	bytes += s->size;
+      }
+    }
+
+    /* Group also over non-duplicate entries with the same site */
+    for (s = silc_tree_enumerate(st_blocks, stack); s;
+	 s = silc_tree_enumerate(st_blocks, s)) {
+      if (!s->dumpped && s->file == stack->file && s->line == stack->line) {
+	s->dumpped = 1;
+	blocks++;
+	bytes += s->size;
+      }
+    }
+
+    fprintf(stderr, "silc_malloc: %lu bytes in %lu blocks, %s:%d%s\n",
+	    bytes, blocks, stack->file, stack->line,
+	    sample_rate ? " (sampled)" : "");
+
+    total_blocks += blocks;
+    total_bytes += bytes;
+  }
+
+  fprintf(stderr, "silc_malloc: total %lu live bytes in %lu blocks%s\n",
+	  total_bytes, total_blocks,
+	  sample_rate ? " (sampled subset)" : "");
+
+  for (stack = silc_tree_enumerate(st_blocks, NULL); stack != NULL;
+       stack = silc_tree_enumerate(st_blocks, stack))
+    stack->dumpped = 0;
+
+  silc_mutex_unlock(lock);
+}
+
 /* Dumps the stack into file if there are leaks. */
 
 void silc_st_dump(void)
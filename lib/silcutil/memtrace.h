@@ -43,6 +43,7 @@ void silc_st_free(void *ptr, const char *file, int line);
 void *silc_st_memdup(const void *ptr, size_t size, const char *file, int line);
 void *silc_st_strdup(const char *string, const char *file, int line);
 void silc_st_dump(void);
+void silc_st_dump_live(void);
 
 #else
 #error "memory allocation stack trace not supported on this platform"
@@ -61,17 +61,54 @@ void silc_async_abort(SilcAsyncOperation op,
 
 /* Creates new async operation */
 
+/* Per-thread operation pool.  Call paths that create and complete large
+   numbers of operations (resolver, connect) recycle the contexts through
+   this pool instead of the heap. */
+typedef struct {
+  SilcAsyncOperation free_ops;		/* Recycled operations */
+  SilcUInt32 free_count;		/* Number of recycled operations */
+  SilcUInt32 hits;			/* Allocations served from pool */
+  SilcUInt32 misses;			/* Allocations from the heap */
+} SilcAsyncPool;
+
+/* Maximum operations kept in a thread's pool */
+#define SILC_ASYNC_POOL_MAX 64
+
+/* Returns the calling thread's operation pool */
+
+static SilcAsyncPool *silc_async_pool(void)
+{
+  SilcAsyncPool *pool = silc_global_get_var("srtasyncpool", TRUE);
+
+  if (!pool)
+    pool = silc_global_set_var("srtasyncpool", sizeof(*pool), NULL, TRUE);
+
+  return pool;
+}
+
 SilcAsyncOperation silc_async_alloc(SilcAsyncOperationAbort abort_cb,
 				    SilcAsyncOperationPause pause_cb,
 				    void *context)
 {
-  SilcAsyncOperation op;
+  SilcAsyncPool *pool = silc_async_pool();
+  SilcAsyncOperation op = NULL;
 
   SILC_LOG_DEBUG(("Creating new async operation"));
 
-  op = silc_calloc(1, sizeof(*op));
-  if (!op)
-    return NULL;
+  /* Get from the pool or allocate */
+  if (pool && pool->free_ops) {
+    op = pool->free_ops;
+    pool->free_ops = op->pool_next;
+    pool->free_count--;
+    pool->hits++;
+    memset(op, 0, sizeof(*op));
+  } else {
+    if (pool)
+      pool->misses++;
+    op = silc_calloc(1, sizeof(*op));
+    if (!op)
+      return NULL;
+  }
 
   silc_async_init(op, abort_cb, pause_cb, context);
 
@@ -80,6 +117,21 @@ SilcAsyncOperation silc_async_alloc(SilcAsyncOperationAbort abort_cb,
   return op;
 }
 
+/* Return operation pool statistics of the calling thread */
+
+void silc_async_get_stats(SilcUInt32 *ret_hits, SilcUInt32 *ret_misses,
+			  SilcUInt32 *ret_pooled)
+{
+  SilcAsyncPool *pool = silc_async_pool();
+
+  if (ret_hits)
+    *ret_hits = pool ? pool->hits : 0;
+  if (ret_misses)
+    *ret_misses = pool ? pool->misses : 0;
+  if (ret_pooled)
+    *ret_pooled = pool ? pool->free_count : 0;
+}
+
 /* Creates new async operation */
 
 SilcBool silc_async_init(SilcAsyncOperation op,
@@ -99,8 +151,22 @@ SilcBool silc_async_init(SilcAsyncOperation op,
 
 void silc_async_free(SilcAsyncOperation op)
 {
+  SilcAsyncPool *pool;
+
   if (op->allocated) {
     SILC_LOG_DEBUG(("Stopping async operation"));
+
+    /* Recycle through the thread's pool.  Operations that completed
+       synchronously come and go through the pool head without ever
+       touching the heap. */
+    pool = silc_async_pool();
+    if (pool && pool->free_count < SILC_ASYNC_POOL_MAX) {
+      op->pool_next = pool->free_ops;
+      pool->free_ops = op;
+      pool->free_count++;
+      return;
+    }
+
     silc_free(op);
   }
 }
@@ -111,3 +177,41 @@ void *silc_async_get_context(SilcAsyncOperation op)
 {
   return op->context;
 }
+
+/* Per-thread direct completion mode flag */
+
+static SilcBool *silc_async_direct_flag(void)
+{
+  SilcBool *f;
+
+  f = silc_global_get_var("srtasyncdirect", TRUE);
+  if (!f)
+    f = silc_global_set_var("srtasyncdirect", sizeof(*f), NULL, TRUE);
+
+  return f;
+}
+
+/* Set direct completion mode for the calling thread */
+
+void silc_async_set_direct(SilcBool enable)
+{
+  SilcBool *f = silc_async_direct_flag();
+
+  if (f)
+    *f = enable;
+}
+
+/* Return TRUE if a completion targeting `schedule' may be invoked
+   directly on the calling thread */
+
+SilcBool silc_async_direct(SilcSchedule schedule)
+{
+  SilcBool *f = silc_async_direct_flag();
+
+  if (!f || !*f)
+    return FALSE;
+
+  /* Safe only when the completion would run on this same thread's
+     scheduler anyway; cross-thread completions must be deferred. */
+  return schedule && silc_schedule_get_global() == schedule;
+}
@@ -326,4 +326,62 @@ void *silc_async_get_context(SilcAsyncOperation op);
 
 #include "silcasync_i.h"
 
+/****f* silcutil/silc_async_get_stats
+ *
+ * SYNOPSIS
+ *
+ *    void silc_async_get_stats(SilcUInt32 *ret_hits,
+ *                              SilcUInt32 *ret_misses,
+ *                              SilcUInt32 *ret_pooled);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the calling thread's async operation pool statistics: the
+ *    number of operations served from the pool, the number that had to
+ *    be allocated from the heap, and the number currently pooled.
+ *    Operations allocated with silc_async_alloc are recycled through a
+ *    per-thread pool, so operations that complete immediately never
+ *    touch the heap after warmup.
+ *
+ ***/
+void silc_async_get_stats(SilcUInt32 *ret_hits, SilcUInt32 *ret_misses,
+			  SilcUInt32 *ret_pooled);
+
+/****f* silcutil/silc_async_set_direct
+ *
+ * SYNOPSIS
+ *
+ *    void silc_async_set_direct(SilcBool enable);
+ *
+ * DESCRIPTION
+ *
+ *    Enables direct completion mode for the calling thread.  In this
+ *    mode asynchronous interfaces that complete synchronously (a DNS
+ *    cache hit, an already-connected socket) may invoke the completion
+ *    callback immediately instead of deferring it through the
+ *    scheduler, saving a loop round trip.  The callback can then run
+ *    inside the call that started the operation, so only enable this
+ *    when the callers are reentrancy safe.  Off by default.
+ *
+ ***/
+void silc_async_set_direct(SilcBool enable);
+
+/****f* silcutil/silc_async_direct
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_async_direct(SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Returns TRUE when a completion targeting the `schedule' may be
+ *    invoked directly on the calling thread: direct completion mode is
+ *    enabled on this thread and `schedule' is this thread's scheduler.
+ *    Operation layers call this before short-circuiting a completion;
+ *    when it returns FALSE the completion must be deferred through the
+ *    scheduler as usual.
+ *
+ ***/
+SilcBool silc_async_direct(SilcSchedule schedule);
+
 #endif /* SILCASYNC_H */
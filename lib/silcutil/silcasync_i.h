@@ -29,6 +29,7 @@ struct SilcAsyncOperationObject {
   SilcAsyncOperationAbort abort_cb;
   SilcAsyncOperationPause pause_cb;
   void *context;
+  struct SilcAsyncOperationObject *pool_next; /* Operation pool linkage */
   unsigned int allocated  : 1;
 };
 
@@ -1262,4 +1262,216 @@ SilcBool silc_atomic_cas_pointer(SilcAtomicPointer *atomic, void *old_val,
 #endif
 }
 
+/****s* silcutil/SilcAtomic64
+ *
+ * NAME
+ *
+ *    typedef struct { ... } SilcAtomic64;
+ *
+ * DESCRIPTION
+ *
+ *    64-bit atomic integer for counters that would wrap a 32-bit value,
+ *    such as byte counters on fast links.  Operated with the
+ *    silc_atomic_*_int64 functions.  On compilers with 64-bit atomic
+ *    builtins the operations are lock free; otherwise a mutex protects
+ *    the value.
+ *
+ ***/
+#if defined(__GNUC__) && (defined(SILC_X86_64) || defined(SILC_IA64) || 			  defined(__aarch64__) || !defined(SILC_THREADS))
+#define SILC_ATOMIC64_BUILTIN
+typedef struct {
+  volatile SilcUInt64 value;
+} SilcAtomic64;
+#else
+typedef struct {
+  SilcMutex lock;
+  SilcUInt64 value;
+} SilcAtomic64;
+#endif
+
+static inline
+SilcBool silc_atomic_init64(SilcAtomic64 *atomic, SilcUInt64 value)
+{
+  atomic->value = value;
+#if !defined(SILC_ATOMIC64_BUILTIN)
+  if (!silc_mutex_alloc(&atomic->lock))
+    return FALSE;
+#endif
+  return TRUE;
+}
+
+static inline
+void silc_atomic_uninit64(SilcAtomic64 *atomic)
+{
+  atomic->value = 0;
+#if !defined(SILC_ATOMIC64_BUILTIN)
+  silc_mutex_free(atomic->lock);
+#endif
+}
+
+static inline
+SilcUInt64 silc_atomic_get_int64(SilcAtomic64 *atomic)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  SilcUInt64 ret = atomic->value;
+  __sync_synchronize();
+  return ret;
+#else
+  SilcUInt64 ret;
+  silc_mutex_lock(atomic->lock);
+  ret = atomic->value;
+  silc_mutex_unlock(atomic->lock);
+  return ret;
+#endif
+}
+
+static inline
+void silc_atomic_set_int64(SilcAtomic64 *atomic, SilcUInt64 value)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  __sync_synchronize();
+  atomic->value = value;
+#else
+  silc_mutex_lock(atomic->lock);
+  atomic->value = value;
+  silc_mutex_unlock(atomic->lock);
+#endif
+}
+
+static inline
+SilcUInt64 silc_atomic_add_int64(SilcAtomic64 *atomic, SilcInt64 value)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  return __sync_add_and_fetch(&atomic->value, (SilcUInt64)value);
+#else
+  SilcUInt64 ret;
+  silc_mutex_lock(atomic->lock);
+  atomic->value += value;
+  ret = atomic->value;
+  silc_mutex_unlock(atomic->lock);
+  return ret;
+#endif
+}
+
+static inline
+SilcUInt64 silc_atomic_sub_int64(SilcAtomic64 *atomic, SilcInt64 value)
+{
+  return silc_atomic_add_int64(atomic, -value);
+}
+
+static inline
+SilcBool silc_atomic_cas64(SilcAtomic64 *atomic, SilcUInt64 old_val,
+			   SilcUInt64 new_val)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  return __sync_bool_compare_and_swap(&atomic->value, old_val, new_val);
+#else
+  SilcBool ret = FALSE;
+  silc_mutex_lock(atomic->lock);
+  if (atomic->value == old_val) {
+    atomic->value = new_val;
+    ret = TRUE;
+  }
+  silc_mutex_unlock(atomic->lock);
+  return ret;
+#endif
+}
+
+static inline
+SilcUInt64 silc_atomic_fetch_or64(SilcAtomic64 *atomic, SilcUInt64 value)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  return __sync_fetch_and_or(&atomic->value, value);
+#else
+  SilcUInt64 ret;
+  silc_mutex_lock(atomic->lock);
+  ret = atomic->value;
+  atomic->value |= value;
+  silc_mutex_unlock(atomic->lock);
+  return ret;
+#endif
+}
+
+static inline
+SilcUInt64 silc_atomic_fetch_and64(SilcAtomic64 *atomic, SilcUInt64 value)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  return __sync_fetch_and_and(&atomic->value, value);
+#else
+  SilcUInt64 ret;
+  silc_mutex_lock(atomic->lock);
+  ret = atomic->value;
+  atomic->value &= value;
+  silc_mutex_unlock(atomic->lock);
+  return ret;
+#endif
+}
+
+static inline
+SilcUInt64 silc_atomic_exchange64(SilcAtomic64 *atomic, SilcUInt64 value)
+{
+#if defined(SILC_ATOMIC64_BUILTIN)
+  SilcUInt64 old;
+  do
+    old = atomic->value;
+  while (!__sync_bool_compare_and_swap(&atomic->value, old, value));
+  return old;
+#else
+  SilcUInt64 ret;
+  silc_mutex_lock(atomic->lock);
+  ret = atomic->value;
+  atomic->value = value;
+  silc_mutex_unlock(atomic->lock);
+  return ret;
+#endif
+}
+
+/****f* silcutil/silc_atomic_fetch_or32
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_atomic_fetch_or32(SilcAtomic32 *atomic,
+ *                                      SilcUInt32 value);
+ *    SilcUInt32 silc_atomic_fetch_and32(SilcAtomic32 *atomic,
+ *                                       SilcUInt32 value);
+ *    SilcUInt32 silc_atomic_exchange32(SilcAtomic32 *atomic,
+ *                                      SilcUInt32 value);
+ *
+ * DESCRIPTION
+ *
+ *    Atomic fetch-or, fetch-and and exchange for 32-bit atomic
+ *    integers, built on the compare-and-swap of the platform backend.
+ *    Return the previous value.
+ *
+ ***/
+static inline
+SilcUInt32 silc_atomic_fetch_or32(SilcAtomic32 *atomic, SilcUInt32 value)
+{
+  SilcUInt32 old;
+  do
+    old = silc_atomic_get_int32(atomic);
+  while (!silc_atomic_cas32(atomic, old, old | value));
+  return old;
+}
+
+static inline
+SilcUInt32 silc_atomic_fetch_and32(SilcAtomic32 *atomic, SilcUInt32 value)
+{
+  SilcUInt32 old;
+  do
+    old = silc_atomic_get_int32(atomic);
+  while (!silc_atomic_cas32(atomic, old, old & value));
+  return old;
+}
+
+static inline
+SilcUInt32 silc_atomic_exchange32(SilcAtomic32 *atomic, SilcUInt32 value)
+{
+  SilcUInt32 old;
+  do
+    old = silc_atomic_get_int32(atomic);
+  while (!silc_atomic_cas32(atomic, old, value));
+  return old;
+}
+
 #endif /* SILCATOMIC_H */
@@ -443,9 +443,98 @@ SilcBool silc_avl_tree_del(SilcTree *tree, void *entry)
 }
 
 /* AVL tree operations */
+/* Builds a balanced subtree from the sorted entries bottom-up and
+   returns its root.  The subtree height is returned to `ret_height'. */
+
+static SilcTreeHeader *silc_avl_tree_load_subtree(SilcTree *tree,
+						  void **entries,
+						  SilcUInt32 count,
+						  int *ret_height)
+{
+  SilcTreeHeader *h, *l, *r;
+  SilcUInt32 mid;
+  int hl = 0, hr = 0;
+
+  if (!count) {
+    *ret_height = 0;
+    return NULL;
+  }
+
+  mid = count / 2;
+  h = SILC_TREE_GET_HEADER(tree, entries[mid]);
+
+  l = silc_avl_tree_load_subtree(tree, entries, mid, &hl);
+  r = silc_avl_tree_load_subtree(tree, entries + mid + 1,
+				 count - mid - 1, &hr);
+
+  h->left = l;
+  h->right = r;
+  h->parent = h->dup = NULL;
+  h->duplicate = FALSE;
+  h->t = hr - hl;
+  if (l)
+    l->parent = h;
+  if (r)
+    r->parent = h;
+
+  *ret_height = SILC_MAX(hl, hr) + 1;
+
+  return h;
+}
+
+/* Loads a pre-sorted entry array into an empty tree in O(n) */
+
+SilcBool silc_avl_tree_load(SilcTree *tree, void **entries,
+			    SilcUInt32 count)
+{
+  int height;
+
+  SILC_TREE_DEBUG(("AVL tree %p, loading %d entries", tree, count));
+
+  if (tree->root) {
+    silc_set_errno_nofail(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+  if (!count)
+    return TRUE;
+
+  tree->root = silc_avl_tree_load_subtree(tree, entries, count, &height);
+  tree->count = count;
+
+  return TRUE;
+}
+
+/* Finds the smallest entry greater than or equal to `entry' */
+
+void *silc_avl_tree_find_ge(SilcTree *tree, void *entry)
+{
+  SilcTreeHeader *h = tree->root, *best = NULL;
+  int ret;
+
+  while (h) {
+    ret = tree->compare(entry, SILC_TREE_GET_ENTRY(tree, h),
+			tree->context);
+    if (ret <= 0) {
+      best = h;
+      h = h->left;
+    } else {
+      h = h->right;
+    }
+  }
+
+  if (!best) {
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  return SILC_TREE_GET_ENTRY(tree, best);
+}
+
 const struct SilcTreeOpsStruct silc_tree_avl_ops =
 {
   silc_avl_tree_add,
   silc_avl_tree_del,
   silc_avl_tree_find,
+  silc_avl_tree_load,
+  silc_avl_tree_find_ge,
 };
@@ -85,4 +85,121 @@ unsigned char *silc_base64_decode(SilcStack stack,
 				  SilcUInt32 base64_len,
 				  SilcUInt32 *ret_len);
 
+/****s* silcutil/SilcBase64
+ *
+ * NAME
+ *
+ *    typedef struct SilcBase64Struct *SilcBase64, SilcBase64Struct;
+ *
+ * DESCRIPTION
+ *
+ *    Incremental Base 64 codec context for transcoding arbitrarily
+ *    large data in chunks with fixed small buffers.  Initialized with
+ *    silc_base64_init; the same context encodes with
+ *    silc_base64_encode_update/silc_base64_encode_final or decodes with
+ *    silc_base64_decode_update, carrying partial quanta across chunk
+ *    boundaries.
+ *
+ * SOURCE
+ */
+typedef struct SilcBase64Struct {
+  SilcUInt32 bits;		       /* Carried partial quantum */
+  SilcUInt32 char_count;	       /* Bytes/chars in the quantum */
+  unsigned int ended : 1;	       /* Decoder saw the '=' ending */
+} *SilcBase64, SilcBase64Struct;
+/***/
+
+/****f* silcutil/silc_base64_init
+ *
+ * SYNOPSIS
+ *
+ *    void silc_base64_init(SilcBase64 ctx);
+ *
+ * DESCRIPTION
+ *
+ *    Initializes (or reinitializes) the incremental codec context.
+ *
+ ***/
+void silc_base64_init(SilcBase64 ctx);
+
+/****f* silcutil/silc_base64_encode_len
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_base64_encode_len(SilcBase64 ctx,
+ *                                      SilcUInt32 data_len);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the maximum number of bytes silc_base64_encode_update
+ *    produces for `data_len' bytes of input with the current carry.
+ *
+ ***/
+#define silc_base64_encode_len(ctx, data_len)		\
+  (((((data_len) + (ctx)->char_count) / 3) * 4) + 4)
+
+/****f* silcutil/silc_base64_encode_update
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_base64_encode_update(SilcBase64 ctx,
+ *                                         const unsigned char *data,
+ *                                         SilcUInt32 data_len,
+ *                                         unsigned char *ret,
+ *                                         SilcUInt32 ret_size);
+ *
+ * DESCRIPTION
+ *
+ *    Encodes one chunk of data to `ret', carrying a partial 3-byte
+ *    quantum to the next call.  Returns the number of bytes written.
+ *    The `ret_size' must be at least silc_base64_encode_len bytes.
+ *
+ ***/
+SilcUInt32 silc_base64_encode_update(SilcBase64 ctx,
+				     const unsigned char *data,
+				     SilcUInt32 data_len,
+				     unsigned char *ret,
+				     SilcUInt32 ret_size);
+
+/****f* silcutil/silc_base64_encode_final
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_base64_encode_final(SilcBase64 ctx,
+ *                                        unsigned char *ret,
+ *                                        SilcUInt32 ret_size);
+ *
+ * DESCRIPTION
+ *
+ *    Finishes incremental encoding, writing the padded final quantum if
+ *    one is carried.  Returns the number of bytes written.
+ *
+ ***/
+SilcUInt32 silc_base64_encode_final(SilcBase64 ctx, unsigned char *ret,
+				    SilcUInt32 ret_size);
+
+/****f* silcutil/silc_base64_decode_update
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_base64_decode_update(SilcBase64 ctx,
+ *                                         const unsigned char *data,
+ *                                         SilcUInt32 data_len,
+ *                                         unsigned char *ret,
+ *                                         SilcUInt32 ret_size);
+ *
+ * DESCRIPTION
+ *
+ *    Decodes one chunk of Base 64 data to `ret', carrying a partial
+ *    4-character quantum to the next call.  Whitespace is skipped and
+ *    '=' ends the stream.  Returns the number of bytes written.  The
+ *    `ret_size' should be at least 3 * (data_len / 4) + 3 bytes.
+ *
+ ***/
+SilcUInt32 silc_base64_decode_update(SilcBase64 ctx,
+				     const unsigned char *data,
+				     SilcUInt32 data_len,
+				     unsigned char *ret,
+				     SilcUInt32 ret_size);
+
 #endif /* SILCBASE64_H */
@@ -176,6 +176,56 @@ int silc_bit_get(volatile unsigned long *bitmap, SilcUInt32 bitmap_size,
 
 /* Return first set bit number */
 
+/* Count trailing zero bits of non-zero word */
+
+static inline SilcUInt32 silc_bit_ctz(unsigned long w)
+{
+#if defined(__GNUC__)
+  return (SilcUInt32)__builtin_ctzl(w);
+#else
+  SilcUInt32 n = 0;
+  while (!(w & 1)) {
+    w >>= 1;
+    n++;
+  }
+  return n;
+#endif /* __GNUC__ */
+}
+
+/* Count set bits of a word */
+
+static inline SilcUInt32 silc_bit_popcount_word(unsigned long w)
+{
+#if defined(__GNUC__)
+  return (SilcUInt32)__builtin_popcountl(w);
+#else
+  SilcUInt32 n = 0;
+  while (w) {
+    w &= w - 1;
+    n++;
+  }
+  return n;
+#endif /* __GNUC__ */
+}
+
+/* Count set bits in the bitmap */
+
+int silc_bit_popcount(volatile unsigned long *bitmap,
+		      SilcUInt32 bitmap_size)
+{
+  SilcUInt32 i, n = 0;
+
+  if (!bitmap) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -1;
+  }
+
+  for (i = 0; i < bitmap_size; i++)
+    n += silc_bit_popcount_word(bitmap[i]);
+
+  return (int)n;
+}
+
 int silc_bit_ffs(volatile unsigned long *bitmap, SilcUInt32 bitmap_size)
 {
   return silc_bit_fns(bitmap, bitmap_size, 0);
@@ -204,9 +254,23 @@ int silc_bit_fns(volatile unsigned long *bitmap, SilcUInt32 bitmap_size,
     return -1;
   }
 
-  for (i = offset; i < bitmap_size * SILC_BIT_SIZE; i++)
-    if (bitmap[SILC_BIT_POS(i)] & SILC_BIT_MASK(i))
-      return i;
+  /* Scan the first, possibly partial word */
+  i = offset;
+  if (i % SILC_BIT_SIZE) {
+    unsigned long w = bitmap[SILC_BIT_POS(i)] &
+      ~((SILC_BIT_MASK(i)) - 1);
+    if (w)
+      return SILC_BIT_POS(i) * SILC_BIT_SIZE + silc_bit_ctz(w);
+    i = (SILC_BIT_POS(i) + 1) * SILC_BIT_SIZE;
+  }
+
+  /* Whole words; empty words are skipped a word compare at a time */
+  while (i < bitmap_size * SILC_BIT_SIZE) {
+    unsigned long w = bitmap[SILC_BIT_POS(i)];
+    if (w)
+      return i + silc_bit_ctz(w);
+    i += SILC_BIT_SIZE;
+  }
 
   silc_set_errno(SILC_ERR_NOT_FOUND);
   return -1;
@@ -228,9 +292,32 @@ int silc_bit_fnz(volatile unsigned long *bitmap, SilcUInt32 bitmap_size,
     return -1;
   }
 
-  for (i = offset; i < bitmap_size * SILC_BIT_SIZE; i++)
-    if ((bitmap[SILC_BIT_POS(i)] & SILC_BIT_MASK(i)) == 0)
-      return i;
+  /* Scan the first, possibly partial word */
+  i = offset;
+  if (i % SILC_BIT_SIZE) {
+    unsigned long w = (~bitmap[SILC_BIT_POS(i)]) &
+      ~((SILC_BIT_MASK(i)) - 1);
+    if (w) {
+      SilcUInt32 bit = SILC_BIT_POS(i) * SILC_BIT_SIZE + silc_bit_ctz(w);
+      if (bit < bitmap_size * SILC_BIT_SIZE)
+	return bit;
+      silc_set_errno(SILC_ERR_NOT_FOUND);
+      return -1;
+    }
+    i = (SILC_BIT_POS(i) + 1) * SILC_BIT_SIZE;
+  }
+
+  /* Whole words; full words are skipped a word compare at a time */
+  while (i < bitmap_size * SILC_BIT_SIZE) {
+    unsigned long w = ~bitmap[SILC_BIT_POS(i)];
+    if (w) {
+      SilcUInt32 bit = i + silc_bit_ctz(w);
+      if (bit < bitmap_size * SILC_BIT_SIZE)
+	return bit;
+      break;
+    }
+    i += SILC_BIT_SIZE;
+  }
 
   silc_set_errno(SILC_ERR_NOT_FOUND);
   return -1;
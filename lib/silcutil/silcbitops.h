@@ -279,4 +279,21 @@ int silc_bit_fnz(volatile unsigned long *bitmap, SilcUInt32 bitmap_size,
 void silc_bit_clear_bitmap(volatile unsigned long *bitmap,
 			   SilcUInt32 bitmap_size);
 
+/****f* silcutil/silc_bit_popcount
+ *
+ * SYNOPSIS
+ *
+ *    int silc_bit_popcount(volatile unsigned long *bitmap,
+ *                          SilcUInt32 bitmap_size);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of set bits in the bitmap, counted a word at a
+ *    time with the processor popcount where available.  Returns -1 on
+ *    error.
+ *
+ ***/
+int silc_bit_popcount(volatile unsigned long *bitmap,
+		      SilcUInt32 bitmap_size);
+
 #endif /* SILCBITOPS_H */
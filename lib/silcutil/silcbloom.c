@@ -0,0 +1,160 @@
+/*
+
+  silcbloom.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Bloom filter context */
+struct SilcBloomStruct {
+  SilcAtomic32 *bits;		       /* Bit array in 32-bit words */
+  SilcUInt32 num_bits;		       /* Bit array size, power of two */
+  SilcUInt32 num_words;		       /* Word count */
+  SilcUInt32 num_hashes;	       /* Probes per element */
+};
+
+/* Computes the two independent hashes of an element.  The probe
+   positions are derived with double hashing: h1 + i * h2. */
+
+static void silc_bloom_hash(const void *data, SilcUInt32 data_len,
+			    SilcUInt32 *h1, SilcUInt32 *h2)
+{
+  SilcUInt64 h = silc_fast_hash(data, data_len, 0);
+
+  *h1 = (SilcUInt32)h;
+  *h2 = (SilcUInt32)(h >> 32) | 1;     /* Odd, so probes cycle all bits */
+}
+
+/* Allocate filter */
+
+SilcBloom silc_bloom_alloc(SilcUInt32 num_elements,
+			   SilcUInt32 fp_rate_inverse)
+{
+  SilcBloom bloom;
+  SilcUInt32 log2p = 0, bits, i;
+
+  if (!num_elements)
+    num_elements = 1;
+  if (!fp_rate_inverse)
+    fp_rate_inverse = 100;
+
+  /* Optimal bit count is n * log2(1/p) / ln(2) ~ n * log2(1/p) * 1.44,
+     and the probe count log2(1/p); integer arithmetic is accurate
+     enough here. */
+  while ((SilcUInt32)1 << (log2p + 1) <= fp_rate_inverse)
+    log2p++;
+
+  bits = num_elements * log2p + (num_elements * log2p) / 2;
+  if (bits < 64)
+    bits = 64;
+
+  bloom = silc_calloc(1, sizeof(*bloom));
+  if (!bloom)
+    return NULL;
+
+  /* Round up to a power of two for mask indexing */
+  for (bloom->num_bits = 64; bloom->num_bits < bits; bloom->num_bits <<= 1)
+    if (bloom->num_bits >= (SilcUInt32)1 << 31)
+      break;
+
+  bloom->num_words = bloom->num_bits / 32;
+  bloom->num_hashes = log2p ? log2p : 1;
+
+  bloom->bits = silc_calloc(bloom->num_words, sizeof(*bloom->bits));
+  if (!bloom->bits) {
+    silc_free(bloom);
+    return NULL;
+  }
+
+  for (i = 0; i < bloom->num_words; i++)
+    silc_atomic_init32(&bloom->bits[i], 0);
+
+  SILC_LOG_DEBUG(("Allocated bloom filter %p, %u bits, %u hashes",
+		  bloom, bloom->num_bits, bloom->num_hashes));
+
+  return bloom;
+}
+
+/* Free filter */
+
+void silc_bloom_free(SilcBloom bloom)
+{
+  SilcUInt32 i;
+
+  if (!bloom)
+    return;
+
+  /* On platforms without native atomics each word owns a lock */
+  for (i = 0; i < bloom->num_words; i++)
+    silc_atomic_uninit32(&bloom->bits[i]);
+
+  silc_free(bloom->bits);
+  silc_free(bloom);
+}
+
+/* Add element */
+
+void silc_bloom_add(SilcBloom bloom, const void *data, SilcUInt32 data_len)
+{
+  SilcUInt32 h1, h2, bit, i;
+
+  if (!bloom || !data)
+    return;
+
+  silc_bloom_hash(data, data_len, &h1, &h2);
+
+  for (i = 0; i < bloom->num_hashes; i++) {
+    bit = (h1 + i * h2) & (bloom->num_bits - 1);
+    silc_atomic_fetch_or32(&bloom->bits[bit >> 5],
+			   (SilcUInt32)1 << (bit & 31));
+  }
+}
+
+/* Test membership */
+
+SilcBool silc_bloom_check(SilcBloom bloom, const void *data,
+			  SilcUInt32 data_len)
+{
+  SilcUInt32 h1, h2, bit, i;
+
+  if (!bloom || !data)
+    return FALSE;
+
+  silc_bloom_hash(data, data_len, &h1, &h2);
+
+  for (i = 0; i < bloom->num_hashes; i++) {
+    bit = (h1 + i * h2) & (bloom->num_bits - 1);
+    if (!(silc_atomic_get_int32(&bloom->bits[bit >> 5]) &
+	  ((SilcUInt32)1 << (bit & 31))))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Clear filter */
+
+void silc_bloom_clear(SilcBloom bloom)
+{
+  SilcUInt32 i;
+
+  if (!bloom)
+    return;
+
+  for (i = 0; i < bloom->num_words; i++)
+    silc_atomic_set_int32(&bloom->bits[i], 0);
+}
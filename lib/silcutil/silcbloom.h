@@ -0,0 +1,132 @@
+/*
+
+  silcbloom.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Bloom Filter Interface
+ *
+ * DESCRIPTION
+ *
+ * A Bloom filter for pre-screening lookups against large tables.  When
+ * most lookups miss, probing the filter first answers "definitely not
+ * present" after touching a couple of cache lines, short-circuiting
+ * the full table probe; a positive answer means "possibly present" and
+ * the table is consulted.  The false positive rate is set at
+ * allocation time and determines the filter size.
+ *
+ * Inserts and membership tests are thread safe and lock free; the bit
+ * array is updated with atomic operations.  Elements cannot be removed
+ * from a Bloom filter; clear and repopulate instead.
+ *
+ ***/
+
+#ifndef SILCBLOOM_H
+#define SILCBLOOM_H
+
+/****s* silcutil/SilcBloom
+ *
+ * NAME
+ *
+ *    typedef struct SilcBloomStruct *SilcBloom;
+ *
+ * DESCRIPTION
+ *
+ *    The Bloom filter context allocated by silc_bloom_alloc.
+ *
+ ***/
+typedef struct SilcBloomStruct *SilcBloom;
+
+/****f* silcutil/silc_bloom_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcBloom silc_bloom_alloc(SilcUInt32 num_elements,
+ *                               SilcUInt32 fp_rate_inverse);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates a Bloom filter sized for `num_elements' expected
+ *    elements with a false positive probability of about
+ *    1 / `fp_rate_inverse' (pass 100 for one percent; 0 selects 100).
+ *    The bit array and number of hash probes are derived from these.
+ *    Returns NULL on memory allocation error.
+ *
+ ***/
+SilcBloom silc_bloom_alloc(SilcUInt32 num_elements,
+			   SilcUInt32 fp_rate_inverse);
+
+/****f* silcutil/silc_bloom_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_bloom_free(SilcBloom bloom);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the filter.  The caller must make sure no thread is using
+ *    the filter any more.
+ *
+ ***/
+void silc_bloom_free(SilcBloom bloom);
+
+/****f* silcutil/silc_bloom_add
+ *
+ * SYNOPSIS
+ *
+ *    void silc_bloom_add(SilcBloom bloom, const void *data,
+ *                        SilcUInt32 data_len);
+ *
+ * DESCRIPTION
+ *
+ *    Adds the element to the filter.  May be called concurrently from
+ *    several threads.
+ *
+ ***/
+void silc_bloom_add(SilcBloom bloom, const void *data, SilcUInt32 data_len);
+
+/****f* silcutil/silc_bloom_check
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_bloom_check(SilcBloom bloom, const void *data,
+ *                              SilcUInt32 data_len);
+ *
+ * DESCRIPTION
+ *
+ *    Tests membership.  FALSE means the element definitely has not
+ *    been added; TRUE means it possibly has and the backing table must
+ *    be consulted.
+ *
+ ***/
+SilcBool silc_bloom_check(SilcBloom bloom, const void *data,
+			  SilcUInt32 data_len);
+
+/****f* silcutil/silc_bloom_clear
+ *
+ * SYNOPSIS
+ *
+ *    void silc_bloom_clear(SilcBloom bloom);
+ *
+ * DESCRIPTION
+ *
+ *    Clears the filter to empty.  Not atomic with respect to
+ *    concurrent inserts; quiesce updaters first.
+ *
+ ***/
+void silc_bloom_clear(SilcBloom bloom);
+
+#endif /* SILCBLOOM_H */
@@ -0,0 +1,619 @@
+/*
+
+  silcbtree.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+/* B-tree backend for the SilcTree API.  Entries are kept in multi-entry
+   nodes probed linearly, so finds touch a few contiguous pointer arrays
+   instead of one heap node per comparison as in the AVL tree.  The
+   entries are additionally threaded through their SilcTreeHeaders into a
+   sorted list, which the generic silc_tree_enumerate walks in order with
+   one pointer chase per entry.
+
+   The B-tree does not support duplicate values; silc_tree_init returns
+   FALSE for SILC_TREE_BTREE if duplicates are requested.  The internal
+   nodes are released when the last entry is deleted from the tree. */
+
+#include "silcruntime.h"
+
+/* Define to 1 if you want tree debug enabled */
+#define SILC_BTREE_DEBUG 0
+
+#if SILC_BTREE_DEBUG == 1
+#define SILC_TREE_DEBUG(fmt) SILC_LOG_DEBUG(fmt)
+#else
+#define SILC_TREE_DEBUG(fmt)
+#endif
+
+/* Maximum number of entries per node.  15 entries and 16 children keep
+   the node in a couple of cache lines. */
+#define SILC_BTREE_MAX 15
+#define SILC_BTREE_MIN (SILC_BTREE_MAX / 2)
+
+/* B-tree node */
+typedef struct SilcBTreeNodeStruct {
+  void *entry[SILC_BTREE_MAX];			    /* Entries, sorted */
+  struct SilcBTreeNodeStruct *child[SILC_BTREE_MAX + 1];
+  SilcUInt16 count;				    /* Number of entries */
+  unsigned int leaf : 1;			    /* Set for leaf nodes */
+} SilcBTreeNode;
+
+/* B-tree context, in tree->internal */
+typedef struct {
+  SilcBTreeNode *root;
+} SilcBTree;
+
+/************************ Static utility functions **************************/
+
+static SilcBTreeNode *silc_btree_node_alloc(void)
+{
+  SilcBTreeNode *node = silc_calloc(1, sizeof(*node));
+  if (node)
+    node->leaf = TRUE;
+  return node;
+}
+
+/* Frees node and all its children */
+
+static void silc_btree_node_free(SilcBTreeNode *node)
+{
+  int i;
+
+  if (!node->leaf)
+    for (i = 0; i <= node->count; i++)
+      silc_btree_node_free(node->child[i]);
+  silc_free(node);
+}
+
+/* Links `entry' to the sorted entry list after `prev' (NULL prepends).
+   The list head is kept in tree->root so that the generic enumeration
+   and minmax find it.  The `right' pointer is the next entry and the
+   `parent' pointer the previous entry; `left' stays NULL, which makes
+   the list a degenerate right-leaning tree that the generic in-order
+   enumeration walks with one pointer chase per entry. */
+
+static void silc_btree_list_add(SilcTree *tree, void *entry, void *prev)
+{
+  SilcTreeHeader *h = SILC_TREE_GET_HEADER(tree, entry), *p, *n;
+
+  h->left = h->dup = NULL;
+  h->duplicate = FALSE;
+  h->t = 0;
+
+  if (!prev) {
+    h->parent = NULL;
+    h->right = tree->root;
+    if (tree->root)
+      tree->root->parent = h;
+    tree->root = h;
+    return;
+  }
+
+  p = SILC_TREE_GET_HEADER(tree, prev);
+  n = p->right;
+  h->parent = p;
+  h->right = n;
+  p->right = h;
+  if (n)
+    n->parent = h;
+}
+
+/* Unlinks `entry' from the sorted entry list */
+
+static void silc_btree_list_del(SilcTree *tree, void *entry)
+{
+  SilcTreeHeader *h = SILC_TREE_GET_HEADER(tree, entry);
+
+  if (h->parent)
+    h->parent->right = h->right;
+  else
+    tree->root = h->right;
+  if (h->right)
+    h->right->parent = h->parent;
+  h->parent = h->right = NULL;
+}
+
+/* Splits the full child `i' of `node'; the median entry moves up */
+
+static SilcBool silc_btree_split_child(SilcBTreeNode *node, int i)
+{
+  SilcBTreeNode *c = node->child[i], *n;
+  int k;
+
+  n = silc_btree_node_alloc();
+  if (!n)
+    return FALSE;
+  n->leaf = c->leaf;
+  n->count = SILC_BTREE_MIN;
+
+  /* Upper half moves to the new right sibling */
+  for (k = 0; k < SILC_BTREE_MIN; k++)
+    n->entry[k] = c->entry[k + SILC_BTREE_MIN + 1];
+  if (!c->leaf)
+    for (k = 0; k <= SILC_BTREE_MIN; k++)
+      n->child[k] = c->child[k + SILC_BTREE_MIN + 1];
+  c->count = SILC_BTREE_MIN;
+
+  /* Make room in the parent */
+  for (k = node->count; k > i; k--) {
+    node->entry[k] = node->entry[k - 1];
+    node->child[k + 1] = node->child[k];
+  }
+  node->entry[i] = c->entry[SILC_BTREE_MIN];
+  node->child[i + 1] = n;
+  node->count++;
+
+  return TRUE;
+}
+
+/* Merges child `i+1' of `node' into child `i' with the separating entry */
+
+static void silc_btree_merge_children(SilcBTreeNode *node, int i)
+{
+  SilcBTreeNode *l = node->child[i], *r = node->child[i + 1];
+  int k;
+
+  l->entry[l->count] = node->entry[i];
+  for (k = 0; k < r->count; k++)
+    l->entry[l->count + 1 + k] = r->entry[k];
+  if (!l->leaf)
+    for (k = 0; k <= r->count; k++)
+      l->child[l->count + 1 + k] = r->child[k];
+  l->count += r->count + 1;
+
+  for (k = i; k < node->count - 1; k++) {
+    node->entry[k] = node->entry[k + 1];
+    node->child[k + 1] = node->child[k + 2];
+  }
+  node->count--;
+
+  silc_free(r);
+}
+
+/* Deletes `entry' (located by the comparison function) from the subtree
+   of `node'.  The node has always at least SILC_BTREE_MIN + 1 entries
+   when descending (except the root).  Returns the deleted entry. */
+
+static void *silc_btree_del_entry(SilcTree *tree, SilcBTreeNode *node,
+				  void *entry)
+{
+  int i, ret = 0;
+
+  for (;;) {
+    /* Find the entry or the child to descend to */
+    for (i = 0; i < node->count; i++) {
+      ret = tree->compare(entry, node->entry[i], tree->context);
+      if (ret == SILC_COMPARE_EQUAL_TO || ret < 0)
+	break;
+    }
+
+    if (i < node->count && ret == SILC_COMPARE_EQUAL_TO) {
+      void *found = node->entry[i];
+
+      if (node->leaf) {
+	/* Shift out from the leaf */
+	for (; i < node->count - 1; i++)
+	  node->entry[i] = node->entry[i + 1];
+	node->count--;
+	return found;
+      }
+
+      /* Internal node; replace with predecessor or successor from a
+	 child that can spare an entry, or merge the children. */
+      if (node->child[i]->count > SILC_BTREE_MIN) {
+	/* Take the predecessor */
+	SilcBTreeNode *c = node->child[i];
+	while (!c->leaf)
+	  c = c->child[c->count];
+	node->entry[i] = c->entry[c->count - 1];
+	/* Delete the predecessor from the subtree */
+	silc_btree_del_entry(tree, node->child[i], node->entry[i]);
+	return found;
+      }
+      if (node->child[i + 1]->count > SILC_BTREE_MIN) {
+	/* Take the successor */
+	SilcBTreeNode *c = node->child[i + 1];
+	while (!c->leaf)
+	  c = c->child[0];
+	node->entry[i] = c->entry[0];
+	silc_btree_del_entry(tree, node->child[i + 1], node->entry[i]);
+	return found;
+      }
+
+      /* Both children minimal; merge and continue in the merged child */
+      silc_btree_merge_children(node, i);
+      node = node->child[i];
+      continue;
+    }
+
+    if (node->leaf) {
+      /* Not found */
+      return NULL;
+    }
+
+    /* Ensure the child we descend to can spare an entry */
+    if (node->child[i]->count <= SILC_BTREE_MIN) {
+      SilcBTreeNode *c = node->child[i];
+
+      if (i > 0 && node->child[i - 1]->count > SILC_BTREE_MIN) {
+	/* Borrow from the left sibling through the parent */
+	SilcBTreeNode *l = node->child[i - 1];
+	int k;
+
+	for (k = c->count; k > 0; k--)
+	  c->entry[k] = c->entry[k - 1];
+	if (!c->leaf)
+	  for (k = c->count + 1; k > 0; k--)
+	    c->child[k] = c->child[k - 1];
+	c->entry[0] = node->entry[i - 1];
+	if (!c->leaf)
+	  c->child[0] = l->child[l->count];
+	c->count++;
+	node->entry[i - 1] = l->entry[l->count - 1];
+	l->count--;
+      } else if (i < node->count &&
+		 node->child[i + 1]->count > SILC_BTREE_MIN) {
+	/* Borrow from the right sibling through the parent */
+	SilcBTreeNode *r = node->child[i + 1];
+	int k;
+
+	c->entry[c->count] = node->entry[i];
+	if (!c->leaf)
+	  c->child[c->count + 1] = r->child[0];
+	c->count++;
+	node->entry[i] = r->entry[0];
+	for (k = 0; k < r->count - 1; k++)
+	  r->entry[k] = r->entry[k + 1];
+	if (!r->leaf)
+	  for (k = 0; k <= r->count - 1; k++)
+	    r->child[k] = r->child[k + 1];
+	r->count--;
+      } else {
+	/* Merge with a sibling */
+	if (i == node->count)
+	  i--;
+	silc_btree_merge_children(node, i);
+      }
+
+      node = node->child[i];
+      continue;
+    }
+
+    node = node->child[i];
+  }
+}
+
+/**************************** Tree operations *******************************/
+
+/* Add entry to tree */
+
+SilcBool silc_btree_add(SilcTree *tree, void *entry)
+{
+  SilcBTree *bt = tree->internal;
+  SilcBTreeNode *node, *root;
+  void *prev = NULL;
+  int i, ret;
+
+  SILC_TREE_DEBUG(("B-tree %p, adding %p", tree, entry));
+
+  if (!bt) {
+    bt = silc_calloc(1, sizeof(*bt));
+    if (!bt)
+      return FALSE;
+    tree->internal = bt;
+  }
+
+  if (!bt->root) {
+    bt->root = silc_btree_node_alloc();
+    if (!bt->root)
+      return FALSE;
+  }
+
+  /* Split the root beforehand if it is full */
+  if (bt->root->count == SILC_BTREE_MAX) {
+    root = silc_btree_node_alloc();
+    if (!root)
+      return FALSE;
+    root->leaf = FALSE;
+    root->child[0] = bt->root;
+    if (!silc_btree_split_child(root, 0)) {
+      silc_free(root);
+      return FALSE;
+    }
+    bt->root = root;
+  }
+
+  node = bt->root;
+  for (;;) {
+    /* Find the position, tracking the in-order predecessor */
+    ret = 1;
+    for (i = 0; i < node->count; i++) {
+      ret = tree->compare(entry, node->entry[i], tree->context);
+      if (ret == SILC_COMPARE_EQUAL_TO) {
+	silc_set_errno_nofail(SILC_ERR_ALREADY_EXISTS);
+	return FALSE;
+      }
+      if (ret < 0)
+	break;
+      prev = node->entry[i];
+    }
+
+    if (node->leaf)
+      break;
+
+    /* Split full child before descending */
+    if (node->child[i]->count == SILC_BTREE_MAX) {
+      if (!silc_btree_split_child(node, i))
+	return FALSE;
+      ret = tree->compare(entry, node->entry[i], tree->context);
+      if (ret == SILC_COMPARE_EQUAL_TO) {
+	silc_set_errno_nofail(SILC_ERR_ALREADY_EXISTS);
+	return FALSE;
+      }
+      if (ret > 0) {
+	prev = node->entry[i];
+	i++;
+      }
+    }
+
+    node = node->child[i];
+  }
+
+  /* Insert to the leaf */
+  for (ret = node->count; ret > i; ret--)
+    node->entry[ret] = node->entry[ret - 1];
+  node->entry[i] = entry;
+  node->count++;
+
+  /* Thread to the sorted entry list for enumeration */
+  silc_btree_list_add(tree, entry, prev);
+
+  tree->count++;
+
+  return TRUE;
+}
+
+/* Delete entry from tree */
+
+SilcBool silc_btree_del(SilcTree *tree, void *entry)
+{
+  SilcBTree *bt = tree->internal;
+  SilcBTreeNode *root;
+  void *found;
+
+  SILC_TREE_DEBUG(("B-tree %p, deleting %p", tree, entry));
+
+  if (!bt || !bt->root) {
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  found = silc_btree_del_entry(tree, bt->root, entry);
+  if (!found) {
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  /* Shrink the root when it empties */
+  if (!bt->root->count) {
+    root = bt->root;
+    bt->root = root->leaf ? NULL : root->child[0];
+    silc_free(root);
+  }
+
+  silc_btree_list_del(tree, found);
+
+  tree->count--;
+
+  /* Release the index when the tree empties */
+  if (!tree->count) {
+    if (bt->root)
+      silc_btree_node_free(bt->root);
+    silc_free(bt);
+    tree->internal = NULL;
+  }
+
+  return TRUE;
+}
+
+/* Find entry from tree */
+
+void *silc_btree_find(SilcTree *tree, void *entry,
+		      SilcCompare compare, void *context)
+{
+  SilcBTree *bt = tree->internal;
+  SilcBTreeNode *node;
+  SilcCompare cmp = compare ? compare : tree->compare;
+  void *cmp_context = compare ? context : tree->context;
+  int i, ret;
+
+  SILC_TREE_DEBUG(("B-tree %p, find %p", tree, entry));
+
+  if (!bt || !bt->root) {
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  node = bt->root;
+  while (node) {
+    ret = 1;
+    for (i = 0; i < node->count; i++) {
+      ret = cmp(entry, node->entry[i], cmp_context);
+      if (ret == SILC_COMPARE_EQUAL_TO) {
+	SILC_TREE_DEBUG(("Found %p", node->entry[i]));
+	return node->entry[i];
+      }
+      if (ret == SILC_COMPARE_STOP)
+	return NULL;
+      if (ret < 0)
+	break;
+    }
+    if (node->leaf)
+      break;
+    node = node->child[i];
+  }
+
+  SILC_TREE_DEBUG(("Not found"));
+  silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+  return NULL;
+}
+
+/* Returns the entry capacity of a subtree of height `h' */
+
+static SilcUInt32 silc_btree_capacity(int h)
+{
+  SilcUInt32 cap = SILC_BTREE_MAX;
+
+  while (h-- > 0)
+    cap = SILC_BTREE_MAX + (SILC_BTREE_MAX + 1) * cap;
+
+  return cap;
+}
+
+/* Builds a subtree of height `h' from the sorted entries bottom-up */
+
+static SilcBTreeNode *silc_btree_load_subtree(void **entries,
+					      SilcUInt32 count, int h)
+{
+  SilcBTreeNode *node, *c;
+  SilcUInt32 cap, k, base, extra, n, i, pos = 0;
+
+  node = silc_btree_node_alloc();
+  if (!node)
+    return NULL;
+
+  if (h == 0) {
+    /* Leaf */
+    for (i = 0; i < count; i++)
+      node->entry[i] = entries[i];
+    node->count = count;
+    return node;
+  }
+
+  /* Divide the entries evenly over the children, one separator entry
+     between each pair of children. */
+  cap = silc_btree_capacity(h - 1);
+  k = (count + 1 + cap) / (cap + 1);	  /* Number of children */
+  base = (count - (k - 1)) / k;
+  extra = (count - (k - 1)) % k;
+
+  node->leaf = FALSE;
+  for (i = 0; i < k; i++) {
+    n = base + (i < extra);
+    c = silc_btree_load_subtree(entries + pos, n, h - 1);
+    if (!c) {
+      if (!i)
+	node->leaf = TRUE;
+      node->count = i ? i - 1 : 0;
+      silc_btree_node_free(node);
+      return NULL;
+    }
+    node->child[i] = c;
+    pos += n;
+    if (i < k - 1)
+      node->entry[i] = entries[pos++];
+  }
+  node->count = k - 1;
+
+  return node;
+}
+
+/* Loads a pre-sorted entry array into an empty tree in O(n) */
+
+SilcBool silc_btree_load(SilcTree *tree, void **entries, SilcUInt32 count)
+{
+  SilcBTree *bt;
+  SilcUInt32 i;
+  int h = 0;
+
+  SILC_TREE_DEBUG(("B-tree %p, loading %d entries", tree, count));
+
+  if (tree->count || tree->internal) {
+    silc_set_errno_nofail(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+  if (!count)
+    return TRUE;
+
+  bt = silc_calloc(1, sizeof(*bt));
+  if (!bt)
+    return FALSE;
+
+  /* Smallest height that holds all entries */
+  while (silc_btree_capacity(h) < count)
+    h++;
+
+  bt->root = silc_btree_load_subtree(entries, count, h);
+  if (!bt->root) {
+    silc_free(bt);
+    return FALSE;
+  }
+
+  tree->internal = bt;
+  tree->count = count;
+
+  /* Thread the sorted entry list */
+  for (i = 0; i < count; i++)
+    silc_btree_list_add(tree, entries[i], i ? entries[i - 1] : NULL);
+
+  return TRUE;
+}
+
+/* Finds the smallest entry greater than or equal to `entry' */
+
+void *silc_btree_find_ge(SilcTree *tree, void *entry)
+{
+  SilcBTree *bt = tree->internal;
+  SilcBTreeNode *node;
+  void *best = NULL;
+  int i, ret;
+
+  if (!bt || !bt->root) {
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  node = bt->root;
+  while (node) {
+    ret = 1;
+    for (i = 0; i < node->count; i++) {
+      ret = tree->compare(entry, node->entry[i], tree->context);
+      if (ret == SILC_COMPARE_EQUAL_TO)
+	return node->entry[i];
+      if (ret < 0) {
+	best = node->entry[i];
+	break;
+      }
+    }
+    if (node->leaf)
+      break;
+    node = node->child[i];
+  }
+
+  if (!best)
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+
+  return best;
+}
+
+const struct SilcTreeOpsStruct silc_tree_btree_ops =
+{
+  silc_btree_add,
+  silc_btree_del,
+  silc_btree_find,
+  silc_btree_load,
+  silc_btree_find_ge,
+};
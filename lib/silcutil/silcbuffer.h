@@ -1306,11 +1306,26 @@ static inline
 SilcBool silc_buffer_enlarge(SilcBuffer sb, SilcUInt32 size)
 {
   if (size > silc_buffer_len(sb)) {
-    if (size > silc_buffer_taillen(sb) + silc_buffer_len(sb))
-      if (silc_unlikely(!silc_buffer_realloc(sb, silc_buffer_truelen(sb) +
-					     (size - silc_buffer_taillen(sb) -
-					      silc_buffer_len(sb)))))
+    if (size > silc_buffer_taillen(sb) + silc_buffer_len(sb)) {
+      SilcUInt32 hlen, dlen, cursize, needed;
+      unsigned char *h;
+
+      /* Grow with the geometric growth policy, expanding into allocator
+	 slack without copying when possible, so a steadily growing
+	 buffer is not copied on every enlarge. */
+      cursize = silc_buffer_truelen(sb);
+      needed = cursize + (size - silc_buffer_taillen(sb) -
+			  silc_buffer_len(sb));
+      hlen = silc_buffer_headlen(sb);
+      dlen = silc_buffer_len(sb);
+      h = (unsigned char *)silc_realloc_grow(sb->head, &cursize, needed);
+      if (silc_unlikely(!h))
 	return FALSE;
+      sb->head = h;
+      sb->data = sb->head + hlen;
+      sb->tail = sb->data + dlen;
+      sb->end = sb->head + cursize;
+    }
     silc_buffer_pull_tail(sb, size - silc_buffer_len(sb));
   }
   return TRUE;
@@ -1581,4 +1596,412 @@ void silc_buffer_printf(SilcBuffer sb, SilcBool newline)
   fflush(stdout);
 }
 
+/****f* silcutil/silc_buffer_pull_unsafe
+ *
+ * SYNOPSIS
+ *
+ *    unsigned char *silc_buffer_pull_unsafe(SilcBuffer sb, SilcUInt32 len);
+ *    unsigned char *silc_buffer_push_unsafe(SilcBuffer sb, SilcUInt32 len);
+ *    unsigned char *silc_buffer_pull_tail_unsafe(SilcBuffer sb,
+ *                                                SilcUInt32 len);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_buffer_pull, silc_buffer_push and silc_buffer_pull_tail but
+ *    without bounds checking, errno writes or debug assertions: each is
+ *    two pointer adjustments.  For decoder loops that have already
+ *    validated the lengths and execute these tens of millions of times
+ *    per second.  The caller is fully responsible for staying within
+ *    the buffer.
+ *
+ * SOURCE
+ */
+static inline
+unsigned char *silc_buffer_pull_unsafe(SilcBuffer sb, SilcUInt32 len)
+{
+  unsigned char *old_data = sb->data;
+  sb->data += len;
+  return old_data;
+}
+
+static inline
+unsigned char *silc_buffer_push_unsafe(SilcBuffer sb, SilcUInt32 len)
+{
+  unsigned char *old_data = sb->data;
+  sb->data -= len;
+  return old_data;
+}
+
+static inline
+unsigned char *silc_buffer_pull_tail_unsafe(SilcBuffer sb, SilcUInt32 len)
+{
+  unsigned char *old_tail = sb->tail;
+  sb->tail += len;
+  return old_tail;
+}
+/***/
+
+/****s* silcutil/SilcBufferChain
+ *
+ * NAME
+ *
+ *    typedef struct SilcBufferChainObject
+ *                     *SilcBufferChain, SilcBufferChainStruct;
+ *
+ * DESCRIPTION
+ *
+ *    A chain of SilcBuffer segments that together form one logical data
+ *    area.  Protocol layers can prepend headers and append payloads and
+ *    trailers as separate segments without copying the data into one
+ *    contiguous buffer.  A chain is written to a stream with the
+ *    silc_stream_writev without coalescing the segments.
+ *
+ * SOURCE
+ */
+typedef struct SilcBufferChainEntryObject {
+  SilcBuffer buffer;			       /* The segment */
+  struct SilcBufferChainEntryObject *next;
+} *SilcBufferChainEntry;
+
+typedef struct SilcBufferChainObject {
+  SilcBufferChainEntry head;		       /* First segment */
+  SilcBufferChainEntry tail;		       /* Last segment */
+  SilcUInt32 count;			       /* Number of segments */
+} *SilcBufferChain, SilcBufferChainStruct;
+/***/
+
+/****f* silcutil/silc_buffer_chain_init
+ *
+ * SYNOPSIS
+ *
+ *    void silc_buffer_chain_init(SilcBufferChain chain);
+ *
+ * DESCRIPTION
+ *
+ *    Initializes the buffer chain `chain'.  The chain does not own the
+ *    buffers linked to it unless it is freed with silc_buffer_chain_free
+ *    with `free_buffers' set to TRUE.
+ *
+ ***/
+static inline
+void silc_buffer_chain_init(SilcBufferChain chain)
+{
+  chain->head = chain->tail = NULL;
+  chain->count = 0;
+}
+
+/****f* silcutil/silc_buffer_chain_add
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_buffer_chain_add(SilcBufferChain chain,
+ *                                   SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Appends the `buffer' as the last segment of the chain `chain'.
+ *    Returns FALSE on memory allocation error.
+ *
+ ***/
+static inline
+SilcBool silc_buffer_chain_add(SilcBufferChain chain, SilcBuffer buffer)
+{
+  SilcBufferChainEntry e = (SilcBufferChainEntry)silc_calloc(1, sizeof(*e));
+  if (silc_unlikely(!e))
+    return FALSE;
+  e->buffer = buffer;
+  if (chain->tail)
+    chain->tail->next = e;
+  else
+    chain->head = e;
+  chain->tail = e;
+  chain->count++;
+  return TRUE;
+}
+
+/****f* silcutil/silc_buffer_chain_prepend
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_buffer_chain_prepend(SilcBufferChain chain,
+ *                                       SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Adds the `buffer' as the first segment of the chain `chain'.  This
+ *    is used to prepend headers in front of payload segments without
+ *    copying the payload.  Returns FALSE on memory allocation error.
+ *
+ ***/
+static inline
+SilcBool silc_buffer_chain_prepend(SilcBufferChain chain, SilcBuffer buffer)
+{
+  SilcBufferChainEntry e = (SilcBufferChainEntry)silc_calloc(1, sizeof(*e));
+  if (silc_unlikely(!e))
+    return FALSE;
+  e->buffer = buffer;
+  e->next = chain->head;
+  chain->head = e;
+  if (!chain->tail)
+    chain->tail = e;
+  chain->count++;
+  return TRUE;
+}
+
+/****f* silcutil/silc_buffer_chain_len
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_buffer_chain_len(SilcBufferChain chain);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the total length of the data areas of all segments in the
+ *    chain `chain'.
+ *
+ ***/
+static inline
+SilcUInt32 silc_buffer_chain_len(SilcBufferChain chain)
+{
+  SilcBufferChainEntry e;
+  SilcUInt32 len = 0;
+  for (e = chain->head; e; e = e->next)
+    len += silc_buffer_len(e->buffer);
+  return len;
+}
+
+/****f* silcutil/silc_buffer_chain_pull
+ *
+ * SYNOPSIS
+ *
+ *    void silc_buffer_chain_pull(SilcBufferChain chain, SilcUInt32 len,
+ *                                SilcBool free_buffers);
+ *
+ * DESCRIPTION
+ *
+ *    Pulls `len' bytes from the start of the chain, advancing over whole
+ *    and partial segments.  Fully consumed segments are unlinked from the
+ *    chain, and freed with silc_buffer_free if `free_buffers' is TRUE.
+ *    This is used after a partial write to drop the data that was
+ *    already written.
+ *
+ ***/
+static inline
+void silc_buffer_chain_pull(SilcBufferChain chain, SilcUInt32 len,
+			    SilcBool free_buffers)
+{
+  SilcBufferChainEntry e;
+  SilcUInt32 n;
+
+  while (len && chain->head) {
+    e = chain->head;
+    n = silc_buffer_len(e->buffer);
+    if (len < n) {
+      silc_buffer_pull(e->buffer, len);
+      return;
+    }
+    len -= n;
+    chain->head = e->next;
+    if (!chain->head)
+      chain->tail = NULL;
+    chain->count--;
+    if (free_buffers)
+      silc_buffer_free(e->buffer);
+    silc_free(e);
+  }
+}
+
+/****f* silcutil/silc_buffer_chain_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_buffer_chain_free(SilcBufferChain chain,
+ *                                SilcBool free_buffers);
+ *
+ * DESCRIPTION
+ *
+ *    Frees all segment links of the chain `chain', and the buffers
+ *    themselves if `free_buffers' is TRUE.
+ *
+ ***/
+static inline
+void silc_buffer_chain_free(SilcBufferChain chain, SilcBool free_buffers)
+{
+  SilcBufferChainEntry e, next;
+  for (e = chain->head; e; e = next) {
+    next = e->next;
+    if (free_buffers)
+      silc_buffer_free(e->buffer);
+    silc_free(e);
+  }
+  silc_buffer_chain_init(chain);
+}
+
+/****s* silcutil/SilcRefBuffer
+ *
+ * NAME
+ *
+ *    typedef struct SilcRefBufferObject
+ *                     *SilcRefBuffer, SilcRefBufferStruct;
+ *
+ * DESCRIPTION
+ *
+ *    A reference counted immutable buffer.  The data storage is shared
+ *    between any number of cheap slice views, so fanning one packet out
+ *    to many receivers does not copy the payload for each of them.  The
+ *    context can be used as a SilcBuffer in all read-only buffer
+ *    operations; the data must not be modified once shared.  Created by
+ *    silc_buffer_ref_create, shared with silc_buffer_ref and
+ *    silc_buffer_ref_slice, and released with silc_buffer_unref.
+ *
+ * SOURCE
+ */
+typedef struct SilcRefDataObject {
+  SilcAtomic32 refcnt;			       /* Storage reference count */
+  /* Data follows */
+} *SilcRefData;
+
+typedef struct SilcRefBufferObject {
+  SilcBufferStruct buffer;		       /* View; must be first */
+  SilcRefData storage;			       /* Shared storage */
+  SilcAtomic32 refcnt;			       /* View reference count */
+} *SilcRefBuffer, SilcRefBufferStruct;
+/***/
+
+/****f* silcutil/silc_buffer_ref_create
+ *
+ * SYNOPSIS
+ *
+ *    SilcBuffer silc_buffer_ref_create(const unsigned char *data,
+ *                                      SilcUInt32 data_len);
+ *
+ * DESCRIPTION
+ *
+ *    Creates a reference counted buffer holding a copy of `data'.  This
+ *    is the only copy ever made; all further sharing is by reference.
+ *    Returns the buffer with one reference, or NULL on error.  Release
+ *    with silc_buffer_unref.
+ *
+ ***/
+static inline
+SilcBuffer silc_buffer_ref_create(const unsigned char *data,
+				  SilcUInt32 data_len)
+{
+  SilcRefData d;
+  SilcRefBuffer rb;
+
+  d = (SilcRefData)silc_malloc(sizeof(*d) + data_len);
+  if (silc_unlikely(!d))
+    return NULL;
+  silc_atomic_init32(&d->refcnt, 1);
+  if (data)
+    memcpy((unsigned char *)(d + 1), data, data_len);
+
+  rb = (SilcRefBuffer)silc_calloc(1, sizeof(*rb));
+  if (silc_unlikely(!rb)) {
+    silc_free(d);
+    return NULL;
+  }
+
+  rb->storage = d;
+  silc_atomic_init32(&rb->refcnt, 1);
+  rb->buffer.head = rb->buffer.data = (unsigned char *)(d + 1);
+  rb->buffer.tail = rb->buffer.end = rb->buffer.head + data_len;
+
+  return (SilcBuffer)rb;
+}
+
+/****f* silcutil/silc_buffer_ref
+ *
+ * SYNOPSIS
+ *
+ *    SilcBuffer silc_buffer_ref(SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Takes an additional reference to the reference counted `buffer'.
+ *    The `buffer' must have been created with silc_buffer_ref_create or
+ *    silc_buffer_ref_slice.  Returns the `buffer'.
+ *
+ ***/
+static inline
+SilcBuffer silc_buffer_ref(SilcBuffer buffer)
+{
+  SilcRefBuffer rb = (SilcRefBuffer)buffer;
+  silc_atomic_add_int32(&rb->refcnt, 1);
+  silc_atomic_add_int32(&rb->storage->refcnt, 1);
+  return buffer;
+}
+
+/****f* silcutil/silc_buffer_ref_slice
+ *
+ * SYNOPSIS
+ *
+ *    SilcBuffer silc_buffer_ref_slice(SilcBuffer buffer,
+ *                                     SilcUInt32 offset, SilcUInt32 len);
+ *
+ * DESCRIPTION
+ *
+ *    Returns a new view of `len' bytes starting at `offset' of the data
+ *    area of the reference counted `buffer'.  The data is shared, not
+ *    copied; only a small view context is allocated.  Returns NULL on
+ *    error or if the range is outside the buffer.  Release the slice
+ *    with silc_buffer_unref.
+ *
+ ***/
+static inline
+SilcBuffer silc_buffer_ref_slice(SilcBuffer buffer, SilcUInt32 offset,
+				 SilcUInt32 len)
+{
+  SilcRefBuffer rb = (SilcRefBuffer)buffer, slice;
+
+  if (silc_unlikely(offset + len > silc_buffer_len(buffer))) {
+    silc_set_errno(SILC_ERR_OVERFLOW);
+    return NULL;
+  }
+
+  slice = (SilcRefBuffer)silc_calloc(1, sizeof(*slice));
+  if (silc_unlikely(!slice))
+    return NULL;
+
+  slice->storage = rb->storage;
+  silc_atomic_init32(&slice->refcnt, 1);
+  silc_atomic_add_int32(&rb->storage->refcnt, 1);
+  slice->buffer.head = slice->buffer.data = buffer->data + offset;
+  slice->buffer.tail = slice->buffer.end = slice->buffer.data + len;
+
+  return (SilcBuffer)slice;
+}
+
+/****f* silcutil/silc_buffer_unref
+ *
+ * SYNOPSIS
+ *
+ *    void silc_buffer_unref(SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Releases a reference to the reference counted `buffer'.  The view
+ *    context is freed and when the last reference to the shared storage
+ *    goes away the storage is freed as well.
+ *
+ ***/
+static inline
+void silc_buffer_unref(SilcBuffer buffer)
+{
+  SilcRefBuffer rb = (SilcRefBuffer)buffer;
+
+  if (!rb)
+    return;
+
+  if (silc_atomic_sub_int32(&rb->storage->refcnt, 1) == 0) {
+    silc_atomic_uninit32(&rb->storage->refcnt);
+    silc_free(rb->storage);
+  }
+  if (silc_atomic_sub_int32(&rb->refcnt, 1) == 0) {
+    silc_atomic_uninit32(&rb->refcnt);
+    silc_free(rb);
+  }
+}
+
 #endif /* SILCBUFFER_H */
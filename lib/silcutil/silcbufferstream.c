@@ -34,11 +34,39 @@ typedef struct {
   SilcBufferStruct queue;
   SilcBufferReceiveCallback receiver;
   void *context;
+  SilcBufferReceiveBatchCallback batch_receiver;
+  void *batch_context;
+  SilcUInt32 max_message;	       /* Max message size, 0 unlimited */
+  SilcStack stack;
+  SilcBufferStreamWatermarkCb wm_cb;
+  void *wm_context;
+  SilcUInt32 high_mark;
+  SilcUInt32 low_mark;
   unsigned int closed   : 1;
+  unsigned int above    : 1;
 } *SilcBufferStream;
 
 /************************ Static utility functions **************************/
 
+/* Calls the watermark callback if the queued data amount has crossed a
+   watermark. */
+
+static void silc_buffer_stream_check_watermarks(SilcBufferStream bs)
+{
+  SilcUInt32 queued = silc_buffer_len(&bs->queue);
+
+  if (!bs->wm_cb)
+    return;
+
+  if (!bs->above && queued >= bs->high_mark) {
+    bs->above = TRUE;
+    bs->wm_cb((SilcStream)bs, TRUE, queued, bs->wm_context);
+  } else if (bs->above && queued <= bs->low_mark) {
+    bs->above = FALSE;
+    bs->wm_cb((SilcStream)bs, FALSE, queued, bs->wm_context);
+  }
+}
+
 /* IO callback */
 
 static void silc_buffer_stream_io(SilcStream stream,
@@ -59,14 +87,73 @@ static void silc_buffer_stream_io(SilcStream stream,
 
     while ((ret = silc_stream_read(bs->stream, bs->inbuf->tail,
 				   silc_buffer_taillen(bs->inbuf))) > 0) {
+      silc_buffer_pull_tail(bs->inbuf, ret);
+
+      /* Reject over-limit messages before buffering more of them */
+      if (bs->max_message && silc_buffer_len(bs->inbuf) >= 4) {
+	SILC_GET32_MSB(buf_len, bs->inbuf->data);
+	if (buf_len > bs->max_message) {
+	  SILC_LOG_DEBUG(("Buffer stream %p message %u exceeds limit %u",
+			  bs, buf_len, bs->max_message));
+	  silc_buffer_free(buffer);
+	  silc_set_errno(SILC_ERR_OVERFLOW);
+	  if (bs->batch_receiver)
+	    bs->batch_receiver(SILC_ERR_OVERFLOW, (SilcStream)bs, NULL, 0,
+			       bs->batch_context);
+	  else
+	    bs->receiver(SILC_ERR_OVERFLOW, (SilcStream)bs, NULL,
+			 bs->context);
+	  return;
+	}
+      }
+
+      if (bs->batch_receiver) {
+	/* Batch mode: hand over all complete messages as slices into
+	   the read buffer in one callback, no per-message allocation */
+	SilcBufferStruct slices[32], *msgs = slices;
+	SilcUInt32 num = 0, max = 32, total = 0, mlen;
+	unsigned char *p = silc_buffer_data(bs->inbuf);
+	SilcUInt32 avail = silc_buffer_len(bs->inbuf);
+
+	while (avail >= 4) {
+	  SILC_GET32_MSB(mlen, p);
+	  if (avail < 4 + mlen)
+	    break;
+	  if (num == max) {
+	    SilcBuffer tmp = msgs == slices ? NULL : msgs;
+	    max <<= 1;
+	    tmp = silc_realloc(tmp, max * sizeof(*msgs));
+	    if (!tmp)
+	      break;
+	    if (msgs == slices)
+	      memcpy(tmp, slices, num * sizeof(*msgs));
+	    msgs = tmp;
+	  }
+	  silc_buffer_set(&msgs[num++], p + 4, mlen);
+	  p += 4 + mlen;
+	  avail -= 4 + mlen;
+	  total += 4 + mlen;
+	}
+
+	if (num) {
+	  bs->batch_receiver(SILC_OK, (SilcStream)bs, msgs, num,
+			     bs->batch_context);
+	  silc_buffer_pull(bs->inbuf, total);
+	}
+	if (msgs != slices)
+	  silc_free(msgs);
+
+	if (silc_buffer_len(bs->inbuf) == 0)
+	  silc_buffer_reset(bs->inbuf);
+	goto more;
+      }
+
       if (!buffer) {
 	buffer = silc_buffer_alloc(0);
 	if (!buffer)
 	  return;
       }
 
-      silc_buffer_pull_tail(bs->inbuf, ret);
-
       /* Parse the buffer */
       while ((len = silc_buffer_unformat(bs->inbuf,
 					 SILC_STR_BUFFER_ALLOC(buffer),
@@ -83,6 +170,7 @@ static void silc_buffer_stream_io(SilcStream stream,
 	  return;
       }
 
+    more:
       if (silc_buffer_len(bs->inbuf) > 0) {
 	/* Not complete buffer, read more data */
 	buf_len = 4;
@@ -94,8 +182,8 @@ static void silc_buffer_stream_io(SilcStream stream,
 
 	/* Enlarge inbuf if needed */
 	if (silc_buffer_taillen(bs->inbuf) < buf_len)
-	  silc_buffer_realloc(bs->inbuf, silc_buffer_truelen(bs->inbuf) +
-			      buf_len);
+	  silc_buffer_srealloc(bs->stack, bs->inbuf,
+			       silc_buffer_truelen(bs->inbuf) + buf_len);
 	continue;
       }
 
@@ -106,7 +194,11 @@ static void silc_buffer_stream_io(SilcStream stream,
     silc_buffer_free(buffer);
 
     if (ret == 0 || ret == -2) {
-      bs->receiver(silc_errno, (SilcStream)bs, NULL, bs->context);
+      if (bs->batch_receiver)
+	bs->batch_receiver(silc_errno, (SilcStream)bs, NULL, 0,
+			   bs->batch_context);
+      else
+	bs->receiver(silc_errno, (SilcStream)bs, NULL, bs->context);
       return;
     }
   } else {
@@ -124,6 +216,7 @@ static void silc_buffer_stream_io(SilcStream stream,
 
       if (silc_unlikely(ret == -1)) {
 	SILC_LOG_DEBUG(("Buffer stream %p would block, send later", bs));
+	silc_buffer_stream_check_watermarks(bs);
 	return;
       }
 
@@ -133,6 +226,7 @@ static void silc_buffer_stream_io(SilcStream stream,
 
     memset(&bs->queue, 0, sizeof(bs->queue));
     silc_buffer_reset(bs->outbuf);
+    silc_buffer_stream_check_watermarks(bs);
   }
 }
 
@@ -143,6 +237,16 @@ static void silc_buffer_stream_io(SilcStream stream,
 SilcStream silc_buffer_stream_create(SilcStream stream,
 				     SilcBufferReceiveCallback receiver,
 				     void *context)
+{
+  return silc_buffer_stream_create_stack(NULL, stream, receiver, context);
+}
+
+/* Create buffer stream from stack */
+
+SilcStream silc_buffer_stream_create_stack(SilcStack stack,
+					   SilcStream stream,
+					   SilcBufferReceiveCallback receiver,
+					   void *context)
 {
   SilcBufferStream bs;
 
@@ -151,7 +255,7 @@ SilcStream silc_buffer_stream_create(SilcStream stream,
     return NULL;
   }
 
-  bs = silc_calloc(1, sizeof(*bs));
+  bs = silc_scalloc(stack, 1, sizeof(*bs));
   if (!bs)
     return NULL;
 
@@ -161,12 +265,13 @@ SilcStream silc_buffer_stream_create(SilcStream stream,
   bs->stream = stream;
   bs->receiver = receiver;
   bs->context = context;
-  bs->inbuf = silc_buffer_alloc(32);
-  bs->outbuf = silc_buffer_alloc(0);
+  bs->stack = stack;
+  bs->inbuf = silc_buffer_salloc(stack, 32);
+  bs->outbuf = silc_buffer_salloc(stack, 0);
   if (!bs->inbuf || !bs->outbuf) {
-    silc_buffer_free(bs->inbuf);
-    silc_buffer_free(bs->outbuf);
-    silc_free(bs);
+    silc_buffer_sfree(stack, bs->inbuf);
+    silc_buffer_sfree(stack, bs->outbuf);
+    silc_sfree(stack, bs);
     return NULL;
   }
 
@@ -178,6 +283,42 @@ SilcStream silc_buffer_stream_create(SilcStream stream,
   return (SilcStream)bs;
 }
 
+/* Set batch receiver */
+
+SilcBool silc_buffer_stream_set_batch_receiver(SilcStream stream,
+					       SilcBufferReceiveBatchCallback
+					       receiver, void *context)
+{
+  SilcBufferStream bs = stream;
+
+  if (!SILC_IS_BUFFER_STREAM(bs)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  bs->batch_receiver = receiver;
+  bs->batch_context = context;
+
+  return TRUE;
+}
+
+/* Set maximum message size */
+
+SilcBool silc_buffer_stream_set_max_message(SilcStream stream,
+					    SilcUInt32 max_message)
+{
+  SilcBufferStream bs = stream;
+
+  if (!SILC_IS_BUFFER_STREAM(bs)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  bs->max_message = max_message;
+
+  return TRUE;
+}
+
 /* Send buffer to stream */
 
 SilcBool silc_buffer_stream_send(SilcStream stream,
@@ -207,10 +348,10 @@ SilcBool silc_buffer_stream_send(SilcStream stream,
   }
 
   /* Put to queue */
-  if (silc_buffer_format(bs->outbuf,
-			 SILC_STR_ADVANCE,
-			 SILC_STR_BUFFER(buffer),
-			 SILC_STR_END) < 0)
+  if (silc_buffer_sformat(bs->stack, bs->outbuf,
+			  SILC_STR_ADVANCE,
+			  SILC_STR_BUFFER(buffer),
+			  SILC_STR_END) < 0)
     return FALSE;
 
   ret = silc_buffer_headlen(&bs->queue);
@@ -231,6 +372,7 @@ SilcBool silc_buffer_stream_send(SilcStream stream,
 
     if (silc_unlikely(ret == -1)) {
       SILC_LOG_DEBUG(("Buffer stream %p would block, send later", bs));
+      silc_buffer_stream_check_watermarks(bs);
       return TRUE;
     }
 
@@ -240,12 +382,64 @@ SilcBool silc_buffer_stream_send(SilcStream stream,
 
   memset(&bs->queue, 0, sizeof(bs->queue));
   silc_buffer_reset(bs->outbuf);
+  silc_buffer_stream_check_watermarks(bs);
 
   SILC_LOG_DEBUG(("Buffer sent to buffer stream %p", bs));
 
   return TRUE;
 }
 
+/* Set queue watermarks */
+
+SilcBool silc_buffer_stream_set_watermarks(SilcStream stream,
+					   SilcUInt32 high_watermark,
+					   SilcUInt32 low_watermark,
+					   SilcBufferStreamWatermarkCb callback,
+					   void *context)
+{
+  SilcBufferStream bs = stream;
+
+  if (silc_unlikely(!SILC_IS_BUFFER_STREAM(bs))) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!callback) {
+    bs->wm_cb = NULL;
+    bs->wm_context = NULL;
+    bs->high_mark = bs->low_mark = 0;
+    bs->above = FALSE;
+    return TRUE;
+  }
+
+  if (silc_unlikely(!high_watermark || low_watermark > high_watermark)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  bs->wm_cb = callback;
+  bs->wm_context = context;
+  bs->high_mark = high_watermark;
+  bs->low_mark = low_watermark;
+  bs->above = FALSE;
+
+  return TRUE;
+}
+
+/* Return queued data amount */
+
+SilcUInt32 silc_buffer_stream_get_queued_bytes(SilcStream stream)
+{
+  SilcBufferStream bs = stream;
+
+  if (silc_unlikely(!SILC_IS_BUFFER_STREAM(bs))) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return 0;
+  }
+
+  return silc_buffer_len(&bs->queue);
+}
+
 /******************************* Stream API *********************************/
 
 int silc_buffer_stream_read(SilcStream stream, unsigned char *buf,
@@ -282,9 +476,9 @@ void silc_buffer_stream_destroy(SilcStream stream)
   SILC_LOG_DEBUG(("Destroying buffer stream %p", bs));
 
   silc_buffer_stream_close(stream);
-  silc_buffer_free(bs->outbuf);
-  silc_buffer_free(bs->inbuf);
-  silc_free(bs);
+  silc_buffer_sfree(bs->stack, bs->outbuf);
+  silc_buffer_sfree(bs->stack, bs->inbuf);
+  silc_sfree(bs->stack, bs);
 }
 
 SilcBool silc_buffer_stream_notifier(SilcStream stream,
@@ -64,6 +64,33 @@ typedef void (*SilcBufferReceiveCallback)(SilcResult status,
 					  SilcBuffer buffer,
 					  void *context);
 
+/****f* silcutil/SilcBufferReceiveBatchCallback
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcBufferReceiveBatchCallback)(SilcResult status,
+ *                                                   SilcStream stream,
+ *                                                   SilcBuffer buffers,
+ *                                                   SilcUInt32 num_buffers,
+ *                                                   void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Batch receive callback set with
+ *    silc_buffer_stream_set_batch_receiver.  All complete messages in
+ *    the read buffer are delivered in one invocation: `buffers' is an
+ *    array of `num_buffers' buffers whose data are slices into the
+ *    stream's read buffer, valid only for the duration of the call —
+ *    copy what must be kept.  On error `status' indicates it and
+ *    `buffers' is NULL.
+ *
+ ***/
+typedef void (*SilcBufferReceiveBatchCallback)(SilcResult status,
+					       SilcStream stream,
+					       SilcBuffer buffers,
+					       SilcUInt32 num_buffers,
+					       void *context);
+
 /****f* silcutil/silc_buffer_stream_create
  *
  * SYNOPSIS
@@ -92,6 +119,71 @@ SilcStream silc_buffer_stream_create(SilcStream stream,
 				     SilcBufferReceiveCallback receiver,
 				     void *context);
 
+/****f* silcutil/silc_buffer_stream_create_stack
+ *
+ * SYNOPSIS
+ *
+ *    SilcStream
+ *    silc_buffer_stream_create_stack(SilcStack stack, SilcStream stream,
+ *                                    SilcBufferReceiveCallback receiver,
+ *                                    void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Same as silc_buffer_stream_create but allocates the stream context
+ *    and its internal buffers from `stack'.  A connection whose stream,
+ *    buffers and state come from one stack is torn down by one
+ *    silc_stack_pop after destroying the stream.  If `stack' is NULL
+ *    this is equivalent to silc_buffer_stream_create.
+ *
+ ***/
+SilcStream silc_buffer_stream_create_stack(SilcStack stack,
+					   SilcStream stream,
+					   SilcBufferReceiveCallback receiver,
+					   void *context);
+
+/****f* silcutil/silc_buffer_stream_set_batch_receiver
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool
+ *    silc_buffer_stream_set_batch_receiver(SilcStream stream,
+ *                                          SilcBufferReceiveBatchCallback
+ *                                          receiver, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Switches the buffer stream to batch delivery: instead of one
+ *    freshly allocated buffer per message per callback, all complete
+ *    messages in the read buffer are handed over in one call as
+ *    slices into the read buffer (see
+ *    SilcBufferReceiveBatchCallback).  Passing NULL `receiver'
+ *    returns the stream to per-message delivery.
+ *
+ ***/
+SilcBool silc_buffer_stream_set_batch_receiver(SilcStream stream,
+					       SilcBufferReceiveBatchCallback
+					       receiver, void *context);
+
+/****f* silcutil/silc_buffer_stream_set_max_message
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_buffer_stream_set_max_message(SilcStream stream,
+ *                                                SilcUInt32 max_message);
+ *
+ * DESCRIPTION
+ *
+ *    Sets the maximum accepted message size.  A message whose length
+ *    prefix exceeds `max_message' is rejected before it is buffered:
+ *    the receiver is called with SILC_ERR_OVERFLOW status and the
+ *    stream should be destroyed, as the framing can no longer be
+ *    trusted.  Zero (the default) accepts any size.
+ *
+ ***/
+SilcBool silc_buffer_stream_set_max_message(SilcStream stream,
+					    SilcUInt32 max_message);
+
 /****f* silcutil/silc_buffer_stream_send
  *
  * SYNOPSIS
@@ -109,4 +201,71 @@ SilcStream silc_buffer_stream_create(SilcStream stream,
 SilcBool silc_buffer_stream_send(SilcStream stream,
 				 SilcBuffer buffer);
 
+/****f* silcutil/SilcBufferStreamWatermarkCb
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcBufferStreamWatermarkCb)(SilcStream stream,
+ *                                                SilcBool above,
+ *                                                SilcUInt32 queued_bytes,
+ *                                                void *context);
+ *
+ * DESCRIPTION
+ *
+ *    A callback of this type is called when the amount of data queued in
+ *    a buffer stream crosses a watermark set with the
+ *    silc_buffer_stream_set_watermarks.  When `above' is TRUE the queue
+ *    has reached the high watermark and the producer should stop sending;
+ *    when `above' is FALSE the queue has drained to the low watermark and
+ *    sending may resume.  The `queued_bytes' is the current amount of
+ *    queued data.
+ *
+ ***/
+typedef void (*SilcBufferStreamWatermarkCb)(SilcStream stream,
+					    SilcBool above,
+					    SilcUInt32 queued_bytes,
+					    void *context);
+
+/****f* silcutil/silc_buffer_stream_set_watermarks
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool
+ *    silc_buffer_stream_set_watermarks(SilcStream stream,
+ *                                      SilcUInt32 high_watermark,
+ *                                      SilcUInt32 low_watermark,
+ *                                      SilcBufferStreamWatermarkCb callback,
+ *                                      void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Sets outgoing queue watermarks on the buffer stream `stream'.  When
+ *    the amount of queued unsent data reaches `high_watermark' bytes the
+ *    `callback' is called with `above' TRUE, and when the queue has
+ *    drained back to `low_watermark' bytes it is called with `above'
+ *    FALSE.  This provides flow control towards a slow consumer; without
+ *    watermarks the queue grows without bound.  Setting `callback' to
+ *    NULL removes the watermarks.
+ *
+ ***/
+SilcBool silc_buffer_stream_set_watermarks(SilcStream stream,
+					   SilcUInt32 high_watermark,
+					   SilcUInt32 low_watermark,
+					   SilcBufferStreamWatermarkCb callback,
+					   void *context);
+
+/****f* silcutil/silc_buffer_stream_get_queued_bytes
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_buffer_stream_get_queued_bytes(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the amount of data currently queued in the buffer stream
+ *    `stream' waiting to be written to the underlaying stream.
+ *
+ ***/
+SilcUInt32 silc_buffer_stream_get_queued_bytes(SilcStream stream);
+
 #endif /* SILCBUFFERSTREAM_H */
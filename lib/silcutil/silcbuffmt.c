@@ -1382,3 +1382,332 @@ int silc_buffer_sstrformat(SilcStack stack, SilcBuffer dst, ...)
   va_end(va);
   return len;
 }
+
+/**************************** Compiled formats ******************************/
+
+/* One element in a compiled format descriptor */
+typedef struct {
+  SilcUInt32 type;		       /* SILC_PARAM_* type */
+  SilcUInt32 size;		       /* Fixed size, 0 if dynamic */
+} SilcBufferFormatElem;
+
+/* Compiled format descriptor */
+struct SilcBufferFormatStruct {
+  SilcBufferFormatElem *elems;	       /* The elements */
+  SilcUInt32 num_elems;
+  unsigned int strict : 1;	       /* Fail instead of enlarging */
+};
+
+/* Compile a format tape into a descriptor.  Only the fixed integer
+   types and counted data (SILC_STR_DATA) are supported; the descriptor
+   is the hot-path subset of silc_buffer_format. */
+
+SilcBufferFormat silc_buffer_format_compile(SilcUInt32 fmt, ...)
+{
+  SilcBufferFormat f;
+  SilcBufferFormatElem *e;
+  SilcUInt32 num = 0, type;
+  va_list ap;
+
+  va_start(ap, fmt);
+
+  /* Count the elements */
+  type = fmt;
+  while (type != SILC_PARAM_END) {
+    switch (type) {
+    case SILC_PARAM_SINT8:
+    case SILC_PARAM_UINT8:
+    case SILC_PARAM_SINT16:
+    case SILC_PARAM_UINT16:
+    case SILC_PARAM_SINT32:
+    case SILC_PARAM_UINT32:
+    case SILC_PARAM_SINT64:
+    case SILC_PARAM_UINT64:
+    case SILC_PARAM_UICHAR:
+      num++;
+      break;
+
+    default:
+      /* Unsupported element for compiled formats */
+      silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+      va_end(ap);
+      return NULL;
+    }
+    type = va_arg(ap, SilcUInt32);
+  }
+
+  va_end(ap);
+
+  if (!num) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  f = silc_calloc(1, sizeof(*f));
+  if (!f)
+    return NULL;
+  f->elems = silc_calloc(num, sizeof(*f->elems));
+  if (!f->elems) {
+    silc_free(f);
+    return NULL;
+  }
+  f->num_elems = num;
+
+  /* Record the elements */
+  va_start(ap, fmt);
+  type = fmt;
+  e = f->elems;
+  while (type != SILC_PARAM_END) {
+    e->type = type;
+    switch (type) {
+    case SILC_PARAM_SINT8:
+    case SILC_PARAM_UINT8:
+      e->size = 1;
+      break;
+    case SILC_PARAM_SINT16:
+    case SILC_PARAM_UINT16:
+      e->size = 2;
+      break;
+    case SILC_PARAM_SINT32:
+    case SILC_PARAM_UINT32:
+      e->size = 4;
+      break;
+    case SILC_PARAM_SINT64:
+    case SILC_PARAM_UINT64:
+      e->size = 8;
+      break;
+    case SILC_PARAM_UICHAR:
+      e->size = 0;
+      break;
+    }
+    e++;
+    type = va_arg(ap, SilcUInt32);
+  }
+  va_end(ap);
+
+  return f;
+}
+
+/* Set strict no-realloc mode */
+
+void silc_buffer_format_set_strict(SilcBufferFormat format,
+				   SilcBool strict)
+{
+  format->strict = strict;
+}
+
+/* Free compiled format */
+
+void silc_buffer_format_free_compiled(SilcBufferFormat format)
+{
+  if (!format)
+    return;
+  silc_free(format->elems);
+  silc_free(format);
+}
+
+/* Computes the encoded length of the values for `format'.  The variable
+   arguments are the values as in silc_buffer_format_exec. */
+
+int silc_buffer_format_size(SilcBufferFormat format, ...)
+{
+  SilcBufferFormatElem *e;
+  SilcUInt32 i, total = 0;
+  va_list ap;
+
+  va_start(ap, format);
+  for (i = 0; i < format->num_elems; i++) {
+    e = &format->elems[i];
+    if (e->size) {
+      if (e->size == 8)
+	(void)va_arg(ap, SilcUInt64);
+      else
+	(void)va_arg(ap, SilcUInt32);
+      total += e->size;
+    } else {
+      (void)va_arg(ap, unsigned char *);
+      total += va_arg(ap, SilcUInt32);
+    }
+  }
+  va_end(ap);
+
+  return (int)total;
+}
+
+/* Formats the values into the end of `dst' according to the compiled
+   `format'.  The encoded length is computed first and the buffer is
+   enlarged at most once; in strict mode the buffer is never enlarged.
+   The variable arguments are only the values, in the order the format
+   was compiled; counted data is given as pointer and length, as with
+   SILC_STR_DATA.  Returns the number of bytes formatted or -1 on
+   error. */
+
+int silc_buffer_format_exec(SilcBufferFormat format, SilcBuffer dst, ...)
+{
+  SilcBufferFormatElem *e;
+  unsigned char *p, *data;
+  SilcUInt32 i, len, total = 0;
+  SilcUInt64 v64;
+  SilcUInt32 v32;
+  va_list ap, sp;
+
+  va_start(ap, dst);
+
+  /* Sizing pre-pass */
+  silc_va_copy(sp, ap);
+  for (i = 0; i < format->num_elems; i++) {
+    e = &format->elems[i];
+    if (e->size) {
+      if (e->size == 8)
+	(void)va_arg(sp, SilcUInt64);
+      else
+	(void)va_arg(sp, SilcUInt32);
+      total += e->size;
+    } else {
+      (void)va_arg(sp, unsigned char *);
+      total += va_arg(sp, SilcUInt32);
+    }
+  }
+  va_end(sp);
+
+  /* Make room once */
+  if (silc_buffer_taillen(dst) < total) {
+    if (format->strict) {
+      silc_set_errno(SILC_ERR_OVERFLOW);
+      va_end(ap);
+      return -1;
+    }
+    if (!silc_buffer_realloc(dst, silc_buffer_truelen(dst) +
+			     (total - silc_buffer_taillen(dst)))) {
+      va_end(ap);
+      return -1;
+    }
+  }
+
+  /* Store the values */
+  p = dst->tail;
+  for (i = 0; i < format->num_elems; i++) {
+    e = &format->elems[i];
+    switch (e->type) {
+    case SILC_PARAM_SINT8:
+    case SILC_PARAM_UINT8:
+      v32 = va_arg(ap, SilcUInt32);
+      *p = (unsigned char)v32;
+      p += 1;
+      break;
+
+    case SILC_PARAM_SINT16:
+    case SILC_PARAM_UINT16:
+      v32 = va_arg(ap, SilcUInt32);
+      SILC_PUT16_MSB((SilcUInt16)v32, p);
+      p += 2;
+      break;
+
+    case SILC_PARAM_SINT32:
+    case SILC_PARAM_UINT32:
+      v32 = va_arg(ap, SilcUInt32);
+      SILC_PUT32_MSB(v32, p);
+      p += 4;
+      break;
+
+    case SILC_PARAM_SINT64:
+    case SILC_PARAM_UINT64:
+      v64 = va_arg(ap, SilcUInt64);
+      SILC_PUT64_MSB(v64, p);
+      p += 8;
+      break;
+
+    case SILC_PARAM_UICHAR:
+      data = va_arg(ap, unsigned char *);
+      len = va_arg(ap, SilcUInt32);
+      if (data && len)
+	memcpy(p, data, len);
+      p += len;
+      break;
+    }
+  }
+  va_end(ap);
+
+  silc_buffer_pull_tail(dst, total);
+
+  return (int)total;
+}
+
+/* Decode from buffer according to a compiled format.  The minimum
+   length of the whole layout is validated once up front, after which
+   the fields are decoded with direct loads and no per-element bounds
+   checks. */
+
+int silc_buffer_unformat_exec(SilcBufferFormat format, SilcBuffer src, ...)
+{
+  SilcBufferFormatElem *e;
+  unsigned char *p, **retp;
+  SilcUInt32 i, len, total = 0;
+  va_list ap, sp;
+
+  va_start(ap, src);
+
+  /* Compute the layout's total length; data element lengths come from
+     the argument list. */
+  silc_va_copy(sp, ap);
+  for (i = 0; i < format->num_elems; i++) {
+    e = &format->elems[i];
+    if (e->size) {
+      (void)va_arg(sp, void *);
+      total += e->size;
+    } else {
+      (void)va_arg(sp, unsigned char **);
+      total += va_arg(sp, SilcUInt32);
+    }
+  }
+  va_end(sp);
+
+  /* Validate once */
+  if (silc_buffer_len(src) < total) {
+    silc_set_errno(SILC_ERR_OVERFLOW);
+    va_end(ap);
+    return -1;
+  }
+
+  /* Decode with direct loads */
+  p = src->data;
+  for (i = 0; i < format->num_elems; i++) {
+    e = &format->elems[i];
+    switch (e->type) {
+    case SILC_PARAM_SINT8:
+    case SILC_PARAM_UINT8:
+      *va_arg(ap, SilcUInt8 *) = *p;
+      p += 1;
+      break;
+
+    case SILC_PARAM_SINT16:
+    case SILC_PARAM_UINT16:
+      SILC_GET16_MSB(*va_arg(ap, SilcUInt16 *), p);
+      p += 2;
+      break;
+
+    case SILC_PARAM_SINT32:
+    case SILC_PARAM_UINT32:
+      SILC_GET32_MSB(*va_arg(ap, SilcUInt32 *), p);
+      p += 4;
+      break;
+
+    case SILC_PARAM_SINT64:
+    case SILC_PARAM_UINT64:
+      SILC_GET64_MSB(*va_arg(ap, SilcUInt64 *), p);
+      p += 8;
+      break;
+
+    case SILC_PARAM_UICHAR:
+      retp = va_arg(ap, unsigned char **);
+      len = va_arg(ap, SilcUInt32);
+      if (retp)
+	*retp = len ? p : NULL;
+      p += len;
+      break;
+    }
+  }
+  va_end(ap);
+
+  return (int)total;
+}
@@ -1080,4 +1080,147 @@ typedef enum {
  ***/
 #define SILC_STRFMT_END (void *)SILC_STR_END
 
+/****s* silcutil/SilcBufferFormat
+ *
+ * NAME
+ *
+ *    typedef struct SilcBufferFormatStruct *SilcBufferFormat;
+ *
+ * DESCRIPTION
+ *
+ *    A compiled format descriptor created with
+ *    silc_buffer_format_compile and executed with
+ *    silc_buffer_format_exec.  Compiling interprets the SILC_STR_*
+ *    format tape once; executing then only reads the values, which is
+ *    considerably faster for packet shapes formatted repeatedly.
+ *
+ ***/
+typedef struct SilcBufferFormatStruct *SilcBufferFormat;
+
+/****f* silcutil/silc_buffer_format_compile
+ *
+ * SYNOPSIS
+ *
+ *    SilcBufferFormat silc_buffer_format_compile(SilcUInt32 fmt, ...);
+ *
+ * DESCRIPTION
+ *
+ *    Compiles a formatting tape into a reusable descriptor.  The
+ *    arguments are the SILC_PARAM_* types of the elements (not the
+ *    SILC_STR_* macros, which also carry values), ended with
+ *    SILC_PARAM_END.  Supported elements are the fixed size integers
+ *    (SILC_PARAM_SINT8...SILC_PARAM_UINT64) and counted data
+ *    (SILC_PARAM_UICHAR); tapes with other elements return NULL and
+ *    must use silc_buffer_format.  Free with
+ *    silc_buffer_format_free_compiled.
+ *
+ * EXAMPLE
+ *
+ *    // Compile once
+ *    fmt = silc_buffer_format_compile(SILC_PARAM_UINT32,
+ *                                     SILC_PARAM_UINT16,
+ *                                     SILC_PARAM_UICHAR,
+ *                                     SILC_PARAM_END);
+ *
+ *    // Format millions of times
+ *    silc_buffer_format_exec(fmt, buf, seq, flags, payload, payload_len);
+ *
+ ***/
+SilcBufferFormat silc_buffer_format_compile(SilcUInt32 fmt, ...);
+
+/****f* silcutil/silc_buffer_format_exec
+ *
+ * SYNOPSIS
+ *
+ *    int silc_buffer_format_exec(SilcBufferFormat format,
+ *                                SilcBuffer dst, ...);
+ *
+ * DESCRIPTION
+ *
+ *    Formats the values given as variable arguments to the end of `dst'
+ *    according to the compiled `format'.  The encoded length is computed
+ *    in a pre-pass and the buffer is enlarged at most once (never in
+ *    strict mode, see silc_buffer_format_set_strict).  Counted data
+ *    elements take a pointer and a length argument.  Returns the number
+ *    of bytes formatted or -1 on error.
+ *
+ ***/
+int silc_buffer_format_exec(SilcBufferFormat format, SilcBuffer dst, ...);
+
+/****f* silcutil/silc_buffer_unformat_exec
+ *
+ * SYNOPSIS
+ *
+ *    int silc_buffer_unformat_exec(SilcBufferFormat format,
+ *                                  SilcBuffer src, ...);
+ *
+ * DESCRIPTION
+ *
+ *    Decodes data from `src' according to the compiled `format'.  The
+ *    total length of the layout is validated once up front and the
+ *    fields are then decoded with direct loads, without per-element
+ *    bounds checks, which makes this the fastest way to decode a
+ *    fixed packet header.  The arguments are pointers to the decoded
+ *    values: SilcUInt8/16/32/64 pointers for the integer types, and
+ *    for SILC_PARAM_UICHAR an unsigned char ** that is pointed into
+ *    `src' (no copy) followed by the SilcUInt32 data length.  The
+ *    buffer is not advanced; the consumed length is returned, or -1
+ *    if `src' is too short.
+ *
+ * EXAMPLE
+ *
+ *    fmt = silc_buffer_format_compile(SILC_PARAM_UINT32,
+ *                                     SILC_PARAM_UINT16,
+ *                                     SILC_PARAM_END);
+ *    if (silc_buffer_unformat_exec(fmt, buf, &seq, &flags) < 0)
+ *      error;
+ *
+ ***/
+int silc_buffer_unformat_exec(SilcBufferFormat format, SilcBuffer src, ...);
+
+/****f* silcutil/silc_buffer_format_size
+ *
+ * SYNOPSIS
+ *
+ *    int silc_buffer_format_size(SilcBufferFormat format, ...);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the encoded length of the values for the compiled `format'
+ *    without formatting them, for callers that want to pre-size a
+ *    buffer with silc_buffer_salloc.
+ *
+ ***/
+int silc_buffer_format_size(SilcBufferFormat format, ...);
+
+/****f* silcutil/silc_buffer_format_set_strict
+ *
+ * SYNOPSIS
+ *
+ *    void silc_buffer_format_set_strict(SilcBufferFormat format,
+ *                                       SilcBool strict);
+ *
+ * DESCRIPTION
+ *
+ *    In strict mode silc_buffer_format_exec never reallocates the
+ *    destination buffer; if the values do not fit the formatting fails
+ *    with SILC_ERR_OVERFLOW.  For callers that pre-sized the buffer,
+ *    for example from a SilcStack.
+ *
+ ***/
+void silc_buffer_format_set_strict(SilcBufferFormat format, SilcBool strict);
+
+/****f* silcutil/silc_buffer_format_free_compiled
+ *
+ * SYNOPSIS
+ *
+ *    void silc_buffer_format_free_compiled(SilcBufferFormat format);
+ *
+ * DESCRIPTION
+ *
+ *    Frees a compiled format descriptor.
+ *
+ ***/
+void silc_buffer_format_free_compiled(SilcBufferFormat format);
+
 #endif	/* !SILCBUFFMT_H */
@@ -0,0 +1,342 @@
+/*
+
+  silccache.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Initial number of hash buckets, grown when entries exceed buckets */
+#define SILC_CACHE_MIN_BUCKETS 64
+
+/* Cache entry; one allocation with the key copied to the tail */
+typedef struct SilcCacheEntryStruct {
+  struct SilcCacheEntryStruct *hash_next;  /* Bucket chain */
+  struct SilcCacheEntryStruct *lru_prev;   /* Towards most recently used */
+  struct SilcCacheEntryStruct *lru_next;   /* Towards least recently used */
+  void *value;			       /* Cached value */
+  SilcUInt64 size;		       /* Accounted size */
+  SilcUInt64 expires;		       /* Expiry, usec coarse time, 0 never */
+  SilcUInt32 hash;		       /* Cached key hash */
+  SilcUInt32 key_len;		       /* Key length */
+  unsigned char key[1];		       /* Key data, tail allocated */
+} *SilcCacheEntry;
+
+/* Cache context */
+struct SilcCacheStruct {
+  SilcCacheEntry *buckets;	       /* Hash index */
+  SilcCacheEntry lru_head;	       /* Most recently used */
+  SilcCacheEntry lru_tail;	       /* Least recently used */
+  SilcCacheDestructor destructor;
+  void *context;
+  SilcStatCounter hit;		       /* Hit counter, may be NULL */
+  SilcStatCounter miss;		       /* Miss counter, may be NULL */
+  SilcUInt64 max_size;		       /* Size cap, 0 unlimited */
+  SilcUInt64 size;		       /* Current accounted size */
+  SilcUInt64 ttl;		       /* Time to live in usec, 0 never */
+  SilcUInt32 max_count;		       /* Entry cap, 0 unlimited */
+  SilcUInt32 count;		       /* Current entry count */
+  SilcUInt32 num_buckets;	       /* Bucket count, power of two */
+};
+
+/************************ Static utility functions **************************/
+
+/* Hashes the key */
+
+static SilcUInt32 silc_cache_hash(const void *key, SilcUInt32 key_len)
+{
+  return (SilcUInt32)silc_fast_hash(key, key_len, 0);
+}
+
+/* Unlinks `e' from the hash index and LRU list and destroys it */
+
+static void silc_cache_remove(SilcCache cache, SilcCacheEntry e)
+{
+  SilcCacheEntry *ep;
+
+  for (ep = &cache->buckets[e->hash & (cache->num_buckets - 1)];
+       *ep; ep = &(*ep)->hash_next)
+    if (*ep == e) {
+      *ep = e->hash_next;
+      break;
+    }
+
+  if (e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    cache->lru_head = e->lru_next;
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    cache->lru_tail = e->lru_prev;
+
+  cache->count--;
+  cache->size -= e->size;
+
+  if (cache->destructor)
+    cache->destructor(cache, e->key, e->key_len, e->value, cache->context);
+
+  silc_free(e);
+}
+
+/* Moves `e' to the head of the LRU list */
+
+static void silc_cache_touch(SilcCache cache, SilcCacheEntry e)
+{
+  if (cache->lru_head == e)
+    return;
+
+  e->lru_prev->lru_next = e->lru_next;
+  if (e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    cache->lru_tail = e->lru_prev;
+
+  e->lru_prev = NULL;
+  e->lru_next = cache->lru_head;
+  cache->lru_head->lru_prev = e;
+  cache->lru_head = e;
+}
+
+/* Finds the entry of `key'.  Expired entries are removed, not found. */
+
+static SilcCacheEntry silc_cache_find(SilcCache cache, const void *key,
+				      SilcUInt32 key_len, SilcUInt32 hash)
+{
+  SilcCacheEntry e, next;
+
+  for (e = cache->buckets[hash & (cache->num_buckets - 1)]; e; e = next) {
+    next = e->hash_next;
+    if (e->hash != hash || e->key_len != key_len ||
+	memcmp(e->key, key, key_len))
+      continue;
+    if (e->expires && silc_time_coarse_usec() >= e->expires) {
+      silc_cache_remove(cache, e);
+      return NULL;
+    }
+    return e;
+  }
+
+  return NULL;
+}
+
+/* Evicts least recently used entries until the caps hold */
+
+static void silc_cache_evict(SilcCache cache)
+{
+  while (cache->lru_tail &&
+	 ((cache->max_count && cache->count > cache->max_count) ||
+	  (cache->max_size && cache->size > cache->max_size)))
+    silc_cache_remove(cache, cache->lru_tail);
+}
+
+/* Doubles the bucket array when the load factor reaches one */
+
+static void silc_cache_rehash(SilcCache cache)
+{
+  SilcCacheEntry *buckets, e, next;
+  SilcUInt32 num, i;
+
+  num = cache->num_buckets * 2;
+  buckets = silc_calloc(num, sizeof(*buckets));
+  if (!buckets)
+    return;
+
+  for (i = 0; i < cache->num_buckets; i++)
+    for (e = cache->buckets[i]; e; e = next) {
+      next = e->hash_next;
+      e->hash_next = buckets[e->hash & (num - 1)];
+      buckets[e->hash & (num - 1)] = e;
+    }
+
+  silc_free(cache->buckets);
+  cache->buckets = buckets;
+  cache->num_buckets = num;
+}
+
+/****************************** Public API **********************************/
+
+/* Allocate cache */
+
+SilcCache silc_cache_alloc(const char *name, SilcUInt32 max_count,
+			   SilcUInt64 max_size, SilcUInt32 ttl_sec,
+			   SilcCacheDestructor destructor, void *context)
+{
+  SilcCache cache;
+  char cname[128];
+
+  cache = silc_calloc(1, sizeof(*cache));
+  if (!cache)
+    return NULL;
+
+  cache->buckets = silc_calloc(SILC_CACHE_MIN_BUCKETS,
+			       sizeof(*cache->buckets));
+  if (!cache->buckets) {
+    silc_free(cache);
+    return NULL;
+  }
+
+  cache->num_buckets = SILC_CACHE_MIN_BUCKETS;
+  cache->max_count = max_count;
+  cache->max_size = max_size;
+  cache->ttl = (SilcUInt64)ttl_sec * 1000000;
+  cache->destructor = destructor;
+  cache->context = context;
+
+  if (name) {
+    silc_snprintf(cname, sizeof(cname), "cache.%s.hit", name);
+    cache->hit = silc_stat_register(cname);
+    silc_snprintf(cname, sizeof(cname), "cache.%s.miss", name);
+    cache->miss = silc_stat_register(cname);
+  }
+
+  SILC_LOG_DEBUG(("Allocated cache %p", cache));
+
+  return cache;
+}
+
+/* Free cache */
+
+void silc_cache_free(SilcCache cache)
+{
+  if (!cache)
+    return;
+
+  silc_cache_flush(cache);
+  silc_free(cache->buckets);
+  silc_free(cache);
+}
+
+/* Insert entry */
+
+SilcBool silc_cache_put(SilcCache cache, const void *key, SilcUInt32 key_len,
+			void *value, SilcUInt64 size)
+{
+  SilcCacheEntry e;
+  SilcUInt32 hash;
+
+  if (!cache || !key || !key_len) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  hash = silc_cache_hash(key, key_len);
+
+  /* Replace existing entry */
+  e = silc_cache_find(cache, key, key_len, hash);
+  if (e)
+    silc_cache_remove(cache, e);
+
+  e = silc_malloc(sizeof(*e) + key_len - 1);
+  if (!e)
+    return FALSE;
+
+  e->value = value;
+  e->size = size;
+  e->expires = cache->ttl ? silc_time_coarse_usec() + cache->ttl : 0;
+  e->hash = hash;
+  e->key_len = key_len;
+  memcpy(e->key, key, key_len);
+
+  e->hash_next = cache->buckets[hash & (cache->num_buckets - 1)];
+  cache->buckets[hash & (cache->num_buckets - 1)] = e;
+
+  e->lru_prev = NULL;
+  e->lru_next = cache->lru_head;
+  if (cache->lru_head)
+    cache->lru_head->lru_prev = e;
+  cache->lru_head = e;
+  if (!cache->lru_tail)
+    cache->lru_tail = e;
+
+  cache->count++;
+  cache->size += size;
+
+  if (cache->count > cache->num_buckets)
+    silc_cache_rehash(cache);
+
+  silc_cache_evict(cache);
+
+  return TRUE;
+}
+
+/* Look up entry */
+
+SilcBool silc_cache_get(SilcCache cache, const void *key, SilcUInt32 key_len,
+			void **ret_value)
+{
+  SilcCacheEntry e;
+
+  if (!cache || !key || !key_len) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  e = silc_cache_find(cache, key, key_len, silc_cache_hash(key, key_len));
+  if (!e) {
+    silc_stat_inc(cache->miss);
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  silc_cache_touch(cache, e);
+  silc_stat_inc(cache->hit);
+
+  if (ret_value)
+    *ret_value = e->value;
+
+  return TRUE;
+}
+
+/* Delete entry */
+
+SilcBool silc_cache_del(SilcCache cache, const void *key, SilcUInt32 key_len)
+{
+  SilcCacheEntry e;
+
+  if (!cache || !key || !key_len) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  e = silc_cache_find(cache, key, key_len, silc_cache_hash(key, key_len));
+  if (!e) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  silc_cache_remove(cache, e);
+
+  return TRUE;
+}
+
+/* Remove all entries */
+
+void silc_cache_flush(SilcCache cache)
+{
+  if (!cache)
+    return;
+
+  while (cache->lru_tail)
+    silc_cache_remove(cache, cache->lru_tail);
+}
+
+/* Return entry count */
+
+SilcUInt32 silc_cache_count(SilcCache cache)
+{
+  return cache ? cache->count : 0;
+}
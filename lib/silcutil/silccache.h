@@ -0,0 +1,194 @@
+/*
+
+  silccache.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Cache Interface
+ *
+ * DESCRIPTION
+ *
+ * A hash-indexed LRU cache.  Each entry is one allocation holding the
+ * hash chain link, the LRU links and the copied key, so inserting costs
+ * one allocation and eviction is O(1) from the tail of the LRU list.
+ * The cache evicts by entry count and/or by total accounted size, and
+ * optionally expires entries after a time-to-live measured with the
+ * coarse clock.  Hits and misses are counted through silcstat when the
+ * cache is given a name.
+ *
+ * The interface is not thread safe; protect a shared cache with a lock,
+ * or use one cache per thread.
+ *
+ ***/
+
+#ifndef SILCCACHE_H
+#define SILCCACHE_H
+
+/****s* silcutil/SilcCache
+ *
+ * NAME
+ *
+ *    typedef struct SilcCacheStruct *SilcCache;
+ *
+ * DESCRIPTION
+ *
+ *    The cache context allocated by silc_cache_alloc.
+ *
+ ***/
+typedef struct SilcCacheStruct *SilcCache;
+
+/****f* silcutil/SilcCacheDestructor
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcCacheDestructor)(SilcCache cache,
+ *                                        const void *key,
+ *                                        SilcUInt32 key_len,
+ *                                        void *value, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Called for the value of every entry leaving the cache, whether by
+ *    eviction, expiry, silc_cache_del, silc_cache_flush or
+ *    silc_cache_free.
+ *
+ ***/
+typedef void (*SilcCacheDestructor)(SilcCache cache, const void *key,
+				    SilcUInt32 key_len, void *value,
+				    void *context);
+
+/****f* silcutil/silc_cache_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcCache silc_cache_alloc(const char *name, SilcUInt32 max_count,
+ *                               SilcUInt64 max_size, SilcUInt32 ttl_sec,
+ *                               SilcCacheDestructor destructor,
+ *                               void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates a cache.  `max_count', if non-zero, caps the number of
+ *    entries; `max_size', if non-zero, caps the sum of the sizes given
+ *    to silc_cache_put.  When either cap is exceeded least recently
+ *    used entries are evicted.  `ttl_sec', if non-zero, expires entries
+ *    that many seconds after insertion.  If `name' is given, hit and
+ *    miss counters are registered through silcstat as
+ *    "cache.<name>.hit" and "cache.<name>.miss".  Returns NULL on
+ *    error.
+ *
+ ***/
+SilcCache silc_cache_alloc(const char *name, SilcUInt32 max_count,
+			   SilcUInt64 max_size, SilcUInt32 ttl_sec,
+			   SilcCacheDestructor destructor, void *context);
+
+/****f* silcutil/silc_cache_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_cache_free(SilcCache cache);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the cache and all entries in it, calling the destructor for
+ *    each entry.
+ *
+ ***/
+void silc_cache_free(SilcCache cache);
+
+/****f* silcutil/silc_cache_put
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_cache_put(SilcCache cache, const void *key,
+ *                            SilcUInt32 key_len, void *value,
+ *                            SilcUInt64 size);
+ *
+ * DESCRIPTION
+ *
+ *    Inserts `value' under the `key', copying the key into the entry.
+ *    `size' is the entry's contribution towards the cache's size cap;
+ *    pass 0 when only counting entries.  An existing entry with the
+ *    same key is replaced (its destructor is called).  Inserting may
+ *    evict least recently used entries.  Returns FALSE on memory
+ *    allocation error.
+ *
+ ***/
+SilcBool silc_cache_put(SilcCache cache, const void *key, SilcUInt32 key_len,
+			void *value, SilcUInt64 size);
+
+/****f* silcutil/silc_cache_get
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_cache_get(SilcCache cache, const void *key,
+ *                            SilcUInt32 key_len, void **ret_value);
+ *
+ * DESCRIPTION
+ *
+ *    Looks up the entry of `key'.  On a hit the entry becomes the most
+ *    recently used, its value is returned into `ret_value' and TRUE is
+ *    returned.  Expired entries are removed on lookup and count as
+ *    misses.
+ *
+ ***/
+SilcBool silc_cache_get(SilcCache cache, const void *key, SilcUInt32 key_len,
+			void **ret_value);
+
+/****f* silcutil/silc_cache_del
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_cache_del(SilcCache cache, const void *key,
+ *                            SilcUInt32 key_len);
+ *
+ * DESCRIPTION
+ *
+ *    Removes the entry of `key', calling its destructor.  Returns FALSE
+ *    if the key is not in the cache.
+ *
+ ***/
+SilcBool silc_cache_del(SilcCache cache, const void *key,
+			SilcUInt32 key_len);
+
+/****f* silcutil/silc_cache_flush
+ *
+ * SYNOPSIS
+ *
+ *    void silc_cache_flush(SilcCache cache);
+ *
+ * DESCRIPTION
+ *
+ *    Removes all entries, calling the destructor for each.  The cache
+ *    remains usable.
+ *
+ ***/
+void silc_cache_flush(SilcCache cache);
+
+/****f* silcutil/silc_cache_count
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_cache_count(SilcCache cache);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of entries in the cache.
+ *
+ ***/
+SilcUInt32 silc_cache_count(SilcCache cache);
+
+#endif /* SILCCACHE_H */
@@ -0,0 +1,191 @@
+/*
+
+  silcchecksum.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+#include "silcchecksum.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif /* __SSE4_2__ */
+
+/* CRC tables, generated on first use */
+static SilcUInt32 crc32_table[256];
+static SilcUInt32 crc32c_table[256];
+static SilcBool crc_tables_init = FALSE;
+
+/* Generates the lookup table of a reflected CRC32 polynomial */
+
+static void silc_crc_gen_table(SilcUInt32 *table, SilcUInt32 poly)
+{
+  SilcUInt32 c;
+  int i, k;
+
+  for (i = 0; i < 256; i++) {
+    c = (SilcUInt32)i;
+    for (k = 0; k < 8; k++)
+      c = (c & 1) ? poly ^ (c >> 1) : c >> 1;
+    table[i] = c;
+  }
+}
+
+static void silc_crc_init_tables(void)
+{
+  silc_crc_gen_table(crc32_table, 0xedb88320);
+  silc_crc_gen_table(crc32c_table, 0x82f63b78);
+  crc_tables_init = TRUE;
+}
+
+/* CRC32, IEEE 802.3 polynomial */
+
+SilcUInt32 silc_crc32(const unsigned char *data, SilcUInt32 data_len,
+		      SilcUInt32 crc)
+{
+  SilcUInt32 i;
+
+  if (silc_unlikely(!crc_tables_init))
+    silc_crc_init_tables();
+
+  crc = ~crc;
+  for (i = 0; i < data_len; i++)
+    crc = crc32_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+  return ~crc;
+}
+
+/* CRC32C, Castagnoli polynomial.  The implementation is selected once
+   at first use through the multiversion dispatcher instead of checking
+   the processor features on every call. */
+
+typedef SilcUInt32 (*SilcCrc32cFn)(const unsigned char *data,
+				   SilcUInt32 data_len, SilcUInt32 crc);
+
+SILC_MULTIVERSION(SilcCrc32cFn, silc_crc32c_impl)
+
+/* Table implementation */
+
+static SilcUInt32 silc_crc32c_soft(const unsigned char *data,
+				   SilcUInt32 data_len, SilcUInt32 crc)
+{
+  SilcUInt32 i;
+
+  if (silc_unlikely(!crc_tables_init))
+    silc_crc_init_tables();
+
+  for (i = 0; i < data_len; i++)
+    crc = crc32c_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+  return crc;
+}
+
+#if defined(__SSE4_2__)
+/* Hardware CRC32C, eight bytes per instruction */
+
+static SilcUInt32 silc_crc32c_hw(const unsigned char *data,
+				 SilcUInt32 data_len, SilcUInt32 crc)
+{
+  SilcUInt32 i = 0;
+
+  while (i + 8 <= data_len) {
+    SilcUInt64 w;
+    memcpy(&w, data + i, 8);
+    crc = (SilcUInt32)_mm_crc32_u64(crc, w);
+    i += 8;
+  }
+  while (i < data_len)
+    crc = _mm_crc32_u8(crc, data[i++]);
+
+  return crc;
+}
+#endif /* __SSE4_2__ */
+
+static SilcCrc32cFn silc_crc32c_impl_resolve(void)
+{
+#if defined(__SSE4_2__)
+  if (silc_cpuid_features() & SILC_CPUID_SSE42)
+    return silc_crc32c_hw;
+#endif /* __SSE4_2__ */
+  return silc_crc32c_soft;
+}
+
+SilcUInt32 silc_crc32c(const unsigned char *data, SilcUInt32 data_len,
+		       SilcUInt32 crc)
+{
+  return ~SILC_MV(silc_crc32c_impl)(data, data_len, ~crc);
+}
+
+/* Adler-32 */
+
+#define SILC_ADLER_BASE 65521
+#define SILC_ADLER_NMAX 5552
+
+SilcUInt32 silc_adler32(const unsigned char *data, SilcUInt32 data_len,
+			SilcUInt32 adler)
+{
+  SilcUInt32 a = adler & 0xffff, b = (adler >> 16) & 0xffff;
+  SilcUInt32 i, n;
+
+  if (!adler)
+    a = 1;
+
+  while (data_len) {
+    n = data_len > SILC_ADLER_NMAX ? SILC_ADLER_NMAX : data_len;
+    for (i = 0; i < n; i++) {
+      a += data[i];
+      b += a;
+    }
+    a %= SILC_ADLER_BASE;
+    b %= SILC_ADLER_BASE;
+    data += n;
+    data_len -= n;
+  }
+
+  return (b << 16) | a;
+}
+
+/* Fast 64-bit hash (FNV-1a over words with avalanche finish) */
+
+SilcUInt64 silc_fast_hash(const unsigned char *data, SilcUInt32 data_len,
+			  SilcUInt64 seed)
+{
+  SilcUInt64 h = seed ^ ((SilcUInt64)0xcbf29ce484222325LL ^
+			 ((SilcUInt64)data_len *
+			  (SilcUInt64)0x100000001b3LL));
+  SilcUInt64 w;
+  SilcUInt32 i = 0;
+
+  while (i + 8 <= data_len) {
+    memcpy(&w, data + i, 8);
+    h ^= w;
+    h *= (SilcUInt64)0x100000001b3LL;
+    i += 8;
+  }
+  while (i < data_len) {
+    h ^= data[i++];
+    h *= (SilcUInt64)0x100000001b3LL;
+  }
+
+  /* Avalanche */
+  h ^= h >> 33;
+  h *= (SilcUInt64)0xff51afd7ed558ccdLL;
+  h ^= h >> 33;
+  h *= (SilcUInt64)0xc4ceb9fe1a85ec53LL;
+  h ^= h >> 33;
+
+  return h;
+}
@@ -0,0 +1,105 @@
+/*
+
+  silcchecksum.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Checksum Interface
+ *
+ * DESCRIPTION
+ *
+ * Checksum and fast non-cryptographic hash routines: CRC32 (zlib/PNG
+ * polynomial), CRC32C (iSCSI polynomial, computed with the processor
+ * CRC32 instruction where available), Adler-32 and a fast 64-bit hash
+ * for hashing binary keys.  All functions take an initial value so
+ * checksums can be computed incrementally over chunks.
+ *
+ * None of these are cryptographic.
+ *
+ ***/
+
+#ifndef SILCCHECKSUM_H
+#define SILCCHECKSUM_H
+
+/****f* silcutil/silc_crc32
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_crc32(const unsigned char *data, SilcUInt32 data_len,
+ *                          SilcUInt32 crc);
+ *
+ * DESCRIPTION
+ *
+ *    Computes the CRC32 (IEEE 802.3 polynomial) of the data.  Pass 0 as
+ *    `crc' for a new checksum, or the previous return value to continue
+ *    over the next chunk.
+ *
+ ***/
+SilcUInt32 silc_crc32(const unsigned char *data, SilcUInt32 data_len,
+		      SilcUInt32 crc);
+
+/****f* silcutil/silc_crc32c
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_crc32c(const unsigned char *data, SilcUInt32 data_len,
+ *                           SilcUInt32 crc);
+ *
+ * DESCRIPTION
+ *
+ *    Computes the CRC32C (Castagnoli polynomial) of the data, with the
+ *    SSE4.2 CRC32 instruction when the processor has it.  Incremental
+ *    use as with silc_crc32.
+ *
+ ***/
+SilcUInt32 silc_crc32c(const unsigned char *data, SilcUInt32 data_len,
+		       SilcUInt32 crc);
+
+/****f* silcutil/silc_adler32
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_adler32(const unsigned char *data,
+ *                            SilcUInt32 data_len, SilcUInt32 adler);
+ *
+ * DESCRIPTION
+ *
+ *    Computes the Adler-32 checksum of the data.  Pass 1 as `adler' for
+ *    a new checksum, or the previous return value to continue.
+ *
+ ***/
+SilcUInt32 silc_adler32(const unsigned char *data, SilcUInt32 data_len,
+			SilcUInt32 adler);
+
+/****f* silcutil/silc_fast_hash
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_fast_hash(const unsigned char *data,
+ *                              SilcUInt32 data_len, SilcUInt64 seed);
+ *
+ * DESCRIPTION
+ *
+ *    Computes a fast 64-bit non-cryptographic hash of the data,
+ *    processing a word at a time.  Suitable for hash tables and
+ *    fingerprinting; also usable as a SilcHashTable hash function
+ *    through silc_hash_data-style wrappers.
+ *
+ ***/
+SilcUInt64 silc_fast_hash(const unsigned char *data, SilcUInt32 data_len,
+			  SilcUInt64 seed);
+
+#endif /* SILCCHECKSUM_H */
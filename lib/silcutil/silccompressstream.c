@@ -0,0 +1,302 @@
+/*
+
+  silccompressstream.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+#include "silccompressstream.h"
+#include "zlib.h"
+
+/* I/O chunk size */
+#define SILC_COMPRESS_BUFLEN 8192
+
+const SilcStreamOps silc_compress_stream_ops;
+
+#define SILC_IS_COMPRESS_STREAM(s) ((s) && (s)->ops == &silc_compress_stream_ops)
+
+/* Compression stream context */
+typedef struct SilcCompressStreamStruct {
+  const SilcStreamOps *ops;
+  SilcStream stream;		       /* Wrapped stream */
+  z_stream def;			       /* Compressor */
+  z_stream inf;			       /* Decompressor */
+  SilcBuffer outbuf;		       /* Compressed data waiting to send */
+  const unsigned char *dict;	       /* Preset dictionary */
+  SilcUInt32 dict_len;
+  SilcStreamNotifier notifier;
+  void *notifier_context;
+  unsigned char inbuf[SILC_COMPRESS_BUFLEN]; /* Compressed input */
+  unsigned int inf_init  : 1;	       /* Decompressor initialized */
+} *SilcCompressStream;
+
+/************************ Static utility functions **************************/
+
+/* Writes pending compressed data to the wrapped stream.  Returns FALSE
+   on fatal error. */
+
+static SilcBool silc_compress_stream_drain(SilcCompressStream cs)
+{
+  int ret;
+
+  while (silc_buffer_len(cs->outbuf) > 0) {
+    ret = silc_stream_write(cs->stream, silc_buffer_data(cs->outbuf),
+			    silc_buffer_len(cs->outbuf));
+    if (ret == 0 || ret == -2)
+      return FALSE;
+    if (ret == -1)
+      return TRUE;
+    silc_buffer_pull(cs->outbuf, ret);
+  }
+
+  silc_buffer_reset(cs->outbuf);
+  return TRUE;
+}
+
+/* Runs the compressor over `data' with `flush' and queues the output */
+
+static int silc_compress_stream_deflate(SilcCompressStream cs,
+					const unsigned char *data,
+					SilcUInt32 data_len, int flush)
+{
+  unsigned char buf[SILC_COMPRESS_BUFLEN];
+  SilcUInt32 produced;
+  int ret;
+
+  cs->def.next_in = (unsigned char *)data;
+  cs->def.avail_in = data_len;
+
+  do {
+    cs->def.next_out = buf;
+    cs->def.avail_out = sizeof(buf);
+
+    ret = deflate(&cs->def, flush);
+    if (ret == Z_STREAM_ERROR) {
+      silc_set_errno(SILC_ERR_BAD_ENCODING);
+      return -2;
+    }
+
+    produced = sizeof(buf) - cs->def.avail_out;
+    if (produced) {
+      /* Append to the unsent data in the queue */
+      if (silc_buffer_taillen(cs->outbuf) < produced)
+	if (!silc_buffer_realloc(cs->outbuf,
+				 silc_buffer_truelen(cs->outbuf) +
+				 (produced -
+				  silc_buffer_taillen(cs->outbuf))))
+	  return -2;
+      memcpy(cs->outbuf->tail, buf, produced);
+      silc_buffer_pull_tail(cs->outbuf, produced);
+    }
+  } while (cs->def.avail_out == 0);
+
+  if (!silc_compress_stream_drain(cs))
+    return -2;
+
+  return (int)data_len;
+}
+
+/* I/O callback from the wrapped stream */
+
+static void silc_compress_stream_io(SilcStream stream,
+				    SilcStreamStatus status, void *context)
+{
+  SilcCompressStream cs = context;
+
+  if (!cs->notifier)
+    return;
+
+  if (status == SILC_STREAM_CAN_WRITE)
+    if (!silc_compress_stream_drain(cs))
+      return;
+
+  cs->notifier((SilcStream)cs, status, cs->notifier_context);
+}
+
+/**************************** Stream operations *****************************/
+
+/* Read and decompress */
+
+static int silc_compress_stream_read(SilcStream stream, unsigned char *buf,
+				     SilcUInt32 buf_len)
+{
+  SilcCompressStream cs = stream;
+  int ret;
+  SilcUInt32 produced = 0;
+
+  while (produced == 0) {
+    if (cs->inf.avail_in == 0) {
+      /* Read more compressed data */
+      ret = silc_stream_read(cs->stream, cs->inbuf, sizeof(cs->inbuf));
+      if (ret == 0 || ret == -2)
+	return ret;
+      if (ret == -1)
+	return produced ? (int)produced : -1;
+      cs->inf.next_in = cs->inbuf;
+      cs->inf.avail_in = ret;
+    }
+
+    cs->inf.next_out = buf;
+    cs->inf.avail_out = buf_len;
+
+    ret = inflate(&cs->inf, Z_NO_FLUSH);
+    if (ret == Z_NEED_DICT && cs->dict) {
+      if (inflateSetDictionary(&cs->inf, cs->dict, cs->dict_len) != Z_OK) {
+	silc_set_errno(SILC_ERR_BAD_ENCODING);
+	return -2;
+      }
+      continue;
+    }
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+      silc_set_errno(SILC_ERR_BAD_ENCODING);
+      return -2;
+    }
+
+    produced = buf_len - cs->inf.avail_out;
+    if (ret == Z_STREAM_END)
+      break;
+  }
+
+  return (int)produced;
+}
+
+/* Compress and write */
+
+static int silc_compress_stream_write(SilcStream stream,
+				      const unsigned char *data,
+				      SilcUInt32 data_len)
+{
+  SilcCompressStream cs = stream;
+  return silc_compress_stream_deflate(cs, data, data_len, Z_NO_FLUSH);
+}
+
+static SilcBool silc_compress_stream_close(SilcStream stream)
+{
+  SilcCompressStream cs = stream;
+
+  /* Flush remaining compressed data */
+  silc_compress_stream_deflate(cs, NULL, 0, Z_FINISH);
+
+  return silc_stream_close(cs->stream);
+}
+
+static void silc_compress_stream_destroy(SilcStream stream)
+{
+  SilcCompressStream cs = stream;
+
+  deflateEnd(&cs->def);
+  if (cs->inf_init)
+    inflateEnd(&cs->inf);
+  silc_buffer_free(cs->outbuf);
+  silc_free(cs);
+}
+
+static SilcBool silc_compress_stream_notifier(SilcStream stream,
+					      SilcSchedule schedule,
+					      SilcStreamNotifier callback,
+					      void *context)
+{
+  SilcCompressStream cs = stream;
+
+  cs->notifier = callback;
+  cs->notifier_context = context;
+
+  return silc_stream_set_notifier(cs->stream, schedule,
+				  callback ? silc_compress_stream_io : NULL,
+				  callback ? cs : NULL);
+}
+
+static SilcSchedule silc_compress_stream_get_schedule(SilcStream stream)
+{
+  SilcCompressStream cs = stream;
+  return silc_stream_get_schedule(cs->stream);
+}
+
+const SilcStreamOps silc_compress_stream_ops =
+{
+  silc_compress_stream_read,
+  silc_compress_stream_write,
+  silc_compress_stream_close,
+  silc_compress_stream_destroy,
+  silc_compress_stream_notifier,
+  silc_compress_stream_get_schedule,
+};
+
+/****************************** Public API **********************************/
+
+/* Create compression stream */
+
+SilcStream silc_compress_stream_create(SilcStream stream, int level,
+				       const unsigned char *dict,
+				       SilcUInt32 dict_len)
+{
+  SilcCompressStream cs;
+
+  if (!stream) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  cs = silc_calloc(1, sizeof(*cs));
+  if (!cs)
+    return NULL;
+
+  cs->ops = &silc_compress_stream_ops;
+  cs->stream = stream;
+  cs->dict = dict;
+  cs->dict_len = dict_len;
+
+  cs->outbuf = silc_buffer_alloc(SILC_COMPRESS_BUFLEN);
+  if (!cs->outbuf) {
+    silc_free(cs);
+    return NULL;
+  }
+  silc_buffer_reset(cs->outbuf);
+
+  if (deflateInit(&cs->def, level ? level : Z_DEFAULT_COMPRESSION) != Z_OK) {
+    silc_buffer_free(cs->outbuf);
+    silc_free(cs);
+    return NULL;
+  }
+  if (dict)
+    deflateSetDictionary(&cs->def, dict, dict_len);
+
+  if (inflateInit(&cs->inf) != Z_OK) {
+    deflateEnd(&cs->def);
+    silc_buffer_free(cs->outbuf);
+    silc_free(cs);
+    return NULL;
+  }
+  cs->inf_init = TRUE;
+
+  SILC_LOG_DEBUG(("Created compression stream %p over %p", cs, stream));
+
+  return (SilcStream)cs;
+}
+
+/* Flush the compressor at a message boundary */
+
+SilcBool silc_compress_stream_flush(SilcStream stream)
+{
+  SilcCompressStream cs = stream;
+
+  if (!SILC_IS_COMPRESS_STREAM(cs)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  return silc_compress_stream_deflate(cs, NULL, 0, Z_SYNC_FLUSH) >= 0;
+}
@@ -0,0 +1,78 @@
+/*
+
+  silccompressstream.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Compression Stream Interface
+ *
+ * DESCRIPTION
+ *
+ * A compression stream wraps any SilcStream, compressing everything
+ * written to it and decompressing everything read from it, using the
+ * zlib deflate format.  Like the buffer stream wraps framing around a
+ * stream, the compression stream wraps a codec around one; the wrapped
+ * stream carries the compressed bytes.
+ *
+ * An optional preset dictionary primes the codec with protocol-typical
+ * data, improving the ratio of small messages.  Both ends must use the
+ * same dictionary.
+ *
+ ***/
+
+#ifndef SILCCOMPRESSSTREAM_H
+#define SILCCOMPRESSSTREAM_H
+
+/****f* silcutil/silc_compress_stream_create
+ *
+ * SYNOPSIS
+ *
+ *    SilcStream silc_compress_stream_create(SilcStream stream,
+ *                                           int level,
+ *                                           const unsigned char *dict,
+ *                                           SilcUInt32 dict_len);
+ *
+ * DESCRIPTION
+ *
+ *    Creates a compression stream over `stream'.  The `level' is the
+ *    zlib compression level (1-9, 0 for the default).  If `dict' is
+ *    non-NULL it is used as a preset dictionary for both directions.
+ *    The returned stream is used with the normal silc_stream_* API;
+ *    destroying it does not destroy the wrapped stream.  Returns NULL
+ *    on error.
+ *
+ ***/
+SilcStream silc_compress_stream_create(SilcStream stream, int level,
+				       const unsigned char *dict,
+				       SilcUInt32 dict_len);
+
+/****f* silcutil/silc_compress_stream_flush
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_compress_stream_flush(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Flushes the compressor so that everything written so far can be
+ *    decompressed by the receiver (a zlib sync flush).  Call at message
+ *    boundaries; without flushing the codec may hold data back for
+ *    better compression.
+ *
+ ***/
+SilcBool silc_compress_stream_flush(SilcStream stream);
+
+#endif /* SILCCOMPRESSSTREAM_H */
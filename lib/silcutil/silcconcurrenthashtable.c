@@ -0,0 +1,231 @@
+/*
+
+  silcconcurrenthashtable.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+/* Striped thread-safe hash table.  The key space is divided over several
+   independent SilcHashTables, each protected by its own read/write lock.
+   Readers take only the shared lock of their stripe, so read-mostly
+   registries scale over the worker threads instead of serializing on one
+   table mutex. */
+
+#include "silcruntime.h"
+#include "silcconcurrenthashtable.h"
+
+/* Default number of stripes */
+#define SILC_CONCURRENT_HASH_STRIPES 16
+
+/* One stripe */
+typedef struct {
+  SilcHashTable table;
+  SilcRwLock lock;
+} SilcConcurrentHashStripe;
+
+/* Concurrent hash table context */
+struct SilcConcurrentHashTableStruct {
+  SilcConcurrentHashStripe *stripes;
+  SilcUInt32 num_stripes;	     /* Power of two */
+  SilcHashFunction hash;
+  void *hash_user_context;
+};
+
+/* Returns the stripe of `key' */
+
+static inline SilcConcurrentHashStripe *
+silc_concurrent_hash_stripe(SilcConcurrentHashTable ht, void *key)
+{
+  SilcUInt32 h = ht->hash(key, ht->hash_user_context);
+
+  /* Use the high bits for stripe selection; the tables use the low
+     bits for their buckets. */
+  return &ht->stripes[(h >> 16 ^ h) & (ht->num_stripes - 1)];
+}
+
+/* Allocate concurrent hash table */
+
+SilcConcurrentHashTable
+silc_concurrent_hash_table_alloc(SilcStack stack,
+				 SilcUInt32 table_size,
+				 SilcUInt32 num_stripes,
+				 SilcHashFunction hash,
+				 void *hash_user_context,
+				 SilcHashCompare compare,
+				 void *compare_user_context,
+				 SilcHashDestructor destructor,
+				 void *destructor_user_context)
+{
+  SilcConcurrentHashTable ht;
+  SilcUInt32 n = SILC_CONCURRENT_HASH_STRIPES, i;
+
+  if (!hash) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  /* Round stripe count up to a power of two */
+  if (num_stripes) {
+    n = 1;
+    while (n < num_stripes)
+      n <<= 1;
+  }
+
+  ht = silc_calloc(1, sizeof(*ht));
+  if (!ht)
+    return NULL;
+
+  ht->stripes = silc_calloc(n, sizeof(*ht->stripes));
+  if (!ht->stripes) {
+    silc_free(ht);
+    return NULL;
+  }
+  ht->num_stripes = n;
+  ht->hash = hash;
+  ht->hash_user_context = hash_user_context;
+
+  for (i = 0; i < n; i++) {
+    ht->stripes[i].table =
+      silc_hash_table_alloc(stack, table_size ? table_size / n : 0,
+			    hash, hash_user_context,
+			    compare, compare_user_context,
+			    destructor, destructor_user_context, TRUE);
+    if (ht->stripes[i].table)
+      /* Lookups run under the shared lock and must never mutate the
+	 stripe; rehash in one sweep inside the (write-locked) add. */
+      silc_hash_table_set_incremental(ht->stripes[i].table, FALSE);
+    if (!ht->stripes[i].table ||
+	!silc_rwlock_alloc(&ht->stripes[i].lock)) {
+      if (ht->stripes[i].table)
+	silc_hash_table_free(ht->stripes[i].table);
+      while (i-- > 0) {
+	silc_hash_table_free(ht->stripes[i].table);
+	silc_rwlock_free(ht->stripes[i].lock);
+      }
+      silc_free(ht->stripes);
+      silc_free(ht);
+      return NULL;
+    }
+  }
+
+  return ht;
+}
+
+/* Free concurrent hash table */
+
+void silc_concurrent_hash_table_free(SilcConcurrentHashTable ht)
+{
+  SilcUInt32 i;
+
+  for (i = 0; i < ht->num_stripes; i++) {
+    silc_hash_table_free(ht->stripes[i].table);
+    silc_rwlock_free(ht->stripes[i].lock);
+  }
+  silc_free(ht->stripes);
+  silc_free(ht);
+}
+
+/* Add entry */
+
+SilcBool silc_concurrent_hash_table_add(SilcConcurrentHashTable ht,
+					void *key, void *context)
+{
+  SilcConcurrentHashStripe *s = silc_concurrent_hash_stripe(ht, key);
+  SilcBool ret;
+
+  silc_rwlock_wrlock(s->lock);
+  ret = silc_hash_table_add(s->table, key, context);
+  silc_rwlock_unlock(s->lock);
+
+  return ret;
+}
+
+/* Set entry */
+
+SilcBool silc_concurrent_hash_table_set(SilcConcurrentHashTable ht,
+					void *key, void *context)
+{
+  SilcConcurrentHashStripe *s = silc_concurrent_hash_stripe(ht, key);
+  SilcBool ret;
+
+  silc_rwlock_wrlock(s->lock);
+  ret = silc_hash_table_set(s->table, key, context);
+  silc_rwlock_unlock(s->lock);
+
+  return ret;
+}
+
+/* Delete entry */
+
+SilcBool silc_concurrent_hash_table_del(SilcConcurrentHashTable ht,
+					void *key)
+{
+  SilcConcurrentHashStripe *s = silc_concurrent_hash_stripe(ht, key);
+  SilcBool ret;
+
+  silc_rwlock_wrlock(s->lock);
+  ret = silc_hash_table_del(s->table, key);
+  silc_rwlock_unlock(s->lock);
+
+  return ret;
+}
+
+/* Find entry; readers only share-lock the stripe */
+
+SilcBool silc_concurrent_hash_table_find(SilcConcurrentHashTable ht,
+					 void *key, void **ret_key,
+					 void **ret_context)
+{
+  SilcConcurrentHashStripe *s = silc_concurrent_hash_stripe(ht, key);
+  SilcBool ret;
+
+  silc_rwlock_rdlock(s->lock);
+  ret = silc_hash_table_find(s->table, key, ret_key, ret_context);
+  silc_rwlock_unlock(s->lock);
+
+  return ret;
+}
+
+/* Return entry count */
+
+SilcUInt32 silc_concurrent_hash_table_count(SilcConcurrentHashTable ht)
+{
+  SilcUInt32 i, count = 0;
+
+  for (i = 0; i < ht->num_stripes; i++) {
+    silc_rwlock_rdlock(ht->stripes[i].lock);
+    count += silc_hash_table_count(ht->stripes[i].table);
+    silc_rwlock_unlock(ht->stripes[i].lock);
+  }
+
+  return count;
+}
+
+/* Traverse all entries, one stripe at a time */
+
+void silc_concurrent_hash_table_foreach(SilcConcurrentHashTable ht,
+					SilcHashForeach foreach,
+					void *user_context)
+{
+  SilcUInt32 i;
+
+  if (!foreach)
+    return;
+
+  for (i = 0; i < ht->num_stripes; i++) {
+    silc_rwlock_rdlock(ht->stripes[i].lock);
+    silc_hash_table_foreach(ht->stripes[i].table, foreach, user_context);
+    silc_rwlock_unlock(ht->stripes[i].lock);
+  }
+}
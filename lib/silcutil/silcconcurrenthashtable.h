@@ -0,0 +1,209 @@
+/*
+
+  silcconcurrenthashtable.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Concurrent Hash Table Interface
+ *
+ * DESCRIPTION
+ *
+ * Thread-safe hash table for read-mostly registries shared between
+ * threads.  The table is divided into independently locked stripes; any
+ * number of readers proceed concurrently in a stripe and writers only
+ * contend with operations on the same stripe, so shared registries do
+ * not need a single table-wide mutex.  The same hash and comparison
+ * functions are used as with the normal SilcHashTable
+ * (silc_hash_string, silc_hash_ptr, etc.).
+ *
+ * The key and context lifetimes follow the same rules as with the
+ * SilcHashTable; the destructor is called with the table locked.
+ *
+ ***/
+
+#ifndef SILCCONCURRENTHASHTABLE_H
+#define SILCCONCURRENTHASHTABLE_H
+
+#include "silchashtable.h"
+
+/****s* silcutil/SilcConcurrentHashTable
+ *
+ * NAME
+ *
+ *    typedef struct SilcConcurrentHashTableStruct
+ *                     *SilcConcurrentHashTable;
+ *
+ * DESCRIPTION
+ *
+ *    The concurrent hash table context, allocated by
+ *    silc_concurrent_hash_table_alloc and freed by
+ *    silc_concurrent_hash_table_free.
+ *
+ ***/
+typedef struct SilcConcurrentHashTableStruct *SilcConcurrentHashTable;
+
+/****f* silcutil/silc_concurrent_hash_table_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcConcurrentHashTable
+ *    silc_concurrent_hash_table_alloc(SilcStack stack,
+ *                                     SilcUInt32 table_size,
+ *                                     SilcUInt32 num_stripes,
+ *                                     SilcHashFunction hash,
+ *                                     void *hash_user_context,
+ *                                     SilcHashCompare compare,
+ *                                     void *compare_user_context,
+ *                                     SilcHashDestructor destructor,
+ *                                     void *destructor_user_context);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates new concurrent hash table with `num_stripes' independently
+ *    locked stripes (zero selects a suitable default).  The other
+ *    arguments are as in silc_hash_table_alloc.  Returns NULL on error.
+ *
+ ***/
+SilcConcurrentHashTable
+silc_concurrent_hash_table_alloc(SilcStack stack,
+				 SilcUInt32 table_size,
+				 SilcUInt32 num_stripes,
+				 SilcHashFunction hash,
+				 void *hash_user_context,
+				 SilcHashCompare compare,
+				 void *compare_user_context,
+				 SilcHashDestructor destructor,
+				 void *destructor_user_context);
+
+/****f* silcutil/silc_concurrent_hash_table_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_concurrent_hash_table_free(SilcConcurrentHashTable ht);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the concurrent hash table, calling the destructor for all
+ *    entries.  The caller must guarantee no other thread accesses the
+ *    table anymore.
+ *
+ ***/
+void silc_concurrent_hash_table_free(SilcConcurrentHashTable ht);
+
+/****f* silcutil/silc_concurrent_hash_table_add
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_concurrent_hash_table_add(SilcConcurrentHashTable ht,
+ *                                            void *key, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Adds the `key' and `context' to the table.  Takes the stripe write
+ *    lock for the duration of the add.
+ *
+ ***/
+SilcBool silc_concurrent_hash_table_add(SilcConcurrentHashTable ht,
+					void *key, void *context);
+
+/****f* silcutil/silc_concurrent_hash_table_set
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_concurrent_hash_table_set(SilcConcurrentHashTable ht,
+ *                                            void *key, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_concurrent_hash_table_add but replaces an existing entry
+ *    with the same key, calling the destructor for the replaced entry.
+ *
+ ***/
+SilcBool silc_concurrent_hash_table_set(SilcConcurrentHashTable ht,
+					void *key, void *context);
+
+/****f* silcutil/silc_concurrent_hash_table_del
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_concurrent_hash_table_del(SilcConcurrentHashTable ht,
+ *                                            void *key);
+ *
+ * DESCRIPTION
+ *
+ *    Deletes the entry of `key', calling the destructor for it.  Takes
+ *    the stripe write lock for the duration of the delete.
+ *
+ ***/
+SilcBool silc_concurrent_hash_table_del(SilcConcurrentHashTable ht,
+					void *key);
+
+/****f* silcutil/silc_concurrent_hash_table_find
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_concurrent_hash_table_find(SilcConcurrentHashTable ht,
+ *                                             void *key, void **ret_key,
+ *                                             void **ret_context);
+ *
+ * DESCRIPTION
+ *
+ *    Finds the entry of `key'.  Only the stripe read lock is taken, so
+ *    any number of finders proceed concurrently.  Note that the returned
+ *    key and context are protected only as long as the application's own
+ *    lifetime rules guarantee them; a concurrent delete may free them
+ *    once this returns.
+ *
+ ***/
+SilcBool silc_concurrent_hash_table_find(SilcConcurrentHashTable ht,
+					 void *key, void **ret_key,
+					 void **ret_context);
+
+/****f* silcutil/silc_concurrent_hash_table_count
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32
+ *    silc_concurrent_hash_table_count(SilcConcurrentHashTable ht);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of entries in the table.
+ *
+ ***/
+SilcUInt32 silc_concurrent_hash_table_count(SilcConcurrentHashTable ht);
+
+/****f* silcutil/silc_concurrent_hash_table_foreach
+ *
+ * SYNOPSIS
+ *
+ *    void silc_concurrent_hash_table_foreach(SilcConcurrentHashTable ht,
+ *                                            SilcHashForeach foreach,
+ *                                            void *user_context);
+ *
+ * DESCRIPTION
+ *
+ *    Calls `foreach' for every entry in the table.  The stripes are
+ *    locked one at a time with the read lock, so writers to other
+ *    stripes proceed during the traversal.  The `foreach' must not
+ *    modify the table.
+ *
+ ***/
+void silc_concurrent_hash_table_foreach(SilcConcurrentHashTable ht,
+					SilcHashForeach foreach,
+					void *user_context);
+
+#endif /* SILCCONCURRENTHASHTABLE_H */
@@ -49,6 +49,7 @@ struct SilcConfigFileObject {
   SilcUInt32 len;	/* fixed length of the whole file */
   SilcUInt32 line;	/* current parsing line, strictly linked to p */
   SilcBool included;	/* wether this file is main or included */
+  FILE *record;		/* binary cache being recorded, or NULL */
 };
 
 /* We need the entity to base our block-style parsing on */
@@ -514,6 +515,7 @@ static int silc_config_main_internal(SilcConfigEntity ent)
       if (!inc_file) /* does it point a valid filename? */
         return SILC_CONFIG_ECANTOPEN;
       inc_file->included = TRUE;
+      inc_file->record = file->record;
 
       /* create a new entity and hack it to use the same options */
       inc_ent = silc_config_init(inc_file);
@@ -553,6 +555,8 @@ static int silc_config_main_internal(SilcConfigEntity ent)
       SilcConfigEntity sub_ent;
 
       SILC_CONFIG_DEBUG(("Entering sub-block"));
+      if (file->record)
+	fprintf(file->record, "B %s\n", thisopt->name);
       if (*(*p)++ != '{')
 	return SILC_CONFIG_EOPENBRACE;
       /* build the new entity for this sub-block */
@@ -580,12 +584,17 @@ static int silc_config_main_internal(SilcConfigEntity ent)
       /* Do we want ';' to be mandatory after close brace? */
       if (*(*p)++ != ';')
 	return SILC_CONFIG_EMISSCOLON;
+
+      if (file->record)
+	fprintf(file->record, "E\n");
     }
     else if (thisopt->type == SILC_CONFIG_ARG_NONE) {
       /* before getting on, check if this row is REALLY complete */
       if (*(*p)++ != ';')
 	return SILC_CONFIG_EMISSCOLON;
       SILC_CONFIG_DEBUG(("Triggering callback for none"));
+      if (file->record)
+	fprintf(file->record, "N %s\n", thisopt->name);
       if (thisopt->cb) {
 	thisopt->cb(thisopt->type, thisopt->name, file->line,
 		    NULL, thisopt->context);
@@ -605,6 +614,11 @@ static int silc_config_main_internal(SilcConfigEntity ent)
       if (*(*p)++ != ';')
 	return SILC_CONFIG_EMISSCOLON;
 
+      if (file->record)
+	fprintf(file->record, "O %lu %s %lu\n%s\n",
+		(unsigned long)file->line, thisopt->name,
+		(unsigned long)strlen(buf), buf);
+
       /* convert the option argument to the right format */
       pt = silc_config_marshall(thisopt->type, buf);
       if (!pt)
@@ -665,3 +679,165 @@ int silc_config_main(SilcConfigEntity ent)
  main_end:
   return ret;
 }
+
+/*************************** Binary config cache ****************************/
+
+/* Cache file magic line */
+#define SILC_CONFIG_CACHE_MAGIC "SRTCFGC1"
+
+/* Replays a recorded parse from `fp', calling the same callbacks the
+   text parse would.  Returns a SILC_CONFIG_* status. */
+
+static int silc_config_replay(SilcConfigEntity ent, FILE *fp)
+{
+  SilcConfigEntity stack[33];
+  SilcConfigOption *optstack[33];
+  SilcConfigOption *opt;
+  char line[BUF_SIZE + 64], name[BUF_SIZE], *val;
+  unsigned long lineno, val_len;
+  int level = 0, ret = SILC_CONFIG_OK;
+  void *pt;
+
+  stack[0] = ent;
+
+  while (fgets(line, sizeof(line), fp)) {
+    switch (line[0]) {
+    case 'B':
+      if (sscanf(line, "B %s", name) != 1)
+	return SILC_CONFIG_EGENERIC;
+      opt = silc_config_find_option(stack[level], name);
+      if (!opt || opt->type != SILC_CONFIG_ARG_BLOCK)
+	return SILC_CONFIG_EBADOPTION;
+      if (level >= 32)
+	return SILC_CONFIG_EGENERIC;
+      stack[level + 1] = silc_config_init(stack[level]->file);
+      if (!stack[level + 1])
+	return SILC_CONFIG_EGENERIC;
+      silc_config_register_table(stack[level + 1], opt->subtable,
+				 opt->context);
+      level++;
+      optstack[level] = opt;
+      break;
+
+    case 'E':
+      if (!level)
+	return SILC_CONFIG_EUNEXPECTED;
+      silc_config_destroy(stack[level], TRUE);
+      opt = optstack[level];
+      level--;
+      /* Block clean-up callback, as after a parsed sub-block */
+      if (opt->cb) {
+	ret = opt->cb(opt->type, opt->name, 0, NULL, opt->context);
+	if (ret)
+	  return ret;
+      }
+      break;
+
+    case 'N':
+      if (sscanf(line, "N %s", name) != 1)
+	return SILC_CONFIG_EGENERIC;
+      opt = silc_config_find_option(stack[level], name);
+      if (!opt)
+	return SILC_CONFIG_EBADOPTION;
+      if (opt->cb)
+	opt->cb(opt->type, opt->name, 0, NULL, opt->context);
+      break;
+
+    case 'O':
+      if (sscanf(line, "O %lu %s %lu", &lineno, name, &val_len) != 3)
+	return SILC_CONFIG_EGENERIC;
+      if (val_len >= BUF_SIZE)
+	return SILC_CONFIG_EGENERIC;
+      val = silc_malloc(val_len + 2);
+      if (!val)
+	return SILC_CONFIG_EGENERIC;
+      if (fread(val, 1, val_len + 1, fp) != val_len + 1) {
+	silc_free(val);
+	return SILC_CONFIG_EGENERIC;
+      }
+      val[val_len] = '\0';
+
+      opt = silc_config_find_option(stack[level], name);
+      if (!opt) {
+	silc_free(val);
+	return SILC_CONFIG_EBADOPTION;
+      }
+
+      pt = silc_config_marshall(opt->type, val);
+      silc_free(val);
+      if (!pt)
+	return SILC_CONFIG_EINVALIDTEXT;
+      ret = 0;
+      if (opt->cb)
+	ret = opt->cb(opt->type, opt->name, lineno, pt, opt->context);
+      silc_free(pt);
+      if (ret)
+	return ret;
+      break;
+
+    default:
+      return SILC_CONFIG_EGENERIC;
+    }
+  }
+
+  while (level > 0)
+    silc_config_destroy(stack[level--], TRUE);
+
+  return SILC_CONFIG_OK;
+}
+
+/* As silc_config_main but with a binary cache.  When `cache_filename'
+   exists and matches the source file's size and modification time, the
+   recorded parse is replayed through the registered tables without
+   re-tokenizing the text.  Otherwise the text is parsed normally and
+   the cache is written for the next load. */
+
+int silc_config_main_cached(SilcConfigEntity ent, const char *cache_filename)
+{
+  SilcConfigFile *file;
+  struct stat st;
+  FILE *fp;
+  char magic[16];
+  unsigned long csize = 0, cmtime = 0;
+  int ret;
+
+  if (!ent || !cache_filename)
+    return SILC_CONFIG_EGENERIC;
+
+  file = ent->file;
+
+  if (stat(file->filename, &st) < 0)
+    return SILC_CONFIG_ECANTOPEN;
+
+  /* Try the cache */
+  fp = fopen(cache_filename, "r");
+  if (fp) {
+    if (fscanf(fp, "%15s %lu %lu\n", magic, &csize, &cmtime) == 3 &&
+	!strcmp(magic, SILC_CONFIG_CACHE_MAGIC) &&
+	csize == (unsigned long)st.st_size &&
+	cmtime == (unsigned long)st.st_mtime) {
+      SILC_CONFIG_DEBUG(("Replaying config from cache %s", cache_filename));
+      ret = silc_config_replay(ent, fp);
+      fclose(fp);
+      silc_config_destroy(ent, TRUE);
+      return ret;
+    }
+    fclose(fp);
+  }
+
+  /* Parse the text and record the cache */
+  fp = fopen(cache_filename, "w");
+  if (fp)
+    fprintf(fp, "%s %lu %lu\n", SILC_CONFIG_CACHE_MAGIC,
+	    (unsigned long)st.st_size, (unsigned long)st.st_mtime);
+
+  file->record = fp;
+  ret = silc_config_main(ent);
+  if (fp) {
+    fclose(fp);
+    if (ret != SILC_CONFIG_OK)
+      unlink(cache_filename);
+  }
+
+  return ret;
+}
@@ -459,4 +459,26 @@ SilcBool silc_config_register_table(SilcConfigEntity ent,
  ***/
 int silc_config_main(SilcConfigEntity ent);
 
+/****f* silcutil/silc_config_main_cached
+ *
+ * SYNOPSIS
+ *
+ *    int silc_config_main_cached(SilcConfigEntity ent,
+ *                                const char *cache_filename);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_config_main but with a binary parse cache.  When
+ *    `cache_filename' exists and matches the configuration file's size
+ *    and modification time, the recorded parse result is replayed
+ *    through the registered tables and callbacks without re-tokenizing
+ *    the text, which makes reloading large generated configurations
+ *    close to I/O speed.  Otherwise the text is parsed normally and the
+ *    cache written for the next load.  The cache is invalidated
+ *    automatically when the configuration file changes.
+ *
+ ***/
+int silc_config_main_cached(SilcConfigEntity ent,
+			    const char *cache_filename);
+
 #endif	/* !SILCCONFIG_H */
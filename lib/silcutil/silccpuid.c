@@ -35,13 +35,35 @@ static void silc_cpuid(SilcUInt32 level, SilcUInt32 *ecx, SilcUInt32 *edx)
 
   SILC_LOG_DEBUG(("CPUID 0x%08x: ecx=0x%08x, edx=0x%08x", level, *ecx, *edx));
 }
+/* CPUID with EBX output, for the structured extended feature leaf */
+
+static void silc_cpuid_ebx(SilcUInt32 level, SilcUInt32 *ebx)
+{
+  asm volatile ("xorl %%ebx, %%ebx   \n"
+		"xorl %%ecx, %%ecx   \n"
+		"movl %1, %%eax      \n"
+		"cpuid               \n"
+		"movl %%ebx, %0      \n"
+		: "=m" (*ebx)
+		: "r" (level)
+		: "ebx", "eax", "ecx", "edx");
+}
 #endif /* SILC_I486 || SILC_X86_64 */
 
 SilcCPUIdFeatures silc_cpuid_features(void)
 {
+  static SilcCPUIdFeatures cached_id = SILC_CPUID_UNKNOWN;
+  static SilcBool cached = FALSE;
   SilcCPUIdFeatures id = SILC_CPUID_UNKNOWN;
 #if defined(SILC_I486) || defined(SILC_X86_64)
-  SilcUInt32 ecx = 0, edx = 0;
+  SilcUInt32 ecx = 0, edx = 0, ebx = 0;
+#endif /* SILC_I486 || SILC_X86_64 */
+
+  /* The feature set is detected once */
+  if (cached)
+    return cached_id;
+
+#if defined(SILC_I486) || defined(SILC_X86_64)
 
   /* Basic level */
   silc_cpuid(1, &ecx, &edx);
@@ -88,7 +110,7 @@ SilcCPUIdFeatures silc_cpuid_features(void)
 
   if (ecx & (1 << 20)) {
     SILC_LOG_DEBUG(("SSE4.2"));
-    id |= SILC_CPUID_SSE41;
+    id |= SILC_CPUID_SSE42;
   }
 
   if (ecx & (1 << 28)) {
@@ -101,6 +123,25 @@ SilcCPUIdFeatures silc_cpuid_features(void)
     id |= SILC_CPUID_AES;
   }
 
+  /* Structured extended features */
+  silc_cpuid_ebx(7, &ebx);
+  if (ebx & (1 << 5)) {
+    SILC_LOG_DEBUG(("AVX2"));
+    id |= SILC_CPUID_AVX2;
+  }
+  if (ebx & (1 << 8)) {
+    SILC_LOG_DEBUG(("BMI2"));
+    id |= SILC_CPUID_BMI2;
+  }
+  if (ebx & (1 << 16)) {
+    SILC_LOG_DEBUG(("AVX-512F"));
+    id |= SILC_CPUID_AVX512F;
+  }
+  if (ebx & (1 << 30)) {
+    SILC_LOG_DEBUG(("AVX-512BW"));
+    id |= SILC_CPUID_AVX512BW;
+  }
+
   /* Extended level */
   ecx = edx = 0;
   silc_cpuid(0x80000001, &ecx, &edx);
@@ -119,5 +160,68 @@ SilcCPUIdFeatures silc_cpuid_features(void)
 
  out:
 #endif /* SILC_I486 || SILC_X86_64 */
+
+#if defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+  SILC_LOG_DEBUG(("NEON"));
+  id |= SILC_CPUID_NEON;
+#endif /* __aarch64__ || __ARM_NEON */
+#if defined(__ARM_FEATURE_SVE)
+  SILC_LOG_DEBUG(("SVE"));
+  id |= SILC_CPUID_SVE;
+#endif /* __ARM_FEATURE_SVE */
+#if defined(__ARM_FEATURE_CRC32)
+  SILC_LOG_DEBUG(("CRC32"));
+  id |= SILC_CPUID_CRC32;
+#endif /* __ARM_FEATURE_CRC32 */
+
+  cached_id = id;
+  cached = TRUE;
+
   return id;
 }
+
+/* Return processor cache line size */
+
+SilcUInt32 silc_cpuid_cache_line(void)
+{
+  long line = 0;
+
+#if defined(_SC_LEVEL1_DCACHE_LINESIZE)
+  line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+#endif /* _SC_LEVEL1_DCACHE_LINESIZE */
+
+  return line > 0 ? (SilcUInt32)line : 64;
+}
+
+/* Return cache sizes */
+
+void silc_cpuid_cache_sizes(SilcUInt32 *ret_l1, SilcUInt32 *ret_l2,
+			    SilcUInt32 *ret_l3)
+{
+  long v;
+
+  if (ret_l1) {
+    *ret_l1 = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+    v = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    if (v > 0)
+      *ret_l1 = (SilcUInt32)v;
+#endif /* _SC_LEVEL1_DCACHE_SIZE */
+  }
+  if (ret_l2) {
+    *ret_l2 = 0;
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    v = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (v > 0)
+      *ret_l2 = (SilcUInt32)v;
+#endif /* _SC_LEVEL2_CACHE_SIZE */
+  }
+  if (ret_l3) {
+    *ret_l3 = 0;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    v = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (v > 0)
+      *ret_l3 = (SilcUInt32)v;
+#endif /* _SC_LEVEL3_CACHE_SIZE */
+  }
+}
@@ -46,6 +46,13 @@ typedef enum {
   SILC_CPUID_SSE5        = 0x00000800,		 /* SSE5 */
   SILC_CPUID_AVX         = 0x00001000,		 /* AVX */
   SILC_CPUID_AES         = 0x00002000,		 /* AES */
+  SILC_CPUID_AVX2        = 0x00004000,		 /* AVX2 */
+  SILC_CPUID_AVX512F     = 0x00008000,		 /* AVX-512 Foundation */
+  SILC_CPUID_AVX512BW    = 0x00010000,		 /* AVX-512 Byte and Word */
+  SILC_CPUID_BMI2        = 0x00020000,		 /* BMI2 */
+  SILC_CPUID_NEON        = 0x00040000,		 /* ARM NEON/ASIMD */
+  SILC_CPUID_SVE         = 0x00080000,		 /* ARM SVE */
+  SILC_CPUID_CRC32       = 0x00100000,		 /* ARM CRC32 extension */
 } SilcCPUIdFeatures;
 /***/
 
@@ -72,4 +79,87 @@ typedef enum {
  ***/
 SilcCPUIdFeatures silc_cpuid_features(void);
 
+/****f* silcutil/silc_cpuid_cache_line
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_cpuid_cache_line(void);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the processor cache line size in bytes, or 64 if it cannot
+ *    be determined.
+ *
+ ***/
+SilcUInt32 silc_cpuid_cache_line(void);
+
+/****f* silcutil/silc_cpuid_cache_sizes
+ *
+ * SYNOPSIS
+ *
+ *    void silc_cpuid_cache_sizes(SilcUInt32 *ret_l1, SilcUInt32 *ret_l2,
+ *                                SilcUInt32 *ret_l3);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the L1 data, L2 and L3 cache sizes in bytes, or zero for
+ *    the levels that cannot be determined on the platform.
+ *
+ ***/
+void silc_cpuid_cache_sizes(SilcUInt32 *ret_l1, SilcUInt32 *ret_l2,
+			    SilcUInt32 *ret_l3);
+
+/****d* silcutil/SILC_MULTIVERSION
+ *
+ * NAME
+ *
+ *    #define SILC_MULTIVERSION(type, name) ...
+ *    #define SILC_MV(name) ...
+ *
+ * DESCRIPTION
+ *
+ *    Runtime dispatch for functions with several ISA-specific
+ *    implementations.  SILC_MULTIVERSION declares a dispatcher for a
+ *    function pointer of `type' named `name'; the kernel provides a
+ *    static `name_resolve' function that inspects
+ *    silc_cpuid_features and returns the best implementation.  The
+ *    resolver runs once on first call and the chosen implementation
+ *    is cached.  SILC_MV(name) returns the implementation to call.
+ *
+ *    ISA-specific variants live in their own translation units
+ *    compiled with the per-ISA flags from Makefile.defines.in
+ *    (SILC_AVX2_CFLAGS and friends), so the library's baseline ISA is
+ *    unchanged and the variants are selected only on processors that
+ *    have the features.
+ *
+ * EXAMPLE
+ *
+ *    typedef SilcUInt32 (*SilcFooFn)(const unsigned char *, SilcUInt32);
+ *    SILC_MULTIVERSION(SilcFooFn, silc_foo)
+ *
+ *    static SilcFooFn silc_foo_resolve(void)
+ *    {
+ *      if (silc_cpuid_features() & SILC_CPUID_AVX2)
+ *        return silc_foo_avx2;      // from foo_avx2.c, built with
+ *      return silc_foo_c;           // SILC_AVX2_CFLAGS
+ *    }
+ *
+ *    len = SILC_MV(silc_foo)(data, data_len);
+ *
+ * SOURCE
+ */
+#define SILC_MULTIVERSION(type, name)					\
+static type name##_resolve(void);					\
+static type name##_fnptr;						\
+static type name##_dispatch(void)					\
+{									\
+  type fn = name##_fnptr;						\
+  if (silc_unlikely(!fn))						\
+    fn = name##_fnptr = name##_resolve();				\
+  return fn;								\
+}
+
+#define SILC_MV(name) (name##_dispatch())
+/***/
+
 #endif /* SILCCPUID_H */
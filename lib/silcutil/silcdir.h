@@ -160,4 +160,66 @@ const char *silc_dir_name(SilcDir dir);
  ***/
 const char *silc_dir_entry_name(SilcDirEntry entry);
 
+/****d* silcutil/SilcDirEntryType
+ *
+ * NAME
+ *
+ *    typedef enum { ... } SilcDirEntryType;
+ *
+ * DESCRIPTION
+ *
+ *    File type of a bulk scanned directory entry, when the file system
+ *    provides it without a separate stat.
+ *
+ * SOURCE
+ */
+typedef enum {
+  SILC_DIR_ENTRY_UNKNOWN  = 0,	     /* Type not known without stat */
+  SILC_DIR_ENTRY_FILE     = 1,	     /* Regular file */
+  SILC_DIR_ENTRY_DIR      = 2,	     /* Directory */
+  SILC_DIR_ENTRY_SYMLINK  = 3,	     /* Symbolic link */
+  SILC_DIR_ENTRY_OTHER    = 4,	     /* Device, socket, fifo, etc. */
+} SilcDirEntryType;
+/***/
+
+/****s* silcutil/SilcDirBulkEntry
+ *
+ * NAME
+ *
+ *    typedef struct SilcDirBulkEntryStruct SilcDirBulkEntry;
+ *
+ * DESCRIPTION
+ *
+ *    One entry returned by silc_dir_read_bulk.
+ *
+ * SOURCE
+ */
+typedef struct SilcDirBulkEntryStruct {
+  char name[256];		     /* Entry name */
+  SilcUInt64 ino;		     /* Inode number */
+  SilcDirEntryType type;	     /* File type, if known */
+} SilcDirBulkEntry;
+/***/
+
+/****f* silcutil/silc_dir_read_bulk
+ *
+ * SYNOPSIS
+ *
+ *    int silc_dir_read_bulk(SilcDir dir, SilcDirBulkEntry *entries,
+ *                           SilcUInt32 num_entries);
+ *
+ * DESCRIPTION
+ *
+ *    Reads up to `num_entries' directory entries in one pass to the
+ *    array `entries', with the file type filled from the directory
+ *    stream when the file system provides it, so most scans avoid a
+ *    stat per entry.  On Linux the entries are read with batched
+ *    getdents64 calls.  Returns the number of entries read, 0 at the
+ *    end of the directory, or -1 on error.  Do not mix with
+ *    silc_dir_read on the same context.
+ *
+ ***/
+int silc_dir_read_bulk(SilcDir dir, SilcDirBulkEntry *entries,
+		       SilcUInt32 num_entries);
+
 #endif /* SILCDIR_H */
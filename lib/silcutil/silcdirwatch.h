@@ -0,0 +1,125 @@
+/*
+
+  silcdirwatch.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Directory Watch Interface
+ *
+ * DESCRIPTION
+ *
+ * Event-driven directory change notification.  Instead of rescanning a
+ * directory on a timer, a watch delivers file creation, deletion and
+ * modification events through a callback as they happen, using the
+ * platform's change notification facility (inotify on Linux, kqueue on
+ * BSD) and falling back to a periodic scan where neither exists.  The
+ * callback runs in the watched schedule's thread.
+ *
+ ***/
+
+#ifndef SILCDIRWATCH_H
+#define SILCDIRWATCH_H
+
+/****s* silcutil/SilcDirWatch
+ *
+ * NAME
+ *
+ *    typedef struct SilcDirWatchStruct *SilcDirWatch;
+ *
+ * DESCRIPTION
+ *
+ *    The directory watch context returned by silc_dir_watch_start.
+ *
+ ***/
+typedef struct SilcDirWatchStruct *SilcDirWatch;
+
+/****d* silcutil/SilcDirWatchEvent
+ *
+ * NAME
+ *
+ *    typedef enum { ... } SilcDirWatchEvent;
+ *
+ * DESCRIPTION
+ *
+ *    Directory change event types delivered to the watch callback.
+ *
+ * SOURCE
+ */
+typedef enum {
+  SILC_DIR_WATCH_CREATE,	       /* File appeared in the directory */
+  SILC_DIR_WATCH_DELETE,	       /* File disappeared */
+  SILC_DIR_WATCH_MODIFY,	       /* File contents changed */
+} SilcDirWatchEvent;
+/***/
+
+/****f* silcutil/SilcDirWatchCallback
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcDirWatchCallback)(SilcDirWatch watch,
+ *                                         SilcDirWatchEvent event,
+ *                                         const char *name,
+ *                                         void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Called for each change in the watched directory.  `name' is the
+ *    file name relative to the watched directory and is valid only for
+ *    the duration of the call.
+ *
+ ***/
+typedef void (*SilcDirWatchCallback)(SilcDirWatch watch,
+				     SilcDirWatchEvent event,
+				     const char *name, void *context);
+
+/****f* silcutil/silc_dir_watch_start
+ *
+ * SYNOPSIS
+ *
+ *    SilcDirWatch silc_dir_watch_start(const char *dir,
+ *                                      SilcSchedule schedule,
+ *                                      SilcDirWatchCallback callback,
+ *                                      void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Starts watching the directory `dir' and delivering change events
+ *    to `callback'.  If `schedule' is NULL the global scheduler is
+ *    used.  Returns NULL on error.  On platforms without a change
+ *    notification facility the directory is scanned once a second and
+ *    events are synthesized from the differences; with kqueue the scan
+ *    runs only when the kernel reports the directory changed.
+ *
+ ***/
+SilcDirWatch silc_dir_watch_start(const char *dir, SilcSchedule schedule,
+				  SilcDirWatchCallback callback,
+				  void *context);
+
+/****f* silcutil/silc_dir_watch_stop
+ *
+ * SYNOPSIS
+ *
+ *    void silc_dir_watch_stop(SilcDirWatch watch);
+ *
+ * DESCRIPTION
+ *
+ *    Stops the watch and frees the context.  No events are delivered
+ *    after this returns.
+ *
+ ***/
+void silc_dir_watch_stop(SilcDirWatch watch);
+
+#endif /* SILCDIRWATCH_H */
@@ -71,6 +71,9 @@ typedef struct SilcDListObject {
   SilcList list;
   void *current;
   void *prev;
+  struct SilcDListEntryStruct *ientry; /* Inline entry storage */
+  SilcUInt16 inline_count;	       /* Number of inline entries */
+  SilcUInt16 inline_used;	       /* Bitmap of used inline entries */
 } *SilcDList, SilcDListStruct;
 
 /* SilcDListEntry structure, one entry in the list. This MUST NOT be used
@@ -104,6 +107,8 @@ SilcDList silc_dlist_init(void)
   if (!list)
     return NULL;
   list->stack = list->current = list->prev = NULL;
+  list->ientry = NULL;
+  list->inline_count = list->inline_used = 0;
   silc_list_init_prev(list->list, struct SilcDListEntryStruct, next, prev);
 
   return list;
@@ -138,6 +143,8 @@ SilcDList silc_dlist_sinit(SilcStack stack)
   }
   list->stack = stack;
   list->current = list->prev = NULL;
+  list->ientry = NULL;
+  list->inline_count = list->inline_used = 0;
   silc_list_init_prev(list->list, struct SilcDListEntryStruct, next, prev);
 
   return list;
@@ -160,9 +167,104 @@ static inline
 void silc_dlist_init_static(SilcDList list)
 {
   list->stack = list->current = list->prev = NULL;
+  list->ientry = NULL;
+  list->inline_count = list->inline_used = 0;
   silc_list_init_prev(list->list, struct SilcDListEntryStruct, next, prev);
 }
 
+/****d* silcutil/SILC_DLIST_SMALL_SIZE
+ *
+ * NAME
+ *
+ *    #define SILC_DLIST_SMALL_SIZE 4
+ *
+ * DESCRIPTION
+ *
+ *    Number of inline entries in a small SilcDList (see
+ *    silc_dlist_init_small).
+ *
+ * SOURCE
+ */
+#define SILC_DLIST_SMALL_SIZE 4
+/***/
+
+/****s* silcutil/SilcSDListStruct
+ *
+ * NAME
+ *
+ *    typedef struct SilcSDListObject SilcSDListStruct;
+ *
+ * DESCRIPTION
+ *
+ *    A SilcDList with storage for SILC_DLIST_SMALL_SIZE entries embedded
+ *    in the list context itself.  Initialized with the
+ *    silc_dlist_init_small.
+ *
+ ***/
+typedef struct SilcSDListObject {
+  SilcDListStruct dlist;
+  struct SilcDListEntryStruct entry[SILC_DLIST_SMALL_SIZE];
+} SilcSDListStruct;
+
+/****f* silcutil/silc_dlist_init_small
+ *
+ * SYNOPSIS
+ *
+ *    static inline
+ *    SilcDList silc_dlist_init_small(SilcSDListStruct *list);
+ *
+ * DESCRIPTION
+ *
+ *    Initializes a small list with SILC_DLIST_SMALL_SIZE entries stored
+ *    inline in the pre-allocated `list' itself; the common case of a
+ *    list holding only a few entries performs no memory allocations at
+ *    all, and only entries beyond the inline capacity are allocated.
+ *    Returns the SilcDList context used with the normal silc_dlist_*
+ *    API.  The list is uninitialized with the silc_dlist_uninit_static;
+ *    silc_dlist_uninit must not be used as the context is not allocated.
+ *
+ ***/
+static inline
+SilcDList silc_dlist_init_small(SilcSDListStruct *list)
+{
+  silc_dlist_init_static(&list->dlist);
+  list->dlist.ientry = list->entry;
+  list->dlist.inline_count = SILC_DLIST_SMALL_SIZE;
+
+  return &list->dlist;
+}
+
+/* Allocates a list entry, using free inline storage when available */
+
+static inline
+SilcDListEntry silc_dlist_entry_alloc(SilcDList list)
+{
+  SilcUInt32 i;
+
+  for (i = 0; i < list->inline_count; i++)
+    if (!(list->inline_used & (1 << i))) {
+      list->inline_used |= (1 << i);
+      return &list->ientry[i];
+    }
+
+  return (SilcDListEntry)silc_smalloc(list->stack,
+				      sizeof(struct SilcDListEntryStruct));
+}
+
+/* Frees a list entry, returning inline storage to the list */
+
+static inline
+void silc_dlist_entry_free(SilcDList list, SilcDListEntry e)
+{
+  if (list->ientry && e >= list->ientry &&
+      e < list->ientry + list->inline_count) {
+    list->inline_used &= ~(1 << (SilcUInt32)(e - list->ientry));
+    return;
+  }
+
+  silc_sfree(list->stack, e);
+}
+
 /****f* silcutil/silc_dlist_uninit
  *
  * SYNOPSIS
@@ -188,7 +290,7 @@ void silc_dlist_uninit(SilcDList list)
     silc_list_start(list->list);
     while ((e = (SilcDListEntry)silc_list_get(list->list)) != SILC_LIST_END) {
       silc_list_del(list->list, e);
-      silc_sfree(stack, e);
+      silc_dlist_entry_free(list, e);
     }
     silc_sfree(stack, list);
     silc_stack_free(stack);
@@ -218,7 +320,7 @@ void silc_dlist_uninit_static(SilcDList list)
     silc_list_start(list->list);
     while ((e = (SilcDListEntry)silc_list_get(list->list)) != SILC_LIST_END) {
       silc_list_del(list->list, e);
-      silc_free(e);
+      silc_dlist_entry_free(list, e);
     }
   }
 }
@@ -301,7 +403,7 @@ void silc_dlist_end(SilcDList list)
 static inline
 SilcBool silc_dlist_add(SilcDList list, void *context)
 {
-  SilcDListEntry e = (SilcDListEntry)silc_smalloc(list->stack, sizeof(*e));
+  SilcDListEntry e = silc_dlist_entry_alloc(list);
   if (silc_unlikely(!e))
     return FALSE;
   e->context = context;
@@ -327,7 +429,7 @@ SilcBool silc_dlist_add(SilcDList list, void *context)
 static inline
 SilcBool silc_dlist_insert(SilcDList list, void *context)
 {
-  SilcDListEntry e = (SilcDListEntry)silc_smalloc(list->stack, sizeof(*e));
+  SilcDListEntry e = silc_dlist_entry_alloc(list);
   if (silc_unlikely(!e))
     return FALSE;
   e->context = context;
@@ -364,7 +466,7 @@ void silc_dlist_del(SilcDList list, void *entry)
 	list->current = NULL;
       if (list->prev == e)
 	list->prev = NULL;
-      silc_sfree(list->stack, e);
+      silc_dlist_entry_free(list, e);
       break;
     }
   }
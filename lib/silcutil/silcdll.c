@@ -19,6 +19,67 @@
 
 #include "silcruntime.h"
 
+/* Cache of resolved symbols, one symbol table per loaded object */
+static SilcHashTable silc_dll_cache = NULL;
+static SilcMutex silc_dll_cache_lock = NULL;
+
+/* Symbol table entry destructor */
+
+static void silc_dll_sym_destructor(void *key, void *context,
+				    void *user_context)
+{
+  silc_free(key);
+}
+
+/* Object entry destructor */
+
+static void silc_dll_obj_destructor(void *key, void *context,
+				    void *user_context)
+{
+  silc_hash_table_free(context);
+}
+
+/* Returns the symbol table of `dll', creating it if wanted */
+
+static SilcHashTable silc_dll_symbols(SilcDll dll, SilcBool create)
+{
+  SilcHashTable syms = NULL;
+
+  if (!silc_dll_cache_lock)
+    if (!silc_mutex_alloc(&silc_dll_cache_lock))
+      return NULL;
+
+  silc_mutex_lock(silc_dll_cache_lock);
+
+  if (!silc_dll_cache) {
+    if (!create) {
+      silc_mutex_unlock(silc_dll_cache_lock);
+      return NULL;
+    }
+    silc_dll_cache = silc_hash_table_alloc(NULL, 0, silc_hash_ptr, NULL,
+					   NULL, NULL,
+					   silc_dll_obj_destructor, NULL,
+					   TRUE);
+    if (!silc_dll_cache) {
+      silc_mutex_unlock(silc_dll_cache_lock);
+      return NULL;
+    }
+  }
+
+  if (!silc_hash_table_find(silc_dll_cache, dll, NULL, (void *)&syms) &&
+      create) {
+    syms = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+				 silc_hash_string_compare, NULL,
+				 silc_dll_sym_destructor, NULL, TRUE);
+    if (syms)
+      silc_hash_table_add(silc_dll_cache, dll, syms);
+  }
+
+  silc_mutex_unlock(silc_dll_cache_lock);
+
+  return syms;
+}
+
 /* Load shared object */
 
 SilcDll silc_dll_load(const char *object_path)
@@ -47,6 +108,14 @@ SilcDll silc_dll_load(const char *object_path)
 
 void silc_dll_close(SilcDll dll)
 {
+  /* Invalidate cached symbols */
+  if (silc_dll_cache_lock) {
+    silc_mutex_lock(silc_dll_cache_lock);
+    if (silc_dll_cache)
+      silc_hash_table_del(silc_dll_cache, dll);
+    silc_mutex_unlock(silc_dll_cache_lock);
+  }
+
 #ifdef SILC_UNIX
 #if defined(HAVE_DLOPEN)
   dlclose(dll);
@@ -58,9 +127,9 @@ void silc_dll_close(SilcDll dll)
 #endif /* SILC_UNIX */
 }
 
-/* Get symbol address from shared object */
+/* Resolve symbol address from shared object, uncached */
 
-void *silc_dll_getsym(SilcDll dll, const char *symbol)
+static void *silc_dll_getsym_raw(SilcDll dll, const char *symbol)
 {
 #ifdef SILC_UNIX
 #if defined(HAVE_DLOPEN)
@@ -76,6 +145,49 @@ void *silc_dll_getsym(SilcDll dll, const char *symbol)
   return NULL;
 }
 
+/* Get symbol address from shared object */
+
+void *silc_dll_getsym(SilcDll dll, const char *symbol)
+{
+  SilcHashTable syms;
+  void *addr;
+
+  /* Serve repeated lookups from the cache */
+  syms = silc_dll_symbols(dll, TRUE);
+  if (syms) {
+    silc_mutex_lock(silc_dll_cache_lock);
+    if (silc_hash_table_find(syms, (void *)symbol, NULL, &addr)) {
+      silc_mutex_unlock(silc_dll_cache_lock);
+      return addr;
+    }
+    silc_mutex_unlock(silc_dll_cache_lock);
+  }
+
+  addr = silc_dll_getsym_raw(dll, symbol);
+
+  if (addr && syms) {
+    silc_mutex_lock(silc_dll_cache_lock);
+    silc_hash_table_set(syms, silc_strdup(symbol), addr);
+    silc_mutex_unlock(silc_dll_cache_lock);
+  }
+
+  return addr;
+}
+
+/* Resolve a list of symbols up front */
+
+SilcUInt32 silc_dll_prefetch(SilcDll dll, const char **symbols,
+			     SilcUInt32 num_symbols)
+{
+  SilcUInt32 i, n = 0;
+
+  for (i = 0; i < num_symbols; i++)
+    if (silc_dll_getsym(dll, symbols[i]))
+      n++;
+
+  return n;
+}
+
 /* Get error string */
 
 const char *silc_dll_error(SilcDll dll)
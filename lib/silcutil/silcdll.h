@@ -125,4 +125,23 @@ void *silc_dll_getsym(SilcDll dll, const char *symbol);
  ***/
 const char *silc_dll_error(SilcDll dll);
 
+/****f* silcutil/silc_dll_prefetch
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_dll_prefetch(SilcDll dll, const char **symbols,
+ *                                 SilcUInt32 num_symbols);
+ *
+ * DESCRIPTION
+ *
+ *    Resolves the listed symbols from the shared object up front into
+ *    the per-object symbol cache, so later silc_dll_getsym calls for
+ *    them are hash lookups instead of dlsym calls.  Returns the number
+ *    of symbols that resolved.  The cache is invalidated by
+ *    silc_dll_close.
+ *
+ ***/
+SilcUInt32 silc_dll_prefetch(SilcDll dll, const char **symbols,
+			     SilcUInt32 num_symbols);
+
 #endif /* SILCDLL_H */
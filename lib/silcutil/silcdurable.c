@@ -0,0 +1,402 @@
+/*
+
+  silcdurable.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Default batch window, milliseconds */
+#define SILC_DURABLE_WINDOW 5
+
+/* Direct I/O block size and buffer alignment */
+#define SILC_DURABLE_BLOCK 4096
+
+/* Pending completion */
+typedef struct SilcDurableCompletionStruct {
+  struct SilcDurableCompletionStruct *next;
+  SilcTaskCallback completion;
+  void *context;
+} *SilcDurableCompletion;
+
+/* Durable writer context */
+struct SilcDurableWriterStruct {
+  SilcMutex lock;
+  SilcCond signal;
+  SilcThread thread;		       /* Writer thread */
+  SilcSchedule schedule;	       /* Completion delivery scheduler */
+  SilcBuffer batch;		       /* Accumulating batch */
+  SilcDurableCompletion completions;   /* Batch completions, LIFO */
+  SilcDurableCompletion free_comps;    /* Completion freelist */
+  SilcUInt64 synced_len;	       /* Durable file length */
+  SilcUInt32 window_ms;		       /* Batch window */
+  int fd;			       /* The file */
+  unsigned char tail[SILC_DURABLE_BLOCK]; /* Partial last block (direct) */
+  SilcUInt32 tail_len;		       /* Bytes in tail */
+  unsigned int direct   : 1;	       /* O_DIRECT in use */
+  unsigned int flush_now : 1;	       /* Flush without waiting window */
+  unsigned int shutdown : 1;	       /* Writer is being destroyed */
+};
+
+/************************ Static utility functions **************************/
+
+/* Syncs the file data durably to disk */
+
+static void silc_durable_sync(SilcDurableWriter w)
+{
+#if defined(SILC_WIN32)
+  _commit(w->fd);
+#elif defined(HAVE_FDATASYNC)
+  fdatasync(w->fd);
+#else
+  fsync(w->fd);
+#endif
+}
+
+/* Writes one batch durably.  Called from the writer thread without the
+   lock; `data'/`data_len' is the batch payload. */
+
+static void silc_durable_write_batch(SilcDurableWriter w,
+				     const unsigned char *data,
+				     SilcUInt32 data_len)
+{
+  if (!w->direct) {
+    SilcUInt32 off = 0;
+    int ret;
+
+    while (off < data_len) {
+      ret = write(w->fd, data + off, data_len - off);
+      if (ret <= 0) {
+	if (errno == EINTR)
+	  continue;
+	SILC_LOG_ERROR(("Durable writer %p write error: %s", w,
+			silc_errno_string(silc_errno)));
+	break;
+      }
+      off += ret;
+    }
+  } else {
+    /* Direct I/O: write from the last block boundary, carrying the
+       previous partial block in front of the new data, in one aligned
+       buffer. */
+    SilcUInt64 start = w->synced_len - w->tail_len;
+    SilcUInt32 total = w->tail_len + data_len;
+    SilcUInt32 blocks = (total + SILC_DURABLE_BLOCK - 1) /
+      SILC_DURABLE_BLOCK;
+    unsigned char *buf;
+    SilcUInt32 off = 0;
+    int ret;
+
+    buf = silc_malloc_aligned(blocks * SILC_DURABLE_BLOCK,
+			      SILC_DURABLE_BLOCK);
+    if (!buf)
+      return;
+
+    memset(buf, 0, blocks * SILC_DURABLE_BLOCK);
+    memcpy(buf, w->tail, w->tail_len);
+    memcpy(buf + w->tail_len, data, data_len);
+
+    while (off < blocks * SILC_DURABLE_BLOCK) {
+      ret = pwrite(w->fd, buf + off, blocks * SILC_DURABLE_BLOCK - off,
+		   (off_t)(start + off));
+      if (ret <= 0) {
+	if (errno == EINTR)
+	  continue;
+	SILC_LOG_ERROR(("Durable writer %p write error: %s", w,
+			silc_errno_string(silc_errno)));
+	break;
+      }
+      off += ret;
+    }
+
+    /* Remember the new partial last block */
+    w->tail_len = total % SILC_DURABLE_BLOCK;
+    memcpy(w->tail, buf + (total - w->tail_len), w->tail_len);
+
+    silc_free_aligned(buf);
+  }
+
+  silc_durable_sync(w);
+  w->synced_len += data_len;
+}
+
+/* Delivers a batch's completions through the scheduler */
+
+static void silc_durable_complete(SilcDurableWriter w,
+				  SilcDurableCompletion comps)
+{
+  SilcDurableCompletion c, next;
+
+  for (c = comps; c; c = next) {
+    next = c->next;
+    if (c->completion) {
+      silc_schedule_task_add_timeout(w->schedule, c->completion,
+				     c->context, 0, 0);
+      silc_schedule_wakeup(w->schedule);
+    }
+
+    /* Recycle */
+    silc_mutex_lock(w->lock);
+    c->next = w->free_comps;
+    w->free_comps = c;
+    silc_mutex_unlock(w->lock);
+  }
+}
+
+/* The writer thread; collects a batch for the window, then writes and
+   syncs it once for all writes in it. */
+
+static void *silc_durable_thread(void *context)
+{
+  SilcDurableWriter w = context;
+  SilcDurableCompletion comps, c, prev;
+  SilcBuffer batch;
+
+  silc_mutex_lock(w->lock);
+
+  while (1) {
+    /* Wait for work */
+    while (!w->shutdown && !silc_buffer_len(w->batch))
+      silc_cond_wait(w->signal, w->lock);
+
+    if (!silc_buffer_len(w->batch) && w->shutdown)
+      break;
+
+    /* Group commit: let more writes join the batch for the window */
+    if (!w->flush_now && !w->shutdown && w->window_ms)
+      silc_cond_timedwait(w->signal, w->lock, w->window_ms);
+    w->flush_now = FALSE;
+
+    /* Take the batch */
+    batch = w->batch;
+    w->batch = silc_buffer_alloc(0);
+    comps = w->completions;
+    w->completions = NULL;
+
+    silc_mutex_unlock(w->lock);
+
+    /* Completions were collected LIFO; reverse to write order */
+    prev = NULL;
+    while (comps) {
+      c = comps->next;
+      comps->next = prev;
+      prev = comps;
+      comps = c;
+    }
+
+    if (batch) {
+      silc_durable_write_batch(w, silc_buffer_data(batch),
+			       silc_buffer_len(batch));
+      silc_buffer_free(batch);
+    }
+    silc_durable_complete(w, prev);
+
+    silc_mutex_lock(w->lock);
+  }
+
+  silc_mutex_unlock(w->lock);
+  return NULL;
+}
+
+/****************************** Public API **********************************/
+
+/* Create durable writer */
+
+SilcDurableWriter silc_durable_writer_create(const char *filename,
+					     SilcSchedule schedule,
+					     SilcUInt32 batch_window_ms,
+					     SilcBool direct_io)
+{
+  SilcDurableWriter w;
+  int flags = O_WRONLY | O_CREAT;
+
+  if (!filename) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return NULL;
+    }
+  }
+
+  w = silc_calloc(1, sizeof(*w));
+  if (!w)
+    return NULL;
+
+  w->fd = -1;
+#ifdef O_DIRECT
+  if (direct_io) {
+    w->fd = silc_file_open_mode(filename, flags | O_DIRECT, 0600);
+    if (w->fd >= 0)
+      w->direct = TRUE;
+  }
+#endif /* O_DIRECT */
+  if (w->fd < 0)
+    w->fd = silc_file_open_mode(filename, flags | (direct_io ? 0 : O_APPEND),
+				0600);
+  if (w->fd < 0) {
+    silc_free(w);
+    return NULL;
+  }
+
+  /* Append starts at the current end of file */
+  w->synced_len = (SilcUInt64)lseek(w->fd, 0, SEEK_END);
+
+  if (w->direct) {
+    /* Read back the partial last block so the first direct write can
+       rewrite it whole */
+    w->tail_len = (SilcUInt32)(w->synced_len % SILC_DURABLE_BLOCK);
+    if (w->tail_len &&
+	pread(w->fd, w->tail, w->tail_len,
+	      (off_t)(w->synced_len - w->tail_len)) != (int)w->tail_len) {
+      close(w->fd);
+      silc_free(w);
+      return NULL;
+    }
+  }
+
+  w->schedule = schedule;
+  w->window_ms = batch_window_ms ? batch_window_ms : SILC_DURABLE_WINDOW;
+  w->batch = silc_buffer_alloc(0);
+
+  if (!w->batch || !silc_mutex_alloc(&w->lock) ||
+      !silc_cond_alloc(&w->signal)) {
+    silc_buffer_free(w->batch);
+    close(w->fd);
+    silc_free(w);
+    return NULL;
+  }
+
+  w->thread = silc_thread_create(silc_durable_thread, w, TRUE);
+  if (!w->thread) {
+    silc_cond_free(w->signal);
+    silc_mutex_free(w->lock);
+    silc_buffer_free(w->batch);
+    close(w->fd);
+    silc_free(w);
+    return NULL;
+  }
+
+  SILC_LOG_DEBUG(("Created durable writer %p to %s%s", w, filename,
+		  w->direct ? " (direct I/O)" : ""));
+
+  return w;
+}
+
+/* Destroy durable writer */
+
+void silc_durable_writer_destroy(SilcDurableWriter writer)
+{
+  SilcDurableCompletion c;
+
+  if (!writer)
+    return;
+
+  silc_mutex_lock(writer->lock);
+  writer->shutdown = TRUE;
+  writer->flush_now = TRUE;
+  silc_cond_broadcast(writer->signal);
+  silc_mutex_unlock(writer->lock);
+
+  silc_thread_wait(writer->thread, NULL);
+
+  while ((c = writer->free_comps)) {
+    writer->free_comps = c->next;
+    silc_free(c);
+  }
+
+  silc_buffer_free(writer->batch);
+  close(writer->fd);
+  silc_cond_free(writer->signal);
+  silc_mutex_free(writer->lock);
+  silc_free(writer);
+}
+
+/* Append write */
+
+SilcBool silc_durable_writer_write(SilcDurableWriter writer,
+				   const unsigned char *data,
+				   SilcUInt32 data_len,
+				   SilcTaskCallback completion,
+				   void *context)
+{
+  SilcDurableCompletion c;
+
+  if (!writer || !data || !data_len) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  silc_mutex_lock(writer->lock);
+
+  if (writer->shutdown) {
+    silc_mutex_unlock(writer->lock);
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return FALSE;
+  }
+
+  /* Append to the batch */
+  if (silc_buffer_taillen(writer->batch) < data_len)
+    if (!silc_buffer_realloc(writer->batch,
+			     silc_buffer_truelen(writer->batch) +
+			     (data_len -
+			      silc_buffer_taillen(writer->batch)))) {
+      silc_mutex_unlock(writer->lock);
+      return FALSE;
+    }
+  memcpy(writer->batch->tail, data, data_len);
+  silc_buffer_pull_tail(writer->batch, data_len);
+
+  if (completion) {
+    c = writer->free_comps;
+    if (c)
+      writer->free_comps = c->next;
+    else
+      c = silc_calloc(1, sizeof(*c));
+    if (c) {
+      c->completion = completion;
+      c->context = context;
+      c->next = writer->completions;
+      writer->completions = c;
+    }
+  }
+
+  silc_cond_signal(writer->signal);
+  silc_mutex_unlock(writer->lock);
+
+  return TRUE;
+}
+
+/* Force flush */
+
+SilcBool silc_durable_writer_flush(SilcDurableWriter writer)
+{
+  if (!writer) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  silc_mutex_lock(writer->lock);
+  writer->flush_now = TRUE;
+  silc_cond_broadcast(writer->signal);
+  silc_mutex_unlock(writer->lock);
+
+  return TRUE;
+}
@@ -0,0 +1,132 @@
+/*
+
+  silcdurable.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Durable Writer Interface
+ *
+ * DESCRIPTION
+ *
+ * An append-only file writer with group commit for write-ahead logs.
+ * Writes are accumulated and flushed by a dedicated writer thread with
+ * one data sync per batch window, so concurrent commits share one
+ * fdatasync instead of serializing on one each.  A write's completion
+ * callback is delivered through the caller's scheduler only after the
+ * data is durable on disk.  O_DIRECT with aligned buffers can be
+ * requested to bypass the page cache.
+ *
+ ***/
+
+#ifndef SILCDURABLE_H
+#define SILCDURABLE_H
+
+/****s* silcutil/SilcDurableWriter
+ *
+ * NAME
+ *
+ *    typedef struct SilcDurableWriterStruct *SilcDurableWriter;
+ *
+ * DESCRIPTION
+ *
+ *    The durable writer context created with silc_durable_writer_create.
+ *
+ ***/
+typedef struct SilcDurableWriterStruct *SilcDurableWriter;
+
+/****f* silcutil/silc_durable_writer_create
+ *
+ * SYNOPSIS
+ *
+ *    SilcDurableWriter
+ *    silc_durable_writer_create(const char *filename,
+ *                               SilcSchedule schedule,
+ *                               SilcUInt32 batch_window_ms,
+ *                               SilcBool direct_io);
+ *
+ * DESCRIPTION
+ *
+ *    Creates a durable writer appending to `filename' (created if it
+ *    does not exist).  Writes are made durable in batches: the writer
+ *    thread collects writes for up to `batch_window_ms' milliseconds
+ *    (0 for 5ms) and issues one write plus one fdatasync for the
+ *    batch.  Completion callbacks run in `schedule' (NULL for the
+ *    global scheduler).  With `direct_io' the file is opened with
+ *    O_DIRECT where supported and written through aligned buffers.
+ *    Returns NULL on error.
+ *
+ ***/
+SilcDurableWriter silc_durable_writer_create(const char *filename,
+					     SilcSchedule schedule,
+					     SilcUInt32 batch_window_ms,
+					     SilcBool direct_io);
+
+/****f* silcutil/silc_durable_writer_destroy
+ *
+ * SYNOPSIS
+ *
+ *    void silc_durable_writer_destroy(SilcDurableWriter writer);
+ *
+ * DESCRIPTION
+ *
+ *    Flushes all pending writes durably, stops the writer thread and
+ *    frees the writer.
+ *
+ ***/
+void silc_durable_writer_destroy(SilcDurableWriter writer);
+
+/****f* silcutil/silc_durable_writer_write
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_durable_writer_write(SilcDurableWriter writer,
+ *                                       const unsigned char *data,
+ *                                       SilcUInt32 data_len,
+ *                                       SilcTaskCallback completion,
+ *                                       void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Appends `data' to the file.  The data is copied; the caller's
+ *    buffer may be reused immediately.  When the batch holding this
+ *    write has been written and fdatasync'd, `completion' (which may
+ *    be NULL) is called through the writer's scheduler with `context'.
+ *    Returns FALSE on memory allocation error or if the writer is
+ *    being destroyed.
+ *
+ ***/
+SilcBool silc_durable_writer_write(SilcDurableWriter writer,
+				   const unsigned char *data,
+				   SilcUInt32 data_len,
+				   SilcTaskCallback completion,
+				   void *context);
+
+/****f* silcutil/silc_durable_writer_flush
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_durable_writer_flush(SilcDurableWriter writer);
+ *
+ * DESCRIPTION
+ *
+ *    Makes the writer thread flush the current batch immediately
+ *    instead of waiting out the batch window.  Does not wait for the
+ *    flush to finish; completions signal it as usual.
+ *
+ ***/
+SilcBool silc_durable_writer_flush(SilcDurableWriter writer);
+
+#endif /* SILCDURABLE_H */
@@ -62,3 +62,152 @@ SilcBool silc_clearenv(void)
 #endif /* HAVE_GETENV */
   return FALSE;
 }
+
+/*************************** Environment snapshot ***************************/
+
+/* Snapshot of the environment in a hash table for one-lookup access on
+   hot paths. */
+
+static void silc_envs_destructor(void *key, void *context,
+				 void *user_context)
+{
+  silc_free(key);
+  silc_free(context);
+}
+
+/* Refresh (or create) the environment snapshot */
+
+SilcBool silc_envs_refresh(void)
+{
+#if defined(SILC_UNIX) || defined(SILC_WIN32)
+  extern char **environ;
+  SilcHashTable t, *tp;
+  char *eq;
+  int i;
+
+  t = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+			    silc_hash_string_compare, NULL,
+			    silc_envs_destructor, NULL, TRUE);
+  if (!t)
+    return FALSE;
+
+  for (i = 0; environ[i]; i++) {
+    eq = strchr(environ[i], '=');
+    if (!eq)
+      continue;
+    silc_hash_table_set(t, silc_memdup(environ[i], eq - environ[i]),
+			silc_strdup(eq + 1));
+  }
+
+  tp = silc_global_get_var("srtenvs", FALSE);
+  if (!tp)
+    tp = silc_global_set_var("srtenvs", sizeof(*tp), NULL, FALSE);
+  if (!tp) {
+    silc_hash_table_free(t);
+    return FALSE;
+  }
+
+  if (*tp)
+    silc_hash_table_free(*tp);
+  *tp = t;
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* SILC_UNIX || SILC_WIN32 */
+}
+
+/* Get variable from the snapshot */
+
+const char *silc_envs_get(const char *variable)
+{
+  SilcHashTable *tp;
+  void *val;
+
+  tp = silc_global_get_var("srtenvs", FALSE);
+  if (!tp || !*tp) {
+    if (!silc_envs_refresh())
+      return NULL;
+    tp = silc_global_get_var("srtenvs", FALSE);
+    if (!tp || !*tp)
+      return NULL;
+  }
+
+  if (!silc_hash_table_find(*tp, (void *)variable, NULL, &val)) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  return val;
+}
+
+/* Get boolean variable from the snapshot */
+
+SilcBool silc_envs_get_bool(const char *variable, SilcBool default_value)
+{
+  const char *v = silc_envs_get(variable);
+
+  if (!v)
+    return default_value;
+
+  if (!strcmp(v, "1") || !strcasecmp(v, "yes") || !strcasecmp(v, "true") ||
+      !strcasecmp(v, "on"))
+    return TRUE;
+  if (!strcmp(v, "0") || !strcasecmp(v, "no") || !strcasecmp(v, "false") ||
+      !strcasecmp(v, "off"))
+    return FALSE;
+
+  return default_value;
+}
+
+/* Get integer variable from the snapshot */
+
+SilcInt64 silc_envs_get_int(const char *variable, SilcInt64 default_value)
+{
+  const char *v = silc_envs_get(variable);
+  char *end;
+  SilcInt64 val;
+
+  if (!v || !*v)
+    return default_value;
+
+  val = (SilcInt64)strtol(v, &end, 0);
+  if (*end)
+    return default_value;
+
+  return val;
+}
+
+/* Get size variable with k/M/G suffix from the snapshot */
+
+SilcUInt64 silc_envs_get_size(const char *variable,
+			      SilcUInt64 default_value)
+{
+  const char *v = silc_envs_get(variable);
+  char *end;
+  SilcUInt64 val;
+
+  if (!v || !*v)
+    return default_value;
+
+  val = (SilcUInt64)strtoul(v, &end, 0);
+  switch (*end) {
+  case 'k': case 'K':
+    val <<= 10;
+    end++;
+    break;
+  case 'm': case 'M':
+    val <<= 20;
+    end++;
+    break;
+  case 'g': case 'G':
+    val <<= 30;
+    end++;
+    break;
+  }
+  if (*end)
+    return default_value;
+
+  return val;
+}
@@ -90,4 +90,59 @@ SilcBool silc_unsetenv(const char *variable);
  ***/
 SilcBool silc_clearenv(void);
 
+/****f* silcutil/silc_envs_refresh
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_envs_refresh(void);
+ *
+ * DESCRIPTION
+ *
+ *    Loads (or reloads) a snapshot of the process environment into a
+ *    hash table.  The snapshot is shared by all threads and is created
+ *    automatically on the first silc_envs_get.
+ *
+ ***/
+SilcBool silc_envs_refresh(void);
+
+/****f* silcutil/silc_envs_get
+ *
+ * SYNOPSIS
+ *
+ *    const char *silc_envs_get(const char *variable);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the value of `variable' from the environment snapshot with
+ *    one hash lookup, unlike silc_getenv which scans the environment
+ *    linearly in libc.  Changes made to the environment after the
+ *    snapshot are seen only after silc_envs_refresh.
+ *
+ ***/
+const char *silc_envs_get(const char *variable);
+
+/****f* silcutil/silc_envs_get_bool
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_envs_get_bool(const char *variable,
+ *                                SilcBool default_value);
+ *    SilcInt64 silc_envs_get_int(const char *variable,
+ *                                SilcInt64 default_value);
+ *    SilcUInt64 silc_envs_get_size(const char *variable,
+ *                                  SilcUInt64 default_value);
+ *
+ * DESCRIPTION
+ *
+ *    Typed accessors over the environment snapshot.  The boolean
+ *    accessor understands 1/0, yes/no, true/false and on/off; the size
+ *    accessor understands k, M and G suffixes.  The default is
+ *    returned when the variable is unset or does not parse.
+ *
+ ***/
+SilcBool silc_envs_get_bool(const char *variable, SilcBool default_value);
+SilcInt64 silc_envs_get_int(const char *variable, SilcInt64 default_value);
+SilcUInt64 silc_envs_get_size(const char *variable,
+			      SilcUInt64 default_value);
+
 #endif /* SILCENV_H */
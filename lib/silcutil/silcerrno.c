@@ -21,28 +21,52 @@
 
 /* Get last error */
 
+/* On compilers with fast thread-local variables the errno itself lives
+   in a dedicated __thread variable, so setting and reading it is one
+   store or load without the Tls context lookup.  The reason and location
+   details stay in the Tls context.  Symbian and other platforms without
+   __thread keep the portable path. */
+#if defined(__GNUC__) && !defined(SILC_SYMBIAN) && defined(SILC_THREADS)
+#define SILC_ERRNO_TLS
+static __thread SilcResult silc_errno_value = SILC_OK;
+#endif /* __GNUC__ && !SILC_SYMBIAN && SILC_THREADS */
+
 SilcResult silc_get_errno(void)
 {
+#ifdef SILC_ERRNO_TLS
+  return silc_errno_value;
+#else
   SilcTls tls = silc_thread_get_tls();
 
   if (!tls)
     return SILC_OK;
 
   return tls->error;
+#endif /* SILC_ERRNO_TLS */
 }
 
 /* Set error */
 
 void silc_set_errno(SilcResult error)
 {
-  SilcTls tls = silc_thread_get_tls();
+  SilcTls tls;
 
+#ifdef SILC_ERRNO_TLS
+  /* One store; the details in the Tls context are cleared only if the
+     context already exists. */
+  silc_errno_value = error;
+  tls = silc_thread_get_tls();
+  if (!tls)
+    return;
+#else
+  tls = silc_thread_get_tls();
   if (!tls) {
     /* Try to create Tls */
     tls = silc_thread_tls_init();
     if (!tls)
       return;
   }
+#endif /* SILC_ERRNO_TLS */
 
   tls->error_reason[0] = '\0';
   tls->filename[0] = '\0';
@@ -55,6 +79,10 @@ void silc_set_errno_nofail(SilcResult error)
 {
   SilcTls tls = silc_thread_get_tls();
 
+#ifdef SILC_ERRNO_TLS
+  silc_errno_value = error;
+#endif /* SILC_ERRNO_TLS */
+
   if (!tls)
     return;
 
@@ -83,6 +111,9 @@ void silc_set_errno_reason(SilcResult error, const char *format, ...)
     va_end(va);
   }
 
+#ifdef SILC_ERRNO_TLS
+  silc_errno_value = error;
+#endif /* SILC_ERRNO_TLS */
   tls->error = error;
 }
 
@@ -102,6 +133,9 @@ void silc_set_errno_reason_nofail(SilcResult error, const char *format, ...)
     va_end(va);
   }
 
+#ifdef SILC_ERRNO_TLS
+  silc_errno_value = error;
+#endif /* SILC_ERRNO_TLS */
   tls->error = error;
 }
 
@@ -25,8 +25,22 @@
 
 const SilcStreamOps silc_fd_stream_ops;
 
-/* FD stream context */
+SilcBool silc_fd_stream_flush(SilcStream stream);
+
+/* Asynchronous fill context.  Heap allocated and owning its own read
+   buffer, so a stream destroyed while the fill is in flight can orphan
+   it; the completion then only frees the context. */
 typedef struct {
+  struct SilcFDStreamObject *fd_stream; /* Owning stream, NULL if orphaned */
+  unsigned char *buf;		       /* Worker read target */
+  SilcUInt32 buf_size;
+  int fd;			       /* Dup of the stream fd, fill owned */
+  int len;			       /* Read result */
+  int error;			       /* errno of the read */
+} *SilcFDStreamFill;
+
+/* FD stream context */
+typedef struct SilcFDStreamObject {
   const SilcStreamOps *ops;
   SilcStack stack;
   SilcSchedule schedule;
@@ -34,8 +48,83 @@ typedef struct {
   void *notifier_context;
   int fd1;
   int fd2;
+  SilcBuffer rbuf;		       /* Readahead buffer */
+  SilcBuffer wbuf;		       /* Write coalescing buffer */
+  SilcUInt32 buffer_size;	       /* Buffering window, 0 = unbuffered */
+  SilcFDStreamFill fill;	       /* In-flight fill, NULL when idle */
+  int fill_len;			       /* Result of asynchronous fill */
+  int fill_errno;
+  unsigned int async	    : 1;       /* Asynchronous reads enabled */
+  unsigned int at_eof	    : 1;       /* End of file seen by the fill */
 } *SilcFDStream;
 
+/* Returns the shared fd stream worker pool */
+
+static SilcThreadPool silc_fd_stream_pool(void)
+{
+  SilcThreadPool *pool = silc_global_get_var("srtfdpool", FALSE);
+
+  if (!pool)
+    pool = silc_global_set_var("srtfdpool", sizeof(*pool), NULL, FALSE);
+  if (!pool)
+    return NULL;
+  if (!*pool)
+    *pool = silc_thread_pool_alloc(NULL, 0, 4, TRUE);
+
+  return *pool;
+}
+
+/* Worker; performs the blocking read off the scheduler thread.  Only
+   the fill context is touched, never the stream, which may have been
+   destroyed meanwhile. */
+
+static void silc_fd_stream_fill_worker(SilcSchedule schedule, void *context)
+{
+  SilcFDStreamFill fill = context;
+
+  fill->len = silc_file_read(fill->fd, fill->buf, fill->buf_size);
+  fill->error = errno;
+}
+
+/* Fill completion, runs in the scheduler thread */
+
+SILC_TASK_CALLBACK(silc_fd_stream_fill_done)
+{
+  SilcFDStreamFill fill = context;
+  SilcFDStream fd_stream = fill->fd_stream;
+
+  if (!fd_stream) {
+    /* The stream was destroyed while the fill was in flight */
+    silc_file_close(fill->fd);
+    silc_free(fill->buf);
+    silc_free(fill);
+    return;
+  }
+
+  fd_stream->fill = NULL;
+  fd_stream->fill_len = fill->len;
+  fd_stream->fill_errno = fill->error;
+
+  if (fill->len > 0) {
+    /* The buffer may have been resized while the fill was in flight */
+    if ((SilcUInt32)fill->len > silc_buffer_truelen(fd_stream->rbuf))
+      fill->len = silc_buffer_truelen(fd_stream->rbuf);
+    silc_buffer_reset(fd_stream->rbuf);
+    memcpy(fd_stream->rbuf->head, fill->buf, fill->len);
+    silc_buffer_pull_tail(fd_stream->rbuf, fill->len);
+  } else if (fill->len == 0) {
+    fd_stream->at_eof = TRUE;
+  }
+
+  silc_file_close(fill->fd);
+  silc_free(fill->buf);
+  silc_free(fill);
+
+  if (fd_stream->notifier)
+    fd_stream->notifier((SilcStream)fd_stream, SILC_STREAM_CAN_READ,
+			fd_stream->notifier_context);
+}
+
 
 /************************ Static utility functions **************************/
 
@@ -187,8 +276,103 @@ int silc_fd_stream_read(SilcStream stream, unsigned char *buf,
 
   SILC_LOG_DEBUG(("Reading data from fd %d", fd_stream->fd1));
 
+  if (fd_stream->buffer_size && fd_stream->async) {
+    /* Serve buffered data; refills happen in a worker thread so the
+       scheduler never blocks on disk. */
+    if (silc_buffer_len(fd_stream->rbuf)) {
+      len = silc_buffer_len(fd_stream->rbuf);
+      if ((SilcUInt32)len > buf_len)
+	len = buf_len;
+      memcpy(buf, silc_buffer_data(fd_stream->rbuf), len);
+      silc_buffer_pull(fd_stream->rbuf, len);
+      return len;
+    }
+
+    if (fd_stream->fill) {
+      silc_set_errno(SILC_ERR_WOULD_BLOCK);
+      return -1;
+    }
+
+    if (fd_stream->at_eof)
+      return 0;
+
+    if (fd_stream->fill_len < 0 && fd_stream->fill_errno) {
+      silc_set_errno_posix(fd_stream->fill_errno);
+      fd_stream->fill_errno = 0;
+      return -2;
+    }
+
+    /* Submit a fill; the notifier signals when the data is here */
+    {
+      SilcThreadPool pool = silc_fd_stream_pool();
+      SilcFDStreamFill fill;
+
+      if (pool) {
+	fill = silc_calloc(1, sizeof(*fill));
+	if (fill) {
+	  fill->buf_size = silc_buffer_truelen(fd_stream->rbuf);
+	  fill->buf = silc_malloc(fill->buf_size);
+	  if (!fill->buf) {
+	    silc_free(fill);
+	    fill = NULL;
+	  }
+	}
+	if (fill) {
+	  /* The fill owns a dup of the fd; destroying or closing the
+	     stream mid-fill then cannot hand the worker a reused
+	     descriptor. */
+	  fill->fd = dup(fd_stream->fd1);
+	  if (fill->fd < 0) {
+	    silc_free(fill->buf);
+	    silc_free(fill);
+	    fill = NULL;
+	  }
+	}
+	if (fill) {
+	  fill->fd_stream = fd_stream;
+	  fd_stream->fill = fill;
+	  if (silc_thread_pool_run(pool, TRUE, fd_stream->schedule,
+				   silc_fd_stream_fill_worker, fill,
+				   silc_fd_stream_fill_done, fill)) {
+	    silc_set_errno(SILC_ERR_WOULD_BLOCK);
+	    return -1;
+	  }
+	  fd_stream->fill = NULL;
+	  silc_file_close(fill->fd);
+	  silc_free(fill->buf);
+	  silc_free(fill);
+	}
+      }
+    }
+    /* No pool; fall through to the synchronous buffered read */
+  }
+
+  if (fd_stream->buffer_size) {
+    /* Serve from the readahead buffer, refilling it in large reads */
+    if (!silc_buffer_len(fd_stream->rbuf)) {
+      silc_buffer_reset(fd_stream->rbuf);
+      len = silc_file_read(fd_stream->fd1, fd_stream->rbuf->head,
+			   silc_buffer_truelen(fd_stream->rbuf));
+      if (len < 0)
+	goto read_error;
+      if (!len) {
+	silc_schedule_unset_listen_fd(fd_stream->schedule, fd_stream->fd1);
+	return 0;
+      }
+      silc_buffer_pull_tail(fd_stream->rbuf, len);
+    }
+
+    len = silc_buffer_len(fd_stream->rbuf);
+    if ((SilcUInt32)len > buf_len)
+      len = buf_len;
+    memcpy(buf, silc_buffer_data(fd_stream->rbuf), len);
+    silc_buffer_pull(fd_stream->rbuf, len);
+    return len;
+  }
+
   len = silc_file_read(fd_stream->fd1, buf, buf_len);
   if (len < 0) {
+  read_error:
     if (errno == EAGAIN || errno == EINTR) {
       SILC_LOG_DEBUG(("Could not read immediately, will do it later"));
       silc_schedule_set_listen_fd(fd_stream->schedule, fd_stream->fd1,
@@ -224,6 +408,27 @@ int silc_fd_stream_write(SilcStream stream, const unsigned char *data,
 
   SILC_LOG_DEBUG(("Writing data to fd %d", fd_stream->fd2));
 
+  if (fd_stream->buffer_size) {
+    /* Coalesce small writes; the buffer is flushed when it fills or
+       with silc_fd_stream_flush. */
+    if (silc_buffer_len(fd_stream->wbuf) + data_len <=
+	silc_buffer_truelen(fd_stream->wbuf)) {
+      memcpy(fd_stream->wbuf->tail, data, data_len);
+      silc_buffer_pull_tail(fd_stream->wbuf, data_len);
+      return (int)data_len;
+    }
+
+    if (!silc_fd_stream_flush(stream))
+      return -2;
+
+    if (data_len <= silc_buffer_truelen(fd_stream->wbuf)) {
+      memcpy(fd_stream->wbuf->tail, data, data_len);
+      silc_buffer_pull_tail(fd_stream->wbuf, data_len);
+      return (int)data_len;
+    }
+    /* Larger than the buffer; write through */
+  }
+
   ret = silc_file_write(fd_stream->fd2, data, data_len);
   if (ret < 0) {
     if (errno == EAGAIN || errno == EINTR) {
@@ -281,6 +486,19 @@ void silc_fd_stream_destroy(SilcStream stream)
   SilcFDStream fd_stream = stream;
   SilcStack stack = fd_stream->stack;
 
+  /* Orphan an in-flight fill instead of waiting for it; waiting here
+     would deadlock when destroy runs in the scheduler thread that must
+     dispatch the fill completion.  The completion frees the orphaned
+     context. */
+  if (fd_stream->fill)
+    fd_stream->fill->fd_stream = NULL;
+
+  if (fd_stream->buffer_size) {
+    silc_fd_stream_flush(stream);
+    silc_buffer_free(fd_stream->rbuf);
+    silc_buffer_free(fd_stream->wbuf);
+  }
+
   silc_fd_stream_close(stream);
   silc_sfree(stack, stream);
   silc_stack_free(stack);
@@ -338,6 +556,83 @@ SilcSchedule silc_fd_stream_get_schedule(SilcStream stream)
 }
 
 /* File descriptor stream operations */
+/* Flush the write coalescing buffer */
+
+SilcBool silc_fd_stream_flush(SilcStream stream)
+{
+  SilcFDStream fd_stream = stream;
+  int ret;
+
+  if (!fd_stream->buffer_size || !silc_buffer_len(fd_stream->wbuf))
+    return TRUE;
+
+  while (silc_buffer_len(fd_stream->wbuf) > 0) {
+    ret = silc_file_write(fd_stream->fd2,
+			  silc_buffer_data(fd_stream->wbuf),
+			  silc_buffer_len(fd_stream->wbuf));
+    if (ret < 0) {
+      if (errno == EINTR)
+	continue;
+      silc_set_errno_posix(errno);
+      return FALSE;
+    }
+    silc_buffer_pull(fd_stream->wbuf, ret);
+  }
+
+  silc_buffer_reset(fd_stream->wbuf);
+  return TRUE;
+}
+
+/* Enable user-space buffering on the fd stream */
+
+SilcBool silc_fd_stream_set_buffer(SilcStream stream, SilcUInt32 buffer_size)
+{
+  SilcFDStream fd_stream = stream;
+
+  if (!buffer_size) {
+    /* Disable; flush pending writes first */
+    if (fd_stream->buffer_size) {
+      silc_fd_stream_flush(stream);
+      silc_buffer_free(fd_stream->rbuf);
+      silc_buffer_free(fd_stream->wbuf);
+      fd_stream->rbuf = fd_stream->wbuf = NULL;
+      fd_stream->buffer_size = 0;
+    }
+    return TRUE;
+  }
+
+  if (fd_stream->buffer_size)
+    return TRUE;
+
+  fd_stream->rbuf = silc_buffer_alloc(buffer_size);
+  fd_stream->wbuf = silc_buffer_alloc(buffer_size);
+  if (!fd_stream->rbuf || !fd_stream->wbuf) {
+    silc_buffer_free(fd_stream->rbuf);
+    silc_buffer_free(fd_stream->wbuf);
+    fd_stream->rbuf = fd_stream->wbuf = NULL;
+    return FALSE;
+  }
+  silc_buffer_reset(fd_stream->rbuf);
+  silc_buffer_reset(fd_stream->wbuf);
+  fd_stream->buffer_size = buffer_size;
+
+  return TRUE;
+}
+
+/* Enable asynchronous reads */
+
+SilcBool silc_fd_stream_set_async(SilcStream stream, SilcBool async)
+{
+  SilcFDStream fd_stream = stream;
+
+  if (async && !fd_stream->buffer_size)
+    if (!silc_fd_stream_set_buffer(stream, 65536))
+      return FALSE;
+
+  fd_stream->async = async;
+  return TRUE;
+}
+
 const SilcStreamOps silc_fd_stream_ops =
 {
   silc_fd_stream_read,
@@ -147,4 +147,58 @@ SilcBool silc_fd_stream_get_info(SilcStream stream,
 /* Backwards support */
 #define silc_fd_stream_get_error(stream) silc_errno
 
+/****f* silcutil/silc_fd_stream_set_buffer
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_fd_stream_set_buffer(SilcStream stream,
+ *                                       SilcUInt32 buffer_size);
+ *
+ * DESCRIPTION
+ *
+ *    Enables user-space buffering on the fd stream: reads are served
+ *    from a `buffer_size' byte readahead buffer refilled with large
+ *    read() calls, and writes smaller than the buffer coalesce and go
+ *    out in large write() calls when the buffer fills or
+ *    silc_fd_stream_flush is called.  Record-at-a-time file processing
+ *    stops paying a system call per record.  Setting zero disables
+ *    buffering, flushing pending writes.
+ *
+ ***/
+SilcBool silc_fd_stream_set_buffer(SilcStream stream,
+				   SilcUInt32 buffer_size);
+
+/****f* silcutil/silc_fd_stream_flush
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_fd_stream_flush(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Writes out data held in the write coalescing buffer.  Buffered
+ *    writes are also flushed when the buffer fills and when the stream
+ *    is destroyed.
+ *
+ ***/
+SilcBool silc_fd_stream_flush(SilcStream stream);
+
+/****f* silcutil/silc_fd_stream_set_async
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_fd_stream_set_async(SilcStream stream, SilcBool async);
+ *
+ * DESCRIPTION
+ *
+ *    Enables asynchronous reads on the fd stream: when the readahead
+ *    buffer is empty silc_stream_read returns -1 and a worker thread
+ *    performs the blocking disk read, after which the stream notifier is
+ *    called with SILC_STREAM_CAN_READ through the scheduler.  The event
+ *    loop never blocks on disk seeks.  Enabling turns on buffering if it
+ *    was off.  Requires a scheduler set with silc_stream_set_notifier.
+ *
+ ***/
+SilcBool silc_fd_stream_set_async(SilcStream stream, SilcBool async);
+
 #endif /* SILCFDSTREAM_H */
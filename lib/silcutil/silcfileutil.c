@@ -19,6 +19,10 @@
 
 #include "silcruntime.h"
 
+#if defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif /* HAVE_SYS_MMAN_H */
+
 /* Opens a file indicated by the filename `filename' with flags indicated
    by the `flags'. */
 
@@ -351,3 +355,59 @@ SilcBool silc_file_fstat(int fd, SilcFileStat return_stat)
 
   return TRUE;
 }
+
+/* Maps a file read-only into memory.  Returns the mapped region and its
+   length.  The region is freed with silc_file_unmapfile.  Returns NULL
+   if mapping is not available on the platform or fails, in which case
+   the caller can fall back to silc_file_readfile. */
+
+unsigned char *silc_file_mapfile(const char *filename,
+				 SilcUInt32 *return_len)
+{
+#if defined(HAVE_SYS_MMAN_H)
+  unsigned char *addr;
+  struct stat st;
+  int fd;
+
+  fd = silc_file_open(filename, O_RDONLY);
+  if (fd < 0) {
+    silc_set_errno_posix(errno);
+    return NULL;
+  }
+
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size) {
+    silc_set_errno_posix(errno);
+    silc_file_close(fd);
+    return NULL;
+  }
+
+  addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  silc_file_close(fd);
+  if (addr == MAP_FAILED) {
+    silc_set_errno_posix(errno);
+    return NULL;
+  }
+
+#if defined(MADV_WILLNEED)
+  madvise(addr, st.st_size, MADV_WILLNEED);
+#endif /* MADV_WILLNEED */
+
+  if (return_len)
+    *return_len = (SilcUInt32)st.st_size;
+
+  return addr;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return NULL;
+#endif /* HAVE_SYS_MMAN_H */
+}
+
+/* Unmaps a region mapped with silc_file_mapfile */
+
+void silc_file_unmapfile(unsigned char *addr, SilcUInt32 len)
+{
+#if defined(HAVE_SYS_MMAN_H)
+  if (addr)
+    munmap(addr, len);
+#endif /* HAVE_SYS_MMAN_H */
+}
@@ -306,4 +306,37 @@ SilcBool silc_file_stat(const char *filename, SilcBool follow_symlinks,
  ***/
 SilcBool silc_file_fstat(int fd, SilcFileStat return_stat);
 
+/****f* silcutil/silc_file_mapfile
+ *
+ * SYNOPSIS
+ *
+ *    unsigned char *silc_file_mapfile(const char *filename,
+ *                                     SilcUInt32 *return_len);
+ *
+ * DESCRIPTION
+ *
+ *    Maps the file `filename' read-only into memory and returns the
+ *    mapped region, with the file length in `return_len'.  Unlike
+ *    silc_file_readfile nothing is copied; large configs and assets
+ *    load at page fault speed.  The region is released with
+ *    silc_file_unmapfile.  Returns NULL if mapping is not available or
+ *    fails; the caller can then fall back to silc_file_readfile.
+ *
+ ***/
+unsigned char *silc_file_mapfile(const char *filename,
+				 SilcUInt32 *return_len);
+
+/****f* silcutil/silc_file_unmapfile
+ *
+ * SYNOPSIS
+ *
+ *    void silc_file_unmapfile(unsigned char *addr, SilcUInt32 len);
+ *
+ * DESCRIPTION
+ *
+ *    Unmaps a region returned by silc_file_mapfile.
+ *
+ ***/
+void silc_file_unmapfile(unsigned char *addr, SilcUInt32 len);
+
 #endif	/* !SILCFILEUTIL_H */
@@ -0,0 +1,163 @@
+/*
+
+  silcflight.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Events per thread ring */
+#define SILC_FLIGHT_RING 1024
+
+/* One trace record */
+typedef struct {
+  SilcUInt64 timestamp;		       /* Monotonic nanoseconds */
+  SilcUInt64 arg1;
+  SilcUInt64 arg2;
+  SilcUInt32 event;
+} SilcFlightRecordStruct;
+
+/* Per-thread ring */
+typedef struct SilcFlightRingStruct {
+  struct SilcFlightRingStruct *next;   /* Registry linkage */
+  SilcThread thread;		       /* Owning thread */
+  SilcUInt32 head;		       /* Next write position */
+  SilcFlightRecordStruct records[SILC_FLIGHT_RING];
+} *SilcFlightRing;
+
+/* Registry of all thread rings */
+typedef struct {
+  SilcMutex lock;
+  SilcFlightRing rings;
+} *SilcFlightRegistry;
+
+/* Returns the global registry */
+
+static SilcFlightRegistry silc_flight_registry(void)
+{
+  SilcFlightRegistry reg;
+
+  reg = silc_global_get_var("srtflightreg", FALSE);
+  if (!reg) {
+    reg = silc_global_set_var("srtflightreg", sizeof(*reg), NULL, FALSE);
+    if (!reg)
+      return NULL;
+    if (!silc_mutex_alloc(&reg->lock))
+      return NULL;
+  }
+
+  return reg;
+}
+
+/* Returns the calling thread's ring, creating and registering it on
+   first use.  Rings are never unregistered; a dead thread's recent
+   history is exactly what a crash dump wants. */
+
+static SilcFlightRing silc_flight_ring(void)
+{
+  SilcFlightRing *rp, ring;
+  SilcFlightRegistry reg;
+
+  rp = silc_global_get_var("srtflightring", TRUE);
+  if (rp && *rp)
+    return *rp;
+  if (!rp) {
+    rp = silc_global_set_var("srtflightring", sizeof(*rp), NULL, TRUE);
+    if (!rp)
+      return NULL;
+  }
+
+  ring = silc_calloc(1, sizeof(*ring));
+  if (!ring)
+    return NULL;
+  ring->thread = silc_thread_self();
+
+  reg = silc_flight_registry();
+  if (reg) {
+    silc_mutex_lock(reg->lock);
+    ring->next = reg->rings;
+    reg->rings = ring;
+    silc_mutex_unlock(reg->lock);
+  }
+
+  *rp = ring;
+
+  return ring;
+}
+
+/* Record event */
+
+void silc_flight_record(SilcUInt32 event, SilcUInt64 arg1, SilcUInt64 arg2)
+{
+  SilcFlightRing ring = silc_flight_ring();
+  SilcFlightRecordStruct *r;
+
+  if (silc_unlikely(!ring))
+    return;
+
+  r = &ring->records[ring->head & (SILC_FLIGHT_RING - 1)];
+  r->timestamp = silc_time_monotonic_nsec();
+  r->event = event;
+  r->arg1 = arg1;
+  r->arg2 = arg2;
+  ring->head++;
+}
+
+/* Dump all rings to file */
+
+SilcBool silc_flight_dump(const char *filename)
+{
+  SilcFlightRegistry reg = silc_flight_registry();
+  SilcFlightRing ring;
+  SilcFlightRecordStruct *r;
+  SilcUInt32 i, start, count;
+  FILE *fp;
+
+  if (!reg || !filename) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  fp = fopen(filename, "w");
+  if (!fp) {
+    silc_set_errno_posix(errno);
+    return FALSE;
+  }
+
+  silc_mutex_lock(reg->lock);
+
+  for (ring = reg->rings; ring; ring = ring->next) {
+    fprintf(fp, "thread %p, %u events\n", ring->thread,
+	    ring->head < SILC_FLIGHT_RING ? ring->head : SILC_FLIGHT_RING);
+
+    count = ring->head < SILC_FLIGHT_RING ? ring->head : SILC_FLIGHT_RING;
+    start = ring->head - count;
+    for (i = 0; i < count; i++) {
+      r = &ring->records[(start + i) & (SILC_FLIGHT_RING - 1)];
+      fprintf(fp, "  %llu event %u args %llx %llx\n",
+	      (unsigned long long)r->timestamp, r->event,
+	      (unsigned long long)r->arg1, (unsigned long long)r->arg2);
+    }
+  }
+
+  silc_mutex_unlock(reg->lock);
+
+  fclose(fp);
+
+  SILC_LOG_DEBUG(("Dumped flight recorder to %s", filename));
+
+  return TRUE;
+}
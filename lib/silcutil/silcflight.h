@@ -0,0 +1,92 @@
+/*
+
+  silcflight.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Flight Recorder Interface
+ *
+ * DESCRIPTION
+ *
+ * An always-on in-memory flight recorder.  Each thread records
+ * fixed-size trace events (an event id, a timestamp and two words)
+ * into its own ring buffer with plain stores and one index advance, so
+ * the recorder can be left enabled in production.  When a loop stalls
+ * or the process hits a fatal error, the rings are dumped to a file,
+ * giving the recent history of every thread; the fatal path of the
+ * log interface dumps automatically.
+ *
+ ***/
+
+#ifndef SILCFLIGHT_H
+#define SILCFLIGHT_H
+
+/****d* silcutil/SilcFlightEvents
+ *
+ * NAME
+ *
+ *    Flight recorder event identifiers.
+ *
+ * DESCRIPTION
+ *
+ *    Well-known event ids recorded by the runtime; applications may
+ *    record their own ids from SILC_FLIGHT_APP upwards.
+ *
+ * SOURCE
+ */
+#define SILC_FLIGHT_SCHED_DISPATCH  1	/* Scheduler dispatch round */
+#define SILC_FLIGHT_SCHED_WAIT      2	/* Scheduler entering wait */
+#define SILC_FLIGHT_SCHED_WAKE      3	/* Scheduler woke up */
+#define SILC_FLIGHT_STREAM_READ     4	/* Stream read */
+#define SILC_FLIGHT_STREAM_WRITE    5	/* Stream write */
+#define SILC_FLIGHT_FSM_STATE       6	/* FSM state transition */
+#define SILC_FLIGHT_APP             256	/* First application event id */
+/***/
+
+/****f* silcutil/silc_flight_record
+ *
+ * SYNOPSIS
+ *
+ *    void silc_flight_record(SilcUInt32 event, SilcUInt64 arg1,
+ *                            SilcUInt64 arg2);
+ *
+ * DESCRIPTION
+ *
+ *    Records an event into the calling thread's ring.  The cost is a
+ *    timestamp read and four stores; safe to call from any code at any
+ *    rate.
+ *
+ ***/
+void silc_flight_record(SilcUInt32 event, SilcUInt64 arg1, SilcUInt64 arg2);
+
+/****f* silcutil/silc_flight_dump
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_flight_dump(const char *filename);
+ *
+ * DESCRIPTION
+ *
+ *    Dumps every thread's recorded events, oldest first, into
+ *    `filename' as text.  Called automatically from the fatal log
+ *    path; can also be called on demand (for example from a watchdog
+ *    that detected a stalled loop).  Returns FALSE if the file cannot
+ *    be written.
+ *
+ ***/
+SilcBool silc_flight_dump(const char *filename);
+
+#endif /* SILCFLIGHT_H */
@@ -19,6 +19,11 @@
 
 #include "silcruntime.h"
 
+#if defined(HAVE_UCONTEXT_H) && defined(HAVE_MAKECONTEXT)
+#define SILC_FSM_CORO
+#include <ucontext.h>
+#endif /* HAVE_UCONTEXT_H && HAVE_MAKECONTEXT */
+
 SILC_TASK_CALLBACK(silc_fsm_run);
 SILC_TASK_CALLBACK(silc_fsm_finish_fsm);
 SILC_TASK_CALLBACK(silc_fsm_event_timedout);
@@ -28,6 +33,105 @@ static void silc_fsm_event_ref(SilcFSMEvent event);
 static void silc_fsm_event_unref(SilcFSMEvent event);
 void *silc_fsm_thread(void *context);
 
+/* Per-thread pool of machine/thread contexts */
+typedef struct {
+  SilcFSM free_fsm;		      /* Recycled contexts, linked via next */
+  SilcUInt32 count;
+} SilcFSMPool;
+
+/* Maximum contexts kept in a thread's pool */
+#define SILC_FSM_POOL_MAX 64
+
+/* Returns the calling thread's FSM pool */
+
+static SilcFSMPool *silc_fsm_pool(void)
+{
+  SilcFSMPool *pool = silc_global_get_var("srtfsmpool", TRUE);
+
+  if (!pool)
+    pool = silc_global_set_var("srtfsmpool", sizeof(*pool), NULL, TRUE);
+
+  return pool;
+}
+
+/* Allocates FSM context from the pool or the heap */
+
+static SilcFSM silc_fsm_alloc_context(void)
+{
+  SilcFSMPool *pool = silc_fsm_pool();
+  SilcFSM f;
+
+  if (pool && pool->free_fsm) {
+    f = pool->free_fsm;
+    pool->free_fsm = f->next;
+    pool->count--;
+    memset(f, 0, sizeof(*f));
+    return f;
+  }
+
+  return silc_calloc(1, sizeof(*f));
+}
+
+/* Recycles FSM context */
+
+static void silc_fsm_free_context(SilcFSM f)
+{
+  SilcFSMPool *pool = silc_fsm_pool();
+
+  if (pool && pool->count < SILC_FSM_POOL_MAX) {
+    f->next = pool->free_fsm;
+    pool->free_fsm = f;
+    pool->count++;
+    return;
+  }
+
+  silc_free(f);
+}
+
+/* Per-state profile entry */
+typedef struct {
+  SilcFSMStateCallback state;	      /* The state function */
+  SilcUInt32 calls;		      /* Number of entries to the state */
+  SilcUInt64 total_usec;	      /* Cumulative runtime */
+} *SilcFSMStateProfileInt;
+
+/* Records one state execution to the machine's profile */
+
+static void silc_fsm_profile_record(SilcFSM machine,
+				    SilcFSMStateCallback state,
+				    SilcTimer timer)
+{
+  SilcFSMStateProfileInt p;
+  SilcUInt64 sec;
+  SilcUInt32 usec;
+
+  silc_timer_value(timer, &sec, &usec);
+
+  if (machine->u.m.lock)
+    silc_mutex_lock(machine->u.m.lock);
+
+  if (machine->u.m.profile &&
+      !silc_hash_table_find(machine->u.m.profile, (void *)state, NULL,
+			    (void *)&p)) {
+    p = silc_calloc(1, sizeof(*p));
+    if (p) {
+      p->state = state;
+      if (!silc_hash_table_add(machine->u.m.profile, (void *)state, p)) {
+	silc_free(p);
+	p = NULL;
+      }
+    }
+  }
+
+  if (machine->u.m.profile && p) {
+    p->calls++;
+    p->total_usec += sec * 1000000 + usec;
+  }
+
+  if (machine->u.m.lock)
+    silc_mutex_unlock(machine->u.m.lock);
+}
+
 /* Allocate FSM */
 
 SilcFSM silc_fsm_alloc(void *fsm_context,
@@ -37,16 +141,18 @@ SilcFSM silc_fsm_alloc(void *fsm_context,
 {
   SilcFSM fsm;
 
-  fsm = silc_calloc(1, sizeof(*fsm));
+  fsm = silc_fsm_alloc_context();
   if (silc_unlikely(!fsm))
     return NULL;
 
   if (silc_unlikely(!silc_fsm_init(fsm, fsm_context, destructor,
 				   destructor_context, schedule))) {
-    silc_free(fsm);
+    silc_fsm_free_context(fsm);
     return NULL;
   }
 
+  fsm->allocated = TRUE;
+
   return fsm;
 }
 
@@ -90,12 +196,14 @@ SilcFSMThread silc_fsm_thread_alloc(SilcFSM fsm,
 {
   SilcFSMThread thread;
 
-  thread = silc_calloc(1, sizeof(*thread));
+  thread = (SilcFSMThread)silc_fsm_alloc_context();
   if (silc_unlikely(!thread))
     return NULL;
 
   silc_fsm_thread_init(thread, fsm, thread_context, destructor,
 		       destructor_context, real_thread);
+  thread->allocated = TRUE;
+  thread->profiling = fsm->profiling;
   return thread;
 }
 
@@ -159,7 +267,13 @@ SILC_TASK_CALLBACK(silc_fsm_free_final)
   if (!f->thread)
     silc_atomic_uninit32(&f->u.m.threads);
 
-  silc_free(f);
+  if (!f->thread && f->u.m.profile)
+    silc_hash_table_free(f->u.m.profile);
+
+  if (f->allocated)
+    silc_fsm_free_context(f);
+  else
+    silc_free(f);
 }
 
 /* Free FSM */
@@ -302,6 +416,48 @@ void silc_fsm_continue(void *fsm)
   silc_schedule_wakeup(f->schedule);
 }
 
+/* Migrate machine to another scheduler */
+
+SilcBool silc_fsm_migrate(void *fsm, SilcSchedule schedule)
+{
+  SilcFSM f = fsm;
+  SilcSchedule old;
+  SilcBool queued;
+
+  if (!f || !schedule || f->thread || f->finished) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* A pending next_later timeout or an event timed wait belongs to the
+     old scheduler and its remaining time cannot be carried over; the
+     machine is not at a migratable state boundary. */
+  if (f->next_later || f->event) {
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return FALSE;
+  }
+
+  old = f->schedule;
+  if (old == schedule)
+    return TRUE;
+
+  SILC_LOG_DEBUG(("Migrating fsm %p from schedule %p to %p", f, old,
+		  schedule));
+
+  /* Move a queued continuation to the new scheduler */
+  queued = silc_schedule_task_del_by_all(old, 0, silc_fsm_run, f);
+
+  f->schedule = schedule;
+
+  if (queued) {
+    if (!silc_schedule_task_add_timeout(f->schedule, silc_fsm_run, f, 0, 0))
+      return FALSE;
+    silc_schedule_wakeup(f->schedule);
+  }
+
+  return TRUE;
+}
+
 /* Continue after callback or async operation immediately */
 
 void silc_fsm_continue_sync(void *fsm)
@@ -430,9 +586,23 @@ SILC_TASK_CALLBACK(silc_fsm_run)
   SILC_LOG_DEBUG(("Running %s %p", fsm->thread ? "thread" : "FSM", fsm));
 
   /* Run the states */
-  do
-    status = fsm->next_state(fsm, fsm->fsm_context, fsm->state_context);
-  while (status == SILC_FSM_ST_CONTINUE);
+  if (silc_unlikely(fsm->profiling)) {
+    SilcFSM machine = fsm->thread ? fsm->u.t.fsm : fsm;
+    SilcFSMStateCallback state;
+    SilcTimerStruct timer;
+
+    do {
+      state = fsm->next_state;
+      silc_timer_start(&timer);
+      status = fsm->next_state(fsm, fsm->fsm_context, fsm->state_context);
+      silc_timer_stop(&timer);
+      silc_fsm_profile_record(machine, state, &timer);
+    } while (status == SILC_FSM_ST_CONTINUE);
+  } else {
+    do
+      status = fsm->next_state(fsm, fsm->fsm_context, fsm->state_context);
+    while (status == SILC_FSM_ST_CONTINUE);
+  }
 
   switch (status) {
   case SILC_FSM_ST_YIELD:
@@ -672,6 +842,38 @@ SILC_TASK_CALLBACK(silc_fsm_signal)
     return;
   }
 
+  /* Batched signal; wake all waiters of this scheduler in this one
+     scheduler pass instead of one task per waiter. */
+  if (!p->fsm) {
+    SilcFSM *batch;
+    SilcUInt32 i, count = 0;
+
+    batch = silc_malloc(silc_list_count(p->event->waiters) *
+			sizeof(*batch));
+    if (silc_unlikely(!batch)) {
+      silc_mutex_unlock(lock);
+      silc_fsm_event_unref(p->event);
+      silc_free(p);
+      return;
+    }
+
+    silc_list_start(p->event->waiters);
+    while ((fsm = silc_list_get(p->event->waiters)) && count < p->count)
+      if (fsm->schedule == schedule)
+	batch[count++] = fsm;
+    silc_mutex_unlock(lock);
+
+    SILC_LOG_DEBUG(("Signalling %d waiters", count));
+
+    for (i = 0; i < count; i++)
+      silc_fsm_continue_sync(batch[i]);
+
+    silc_free(batch);
+    silc_fsm_event_unref(p->event);
+    silc_free(p);
+    return;
+  }
+
   /* If the waiter is not waiting anymore, don't deliver the signal.  It
      can happen if there were multiple signallers and the waiter went away
      after the first signal. */
@@ -697,43 +899,92 @@ SILC_TASK_CALLBACK(silc_fsm_signal)
   silc_free(p);
 }
 
-/* Signal event */
+/* Signal event, waking at most `count' waiters */
 
-void silc_fsm_event_signal(SilcFSMEvent event)
+static void silc_fsm_event_signal_int(SilcFSMEvent event, SilcUInt32 count)
 {
   SilcFSM fsm;
   SilcFSMEventSignal p;
   SilcMutex lock = event->fsm->u.m.lock;
+  SilcSchedule schedules[8];
+  SilcUInt32 scount[8];
+  SilcUInt32 num_schedules = 0, i, n = 0;
 
   SILC_LOG_DEBUG(("Signal event %p", event));
 
   silc_mutex_lock(lock);
 
   event->value++;
+
+  /* Group the waiters by scheduler; one batched wakeup task is added per
+     scheduler instead of one task per waiter. */
   silc_list_start(event->waiters);
-  while ((fsm = silc_list_get(event->waiters))) {
+  while ((fsm = silc_list_get(event->waiters)) && n < count) {
+    n++;
+
     if (fsm->event) {
       silc_schedule_task_del_by_all(fsm->schedule, 0, silc_fsm_event_timedout,
 				    fsm);
       fsm->event = NULL;
     }
 
+    for (i = 0; i < num_schedules; i++)
+      if (schedules[i] == fsm->schedule)
+	break;
+    if (i < num_schedules) {
+      scount[i]++;
+      continue;
+    }
+    if (num_schedules < 8) {
+      schedules[num_schedules] = fsm->schedule;
+      scount[num_schedules++] = 1;
+      continue;
+    }
+
+    /* More distinct schedulers than we track; signal this one alone */
     p = silc_calloc(1, sizeof(*p));
     if (silc_unlikely(!p))
       continue;
     p->event = event;
     p->fsm = fsm;
     silc_fsm_event_ref(event);
-
-    /* Signal through scheduler.  Wake up destination scheduler in case
-       caller is a real thread. */
     silc_schedule_task_add_timeout(fsm->schedule, silc_fsm_signal, p, 0, 0);
     silc_schedule_wakeup(fsm->schedule);
   }
 
+  /* Add one batched signal task per scheduler.  Wake up destination
+     scheduler in case caller is a real thread. */
+  for (i = 0; i < num_schedules; i++) {
+    p = silc_calloc(1, sizeof(*p));
+    if (silc_unlikely(!p))
+      continue;
+    p->event = event;
+    p->fsm = NULL;
+    p->count = scount[i];
+    silc_fsm_event_ref(event);
+    silc_schedule_task_add_timeout(schedules[i], silc_fsm_signal, p, 0, 0);
+    silc_schedule_wakeup(schedules[i]);
+  }
+
   silc_mutex_unlock(lock);
 }
 
+/* Signal event */
+
+void silc_fsm_event_signal(SilcFSMEvent event)
+{
+  silc_fsm_event_signal_int(event, (SilcUInt32)-1);
+}
+
+/* Signal event to a bounded number of waiters */
+
+void silc_fsm_event_signal_n(SilcFSMEvent event, SilcUInt32 count)
+{
+  if (!count)
+    return;
+  silc_fsm_event_signal_int(event, count);
+}
+
 /* Post thread termination event.  Special function used only to
    signal thread termination when SILC_FSM_THREAD_WAIT was used. */
 
@@ -806,3 +1057,266 @@ void *silc_fsm_thread(void *context)
 
   return NULL;
 }
+
+/**************************** State profiling *******************************/
+
+/* Profile entry destructor */
+
+static void silc_fsm_profile_destructor(void *key, void *context,
+					void *user_context)
+{
+  silc_free(context);
+}
+
+/* Enable or disable per-state profiling */
+
+SilcBool silc_fsm_set_profiling(void *fsm, SilcBool enabled)
+{
+  SilcFSM f = fsm, machine;
+
+  machine = f->thread ? f->u.t.fsm : f;
+
+  if (enabled) {
+    if (!machine->u.m.profile) {
+      machine->u.m.profile =
+	silc_hash_table_alloc(NULL, 0, silc_hash_ptr, NULL, NULL, NULL,
+			      silc_fsm_profile_destructor, NULL, TRUE);
+      if (!machine->u.m.profile)
+	return FALSE;
+    }
+    f->profiling = TRUE;
+    machine->profiling = TRUE;
+    return TRUE;
+  }
+
+  f->profiling = FALSE;
+  return TRUE;
+}
+
+/* Return recorded per-state profile, sorted by cumulative runtime */
+
+SilcFSMStateProfile silc_fsm_get_profile(void *fsm, SilcUInt32 *ret_count)
+{
+  SilcFSM f = fsm, machine;
+  SilcFSMStateProfile profile;
+  SilcFSMStateProfileInt entry;
+  SilcHashTableList htl;
+  SilcUInt32 count, i = 0, k;
+
+  machine = f->thread ? f->u.t.fsm : f;
+
+  if (!machine->u.m.profile) {
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return NULL;
+  }
+
+  if (machine->u.m.lock)
+    silc_mutex_lock(machine->u.m.lock);
+
+  count = silc_hash_table_count(machine->u.m.profile);
+  if (!count) {
+    if (machine->u.m.lock)
+      silc_mutex_unlock(machine->u.m.lock);
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  profile = silc_calloc(count, sizeof(*profile));
+  if (!profile) {
+    if (machine->u.m.lock)
+      silc_mutex_unlock(machine->u.m.lock);
+    return NULL;
+  }
+
+  /* Copy sorted, most expensive state first */
+  silc_hash_table_list(machine->u.m.profile, &htl);
+  while (silc_hash_table_get(&htl, NULL, (void *)&entry)) {
+    for (k = i; k > 0; k--) {
+      if (profile[k - 1].total_usec >= entry->total_usec)
+	break;
+      profile[k] = profile[k - 1];
+    }
+    profile[k].state = entry->state;
+    profile[k].calls = entry->calls;
+    profile[k].total_usec = entry->total_usec;
+    i++;
+  }
+  silc_hash_table_list_reset(&htl);
+
+  if (machine->u.m.lock)
+    silc_mutex_unlock(machine->u.m.lock);
+
+  if (ret_count)
+    *ret_count = count;
+
+  return profile;
+}
+
+/*************************** Coroutine threads ******************************/
+
+#ifdef SILC_FSM_CORO
+
+/* Coroutine stack size */
+#define SILC_FSM_CORO_STACK_SIZE 131072
+
+/* Maximum number of pooled coroutine stacks */
+#define SILC_FSM_CORO_POOL_MAX 32
+
+/* Coroutine context */
+typedef struct SilcFSMCoroStruct {
+  ucontext_t caller;		       /* Scheduler side context */
+  ucontext_t coro;		       /* Coroutine side context */
+  SilcFSMCoroFunc func;		       /* The coroutine function */
+  void *func_context;
+  SilcFSMThread thread;		       /* The FSM thread */
+  struct SilcFSMCoroStruct *next;      /* Pool list */
+  unsigned int done : 1;	       /* Coroutine function returned */
+  /* The stack follows */
+} *SilcFSMCoro;
+
+/* Pooled coroutine stacks */
+static SilcFSMCoro silc_fsm_coro_pool = NULL;
+static SilcUInt32 silc_fsm_coro_pool_count = 0;
+static SilcMutex silc_fsm_coro_pool_lock = NULL;
+
+SILC_FSM_STATE(silc_fsm_coro_state);
+
+/* Returns coroutine context to the pool */
+
+static void silc_fsm_coro_put(SilcFSMCoro coro)
+{
+  silc_mutex_lock(silc_fsm_coro_pool_lock);
+  if (silc_fsm_coro_pool_count < SILC_FSM_CORO_POOL_MAX) {
+    coro->next = silc_fsm_coro_pool;
+    silc_fsm_coro_pool = coro;
+    silc_fsm_coro_pool_count++;
+    silc_mutex_unlock(silc_fsm_coro_pool_lock);
+    return;
+  }
+  silc_mutex_unlock(silc_fsm_coro_pool_lock);
+  silc_free(coro);
+}
+
+/* The coroutine entry point.  The context pointer is passed as two
+   integers because makecontext arguments are ints. */
+
+static void silc_fsm_coro_trampoline(unsigned int hi, unsigned int lo)
+{
+  SilcFSMCoro coro =
+    SILC_64_TO_PTR((((SilcUInt64)hi << 32) | (SilcUInt64)lo));
+
+  coro->func(coro->thread, coro->func_context);
+
+  /* The synchronous code is done; return to the scheduler side */
+  coro->done = TRUE;
+  swapcontext(&coro->coro, &coro->caller);
+}
+
+/* The FSM state that hosts the coroutine.  Each entry resumes the
+   coroutine; the state waits while the coroutine is blocked in
+   silc_fsm_coro_wait and finishes when the coroutine function returns. */
+
+SILC_FSM_STATE(silc_fsm_coro_state)
+{
+  SilcFSMCoro coro = state_context;
+
+  /* Resume the coroutine */
+  swapcontext(&coro->caller, &coro->coro);
+
+  if (coro->done) {
+    silc_fsm_coro_put(coro);
+    return SILC_FSM_FINISH;
+  }
+
+  return SILC_FSM_WAIT;
+}
+
+/* Start synchronous-looking code in the FSM thread */
+
+SilcBool silc_fsm_coro_start(SilcFSMThread thread, SilcFSMCoroFunc func,
+			     void *func_context)
+{
+  SilcFSMCoro coro = NULL;
+
+  if (!silc_fsm_coro_pool_lock)
+    silc_mutex_alloc(&silc_fsm_coro_pool_lock);
+
+  /* Get pooled stack or allocate new one */
+  silc_mutex_lock(silc_fsm_coro_pool_lock);
+  if (silc_fsm_coro_pool) {
+    coro = silc_fsm_coro_pool;
+    silc_fsm_coro_pool = coro->next;
+    silc_fsm_coro_pool_count--;
+  }
+  silc_mutex_unlock(silc_fsm_coro_pool_lock);
+
+  if (!coro) {
+    coro = silc_malloc(sizeof(*coro) + SILC_FSM_CORO_STACK_SIZE);
+    if (!coro)
+      return FALSE;
+  }
+
+  coro->func = func;
+  coro->func_context = func_context;
+  coro->thread = thread;
+  coro->next = NULL;
+  coro->done = FALSE;
+
+  if (getcontext(&coro->coro)) {
+    silc_free(coro);
+    return FALSE;
+  }
+  coro->coro.uc_stack.ss_sp = (unsigned char *)(coro + 1);
+  coro->coro.uc_stack.ss_size = SILC_FSM_CORO_STACK_SIZE;
+  coro->coro.uc_link = NULL;
+  makecontext(&coro->coro, (void (*)(void))silc_fsm_coro_trampoline, 2,
+	      (unsigned int)(SILC_PTR_TO_64(coro) >> 32),
+	      (unsigned int)(SILC_PTR_TO_64(coro) & 0xffffffff));
+
+  silc_fsm_set_state_context(thread, coro);
+  silc_fsm_start(thread, silc_fsm_coro_state);
+
+  return TRUE;
+}
+
+/* Yield from the coroutine back to the scheduler */
+
+void silc_fsm_coro_yield(SilcFSMThread thread)
+{
+  SilcFSMCoro coro = silc_fsm_get_state_context(thread);
+  swapcontext(&coro->coro, &coro->caller);
+}
+
+/* Wait for event inside the coroutine */
+
+SilcUInt32 silc_fsm_coro_wait(SilcFSMEvent event, SilcFSMThread thread)
+{
+  SilcUInt32 ret;
+
+  /* Register as waiter and yield until the event is signalled, exactly
+     as state-split code does with SILC_FSM_EVENT_WAIT. */
+  while (!(ret = silc_fsm_event_wait(event, thread)))
+    silc_fsm_coro_yield(thread);
+
+  return ret;
+}
+
+#else /* !SILC_FSM_CORO */
+
+SilcBool silc_fsm_coro_start(SilcFSMThread thread, SilcFSMCoroFunc func,
+			     void *func_context)
+{
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+}
+
+void silc_fsm_coro_yield(SilcFSMThread thread)
+{
+}
+
+SilcUInt32 silc_fsm_coro_wait(SilcFSMEvent event, SilcFSMThread thread)
+{
+  return 0;
+}
+
+#endif /* SILC_FSM_CORO */
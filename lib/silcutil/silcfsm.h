@@ -731,6 +731,31 @@ void silc_fsm_continue(void *fsm);
  ***/
 void silc_fsm_continue_sync(void *fsm);
 
+/****f* silcutil/silc_fsm_migrate
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_fsm_migrate(void *fsm, SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Moves the machine `fsm' to run on the `schedule', so a rebalancer
+ *    can even out per-core load in multi-scheduler setups without
+ *    disconnecting clients.  After this silc_fsm_get_schedule returns
+ *    the new scheduler and all continuations run in it.  Any file
+ *    descriptors the machine's streams use must be moved separately
+ *    with silc_schedule_transfer_fd before data is next expected.
+ *
+ *    The machine must be at a state boundary: either waiting in
+ *    SILC_FSM_WAIT for silc_fsm_continue, or queued to run (a queued
+ *    continuation is moved to the new scheduler).  FSM threads cannot
+ *    be migrated separately from their machine, and a machine with a
+ *    pending silc_fsm_next_later timeout or an event timed wait
+ *    cannot be migrated; FALSE is returned in these cases.
+ *
+ ***/
+SilcBool silc_fsm_migrate(void *fsm, SilcSchedule schedule);
+
 /****f* silcutil/silc_fsm_finish
  *
  * SYNOPSIS
@@ -1070,4 +1095,144 @@ do {						\
 
 #include "silcfsm_i.h"
 
+/****s* silcutil/SilcFSMStateProfile
+ *
+ * NAME
+ *
+ *    typedef struct SilcFSMStateProfileStruct *SilcFSMStateProfile;
+ *
+ * DESCRIPTION
+ *
+ *    One state's profile entry returned by silc_fsm_get_profile.
+ *
+ * SOURCE
+ */
+typedef struct SilcFSMStateProfileStruct {
+  SilcFSMStateCallback state;	     /* The state function */
+  SilcUInt32 calls;		     /* Number of entries to the state */
+  SilcUInt64 total_usec;	     /* Cumulative runtime, microseconds */
+} *SilcFSMStateProfile;
+/***/
+
+/****f* silcutil/silc_fsm_set_profiling
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_fsm_set_profiling(void *fsm, SilcBool enabled);
+ *
+ * DESCRIPTION
+ *
+ *    Enables or disables per-state profiling of the machine (or the
+ *    machine of the thread) `fsm'.  While enabled, every state entry is
+ *    counted and timed.  FSM threads allocated after enabling inherit
+ *    the setting.  Profiling adds a small overhead per state execution.
+ *
+ ***/
+SilcBool silc_fsm_set_profiling(void *fsm, SilcBool enabled);
+
+/****f* silcutil/silc_fsm_get_profile
+ *
+ * SYNOPSIS
+ *
+ *    SilcFSMStateProfile silc_fsm_get_profile(void *fsm,
+ *                                             SilcUInt32 *ret_count);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the recorded per-state profile of the machine of `fsm' as
+ *    an array of `ret_count' entries sorted so that the state with the
+ *    largest cumulative runtime is first.  The caller must free the
+ *    array with silc_free.  Returns NULL if profiling is not enabled or
+ *    nothing has been recorded.
+ *
+ ***/
+SilcFSMStateProfile silc_fsm_get_profile(void *fsm, SilcUInt32 *ret_count);
+
+/****f* silcutil/silc_fsm_event_signal_n
+ *
+ * SYNOPSIS
+ *
+ *    void silc_fsm_event_signal_n(SilcFSMEvent event, SilcUInt32 count);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_fsm_event_signal but wakes up at most `count' waiters,
+ *    which is useful for work distribution patterns where one unit of
+ *    work should wake one (or a few) of many waiting FSM threads
+ *    instead of all of them.
+ *
+ ***/
+void silc_fsm_event_signal_n(SilcFSMEvent event, SilcUInt32 count);
+
+/****f* silcutil/SilcFSMCoroFunc
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcFSMCoroFunc)(SilcFSMThread thread, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    The coroutine function started with silc_fsm_coro_start.  The code
+ *    in the function may be written in normal synchronous style; waits
+ *    are done with silc_fsm_coro_wait, which suspends the coroutine
+ *    without blocking the real thread.  When the function returns the
+ *    FSM thread finishes.
+ *
+ ***/
+typedef void (*SilcFSMCoroFunc)(SilcFSMThread thread, void *context);
+
+/****f* silcutil/silc_fsm_coro_start
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_fsm_coro_start(SilcFSMThread thread,
+ *                                 SilcFSMCoroFunc func, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Starts the FSM thread `thread' (initialized with
+ *    silc_fsm_thread_init) running the coroutine function `func' instead
+ *    of explicit machine states.  The function runs on its own pooled
+ *    execution stack and may call silc_fsm_coro_wait to wait for events
+ *    in the middle of straight-line code, without splitting the logic
+ *    into states around every wait.  The stack is recycled when the
+ *    function returns.  Returns FALSE if coroutines are not supported
+ *    on the platform.
+ *
+ ***/
+SilcBool silc_fsm_coro_start(SilcFSMThread thread, SilcFSMCoroFunc func,
+			     void *context);
+
+/****f* silcutil/silc_fsm_coro_wait
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_fsm_coro_wait(SilcFSMEvent event,
+ *                                  SilcFSMThread thread);
+ *
+ * DESCRIPTION
+ *
+ *    Waits for the `event' inside a coroutine started with
+ *    silc_fsm_coro_start, suspending the coroutine until the event is
+ *    signalled.  Returns like silc_fsm_event_wait.  Must only be called
+ *    from inside the coroutine function.
+ *
+ ***/
+SilcUInt32 silc_fsm_coro_wait(SilcFSMEvent event, SilcFSMThread thread);
+
+/****f* silcutil/silc_fsm_coro_yield
+ *
+ * SYNOPSIS
+ *
+ *    void silc_fsm_coro_yield(SilcFSMThread thread);
+ *
+ * DESCRIPTION
+ *
+ *    Yields from inside a coroutine back to the scheduler; the coroutine
+ *    continues when the FSM thread continues (see silc_fsm_continue).
+ *    Normally silc_fsm_coro_wait is used instead.
+ *
+ ***/
+void silc_fsm_coro_yield(SilcFSMThread thread);
+
 #endif /* SILCFSM_H */
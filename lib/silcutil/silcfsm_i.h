@@ -59,6 +59,7 @@ struct SilcFSMObject {
     struct {
       SilcAtomic32 threads;		/* Number of threads */
       SilcMutex lock;		        /* Lock, valid if using real threads */
+      SilcHashTable profile;		/* Per-state profile, if enabled */
     } m;
 
     /* Thread */
@@ -75,12 +76,17 @@ struct SilcFSMObject {
   unsigned int synchronous      : 1;    /* Set if silc_fsm_start_sync called */
   unsigned int next_later       : 1;    /* Set if silc_fsm_next_later called */
   unsigned int started          : 1;    /* Set when started and not finished */
+  unsigned int allocated        : 1;    /* Set if from silc_fsm_alloc */
+  unsigned int profiling        : 1;    /* Set if profiling is enabled */
 };
 
 /* Event signal context */
 typedef struct {
   SilcFSMEvent event;		        /* Event */
-  SilcFSM fsm;				/* Signalled FSM */
+  SilcFSM fsm;				/* Signalled FSM, or NULL for a
+					   batched signal to all waiters of
+					   the delivering scheduler */
+  SilcUInt32 count;			/* Batched signal waiter limit */
 } *SilcFSMEventSignal;
 
 /* Used internally by the SILC_FSM_CALL macros to detect whether async
@@ -21,6 +21,19 @@
 
 /****************************** Global Storage ******************************/
 
+/* Generation of the shared variables.  Bumped whenever a shared variable
+   is replaced or deleted, invalidating the per-thread read caches. */
+static volatile SilcUInt32 silc_global_generation = 1;
+
+/* Read cache key destructor; the cached variable itself is owned by the
+   shared table. */
+
+static void silc_global_cache_destructor(void *key, void *context,
+					 void *user_context)
+{
+  silc_free(key);
+}
+
 /* Set global variable */
 
 void *silc_global_set_var(const char *name, SilcUInt32 variable_size,
@@ -90,6 +103,9 @@ void *silc_global_set_var(const char *name, SilcUInt32 variable_size,
     silc_mutex_lock(tls->lock);
     ret = silc_hash_table_set(tls->variables, var_name, var);
     silc_mutex_unlock(tls->lock);
+
+    /* Invalidate read caches; the variable pointer may have changed */
+    silc_global_generation++;
   } else {
     ret = silc_hash_table_set(tls->tls_variables, var_name, var);
   }
@@ -130,9 +146,35 @@ void *silc_global_get_var(const char *name, SilcBool in_tls)
   }
 
   if (!in_tls) {
+    /* Serve shared variables from the thread's read cache without the
+       lock.  The cache is invalidated by generation whenever a shared
+       variable is replaced or deleted. */
+    if (tls->var_cache) {
+      if (tls->var_cache_gen != silc_global_generation) {
+	silc_hash_table_free(tls->var_cache);
+	tls->var_cache = NULL;
+      } else if (silc_hash_table_find(tls->var_cache, (void *)name, NULL,
+				      &variable)) {
+	return variable;
+      }
+    }
+
     silc_mutex_lock(tls->lock);
     ret = silc_hash_table_find(tls->variables, (void *)name, NULL, &variable);
     silc_mutex_unlock(tls->lock);
+
+    if (ret) {
+      /* Cache for lock-free rereads */
+      if (!tls->var_cache) {
+	tls->var_cache =
+	  silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+				silc_hash_string_compare, NULL,
+				silc_global_cache_destructor, NULL, TRUE);
+	tls->var_cache_gen = silc_global_generation;
+      }
+      if (tls->var_cache)
+	silc_hash_table_set(tls->var_cache, silc_strdup(name), variable);
+    }
   } else {
     ret = silc_hash_table_find(tls->tls_variables, (void *)name, NULL,
 			       &variable);
@@ -167,6 +209,9 @@ SilcBool silc_global_del_var(const char *name, SilcBool in_tls)
     return FALSE;
   }
 
+  if (!in_tls)
+    silc_global_generation++;
+
   return silc_hash_table_del(in_tls ? tls->tls_variables : tls->variables,
 			     (void *)name);
 }
@@ -56,13 +56,31 @@
 typedef struct SilcHashTableEntryStruct {
   void *key;
   void *context;
+  SilcUInt32 hash;		/* Cached hash of the key */
   struct SilcHashTableEntryStruct *next;
 } *SilcHashTableEntry;
 
+/* Flat (open addressing) table slot.  Key and context are stored inline
+   in one array; collisions are resolved by linear probing, so lookups
+   touch consecutive cache lines instead of chasing chain pointers. */
+typedef struct SilcHashTableFlatSlotStruct {
+  void *key;
+  void *context;
+  SilcUInt32 hash;
+} SilcHashTableFlatSlot;
+
+/* Flat slot states */
+#define SILC_HASH_FLAT_EMPTY 0
+#define SILC_HASH_FLAT_USED  1
+#define SILC_HASH_FLAT_DEL   2
+
 /* Hash table. */
 struct SilcHashTableStruct {
   SilcStack stack;
   SilcHashTableEntry *table;
+  SilcHashTableFlatSlot *ftable; /* Flat mode: slot array */
+  unsigned char *fstate;	 /* Flat mode: slot states */
+  SilcUInt32 fsize;		 /* Flat mode: capacity (power of two) */
   SilcUInt32 table_size;
   SilcUInt32 entry_count;
   SilcHashFunction hash;
@@ -71,7 +89,14 @@ struct SilcHashTableStruct {
   void *hash_user_context;
   void *compare_user_context;
   void *destructor_user_context;
+  SilcHashTableEntry free_entries;/* Recycled entry nodes */
+  SilcUInt32 free_count;	 /* Number of recycled nodes */
+  SilcHashTableEntry *old_table; /* Old table during incremental rehash */
+  SilcUInt32 old_table_size;	 /* Old table size index */
+  SilcUInt32 migrate_index;	 /* Next old bucket to migrate */
   unsigned int auto_rehash : 1;
+  unsigned int flat        : 1;	 /* Set for open addressing mode */
+  unsigned int no_incremental : 1; /* Rehash in one sweep, never migrate */
 };
 
 /* Prime sizes for the hash table. The size of the table will always
@@ -103,6 +128,243 @@ static SilcUInt32 silc_hash_table_primesize(SilcUInt32 size, SilcUInt32 *index)
   return primesize[i - 1];
 }
 
+/* Maximum number of entry nodes kept in the per-table recycler */
+#define SILC_HASH_ENTRY_POOL_MAX 1024
+
+/* Allocates an entry node, recycling from the pool when possible */
+
+static inline SilcHashTableEntry silc_hash_table_entry_alloc(SilcHashTable ht)
+{
+  SilcHashTableEntry e = ht->free_entries;
+
+  if (e) {
+    ht->free_entries = e->next;
+    ht->free_count--;
+    e->key = e->context = NULL;
+    e->next = NULL;
+    return e;
+  }
+
+  return silc_scalloc(ht->stack, 1, sizeof(*e));
+}
+
+/* Returns an entry node to the pool */
+
+static inline void silc_hash_table_entry_free(SilcHashTable ht,
+					      SilcHashTableEntry e)
+{
+  if (ht->free_count < SILC_HASH_ENTRY_POOL_MAX) {
+    e->next = ht->free_entries;
+    ht->free_entries = e;
+    ht->free_count++;
+    return;
+  }
+
+  silc_sfree(ht->stack, e);
+}
+
+/* Incremental rehashing.  Tables larger than this migrate to the new
+   size a bounded number of buckets per operation instead of in one
+   blocking sweep over every entry. */
+#define SILC_HASH_INCREMENTAL_MIN 4096
+#define SILC_HASH_MIGRATE_BUCKETS 8
+
+static void silc_hash_table_rehash_start(SilcHashTable ht);
+
+/* Moves all entries of old table bucket `i' to the current table.  Must
+   only be called during incremental rehash. */
+
+static void silc_hash_table_migrate_bucket(SilcHashTable ht, SilcUInt32 i)
+{
+  SilcHashTableEntry e, next, *np;
+  SilcUInt32 idx;
+
+  e = ht->old_table[i];
+  ht->old_table[i] = NULL;
+
+  while (e) {
+    next = e->next;
+    idx = e->hash % primesize[ht->table_size];
+
+    /* Append to preserve the order of duplicate keys */
+    np = &ht->table[idx];
+    while (*np)
+      np = &(*np)->next;
+    e->next = NULL;
+    *np = e;
+
+    e = next;
+  }
+}
+
+/* Migrates up to `buckets' buckets from the old table, releasing the old
+   table when all buckets have moved. */
+
+static void silc_hash_table_migrate(SilcHashTable ht, SilcUInt32 buckets)
+{
+  SilcUInt32 size = primesize[ht->old_table_size];
+
+  while (buckets-- && ht->migrate_index < size)
+    silc_hash_table_migrate_bucket(ht, ht->migrate_index++);
+
+  if (ht->migrate_index >= size) {
+    silc_sfree(ht->stack, ht->old_table);
+    ht->old_table = NULL;
+    ht->migrate_index = 0;
+  }
+}
+
+/* Finishes a pending incremental rehash */
+
+static void silc_hash_table_migrate_all(SilcHashTable ht)
+{
+  while (ht->old_table)
+    silc_hash_table_migrate(ht, 32);
+}
+
+/*************************** Flat table internals ***************************/
+
+static SilcBool silc_hash_table_flat_grow(SilcHashTable ht);
+
+/* Finds the slot of `key' in a flat table.  Returns the slot index of
+   the key, or the index of the first free slot if the key is not in the
+   table, to `ret_slot'.  Returns TRUE if the key was found. */
+
+static inline SilcBool
+silc_hash_table_flat_find_slot(SilcHashTable ht, void *key, SilcUInt32 hash,
+			       SilcHashCompare compare,
+			       void *compare_user_context,
+			       SilcUInt32 *ret_slot)
+{
+  SilcUInt32 i = hash & (ht->fsize - 1);
+  SilcUInt32 first_free = ht->fsize;
+
+  while (ht->fstate[i] != SILC_HASH_FLAT_EMPTY) {
+    if (ht->fstate[i] == SILC_HASH_FLAT_USED &&
+	ht->ftable[i].hash == hash &&
+	(compare ? compare(ht->ftable[i].key, key, compare_user_context) :
+	 ht->ftable[i].key == key)) {
+      *ret_slot = i;
+      return TRUE;
+    }
+    if (ht->fstate[i] == SILC_HASH_FLAT_DEL && first_free == ht->fsize)
+      first_free = i;
+    i = (i + 1) & (ht->fsize - 1);
+  }
+
+  *ret_slot = first_free != ht->fsize ? first_free : i;
+  return FALSE;
+}
+
+/* Adds or replaces entry in a flat table */
+
+static SilcBool silc_hash_table_flat_add(SilcHashTable ht, void *key,
+					 void *context, SilcUInt32 hash,
+					 SilcHashCompare compare,
+					 void *compare_user_context,
+					 SilcBool replace)
+{
+  SilcUInt32 i;
+
+  /* Keep the table at most 3/4 full */
+  if (silc_unlikely((ht->entry_count + 1) > ht->fsize - (ht->fsize >> 2)))
+    if (!silc_hash_table_flat_grow(ht))
+      return FALSE;
+
+  if (silc_hash_table_flat_find_slot(ht, key, hash, compare,
+				     compare_user_context, &i)) {
+    /* Key exists; flat tables hold unique keys, both add and replace
+       replace the old entry. */
+    if (replace && ht->destructor)
+      ht->destructor(ht->ftable[i].key, ht->ftable[i].context,
+		     ht->destructor_user_context);
+    ht->ftable[i].key = key;
+    ht->ftable[i].context = context;
+    return TRUE;
+  }
+
+  ht->fstate[i] = SILC_HASH_FLAT_USED;
+  ht->ftable[i].key = key;
+  ht->ftable[i].context = context;
+  ht->ftable[i].hash = hash;
+  ht->entry_count++;
+
+  return TRUE;
+}
+
+/* Doubles the flat table size */
+
+static SilcBool silc_hash_table_flat_grow(SilcHashTable ht)
+{
+  SilcHashTableFlatSlot *otable = ht->ftable;
+  unsigned char *ostate = ht->fstate;
+  SilcUInt32 osize = ht->fsize, i, slot;
+
+  ht->ftable = silc_scalloc(ht->stack, osize * 2, sizeof(*ht->ftable));
+  if (!ht->ftable) {
+    ht->ftable = otable;
+    return FALSE;
+  }
+  ht->fstate = silc_scalloc(ht->stack, osize * 2, sizeof(*ht->fstate));
+  if (!ht->fstate) {
+    silc_sfree(ht->stack, ht->ftable);
+    ht->ftable = otable;
+    ht->fstate = ostate;
+    return FALSE;
+  }
+  ht->fsize = osize * 2;
+
+  /* Reinsert; the stored hash makes this a probe without rehashing keys */
+  for (i = 0; i < osize; i++) {
+    if (ostate[i] != SILC_HASH_FLAT_USED)
+      continue;
+    slot = otable[i].hash & (ht->fsize - 1);
+    while (ht->fstate[slot] == SILC_HASH_FLAT_USED)
+      slot = (slot + 1) & (ht->fsize - 1);
+    ht->fstate[slot] = SILC_HASH_FLAT_USED;
+    ht->ftable[slot] = otable[i];
+  }
+
+  silc_sfree(ht->stack, otable);
+  silc_sfree(ht->stack, ostate);
+
+  return TRUE;
+}
+
+/* Deletes entry from a flat table */
+
+static SilcBool silc_hash_table_flat_del(SilcHashTable ht, void *key,
+					 SilcUInt32 hash,
+					 SilcHashCompare compare,
+					 void *compare_user_context,
+					 SilcBool check_context,
+					 void *context,
+					 SilcHashDestructor destructor,
+					 void *destructor_user_context)
+{
+  SilcUInt32 i;
+
+  if (!silc_hash_table_flat_find_slot(ht, key, hash, compare,
+				      compare_user_context, &i) ||
+      (check_context && ht->ftable[i].context != context)) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  if (destructor)
+    destructor(ht->ftable[i].key, ht->ftable[i].context,
+	       destructor_user_context);
+  else if (ht->destructor)
+    ht->destructor(ht->ftable[i].key, ht->ftable[i].context,
+		   ht->destructor_user_context);
+
+  ht->fstate[i] = SILC_HASH_FLAT_DEL;
+  ht->ftable[i].key = ht->ftable[i].context = NULL;
+  ht->entry_count--;
+
+  return TRUE;
+}
+
 /* Internal routine to find entry in the hash table by `key'. Returns
    the previous entry (if exists) as well. */
 
@@ -114,13 +376,23 @@ silc_hash_table_find_internal(SilcHashTable ht, void *key,
 			      void *compare_user_context)
 {
   SilcHashTableEntry *entry, prev = NULL;
-  SilcUInt32 i = SILC_HASH_TABLE_HASH(hash, hash_user_context);
+  SilcUInt32 i;
+
+  SilcUInt32 h = hash(key, hash_user_context);
+
+  if (silc_unlikely(ht->old_table != NULL))
+    silc_hash_table_migrate_bucket(ht, h % primesize[ht->old_table_size]);
+
+  i = h % primesize[ht->table_size];
 
   SILC_HT_DEBUG(("index %d key %p", i, key));
 
   entry = &ht->table[i];
   if (compare) {
-    while (*entry && !compare((*entry)->key, key, compare_user_context)) {
+    /* The cached hash rejects non-matching keys without calling the
+       comparison function. */
+    while (*entry && ((*entry)->hash != h ||
+		      !compare((*entry)->key, key, compare_user_context))) {
       prev = *entry;
       entry = &(*entry)->next;
     }
@@ -148,14 +420,20 @@ silc_hash_table_find_internal_context(SilcHashTable ht, void *key,
 				      void *compare_user_context)
 {
   SilcHashTableEntry *entry, prev = NULL;
-  SilcUInt32 i = SILC_HASH_TABLE_HASH(hash, hash_user_context);
+  SilcUInt32 i, h = hash(key, hash_user_context);
+
+  if (silc_unlikely(ht->old_table != NULL))
+    silc_hash_table_migrate_bucket(ht, h % primesize[ht->old_table_size]);
+
+  i = h % primesize[ht->table_size];
 
   SILC_HT_DEBUG(("index %d key %p context %p", i, key, context));
 
   entry = &ht->table[i];
   if (ht->compare) {
     while (*entry) {
-      if (compare((*entry)->key, key, compare_user_context) &&
+      if ((*entry)->hash == h &&
+	  compare((*entry)->key, key, compare_user_context) &&
 	  (*entry)->context == context)
 	break;
       prev = *entry;
@@ -185,13 +463,19 @@ silc_hash_table_find_internal_simple(SilcHashTable ht, void *key,
 				     void *compare_user_context)
 {
   SilcHashTableEntry *entry;
-  SilcUInt32 i = SILC_HASH_TABLE_HASH(hash, hash_user_context);
+  SilcUInt32 i, h = hash(key, hash_user_context);
+
+  if (silc_unlikely(ht->old_table != NULL))
+    silc_hash_table_migrate_bucket(ht, h % primesize[ht->old_table_size]);
+
+  i = h % primesize[ht->table_size];
 
   SILC_HT_DEBUG(("index %d key %p", i, key));
 
   entry = &ht->table[i];
   if (compare) {
-    while (*entry && !compare((*entry)->key, key, compare_user_context))
+    while (*entry && ((*entry)->hash != h ||
+		      !compare((*entry)->key, key, compare_user_context)))
       entry = &(*entry)->next;
   } else {
     while (*entry && (*entry)->key != key)
@@ -216,7 +500,26 @@ silc_hash_table_find_internal_all(SilcHashTable ht, void *key,
 {
   SilcHashTableEntry e, tmp;
   SilcBool auto_rehash, found = FALSE;
-  SilcUInt32 i = SILC_HASH_TABLE_HASH(hash, hash_user_context);
+  SilcUInt32 i, h;
+
+  if (ht->flat) {
+    /* Flat tables hold unique keys */
+    if (silc_hash_table_flat_find_slot(ht, key,
+				       hash(key, hash_user_context),
+				       compare, compare_user_context, &i))
+      foreach(ht->ftable[i].key, ht->ftable[i].context,
+	      foreach_user_context);
+    else
+      foreach(key, NULL, foreach_user_context);
+    return;
+  }
+
+  h = hash(key, hash_user_context);
+
+  if (silc_unlikely(ht->old_table != NULL))
+    silc_hash_table_migrate_bucket(ht, h % primesize[ht->old_table_size]);
+
+  i = h % primesize[ht->table_size];
 
   SILC_HT_DEBUG(("index %d key %p", i, key));
 
@@ -229,7 +532,7 @@ silc_hash_table_find_internal_all(SilcHashTable ht, void *key,
   if (compare) {
     while (e) {
       tmp = e->next;
-      if (compare(e->key, key, compare_user_context)) {
+      if (e->hash == h && compare(e->key, key, compare_user_context)) {
 	found = TRUE;
 	foreach(e->key, e->context, foreach_user_context);
       }
@@ -261,7 +564,14 @@ silc_hash_table_add_internal(SilcHashTable ht, void *key, void *context,
 			     void *hash_user_context)
 {
   SilcHashTableEntry *entry;
-  SilcUInt32 i = SILC_HASH_TABLE_HASH(hash, hash_user_context);
+  SilcUInt32 i, h = hash(key, hash_user_context);
+
+  if (silc_unlikely(ht->old_table != NULL)) {
+    silc_hash_table_migrate_bucket(ht, h % primesize[ht->old_table_size]);
+    silc_hash_table_migrate(ht, SILC_HASH_MIGRATE_BUCKETS);
+  }
+
+  i = h % primesize[ht->table_size];
 
   SILC_HT_DEBUG(("index %d key %p", i, key));
 
@@ -280,25 +590,27 @@ silc_hash_table_add_internal(SilcHashTable ht, void *key, void *context,
 
     SILC_HT_DEBUG(("Collision; adding new key to list"));
 
-    e->next = silc_scalloc(ht->stack, 1, sizeof(*e->next));
+    e->next = silc_hash_table_entry_alloc(ht);
     if (!e->next)
       return FALSE;
     e->next->key = key;
     e->next->context = context;
+    e->next->hash = h;
     ht->entry_count++;
   } else {
     /* New key */
     SILC_HT_DEBUG(("New key"));
-    *entry = silc_scalloc(ht->stack, 1, sizeof(**entry));
+    *entry = silc_hash_table_entry_alloc(ht);
     if (!(*entry))
       return FALSE;
     (*entry)->key = key;
     (*entry)->context = context;
+    (*entry)->hash = h;
     ht->entry_count++;
   }
 
   if (SILC_HASH_REHASH_INC)
-    silc_hash_table_rehash(ht, 0);
+    silc_hash_table_rehash_start(ht);
 
   return TRUE;
 }
@@ -311,7 +623,14 @@ silc_hash_table_replace_internal(SilcHashTable ht, void *key, void *context,
 				 void *hash_user_context)
 {
   SilcHashTableEntry *entry;
-  SilcUInt32 i = SILC_HASH_TABLE_HASH(hash, hash_user_context);
+  SilcUInt32 i, h = hash(key, hash_user_context);
+
+  if (silc_unlikely(ht->old_table != NULL)) {
+    silc_hash_table_migrate_bucket(ht, h % primesize[ht->old_table_size]);
+    silc_hash_table_migrate(ht, SILC_HASH_MIGRATE_BUCKETS);
+  }
+
+  i = h % primesize[ht->table_size];
 
   SILC_HT_DEBUG(("index %d key %p", i, key));
 
@@ -324,7 +643,7 @@ silc_hash_table_replace_internal(SilcHashTable ht, void *key, void *context,
 		     ht->destructor_user_context);
   } else {
     /* New key */
-    *entry = silc_scalloc(ht->stack, 1, sizeof(**entry));
+    *entry = silc_hash_table_entry_alloc(ht);
     if (!(*entry))
       return FALSE;
     ht->entry_count++;
@@ -332,6 +651,7 @@ silc_hash_table_replace_internal(SilcHashTable ht, void *key, void *context,
 
   (*entry)->key = key;
   (*entry)->context = context;
+  (*entry)->hash = h;
 
   if (SILC_HASH_REHASH_INC)
     silc_hash_table_rehash(ht, 0);
@@ -339,6 +659,42 @@ silc_hash_table_replace_internal(SilcHashTable ht, void *key, void *context,
   return TRUE;
 }
 
+/* Starts automatic rehash.  Small tables rehash in one sweep; large
+   tables switch to incremental migration so the caller never blocks for
+   more than a few buckets at a time. */
+
+static void silc_hash_table_rehash_start(SilcHashTable ht)
+{
+  SilcHashTableEntry *table;
+  SilcUInt32 size_index;
+
+  /* Only one migration at a time */
+  if (ht->old_table)
+    return;
+
+  if (ht->no_incremental ||
+      ht->entry_count <= SILC_HASH_INCREMENTAL_MIN) {
+    silc_hash_table_rehash(ht, 0);
+    return;
+  }
+
+  silc_hash_table_primesize(ht->entry_count, &size_index);
+  if (size_index == ht->table_size)
+    return;
+
+  table = silc_scalloc(ht->stack, primesize[size_index], sizeof(*table));
+  if (!table)
+    return;
+
+  SILC_HT_DEBUG(("Starting incremental rehash"));
+
+  ht->old_table = ht->table;
+  ht->old_table_size = ht->table_size;
+  ht->migrate_index = 0;
+  ht->table = table;
+  ht->table_size = size_index;
+}
+
 /* Allocates new hash table and returns it.  If the `table_size' is not
    zero then the hash table size is the size provided. If zero then the
    default size will be used. Note that if the `table_size' is provided
@@ -396,6 +752,64 @@ SilcHashTable silc_hash_table_alloc(SilcStack stack,
   return ht;
 }
 
+/* Allocates new open addressing (flat) hash table.  Entries are stored
+   inline in one array and probed linearly, avoiding the pointer chase of
+   the chained table.  Flat tables hold unique keys; adding an existing
+   key replaces the old entry. */
+
+SilcHashTable silc_hash_table_alloc_flat(SilcStack stack,
+					 SilcUInt32 table_size,
+					 SilcHashFunction hash,
+					 void *hash_user_context,
+					 SilcHashCompare compare,
+					 void *compare_user_context,
+					 SilcHashDestructor destructor,
+					 void *destructor_user_context)
+{
+  SilcHashTable ht;
+  SilcUInt32 size = 16;
+
+  if (!hash) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  /* Round requested size up to a power of two */
+  while (size < table_size)
+    size <<= 1;
+
+  if (stack)
+    stack = silc_stack_alloc(0, stack);
+
+  ht = silc_scalloc(stack, 1, sizeof(*ht));
+  if (!ht) {
+    silc_stack_free(stack);
+    return NULL;
+  }
+
+  ht->ftable = silc_scalloc(stack, size, sizeof(*ht->ftable));
+  ht->fstate = silc_scalloc(stack, size, sizeof(*ht->fstate));
+  if (!ht->ftable || !ht->fstate) {
+    silc_sfree(stack, ht->ftable);
+    silc_sfree(stack, ht->fstate);
+    silc_sfree(stack, ht);
+    silc_stack_free(stack);
+    return NULL;
+  }
+
+  ht->stack = stack;
+  ht->fsize = size;
+  ht->flat = TRUE;
+  ht->hash = hash;
+  ht->compare = compare;
+  ht->destructor = destructor;
+  ht->hash_user_context = hash_user_context;
+  ht->compare_user_context = compare_user_context;
+  ht->destructor_user_context = destructor_user_context;
+
+  return ht;
+}
+
 /* Frees the hash table. The destructor function provided in the
    silc_hash_table_alloc will be called for all keys in the hash table. */
 
@@ -405,6 +819,22 @@ void silc_hash_table_free(SilcHashTable ht)
   SilcHashTableEntry e, tmp;
   int i;
 
+  if (!ht->flat)
+    silc_hash_table_migrate_all(ht);
+
+  if (ht->flat) {
+    if (ht->destructor)
+      for (i = 0; i < ht->fsize; i++)
+	if (ht->fstate[i] == SILC_HASH_FLAT_USED)
+	  ht->destructor(ht->ftable[i].key, ht->ftable[i].context,
+			 ht->destructor_user_context);
+    silc_sfree(stack, ht->ftable);
+    silc_sfree(stack, ht->fstate);
+    silc_sfree(stack, ht);
+    silc_stack_free(stack);
+    return;
+  }
+
   for (i = 0; i < primesize[ht->table_size]; i++) {
     e = ht->table[i];
     while (e) {
@@ -416,6 +846,14 @@ void silc_hash_table_free(SilcHashTable ht)
     }
   }
 
+  /* Free recycled entry nodes */
+  e = ht->free_entries;
+  while (e) {
+    tmp = e->next;
+    silc_sfree(stack, e);
+    e = tmp;
+  }
+
   silc_sfree(stack, ht->table);
   silc_sfree(stack, ht);
   silc_stack_free(stack);
@@ -425,6 +863,8 @@ void silc_hash_table_free(SilcHashTable ht)
 
 SilcUInt32 silc_hash_table_size(SilcHashTable ht)
 {
+  if (ht->flat)
+    return ht->fsize;
   return primesize[ht->table_size];
 }
 
@@ -444,6 +884,11 @@ SilcUInt32 silc_hash_table_count(SilcHashTable ht)
 
 SilcBool silc_hash_table_add(SilcHashTable ht, void *key, void *context)
 {
+  if (ht->flat)
+    return silc_hash_table_flat_add(ht, key, context,
+				    ht->hash(key, ht->hash_user_context),
+				    ht->compare, ht->compare_user_context,
+				    FALSE);
   return silc_hash_table_add_internal(ht, key, context, ht->hash,
 				      ht->hash_user_context);
 }
@@ -454,6 +899,11 @@ SilcBool silc_hash_table_add_ext(SilcHashTable ht, void *key, void *context,
 				 SilcHashFunction hash,
 				 void *hash_user_context)
 {
+  if (ht->flat)
+    return silc_hash_table_flat_add(ht, key, context,
+				    hash(key, hash_user_context),
+				    ht->compare, ht->compare_user_context,
+				    FALSE);
   return silc_hash_table_add_internal(ht, key, context,
 				      hash, hash_user_context);
 }
@@ -465,6 +915,11 @@ SilcBool silc_hash_table_add_ext(SilcHashTable ht, void *key, void *context,
 
 SilcBool silc_hash_table_set(SilcHashTable ht, void *key, void *context)
 {
+  if (ht->flat)
+    return silc_hash_table_flat_add(ht, key, context,
+				    ht->hash(key, ht->hash_user_context),
+				    ht->compare, ht->compare_user_context,
+				    TRUE);
   return silc_hash_table_replace_internal(ht, key, context, ht->hash,
 					  ht->hash_user_context);
 }
@@ -476,6 +931,11 @@ SilcBool silc_hash_table_set_ext(SilcHashTable ht, void *key,
 				 SilcHashFunction hash,
 				 void *hash_user_context)
 {
+  if (ht->flat)
+    return silc_hash_table_flat_add(ht, key, context,
+				    hash(key, hash_user_context),
+				    ht->compare, ht->compare_user_context,
+				    TRUE);
   return silc_hash_table_replace_internal(ht, key, context,
 					  hash, hash_user_context);
 }
@@ -488,6 +948,12 @@ SilcBool silc_hash_table_del(SilcHashTable ht, void *key)
 {
   SilcHashTableEntry *entry, prev, e;
 
+  if (ht->flat)
+    return silc_hash_table_flat_del(ht, key,
+				    ht->hash(key, ht->hash_user_context),
+				    ht->compare, ht->compare_user_context,
+				    FALSE, NULL, NULL, NULL);
+
   entry = silc_hash_table_find_internal(ht, key, &prev,
 					ht->hash, ht->hash_user_context,
 					ht->compare, ht->compare_user_context);
@@ -509,12 +975,12 @@ SilcBool silc_hash_table_del(SilcHashTable ht, void *key)
 
   if (ht->destructor)
     ht->destructor(e->key, e->context, ht->destructor_user_context);
-  silc_sfree(ht->stack, e);
+  silc_hash_table_entry_free(ht, e);
 
   ht->entry_count--;
 
   if (SILC_HASH_REHASH_DEC)
-    silc_hash_table_rehash(ht, 0);
+    silc_hash_table_rehash_start(ht);
 
   return TRUE;
 }
@@ -531,6 +997,17 @@ SilcBool silc_hash_table_del_ext(SilcHashTable ht, void *key,
 {
   SilcHashTableEntry *entry, prev, e;
 
+  if (ht->flat)
+    return silc_hash_table_flat_del(ht, key,
+				    hash ? hash(key, hash_user_context) :
+				    ht->hash(key, ht->hash_user_context),
+				    compare ? compare : ht->compare,
+				    compare_user_context ?
+				    compare_user_context :
+				    ht->compare_user_context,
+				    FALSE, NULL, destructor,
+				    destructor_user_context);
+
   entry = silc_hash_table_find_internal(ht, key, &prev,
 					hash ? hash : ht->hash,
 					hash_user_context ? hash_user_context :
@@ -561,12 +1038,12 @@ SilcBool silc_hash_table_del_ext(SilcHashTable ht, void *key,
     if (ht->destructor)
       ht->destructor(e->key, e->context, ht->destructor_user_context);
   }
-  silc_sfree(ht->stack, e);
+  silc_hash_table_entry_free(ht, e);
 
   ht->entry_count--;
 
   if (SILC_HASH_REHASH_DEC)
-    silc_hash_table_rehash(ht, 0);
+    silc_hash_table_rehash_start(ht);
 
   return TRUE;
 }
@@ -581,6 +1058,12 @@ SilcBool silc_hash_table_del_by_context(SilcHashTable ht, void *key,
 {
   SilcHashTableEntry *entry, prev, e;
 
+  if (ht->flat)
+    return silc_hash_table_flat_del(ht, key,
+				    ht->hash(key, ht->hash_user_context),
+				    ht->compare, ht->compare_user_context,
+				    TRUE, context, NULL, NULL);
+
   entry = silc_hash_table_find_internal_context(ht, key, context, &prev,
 						ht->hash,
 						ht->hash_user_context,
@@ -604,12 +1087,12 @@ SilcBool silc_hash_table_del_by_context(SilcHashTable ht, void *key,
 
   if (ht->destructor)
     ht->destructor(e->key, e->context, ht->destructor_user_context);
-  silc_sfree(ht->stack, e);
+  silc_hash_table_entry_free(ht, e);
 
   ht->entry_count--;
 
   if (SILC_HASH_REHASH_DEC)
-    silc_hash_table_rehash(ht, 0);
+    silc_hash_table_rehash_start(ht);
 
   return TRUE;
 }
@@ -627,6 +1110,17 @@ SilcBool silc_hash_table_del_by_context_ext(SilcHashTable ht, void *key,
 {
   SilcHashTableEntry *entry, prev, e;
 
+  if (ht->flat)
+    return silc_hash_table_flat_del(ht, key,
+				    hash ? hash(key, hash_user_context) :
+				    ht->hash(key, ht->hash_user_context),
+				    compare ? compare : ht->compare,
+				    compare_user_context ?
+				    compare_user_context :
+				    ht->compare_user_context,
+				    TRUE, context, destructor,
+				    destructor_user_context);
+
   entry = silc_hash_table_find_internal_context(ht, key, context, &prev,
 						hash ? hash : ht->hash,
 						hash_user_context ?
@@ -659,12 +1153,12 @@ SilcBool silc_hash_table_del_by_context_ext(SilcHashTable ht, void *key,
     if (ht->destructor)
       ht->destructor(e->key, e->context, ht->destructor_user_context);
   }
-  silc_sfree(ht->stack, e);
+  silc_hash_table_entry_free(ht, e);
 
   ht->entry_count--;
 
   if (SILC_HASH_REHASH_DEC)
-    silc_hash_table_rehash(ht, 0);
+    silc_hash_table_rehash_start(ht);
 
   return TRUE;
 }
@@ -693,6 +1187,26 @@ SilcBool silc_hash_table_find_ext(SilcHashTable ht, void *key,
 {
   SilcHashTableEntry *entry;
 
+  if (ht->flat) {
+    SilcUInt32 i;
+
+    if (!silc_hash_table_flat_find_slot(ht, key,
+					hash ? hash(key, hash_user_context) :
+					ht->hash(key, ht->hash_user_context),
+					compare ? compare : ht->compare,
+					compare_user_context ?
+					compare_user_context :
+					ht->compare_user_context, &i)) {
+      silc_set_errno(SILC_ERR_NOT_FOUND);
+      return FALSE;
+    }
+    if (ret_key)
+      *ret_key = ht->ftable[i].key;
+    if (ret_context)
+      *ret_context = ht->ftable[i].context;
+    return TRUE;
+  }
+
   entry = silc_hash_table_find_internal_simple(ht, key,
 					       hash ? hash : ht->hash,
 					       hash_user_context ?
@@ -716,6 +1230,57 @@ SilcBool silc_hash_table_find_ext(SilcHashTable ht, void *key,
   return TRUE;
 }
 
+/* Finds entry with a caller-precomputed hash value.  The key is not
+   hashed; callers that look up the same key from several tables hash it
+   once with the table's hash function and pass the value here. */
+
+SilcBool silc_hash_table_find_precomputed(SilcHashTable ht, void *key,
+					  SilcUInt32 hash,
+					  void **ret_key, void **ret_context)
+{
+  SilcHashTableEntry *entry;
+  SilcUInt32 i;
+
+  if (ht->flat) {
+    if (!silc_hash_table_flat_find_slot(ht, key, hash, ht->compare,
+					ht->compare_user_context, &i)) {
+      silc_set_errno(SILC_ERR_NOT_FOUND);
+      return FALSE;
+    }
+    if (ret_key)
+      *ret_key = ht->ftable[i].key;
+    if (ret_context)
+      *ret_context = ht->ftable[i].context;
+    return TRUE;
+  }
+
+  if (silc_unlikely(ht->old_table != NULL))
+    silc_hash_table_migrate_bucket(ht, hash % primesize[ht->old_table_size]);
+
+  entry = &ht->table[hash % primesize[ht->table_size]];
+  if (ht->compare) {
+    while (*entry && ((*entry)->hash != hash ||
+		      !ht->compare((*entry)->key, key,
+				   ht->compare_user_context)))
+      entry = &(*entry)->next;
+  } else {
+    while (*entry && (*entry)->key != key)
+      entry = &(*entry)->next;
+  }
+
+  if (*entry == NULL) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  if (ret_key)
+    *ret_key = (*entry)->key;
+  if (ret_context)
+    *ret_context = (*entry)->context;
+
+  return TRUE;
+}
+
 /* Same as silc_hash_table_find but finds with specific context. */
 
 SilcBool silc_hash_table_find_by_context(SilcHashTable ht, void *key,
@@ -736,6 +1301,25 @@ SilcBool silc_hash_table_find_by_context_ext(SilcHashTable ht, void *key,
 {
   SilcHashTableEntry *entry;
 
+  if (ht->flat) {
+    SilcUInt32 i;
+
+    if (!silc_hash_table_flat_find_slot(ht, key,
+					hash ? hash(key, hash_user_context) :
+					ht->hash(key, ht->hash_user_context),
+					compare ? compare : ht->compare,
+					compare_user_context ?
+					compare_user_context :
+					ht->compare_user_context, &i) ||
+	ht->ftable[i].context != context) {
+      silc_set_errno(SILC_ERR_NOT_FOUND);
+      return FALSE;
+    }
+    if (ret_key)
+      *ret_key = ht->ftable[i].key;
+    return TRUE;
+  }
+
   entry = silc_hash_table_find_internal_context(ht, key, context, NULL,
 						hash ? hash : ht->hash,
 						hash_user_context ?
@@ -806,6 +1390,15 @@ void silc_hash_table_foreach(SilcHashTable ht, SilcHashForeach foreach,
   if (!foreach)
     return;
 
+  if (ht->flat) {
+    for (i = 0; i < ht->fsize; i++)
+      if (ht->fstate[i] == SILC_HASH_FLAT_USED)
+	foreach(ht->ftable[i].key, ht->ftable[i].context, user_context);
+    return;
+  }
+
+  silc_hash_table_migrate_all(ht);
+
   auto_rehash = ht->auto_rehash;
   ht->auto_rehash = FALSE;
   for (i = 0; i < primesize[ht->table_size]; i++) {
@@ -820,6 +1413,57 @@ void silc_hash_table_foreach(SilcHashTable ht, SilcHashForeach foreach,
   ht->auto_rehash = auto_rehash;
 }
 
+/* Traverse all entries against a consistent snapshot.  The entries are
+   first copied into a snapshot array in one fast sweep and the `foreach'
+   is then called on the copy, so the table is held exclusively only for
+   the duration of the copy instead of for every callback; readers and
+   writers may proceed while the callbacks run.  Entries added after the
+   snapshot are not seen and deleted entries may still be delivered. */
+
+void silc_hash_table_foreach_snapshot(SilcHashTable ht,
+				      SilcHashForeach foreach,
+				      void *user_context)
+{
+  SilcHashTableEntry e;
+  struct { void *key; void *context; } *snap;
+  SilcUInt32 i, count = 0;
+
+  if (!foreach)
+    return;
+
+  if (!ht->entry_count)
+    return;
+
+  snap = silc_malloc(ht->entry_count * sizeof(*snap));
+  if (!snap) {
+    /* Fall back to direct traversal */
+    silc_hash_table_foreach(ht, foreach, user_context);
+    return;
+  }
+
+  if (ht->flat) {
+    for (i = 0; i < ht->fsize && count < ht->entry_count; i++)
+      if (ht->fstate[i] == SILC_HASH_FLAT_USED) {
+	snap[count].key = ht->ftable[i].key;
+	snap[count].context = ht->ftable[i].context;
+	count++;
+      }
+  } else {
+    silc_hash_table_migrate_all(ht);
+    for (i = 0; i < primesize[ht->table_size]; i++)
+      for (e = ht->table[i]; e && count < ht->entry_count; e = e->next) {
+	snap[count].key = e->key;
+	snap[count].context = e->context;
+	count++;
+      }
+  }
+
+  for (i = 0; i < count; i++)
+    foreach(snap[i].key, snap[i].context, user_context);
+
+  silc_free(snap);
+}
+
 /* Rehashs the hash table. The size of the new hash table is provided
    as `new_size'. If the `new_size' is zero then this routine will make
    the new table of a suitable size. Note that this operation may be
@@ -834,6 +1478,17 @@ void silc_hash_table_rehash(SilcHashTable ht, SilcUInt32 new_size)
 
   SILC_HT_DEBUG(("Start"));
 
+  if (ht->flat) {
+    /* Flat tables only grow */
+    while (ht->fsize < new_size)
+      if (!silc_hash_table_flat_grow(ht))
+	return;
+    return;
+  }
+
+  /* Finish a pending incremental rehash first */
+  silc_hash_table_migrate_all(ht);
+
   if (new_size)
     silc_hash_table_primesize(new_size, &size_index);
   else
@@ -867,7 +1522,7 @@ void silc_hash_table_rehash(SilcHashTable ht, SilcUInt32 new_size)
       e = e->next;
 
       /* Remove old entry */
-      silc_sfree(ht->stack, tmp);
+      silc_hash_table_entry_free(ht, tmp);
     }
   }
 
@@ -890,6 +1545,16 @@ void silc_hash_table_rehash_ext(SilcHashTable ht, SilcUInt32 new_size,
 
   SILC_HT_DEBUG(("Start"));
 
+  if (ht->flat) {
+    while (ht->fsize < new_size)
+      if (!silc_hash_table_flat_grow(ht))
+	return;
+    return;
+  }
+
+  /* Finish a pending incremental rehash first */
+  silc_hash_table_migrate_all(ht);
+
   if (new_size)
     silc_hash_table_primesize(new_size, &size_index);
   else
@@ -924,7 +1589,7 @@ void silc_hash_table_rehash_ext(SilcHashTable ht, SilcUInt32 new_size,
       e = e->next;
 
       /* Remove old entry */
-      silc_sfree(ht->stack, tmp);
+      silc_hash_table_entry_free(ht, tmp);
     }
   }
 
@@ -940,6 +1605,9 @@ void silc_hash_table_rehash_ext(SilcHashTable ht, SilcUInt32 new_size,
 
 void silc_hash_table_list(SilcHashTable ht, SilcHashTableList *htl)
 {
+  if (!ht->flat)
+    silc_hash_table_migrate_all(ht);
+
   htl->ht = ht;
   htl->entry = NULL;
   htl->index = 0;
@@ -969,6 +1637,23 @@ SilcBool silc_hash_table_get(SilcHashTableList *htl, void **key,
   if (!htl->ht->entry_count)
     return FALSE;
 
+  if (htl->ht->flat) {
+    SilcHashTable ht = htl->ht;
+
+    while (htl->index < ht->fsize &&
+	   ht->fstate[htl->index] != SILC_HASH_FLAT_USED)
+      htl->index++;
+    if (htl->index >= ht->fsize)
+      return FALSE;
+
+    if (key)
+      *key = ht->ftable[htl->index].key;
+    if (context)
+      *context = ht->ftable[htl->index].context;
+    htl->index++;
+    return TRUE;
+  }
+
   while (!entry && htl->index < primesize[htl->ht->table_size]) {
     entry = htl->ht->table[htl->index];
     htl->index++;
@@ -1127,3 +1812,293 @@ void silc_hash_destructor(void *key, void *context, void *user_context)
   silc_free(key);
   silc_free(context);
 }
+
+/* Set incremental rehashing mode */
+
+void silc_hash_table_set_incremental(SilcHashTable ht, SilcBool incremental)
+{
+  if (!ht)
+    return;
+
+  ht->no_incremental = !incremental;
+
+  /* Leave no migration pending; with incremental off, lookups must
+     never mutate the table. */
+  if (ht->no_incremental)
+    silc_hash_table_migrate_all(ht);
+}
+
+/* Batch lookup with software prefetching.  All keys are hashed and
+   their bucket heads prefetched before any bucket is walked, so the
+   cache misses of a batch overlap instead of forming a dependent
+   chain. */
+
+SilcUInt32 silc_hash_table_find_many(SilcHashTable ht, void **keys,
+				     SilcUInt32 num_keys,
+				     void **ret_contexts)
+{
+  SilcUInt32 hashes[64];
+  SilcUInt32 i, n, base, found = 0;
+  SilcHashTableEntry e;
+
+  if (!ht || !keys || !ret_contexts) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return 0;
+  }
+
+  for (base = 0; base < num_keys; base += 64) {
+    n = num_keys - base < 64 ? num_keys - base : 64;
+
+    /* Hash all keys and prefetch all bucket heads */
+    for (i = 0; i < n; i++) {
+      hashes[i] = ht->hash(keys[base + i], ht->hash_user_context);
+#if defined(__GNUC__)
+      if (!ht->flat)
+	__builtin_prefetch(&ht->table[hashes[i] % primesize[ht->table_size]]);
+      else
+	__builtin_prefetch(&ht->ftable[hashes[i] & (ht->fsize - 1)]);
+#endif /* __GNUC__ */
+    }
+
+#if defined(__GNUC__)
+    if (!ht->flat) {
+      /* Second wave: prefetch the first entry node of each bucket */
+      for (i = 0; i < n; i++) {
+	e = ht->table[hashes[i] % primesize[ht->table_size]];
+	if (e)
+	  __builtin_prefetch(e);
+      }
+    }
+#endif /* __GNUC__ */
+
+    /* Resolve */
+    for (i = 0; i < n; i++) {
+      ret_contexts[base + i] = NULL;
+      if (silc_hash_table_find(ht, keys[base + i], NULL,
+			       &ret_contexts[base + i]))
+	found++;
+    }
+  }
+
+  return found;
+}
+
+/****************************** Integer table *******************************/
+
+/* Reserved key values marking slot states */
+#define SILC_INT_TABLE_EMPTY ((SilcUInt64)-1LL)
+#define SILC_INT_TABLE_TOMB  ((SilcUInt64)-2LL)
+
+/* Compact slot: inline integer key and 32-bit value, 16 bytes, no
+   entry allocation or destructor bookkeeping. */
+typedef struct {
+  SilcUInt64 key;
+  SilcUInt32 value;
+  SilcUInt32 pad;
+} SilcIntTableSlot;
+
+/* Integer table context */
+struct SilcIntTableStruct {
+  SilcIntTableSlot *slots;	       /* Slot array, power of two */
+  SilcUInt32 num_slots;
+  SilcUInt32 count;		       /* Live entries */
+  SilcUInt32 tombs;		       /* Tombstones */
+};
+
+/* Mixes the key to a slot index distribution */
+
+static SilcUInt32 silc_int_table_hash(SilcUInt64 key)
+{
+  key ^= key >> 33;
+  key *= (SilcUInt64)0xff51afd7ed558ccdLL;
+  key ^= key >> 33;
+  return (SilcUInt32)key;
+}
+
+/* Fills a slot array with empty markers */
+
+static void silc_int_table_clear(SilcIntTableSlot *slots, SilcUInt32 num)
+{
+  SilcUInt32 i;
+
+  for (i = 0; i < num; i++)
+    slots[i].key = SILC_INT_TABLE_EMPTY;
+}
+
+/* Grows (or compacts tombstones of) the table */
+
+static SilcBool silc_int_table_rehash(SilcIntTable table, SilcUInt32 num)
+{
+  SilcIntTableSlot *slots, *e;
+  SilcUInt32 i, j, mask = num - 1;
+
+  slots = silc_malloc(num * sizeof(*slots));
+  if (!slots)
+    return FALSE;
+  silc_int_table_clear(slots, num);
+
+  for (i = 0; i < table->num_slots; i++) {
+    e = &table->slots[i];
+    if (e->key == SILC_INT_TABLE_EMPTY || e->key == SILC_INT_TABLE_TOMB)
+      continue;
+    j = silc_int_table_hash(e->key) & mask;
+    while (slots[j].key != SILC_INT_TABLE_EMPTY)
+      j = (j + 1) & mask;
+    slots[j] = *e;
+  }
+
+  silc_free(table->slots);
+  table->slots = slots;
+  table->num_slots = num;
+  table->tombs = 0;
+
+  return TRUE;
+}
+
+/* Allocate integer table */
+
+SilcIntTable silc_int_table_alloc(SilcUInt32 initial_count)
+{
+  SilcIntTable table;
+  SilcUInt32 num = 16;
+
+  while (num < initial_count * 2)
+    num <<= 1;
+
+  table = silc_calloc(1, sizeof(*table));
+  if (!table)
+    return NULL;
+
+  table->slots = silc_malloc(num * sizeof(*table->slots));
+  if (!table->slots) {
+    silc_free(table);
+    return NULL;
+  }
+  silc_int_table_clear(table->slots, num);
+  table->num_slots = num;
+
+  return table;
+}
+
+/* Free integer table */
+
+void silc_int_table_free(SilcIntTable table)
+{
+  if (!table)
+    return;
+  silc_free(table->slots);
+  silc_free(table);
+}
+
+/* Set value; replaces an existing key's value */
+
+SilcBool silc_int_table_set(SilcIntTable table, SilcUInt64 key,
+			    SilcUInt32 value)
+{
+  SilcIntTableSlot *e;
+  SilcUInt32 i, mask, tomb = (SilcUInt32)-1;
+
+  if (!table || key >= SILC_INT_TABLE_TOMB) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* Grow at 3/4 load counting tombstones */
+  if ((table->count + table->tombs) * 4 >= table->num_slots * 3)
+    if (!silc_int_table_rehash(table,
+			       table->count * 4 >= table->num_slots * 3 ?
+			       table->num_slots << 1 : table->num_slots))
+      return FALSE;
+
+  mask = table->num_slots - 1;
+  i = silc_int_table_hash(key) & mask;
+  for (;;) {
+    e = &table->slots[i];
+    if (e->key == key) {
+      e->value = value;
+      return TRUE;
+    }
+    if (e->key == SILC_INT_TABLE_TOMB && tomb == (SilcUInt32)-1)
+      tomb = i;
+    if (e->key == SILC_INT_TABLE_EMPTY)
+      break;
+    i = (i + 1) & mask;
+  }
+
+  if (tomb != (SilcUInt32)-1) {
+    i = tomb;
+    table->tombs--;
+  }
+  table->slots[i].key = key;
+  table->slots[i].value = value;
+  table->count++;
+
+  return TRUE;
+}
+
+/* Find value */
+
+SilcBool silc_int_table_find(SilcIntTable table, SilcUInt64 key,
+			     SilcUInt32 *ret_value)
+{
+  SilcIntTableSlot *e;
+  SilcUInt32 i, mask;
+
+  if (!table || key >= SILC_INT_TABLE_TOMB) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  mask = table->num_slots - 1;
+  i = silc_int_table_hash(key) & mask;
+  for (;;) {
+    e = &table->slots[i];
+    if (e->key == key) {
+      if (ret_value)
+	*ret_value = e->value;
+      return TRUE;
+    }
+    if (e->key == SILC_INT_TABLE_EMPTY) {
+      silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+      return FALSE;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+/* Delete key */
+
+SilcBool silc_int_table_del(SilcIntTable table, SilcUInt64 key)
+{
+  SilcIntTableSlot *e;
+  SilcUInt32 i, mask;
+
+  if (!table || key >= SILC_INT_TABLE_TOMB) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  mask = table->num_slots - 1;
+  i = silc_int_table_hash(key) & mask;
+  for (;;) {
+    e = &table->slots[i];
+    if (e->key == key) {
+      e->key = SILC_INT_TABLE_TOMB;
+      table->count--;
+      table->tombs++;
+      return TRUE;
+    }
+    if (e->key == SILC_INT_TABLE_EMPTY) {
+      silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+      return FALSE;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+/* Return entry count */
+
+SilcUInt32 silc_int_table_count(SilcIntTable table)
+{
+  return table ? table->count : 0;
+}
@@ -207,6 +207,45 @@ SilcHashTable silc_hash_table_alloc(SilcStack stack,
 				    void *destructor_user_context,
 				    SilcBool auto_rehash);
 
+/****f* silcutil/silc_hash_table_alloc_flat
+ *
+ * SYNOPSIS
+ *
+ *    SilcHashTable
+ *    silc_hash_table_alloc_flat(SilcStack stack,
+ *                               SilcUInt32 table_size,
+ *                               SilcHashFunction hash,
+ *                               void *hash_user_context,
+ *                               SilcHashCompare compare,
+ *                               void *compare_user_context,
+ *                               SilcHashDestructor destructor,
+ *                               void *destructor_user_context);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates new open addressing hash table.  Keys and contexts are
+ *    stored inline in one flat array and collisions are resolved by
+ *    linear probing, so lookups touch consecutive memory instead of
+ *    walking per-entry chains; with large tables this is considerably
+ *    more cache friendly than the chained table allocated with the
+ *    silc_hash_table_alloc.  The returned table is used with the normal
+ *    silc_hash_table_* API.
+ *
+ *    Unlike the chained table the flat table holds unique keys; adding
+ *    a key that already exists replaces the old entry.  The table grows
+ *    automatically.  If `stack' is non-NULL the table is allocated from
+ *    the stack.
+ *
+ ***/
+SilcHashTable silc_hash_table_alloc_flat(SilcStack stack,
+					 SilcUInt32 table_size,
+					 SilcHashFunction hash,
+					 void *hash_user_context,
+					 SilcHashCompare compare,
+					 void *compare_user_context,
+					 SilcHashDestructor destructor,
+					 void *destructor_user_context);
+
 /****f* silcutil/silc_hash_table_free
  *
  * SYNOPSIS
@@ -339,6 +378,30 @@ SilcBool silc_hash_table_del_by_context(SilcHashTable ht, void *key,
 SilcBool silc_hash_table_find(SilcHashTable ht, void *key,
 			      void **ret_key, void **ret_context);
 
+/****f* silcutil/silc_hash_table_find_precomputed
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_hash_table_find_precomputed(SilcHashTable ht,
+ *                                              void *key,
+ *                                              SilcUInt32 hash,
+ *                                              void **ret_key,
+ *                                              void **ret_context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_hash_table_find but takes the already computed hash value
+ *    of `key' as `hash' instead of hashing the key.  A caller looking up
+ *    the same key from several tables that share the hash function can
+ *    hash the key once and probe all tables with the value.  The `hash'
+ *    must have been computed with the table's hash function.
+ *
+ ***/
+SilcBool silc_hash_table_find_precomputed(SilcHashTable ht, void *key,
+					  SilcUInt32 hash,
+					  void **ret_key,
+					  void **ret_context);
+
 /****f* silcutil/silc_hash_table_find_by_context
  *
  * SYNOPSIS
@@ -409,6 +472,31 @@ void silc_hash_table_find_foreach(SilcHashTable ht, void *key,
 void silc_hash_table_foreach(SilcHashTable ht, SilcHashForeach foreach,
 			     void *user_context);
 
+/****f* silcutil/silc_hash_table_foreach_snapshot
+ *
+ * SYNOPSIS
+ *
+ *    void silc_hash_table_foreach_snapshot(SilcHashTable ht,
+ *                                          SilcHashForeach foreach,
+ *                                          void *user_context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_hash_table_foreach but traverses a snapshot of the table.
+ *    The entries are copied in one fast sweep and the `foreach' is
+ *    called on the copy, so the table is blocked only for the duration
+ *    of the copy instead of for every callback; other threads (with the
+ *    caller's normal table locking) can use the table while the
+ *    callbacks run.  Entries added after the snapshot was taken are not
+ *    delivered and concurrently deleted entries may still be delivered;
+ *    the callback must tolerate this with the application's own entry
+ *    lifetime rules.
+ *
+ ***/
+void silc_hash_table_foreach_snapshot(SilcHashTable ht,
+				      SilcHashForeach foreach,
+				      void *user_context);
+
 /****f* silcutil/silc_hash_table_rehash
  *
  * SYNOPSIS
@@ -913,4 +1001,152 @@ SilcBool silc_hash_data_compare(void *key1, void *key2, void *user_context);
  ***/
 void silc_hash_destructor(void *key, void *context, void *user_context);
 
+/****f* silcutil/silc_hash_table_set_incremental
+ *
+ * SYNOPSIS
+ *
+ *    void silc_hash_table_set_incremental(SilcHashTable ht,
+ *                                         SilcBool incremental);
+ *
+ * DESCRIPTION
+ *
+ *    Controls incremental rehashing.  By default large tables grow by
+ *    incremental migration, which makes lookups migrate buckets as a
+ *    side effect.  Passing FALSE forces rehashing to happen in one
+ *    sweep inside the mutating call, so lookups never modify the
+ *    table; required when lookups run under a shared (read) lock, as
+ *    in SilcConcurrentHashTable.  Passing FALSE also completes any
+ *    migration already in progress.
+ *
+ ***/
+void silc_hash_table_set_incremental(SilcHashTable ht,
+				     SilcBool incremental);
+
+/****f* silcutil/silc_hash_table_find_many
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_hash_table_find_many(SilcHashTable ht, void **keys,
+ *                                         SilcUInt32 num_keys,
+ *                                         void **ret_contexts);
+ *
+ * DESCRIPTION
+ *
+ *    Looks up `num_keys' keys in one call.  All keys are hashed and
+ *    their buckets prefetched before any bucket is walked, so on an
+ *    out-of-cache table the misses of a batch overlap instead of
+ *    being taken one dependent load at a time.  The context of key i
+ *    is returned into ret_contexts[i], NULL for keys not found;
+ *    returns the number of keys found.
+ *
+ ***/
+SilcUInt32 silc_hash_table_find_many(SilcHashTable ht, void **keys,
+				     SilcUInt32 num_keys,
+				     void **ret_contexts);
+
+/****s* silcutil/SilcIntTable
+ *
+ * NAME
+ *
+ *    typedef struct SilcIntTableStruct *SilcIntTable;
+ *
+ * DESCRIPTION
+ *
+ *    A compact open addressed table from integer keys to 32-bit
+ *    values.  Keys and values are stored inline in 16-byte slots with
+ *    no per-entry allocation, key pointers or destructor fields,
+ *    roughly a third of the memory of a SilcHashTable entry; meant for
+ *    large ID-to-index maps.  Keys (SilcUInt64)-1 and (SilcUInt64)-2
+ *    are reserved.  Not thread safe.
+ *
+ ***/
+typedef struct SilcIntTableStruct *SilcIntTable;
+
+/****f* silcutil/silc_int_table_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcIntTable silc_int_table_alloc(SilcUInt32 initial_count);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates an integer table pre-sized for about `initial_count'
+ *    entries (0 for a small default).  Returns NULL on memory
+ *    allocation error.  Freed with silc_int_table_free.
+ *
+ ***/
+SilcIntTable silc_int_table_alloc(SilcUInt32 initial_count);
+
+/****f* silcutil/silc_int_table_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_int_table_free(SilcIntTable table);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the table.
+ *
+ ***/
+void silc_int_table_free(SilcIntTable table);
+
+/****f* silcutil/silc_int_table_set
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_int_table_set(SilcIntTable table, SilcUInt64 key,
+ *                                SilcUInt32 value);
+ *
+ * DESCRIPTION
+ *
+ *    Sets `key' to `value', replacing an existing value of the same
+ *    key.  Returns FALSE on memory allocation error or reserved key.
+ *
+ ***/
+SilcBool silc_int_table_set(SilcIntTable table, SilcUInt64 key,
+			    SilcUInt32 value);
+
+/****f* silcutil/silc_int_table_find
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_int_table_find(SilcIntTable table, SilcUInt64 key,
+ *                                 SilcUInt32 *ret_value);
+ *
+ * DESCRIPTION
+ *
+ *    Finds the value of `key'.  Returns FALSE if the key is not in the
+ *    table.
+ *
+ ***/
+SilcBool silc_int_table_find(SilcIntTable table, SilcUInt64 key,
+			     SilcUInt32 *ret_value);
+
+/****f* silcutil/silc_int_table_del
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_int_table_del(SilcIntTable table, SilcUInt64 key);
+ *
+ * DESCRIPTION
+ *
+ *    Removes `key' from the table.  Returns FALSE if the key is not in
+ *    the table.
+ *
+ ***/
+SilcBool silc_int_table_del(SilcIntTable table, SilcUInt64 key);
+
+/****f* silcutil/silc_int_table_count
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_int_table_count(SilcIntTable table);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of entries in the table.
+ *
+ ***/
+SilcUInt32 silc_int_table_count(SilcIntTable table);
+
 #endif
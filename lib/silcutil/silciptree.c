@@ -0,0 +1,298 @@
+/*
+
+  silciptree.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Tree node.  One node per prefix bit on the path; nodes without a
+   value are internal branch points. */
+typedef struct SilcIpTreeNodeStruct {
+  struct SilcIpTreeNodeStruct *child[2];
+  void *context;		       /* Prefix context */
+  unsigned int has_value : 1;	       /* Node terminates a prefix */
+} *SilcIpTreeNode;
+
+/* Tree context; separate roots for the two address families */
+struct SilcIpTreeStruct {
+  SilcIpTreeNode root4;		       /* IPv4, 32 bit prefixes */
+  SilcIpTreeNode root6;		       /* IPv6, 128 bit prefixes */
+};
+
+/************************ Static utility functions **************************/
+
+/* Returns bit `i' (0 = most significant) of the address */
+
+#define SILC_IP_TREE_BIT(addr, i) (((addr)[(i) >> 3] >> (7 - ((i) & 7))) & 1)
+
+/* Parses "addr/prefixlen" into binary address and prefix length.
+   A plain address gets the full host prefix. */
+
+static SilcBool silc_ip_tree_parse(const char *cidr, unsigned char *addr,
+				   SilcUInt32 *addr_len,
+				   SilcUInt32 *prefix_len)
+{
+  char ip[64], *p;
+  SilcUInt32 maxlen;
+  long plen = -1;
+
+  if (!cidr || silc_snprintf(ip, sizeof(ip), "%s", cidr) >= sizeof(ip)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  p = strchr(ip, '/');
+  if (p) {
+    *p = '\0';
+    plen = atol(p + 1);
+  }
+
+  if (silc_net_is_ip4(ip))
+    maxlen = 4;
+  else if (silc_net_is_ip6(ip))
+    maxlen = 16;
+  else {
+    silc_set_errno(SILC_ERR_BAD_IP);
+    return FALSE;
+  }
+
+  if (plen < 0)
+    plen = maxlen * 8;
+  if (plen > maxlen * 8) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!silc_net_addr2bin(ip, addr, maxlen))
+    return FALSE;
+
+  *addr_len = maxlen;
+  *prefix_len = (SilcUInt32)plen;
+
+  return TRUE;
+}
+
+/* Returns the root for an address of `addr_len' bytes, allocating it
+   when `alloc' is TRUE */
+
+static SilcIpTreeNode *silc_ip_tree_root(SilcIpTree tree,
+					 SilcUInt32 addr_len)
+{
+  return addr_len == 4 ? &tree->root4 : &tree->root6;
+}
+
+/* Frees the subtree of `node' */
+
+static void silc_ip_tree_free_node(SilcIpTreeNode node)
+{
+  if (!node)
+    return;
+  silc_ip_tree_free_node(node->child[0]);
+  silc_ip_tree_free_node(node->child[1]);
+  silc_free(node);
+}
+
+/* Adds prefix in binary form */
+
+static SilcBool silc_ip_tree_add_bin(SilcIpTree tree,
+				     const unsigned char *addr,
+				     SilcUInt32 addr_len,
+				     SilcUInt32 prefix_len, void *context)
+{
+  SilcIpTreeNode *np = silc_ip_tree_root(tree, addr_len);
+  SilcUInt32 i;
+
+  for (i = 0; ; i++) {
+    if (!*np) {
+      *np = silc_calloc(1, sizeof(**np));
+      if (!*np)
+	return FALSE;
+    }
+    if (i == prefix_len)
+      break;
+    np = &(*np)->child[SILC_IP_TREE_BIT(addr, i)];
+  }
+
+  (*np)->context = context;
+  (*np)->has_value = TRUE;
+
+  return TRUE;
+}
+
+/****************************** Public API **********************************/
+
+/* Allocate tree */
+
+SilcIpTree silc_ip_tree_alloc(void)
+{
+  SilcIpTree tree;
+
+  tree = silc_calloc(1, sizeof(*tree));
+  if (!tree)
+    return NULL;
+
+  SILC_LOG_DEBUG(("Allocated IP tree %p", tree));
+
+  return tree;
+}
+
+/* Free tree */
+
+void silc_ip_tree_free(SilcIpTree tree)
+{
+  if (!tree)
+    return;
+
+  silc_ip_tree_free_node(tree->root4);
+  silc_ip_tree_free_node(tree->root6);
+  silc_free(tree);
+}
+
+/* Add prefix */
+
+SilcBool silc_ip_tree_add(SilcIpTree tree, const char *cidr, void *context)
+{
+  unsigned char addr[16];
+  SilcUInt32 addr_len, prefix_len;
+
+  if (!tree) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!silc_ip_tree_parse(cidr, addr, &addr_len, &prefix_len))
+    return FALSE;
+
+  return silc_ip_tree_add_bin(tree, addr, addr_len, prefix_len, context);
+}
+
+/* Bulk load prefixes */
+
+SilcBool silc_ip_tree_load(SilcIpTree tree, const char **cidrs,
+			   SilcUInt32 num_cidrs, void *context)
+{
+  SilcUInt32 i;
+
+  if (!tree || !cidrs) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  for (i = 0; i < num_cidrs; i++)
+    if (!silc_ip_tree_add(tree, cidrs[i], context))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Remove prefix */
+
+SilcBool silc_ip_tree_del(SilcIpTree tree, const char *cidr)
+{
+  unsigned char addr[16];
+  SilcUInt32 addr_len, prefix_len, i;
+  SilcIpTreeNode node;
+
+  if (!tree) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!silc_ip_tree_parse(cidr, addr, &addr_len, &prefix_len))
+    return FALSE;
+
+  node = *silc_ip_tree_root(tree, addr_len);
+  for (i = 0; node && i < prefix_len; i++)
+    node = node->child[SILC_IP_TREE_BIT(addr, i)];
+
+  if (!node || !node->has_value) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  /* The node may be a branch point for longer prefixes; just clear
+     the value. */
+  node->has_value = FALSE;
+  node->context = NULL;
+
+  return TRUE;
+}
+
+/* Longest prefix match, binary address */
+
+SilcBool silc_ip_tree_find_bin(SilcIpTree tree, const unsigned char *addr,
+			       SilcUInt32 addr_len, void **ret_context)
+{
+  SilcIpTreeNode node;
+  void *context = NULL;
+  SilcBool found = FALSE;
+  SilcUInt32 i;
+
+  if (!tree || !addr || (addr_len != 4 && addr_len != 16)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  node = *silc_ip_tree_root(tree, addr_len);
+  for (i = 0; node; i++) {
+    if (node->has_value) {
+      context = node->context;
+      found = TRUE;
+    }
+    if (i == addr_len * 8)
+      break;
+    node = node->child[SILC_IP_TREE_BIT(addr, i)];
+  }
+
+  if (!found) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  if (ret_context)
+    *ret_context = context;
+
+  return TRUE;
+}
+
+/* Longest prefix match */
+
+SilcBool silc_ip_tree_find(SilcIpTree tree, const char *addr,
+			   void **ret_context)
+{
+  unsigned char bin[16];
+  SilcUInt32 len;
+
+  if (!addr) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (silc_net_is_ip4(addr))
+    len = 4;
+  else if (silc_net_is_ip6(addr))
+    len = 16;
+  else {
+    silc_set_errno(SILC_ERR_BAD_IP);
+    return FALSE;
+  }
+
+  if (!silc_net_addr2bin(addr, bin, len))
+    return FALSE;
+
+  return silc_ip_tree_find_bin(tree, bin, len, ret_context);
+}
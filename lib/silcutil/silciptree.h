@@ -0,0 +1,165 @@
+/*
+
+  silciptree.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/IP Prefix Tree Interface
+ *
+ * DESCRIPTION
+ *
+ * A binary radix tree over IPv4 and IPv6 address prefixes with
+ * longest-prefix-match lookup.  Lookup cost is bounded by the address
+ * width (32 or 128 bits) regardless of how many prefixes the tree
+ * holds, making it suitable for ACL checks on the accept path and for
+ * routing-table style lookups, where a linear rule list costs one
+ * address comparison per rule.
+ *
+ * Prefixes are given in CIDR notation ("10.1.0.0/16", "fd00::/8"); a
+ * plain address is a host prefix.  Each prefix carries a caller
+ * context, returned by the match.  The interface is not thread safe.
+ *
+ ***/
+
+#ifndef SILCIPTREE_H
+#define SILCIPTREE_H
+
+/****s* silcutil/SilcIpTree
+ *
+ * NAME
+ *
+ *    typedef struct SilcIpTreeStruct *SilcIpTree;
+ *
+ * DESCRIPTION
+ *
+ *    The IP prefix tree context allocated by silc_ip_tree_alloc.
+ *
+ ***/
+typedef struct SilcIpTreeStruct *SilcIpTree;
+
+/****f* silcutil/silc_ip_tree_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcIpTree silc_ip_tree_alloc(void);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates IP prefix tree.  Returns NULL on memory allocation
+ *    error.  Free with silc_ip_tree_free.
+ *
+ ***/
+SilcIpTree silc_ip_tree_alloc(void);
+
+/****f* silcutil/silc_ip_tree_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_ip_tree_free(SilcIpTree tree);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the tree.  The prefix contexts are the caller's to free.
+ *
+ ***/
+void silc_ip_tree_free(SilcIpTree tree);
+
+/****f* silcutil/silc_ip_tree_add
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_ip_tree_add(SilcIpTree tree, const char *cidr,
+ *                              void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Adds the prefix `cidr' ("10.1.0.0/16", "fd00::/8" or a plain
+ *    address for a host prefix) with `context'.  Adding an existing
+ *    prefix replaces its context.  Returns FALSE if the prefix cannot
+ *    be parsed or on memory allocation error.
+ *
+ ***/
+SilcBool silc_ip_tree_add(SilcIpTree tree, const char *cidr, void *context);
+
+/****f* silcutil/silc_ip_tree_load
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_ip_tree_load(SilcIpTree tree, const char **cidrs,
+ *                               SilcUInt32 num_cidrs, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Bulk loads `num_cidrs' prefixes from the `cidrs' list, all with
+ *    the same `context'.  Stops and returns FALSE on the first prefix
+ *    that cannot be added; already added prefixes remain in the tree.
+ *
+ ***/
+SilcBool silc_ip_tree_load(SilcIpTree tree, const char **cidrs,
+			   SilcUInt32 num_cidrs, void *context);
+
+/****f* silcutil/silc_ip_tree_del
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_ip_tree_del(SilcIpTree tree, const char *cidr);
+ *
+ * DESCRIPTION
+ *
+ *    Removes the prefix `cidr'.  Returns FALSE if the prefix is not in
+ *    the tree.
+ *
+ ***/
+SilcBool silc_ip_tree_del(SilcIpTree tree, const char *cidr);
+
+/****f* silcutil/silc_ip_tree_find
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_ip_tree_find(SilcIpTree tree, const char *addr,
+ *                               void **ret_context);
+ *
+ * DESCRIPTION
+ *
+ *    Finds the longest prefix matching the address `addr' and returns
+ *    its context into `ret_context'.  Returns FALSE if no prefix
+ *    matches.
+ *
+ ***/
+SilcBool silc_ip_tree_find(SilcIpTree tree, const char *addr,
+			   void **ret_context);
+
+/****f* silcutil/silc_ip_tree_find_bin
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_ip_tree_find_bin(SilcIpTree tree,
+ *                                   const unsigned char *addr,
+ *                                   SilcUInt32 addr_len,
+ *                                   void **ret_context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_ip_tree_find but takes the address in binary form; 4
+ *    bytes for IPv4, 16 bytes for IPv6, both in network order.  This
+ *    is the hot-path variant for code that already holds the binary
+ *    address.
+ *
+ ***/
+SilcBool silc_ip_tree_find_bin(SilcIpTree tree, const unsigned char *addr,
+			       SilcUInt32 addr_len, void **ret_context);
+
+#endif /* SILCIPTREE_H */
@@ -19,6 +19,12 @@
 
 #include <silcruntime.h>
 
+#if defined(SILC_UNIX) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN)
+#define SILC_LOCAL_NET_SHM
+#include <sys/mman.h>
+#include <sys/socket.h>
+#endif
+
 /************************** Types and definitions ***************************/
 
 /* Local net listener context */
@@ -29,8 +35,544 @@ typedef struct {
   void *context;
 } *SilcLocalNetListener;
 
+#ifdef SILC_LOCAL_NET_SHM
+
+/* Size of one shared memory ring (must be power of two) */
+#define SILC_LOCAL_NET_RING_SIZE 0x20000
+
+/* Shared memory handshake magic */
+#define SILC_LOCAL_NET_SHM_MAGIC 0x53484d31
+
+const SilcStreamOps silc_local_net_shm_ops;
+
+/* One SPSC ring in the shared segment.  The counters are free running;
+   index is position masked with the ring size. */
+typedef struct {
+  SilcAtomic32 head;		    /* Read position */
+  SilcAtomic32 tail;		    /* Write position */
+  SilcAtomic32 waiting;		    /* Set when writer waits for space */
+} SilcLocalNetRing;
+
+/* Shared segment header, followed by the two ring data areas.  Ring 0
+   carries data from connector to acceptor, ring 1 the reverse. */
+typedef struct {
+  SilcUInt32 magic;
+  SilcUInt32 ring_size;
+  SilcLocalNetRing ring[2];
+} SilcLocalNetShmHeader;
+
+/* Shared memory stream context.  Data moves through the rings; the
+   underlying loopback socket carries only doorbell bytes and acts as the
+   connection lifetime anchor. */
+typedef struct {
+  const SilcStreamOps *ops;
+  SilcStream sock;		    /* Underlying socket stream */
+  SilcLocalNetShmHeader *shm;	    /* Mapped segment */
+  unsigned char *rx_data;	    /* Receive ring data area */
+  unsigned char *tx_data;	    /* Send ring data area */
+  SilcLocalNetRing *rx;		    /* Receive ring */
+  SilcLocalNetRing *tx;		    /* Send ring */
+  SilcUInt32 shm_len;		    /* Mapped length */
+  SilcStreamNotifier notifier;
+  void *notifier_context;
+  unsigned int write_blocked  : 1;  /* Writer waits for ring space */
+  unsigned int eof	      : 1;  /* Underlying socket closed */
+} *SilcLocalNetShmStream;
+
+/* Shared memory upgrade handshake context */
+typedef struct {
+  SilcStream stream;		    /* The accepted/connected socket */
+  SilcNetCallback callback;	    /* Completion callback */
+  void *context;
+  SilcSchedule schedule;
+  char shm_name[64];		    /* Created segment (connector) */
+  SilcLocalNetShmHeader *shm;	    /* Mapped segment (connector) */
+  SilcUInt32 shm_len;
+  unsigned int connector	: 1;
+} *SilcLocalNetUpgrade;
+
+#endif /* SILC_LOCAL_NET_SHM */
+
 /************************ Static utility functions **************************/
 
+#ifdef SILC_LOCAL_NET_SHM
+
+/* Write data to ring.  Returns the number of bytes written, which may be
+   zero when the ring is full. */
+
+static SilcUInt32 silc_local_net_ring_write(SilcLocalNetRing *ring,
+					    unsigned char *data_area,
+					    const unsigned char *data,
+					    SilcUInt32 data_len)
+{
+  SilcUInt32 head, tail, space, n, idx, first;
+
+  head = silc_atomic_get_int32(&ring->head);
+  tail = silc_atomic_get_int32(&ring->tail);
+  space = SILC_LOCAL_NET_RING_SIZE - (tail - head);
+
+  if (!space) {
+    silc_atomic_set_int32(&ring->waiting, 1);
+    return 0;
+  }
+
+  n = data_len < space ? data_len : space;
+  idx = tail & (SILC_LOCAL_NET_RING_SIZE - 1);
+  first = n < SILC_LOCAL_NET_RING_SIZE - idx ? n :
+    SILC_LOCAL_NET_RING_SIZE - idx;
+  memcpy(data_area + idx, data, first);
+  if (n > first)
+    memcpy(data_area, data + first, n - first);
+
+  silc_atomic_set_int32(&ring->tail, tail + n);
+
+  return n;
+}
+
+/* Read data from ring.  Returns the number of bytes read. */
+
+static SilcUInt32 silc_local_net_ring_read(SilcLocalNetRing *ring,
+					   unsigned char *data_area,
+					   unsigned char *buf,
+					   SilcUInt32 buf_len)
+{
+  SilcUInt32 head, tail, avail, n, idx, first;
+
+  head = silc_atomic_get_int32(&ring->head);
+  tail = silc_atomic_get_int32(&ring->tail);
+  avail = tail - head;
+
+  if (!avail)
+    return 0;
+
+  n = buf_len < avail ? buf_len : avail;
+  idx = head & (SILC_LOCAL_NET_RING_SIZE - 1);
+  first = n < SILC_LOCAL_NET_RING_SIZE - idx ? n :
+    SILC_LOCAL_NET_RING_SIZE - idx;
+  memcpy(buf, data_area + idx, first);
+  if (n > first)
+    memcpy(buf + first, data_area, n - first);
+
+  silc_atomic_set_int32(&ring->head, head + n);
+
+  return n;
+}
+
+/* Ring doorbell; one byte through the loopback socket wakes the peer */
+
+static void silc_local_net_doorbell(SilcLocalNetShmStream ls)
+{
+  unsigned char c = '!';
+  (void)silc_stream_write(ls->sock, &c, 1);
+}
+
+/* IO callback from the underlying socket.  Translates doorbells to
+   notifier calls. */
+
+static void silc_local_net_shm_io(SilcStream stream, SilcStreamStatus status,
+				  void *context)
+{
+  SilcLocalNetShmStream ls = context;
+
+  if (!ls->notifier)
+    return;
+
+  if (status == SILC_STREAM_CAN_READ) {
+    ls->notifier((SilcStream)ls, SILC_STREAM_CAN_READ,
+		 ls->notifier_context);
+
+    /* A doorbell may also signal freed ring space for our writer */
+    if (ls->write_blocked &&
+	(silc_atomic_get_int32(&ls->tx->tail) -
+	 silc_atomic_get_int32(&ls->tx->head)) < SILC_LOCAL_NET_RING_SIZE) {
+      ls->write_blocked = FALSE;
+      if (ls->notifier)
+	ls->notifier((SilcStream)ls, SILC_STREAM_CAN_WRITE,
+		     ls->notifier_context);
+    }
+  } else {
+    ls->notifier((SilcStream)ls, status, ls->notifier_context);
+  }
+}
+
+/* Stream read operation */
+
+static int silc_local_net_shm_read(SilcStream stream, unsigned char *buf,
+				   SilcUInt32 buf_len)
+{
+  SilcLocalNetShmStream ls = stream;
+  unsigned char bells[64];
+  int ret, n;
+
+  /* Drain pending doorbells */
+  while ((ret = silc_stream_read(ls->sock, bells, sizeof(bells))) > 0)
+    ;
+  if (ret == 0 || ret == -2)
+    ls->eof = TRUE;
+
+  n = silc_local_net_ring_read(ls->rx, ls->rx_data, buf, buf_len);
+  if (n) {
+    /* Wake a writer waiting for ring space */
+    if (silc_atomic_get_int32(&ls->rx->waiting)) {
+      silc_atomic_set_int32(&ls->rx->waiting, 0);
+      silc_local_net_doorbell(ls);
+    }
+    return n;
+  }
+
+  if (ls->eof)
+    return ret == -2 ? -2 : 0;
+
+  return -1;
+}
+
+/* Stream write operation */
+
+static int silc_local_net_shm_write(SilcStream stream,
+				    const unsigned char *data,
+				    SilcUInt32 data_len)
+{
+  SilcLocalNetShmStream ls = stream;
+  SilcUInt32 n;
+
+  if (silc_unlikely(ls->eof))
+    return -2;
+
+  n = silc_local_net_ring_write(ls->tx, ls->tx_data, data, data_len);
+  if (!n) {
+    /* Ring full; the peer doorbells when it has consumed data */
+    ls->write_blocked = TRUE;
+    silc_set_errno(SILC_ERR_WOULD_BLOCK);
+    return -1;
+  }
+
+  silc_local_net_doorbell(ls);
+
+  return n;
+}
+
+/* Close stream */
+
+static SilcBool silc_local_net_shm_close(SilcStream stream)
+{
+  SilcLocalNetShmStream ls = stream;
+  return silc_stream_close(ls->sock);
+}
+
+/* Destroy stream */
+
+static void silc_local_net_shm_destroy(SilcStream stream)
+{
+  SilcLocalNetShmStream ls = stream;
+
+  munmap((void *)ls->shm, ls->shm_len);
+  silc_stream_destroy(ls->sock);
+  silc_free(ls);
+}
+
+/* Set notifier callback */
+
+static SilcBool silc_local_net_shm_notifier(SilcStream stream,
+					    SilcSchedule schedule,
+					    SilcStreamNotifier callback,
+					    void *context)
+{
+  SilcLocalNetShmStream ls = stream;
+
+  ls->notifier = callback;
+  ls->notifier_context = context;
+
+  return silc_stream_set_notifier(ls->sock, schedule,
+				  callback ? silc_local_net_shm_io : NULL,
+				  callback ? ls : NULL);
+}
+
+/* Return schedule */
+
+static SilcSchedule silc_local_net_shm_get_schedule(SilcStream stream)
+{
+  SilcLocalNetShmStream ls = stream;
+  return silc_stream_get_schedule(ls->sock);
+}
+
+const SilcStreamOps silc_local_net_shm_ops =
+{
+  silc_local_net_shm_read,
+  silc_local_net_shm_write,
+  silc_local_net_shm_close,
+  silc_local_net_shm_destroy,
+  silc_local_net_shm_notifier,
+  silc_local_net_shm_get_schedule,
+};
+
+/* Creates the shared memory stream over the mapped segment `shm'. */
+
+static SilcStream silc_local_net_shm_stream(SilcStream sock,
+					    SilcLocalNetShmHeader *shm,
+					    SilcUInt32 shm_len,
+					    SilcBool connector)
+{
+  SilcLocalNetShmStream ls;
+
+  ls = silc_calloc(1, sizeof(*ls));
+  if (!ls)
+    return NULL;
+
+  ls->ops = &silc_local_net_shm_ops;
+  ls->sock = sock;
+  ls->shm = shm;
+  ls->shm_len = shm_len;
+
+  /* Ring 0 carries connector to acceptor data */
+  ls->tx = &shm->ring[connector ? 0 : 1];
+  ls->rx = &shm->ring[connector ? 1 : 0];
+  ls->tx_data = (unsigned char *)(shm + 1) +
+    (connector ? 0 : SILC_LOCAL_NET_RING_SIZE);
+  ls->rx_data = (unsigned char *)(shm + 1) +
+    (connector ? SILC_LOCAL_NET_RING_SIZE : 0);
+
+  return (SilcStream)ls;
+}
+
+#endif /* SILC_LOCAL_NET_SHM */
+
+#ifdef SILC_LOCAL_NET_SHM
+
+/* The shared memory transport is opt-in: the upgraded stream is not a
+   socket stream and callers are promised one, so both ends attempt the
+   upgrade only when SILC_LOCAL_NET_SHM is set in the environment. */
+
+static SilcBool silc_local_net_shm_enabled(void)
+{
+  return silc_getenv("SILC_LOCAL_NET_SHM") != NULL;
+}
+
+/* Ends the shared memory upgrade handshake and delivers the plain socket
+   stream. */
+
+static void silc_local_net_deliver_plain(SilcLocalNetUpgrade up)
+{
+  silc_stream_set_notifier(up->stream, up->schedule, NULL, NULL);
+  silc_schedule_task_del_by_context(up->schedule, up);
+
+  if (up->shm) {
+    munmap((void *)up->shm, up->shm_len);
+    shm_unlink(up->shm_name);
+  }
+
+  up->callback(SILC_OK, up->stream, up->context);
+  silc_free(up);
+}
+
+/* Handshake timeout; fall back to the plain socket stream */
+
+SILC_TASK_CALLBACK(silc_local_net_upgrade_timeout)
+{
+  SilcLocalNetUpgrade up = context;
+
+  SILC_LOG_DEBUG(("Shared memory handshake timeout, using socket"));
+  silc_local_net_deliver_plain(up);
+}
+
+/* Acceptor side of the shared memory handshake.  Peeks the socket for
+   the handshake line; anything else is delivered untouched as a plain
+   socket connection. */
+
+static void silc_local_net_accept_io(SilcStream stream,
+				     SilcStreamStatus status, void *context)
+{
+  SilcLocalNetUpgrade up = context;
+  SilcLocalNetShmHeader *shm;
+  char buf[128], name[64], *lf;
+  unsigned char reply;
+  SilcUInt32 ring_size = 0, shm_len;
+  SilcSocket sock_fd;
+  int n, fd = -1;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  if (!silc_socket_stream_get_info(stream, &sock_fd, NULL, NULL, NULL)) {
+    silc_local_net_deliver_plain(up);
+    return;
+  }
+
+  /* Peek; plain connections must not lose their first bytes */
+  n = recv(sock_fd, buf, sizeof(buf) - 1, MSG_PEEK);
+  if (n <= 0)
+    return;
+  buf[n] = '\0';
+
+  if (strncmp(buf, "SRTSHM1 ", 8)) {
+    silc_local_net_deliver_plain(up);
+    return;
+  }
+
+  lf = strchr(buf, '\n');
+  if (!lf) {
+    if (n >= (int)sizeof(buf) - 1)
+      silc_local_net_deliver_plain(up);
+    return;
+  }
+
+  /* Consume the handshake line */
+  n = (int)(lf - buf) + 1;
+  if (silc_stream_read(stream, (unsigned char *)buf, n) != n) {
+    silc_local_net_deliver_plain(up);
+    return;
+  }
+  buf[n] = '\0';
+
+  shm = NULL;
+  shm_len = 0;
+  if (sscanf(buf, "SRTSHM1 %63s %u", name, &ring_size) == 2 &&
+      ring_size == SILC_LOCAL_NET_RING_SIZE) {
+    fd = shm_open(name, O_RDWR, 0600);
+    if (fd >= 0) {
+      shm_len = sizeof(*shm) + 2 * SILC_LOCAL_NET_RING_SIZE;
+      shm = mmap(NULL, shm_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (shm == MAP_FAILED ||
+	  shm->magic != SILC_LOCAL_NET_SHM_MAGIC ||
+	  shm->ring_size != SILC_LOCAL_NET_RING_SIZE) {
+	if (shm != MAP_FAILED)
+	  munmap((void *)shm, shm_len);
+	shm = NULL;
+      }
+    }
+  }
+
+  silc_stream_set_notifier(up->stream, up->schedule, NULL, NULL);
+  silc_schedule_task_del_by_context(up->schedule, up);
+
+  if (!shm) {
+    reply = 'N';
+    (void)silc_stream_write(stream, &reply, 1);
+    up->callback(SILC_OK, up->stream, up->context);
+    silc_free(up);
+    return;
+  }
+
+  reply = 'Y';
+  (void)silc_stream_write(stream, &reply, 1);
+
+  stream = silc_local_net_shm_stream(up->stream, shm, shm_len, FALSE);
+  if (!stream) {
+    munmap((void *)shm, shm_len);
+    stream = up->stream;
+  }
+
+  SILC_LOG_DEBUG(("Local net connection upgraded to shared memory"));
+
+  up->callback(SILC_OK, stream, up->context);
+  silc_free(up);
+}
+
+/* Connector side reply handler */
+
+static void silc_local_net_connect_io(SilcStream stream,
+				      SilcStreamStatus status, void *context)
+{
+  SilcLocalNetUpgrade up = context;
+  unsigned char c;
+  int ret;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  ret = silc_stream_read(stream, &c, 1);
+  if (ret == -1)
+    return;
+
+  silc_stream_set_notifier(up->stream, up->schedule, NULL, NULL);
+  silc_schedule_task_del_by_context(up->schedule, up);
+
+  if (ret == 1 && c == 'Y') {
+    /* Upgraded; the segment can be unlinked now that both have mapped it */
+    shm_unlink(up->shm_name);
+    stream = silc_local_net_shm_stream(up->stream, up->shm, up->shm_len,
+				       TRUE);
+    if (stream) {
+      SILC_LOG_DEBUG(("Local net connection upgraded to shared memory"));
+      up->callback(SILC_OK, stream, up->context);
+      silc_free(up);
+      return;
+    }
+  }
+
+  /* Fall back to the plain socket stream */
+  munmap((void *)up->shm, up->shm_len);
+  shm_unlink(up->shm_name);
+  up->callback(SILC_OK, up->stream, up->context);
+  silc_free(up);
+}
+
+/* TCP connect completion; starts the shared memory handshake */
+
+static void silc_local_net_connected(SilcResult result, SilcStream stream,
+				     void *context)
+{
+  SilcLocalNetUpgrade up = context;
+  SilcLocalNetShmHeader *shm = MAP_FAILED;
+  static SilcUInt32 counter;
+  char req[128];
+  SilcUInt32 shm_len;
+  int fd = -1, i, len;
+
+  if (result != SILC_OK || !stream) {
+    up->callback(result, stream, up->context);
+    silc_free(up);
+    return;
+  }
+
+  up->stream = stream;
+
+  /* Create the shared segment */
+  silc_snprintf(up->shm_name, sizeof(up->shm_name), "/srt-ln-%d-%u",
+		(int)getpid(), ++counter);
+  fd = shm_open(up->shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  shm_len = sizeof(*shm) + 2 * SILC_LOCAL_NET_RING_SIZE;
+  if (fd >= 0 && ftruncate(fd, shm_len) == 0)
+    shm = mmap(NULL, shm_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (fd >= 0)
+    close(fd);
+
+  if (shm == MAP_FAILED) {
+    if (fd >= 0)
+      shm_unlink(up->shm_name);
+    up->callback(SILC_OK, stream, up->context);
+    silc_free(up);
+    return;
+  }
+
+  memset((void *)shm, 0, sizeof(*shm));
+  shm->magic = SILC_LOCAL_NET_SHM_MAGIC;
+  shm->ring_size = SILC_LOCAL_NET_RING_SIZE;
+  for (i = 0; i < 2; i++) {
+    silc_atomic_init32(&shm->ring[i].head, 0);
+    silc_atomic_init32(&shm->ring[i].tail, 0);
+    silc_atomic_init32(&shm->ring[i].waiting, 0);
+  }
+
+  up->shm = shm;
+  up->shm_len = shm_len;
+
+  /* Send the handshake and wait for the reply */
+  len = silc_snprintf(req, sizeof(req), "SRTSHM1 %s %u\n", up->shm_name,
+		      (unsigned int)SILC_LOCAL_NET_RING_SIZE);
+  if (silc_stream_write(stream, (unsigned char *)req, len) != len) {
+    silc_local_net_deliver_plain(up);
+    return;
+  }
+
+  silc_stream_set_notifier(stream, up->schedule, silc_local_net_connect_io,
+			   up);
+  silc_schedule_task_add_timeout(up->schedule,
+				 silc_local_net_upgrade_timeout, up, 1, 0);
+}
+
+#endif /* SILC_LOCAL_NET_SHM */
+
 /* Connection accept callback */
 
 static void silc_local_net_accept(SilcResult result, SilcStream stream,
@@ -38,6 +580,9 @@ static void silc_local_net_accept(SilcResult result, SilcStream stream,
 {
   SilcLocalNetListener listener = context;
   const char *remote_ip;
+#ifdef SILC_LOCAL_NET_SHM
+  SilcLocalNetUpgrade up;
+#endif /* SILC_LOCAL_NET_SHM */
 
   if (!silc_socket_stream_get_info(stream, NULL, NULL, &remote_ip, NULL)) {
     silc_stream_destroy(stream);
@@ -52,6 +597,28 @@ static void silc_local_net_accept(SilcResult result, SilcStream stream,
     return;
   }
 
+#ifdef SILC_LOCAL_NET_SHM
+  /* Wait shortly for a shared memory upgrade handshake; plain
+     connections are delivered untouched after the timeout. */
+  up = silc_local_net_shm_enabled() ? silc_calloc(1, sizeof(*up)) : NULL;
+  if (up) {
+    up->stream = stream;
+    up->callback = listener->callback;
+    up->context = listener->context;
+    up->schedule = silc_stream_get_schedule(stream);
+    if (!up->schedule)
+      up->schedule = silc_schedule_get_global();
+    if (silc_stream_set_notifier(stream, up->schedule,
+				 silc_local_net_accept_io, up)) {
+      silc_schedule_task_add_timeout(up->schedule,
+				     silc_local_net_upgrade_timeout,
+				     up, 0, 200000);
+      return;
+    }
+    silc_free(up);
+  }
+#endif /* SILC_LOCAL_NET_SHM */
+
   listener->callback(result, stream, listener->context);
 }
 
@@ -182,6 +749,22 @@ SilcAsyncOperation silc_local_net_connect(const char *filepath,
 
   silc_free(port_data);
 
+#ifdef SILC_LOCAL_NET_SHM
+  /* Connect and upgrade to shared memory transport when the peer
+     supports it */
+  if (silc_local_net_shm_enabled()) {
+    SilcLocalNetUpgrade up = silc_calloc(1, sizeof(*up));
+    if (up) {
+      up->callback = callback;
+      up->context = context;
+      up->schedule = schedule;
+      up->connector = TRUE;
+      return silc_net_tcp_connect("127.0.0.1", "127.0.0.1", port, schedule,
+				  silc_local_net_connected, up);
+    }
+  }
+#endif /* SILC_LOCAL_NET_SHM */
+
   /* Connect */
   return silc_net_tcp_connect("127.0.0.1", "127.0.0.1", port, schedule,
 			      callback, context);
@@ -30,6 +30,13 @@
  * used for any TCP communication, however connections may be estalished only
  * from the local machine.  The connections use the loopback network.
  *
+ * When the environment variable SILC_LOCAL_NET_SHM is set and both ends
+ * support it, connections are transparently upgraded to a shared memory
+ * transport that bypasses the socket for data.  The upgraded stream is
+ * used with the normal SilcStream API but is NOT a socket stream, so the
+ * silc_socket_stream_* calls do not work on it; the upgrade is therefore
+ * off by default.
+ *
  * EXAMPLE
  *
  * // Create listener
@@ -43,12 +43,23 @@ typedef struct {
   char filename[256];
   FILE *fp;
   SilcUInt64 maxsize;
+  SilcUInt64 written;		/* Bytes written since open */
+  SilcInt64 opened;		/* When the file was opened */
   const char *typename;
   SilcLogType type;
   SilcLogCb cb;
   void *context;
 } *SilcLog, SilcLogStruct;
 
+/* Time-based rotation interval, seconds; 0 rotates by size only */
+static SilcUInt32 silclog_rotate_secs = 0;
+
+/* Duplicate message suppression state.  In asynchronous mode only the
+   writer thread touches these; in synchronous mode the races are no
+   worse than the interleaved writes the mode already has. */
+static char silclog_dedup_last[256];
+static SilcUInt32 silclog_dedup_count = 0;
+
 #ifndef SILC_SYMBIAN
 
 /* Default settings */
@@ -76,10 +87,10 @@ static SilcLogStruct silclogs[4] =
 const SilcLogStruct silclogs[4] =
 #endif /* !SILC_SYMBIAN */
 {
-  {"", NULL, 0, "Info", SILC_LOG_INFO, NULL, NULL},
-  {"", NULL, 0, "Warning", SILC_LOG_WARNING, NULL, NULL},
-  {"", NULL, 0, "Error", SILC_LOG_ERROR, NULL, NULL},
-  {"", NULL, 0, "Fatal", SILC_LOG_FATAL, NULL, NULL},
+  {"", NULL, 0, 0, 0, "Info", SILC_LOG_INFO, NULL, NULL},
+  {"", NULL, 0, 0, 0, "Warning", SILC_LOG_WARNING, NULL, NULL},
+  {"", NULL, 0, 0, 0, "Error", SILC_LOG_ERROR, NULL, NULL},
+  {"", NULL, 0, 0, 0, "Fatal", SILC_LOG_FATAL, NULL, NULL},
 };
 
 /* Return log context by type */
@@ -96,18 +107,16 @@ static SilcLog silc_log_get_context(SilcLogType type)
 static void silc_log_checksize(SilcLog log)
 {
   char newname[256];
-  SilcUInt64 size;
 
-  if (!log || !log->fp || !log->maxsize)
+  if (!log || !log->fp)
     return;
 
-  size = silc_file_size(log->filename);
-  if (!size) {
-    fclose(log->fp);
-    log->fp = NULL;
-  }
-
-  if (size < log->maxsize)
+  /* Size is tracked as bytes written, so this costs no stat call and
+     can run after every message; time-based rotation uses the open
+     time. */
+  if (!(log->maxsize && log->written >= log->maxsize) &&
+      !(silclog_rotate_secs &&
+	silc_time() - log->opened >= (SilcInt64)silclog_rotate_secs))
     return;
 
   /* Cycle log file */
@@ -124,6 +133,8 @@ static void silc_log_checksize(SilcLog log)
   rename(log->filename, newname);
 
   log->fp = fopen(log->filename, "w");
+  log->written = 0;
+  log->opened = silc_time();
   if (!log->fp)
     SILC_LOG_WARNING(("Couldn't reopen log file '%s' for type '%s': %s",
 		      log->filename, log->typename, strerror(errno)));
@@ -160,17 +171,177 @@ SILC_TASK_CALLBACK(silc_log_fflush_callback)
 #endif /* !SILC_SYMBIAN */
 }
 
+/* Asynchronous logging.  Producers push preformatted records to a
+   lock-free queue and a dedicated writer thread drains them to the log
+   files, so the event loop never stalls on disk flushes. */
+
+typedef struct SilcLogAsyncRecStruct {
+  struct SilcLogAsyncRecStruct *next;
+  char *string;			       /* Formatted message, or NULL */
+  const char *fmt;		       /* Deferred format (binary mode) */
+  SilcUInt64 args[4];		       /* Deferred arguments */
+  SilcLogType type;
+} SilcLogAsyncRec;
+
+static struct {
+  SilcMPSCQueue queue;
+  SilcMutex lock;
+  SilcCond cond;
+  void *thread;
+  unsigned int running : 1;
+  unsigned int stop    : 1;
+} silclog_async;
+
+static void silc_log_output_sync(SilcLogType type, char *string);
+static void silc_log_format_deferred(SilcLogAsyncRec *rec);
+
+/* The log writer thread */
+
+static void *silc_log_async_thread(void *context)
+{
+  SilcLogAsyncRec *rec;
+
+  for (;;) {
+    while ((rec = silc_mpsc_queue_pop(silclog_async.queue))) {
+      if (!rec->string)
+	silc_log_format_deferred(rec);
+      if (rec->string)
+	silc_log_output_sync(rec->type, rec->string);
+      silc_free(rec);
+    }
+
+    if (silclog_async.stop &&
+	silc_mpsc_queue_empty(silclog_async.queue))
+      break;
+
+    silc_mutex_lock(silclog_async.lock);
+    if (silc_mpsc_queue_empty(silclog_async.queue) && !silclog_async.stop)
+      silc_cond_timedwait(silclog_async.cond, silclog_async.lock, 200);
+    silc_mutex_unlock(silclog_async.lock);
+  }
+
+  return NULL;
+}
+
+/* Enable or disable asynchronous logging */
+
+void silc_log_set_async(SilcBool enable)
+{
+  if (enable) {
+    if (silclog_async.running)
+      return;
+
+    silc_mpsc_queue_init(silclog_async.queue, SilcLogAsyncRec, next);
+    if (!silc_mutex_alloc(&silclog_async.lock))
+      return;
+    if (!silc_cond_alloc(&silclog_async.cond)) {
+      silc_mutex_free(silclog_async.lock);
+      return;
+    }
+    silclog_async.stop = FALSE;
+    silclog_async.thread = silc_thread_create(silc_log_async_thread, NULL,
+					      TRUE);
+    if (!silclog_async.thread) {
+      silc_cond_free(silclog_async.cond);
+      silc_mutex_free(silclog_async.lock);
+      return;
+    }
+    silclog_async.running = TRUE;
+    return;
+  }
+
+  if (!silclog_async.running)
+    return;
+
+  /* Stop the writer; it drains the queue before exiting */
+  silclog_async.stop = TRUE;
+  silc_mutex_lock(silclog_async.lock);
+  silc_cond_signal(silclog_async.cond);
+  silc_mutex_unlock(silclog_async.lock);
+  silc_thread_wait(silclog_async.thread, NULL);
+  silc_cond_free(silclog_async.cond);
+  silc_mutex_free(silclog_async.lock);
+  silclog_async.running = FALSE;
+}
+
 /* Output log message to log file */
 
 void silc_log_output(SilcLogType type, char *string)
+{
+  /* A fatal error dumps the flight recorder before anything else; the
+     recent per-thread history is the context the message lacks. */
+  if (silc_unlikely(type == SILC_LOG_FATAL)) {
+    char fname[64];
+    silc_snprintf(fname, sizeof(fname), "flightrec-%d.dump",
+		  getpid());
+    silc_flight_dump(fname);
+  }
+
+  /* In asynchronous mode hand the record to the writer thread */
+  if (silclog_async.running && !silclog_async.stop) {
+    SilcLogAsyncRec *rec = silc_malloc(sizeof(*rec));
+    if (rec) {
+      rec->string = string;
+      rec->fmt = NULL;
+      rec->type = type;
+      if (silc_mpsc_queue_push(silclog_async.queue, rec)) {
+	silc_mutex_lock(silclog_async.lock);
+	silc_cond_signal(silclog_async.cond);
+	silc_mutex_unlock(silclog_async.lock);
+      }
+      return;
+    }
+  }
+
+  silc_log_output_sync(type, string);
+}
+
+/* Returns the formatted timestamp for log output.  The string is
+   rendered only when the current second changes; at high message rates
+   the timestamp is almost always served from the cache. */
+
+static const char *silc_log_timestamp_string(void)
+{
+  static char cache[64];
+  static SilcInt64 cache_sec = 0;
+  SilcInt64 now = silc_time();
+
+  if (silc_unlikely(now != cache_sec)) {
+    silc_snprintf(cache, sizeof(cache), "%s", silc_time_string(now));
+    cache_sec = now;
+  }
+
+  return cache;
+}
+
+/* Synchronous log output */
+
+static void silc_log_output_sync(SilcLogType type, char *string)
 {
   const char *typename = NULL;
   SilcLog log = silc_log_get_context(type);
+  SilcUInt32 repeated = 0;
   FILE *fp;
+  int len;
 
   if (!log)
     goto end;
 
+  /* Suppress duplicate messages; an error storm writes one line plus
+     a repeat count instead of the same line millions of times. */
+  if (string && !strncmp(string, silclog_dedup_last,
+			 sizeof(silclog_dedup_last) - 1) &&
+      string[0] && strlen(string) < sizeof(silclog_dedup_last)) {
+    silclog_dedup_count++;
+    silc_free(string);
+    return;
+  }
+  repeated = silclog_dedup_count;
+  silclog_dedup_count = 0;
+  if (string)
+    silc_snprintf(silclog_dedup_last, sizeof(silclog_dedup_last), "%s",
+		  string);
+
   /* Forward to callback if set */
   if (log->cb)
     if ((*log->cb)(type, string, log->context))
@@ -207,16 +378,22 @@ void silc_log_output(SilcLogType type, char *string)
 
 #ifndef SILC_SYMBIAN
  found:
+  if (repeated)
+    fprintf(fp, "[%s] [%s] last message repeated %u times\n",
+	    silc_log_timestamp_string(), typename, repeated);
+
   if (silclog.timestamp)
-    fprintf(fp, "[%s] [%s] %s\n", silc_time_string(0), typename, string);
+    len = fprintf(fp, "[%s] [%s] %s\n", silc_log_timestamp_string(),
+		  typename, string);
   else
-    fprintf(fp, "[%s] %s\n", typename, string);
+    len = fprintf(fp, "[%s] %s\n", typename, string);
+  if (log && len > 0)
+    log->written += len;
 
-  if (silclog.quick || silclog.starting) {
+  if (silclog.quick || silclog.starting)
     fflush(fp);
-    if (log)
-      silc_log_checksize(log);
-  }
+  if (log)
+    silc_log_checksize(log);
 #endif /* !SILC_SYMBIAN */
 
  end:
@@ -233,6 +410,145 @@ void silc_log_output(SilcLogType type, char *string)
   silc_free(string);
 }
 
+/* Formats a deferred (binary) record.  Only integer, pointer and
+   character conversions are supported; the arguments were stored as raw
+   words when the record was made. */
+
+static void silc_log_format_deferred(SilcLogAsyncRec *rec)
+{
+  char buf[1024];
+  const char *p = rec->fmt;
+  SilcUInt32 j = 0, a = 0;
+  SilcUInt64 v;
+
+  while (*p && j < sizeof(buf) - 1) {
+    if (*p != '%') {
+      buf[j++] = *p++;
+      continue;
+    }
+
+    p++;
+    v = a < 4 ? rec->args[a++] : 0;
+    switch (*p++) {
+    case 'd':
+      j += silc_snprintf(buf + j, sizeof(buf) - j, "%d", (int)v);
+      break;
+    case 'u':
+      j += silc_snprintf(buf + j, sizeof(buf) - j, "%u", (unsigned int)v);
+      break;
+    case 'x':
+      j += silc_snprintf(buf + j, sizeof(buf) - j, "%x", (unsigned int)v);
+      break;
+    case 'l':
+      /* %lu, %llu etc; all stored as 64 bits */
+      while (*p == 'l')
+	p++;
+      j += silc_snprintf(buf + j, sizeof(buf) - j, "%llu",
+			 (unsigned long long)v);
+      p++;
+      break;
+    case 'p':
+      j += silc_snprintf(buf + j, sizeof(buf) - j, "%p", (void *)v);
+      break;
+    case 'c':
+      buf[j++] = (char)v;
+      break;
+    case '%':
+      buf[j++] = '%';
+      a--;
+      break;
+    default:
+      buf[j++] = '?';
+      break;
+    }
+    if (j > sizeof(buf) - 1)
+      j = sizeof(buf) - 1;
+  }
+  buf[j] = '\0';
+
+  rec->string = silc_strdup(buf);
+}
+
+/* Binary debug logging; stores the format string pointer and the raw
+   argument words and defers all formatting to the log writer thread.
+   Only integer, pointer and character conversions may be used in the
+   format; strings cannot, since the record outlives the call.  Without
+   asynchronous logging the record is formatted immediately. */
+
+void silc_log_binary(SilcLogType type, const char *fmt, SilcUInt64 arg1,
+		     SilcUInt64 arg2, SilcUInt64 arg3, SilcUInt64 arg4)
+{
+  SilcLogAsyncRec *rec;
+
+  if (silclog_async.running && !silclog_async.stop) {
+    rec = silc_malloc(sizeof(*rec));
+    if (rec) {
+      rec->string = NULL;
+      rec->fmt = fmt;
+      rec->args[0] = arg1;
+      rec->args[1] = arg2;
+      rec->args[2] = arg3;
+      rec->args[3] = arg4;
+      rec->type = type;
+      if (silc_mpsc_queue_push(silclog_async.queue, rec)) {
+	silc_mutex_lock(silclog_async.lock);
+	silc_cond_signal(silclog_async.cond);
+	silc_mutex_unlock(silclog_async.lock);
+      }
+      return;
+    }
+  }
+
+  /* Synchronous fallback */
+  {
+    SilcLogAsyncRec tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.fmt = fmt;
+    tmp.args[0] = arg1;
+    tmp.args[1] = arg2;
+    tmp.args[2] = arg3;
+    tmp.args[3] = arg4;
+    tmp.type = type;
+    silc_log_format_deferred(&tmp);
+    if (tmp.string)
+      silc_log_output_sync(type, tmp.string);
+  }
+}
+
+/* Debug module registry for bitmask gated debugging */
+
+SilcUInt32 silc_log_debug_modules_mask = 0;
+static char silc_log_module_names[32][32];
+static SilcUInt32 silc_log_num_modules = 0;
+
+/* Register debug module */
+
+SilcUInt32 silc_log_register_module(const char *name)
+{
+  SilcUInt32 i;
+
+  for (i = 0; i < silc_log_num_modules; i++)
+    if (!strcmp(silc_log_module_names[i], name))
+      return (SilcUInt32)1 << i;
+
+  if (silc_log_num_modules >= 32) {
+    silc_set_errno(SILC_ERR_LIMIT);
+    return 0;
+  }
+
+  silc_strncat(silc_log_module_names[silc_log_num_modules],
+	       sizeof(silc_log_module_names[0]), name, strlen(name));
+
+  return (SilcUInt32)1 << silc_log_num_modules++;
+}
+
+/* Set enabled debug modules */
+
+void silc_log_set_debug_modules(SilcUInt32 mask)
+{
+  silc_log_debug_modules_mask = mask;
+}
+
 /* Set and initialize the specified log file. */
 
 SilcBool silc_log_set_file(SilcLogType type, char *filename,
@@ -277,6 +593,8 @@ SilcBool silc_log_set_file(SilcLogType type, char *filename,
   if (fp) {
     log->fp = fp;
     log->maxsize = maxsize;
+    log->written = silc_file_size(filename);
+    log->opened = silc_time();
 
     memset(log->filename, 0, sizeof(log->filename));
     silc_strncat(log->filename, sizeof(log->filename), filename,
@@ -303,6 +621,15 @@ char *silc_log_get_file(SilcLogType type)
   return log && log->fp ? log->filename : NULL;
 }
 
+/* Set time-based log rotation */
+
+void silc_log_set_rotation(SilcUInt32 secs)
+{
+#ifndef SILC_SYMBIAN
+  silclog_rotate_secs = secs;
+#endif /* !SILC_SYMBIAN */
+}
+
 /* Sets a log callback, set callback to NULL to return to default behaviour */
 
 void silc_log_set_callback(SilcLogType type, SilcLogCb cb, void *context)
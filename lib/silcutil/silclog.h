@@ -552,4 +552,105 @@ void silc_log_debug(SilcBool enable);
  ***/
 void silc_log_debug_hexdump(SilcBool enable);
 
+/****f* silcutil/silc_log_set_async
+ *
+ * SYNOPSIS
+ *
+ *    void silc_log_set_async(SilcBool enable);
+ *
+ * DESCRIPTION
+ *
+ *    Enables or disables asynchronous logging.  When enabled, log
+ *    messages are pushed to a lock-free queue and a dedicated writer
+ *    thread writes and flushes them to the log files, so logging
+ *    callers never block on disk.  Disabling waits until the queue has
+ *    drained.  Messages can be lost on crash before the writer has
+ *    flushed them.
+ *
+ ***/
+void silc_log_set_async(SilcBool enable);
+
+/****f* silcutil/silc_log_binary
+ *
+ * SYNOPSIS
+ *
+ *    void silc_log_binary(SilcLogType type, const char *fmt,
+ *                         SilcUInt64 arg1, SilcUInt64 arg2,
+ *                         SilcUInt64 arg3, SilcUInt64 arg4);
+ *
+ * DESCRIPTION
+ *
+ *    Logs a message by recording only the format string pointer and up
+ *    to four raw argument words; all formatting is deferred to the
+ *    asynchronous log writer thread, turning the log call into little
+ *    more than a few stores.  Only integer, pointer and character
+ *    conversions may appear in `fmt'; string arguments cannot be used
+ *    since the record outlives the call.  Requires asynchronous logging
+ *    (silc_log_set_async); otherwise formats and logs immediately.
+ *
+ ***/
+void silc_log_binary(SilcLogType type, const char *fmt, SilcUInt64 arg1,
+		     SilcUInt64 arg2, SilcUInt64 arg3, SilcUInt64 arg4);
+
+/****f* silcutil/silc_log_register_module
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_log_register_module(const char *name);
+ *
+ * DESCRIPTION
+ *
+ *    Registers a debug module `name' and returns its bit for
+ *    SILC_LOG_DEBUG_MODULE and silc_log_set_debug_modules.  Up to 32
+ *    modules can be registered; registering the same name again returns
+ *    the same bit.  Returns 0 when the modules run out.
+ *
+ ***/
+SilcUInt32 silc_log_register_module(const char *name);
+
+/****f* silcutil/silc_log_set_debug_modules
+ *
+ * SYNOPSIS
+ *
+ *    void silc_log_set_debug_modules(SilcUInt32 mask);
+ *
+ * DESCRIPTION
+ *
+ *    Sets the bitmask of enabled debug modules.  Debug output through
+ *    SILC_LOG_DEBUG_MODULE costs only one load and test when the module
+ *    is disabled, unlike the string matching of
+ *    silc_log_set_debug_string.
+ *
+ ***/
+void silc_log_set_debug_modules(SilcUInt32 mask);
+
+/****d* silcutil/SILC_LOG_DEBUG_MODULE
+ *
+ * NAME
+ *
+ *    #define SILC_LOG_DEBUG_MODULE(module, fmt)
+ *
+ * DESCRIPTION
+ *
+ *    As SILC_LOG_DEBUG but gated by the debug module bit `module'
+ *    returned by silc_log_register_module.  When the module is not
+ *    enabled with silc_log_set_debug_modules the whole call reduces to
+ *    one load and test, so rich debug logging can be left compiled in
+ *    on hot paths.
+ *
+ * SOURCE
+ */
+extern DLLAPI SilcUInt32 silc_log_debug_modules_mask;
+
+#if defined(SILC_DEBUG)
+#define SILC_LOG_DEBUG_MODULE(module, fmt)		\
+do {							\
+  if (silc_log_debug_modules_mask & (module))		\
+    SILC_LOG_DEBUG(fmt);				\
+} while(0)
+#else
+#define SILC_LOG_DEBUG_MODULE(module, fmt) do { } while(0)
+#endif /* SILC_DEBUG */
+/***/
+
 #endif	/* !SILCLOG_H */
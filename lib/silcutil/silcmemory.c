@@ -19,6 +19,13 @@
 
 #include "silcruntime.h"
 
+#if defined(HAVE_MALLOC_H) && defined(HAVE_MALLOC_USABLE_SIZE)
+#include <malloc.h>
+#endif
+#if defined(HAVE_NUMA_H) && defined(HAVE_LIBNUMA)
+#include <numa.h>
+#endif
+
 #ifndef SILC_MEMTRACE
 
 #define SILC_MAX_ALLOC (1024 * 1024L * 1024L)
@@ -82,6 +89,134 @@ void *silc_realloc(void *ptr, size_t size)
   return addr;
 }
 
+/* Allocate aligned memory */
+
+void *silc_malloc_aligned(size_t size, SilcUInt32 alignment)
+{
+  unsigned char *ptr, *aligned;
+
+  if (silc_unlikely(!size || !alignment ||
+		    (alignment & (alignment - 1)))) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+#if defined(HAVE_POSIX_MEMALIGN)
+  if (alignment >= sizeof(void *)) {
+    void *p;
+    if (posix_memalign(&p, alignment, size)) {
+      silc_set_errno(SILC_ERR_OUT_OF_MEMORY);
+      return NULL;
+    }
+    return p;
+  }
+#endif /* HAVE_POSIX_MEMALIGN */
+
+  /* Over-allocate and store the offset just below the aligned pointer */
+  ptr = silc_malloc(size + alignment + sizeof(SilcUInt32));
+  if (!ptr)
+    return NULL;
+  aligned = (unsigned char *)
+    (((SilcUInt64)(ptr + sizeof(SilcUInt32) + alignment - 1)) &
+     ~((SilcUInt64)alignment - 1));
+  ((SilcUInt32 *)aligned)[-1] = (SilcUInt32)(aligned - ptr);
+
+  return aligned;
+}
+
+/* Free aligned memory */
+
+void silc_free_aligned(void *ptr)
+{
+  if (!ptr)
+    return;
+
+#if defined(HAVE_POSIX_MEMALIGN)
+  free(ptr);
+#else
+  silc_free((unsigned char *)ptr - ((SilcUInt32 *)ptr)[-1]);
+#endif /* HAVE_POSIX_MEMALIGN */
+}
+
+/* Allocate memory from a NUMA node */
+
+void *silc_malloc_numa(size_t size, int node)
+{
+#if defined(HAVE_NUMA_H) && defined(HAVE_LIBNUMA)
+  void *ptr;
+
+  if (numa_available() >= 0) {
+    ptr = numa_alloc_onnode(size, node);
+    if (ptr)
+      return ptr;
+  }
+#endif /* HAVE_NUMA_H && HAVE_LIBNUMA */
+
+  return silc_malloc(size);
+}
+
+/* Free memory allocated with silc_malloc_numa */
+
+void silc_free_numa(void *ptr, size_t size)
+{
+  if (!ptr)
+    return;
+
+#if defined(HAVE_NUMA_H) && defined(HAVE_LIBNUMA)
+  if (numa_available() >= 0) {
+    numa_free(ptr, size);
+    return;
+  }
+#endif /* HAVE_NUMA_H && HAVE_LIBNUMA */
+
+  silc_free(ptr);
+}
+
+/* Return the usable size of an allocation */
+
+SilcUInt32 silc_malloc_usable_size(void *ptr)
+{
+#if defined(HAVE_MALLOC_USABLE_SIZE)
+  if (ptr)
+    return (SilcUInt32)malloc_usable_size(ptr);
+#endif /* HAVE_MALLOC_USABLE_SIZE */
+  return 0;
+}
+
+/* Reallocate with geometric growth policy */
+
+void *silc_realloc_grow(void *ptr, SilcUInt32 *size, SilcUInt32 needed_size)
+{
+  SilcUInt32 newsize, usable;
+  void *p;
+
+  if (silc_unlikely(!size))
+    return NULL;
+
+  if (needed_size <= *size)
+    return ptr;
+
+  /* Expand into allocator slack without copying when possible */
+  usable = silc_malloc_usable_size(ptr);
+  if (usable >= needed_size) {
+    *size = usable;
+    return ptr;
+  }
+
+  /* Grow geometrically so that a steadily growing buffer is copied
+     O(log n) times instead of once per growth step. */
+  newsize = *size + (*size >> 1);
+  if (newsize < needed_size)
+    newsize = needed_size;
+
+  p = silc_realloc(ptr, newsize);
+  if (silc_unlikely(!p))
+    return NULL;
+
+  *size = newsize;
+  return p;
+}
+
 void silc_free(void *ptr)
 {
   free(ptr);
@@ -68,6 +68,7 @@ void *silc_calloc(size_t items, size_t size);
  * SYNOPSIS
  *
  *    void *silc_realloc(void *ptr, size_t size);
+
  *
  * DESCRIPTION
  *
@@ -85,6 +86,102 @@ void *silc_calloc(size_t items, size_t size);
  ***/
 void *silc_realloc(void *ptr, size_t size);
 
+/****f* silcutil/silc_malloc_aligned
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_malloc_aligned(size_t size, SilcUInt32 alignment);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates `size' bytes of memory aligned to an `alignment' byte
+ *    boundary (a power of two).  Use for example a cache line size
+ *    alignment for per-processor structures to avoid false sharing.
+ *    The memory must be freed with silc_free_aligned.  Returns NULL on
+ *    error and sets silc_errno.
+ *
+ ***/
+void *silc_malloc_aligned(size_t size, SilcUInt32 alignment);
+
+/****f* silcutil/silc_free_aligned
+ *
+ * SYNOPSIS
+ *
+ *    void silc_free_aligned(void *ptr);
+ *
+ * DESCRIPTION
+ *
+ *    Frees memory allocated with silc_malloc_aligned.
+ *
+ ***/
+void silc_free_aligned(void *ptr);
+
+/****f* silcutil/silc_malloc_numa
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_malloc_numa(size_t size, int node);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates `size' bytes of memory from the NUMA node `node', so for
+ *    example a per-scheduler arena lands on the node of the processor
+ *    running that scheduler.  Falls back to normal allocation when NUMA
+ *    support is not available.  The memory must be freed with
+ *    silc_free_numa.
+ *
+ ***/
+void *silc_malloc_numa(size_t size, int node);
+
+/****f* silcutil/silc_free_numa
+ *
+ * SYNOPSIS
+ *
+ *    void silc_free_numa(void *ptr, size_t size);
+ *
+ * DESCRIPTION
+ *
+ *    Frees memory allocated with silc_malloc_numa.  The `size' must be
+ *    the size given to silc_malloc_numa.
+ *
+ ***/
+void silc_free_numa(void *ptr, size_t size);
+
+/****f* silcutil/silc_malloc_usable_size
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_malloc_usable_size(void *ptr);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of usable bytes in the allocation `ptr', which
+ *    may be more than was requested, or 0 if the size cannot be
+ *    determined on the platform.
+ *
+ ***/
+SilcUInt32 silc_malloc_usable_size(void *ptr);
+
+/****f* silcutil/silc_realloc_grow
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_realloc_grow(void *ptr, SilcUInt32 *size,
+ *                            SilcUInt32 needed_size);
+ *
+ * DESCRIPTION
+ *
+ *    Grows the allocation `ptr' of `size' bytes to hold at least
+ *    `needed_size' bytes.  The allocation is first expanded into the
+ *    allocator's slack without copying when possible, and otherwise
+ *    grown geometrically (by half) so that a steadily growing buffer is
+ *    copied O(log n) times instead of on every growth step.  On success
+ *    returns the allocation and updates `size' to the new capacity;
+ *    returns NULL on error and leaves `ptr' intact.
+ *
+ ***/
+void *silc_realloc_grow(void *ptr, SilcUInt32 *size, SilcUInt32 needed_size);
+
 /****f* silcutil/silc_free
  *
  * SYNOPSIS
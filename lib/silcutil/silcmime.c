@@ -140,6 +140,8 @@ SilcMimeAssembler silc_mime_assembler_alloc(void)
 void silc_mime_assembler_free(SilcMimeAssembler assembler)
 {
   silc_hash_table_free(assembler->fragments);
+  if (assembler->streams)
+    silc_hash_table_free(assembler->streams);
   silc_free(assembler);
 }
 
@@ -472,6 +474,103 @@ unsigned char *silc_mime_encode(SilcMime mime, SilcUInt32 *encoded_len)
   return ret;
 }
 
+/* Adds a stack-allocated buffer wrapping `data' to the chain */
+
+static SilcBool silc_mime_chain_ref(SilcStack stack, SilcBufferChain chain,
+				    const unsigned char *data,
+				    SilcUInt32 data_len)
+{
+  SilcBuffer b;
+
+  if (!data_len)
+    return TRUE;
+
+  b = silc_scalloc(stack, 1, sizeof(*b));
+  if (!b)
+    return FALSE;
+  silc_buffer_set(b, (unsigned char *)data, data_len);
+
+  return silc_buffer_chain_add(chain, b);
+}
+
+/* Adds stack-duplicated text to the chain */
+
+static SilcBool silc_mime_chain_text(SilcStack stack, SilcBufferChain chain,
+				     const char *text)
+{
+  SilcUInt32 len = strlen(text);
+  unsigned char *copy;
+
+  if (!len)
+    return TRUE;
+
+  copy = silc_smemdup(stack, text, len);
+  if (!copy)
+    return FALSE;
+
+  return silc_mime_chain_ref(stack, chain, copy, len);
+}
+
+/* Encode MIME message into a buffer chain without flattening */
+
+SilcBool silc_mime_encode_chain(SilcMime mime, SilcBufferChain chain,
+				SilcStack stack)
+{
+  SilcMime part;
+  SilcHashTableList htl;
+  char *field, *value, tmp[1024];
+  int i;
+
+  SILC_LOG_DEBUG(("Encoding MIME message into chain"));
+
+  if (!mime || !chain) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* Encode the headers into one chained segment */
+  i = 0;
+  silc_hash_table_list(mime->fields, &htl);
+  while (silc_hash_table_get(&htl, (void *)&field, (void *)&value)) {
+    silc_snprintf(tmp, sizeof(tmp) - 1, "%s: %s\r\n", field, value);
+    if (!silc_mime_chain_text(stack, chain, tmp)) {
+      silc_hash_table_list_reset(&htl);
+      return FALSE;
+    }
+    i++;
+  }
+  silc_hash_table_list_reset(&htl);
+  if (i && !silc_mime_chain_text(stack, chain, "\r\n"))
+    return FALSE;
+
+  /* Reference the data in place; this is the zero-copy part */
+  if (mime->data)
+    if (!silc_mime_chain_ref(stack, chain, mime->data, mime->data_len))
+      return FALSE;
+
+  /* Multiparts, recursively */
+  if (mime->multiparts) {
+    silc_dlist_start(mime->multiparts);
+    i = 0;
+    while ((part = silc_dlist_get(mime->multiparts)) != SILC_LIST_END) {
+      silc_snprintf(tmp, sizeof(tmp) - 1, "%s--%s\r\n%s",
+		    i != 0 ? "\r\n" : "", mime->boundary,
+		    !silc_hash_table_count(part->fields) ? "\r\n" : "");
+      i = 1;
+      if (!silc_mime_chain_text(stack, chain, tmp))
+	return FALSE;
+      if (!silc_mime_encode_chain(part, chain, stack))
+	return FALSE;
+    }
+
+    silc_snprintf(tmp, sizeof(tmp) - 1, "\r\n--%s--\r\n", mime->boundary);
+    if (!silc_mime_chain_text(stack, chain, tmp))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 /* Assembles MIME message from partial MIME messages */
 
 SilcMime silc_mime_assemble(SilcMimeAssembler assembler, SilcMime partial)
@@ -922,3 +1021,264 @@ SilcDList silc_mime_get_multiparts(SilcMime mime, const char **type)
 
   return mime->multiparts;
 }
+
+/*************************** Zero-copy decoding *****************************/
+
+/* Decode MIME field slices without copying.  Fills at most `max_fields'
+   entries to `fields' with name and value slices pointing into `data'
+   and returns the number of fields, or -1 on error.  The body slice is
+   returned to `ret_body'. */
+
+int silc_mime_decode_view(SilcMimeFieldView *fields, SilcUInt32 max_fields,
+			  const unsigned char *data, SilcUInt32 data_len,
+			  const unsigned char **ret_body,
+			  SilcUInt32 *ret_body_len)
+{
+  SilcUInt32 i = 0, n = 0;
+  const unsigned char *line, *colon, *end;
+
+  if (!data || !data_len) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -1;
+  }
+
+  while (i < data_len) {
+    line = data + i;
+
+    /* Find end of line */
+    end = memchr(line, '\n', data_len - i);
+    if (!end)
+      break;
+    i = (SilcUInt32)(end - data) + 1;
+    if (end > line && end[-1] == '\r')
+      end--;
+
+    /* Empty line ends the headers */
+    if (end == line) {
+      if (ret_body)
+	*ret_body = data + i;
+      if (ret_body_len)
+	*ret_body_len = data_len - i;
+      return (int)n;
+    }
+
+    colon = memchr(line, ':', end - line);
+    if (!colon)
+      continue;
+
+    if (n < max_fields) {
+      fields[n].name = line;
+      fields[n].name_len = (SilcUInt32)(colon - line);
+      colon++;
+      while (colon < end && (*colon == ' ' || *colon == '\t'))
+	colon++;
+      fields[n].value = colon;
+      fields[n].value_len = (SilcUInt32)(end - colon);
+      n++;
+    }
+  }
+
+  if (ret_body)
+    *ret_body = data + data_len;
+  if (ret_body_len)
+    *ret_body_len = 0;
+
+  return (int)n;
+}
+
+/* Find field from decoded slices, case-insensitively */
+
+const unsigned char *silc_mime_view_get_field(SilcMimeFieldView *fields,
+					      SilcUInt32 num_fields,
+					      const char *field,
+					      SilcUInt32 *ret_value_len)
+{
+  SilcUInt32 i, len = strlen(field);
+
+  for (i = 0; i < num_fields; i++) {
+    if (fields[i].name_len == len &&
+	!strncasecmp((const char *)fields[i].name, field, len)) {
+      if (ret_value_len)
+	*ret_value_len = fields[i].value_len;
+      return fields[i].value;
+    }
+  }
+
+  silc_set_errno(SILC_ERR_NOT_FOUND);
+  return NULL;
+}
+
+/************************** Streaming assembly ******************************/
+
+/* Streaming assembly context of one fragment ID */
+typedef struct {
+  SilcStream sink;		       /* Where completed data goes */
+  SilcHashTable pending;	       /* Out of order fragments */
+  char *id;			       /* Fragment ID */
+  int next;			       /* Next expected fragment number */
+  int total;			       /* Total fragments, -1 if unknown */
+} *SilcMimeStreamCtx;
+
+/* Parses fragment id, number and total from the Content-Type of
+   `partial'.  Returns the ID as an allocation. */
+
+static SilcBool silc_mime_fragment_info(SilcMime partial, char **ret_id,
+					int *ret_number, int *ret_total)
+{
+  char *type, *tmp, *id;
+
+  type = (char *)silc_mime_get_field(partial, "Content-Type");
+  if (!type)
+    return FALSE;
+
+  tmp = strstr(type, "id=");
+  if (!tmp || strlen(tmp) <= 4)
+    return FALSE;
+  tmp += 3;
+  if (*tmp == '"')
+    tmp++;
+  id = silc_strdup(tmp);
+  if (!id)
+    return FALSE;
+  if (strchr(id, ';'))
+    *strchr(id, ';') = '\0';
+  if (strrchr(id, '"'))
+    *strrchr(id, '"') = '\0';
+
+  tmp = strstr(type, "number=");
+  if (!tmp || !(tmp = strchr(tmp, '=')) || strlen(tmp) < 2) {
+    silc_free(id);
+    return FALSE;
+  }
+  *ret_number = atoi(tmp + 1);
+
+  *ret_total = -1;
+  tmp = strstr(type, "total=");
+  if (tmp && (tmp = strchr(tmp, '=')) && strlen(tmp) >= 2)
+    *ret_total = atoi(tmp + 1);
+
+  *ret_id = id;
+  return TRUE;
+}
+
+/* Writes fragment data to the sink in full */
+
+static SilcBool silc_mime_stream_flush(SilcMimeStreamCtx ctx, SilcMime p)
+{
+  const unsigned char *data;
+  SilcUInt32 data_len, i = 0;
+  int ret;
+
+  data = silc_mime_get_data(p, &data_len);
+  if (!data)
+    return FALSE;
+
+  while (i < data_len) {
+    ret = silc_stream_write(ctx->sink, (unsigned char *)data + i,
+			    data_len - i);
+    if (ret <= 0)
+      return FALSE;
+    i += ret;
+  }
+
+  return TRUE;
+}
+
+/* Assemble fragments incrementally into a stream.  In-order fragments
+   are written to the `sink' immediately and freed; only out-of-order
+   fragments are buffered, so memory use is bounded by the reordering
+   window instead of the message size.  Returns 1 when the message is
+   complete, 0 while fragments remain, and -1 on error. */
+
+int silc_mime_assemble_stream(SilcMimeAssembler assembler, SilcMime partial,
+			      SilcStream sink)
+{
+  SilcMimeStreamCtx ctx;
+  SilcMime p;
+  char *id = NULL;
+  int number, total;
+
+  if (!assembler || !partial || !sink) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -1;
+  }
+
+  if (!silc_mime_fragment_info(partial, &id, &number, &total)) {
+    silc_set_errno(SILC_ERR_BAD_ENCODING);
+    return -1;
+  }
+
+  if (!assembler->streams) {
+    assembler->streams =
+      silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+			    silc_hash_string_compare, NULL, NULL, NULL,
+			    TRUE);
+    if (!assembler->streams)
+      goto err;
+  }
+
+  if (!silc_hash_table_find(assembler->streams, id, NULL, (void *)&ctx)) {
+    ctx = silc_calloc(1, sizeof(*ctx));
+    if (!ctx)
+      goto err;
+    ctx->sink = sink;
+    ctx->next = 1;
+    ctx->total = -1;
+    ctx->id = id;
+    ctx->pending = silc_hash_table_alloc(NULL, 0, silc_hash_uint, NULL,
+					 NULL, NULL, NULL, NULL, TRUE);
+    if (!ctx->pending) {
+      silc_free(ctx);
+      goto err;
+    }
+    if (!silc_hash_table_add(assembler->streams, ctx->id, ctx)) {
+      silc_hash_table_free(ctx->pending);
+      silc_free(ctx);
+      goto err;
+    }
+    id = NULL;
+  } else {
+    silc_free(id);
+    id = NULL;
+  }
+
+  if (total != -1)
+    ctx->total = total;
+
+  if (number == ctx->next) {
+    /* In order; flush this and any buffered successors */
+    if (!silc_mime_stream_flush(ctx, partial))
+      return -1;
+    silc_mime_free(partial);
+    ctx->next++;
+
+    while (silc_hash_table_find(ctx->pending, SILC_32_TO_PTR(ctx->next),
+				NULL, (void *)&p)) {
+      silc_hash_table_del(ctx->pending, SILC_32_TO_PTR(ctx->next));
+      if (!silc_mime_stream_flush(ctx, p)) {
+	silc_mime_free(p);
+	return -1;
+      }
+      silc_mime_free(p);
+      ctx->next++;
+    }
+  } else {
+    /* Out of order; buffer */
+    silc_hash_table_add(ctx->pending, SILC_32_TO_PTR(number), partial);
+  }
+
+  if (ctx->total != -1 && ctx->next > ctx->total) {
+    /* Complete */
+    silc_hash_table_del(assembler->streams, ctx->id);
+    silc_hash_table_free(ctx->pending);
+    silc_free(ctx->id);
+    silc_free(ctx);
+    return 1;
+  }
+
+  return 0;
+
+ err:
+  silc_free(id);
+  return -1;
+}
@@ -190,6 +190,29 @@ SilcMime silc_mime_decode(SilcMime mime, const unsigned char *data,
  ***/
 unsigned char *silc_mime_encode(SilcMime mime, SilcUInt32 *encoded_len);
 
+/****f* silcutil/silc_mime_encode_chain
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_mime_encode_chain(SilcMime mime, SilcBufferChain chain,
+ *                                    SilcStack stack);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_mime_encode but appends the encoded message to the buffer
+ *    `chain' without flattening: part payloads are referenced in place
+ *    and only the headers and boundaries are rendered, so encoding a
+ *    large multipart message costs no payload copies.  The chain is
+ *    sent with silc_stream_write_chain (one gather write on streams
+ *    with vectored I/O).  The chain's segment wrappers and rendered
+ *    text are allocated from `stack' (NULL for the heap); free the
+ *    chain with silc_buffer_chain_free(chain, FALSE) and keep `mime'
+ *    alive until the chain has been sent.
+ *
+ ***/
+SilcBool silc_mime_encode_chain(SilcMime mime, SilcBufferChain chain,
+				SilcStack stack);
+
 /****f* silcutil/silc_mime_assemble
  *
  * SYNOPSIS
@@ -427,4 +450,92 @@ SilcDList silc_mime_get_multiparts(SilcMime mime, const char **type);
 
 #include "silcmime_i.h"
 
+/****s* silcutil/SilcMimeFieldView
+ *
+ * NAME
+ *
+ *    typedef struct SilcMimeFieldViewStruct SilcMimeFieldView;
+ *
+ * DESCRIPTION
+ *
+ *    One header field as pointer and length slices into the caller's
+ *    buffer, filled by silc_mime_decode_view.  Nothing is allocated or
+ *    copied; the buffer must stay valid while the slices are used.
+ *
+ * SOURCE
+ */
+typedef struct SilcMimeFieldViewStruct {
+  const unsigned char *name;	       /* Field name slice */
+  const unsigned char *value;	       /* Field value slice */
+  SilcUInt32 name_len;		       /* Name length */
+  SilcUInt32 value_len;		       /* Value length */
+} SilcMimeFieldView;
+/***/
+
+/****f* silcutil/silc_mime_decode_view
+ *
+ * SYNOPSIS
+ *
+ *    int silc_mime_decode_view(SilcMimeFieldView *fields,
+ *                              SilcUInt32 max_fields,
+ *                              const unsigned char *data,
+ *                              SilcUInt32 data_len,
+ *                              const unsigned char **ret_body,
+ *                              SilcUInt32 *ret_body_len);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_mime_decode but without allocating or copying anything:
+ *    header names and values are returned as slices into `data' and the
+ *    body as a slice after the headers.  Fills at most `max_fields'
+ *    entries and returns the number of fields, or -1 on error.  For
+ *    per-request header parsing this removes all allocations.
+ *
+ ***/
+int silc_mime_decode_view(SilcMimeFieldView *fields, SilcUInt32 max_fields,
+			  const unsigned char *data, SilcUInt32 data_len,
+			  const unsigned char **ret_body,
+			  SilcUInt32 *ret_body_len);
+
+/****f* silcutil/silc_mime_view_get_field
+ *
+ * SYNOPSIS
+ *
+ *    const unsigned char *
+ *    silc_mime_view_get_field(SilcMimeFieldView *fields,
+ *                             SilcUInt32 num_fields, const char *field,
+ *                             SilcUInt32 *ret_value_len);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the value slice of the header `field' from the decoded
+ *    slices, or NULL if not present.  Comparison is case-insensitive.
+ *
+ ***/
+const unsigned char *silc_mime_view_get_field(SilcMimeFieldView *fields,
+					      SilcUInt32 num_fields,
+					      const char *field,
+					      SilcUInt32 *ret_value_len);
+
+/****f* silcutil/silc_mime_assemble_stream
+ *
+ * SYNOPSIS
+ *
+ *    int silc_mime_assemble_stream(SilcMimeAssembler assembler,
+ *                                  SilcMime partial, SilcStream sink);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_mime_assemble but assembles incrementally into the `sink'
+ *    stream: fragments arriving in order are written out immediately
+ *    and freed, and only out-of-order fragments are buffered, so memory
+ *    use is bounded by the reordering window instead of the total
+ *    message size.  The `partial' is consumed on in-order delivery.
+ *    Returns 1 when the message completed, 0 while fragments remain
+ *    and -1 on error.
+ *
+ ***/
+int silc_mime_assemble_stream(SilcMimeAssembler assembler, SilcMime partial,
+			      SilcStream sink);
+
 #endif /* SILCMIME_H */
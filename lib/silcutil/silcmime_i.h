@@ -37,6 +37,7 @@ struct SilcMimeStruct {
 /* MIME assembler */
 struct SilcMimeAssemblerStruct {
   SilcHashTable fragments;
+  SilcHashTable streams;	       /* Streaming assembly contexts */
 };
 
 #endif /* SILCMIME_I_H */
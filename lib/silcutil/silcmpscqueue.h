@@ -0,0 +1,190 @@
+/*
+
+  silcmpscqueue.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/MPSC Queue Interface
+ *
+ * DESCRIPTION
+ *
+ * Intrusive lock-free multiple-producer single-consumer queue.  Like
+ * SilcList, any structure with a next pointer can be queued; the
+ * interface does not allocate memory.  Any number of producer threads
+ * push entries concurrently without locks; exactly one consumer thread
+ * at a time pops them in push order.  This is intended for passing work
+ * from producer threads to a scheduler-bound or other single consumer
+ * without mutexes.
+ *
+ * EXAMPLE
+ *
+ * struct EntryStruct {
+ *   int data;
+ *   struct EntryStruct *next;        // The queue member pointer
+ * };
+ *
+ * SilcMPSCQueue queue;
+ *
+ * // Initialize queue
+ * silc_mpsc_queue_init(queue, struct EntryStruct, next);
+ *
+ * // Producer threads
+ * if (silc_mpsc_queue_push(queue, entry))
+ *   wakeup_consumer();
+ *
+ * // Consumer thread
+ * while ((entry = silc_mpsc_queue_pop(queue)))
+ *   ...
+ *
+ ***/
+
+#ifndef SILCMPSCQUEUE_H
+#define SILCMPSCQUEUE_H
+
+/****s* silcutil/SilcMPSCQueue
+ *
+ * NAME
+ *
+ *    typedef struct SilcMPSCQueueStruct SilcMPSCQueue;
+ *
+ * DESCRIPTION
+ *
+ *    This is the MPSC queue context, initialized by calling the
+ *    silc_mpsc_queue_init.
+ *
+ ***/
+typedef struct SilcMPSCQueueStruct {
+  SilcAtomicPointer head;	     /* Producer side, newest first */
+  void *drained;		     /* Consumer side, push order */
+  SilcUInt16 next_offset;	     /* Offset to 'next' pointer */
+} SilcMPSCQueue;
+
+/* Get position of next pointer in queued entry */
+#define __silc_mpsc_next(queue, pos)				\
+  ((void **)((unsigned char *)(pos) + (queue)->next_offset))
+
+/****f* silcutil/silc_mpsc_queue_init
+ *
+ * SYNOPSIS
+ *
+ *    #define silc_mpsc_queue_init(queue, type, nextfield) ...
+ *
+ * DESCRIPTION
+ *
+ *    Initializes the MPSC queue.  The arguments are as in
+ *    silc_list_init; the `nextfield' is the pointer in the entry
+ *    structure used to link the queued entries.  The entry must not be
+ *    in the queue more than once at a time.
+ *
+ ***/
+#define silc_mpsc_queue_init(queue, type, nextfield)			\
+do {									\
+  silc_atomic_init_pointer(&(queue).head, NULL);			\
+  (queue).drained = NULL;						\
+  (queue).next_offset = silc_offsetof(type, nextfield);			\
+} while(0)
+
+/****f* silcutil/silc_mpsc_queue_push
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_mpsc_queue_push(SilcMPSCQueue queue, void *entry);
+ *
+ * DESCRIPTION
+ *
+ *    Pushes the `entry' to the queue.  May be called from any number of
+ *    threads concurrently without locking.  Returns TRUE if the queue
+ *    was empty before the push; a producer typically wakes up the
+ *    consumer only in that case, so a burst of pushes costs one wakeup.
+ *
+ ***/
+#define silc_mpsc_queue_push(queue, entry)	\
+  __silc_mpsc_queue_push(&(queue), (entry))
+static inline
+SilcBool __silc_mpsc_queue_push(SilcMPSCQueue *queue, void *entry)
+{
+  void *head;
+
+  do {
+    head = silc_atomic_get_pointer(&queue->head);
+    *__silc_mpsc_next(queue, entry) = head;
+  } while (!silc_atomic_cas_pointer(&queue->head, head, entry));
+
+  return head == NULL;
+}
+
+/****f* silcutil/silc_mpsc_queue_pop
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_mpsc_queue_pop(SilcMPSCQueue queue);
+ *
+ * DESCRIPTION
+ *
+ *    Pops the oldest entry from the queue, or returns NULL if the queue
+ *    is empty.  Must be called from one consumer thread at a time only.
+ *
+ ***/
+#define silc_mpsc_queue_pop(queue) __silc_mpsc_queue_pop(&(queue))
+static inline
+void *__silc_mpsc_queue_pop(SilcMPSCQueue *queue)
+{
+  void *e, *next, *prev;
+
+  if (!queue->drained) {
+    /* Take the whole producer stack and reverse it to push order */
+    e = silc_atomic_get_pointer(&queue->head);
+    if (!e)
+      return NULL;
+    while (!silc_atomic_cas_pointer(&queue->head, e, NULL))
+      e = silc_atomic_get_pointer(&queue->head);
+
+    prev = NULL;
+    while (e) {
+      next = *__silc_mpsc_next(queue, e);
+      *__silc_mpsc_next(queue, e) = prev;
+      prev = e;
+      e = next;
+    }
+    queue->drained = prev;
+  }
+
+  e = queue->drained;
+  queue->drained = *__silc_mpsc_next(queue, e);
+  return e;
+}
+
+/****f* silcutil/silc_mpsc_queue_empty
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_mpsc_queue_empty(SilcMPSCQueue queue);
+ *
+ * DESCRIPTION
+ *
+ *    Returns TRUE if the queue appears empty.  Only the consumer thread
+ *    can rely on the result.
+ *
+ ***/
+#define silc_mpsc_queue_empty(queue) __silc_mpsc_queue_empty(&(queue))
+static inline
+SilcBool __silc_mpsc_queue_empty(SilcMPSCQueue *queue)
+{
+  return queue->drained == NULL &&
+    silc_atomic_get_pointer(&queue->head) == NULL;
+}
+
+#endif /* SILCMPSCQUEUE_H */
@@ -77,6 +77,24 @@ typedef struct SilcRwLockStruct *SilcRwLock;
  ***/
 SilcBool silc_mutex_alloc(SilcMutex *mutex);
 
+/****f* silcutil/silc_mutex_alloc_adaptive
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_mutex_alloc_adaptive(SilcMutex *mutex);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_mutex_alloc but the returned mutex spins briefly trying to
+ *    take the lock before parking the thread in the kernel.  With hot
+ *    short critical sections the lock is usually acquired during the
+ *    spin and the futex round trip is avoided.  Use for short critical
+ *    sections only; long hold times waste processor time in the
+ *    spinners.
+ *
+ ***/
+SilcBool silc_mutex_alloc_adaptive(SilcMutex *mutex);
+
 /****f* silcutil/silc_mutex_free
  *
  * SYNOPSIS
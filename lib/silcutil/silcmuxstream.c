@@ -0,0 +1,449 @@
+/*
+
+  silcmuxstream.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+/* Channel multiplexing over one stream.  Frames are [id(2), len(4)]
+   followed by payload.  Writes go out as a gather list of header and
+   payload; short writes queue in the mux and continue on write-ready.
+   Received frames are demultiplexed to per-channel read buffers; a
+   channel left undrained past its high watermark pauses reading from
+   the underlying stream, backpressuring the peer. */
+
+#include "silcruntime.h"
+#include "silcmuxstream.h"
+
+/* Frame header length */
+#define SILC_MUX_HEADER 6
+
+/* Per-channel read buffer high watermark */
+#define SILC_MUX_READ_LIMIT 262144
+
+const SilcStreamOps silc_mux_channel_ops;
+
+/* Channel context; a SilcStream */
+typedef struct SilcMuxChannelStruct {
+  const SilcStreamOps *ops;
+  struct SilcMuxStreamStruct *mux;     /* The multiplexer */
+  SilcBuffer inbuf;		       /* Received data */
+  SilcStreamNotifier notifier;
+  void *notifier_context;
+  SilcUInt16 id;		       /* Channel id */
+  unsigned int write_blocked : 1;      /* Waiting for write-ready */
+} *SilcMuxChannel;
+
+/* Multiplexer context */
+struct SilcMuxStreamStruct {
+  SilcStream stream;		       /* Underlying stream */
+  SilcSchedule schedule;
+  SilcHashTable channels;	       /* id to channel */
+  SilcBuffer outbuf;		       /* Queued unsent frame data */
+  SilcBuffer inbuf;		       /* Partial received frame */
+  SilcUInt32 rr_next;		       /* Round-robin write-ready cursor */
+  unsigned int paused : 1;	       /* Reading paused (backpressure) */
+};
+
+/************************ Static utility functions **************************/
+
+/* Appends data to a buffer's tail area, growing it when needed */
+
+static SilcBool silc_mux_append(SilcBuffer buf, const unsigned char *data,
+				SilcUInt32 data_len)
+{
+  if (silc_buffer_taillen(buf) < data_len)
+    if (!silc_buffer_realloc(buf, silc_buffer_truelen(buf) +
+			     (data_len - silc_buffer_taillen(buf))))
+      return FALSE;
+  memcpy(buf->tail, data, data_len);
+  silc_buffer_pull_tail(buf, data_len);
+  return TRUE;
+}
+
+/* Drains queued frame data to the underlying stream */
+
+static SilcBool silc_mux_drain(SilcMuxStream mux)
+{
+  int ret;
+
+  while (silc_buffer_len(mux->outbuf) > 0) {
+    ret = silc_stream_write(mux->stream, silc_buffer_data(mux->outbuf),
+			    silc_buffer_len(mux->outbuf));
+    if (ret == 0 || ret == -2)
+      return FALSE;
+    if (ret == -1)
+      return TRUE;
+    silc_buffer_pull(mux->outbuf, ret);
+  }
+
+  silc_buffer_reset(mux->outbuf);
+  return TRUE;
+}
+
+/* Wakes blocked channel writers fairly, round robin */
+
+static void silc_mux_notify_writers(SilcMuxStream mux)
+{
+  SilcMuxChannel c;
+  SilcHashTableList htl;
+  SilcMuxChannel blocked[64];
+  SilcUInt32 i, n = 0;
+
+  if (silc_buffer_len(mux->outbuf))
+    return;
+
+  silc_hash_table_list(mux->channels, &htl);
+  while (n < 64 && silc_hash_table_get(&htl, NULL, (void *)&c))
+    if (c->write_blocked)
+      blocked[n++] = c;
+  silc_hash_table_list_reset(&htl);
+
+  /* Start from the round-robin cursor so one busy channel cannot hog
+     the write readiness */
+  for (i = 0; i < n; i++) {
+    c = blocked[(mux->rr_next + i) % n];
+    c->write_blocked = FALSE;
+    if (c->notifier)
+      c->notifier((SilcStream)c, SILC_STREAM_CAN_WRITE,
+		  c->notifier_context);
+  }
+  if (n)
+    mux->rr_next++;
+}
+
+/* Parses and delivers complete frames from the mux input buffer */
+
+static void silc_mux_demux(SilcMuxStream mux)
+{
+  SilcMuxChannel c;
+  SilcUInt32 len;
+  SilcUInt16 id;
+  unsigned char *p;
+
+  while (silc_buffer_len(mux->inbuf) >= SILC_MUX_HEADER) {
+    p = silc_buffer_data(mux->inbuf);
+    SILC_GET16_MSB(id, p);
+    SILC_GET32_MSB(len, p + 2);
+
+    if (silc_buffer_len(mux->inbuf) < SILC_MUX_HEADER + len)
+      break;
+
+    if (silc_hash_table_find(mux->channels, SILC_32_TO_PTR(id), NULL,
+			     (void *)&c)) {
+      silc_mux_append(c->inbuf, p + SILC_MUX_HEADER, len);
+      if (c->notifier)
+	c->notifier((SilcStream)c, SILC_STREAM_CAN_READ,
+		    c->notifier_context);
+    }
+    /* Frames to unknown channels are dropped */
+
+    silc_buffer_pull(mux->inbuf, SILC_MUX_HEADER + len);
+  }
+
+  /* Compact the partial frame to the buffer start */
+  if (silc_buffer_len(mux->inbuf)) {
+    len = silc_buffer_len(mux->inbuf);
+    memmove(mux->inbuf->head, silc_buffer_data(mux->inbuf), len);
+    silc_buffer_reset(mux->inbuf);
+    silc_buffer_pull_tail(mux->inbuf, len);
+  } else {
+    silc_buffer_reset(mux->inbuf);
+  }
+}
+
+/* Returns TRUE if some channel is past its read watermark */
+
+static SilcBool silc_mux_backpressure(SilcMuxStream mux)
+{
+  SilcMuxChannel c;
+  SilcHashTableList htl;
+
+  silc_hash_table_list(mux->channels, &htl);
+  while (silc_hash_table_get(&htl, NULL, (void *)&c)) {
+    if (silc_buffer_len(c->inbuf) >= SILC_MUX_READ_LIMIT) {
+      silc_hash_table_list_reset(&htl);
+      return TRUE;
+    }
+  }
+  silc_hash_table_list_reset(&htl);
+
+  return FALSE;
+}
+
+/* I/O callback from the underlying stream */
+
+static void silc_mux_io(SilcStream stream, SilcStreamStatus status,
+			void *context)
+{
+  SilcMuxStream mux = context;
+  unsigned char buf[16384];
+  int ret;
+
+  if (status == SILC_STREAM_CAN_WRITE) {
+    if (silc_mux_drain(mux))
+      silc_mux_notify_writers(mux);
+    return;
+  }
+
+  /* Readable; stop reading while a channel is over its watermark */
+  while (!silc_mux_backpressure(mux)) {
+    ret = silc_stream_read(mux->stream, buf, sizeof(buf));
+    if (ret == -1)
+      return;
+    if (ret == 0 || ret == -2) {
+      /* Deliver end of stream to all channels as readable; their reads
+	 return the remaining data and then the end */
+      SilcMuxChannel c;
+      SilcHashTableList htl;
+      silc_hash_table_list(mux->channels, &htl);
+      while (silc_hash_table_get(&htl, NULL, (void *)&c))
+	if (c->notifier)
+	  c->notifier((SilcStream)c, SILC_STREAM_CAN_READ,
+		      c->notifier_context);
+      silc_hash_table_list_reset(&htl);
+      return;
+    }
+
+    silc_mux_append(mux->inbuf, buf, ret);
+    silc_mux_demux(mux);
+  }
+}
+
+/************************* Channel stream operations ************************/
+
+static int silc_mux_channel_read(SilcStream stream, unsigned char *buf,
+				 SilcUInt32 buf_len)
+{
+  SilcMuxChannel c = stream;
+  SilcUInt32 len = silc_buffer_len(c->inbuf);
+  SilcBool paused;
+
+  if (!len) {
+    silc_set_errno(SILC_ERR_WOULD_BLOCK);
+    return -1;
+  }
+
+  if (len > buf_len)
+    len = buf_len;
+  memcpy(buf, silc_buffer_data(c->inbuf), len);
+  silc_buffer_pull(c->inbuf, len);
+
+  if (!silc_buffer_len(c->inbuf))
+    silc_buffer_reset(c->inbuf);
+
+  /* Resume reading from the underlying stream if we were the
+     backpressure */
+  paused = silc_mux_backpressure(c->mux);
+  if (!paused)
+    silc_mux_io(c->mux->stream, SILC_STREAM_CAN_READ, c->mux);
+
+  return (int)len;
+}
+
+static int silc_mux_channel_write(SilcStream stream,
+				  const unsigned char *data,
+				  SilcUInt32 data_len)
+{
+  SilcMuxChannel c = stream;
+  SilcMuxStream mux = c->mux;
+  SilcStreamIOVec iov[2];
+  unsigned char header[SILC_MUX_HEADER];
+  int ret;
+
+  /* Preserve frame ordering; with queued data everything goes through
+     the queue */
+  SILC_PUT16_MSB(c->id, header);
+  SILC_PUT32_MSB(data_len, header + 2);
+
+  if (!silc_buffer_len(mux->outbuf)) {
+    iov[0].data = header;
+    iov[0].data_len = SILC_MUX_HEADER;
+    iov[1].data = (unsigned char *)data;
+    iov[1].data_len = data_len;
+
+    ret = silc_stream_writev(mux->stream, iov, 2);
+    if (ret == 0 || ret == -2)
+      return ret;
+    if (ret == -1)
+      ret = 0;
+
+    if ((SilcUInt32)ret >= SILC_MUX_HEADER + data_len)
+      return (int)data_len;
+
+    /* Queue the remainder of the frame */
+    if (ret < SILC_MUX_HEADER) {
+      silc_mux_append(mux->outbuf, header + ret, SILC_MUX_HEADER - ret);
+      silc_mux_append(mux->outbuf, data, data_len);
+    } else {
+      silc_mux_append(mux->outbuf, data + (ret - SILC_MUX_HEADER),
+		      data_len - (ret - SILC_MUX_HEADER));
+    }
+    c->write_blocked = TRUE;
+    return (int)data_len;
+  }
+
+  /* Queue the whole frame behind the pending data */
+  silc_mux_append(mux->outbuf, header, SILC_MUX_HEADER);
+  silc_mux_append(mux->outbuf, data, data_len);
+  c->write_blocked = TRUE;
+
+  return (int)data_len;
+}
+
+static SilcBool silc_mux_channel_close(SilcStream stream)
+{
+  return TRUE;
+}
+
+static void silc_mux_channel_destroy(SilcStream stream)
+{
+  SilcMuxChannel c = stream;
+
+  silc_hash_table_del(c->mux->channels, SILC_32_TO_PTR(c->id));
+  silc_buffer_free(c->inbuf);
+  silc_free(c);
+}
+
+static SilcBool silc_mux_channel_notifier(SilcStream stream,
+					  SilcSchedule schedule,
+					  SilcStreamNotifier callback,
+					  void *context)
+{
+  SilcMuxChannel c = stream;
+
+  c->notifier = callback;
+  c->notifier_context = context;
+
+  return TRUE;
+}
+
+static SilcSchedule silc_mux_channel_get_schedule(SilcStream stream)
+{
+  SilcMuxChannel c = stream;
+  return c->mux->schedule;
+}
+
+const SilcStreamOps silc_mux_channel_ops =
+{
+  silc_mux_channel_read,
+  silc_mux_channel_write,
+  silc_mux_channel_close,
+  silc_mux_channel_destroy,
+  silc_mux_channel_notifier,
+  silc_mux_channel_get_schedule,
+};
+
+/****************************** Public API **********************************/
+
+/* Create multiplexer */
+
+SilcMuxStream silc_mux_stream_create(SilcStream stream,
+				     SilcSchedule schedule)
+{
+  SilcMuxStream mux;
+
+  if (!stream) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  mux = silc_calloc(1, sizeof(*mux));
+  if (!mux)
+    return NULL;
+
+  mux->stream = stream;
+  mux->schedule = schedule ? schedule : silc_stream_get_schedule(stream);
+  mux->channels = silc_hash_table_alloc(NULL, 0, silc_hash_uint, NULL,
+					NULL, NULL, NULL, NULL, TRUE);
+  mux->outbuf = silc_buffer_alloc(16384);
+  mux->inbuf = silc_buffer_alloc(16384);
+  if (!mux->channels || !mux->outbuf || !mux->inbuf) {
+    if (mux->channels)
+      silc_hash_table_free(mux->channels);
+    silc_buffer_free(mux->outbuf);
+    silc_buffer_free(mux->inbuf);
+    silc_free(mux);
+    return NULL;
+  }
+  silc_buffer_reset(mux->outbuf);
+  silc_buffer_reset(mux->inbuf);
+
+  silc_stream_set_notifier(stream, mux->schedule, silc_mux_io, mux);
+
+  SILC_LOG_DEBUG(("Created mux stream %p over %p", mux, stream));
+
+  return mux;
+}
+
+/* Destroy multiplexer and channels */
+
+void silc_mux_stream_destroy(SilcMuxStream mux)
+{
+  SilcMuxChannel c;
+  SilcHashTableList htl;
+
+  if (!mux)
+    return;
+
+  silc_stream_set_notifier(mux->stream, mux->schedule, NULL, NULL);
+
+  silc_hash_table_list(mux->channels, &htl);
+  while (silc_hash_table_get(&htl, NULL, (void *)&c)) {
+    silc_buffer_free(c->inbuf);
+    silc_free(c);
+  }
+  silc_hash_table_list_reset(&htl);
+  silc_hash_table_free(mux->channels);
+
+  silc_buffer_free(mux->outbuf);
+  silc_buffer_free(mux->inbuf);
+  silc_free(mux);
+}
+
+/* Open channel */
+
+SilcStream silc_mux_stream_open(SilcMuxStream mux, SilcUInt16 id)
+{
+  SilcMuxChannel c;
+
+  if (silc_hash_table_find(mux->channels, SILC_32_TO_PTR(id), NULL, NULL)) {
+    silc_set_errno(SILC_ERR_ALREADY_EXISTS);
+    return NULL;
+  }
+
+  c = silc_calloc(1, sizeof(*c));
+  if (!c)
+    return NULL;
+
+  c->ops = &silc_mux_channel_ops;
+  c->mux = mux;
+  c->id = id;
+  c->inbuf = silc_buffer_alloc(4096);
+  if (!c->inbuf) {
+    silc_free(c);
+    return NULL;
+  }
+  silc_buffer_reset(c->inbuf);
+
+  if (!silc_hash_table_add(mux->channels, SILC_32_TO_PTR(id), c)) {
+    silc_buffer_free(c->inbuf);
+    silc_free(c);
+    return NULL;
+  }
+
+  SILC_LOG_DEBUG(("Opened mux channel %d", id));
+
+  return (SilcStream)c;
+}
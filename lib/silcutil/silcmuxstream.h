@@ -0,0 +1,102 @@
+/*
+
+  silcmuxstream.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Mux Stream Interface
+ *
+ * DESCRIPTION
+ *
+ * The mux stream runs many logical channels over one underlying stream
+ * (typically one TCP connection).  Each channel is a SilcStream of its
+ * own, with its own notifier; the mux frames channel writes onto the
+ * underlying stream and demultiplexes received frames to the channels'
+ * read buffers.  Both ends of the connection must use the mux stream
+ * and agree on the channel ids.
+ *
+ * A channel whose read buffer the application does not drain pauses
+ * reading from the underlying stream, providing backpressure.
+ *
+ ***/
+
+#ifndef SILCMUXSTREAM_H
+#define SILCMUXSTREAM_H
+
+/****s* silcutil/SilcMuxStream
+ *
+ * NAME
+ *
+ *    typedef struct SilcMuxStreamStruct *SilcMuxStream;
+ *
+ * DESCRIPTION
+ *
+ *    The multiplexer context created by silc_mux_stream_create.
+ *
+ ***/
+typedef struct SilcMuxStreamStruct *SilcMuxStream;
+
+/****f* silcutil/silc_mux_stream_create
+ *
+ * SYNOPSIS
+ *
+ *    SilcMuxStream silc_mux_stream_create(SilcStream stream,
+ *                                         SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Creates a multiplexer over the `stream'.  The mux takes over the
+ *    stream's notifier.  Channels are opened with
+ *    silc_mux_stream_open.  Freed with silc_mux_stream_destroy, which
+ *    destroys all channels but not the underlying stream.
+ *
+ ***/
+SilcMuxStream silc_mux_stream_create(SilcStream stream,
+				     SilcSchedule schedule);
+
+/****f* silcutil/silc_mux_stream_destroy
+ *
+ * SYNOPSIS
+ *
+ *    void silc_mux_stream_destroy(SilcMuxStream mux);
+ *
+ * DESCRIPTION
+ *
+ *    Destroys the multiplexer and all its channel streams.  The
+ *    underlying stream is not destroyed.
+ *
+ ***/
+void silc_mux_stream_destroy(SilcMuxStream mux);
+
+/****f* silcutil/silc_mux_stream_open
+ *
+ * SYNOPSIS
+ *
+ *    SilcStream silc_mux_stream_open(SilcMuxStream mux, SilcUInt16 id);
+ *
+ * DESCRIPTION
+ *
+ *    Opens logical channel `id' and returns its stream.  The channel is
+ *    used with the normal silc_stream_* API; its notifier delivers
+ *    SILC_STREAM_CAN_READ when a frame for the channel has arrived and
+ *    SILC_STREAM_CAN_WRITE when a blocked write can continue.  Returns
+ *    NULL if the channel is already open.  The channel is closed with
+ *    silc_stream_destroy.
+ *
+ ***/
+SilcStream silc_mux_stream_open(SilcMuxStream mux, SilcUInt16 id);
+
+#endif /* SILCMUXSTREAM_H */
@@ -119,36 +119,145 @@ int silc_net_get_socket_opt(int sock, int level, int option,
 
 /* Checks whether IP address sent as argument is valid IPv4 address. */
 
-SilcBool silc_net_is_ip4(const char *addr)
+/* Single-pass dotted-quad parser.  Parses and validates `addr' into
+   `bin' (network order) in one scan; called on every accept and ACL
+   evaluation, so no library round trips. */
+
+SilcBool silc_net_parse_ip4(const char *addr, unsigned char *bin)
+{
+  unsigned int octet = 0, digits = 0, octets = 0;
+  unsigned char c;
+
+  for (;;) {
+    c = (unsigned char)*addr++;
+    if (c >= '0' && c <= '9') {
+      octet = octet * 10 + (c - '0');
+      if (octet > 255 || ++digits > 3)
+	return FALSE;
+      continue;
+    }
+    if (c == '.' || c == '\0') {
+      if (!digits || octets == 4)
+	return FALSE;
+      bin[octets++] = (unsigned char)octet;
+      octet = digits = 0;
+      if (c == '\0')
+	break;
+      continue;
+    }
+    return FALSE;
+  }
+
+  return octets == 4;
+}
+
+/* Parses an IPv6 address (full, ::-compressed and trailing dotted-quad
+   forms) into 16 bytes in network order, one scan, no getaddrinfo. */
+
+SilcBool silc_net_parse_ip6(const char *addr, unsigned char *bin)
 {
-  int count = 0;
+  unsigned char tmp[16], v4[4];
+  unsigned int group = 0, digits = 0, groups = 0;
+  int zpos = -1;
+  const char *group_start = addr;
+  unsigned char c;
+
+  if (addr[0] == ':' && addr[1] != ':')
+    return FALSE;
+
+  for (;;) {
+    c = (unsigned char)*addr;
+
+    if (isxdigit(c)) {
+      group = (group << 4) |
+	(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+      if (++digits > 4)
+	return FALSE;
+      addr++;
+      continue;
+    }
+
+    if (c == ':') {
+      unsigned int had = digits;
+
+      if (addr[1] == ':' && zpos != -1)
+	return FALSE;			/* Only one :: allowed */
+      if (digits) {
+	if (groups == 8)
+	  return FALSE;
+	tmp[groups * 2] = (unsigned char)(group >> 8);
+	tmp[groups * 2 + 1] = (unsigned char)(group & 0xff);
+	groups++;
+	group = digits = 0;
+      }
+      if (addr[1] == ':') {
+	zpos = groups;
+	addr++;
+      } else if (!had) {
+	return FALSE;			/* Lone colon without a group */
+      }
+      addr++;
+      group_start = addr;
+      continue;
+    }
 
-  while (*addr) {
-    if (*addr != '.' && !isdigit((int)*addr))
+    if (c == '.') {
+      /* Trailing IPv4 form; re-parse the last group as dotted quad */
+      if (groups > 6 || !silc_net_parse_ip4(group_start, v4))
+	return FALSE;
+      tmp[groups * 2] = v4[0];
+      tmp[groups * 2 + 1] = v4[1];
+      tmp[groups * 2 + 2] = v4[2];
+      tmp[groups * 2 + 3] = v4[3];
+      groups += 2;
+      group = digits = 0;
+      break;
+    }
+
+    if (c == '\0') {
+      if (digits) {
+	if (groups == 8)
+	  return FALSE;
+	tmp[groups * 2] = (unsigned char)(group >> 8);
+	tmp[groups * 2 + 1] = (unsigned char)(group & 0xff);
+	groups++;
+      }
+      break;
+    }
+
+    return FALSE;
+  }
+
+  if (zpos == -1) {
+    if (groups != 8)
       return FALSE;
-    if (*addr == '.')
-      count++;
-    addr++;
+    memcpy(bin, tmp, 16);
+    return TRUE;
   }
 
-  if (count != 3)
+  /* Expand the :: gap */
+  if (groups == 8)
     return FALSE;
+  memset(bin, 0, 16);
+  memcpy(bin, tmp, zpos * 2);
+  memcpy(bin + 16 - (groups - zpos) * 2, tmp + zpos * 2,
+	 (groups - zpos) * 2);
 
   return TRUE;
 }
 
+SilcBool silc_net_is_ip4(const char *addr)
+{
+  unsigned char bin[4];
+  return silc_net_parse_ip4(addr, bin);
+}
+
 /* Checks whether IP address sent as argument is valid IPv6 address. */
 
 SilcBool silc_net_is_ip6(const char *addr)
 {
-  /* XXX does this work with all kinds of IPv6 addresses? */
-  while (*addr) {
-    if (*addr != ':' && !isxdigit((int)*addr))
-      return FALSE;
-    addr++;
-  }
-
-  return TRUE;
+  unsigned char bin[16];
+  return silc_net_parse_ip6(addr, bin);
 }
 
 /* Checks whether IP address sent as argument is valid IP address. */
@@ -161,13 +270,14 @@ SilcBool silc_net_is_ip(const char *addr)
 }
 
 /* Internal context for async resolving */
-typedef struct {
+typedef struct SilcNetResolveContextStruct {
   SilcNetResolveCallback completion;
   void *context;
   SilcBool prefer_ipv6;
   SilcSchedule schedule;
   char *input;
   char *result;
+  struct SilcNetResolveContextStruct *coalesced; /* Coalesced waiters */
 } *SilcNetResolveContext;
 
 SILC_TASK_CALLBACK(silc_net_resolve_completion)
@@ -183,6 +293,137 @@ SILC_TASK_CALLBACK(silc_net_resolve_completion)
   silc_free(r);
 }
 
+/* Resolver engine.  Lookups run in a fixed worker pool, results are
+   cached with a TTL and duplicate in-flight lookups of the same name are
+   coalesced into one resolution. */
+
+#define SILC_NET_RESOLVER_WORKERS   4	   /* Worker threads */
+#define SILC_NET_RESOLVER_TTL	    300	   /* Positive result TTL, seconds */
+#define SILC_NET_RESOLVER_NEG_TTL   10	   /* Negative result TTL, seconds */
+
+/* Cache entry */
+typedef struct {
+  char *result;				   /* Result, NULL for negative */
+  SilcInt64 expire;			   /* Expiry time */
+} *SilcNetResolverCacheEntry;
+
+/* Resolver context */
+typedef struct {
+  SilcMutex lock;
+  SilcHashTable cache;			   /* Name to cache entry */
+  SilcHashTable inflight;		   /* Name to waiter list */
+  SilcThreadPool pool;			   /* Resolver workers */
+} *SilcNetResolver;
+
+/* Worker context */
+typedef struct {
+  char *key;				   /* Cache key (name + family) */
+  char *name;				   /* Name to resolve */
+  SilcBool prefer_ipv6;
+} *SilcNetResolverLookup;
+
+/* Cache entry destructor */
+
+static void silc_net_resolver_cache_destructor(void *key, void *context,
+					       void *user_context)
+{
+  SilcNetResolverCacheEntry e = context;
+  silc_free(key);
+  silc_free(e->result);
+  silc_free(e);
+}
+
+/* Inflight entry destructor; the waiters are delivered separately */
+
+static void silc_net_resolver_inflight_destructor(void *key, void *context,
+						  void *user_context)
+{
+  silc_free(key);
+}
+
+/* Returns the resolver, creating it on first use */
+
+static SilcNetResolver silc_net_resolver(void)
+{
+  SilcNetResolver res = silc_global_get_var("srtresolver", FALSE);
+
+  if (res)
+    return res;
+
+  res = silc_global_set_var("srtresolver", sizeof(*res), NULL, FALSE);
+  if (!res)
+    return NULL;
+
+  if (!silc_mutex_alloc(&res->lock))
+    return NULL;
+  res->cache = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+				     silc_hash_string_compare, NULL,
+				     silc_net_resolver_cache_destructor,
+				     NULL, TRUE);
+  res->inflight = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+					silc_hash_string_compare, NULL,
+					silc_net_resolver_inflight_destructor,
+					NULL, TRUE);
+  res->pool = silc_thread_pool_alloc(NULL, 1, SILC_NET_RESOLVER_WORKERS,
+				     TRUE);
+
+  return res;
+}
+
+/* Delivers the result to a waiter through its scheduler */
+
+static void silc_net_resolver_deliver(SilcNetResolveContext r,
+				      const char *result)
+{
+  r->result = result ? silc_strdup(result) : NULL;
+  silc_schedule_task_add(r->schedule, 0, silc_net_resolve_completion, r,
+			 0, 1, SILC_TASK_TIMEOUT);
+  silc_schedule_wakeup(r->schedule);
+}
+
+/* Resolver worker; resolves the name, caches the result and delivers it
+   to all waiters coalesced on the name. */
+
+static void silc_net_resolver_worker(SilcSchedule schedule, void *context)
+{
+  SilcNetResolverLookup lookup = context;
+  SilcNetResolver res = silc_net_resolver();
+  SilcNetResolverCacheEntry e;
+  SilcNetResolveContext r, next;
+  void *waiters = NULL;
+  char tmp[64], *result = NULL;
+
+  if (silc_net_gethostbyname(lookup->name, lookup->prefer_ipv6, tmp,
+			     sizeof(tmp)))
+    result = tmp;
+
+  silc_mutex_lock(res->lock);
+
+  /* Cache the result */
+  e = silc_calloc(1, sizeof(*e));
+  if (e) {
+    e->result = result ? silc_strdup(result) : NULL;
+    e->expire = silc_time() + (result ? SILC_NET_RESOLVER_TTL :
+			       SILC_NET_RESOLVER_NEG_TTL);
+    silc_hash_table_set(res->cache, silc_strdup(lookup->key), e);
+  }
+
+  /* Take the coalesced waiters */
+  silc_hash_table_find(res->inflight, lookup->key, NULL, &waiters);
+  silc_hash_table_del(res->inflight, lookup->key);
+
+  silc_mutex_unlock(res->lock);
+
+  for (r = waiters; r; r = next) {
+    next = r->coalesced;
+    silc_net_resolver_deliver(r, result);
+  }
+
+  silc_free(lookup->key);
+  silc_free(lookup->name);
+  silc_free(lookup);
+}
+
 /* Thread function to resolve the address for hostname. */
 
 static void *silc_net_gethostbyname_thread(void *context)
@@ -298,6 +539,11 @@ void silc_net_gethostbyname_async(const char *name,
 				  void *context)
 {
   SilcNetResolveContext r = silc_calloc(1, sizeof(*r));
+  SilcNetResolver res;
+  SilcNetResolverCacheEntry e;
+  SilcNetResolverLookup lookup;
+  void *waiters;
+  char key[264];
 
   if (!schedule) {
     schedule = silc_schedule_get_global();
@@ -310,7 +556,71 @@ void silc_net_gethostbyname_async(const char *name,
   r->schedule = schedule;
   r->input = silc_strdup(name);
 
-  silc_thread_create(silc_net_gethostbyname_thread, r, FALSE);
+  res = silc_net_resolver();
+  if (!res || !res->cache || !res->inflight || !res->pool) {
+    /* Resolver could not be created; resolve in own thread */
+    silc_thread_create(silc_net_gethostbyname_thread, r, FALSE);
+    return;
+  }
+
+  silc_snprintf(key, sizeof(key), "%s/%d", name, prefer_ipv6 ? 6 : 4);
+
+  silc_mutex_lock(res->lock);
+
+  /* Serve fresh results from the cache */
+  if (silc_hash_table_find(res->cache, key, NULL, (void *)&e)) {
+    if (e->expire > silc_time()) {
+      char *result = e->result ? silc_strdup(e->result) : NULL;
+      silc_mutex_unlock(res->lock);
+      r->result = result;
+
+      /* In direct completion mode a same-thread cache hit skips the
+	 scheduler round trip */
+      if (silc_async_direct(schedule)) {
+	silc_net_resolve_completion(schedule, NULL, 0, 0, r);
+	return;
+      }
+
+      silc_schedule_task_add(schedule, 0, silc_net_resolve_completion, r,
+			     0, 1, SILC_TASK_TIMEOUT);
+      silc_schedule_wakeup(schedule);
+      return;
+    }
+    silc_hash_table_del(res->cache, key);
+  }
+
+  /* Coalesce with an in-flight lookup of the same name */
+  if (silc_hash_table_find(res->inflight, key, NULL, &waiters)) {
+    r->coalesced = waiters;
+    silc_hash_table_set(res->inflight, silc_strdup(key), r);
+    silc_mutex_unlock(res->lock);
+    return;
+  }
+
+  lookup = silc_calloc(1, sizeof(*lookup));
+  if (!lookup) {
+    silc_mutex_unlock(res->lock);
+    silc_thread_create(silc_net_gethostbyname_thread, r, FALSE);
+    return;
+  }
+  lookup->key = silc_strdup(key);
+  lookup->name = silc_strdup(name);
+  lookup->prefer_ipv6 = prefer_ipv6;
+
+  silc_hash_table_add(res->inflight, silc_strdup(key), r);
+  silc_mutex_unlock(res->lock);
+
+  /* Resolve in the fixed worker pool */
+  if (!silc_thread_pool_run(res->pool, TRUE, NULL,
+			    silc_net_resolver_worker, lookup, NULL, NULL)) {
+    silc_mutex_lock(res->lock);
+    silc_hash_table_del(res->inflight, key);
+    silc_mutex_unlock(res->lock);
+    silc_free(lookup->key);
+    silc_free(lookup->name);
+    silc_free(lookup);
+    silc_thread_create(silc_net_gethostbyname_thread, r, FALSE);
+  }
 }
 
 /* Resolves hostname by IP address. */
@@ -120,6 +120,154 @@ silc_net_tcp_create_listener(const char **local_ip_addr,
 			     SilcSchedule schedule,
 			     SilcNetCallback callback, void *context);
 
+/****s* silcutil/SilcNetSocketProfile
+ *
+ * NAME
+ *
+ *    typedef struct SilcNetSocketProfileStruct SilcNetSocketProfile;
+ *
+ * DESCRIPTION
+ *
+ *    Declarative socket option profile applied at the right lifecycle
+ *    moments with silc_net_set_socket_profile or
+ *    silc_net_listener_set_profile.  Zero values leave the option at the
+ *    system default.
+ *
+ * SOURCE
+ */
+typedef struct SilcNetSocketProfileStruct {
+  SilcUInt32 user_timeout;	     /* TCP_USER_TIMEOUT, milliseconds */
+  SilcUInt32 keepalive_idle;	     /* TCP_KEEPIDLE, seconds */
+  SilcUInt32 keepalive_interval;     /* TCP_KEEPINTVL, seconds */
+  SilcUInt32 keepalive_count;	     /* TCP_KEEPCNT */
+  unsigned int fastopen     : 1;     /* TCP Fast Open on listener */
+  unsigned int defer_accept : 1;     /* TCP_DEFER_ACCEPT on listener */
+} SilcNetSocketProfile;
+/***/
+
+/****f* silcutil/silc_net_set_socket_profile
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_net_set_socket_profile(int sock, SilcBool listener,
+ *                                         SilcNetSocketProfile *profile);
+ *
+ * DESCRIPTION
+ *
+ *    Applies the socket option `profile' to `sock'.  The listener-only
+ *    options (fast open, defer accept) are applied when `listener' is
+ *    TRUE.  Options not supported by the platform are skipped.  Can be
+ *    used directly on a connected stream's socket (see
+ *    silc_socket_stream_get_info).
+ *
+ ***/
+SilcBool silc_net_set_socket_profile(int sock, SilcBool listener,
+				     SilcNetSocketProfile *profile);
+
+/****f* silcutil/silc_net_listener_set_profile
+ *
+ * SYNOPSIS
+ *
+ *    void silc_net_listener_set_profile(SilcNetListener listener,
+ *                                       SilcNetSocketProfile *profile);
+ *
+ * DESCRIPTION
+ *
+ *    Applies the listener options of `profile' to the listener sockets
+ *    now, and the connection options to every connection the listener
+ *    accepts from now on.
+ *
+ ***/
+void silc_net_listener_set_profile(SilcNetListener listener,
+				   SilcNetSocketProfile *profile);
+
+/****f* silcutil/silc_net_listener_set_deferred_lookup
+ *
+ * SYNOPSIS
+ *
+ *    void silc_net_listener_set_deferred_lookup(SilcNetListener listener,
+ *                                               SilcBool deferred);
+ *
+ * DESCRIPTION
+ *
+ *    When `deferred' is TRUE accepted connections are delivered to the
+ *    listener callback immediately with IP address information only,
+ *    without performing the blocking reverse DNS lookup on the accept
+ *    path.  The application resolves the hostname afterwards with
+ *    silc_socket_stream_resolve if it needs it.
+ *
+ ***/
+void silc_net_listener_set_deferred_lookup(SilcNetListener listener,
+					   SilcBool deferred);
+
+/****f* silcutil/silc_net_listener_set_accept_limits
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool
+ *    silc_net_listener_set_accept_limits(SilcNetListener listener,
+ *                                        SilcUInt32 max_per_sec,
+ *                                        SilcUInt32 max_pending);
+ *
+ * DESCRIPTION
+ *
+ *    Sets accept backpressure limits on the listener.  At most
+ *    `max_per_sec' connections are accepted per second and at most
+ *    `max_pending' accepted connections may be awaiting delivery to
+ *    the application at once (both 0 for no limit).  Connections over
+ *    the limits stay in the kernel backlog and the listener pauses
+ *    briefly instead of turning a reconnect storm into unbounded
+ *    stream allocations.  Throttled accept attempts are counted and
+ *    readable with silc_net_listener_get_overflow.
+ *
+ ***/
+SilcBool silc_net_listener_set_accept_limits(SilcNetListener listener,
+					     SilcUInt32 max_per_sec,
+					     SilcUInt32 max_pending);
+
+/****f* silcutil/silc_net_listener_get_overflow
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_net_listener_get_overflow(SilcNetListener listener);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of times the listener has throttled accepting
+ *    because of the limits set with silc_net_listener_set_accept_limits.
+ *
+ ***/
+SilcUInt64 silc_net_listener_get_overflow(SilcNetListener listener);
+
+/****f* silcutil/silc_net_tcp_create_listener_shard
+ *
+ * SYNOPSIS
+ *
+ *    SilcNetListener
+ *    silc_net_tcp_create_listener_shard(const char *local_ip_addr,
+ *                                       int port, SilcBool lookup,
+ *                                       SilcBool require_fqdn,
+ *                                       SilcSchedule schedule,
+ *                                       SilcNetCallback callback,
+ *                                       void *context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_net_tcp_create_listener but creates one SO_REUSEPORT
+ *    listener socket for the `schedule' and one for each of its child
+ *    schedulers (see silc_schedule_start_children).  The kernel
+ *    balances incoming connections over the shards and each shard
+ *    accepts in its own scheduler, removing the single listener fd
+ *    bottleneck under connect storms.  Returns NULL if SO_REUSEPORT is
+ *    not supported.
+ *
+ ***/
+SilcNetListener
+silc_net_tcp_create_listener_shard(const char *local_ip_addr, int port,
+				   SilcBool lookup, SilcBool require_fqdn,
+				   SilcSchedule schedule,
+				   SilcNetCallback callback, void *context);
+
 /****f* silcutil/silc_net_tcp_create_listener2
  *
  * SYNOPSIS
@@ -342,6 +490,108 @@ int silc_net_udp_receive(SilcStream stream, char *remote_ip_addr,
 			 SilcUInt32 remote_ip_addr_size, int *remote_port,
 			 unsigned char *ret_data, SilcUInt32 data_size);
 
+/****s* silcutil/SilcNetUdpDatagram
+ *
+ * NAME
+ *
+ *    typedef struct SilcNetUdpDatagramStruct { ... } SilcNetUdpDatagram;
+ *
+ * DESCRIPTION
+ *
+ *    One datagram in a batched UDP receive or send performed with
+ *    silc_net_udp_receive_multi or silc_net_udp_send_multi.
+ *
+ * SOURCE
+ */
+typedef struct SilcNetUdpDatagramStruct {
+  unsigned char *data;		/* Datagram data buffer */
+  SilcUInt32 data_size;		/* Size of `data' (receive) */
+  SilcUInt32 data_len;		/* Length of the datagram */
+  char ip_addr[64];		/* Remote IP address */
+  int port;			/* Remote port */
+} SilcNetUdpDatagram;
+/***/
+
+/****f* silcutil/silc_net_udp_receive_multi
+ *
+ * SYNOPSIS
+ *
+ *    int
+ *    silc_net_udp_receive_multi(SilcStream stream,
+ *                               SilcNetUdpDatagram *packets,
+ *                               SilcUInt32 num_packets);
+ *
+ * DESCRIPTION
+ *
+ *    Receives up to `num_packets' UDP packets in one call to the
+ *    datagram array `packets'.  The caller fills in `data' and
+ *    `data_size' of each entry; `data_len', `ip_addr' and `port' are
+ *    filled for each received datagram.  On platforms with recvmmsg(2)
+ *    all datagrams are received with a single system call.  Returns the
+ *    number of datagrams received, -1 if none could be received at this
+ *    moment, or -2 on error.
+ *
+ ***/
+int silc_net_udp_receive_multi(SilcStream stream,
+			       SilcNetUdpDatagram *packets,
+			       SilcUInt32 num_packets);
+
+/****f* silcutil/silc_net_udp_set_gso
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_net_udp_set_gso(SilcStream stream,
+ *                                  SilcUInt32 segment_size);
+ *
+ * DESCRIPTION
+ *
+ *    Enables UDP generic segmentation offload on the UDP stream: a
+ *    single silc_stream_write of a large logical buffer is split by the
+ *    kernel into datagrams of `segment_size' bytes, so a burst of equal
+ *    sized datagrams costs one system call instead of one per datagram.
+ *    Available on Linux; returns FALSE elsewhere.
+ *
+ ***/
+SilcBool silc_net_udp_set_gso(SilcStream stream, SilcUInt32 segment_size);
+
+/****f* silcutil/silc_net_udp_set_gro
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_net_udp_set_gro(SilcStream stream, SilcBool enable);
+ *
+ * DESCRIPTION
+ *
+ *    Enables UDP generic receive offload on the UDP stream so the
+ *    kernel coalesces consecutive datagrams, pairing with
+ *    silc_net_udp_receive_multi for batched delivery from one stream
+ *    notifier call.  Available on Linux; returns FALSE elsewhere.
+ *
+ ***/
+SilcBool silc_net_udp_set_gro(SilcStream stream, SilcBool enable);
+
+/****f* silcutil/silc_net_udp_send_multi
+ *
+ * SYNOPSIS
+ *
+ *    int silc_net_udp_send_multi(SilcStream stream,
+ *                                SilcNetUdpDatagram *packets,
+ *                                SilcUInt32 num_packets);
+ *
+ * DESCRIPTION
+ *
+ *    Sends `num_packets' UDP packets from the datagram array `packets'
+ *    in one call.  The caller fills in `data', `data_len' and, for
+ *    unconnected UDP streams, `ip_addr' and `port' of each entry.  On
+ *    platforms with sendmmsg(2) the datagrams are sent with a single
+ *    system call.  Returns the number of datagrams sent, -1 if none
+ *    could be sent at this moment, or -2 on error.
+ *
+ ***/
+int silc_net_udp_send_multi(SilcStream stream,
+			    SilcNetUdpDatagram *packets,
+			    SilcUInt32 num_packets);
+
 /****f* silcutil/silc_net_udp_send
  *
  * SYNOPSIS
@@ -485,6 +735,25 @@ SilcBool silc_net_is_ip6(const char *addr);
  ***/
 SilcBool silc_net_is_ip(const char *addr);
 
+/****f* silcutil/silc_net_parse_ip4
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_net_parse_ip4(const char *addr, unsigned char *bin);
+ *    SilcBool silc_net_parse_ip6(const char *addr, unsigned char *bin);
+ *
+ * DESCRIPTION
+ *
+ *    Parse and validate an IP address string into its binary form in
+ *    network byte order (4 bytes for IPv4, 16 for IPv6) in one pass,
+ *    without resolver library round trips.  These are the hot-path
+ *    parsers behind silc_net_is_ip4/6 and silc_net_addr2bin; use them
+ *    directly when both validation and the binary form are wanted.
+ *
+ ***/
+SilcBool silc_net_parse_ip4(const char *addr, unsigned char *bin);
+SilcBool silc_net_parse_ip6(const char *addr, unsigned char *bin);
+
 /****f* silcutil/silc_net_addr2bin
  *
  * SYNOPSIS
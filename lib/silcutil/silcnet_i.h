@@ -30,9 +30,19 @@ struct SilcNetListenerStruct {
   SilcNetCallback callback;
   void *context;
   SilcSocket *socks;
+  SilcSchedule *shard_schedules;	     /* Per-sock schedules (shards) */
+  SilcUInt64 overflow_count;		     /* Throttled/deferred accepts */
+  SilcUInt32 accept_limit;		     /* Max accepts per second, 0 off */
+  SilcUInt32 accept_tokens;		     /* Accepts left this second */
+  SilcInt64 accept_refill;		     /* Second of last token refill */
+  SilcUInt32 max_pending;		     /* Undelivered accept cap, 0 off */
+  SilcUInt32 pending;			     /* Accepted, not yet delivered */
   unsigned int socks_count   : 30;
   unsigned int require_fqdn  : 1;
   unsigned int lookup        : 1;
+  unsigned int deferred      : 1;	     /* Deliver before hostname lookup */
+  unsigned int has_profile   : 1;	     /* Set if profile is set */
+  SilcNetSocketProfile profile;		     /* Accepted socket options */
 };
 
 /* Backwards support */
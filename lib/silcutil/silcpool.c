@@ -0,0 +1,249 @@
+/*
+
+  silcpool.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+/* Slab pool allocator with per-thread magazines.  Objects live in slabs
+   of SILC_POOL_SLAB_OBJECTS objects; free objects are cached in a
+   per-thread magazine and moved to and from the shared depot in halves,
+   so a thread's steady get/put churn never takes the depot lock and
+   never reaches the system allocator. */
+
+#include "silcruntime.h"
+#include "silcpool.h"
+
+/* Number of objects per slab */
+#define SILC_POOL_SLAB_OBJECTS 128
+
+/* Magazine capacity */
+#define SILC_POOL_MAGAZINE 32
+
+/* Free object header; lives inside the free object memory */
+typedef struct SilcPoolFreeStruct {
+  struct SilcPoolFreeStruct *next;
+} *SilcPoolFree;
+
+/* One slab */
+typedef struct SilcPoolSlabStruct {
+  struct SilcPoolSlabStruct *next;
+  /* Objects follow */
+} *SilcPoolSlab;
+
+/* Per-thread magazine, kept in a thread-local global variable */
+typedef struct {
+  void *items[SILC_POOL_MAGAZINE];
+  SilcUInt32 count;
+} SilcPoolMagazine;
+
+/* Pool context */
+struct SilcPoolStruct {
+  SilcMutex lock;		      /* Depot lock */
+  SilcPoolSlab slabs;		      /* All slabs */
+  SilcPoolFree depot;		      /* Shared free object list */
+  SilcUInt32 object_size;	      /* Aligned object size */
+  SilcUInt32 depot_count;	      /* Number of objects in depot */
+  SilcAtomic32 live;		      /* Objects taken and not returned */
+  char magname[32];		      /* Thread variable name */
+};
+
+/************************ Static utility functions **************************/
+
+/* Returns the calling thread's magazine for `pool', creating it if
+   needed. */
+
+static SilcPoolMagazine *silc_pool_magazine(SilcPool pool)
+{
+  SilcPoolMagazine *m = silc_global_get_var(pool->magname, TRUE);
+
+  if (!m)
+    m = silc_global_set_var(pool->magname, sizeof(*m), NULL, TRUE);
+
+  return m;
+}
+
+/* Allocates a new slab and pushes its objects to the depot.  Must be
+   called with the depot locked. */
+
+static SilcBool silc_pool_grow(SilcPool pool)
+{
+  SilcPoolSlab slab;
+  unsigned char *obj;
+  SilcUInt32 i;
+
+  slab = silc_malloc(sizeof(*slab) +
+		     pool->object_size * SILC_POOL_SLAB_OBJECTS);
+  if (!slab)
+    return FALSE;
+
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+
+  obj = (unsigned char *)(slab + 1);
+  for (i = 0; i < SILC_POOL_SLAB_OBJECTS; i++) {
+    ((SilcPoolFree)obj)->next = pool->depot;
+    pool->depot = (SilcPoolFree)obj;
+    obj += pool->object_size;
+  }
+  pool->depot_count += SILC_POOL_SLAB_OBJECTS;
+
+  return TRUE;
+}
+
+/****************************** Public API **********************************/
+
+/* Allocate pool */
+
+SilcPool silc_pool_alloc(SilcUInt32 object_size, SilcUInt32 prealloc_count)
+{
+  SilcPool pool;
+
+  if (!object_size) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  pool = silc_calloc(1, sizeof(*pool));
+  if (!pool)
+    return NULL;
+
+  /* Objects must hold the free list header */
+  if (object_size < sizeof(struct SilcPoolFreeStruct))
+    object_size = sizeof(struct SilcPoolFreeStruct);
+  pool->object_size = (object_size + SILC_ALIGNMENT - 1) &
+    ~(SILC_ALIGNMENT - 1);
+
+  if (!silc_mutex_alloc(&pool->lock)) {
+    silc_free(pool);
+    return NULL;
+  }
+  silc_atomic_init32(&pool->live, 0);
+  silc_snprintf(pool->magname, sizeof(pool->magname), "srtpool%p", pool);
+
+  while (prealloc_count > 0) {
+    if (!silc_pool_grow(pool)) {
+      silc_pool_free(pool);
+      return NULL;
+    }
+    prealloc_count -= (prealloc_count > SILC_POOL_SLAB_OBJECTS ?
+		       SILC_POOL_SLAB_OBJECTS : prealloc_count);
+  }
+
+  return pool;
+}
+
+/* Free pool and all slabs */
+
+void silc_pool_free(SilcPool pool)
+{
+  SilcPoolSlab slab, next;
+
+  if (!pool)
+    return;
+
+  for (slab = pool->slabs; slab; slab = next) {
+    next = slab->next;
+    silc_free(slab);
+  }
+
+  silc_mutex_free(pool->lock);
+  silc_atomic_uninit32(&pool->live);
+  silc_free(pool);
+}
+
+/* Get object from pool */
+
+void *silc_pool_get(SilcPool pool)
+{
+  SilcPoolMagazine *m = silc_pool_magazine(pool);
+  SilcPoolFree f;
+  SilcUInt32 i;
+
+  /* Fast path from the magazine */
+  if (m && m->count)
+    goto out;
+
+  /* Refill half a magazine from the depot */
+  silc_mutex_lock(pool->lock);
+  if (!pool->depot_count && !silc_pool_grow(pool)) {
+    silc_mutex_unlock(pool->lock);
+    return NULL;
+  }
+  if (m) {
+    for (i = 0; i < SILC_POOL_MAGAZINE / 2 && pool->depot; i++) {
+      m->items[m->count++] = pool->depot;
+      pool->depot = pool->depot->next;
+      pool->depot_count--;
+    }
+    silc_mutex_unlock(pool->lock);
+  } else {
+    /* No thread variables; serve directly from the depot */
+    f = pool->depot;
+    pool->depot = f->next;
+    pool->depot_count--;
+    silc_mutex_unlock(pool->lock);
+    silc_atomic_add_int32(&pool->live, 1);
+    return f;
+  }
+
+ out:
+  silc_atomic_add_int32(&pool->live, 1);
+  return m->items[--m->count];
+}
+
+/* Return object to pool */
+
+void silc_pool_put(SilcPool pool, void *object)
+{
+  SilcPoolMagazine *m = silc_pool_magazine(pool);
+  SilcUInt32 i;
+
+  if (!object)
+    return;
+
+  silc_atomic_sub_int32(&pool->live, 1);
+
+  if (m) {
+    if (m->count < SILC_POOL_MAGAZINE) {
+      m->items[m->count++] = object;
+      return;
+    }
+
+    /* Magazine full; flush half to the depot */
+    silc_mutex_lock(pool->lock);
+    for (i = 0; i < SILC_POOL_MAGAZINE / 2; i++) {
+      SilcPoolFree f = m->items[--m->count];
+      f->next = pool->depot;
+      pool->depot = f;
+      pool->depot_count++;
+    }
+    m->items[m->count++] = object;
+    silc_mutex_unlock(pool->lock);
+    return;
+  }
+
+  silc_mutex_lock(pool->lock);
+  ((SilcPoolFree)object)->next = pool->depot;
+  pool->depot = (SilcPoolFree)object;
+  pool->depot_count++;
+  silc_mutex_unlock(pool->lock);
+}
+
+/* Return number of live objects */
+
+SilcUInt32 silc_pool_count(SilcPool pool)
+{
+  return silc_atomic_get_int32(&pool->live);
+}
@@ -0,0 +1,130 @@
+/*
+
+  silcpool.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Memory Pool Allocator Interface
+ *
+ * DESCRIPTION
+ *
+ * Slab style pool allocator for long-lived fixed-size objects with high
+ * allocation and release churn.  Objects are carved from larger slabs
+ * and recycled through per-thread magazines, so the common get/put pair
+ * touches no locks and never reaches the system allocator.  The central
+ * depot is shared by all threads and refills and drains the magazines
+ * in batches.
+ *
+ * The pool is thread-safe.  All objects are released back to the system
+ * when the pool is freed; objects need not be individually returned
+ * before that.
+ *
+ ***/
+
+#ifndef SILCPOOL_H
+#define SILCPOOL_H
+
+/****s* silcutil/SilcPool
+ *
+ * NAME
+ *
+ *    typedef struct SilcPoolStruct *SilcPool;
+ *
+ * DESCRIPTION
+ *
+ *    The pool allocator context allocated by silc_pool_alloc and freed
+ *    by silc_pool_free.
+ *
+ ***/
+typedef struct SilcPoolStruct *SilcPool;
+
+/****f* silcutil/silc_pool_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcPool silc_pool_alloc(SilcUInt32 object_size,
+ *                             SilcUInt32 prealloc_count);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates a new pool for objects of `object_size' bytes and
+ *    pre-allocates `prealloc_count' objects (zero for none).  Returns
+ *    NULL on error.
+ *
+ ***/
+SilcPool silc_pool_alloc(SilcUInt32 object_size, SilcUInt32 prealloc_count);
+
+/****f* silcutil/silc_pool_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_pool_free(SilcPool pool);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the pool and all its slabs.  All objects taken from the pool
+ *    become invalid.  The caller must guarantee no other thread uses the
+ *    pool anymore.
+ *
+ ***/
+void silc_pool_free(SilcPool pool);
+
+/****f* silcutil/silc_pool_get
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_pool_get(SilcPool pool);
+ *
+ * DESCRIPTION
+ *
+ *    Returns an object from the pool.  The object contents are
+ *    undefined.  The common case takes the object from the calling
+ *    thread's magazine without locks.  Returns NULL if memory cannot be
+ *    allocated.
+ *
+ ***/
+void *silc_pool_get(SilcPool pool);
+
+/****f* silcutil/silc_pool_put
+ *
+ * SYNOPSIS
+ *
+ *    void silc_pool_put(SilcPool pool, void *object);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the `object' taken with silc_pool_get back to the pool for
+ *    reuse.  The common case pushes to the calling thread's magazine
+ *    without locks.
+ *
+ ***/
+void silc_pool_put(SilcPool pool, void *object);
+
+/****f* silcutil/silc_pool_count
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_pool_count(SilcPool pool);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of objects currently live (taken and not
+ *    returned) from the pool.
+ *
+ ***/
+SilcUInt32 silc_pool_count(SilcPool pool);
+
+#endif /* SILCPOOL_H */
@@ -147,3 +147,169 @@ SilcUInt64 silc_rand64(void)
   return (SilcUInt64)(((SilcUInt64)silc_rand_temper(rs) << 32) |
 		      silc_rand_temper(rs));
 }
+
+/***************************** Fast generator *******************************/
+
+/* xoshiro128** state, kept per thread like the main generator state */
+
+static SilcUInt32 *silc_rand_fast_state(void)
+{
+  SilcUInt32 *xs;
+
+  xs = silc_global_get_var("srtrsx", TRUE);
+  if (!xs) {
+    xs = silc_global_set_var("srtrsx", 4 * sizeof(SilcUInt32), NULL, TRUE);
+    if (!xs)
+      return NULL;
+
+    /* Seed from the main generator */
+    xs[0] = silc_rand();
+    xs[1] = silc_rand();
+    xs[2] = silc_rand();
+    xs[3] = silc_rand();
+    if (!(xs[0] | xs[1] | xs[2] | xs[3]))
+      xs[0] = 1;
+  }
+
+  return xs;
+}
+
+#define SILC_RAND_ROTL(x, k) (((x) << (k)) | ((x) >> (32 - (k))))
+
+/* One xoshiro128** step */
+
+static inline SilcUInt32 silc_rand_fast_next(SilcUInt32 *xs)
+{
+  SilcUInt32 result = SILC_RAND_ROTL(xs[1] * 5, 7) * 9;
+  SilcUInt32 t = xs[1] << 9;
+
+  xs[2] ^= xs[0];
+  xs[3] ^= xs[1];
+  xs[1] ^= xs[2];
+  xs[0] ^= xs[3];
+  xs[2] ^= t;
+  xs[3] = SILC_RAND_ROTL(xs[3], 11);
+
+  return result;
+}
+
+/* Return fast 32-bit random number */
+
+SilcUInt32 silc_rand_fast(void)
+{
+  SilcUInt32 *xs = silc_rand_fast_state();
+
+  if (silc_unlikely(!xs))
+    return silc_rand();
+
+  return silc_rand_fast_next(xs);
+}
+
+/* Fill buffer with random data */
+
+void silc_rand_bytes(unsigned char *buf, SilcUInt32 buf_len)
+{
+  SilcUInt32 *xs = silc_rand_fast_state();
+  SilcUInt32 i = 0, v;
+
+  if (silc_unlikely(!xs)) {
+    while (i < buf_len)
+      buf[i++] = (unsigned char)silc_rand();
+    return;
+  }
+
+  /* Whole words, four per iteration */
+  while (i + 16 <= buf_len) {
+    v = silc_rand_fast_next(xs);
+    memcpy(buf + i, &v, 4);
+    v = silc_rand_fast_next(xs);
+    memcpy(buf + i + 4, &v, 4);
+    v = silc_rand_fast_next(xs);
+    memcpy(buf + i + 8, &v, 4);
+    v = silc_rand_fast_next(xs);
+    memcpy(buf + i + 12, &v, 4);
+    i += 16;
+  }
+  while (i + 4 <= buf_len) {
+    v = silc_rand_fast_next(xs);
+    memcpy(buf + i, &v, 4);
+    i += 4;
+  }
+
+  if (i < buf_len) {
+    v = silc_rand_fast_next(xs);
+    while (i < buf_len) {
+      buf[i++] = (unsigned char)v;
+      v >>= 8;
+    }
+  }
+}
+
+/************************* Instantiable generator ***************************/
+
+/* Instantiable generator context */
+struct SilcRandGenStruct {
+  SilcUInt32 state[4];		       /* xoshiro128** state */
+};
+
+/* Allocate deterministic random generator seeded with `seed' */
+
+SilcRandGen silc_rand_alloc(SilcUInt64 seed)
+{
+  SilcRandGen rng;
+  SilcUInt64 z;
+  int i;
+
+  rng = silc_calloc(1, sizeof(*rng));
+  if (!rng)
+    return NULL;
+
+  /* Expand the seed with splitmix64 so that nearby seeds give unrelated
+     streams */
+  for (i = 0; i < 4; i++) {
+    seed += (SilcUInt64)0x9e3779b97f4a7c15LL;
+    z = seed;
+    z = (z ^ (z >> 30)) * (SilcUInt64)0xbf58476d1ce4e5b9LL;
+    z = (z ^ (z >> 27)) * (SilcUInt64)0x94d049bb133111ebLL;
+    rng->state[i] = (SilcUInt32)(z ^ (z >> 31));
+  }
+  if (!(rng->state[0] | rng->state[1] | rng->state[2] | rng->state[3]))
+    rng->state[0] = 1;
+
+  return rng;
+}
+
+/* Free generator */
+
+void silc_rand_free(SilcRandGen rng)
+{
+  silc_free(rng);
+}
+
+/* Return next random number from the generator */
+
+SilcUInt32 silc_rand_gen(SilcRandGen rng)
+{
+  return silc_rand_fast_next(rng->state);
+}
+
+/* Fill buffer from the generator */
+
+void silc_rand_gen_bytes(SilcRandGen rng, unsigned char *buf,
+			 SilcUInt32 buf_len)
+{
+  SilcUInt32 i = 0, v;
+
+  while (i + 4 <= buf_len) {
+    v = silc_rand_fast_next(rng->state);
+    memcpy(buf + i, &v, 4);
+    i += 4;
+  }
+  if (i < buf_len) {
+    v = silc_rand_fast_next(rng->state);
+    while (i < buf_len) {
+      buf[i++] = (unsigned char)v;
+      v >>= 8;
+    }
+  }
+}
@@ -0,0 +1,186 @@
+/*
+
+  silcrate.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Governor tick interval, milliseconds */
+#define SILC_RATE_TICK_MSEC 100
+
+/* Token bucket */
+struct SilcRateBucketStruct {
+  struct SilcRateBucketStruct *next;
+  struct SilcRateBucketStruct *prev;
+  SilcAtomic32 tokens;		       /* Available tokens */
+  SilcUInt32 rate;		       /* Tokens per second */
+  SilcUInt32 burst;		       /* Bucket size */
+  struct SilcRateGovernorStruct *gov;  /* Owning governor */
+};
+
+/* Per-scheduler-thread governor */
+typedef struct SilcRateGovernorStruct {
+  SilcSchedule schedule;	       /* The governor's scheduler */
+  SilcList buckets;		       /* Registered buckets */
+  unsigned int tick_on : 1;	       /* Tick task scheduled */
+} *SilcRateGovernor;
+
+/* Returns the calling thread's governor */
+
+static SilcRateGovernor silc_rate_governor(void)
+{
+  SilcRateGovernor gov;
+
+  gov = silc_global_get_var("srtgovernor", TRUE);
+  if (!gov) {
+    gov = silc_global_set_var("srtgovernor", sizeof(*gov), NULL, TRUE);
+    if (!gov)
+      return NULL;
+    silc_list_init(gov->buckets, struct SilcRateBucketStruct, next);
+  }
+
+  return gov;
+}
+
+/* The coalesced tick; replenishes every bucket of this governor */
+
+SILC_TASK_CALLBACK(silc_rate_tick)
+{
+  SilcRateGovernor gov = context;
+  SilcRateBucket b;
+  SilcUInt32 old, add, now;
+
+  silc_list_start(gov->buckets);
+  while ((b = silc_list_get(gov->buckets))) {
+    add = b->rate / (1000 / SILC_RATE_TICK_MSEC);
+    if (!add)
+      add = 1;
+
+    /* Add tokens up to the burst cap */
+    do {
+      old = silc_atomic_get_int32(&b->tokens);
+      if (old >= b->burst)
+	break;
+      now = old + add;
+      if (now > b->burst)
+	now = b->burst;
+    } while (!silc_atomic_cas32(&b->tokens, old, now));
+  }
+
+  if (silc_list_count(gov->buckets)) {
+    silc_schedule_task_add_timeout(gov->schedule, silc_rate_tick, gov, 0,
+				   SILC_RATE_TICK_MSEC * 1000);
+  } else {
+    gov->tick_on = FALSE;
+  }
+}
+
+/* Register bucket */
+
+SilcRateBucket silc_rate_bucket_register(SilcSchedule schedule,
+					 SilcUInt32 rate, SilcUInt32 burst)
+{
+  SilcRateGovernor gov;
+  SilcRateBucket b;
+
+  if (!rate || !burst) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return NULL;
+    }
+  }
+
+  gov = silc_rate_governor();
+  if (!gov)
+    return NULL;
+
+  b = silc_calloc(1, sizeof(*b));
+  if (!b)
+    return NULL;
+
+  silc_atomic_init32(&b->tokens, burst);
+  b->rate = rate;
+  b->burst = burst;
+  b->gov = gov;
+
+  gov->schedule = schedule;
+  silc_list_add(gov->buckets, b);
+
+  /* All buckets share one tick task */
+  if (!gov->tick_on) {
+    gov->tick_on = TRUE;
+    silc_schedule_task_add_timeout(schedule, silc_rate_tick, gov, 0,
+				   SILC_RATE_TICK_MSEC * 1000);
+  }
+
+  SILC_LOG_DEBUG(("Registered rate bucket %p, %u/s burst %u", b, rate,
+		  burst));
+
+  return b;
+}
+
+/* Unregister bucket */
+
+void silc_rate_bucket_unregister(SilcRateBucket bucket)
+{
+  if (!bucket)
+    return;
+
+  silc_list_del(bucket->gov->buckets, bucket);
+  silc_atomic_uninit32(&bucket->tokens);
+  silc_free(bucket);
+}
+
+/* Consume tokens */
+
+SilcBool silc_rate_bucket_consume(SilcRateBucket bucket, SilcUInt32 tokens)
+{
+  SilcUInt32 old;
+
+  do {
+    old = silc_atomic_get_int32(&bucket->tokens);
+    if (old < tokens)
+      return FALSE;
+  } while (!silc_atomic_cas32(&bucket->tokens, old, old - tokens));
+
+  return TRUE;
+}
+
+/* Return available tokens */
+
+SilcUInt32 silc_rate_bucket_available(SilcRateBucket bucket)
+{
+  return bucket ? silc_atomic_get_int32(&bucket->tokens) : 0;
+}
+
+/* Change rate */
+
+void silc_rate_bucket_set_rate(SilcRateBucket bucket, SilcUInt32 rate,
+			       SilcUInt32 burst)
+{
+  if (!bucket)
+    return;
+
+  bucket->rate = rate;
+  bucket->burst = burst;
+}
@@ -0,0 +1,131 @@
+/*
+
+  silcrate.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Rate Governor Interface
+ *
+ * DESCRIPTION
+ *
+ * A shared token bucket service integrated with the scheduler.  Code
+ * that needs throttling — QoS, accept limiting, log rate limiting,
+ * reconnect backoff — registers a bucket with a rate and burst size
+ * and consumes tokens with one atomic operation on the hot path.  All
+ * buckets of a scheduler are replenished in bulk by one coalesced
+ * timer tick, so adding throttles does not add timers.
+ *
+ * Consuming is thread safe; registration and unregistration must be
+ * done from the bucket's scheduler thread.
+ *
+ ***/
+
+#ifndef SILCRATE_H
+#define SILCRATE_H
+
+/****s* silcutil/SilcRateBucket
+ *
+ * NAME
+ *
+ *    typedef struct SilcRateBucketStruct *SilcRateBucket;
+ *
+ * DESCRIPTION
+ *
+ *    A token bucket registered with silc_rate_bucket_register.
+ *
+ ***/
+typedef struct SilcRateBucketStruct *SilcRateBucket;
+
+/****f* silcutil/silc_rate_bucket_register
+ *
+ * SYNOPSIS
+ *
+ *    SilcRateBucket silc_rate_bucket_register(SilcSchedule schedule,
+ *                                             SilcUInt32 rate,
+ *                                             SilcUInt32 burst);
+ *
+ * DESCRIPTION
+ *
+ *    Registers a token bucket replenished at `rate' tokens per second
+ *    up to `burst' tokens, on the governor of `schedule' (NULL for the
+ *    global scheduler).  The bucket starts full.  The first bucket of
+ *    a scheduler starts the governor's tick task; further buckets
+ *    share it.  Returns NULL on error.
+ *
+ ***/
+SilcRateBucket silc_rate_bucket_register(SilcSchedule schedule,
+					 SilcUInt32 rate, SilcUInt32 burst);
+
+/****f* silcutil/silc_rate_bucket_unregister
+ *
+ * SYNOPSIS
+ *
+ *    void silc_rate_bucket_unregister(SilcRateBucket bucket);
+ *
+ * DESCRIPTION
+ *
+ *    Unregisters and frees the bucket.  The governor's tick task stops
+ *    when the last bucket of the scheduler is unregistered.
+ *
+ ***/
+void silc_rate_bucket_unregister(SilcRateBucket bucket);
+
+/****f* silcutil/silc_rate_bucket_consume
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_rate_bucket_consume(SilcRateBucket bucket,
+ *                                      SilcUInt32 tokens);
+ *
+ * DESCRIPTION
+ *
+ *    Consumes `tokens' tokens from the bucket if available and returns
+ *    TRUE, or FALSE without consuming anything when the bucket does
+ *    not hold that many.  One atomic operation on success; safe to
+ *    call from any thread.
+ *
+ ***/
+SilcBool silc_rate_bucket_consume(SilcRateBucket bucket, SilcUInt32 tokens);
+
+/****f* silcutil/silc_rate_bucket_available
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_rate_bucket_available(SilcRateBucket bucket);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of tokens currently in the bucket.
+ *
+ ***/
+SilcUInt32 silc_rate_bucket_available(SilcRateBucket bucket);
+
+/****f* silcutil/silc_rate_bucket_set_rate
+ *
+ * SYNOPSIS
+ *
+ *    void silc_rate_bucket_set_rate(SilcRateBucket bucket,
+ *                                   SilcUInt32 rate, SilcUInt32 burst);
+ *
+ * DESCRIPTION
+ *
+ *    Changes the bucket's replenish rate and burst size.
+ *
+ ***/
+void silc_rate_bucket_set_rate(SilcRateBucket bucket, SilcUInt32 rate,
+			       SilcUInt32 burst);
+
+#endif /* SILCRATE_H */
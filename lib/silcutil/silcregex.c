@@ -51,6 +51,7 @@
 #define RE_NO_GNU_EXTENSIONS   128   /* no gnu extensions */
 #define RE_NOTBOL              256   /* bol fails to match */
 #define RE_NOTEOL              512   /* eol fails to match */
+#define RE_BOUNDED            1024   /* bounded execution budget */
 #define RE_REPEAT             1024   /* bounded repeat expression */
 
 /* definitions for some common regexp styles */
@@ -796,6 +797,23 @@ int silc_re_compile_fastmap(SilcRegex bufp)
       bufp->anchor = 0; /* none */
   }
   bufp->fastmap_accurate = 1;
+
+  /* Extract the literal prefix of the pattern, if any, so the search
+     loop can jump to candidate positions with memchr instead of testing
+     the fastmap byte by byte. */
+  bufp->prefix_len = 0;
+  if (!bufp->translate) {
+    unsigned char *p = bufp->buffer;
+    int n = 0;
+
+    while (p + 1 < bufp->buffer + bufp->used && *p == Cexact &&
+	   n < (int)sizeof(bufp->prefix)) {
+      bufp->prefix[n++] = p[1];
+      p += 2;
+    }
+    bufp->prefix_len = n;
+  }
+
   return 0;
 }
 
@@ -1790,6 +1808,7 @@ int silc_re_match(SilcRegex bufp, unsigned char *string, int size, int pos,
   unsigned char *regend;
   int regsize;
   match_state state;
+  SilcUInt32 steps = 0, steps_max = 0;
 
   SILC_ASSERT(pos >= 0 && size >= 0);
   SILC_ASSERT(pos <= size);
@@ -1802,9 +1821,20 @@ int silc_re_match(SilcRegex bufp, unsigned char *string, int size, int pos,
 
   translate = bufp->translate;
 
+  /* With bounded matching the number of executed operations is limited
+     to a constant factor of the input length; pathological backtracking
+     aborts as a non-match instead of going exponential. */
+  if (flags & RE_BOUNDED)
+    steps_max = 1000 + 128 * (SilcUInt32)size;
+
   NEW_STATE(state, bufp->num_registers);
 
  continue_matching:
+  if (silc_unlikely(steps_max && ++steps > steps_max)) {
+    silc_set_errno(SILC_ERR_LIMIT);
+    goto error;
+  }
+
   switch (*code++)
     {
     case Cend:
@@ -2252,6 +2282,20 @@ int silc_re_search(SilcRegex bufp, unsigned char *string, int size, int pos,
 		while (text != partend &&
 		       !fastmap[(unsigned char) translate[(unsigned char)*text]])
 		  text++;
+	      else if (bufp->prefix_len)
+		/* Jump directly to literal prefix candidates */
+		for (;;) {
+		  text = memchr(text, bufp->prefix[0], partend - text);
+		  if (!text) {
+		    text = partend;
+		    break;
+		  }
+		  if (bufp->prefix_len == 1 ||
+		      (partend - text >= bufp->prefix_len &&
+		       !memcmp(text, bufp->prefix, bufp->prefix_len)))
+		    break;
+		  text++;
+		}
 	      else
 		while (text != partend && !fastmap[(unsigned char)*text])
 		  text++;
@@ -2357,6 +2401,8 @@ SilcBool silc_regex_match(SilcRegex regexp, const char *string,
     f |= RE_NOTBOL;
   if (flags & SILC_REGEX_NOTEOL)
     f |= RE_NOTEOL;
+  if (flags & SILC_REGEX_BOUNDED)
+    f |= RE_BOUNDED;
 
   /* Search */
   ret = silc_re_search(regexp, (unsigned char *)string, string_len, 0,
@@ -2729,3 +2775,125 @@ SilcBool silc_subst(SilcBuffer buffer, const char *subst)
 
   return ret >= 0 ? TRUE : FALSE;
 }
+
+/****************************** Regex sets **********************************/
+
+/* Compiled regular expression set */
+struct SilcRegexSetObject {
+  SilcRegexStruct *regexps;	       /* The compiled patterns */
+  char *fastmaps;		       /* 256 byte fastmap per pattern */
+  SilcUInt32 count;		       /* Number of patterns */
+};
+
+/* Compile a set of patterns */
+
+SilcRegexSet silc_regex_set_alloc(const char **regexs, SilcUInt32 count,
+				  SilcRegexFlags flags)
+{
+  SilcRegexSet set;
+  SilcUInt32 i;
+
+  if (!regexs || !count) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  set = silc_calloc(1, sizeof(*set));
+  if (!set)
+    return NULL;
+  set->regexps = silc_calloc(count, sizeof(*set->regexps));
+  set->fastmaps = silc_calloc(count, 256);
+  if (!set->regexps || !set->fastmaps) {
+    silc_free(set->regexps);
+    silc_free(set->fastmaps);
+    silc_free(set);
+    return NULL;
+  }
+
+  for (i = 0; i < count; i++) {
+    if (!silc_regex_compile(&set->regexps[i], regexs[i], flags)) {
+      while (i-- > 0)
+	silc_regex_free(&set->regexps[i]);
+      silc_free(set->regexps);
+      silc_free(set->fastmaps);
+      silc_free(set);
+      return NULL;
+    }
+
+    /* Compile the fastmap for first-byte pruning */
+    set->regexps[i].fastmap = set->fastmaps + i * 256;
+    silc_re_compile_fastmap(&set->regexps[i]);
+    set->count++;
+  }
+
+  return set;
+}
+
+/* Free regex set */
+
+void silc_regex_set_free(SilcRegexSet set)
+{
+  SilcUInt32 i;
+
+  if (!set)
+    return;
+
+  for (i = 0; i < set->count; i++) {
+    set->regexps[i].fastmap = NULL;
+    silc_regex_free(&set->regexps[i]);
+  }
+  silc_free(set->regexps);
+  silc_free(set->fastmaps);
+  silc_free(set);
+}
+
+/* Match string against all patterns in the set in one pass.  The byte
+   presence map of the string is computed once and each pattern runs
+   only if some byte of the string can start it according to its
+   fastmap. */
+
+SilcUInt32 silc_regex_set_match(SilcRegexSet set, const char *string,
+				SilcUInt32 string_len, SilcBool *ret_matched,
+				SilcRegexFlags flags)
+{
+  unsigned char present[256];
+  SilcRegex r;
+  SilcUInt32 i, k, num = 0;
+
+  if (!set || !string) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return 0;
+  }
+
+  if (!string_len)
+    string_len = strlen(string);
+
+  /* One pass over the line */
+  memset(present, 0, sizeof(present));
+  for (i = 0; i < string_len; i++)
+    present[(unsigned char)string[i]] = 1;
+
+  for (i = 0; i < set->count; i++) {
+    r = &set->regexps[i];
+
+    if (ret_matched)
+      ret_matched[i] = FALSE;
+
+    /* Prune patterns whose first byte cannot occur in the line */
+    if (r->fastmap && r->fastmap_accurate && !r->can_be_null) {
+      for (k = 0; k < 256; k++)
+	if (r->fastmap[k] && present[k])
+	  break;
+      if (k == 256)
+	continue;
+    }
+
+    if (silc_regex_match(r, string, string_len, 0, NULL, flags)) {
+      if (ret_matched)
+	ret_matched[i] = TRUE;
+      num++;
+    }
+  }
+
+  return num;
+}
@@ -127,6 +127,8 @@ typedef struct SilcRegexObject {
   char can_be_null;	       /* true if can match empty string */
   char uses_registers;         /* registers used and need to be initialized */
   char anchor;		       /* anchor: 0=none 1=begline 2=begbuf */
+  unsigned char prefix[16];    /* literal prefix of the pattern */
+  char prefix_len;	       /* length of the literal prefix */
 } *SilcRegex, SilcRegexStruct;
 
 /****s* silcutil/SilcRegexMatch
@@ -173,6 +175,13 @@ typedef enum {
 
   /* The end-of-line ($) always fails to match. */
   SILC_REGEX_NOTEOL    = 0x00020000,
+
+  /* Bound the execution time of the match.  The backtracking engine can
+     go exponential with pathological patterns or inputs; with this flag
+     the match aborts (as a non-match) after a step budget linear in the
+     input length, guaranteeing linear-bounded execution for untrusted
+     patterns and inputs, such as log routing rules. */
+  SILC_REGEX_BOUNDED   = 0x00040000,
 } SilcRegexFlags;
 /***/
 
@@ -388,4 +397,74 @@ SilcBool silc_subst(SilcBuffer buffer, const char *subst);
 /* Backwards support */
 #define silc_string_regex_match(regex, string) silc_regex(string, regex, NULL)
 
+/****s* silcutil/SilcRegexSet
+ *
+ * NAME
+ *
+ *    typedef struct SilcRegexSetObject *SilcRegexSet;
+ *
+ * DESCRIPTION
+ *
+ *    A set of compiled regular expressions matched together with
+ *    silc_regex_set_match.  Allocated with silc_regex_set_alloc and
+ *    freed with silc_regex_set_free.
+ *
+ ***/
+typedef struct SilcRegexSetObject *SilcRegexSet;
+
+/****f* silcutil/silc_regex_set_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcRegexSet silc_regex_set_alloc(const char **regexs,
+ *                                      SilcUInt32 count,
+ *                                      SilcRegexFlags flags);
+ *
+ * DESCRIPTION
+ *
+ *    Compiles the `count' regular expression strings in `regexs' into
+ *    one set, pre-computing the first-byte fastmap of each pattern for
+ *    pruning.  Returns NULL if any pattern fails to compile.
+ *
+ ***/
+SilcRegexSet silc_regex_set_alloc(const char **regexs, SilcUInt32 count,
+				  SilcRegexFlags flags);
+
+/****f* silcutil/silc_regex_set_match
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_regex_set_match(SilcRegexSet set, const char *string,
+ *                                    SilcUInt32 string_len,
+ *                                    SilcBool *ret_matched,
+ *                                    SilcRegexFlags flags);
+ *
+ * DESCRIPTION
+ *
+ *    Matches the `string' against all patterns of the set.  The string
+ *    is scanned once to build its byte presence map and each pattern is
+ *    executed only if some byte of the string can start it according to
+ *    the pattern's fastmap, so large rule sets skip most patterns per
+ *    line.  If `ret_matched' is non-NULL it must hold one SilcBool per
+ *    pattern and is set to indicate which patterns matched.  Returns
+ *    the number of patterns that matched.
+ *
+ ***/
+SilcUInt32 silc_regex_set_match(SilcRegexSet set, const char *string,
+				SilcUInt32 string_len, SilcBool *ret_matched,
+				SilcRegexFlags flags);
+
+/****f* silcutil/silc_regex_set_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_regex_set_free(SilcRegexSet set);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the regular expression set.
+ *
+ ***/
+void silc_regex_set_free(SilcRegexSet set);
+
 #endif /* SILCREGEX_H */
@@ -22,6 +22,10 @@
 /************************** Types and definitions ***************************/
 
 /* Connected event context */
+/* Receivers delivered from a stack snapshot; above this the snapshot
+   is heap allocated */
+#define SILC_SCHEDULE_EVENT_BATCH 32
+
 typedef struct SilcScheduleEventConnectionStruct {
   SilcSchedule schedule;
   SilcTaskEventCallback callback;
@@ -36,45 +40,101 @@ static void silc_schedule_task_remove(SilcSchedule schedule, SilcTask task);
 static void silc_schedule_dispatch_fd(SilcSchedule schedule);
 static void silc_schedule_dispatch_timeout(SilcSchedule schedule,
 					   SilcBool dispatch_all);
+static void silc_schedule_stats_update(SilcSchedule schedule,
+				       SilcTaskCallback callback,
+				       SilcTimer timer);
 SILC_TASK_CALLBACK(silc_schedule_event_del_timeout);
 
 /************************ Static utility functions **************************/
 
-/* Fd task hash table destructor */
+/* Maximum number of task structures to keep in the freelists */
+#define SILC_SCHEDULE_MAX_FREELIST 1024
+
+/* Fd task hash table destructor.  Recycles the task structure through
+   the fd task freelist. */
 
 static void silc_schedule_fd_destructor(void *key, void *context,
 					void *user_context)
 {
+  SilcSchedule schedule = user_context;
+
+  if (schedule &&
+      silc_list_count(schedule->free_fd_tasks) < SILC_SCHEDULE_MAX_FREELIST) {
+    silc_list_add(schedule->free_fd_tasks, (SilcTask)context);
+    return;
+  }
+
   silc_free(context);
 }
 
+/* Number of fd tasks dispatched per iteration; the rest run on the
+   following iterations so one firehose cannot monopolize the loop. */
+#define SILC_SCHEDULE_FD_BUDGET 256
+
 /* Executes file descriptor tasks. Invalid tasks are removed here. */
 
 static void silc_schedule_dispatch_fd(SilcSchedule schedule)
 {
   SilcTaskFd task;
   SilcTask t;
+  SilcTimerStruct timer;
+  SilcBool record_stats;
+  int budget = SILC_SCHEDULE_FD_BUDGET, pass;
 
   /* The dispatch list includes only valid tasks, and tasks that have
      something to dispatch.  Dispatching is atomic; no matter if another
      thread invalidates a task when we unlock, we dispatch to completion. */
-  SILC_SCHEDULE_UNLOCK(schedule);
-  silc_list_start(schedule->fd_dispatch);
-  while ((task = silc_list_get(schedule->fd_dispatch))) {
-    t = (SilcTask)task;
+  record_stats = schedule->task_stats != NULL;
 
-    /* Is the task ready for reading */
-    if (task->revents & SILC_TASK_READ)
-      t->callback(schedule, schedule->app_context, SILC_TASK_READ,
-		  task->fd, t->context);
+  SILC_TRACE2(schedule_dispatch_entry, schedule,
+	      silc_list_count(schedule->fd_dispatch));
 
-    /* Is the task ready for writing */
-    if (t->valid && task->revents & SILC_TASK_WRITE)
-      t->callback(schedule, schedule->app_context, SILC_TASK_WRITE,
-		  task->fd, t->context);
+  SILC_SCHEDULE_UNLOCK(schedule);
+
+  /* High priority tasks (accepting listeners, control fds) dispatch
+     first; normal tasks consume the remaining budget. */
+  for (pass = 0; pass < 2 && budget > 0; pass++) {
+    silc_list_start(schedule->fd_dispatch);
+    while (budget > 0 && (task = silc_list_get(schedule->fd_dispatch))) {
+      if ((pass == 0) != (task->prio == 1))
+	continue;
+      budget--;
+      task->dispatched = TRUE;
+      t = (SilcTask)task;
+
+      if (silc_unlikely(record_stats))
+	silc_timer_start(&timer);
+
+      /* Is the task ready for reading */
+      if (task->revents & SILC_TASK_READ)
+	t->callback(schedule, schedule->app_context, SILC_TASK_READ,
+		    task->fd, t->context);
+
+      /* Is the task ready for writing */
+      if (t->valid && task->revents & SILC_TASK_WRITE)
+	t->callback(schedule, schedule->app_context, SILC_TASK_WRITE,
+		    task->fd, t->context);
+
+      if (silc_unlikely(record_stats)) {
+	silc_timer_stop(&timer);
+	silc_schedule_stats_update(schedule, t->callback, &timer);
+      }
+    }
   }
+
   SILC_SCHEDULE_LOCK(schedule);
 
+  /* Tasks starved by the budget keep their readiness; level triggered
+     backends re-report them on the next iteration and the edge
+     triggered cache keeps the returned bits until the task is
+     rescheduled. */
+  silc_list_start(schedule->fd_dispatch);
+  while ((task = silc_list_get(schedule->fd_dispatch))) {
+    if (!task->dispatched && task->header.valid)
+      task->ready |= task->revents;
+    task->dispatched = FALSE;
+  }
+
   /* Remove invalidated tasks */
   silc_list_start(schedule->fd_dispatch);
   while ((task = silc_list_get(schedule->fd_dispatch)))
@@ -82,6 +142,292 @@ static void silc_schedule_dispatch_fd(SilcSchedule schedule)
       silc_schedule_task_remove(schedule, (SilcTask)task);
 }
 
+/* Links `task' to the per-context task list so that deleting all tasks
+   of a context does not scan the whole scheduler.  Must be called with
+   scheduler locked. */
+
+static void silc_schedule_ctx_link(SilcSchedule schedule, SilcTask task)
+{
+  SilcTask head = NULL;
+
+  if (!task->context)
+    return;
+
+  if (silc_unlikely(!schedule->ctx_table)) {
+    schedule->ctx_table =
+      silc_hash_table_alloc(NULL, 0, silc_hash_ptr, NULL, NULL, NULL,
+			    NULL, NULL, TRUE);
+    if (!schedule->ctx_table)
+      return;
+  }
+
+  silc_hash_table_find(schedule->ctx_table, task->context, NULL,
+		       (void *)&head);
+  task->ctx_next = head;
+  task->ctx_prev = NULL;
+  if (head)
+    head->ctx_prev = task;
+  silc_hash_table_set(schedule->ctx_table, task->context, task);
+}
+
+/* Unlinks `task' from the per-context task list */
+
+static void silc_schedule_ctx_unlink(SilcSchedule schedule, SilcTask task)
+{
+  if (!task->context || !schedule->ctx_table)
+    return;
+
+  if (task->ctx_prev) {
+    task->ctx_prev->ctx_next = task->ctx_next;
+  } else {
+    /* Head of the chain */
+    if (task->ctx_next)
+      silc_hash_table_set(schedule->ctx_table, task->context,
+			  task->ctx_next);
+    else
+      silc_hash_table_del(schedule->ctx_table, task->context);
+  }
+  if (task->ctx_next)
+    task->ctx_next->ctx_prev = task->ctx_prev;
+  task->ctx_next = task->ctx_prev = NULL;
+}
+
+/* Returns the timer wheel tick for `time'.  One tick is one millisecond. */
+
+static SilcUInt64 silc_schedule_wheel_tick(SilcSchedule schedule,
+					   struct timeval *time)
+{
+  return (SilcUInt64)(((time->tv_sec - schedule->wheel_epoch.tv_sec) *
+		       (SilcInt64)1000000 +
+		       (time->tv_usec - schedule->wheel_epoch.tv_usec)) /
+		      1000);
+}
+
+/* Places `task' to the timer wheel slot determined by its expiry tick.
+   Already expired tasks go directly to the expired queue.  Must be called
+   with scheduler locked. */
+
+static void silc_schedule_wheel_add(SilcSchedule schedule,
+				    SilcTaskTimeout task)
+{
+  SilcUInt64 delta, expiry = task->expiry;
+  SilcUInt32 slot;
+
+  if (expiry <= schedule->wheel_now) {
+    /* Already expired */
+    silc_list_add(schedule->expired_queue, task);
+    return;
+  }
+
+  delta = expiry - schedule->wheel_now;
+  if (silc_likely(delta < SILC_WHEEL_L0_SIZE)) {
+    slot = expiry & (SILC_WHEEL_L0_SIZE - 1);
+  } else if (delta < 1 << (SILC_WHEEL_L0_BITS + SILC_WHEEL_LN_BITS)) {
+    slot = SILC_WHEEL_L0_SIZE +
+      ((expiry >> SILC_WHEEL_L0_BITS) & (SILC_WHEEL_LN_SIZE - 1));
+  } else if (delta < 1 << (SILC_WHEEL_L0_BITS + 2 * SILC_WHEEL_LN_BITS)) {
+    slot = SILC_WHEEL_L0_SIZE + SILC_WHEEL_LN_SIZE +
+      ((expiry >> (SILC_WHEEL_L0_BITS + SILC_WHEEL_LN_BITS)) &
+       (SILC_WHEEL_LN_SIZE - 1));
+  } else {
+    /* Timeouts beyond the wheel span go to the last level and cascade
+       down as the wheel turns. */
+    if (delta >= (SilcUInt64)1 << (SILC_WHEEL_L0_BITS +
+				   3 * SILC_WHEEL_LN_BITS))
+      expiry = schedule->wheel_now +
+	((SilcUInt64)1 << (SILC_WHEEL_L0_BITS + 3 * SILC_WHEEL_LN_BITS)) - 1;
+    slot = SILC_WHEEL_L0_SIZE + 2 * SILC_WHEEL_LN_SIZE +
+      ((expiry >> (SILC_WHEEL_L0_BITS + 2 * SILC_WHEEL_LN_BITS)) &
+       (SILC_WHEEL_LN_SIZE - 1));
+  }
+
+  silc_list_add(schedule->wheel[slot], task);
+}
+
+/* Cascades the timer wheel slot of upper level `level' for the current
+   tick down towards the lowest level.  Must be called with scheduler
+   locked. */
+
+static void silc_schedule_wheel_cascade(SilcSchedule schedule, int level)
+{
+  SilcTaskTimeout task;
+  SilcList list;
+  SilcUInt32 slot;
+
+  slot = SILC_WHEEL_L0_SIZE + (level - 1) * SILC_WHEEL_LN_SIZE +
+    ((schedule->wheel_now >> (SILC_WHEEL_L0_BITS +
+			      (level - 1) * SILC_WHEEL_LN_BITS)) &
+     (SILC_WHEEL_LN_SIZE - 1));
+
+  list = schedule->wheel[slot];
+  silc_list_init(schedule->wheel[slot], struct SilcTaskStruct, next);
+
+  silc_list_start(list);
+  while ((task = silc_list_get(list)))
+    silc_schedule_wheel_add(schedule, task);
+}
+
+/* Advances the timer wheel to `tick', moving all expired timeout tasks to
+   the expired queue.  Must be called with scheduler locked. */
+
+static void silc_schedule_wheel_advance(SilcSchedule schedule,
+					SilcUInt64 tick)
+{
+  SilcTaskTimeout task;
+  SilcUInt32 slot;
+
+  if (!schedule->timeout_count) {
+    schedule->wheel_now = tick;
+    return;
+  }
+
+  while (schedule->wheel_now < tick) {
+    schedule->wheel_now++;
+
+    /* Cascade upper levels when crossing their slot boundaries */
+    if (silc_unlikely(!(schedule->wheel_now &
+			(SILC_WHEEL_L0_SIZE - 1)))) {
+      silc_schedule_wheel_cascade(schedule, 1);
+      if (!(schedule->wheel_now &
+	    ((1 << (SILC_WHEEL_L0_BITS + SILC_WHEEL_LN_BITS)) - 1))) {
+	silc_schedule_wheel_cascade(schedule, 2);
+	if (!(schedule->wheel_now &
+	      ((1 << (SILC_WHEEL_L0_BITS + 2 * SILC_WHEEL_LN_BITS)) - 1)))
+	  silc_schedule_wheel_cascade(schedule, 3);
+      }
+    }
+
+    slot = schedule->wheel_now & (SILC_WHEEL_L0_SIZE - 1);
+    while ((task = silc_list_pop(schedule->wheel[slot])))
+      silc_list_add(schedule->expired_queue, task);
+  }
+}
+
+/* Returns the next timeout tick to `next_tick'.  For timeouts in upper
+   wheel levels this is the slot boundary where the task cascades, which
+   is never later than the actual expiry.  Returns FALSE if there are no
+   timeout tasks.  Must be called with scheduler locked. */
+
+static SilcBool silc_schedule_wheel_next(SilcSchedule schedule,
+					 SilcUInt64 *next_tick)
+{
+  SilcUInt64 cur;
+  SilcUInt32 i, slot;
+  int level, bits;
+
+  if (silc_list_count(schedule->expired_queue)) {
+    *next_tick = schedule->wheel_now;
+    return TRUE;
+  }
+  if (!schedule->timeout_count)
+    return FALSE;
+
+  /* The lowest level gives the exact tick */
+  for (i = 1; i < SILC_WHEEL_L0_SIZE; i++) {
+    slot = (schedule->wheel_now + i) & (SILC_WHEEL_L0_SIZE - 1);
+    if (silc_list_count(schedule->wheel[slot])) {
+      *next_tick = schedule->wheel_now + i;
+      return TRUE;
+    }
+  }
+
+  /* Upper levels give the slot boundary where the tasks cascade */
+  for (level = 1; level < SILC_WHEEL_LEVELS; level++) {
+    bits = SILC_WHEEL_L0_BITS + (level - 1) * SILC_WHEEL_LN_BITS;
+    cur = schedule->wheel_now >> bits;
+    for (i = 1; i <= SILC_WHEEL_LN_SIZE; i++) {
+      slot = SILC_WHEEL_L0_SIZE + (level - 1) * SILC_WHEEL_LN_SIZE +
+	((cur + i) & (SILC_WHEEL_LN_SIZE - 1));
+      if (silc_list_count(schedule->wheel[slot])) {
+	*next_tick = (cur + i) << bits;
+	return TRUE;
+      }
+    }
+  }
+
+  /* Tasks exist but were not found from the wheel; poll shortly */
+  *next_tick = schedule->wheel_now + SILC_WHEEL_L0_SIZE;
+  return TRUE;
+}
+
+/* Invalidates timeout tasks matching `callback' and/or `context'.  Must
+   be called with scheduler locked. */
+
+static SilcBool silc_schedule_invalidate_timeouts(SilcSchedule schedule,
+						  SilcTaskCallback callback,
+						  void *context,
+						  SilcBool match_callback,
+						  SilcBool match_context)
+{
+  SilcTask task;
+  SilcList *list;
+  SilcUInt32 i;
+  SilcBool ret = FALSE;
+
+  for (i = 0; i <= SILC_WHEEL_SLOTS + 1; i++) {
+    list = (i == SILC_WHEEL_SLOTS ? &schedule->expired_queue :
+	    i == SILC_WHEEL_SLOTS + 1 ? &schedule->immediate_queue :
+	    &schedule->wheel[i]);
+    silc_list_start(*list);
+    while ((task = (SilcTask)__silc_list_get(list))) {
+      if ((match_callback && task->callback != callback) ||
+	  (match_context && task->context != context))
+	continue;
+      task->valid = FALSE;
+
+      /* Call notify callback */
+      if (schedule->notify)
+	schedule->notify(schedule, FALSE, task, FALSE, 0, 0, 0, 0,
+			 schedule->notify_context);
+      ret = TRUE;
+    }
+  }
+
+  return ret;
+}
+
+/* Executes the immediate task queue.  Zero timeout tasks are queued here
+   and dispatched after each fd pass, bypassing the timer wheel and all
+   time computations.  Must be called with scheduler locked. */
+
+static void silc_schedule_dispatch_immediate(SilcSchedule schedule)
+{
+  SilcTaskTimeout task;
+  SilcTask t;
+  SilcTimerStruct timer;
+  int count = 0;
+
+  while ((task = silc_list_pop(schedule->immediate_queue))) {
+    t = (SilcTask)task;
+
+    /* Remove invalid task */
+    if (silc_unlikely(!t->valid)) {
+      silc_schedule_task_remove(schedule, t);
+      continue;
+    }
+
+    t->valid = FALSE;
+    SILC_SCHEDULE_UNLOCK(schedule);
+    if (silc_unlikely(schedule->task_stats)) {
+      silc_timer_start(&timer);
+      t->callback(schedule, schedule->app_context, SILC_TASK_EXPIRE, 0,
+		  t->context);
+      silc_timer_stop(&timer);
+      silc_schedule_stats_update(schedule, t->callback, &timer);
+    } else {
+      t->callback(schedule, schedule->app_context, SILC_TASK_EXPIRE, 0,
+		  t->context);
+    }
+    SILC_SCHEDULE_LOCK(schedule);
+
+    silc_schedule_task_remove(schedule, t);
+
+    /* Balance; callbacks may keep adding immediate tasks */
+    if (silc_unlikely((++count) > 60))
+      break;
+  }
+}
+
 /* Executes all tasks whose timeout has expired. The task is removed from
    the task queue after the callback function has returned. Also, invalid
    tasks are removed here. */
@@ -92,19 +438,33 @@ static void silc_schedule_dispatch_timeout(SilcSchedule schedule,
   SilcTask t;
   SilcTaskTimeout task;
   struct timeval curtime;
+  SilcTimerStruct timer;
+  SilcUInt32 i;
   int count = 0;
 
   SILC_LOG_DEBUG(("Running timeout tasks"));
 
   silc_gettimeofday(&curtime);
 
-  /* First task in the task queue has always the earliest timeout. */
-  silc_list_start(schedule->timeout_queue);
-  task = silc_list_get(schedule->timeout_queue);
-  if (silc_unlikely(!task))
-    return;
-  do {
+  /* Turn the wheel; expired tasks move to the expired queue */
+  silc_schedule_wheel_advance(schedule,
+			      silc_schedule_wheel_tick(schedule, &curtime));
+
+  if (silc_unlikely(dispatch_all)) {
+    /* Drain the entire wheel and the immediate queue */
+    for (i = 0; i < SILC_WHEEL_SLOTS; i++)
+      while ((task = silc_list_pop(schedule->wheel[i])))
+	silc_list_add(schedule->expired_queue, task);
+    while ((task = silc_list_pop(schedule->immediate_queue))) {
+      schedule->timeout_count++;
+      silc_list_add(schedule->expired_queue, task);
+    }
+  }
+
+  while ((task = silc_list_pop(schedule->expired_queue))) {
     t = (SilcTask)task;
+    schedule->timeout_count--;
+    schedule->dispatched_timeout++;
 
     /* Remove invalid task */
     if (silc_unlikely(!t->valid)) {
@@ -112,23 +472,27 @@ static void silc_schedule_dispatch_timeout(SilcSchedule schedule,
       continue;
     }
 
-    /* Execute the task if the timeout has expired */
-    if (silc_compare_timeval(&task->timeout, &curtime) > 0 && !dispatch_all)
-      break;
-
     t->valid = FALSE;
     SILC_SCHEDULE_UNLOCK(schedule);
-    t->callback(schedule, schedule->app_context, SILC_TASK_EXPIRE, 0,
-		t->context);
+    if (silc_unlikely(schedule->task_stats)) {
+      silc_timer_start(&timer);
+      t->callback(schedule, schedule->app_context, SILC_TASK_EXPIRE, 0,
+		  t->context);
+      silc_timer_stop(&timer);
+      silc_schedule_stats_update(schedule, t->callback, &timer);
+    } else {
+      t->callback(schedule, schedule->app_context, SILC_TASK_EXPIRE, 0,
+		  t->context);
+    }
     SILC_SCHEDULE_LOCK(schedule);
 
     /* Remove the expired task */
     silc_schedule_task_remove(schedule, t);
 
     /* Balance when we have lots of small timeouts */
-    if (silc_unlikely((++count) > 60))
+    if (silc_unlikely((++count) > 60) && !dispatch_all)
       break;
-  } while (silc_likely((task = silc_list_get(schedule->timeout_queue))));
+  }
 }
 
 /* Calculates next timeout. This is the timeout value when at earliest some
@@ -137,70 +501,80 @@ static void silc_schedule_dispatch_timeout(SilcSchedule schedule,
 
 static void silc_schedule_select_timeout(SilcSchedule schedule)
 {
-  SilcTask t;
-  SilcTaskTimeout task;
   struct timeval curtime;
-  SilcBool dispatch = TRUE;
+  SilcUInt64 now, next_tick;
 
   /* Get the current time */
   silc_gettimeofday(&curtime);
   schedule->has_timeout = FALSE;
+  now = silc_schedule_wheel_tick(schedule, &curtime);
 
-  /* First task in the task queue has always the earliest timeout. */
-  silc_list_start(schedule->timeout_queue);
-  task = silc_list_get(schedule->timeout_queue);
-  if (silc_unlikely(!task))
-    return;
-  do {
-    t = (SilcTask)task;
-
-    /* Remove invalid task */
-    if (silc_unlikely(!t->valid)) {
-      silc_schedule_task_remove(schedule, t);
-      continue;
-    }
-
-    /* If the timeout is in past, we will run the task and all other
-       timeout tasks from the past. */
-    if (silc_compare_timeval(&task->timeout, &curtime) <= 0 && dispatch) {
-      silc_schedule_dispatch_timeout(schedule, FALSE);
-      if (silc_unlikely(!schedule->valid))
-	return;
-
-      /* Start selecting new timeout again after dispatch */
-      silc_list_start(schedule->timeout_queue);
-      dispatch = FALSE;
-      continue;
-    }
+  /* Turn the wheel and dispatch timeouts from the past */
+  silc_schedule_wheel_advance(schedule, now);
+  if (silc_list_count(schedule->expired_queue)) {
+    silc_schedule_dispatch_timeout(schedule, FALSE);
+    if (silc_unlikely(!schedule->valid))
+      return;
+  }
 
-    /* Calculate the next timeout */
-    curtime.tv_sec = task->timeout.tv_sec - curtime.tv_sec;
-    curtime.tv_usec = task->timeout.tv_usec - curtime.tv_usec;
-    if (curtime.tv_sec < 0)
-      curtime.tv_sec = 0;
+  if (silc_list_count(schedule->immediate_queue)) {
+    /* Immediate tasks pending; do not sleep */
+    schedule->timeout.tv_sec = 0;
+    schedule->timeout.tv_usec = 0;
+    schedule->has_timeout = TRUE;
+    return;
+  }
 
-    /* We wouldn't want to go under zero, check for it. */
-    if (curtime.tv_usec < 0) {
-      curtime.tv_sec -= 1;
-      if (curtime.tv_sec < 0)
-	curtime.tv_sec = 0;
-      curtime.tv_usec += 1000000L;
-    }
-    break;
-  } while ((task = silc_list_get(schedule->timeout_queue)));
+  if (!silc_schedule_wheel_next(schedule, &next_tick))
+    return;
 
   /* Save the timeout */
-  if (task) {
-    schedule->timeout = curtime;
-    schedule->has_timeout = TRUE;
-    SILC_LOG_DEBUG(("timeout: sec=%d, usec=%d", schedule->timeout.tv_sec,
-		    schedule->timeout.tv_usec));
+  if (next_tick <= now) {
+    schedule->timeout.tv_sec = 0;
+    schedule->timeout.tv_usec = 0;
+  } else {
+    schedule->timeout.tv_sec = (next_tick - now) / 1000;
+    schedule->timeout.tv_usec = ((next_tick - now) % 1000) * 1000;
   }
+  schedule->has_timeout = TRUE;
+  SILC_LOG_DEBUG(("timeout: sec=%d, usec=%d", schedule->timeout.tv_sec,
+		  schedule->timeout.tv_usec));
 }
 
 /* Removes task from the scheduler.  This must be called with scheduler
    locked. */
 
+/* Mirrors the fd's event mask for lock-free readers.  Called with the
+   scheduler lock held; readers use atomic loads only. */
+
+static void silc_schedule_fd_mirror_set(SilcSchedule schedule, SilcUInt32 fd,
+					SilcUInt32 events)
+{
+  SilcScheduleFdMirror m = schedule->fd_mirror, n;
+  SilcUInt32 size, i;
+
+  if (silc_unlikely(!m || fd >= m->size)) {
+    /* Grow by replacing the array; the old one stays readable for
+       concurrent readers and is freed at uninit. */
+    size = m ? m->size : 1024;
+    while (size <= fd)
+      size <<= 1;
+    n = silc_calloc(1, sizeof(*n) + (size - 1) * sizeof(n->masks[0]));
+    if (!n)
+      return;
+    n->size = size;
+    for (i = 0; i < size; i++)
+      silc_atomic_init32(&n->masks[i],
+			 m && i < m->size ?
+			 silc_atomic_get_int32(&m->masks[i]) : 0);
+    n->retired = m;
+    schedule->fd_mirror = n;
+    m = n;
+  }
+
+  silc_atomic_set_int32(&m->masks[fd], events);
+}
+
 static void silc_schedule_task_remove(SilcSchedule schedule, SilcTask task)
 {
   SilcSchedule parent;
@@ -209,6 +583,7 @@ static void silc_schedule_task_remove(SilcSchedule schedule, SilcTask task)
     SilcTask task;
     SilcEventTask etask;
     SilcHashTableList htl;
+    SilcUInt32 i;
     void *fd;
 
     /* Delete from fd queue */
@@ -217,11 +592,20 @@ static void silc_schedule_task_remove(SilcSchedule schedule, SilcTask task)
       silc_hash_table_del(schedule->fd_queue, fd);
     silc_hash_table_list_reset(&htl);
 
-    /* Delete from timeout queue */
-    silc_list_start(schedule->timeout_queue);
-    while ((task = silc_list_get(schedule->timeout_queue))) {
-      silc_list_del(schedule->timeout_queue, task);
+    /* Delete from the timer wheel */
+    for (i = 0; i < SILC_WHEEL_SLOTS; i++)
+      while ((task = silc_list_pop(schedule->wheel[i])))
+	silc_free(task);
+    while ((task = silc_list_pop(schedule->expired_queue)))
       silc_free(task);
+    while ((task = silc_list_pop(schedule->immediate_queue)))
+      silc_free(task);
+    schedule->timeout_count = 0;
+
+    /* Drop the context index */
+    if (schedule->ctx_table) {
+      silc_hash_table_free(schedule->ctx_table);
+      schedule->ctx_table = NULL;
     }
 
     /* Delete even tasks */
@@ -241,18 +625,23 @@ static void silc_schedule_task_remove(SilcSchedule schedule, SilcTask task)
   switch (task->type) {
   case SILC_TASK_FD:
     {
-      /* Delete from fd queue */
+      /* Unschedule from the platform scheduler; the backend may hold
+	 references to the task (readiness cache, pending polls). */
       SilcTaskFd ftask = (SilcTaskFd)task;
+      silc_schedule_ctx_unlink(schedule, task);
+      schedule_ops.schedule_fd(schedule, schedule->internal, ftask, 0);
+      silc_schedule_fd_mirror_set(schedule, ftask->fd, 0);
+
+      /* Delete from fd queue */
       silc_hash_table_del(schedule->fd_queue, SILC_32_TO_PTR(ftask->fd));
     }
     break;
 
   case SILC_TASK_TIMEOUT:
     {
-      /* Delete from timeout queue */
-      silc_list_del(schedule->timeout_queue, task);
-
-      /* Put to free list */
+      /* The task has been taken off the timer wheel by the dispatcher;
+	 put to free list */
+      silc_schedule_ctx_unlink(schedule, task);
       silc_list_add(schedule->free_tasks, task);
     }
     break;
@@ -282,6 +671,87 @@ static void silc_schedule_task_remove(SilcSchedule schedule, SilcTask task)
   }
 }
 
+/* Drains the posted task queue, moving the tasks posted from other
+   threads to the timer wheel.  Called from the scheduler thread with the
+   scheduler locked. */
+
+static void silc_schedule_drain_posted(SilcSchedule schedule)
+{
+  SilcSchedulePost post, next, prev;
+
+  post = silc_atomic_get_pointer(&schedule->post_queue);
+  if (silc_likely(!post))
+    return;
+
+  /* Take the whole queue */
+  while (!silc_atomic_cas_pointer(&schedule->post_queue, post, NULL))
+    post = silc_atomic_get_pointer(&schedule->post_queue);
+
+  /* Reverse to submission order */
+  prev = NULL;
+  while (post) {
+    next = post->next;
+    post->next = prev;
+    prev = post;
+    post = next;
+  }
+  post = prev;
+
+  SILC_SCHEDULE_UNLOCK(schedule);
+  while (post) {
+    next = post->next;
+    silc_schedule_task_add(schedule, 0, post->callback, post->context,
+			   post->seconds, post->useconds, SILC_TASK_TIMEOUT);
+    silc_free(post);
+    post = next;
+  }
+  SILC_SCHEDULE_LOCK(schedule);
+}
+
+/* Records task callback runtime to the statistics.  Called unlocked. */
+
+static void silc_schedule_stats_update(SilcSchedule schedule,
+				       SilcTaskCallback callback,
+				       SilcTimer timer)
+{
+  SilcScheduleTaskStats stats;
+  SilcUInt64 sec, usec;
+  SilcUInt32 us;
+
+  silc_timer_value(timer, &sec, &us);
+  usec = sec * 1000000 + us;
+
+  SILC_SCHEDULE_LOCK(schedule);
+
+  if (silc_unlikely(!schedule->task_stats)) {
+    SILC_SCHEDULE_UNLOCK(schedule);
+    return;
+  }
+
+  if (!silc_hash_table_find(schedule->task_stats, (void *)callback, NULL,
+			    (void *)&stats)) {
+    stats = silc_calloc(1, sizeof(*stats));
+    if (silc_unlikely(!stats)) {
+      SILC_SCHEDULE_UNLOCK(schedule);
+      return;
+    }
+    stats->callback = callback;
+    if (!silc_hash_table_add(schedule->task_stats, (void *)callback,
+			     stats)) {
+      silc_free(stats);
+      SILC_SCHEDULE_UNLOCK(schedule);
+      return;
+    }
+  }
+
+  stats->dispatched++;
+  stats->total_usec += usec;
+  if (usec > stats->max_usec)
+    stats->max_usec = usec;
+
+  SILC_SCHEDULE_UNLOCK(schedule);
+}
+
 /* Timeout freelist garbage collection */
 
 SILC_TASK_CALLBACK(silc_schedule_timeout_gc)
@@ -302,7 +772,7 @@ SILC_TASK_CALLBACK(silc_schedule_timeout_gc)
 				   schedule, 3600, 0);
     return;
   }
-  if (silc_list_count(schedule->timeout_queue) >
+  if (schedule->timeout_count >
       silc_list_count(schedule->free_tasks)) {
     SILC_SCHEDULE_UNLOCK(schedule);
     silc_schedule_task_add_timeout(schedule, silc_schedule_timeout_gc,
@@ -311,9 +781,9 @@ SILC_TASK_CALLBACK(silc_schedule_timeout_gc)
   }
 
   c = silc_list_count(schedule->free_tasks) / 2;
-  if (c > silc_list_count(schedule->timeout_queue))
+  if (c > schedule->timeout_count)
     c = (silc_list_count(schedule->free_tasks) -
-	 silc_list_count(schedule->timeout_queue));
+	 schedule->timeout_count);
   if (silc_list_count(schedule->free_tasks) - c < 10)
     c -= (10 - (silc_list_count(schedule->free_tasks) - c));
 
@@ -327,6 +797,15 @@ SILC_TASK_CALLBACK(silc_schedule_timeout_gc)
   }
   silc_list_start(schedule->free_tasks);
 
+  /* Trim also the fd task freelist when it exceeds the fd task count */
+  c = silc_list_count(schedule->free_fd_tasks) / 2;
+  if (silc_list_count(schedule->free_fd_tasks) >
+      silc_hash_table_count(schedule->fd_queue)) {
+    SilcTask ft;
+    while ((c-- > 0) && (ft = silc_list_pop(schedule->free_fd_tasks)))
+      silc_free(ft);
+  }
+
   SILC_SCHEDULE_UNLOCK(schedule);
 
   silc_schedule_task_add_timeout(schedule, silc_schedule_timeout_gc,
@@ -344,13 +823,17 @@ void silc_schedule_stats(SilcSchedule schedule)
 	  silc_hash_table_count(schedule->fd_queue),
 	  sizeof(*ftask) * silc_hash_table_count(schedule->fd_queue));
   fprintf(stdout, "Num Timeout tasks    : %d (%lu bytes allocated)\n",
-	  silc_list_count(schedule->timeout_queue),
+	  schedule->timeout_count,
 	  sizeof(struct SilcTaskTimeoutStruct) *
-	  silc_list_count(schedule->timeout_queue));
+	  schedule->timeout_count);
   fprintf(stdout, "Num Timeout freelist : %d (%lu bytes allocated)\n",
 	  silc_list_count(schedule->free_tasks),
 	  sizeof(struct SilcTaskTimeoutStruct) *
 	  silc_list_count(schedule->free_tasks));
+  fprintf(stdout, "Num FD freelist      : %d (%lu bytes allocated)\n",
+	  silc_list_count(schedule->free_fd_tasks),
+	  sizeof(struct SilcTaskFdStruct) *
+	  silc_list_count(schedule->free_fd_tasks));
 }
 #endif /* SILC_DIST_INPLACE */
 
@@ -384,14 +867,26 @@ SilcSchedule silc_schedule_init(int max_tasks, void *app_context,
   /* Allocate Fd task hash table dynamically */
   schedule->fd_queue =
     silc_hash_table_alloc(NULL, 0, silc_hash_uint, NULL, NULL, NULL,
-			  silc_schedule_fd_destructor, NULL, TRUE);
+			  silc_schedule_fd_destructor, schedule, TRUE);
   if (!schedule->fd_queue) {
     silc_stack_free(stack);
     return NULL;
   }
 
-  silc_list_init(schedule->timeout_queue, struct SilcTaskStruct, next);
+  /* Initialize the timer wheel */
+  {
+    SilcUInt32 i;
+    for (i = 0; i < SILC_WHEEL_SLOTS; i++)
+      silc_list_init(schedule->wheel[i], struct SilcTaskStruct, next);
+  }
+  silc_list_init(schedule->expired_queue, struct SilcTaskStruct, next);
+  silc_list_init(schedule->immediate_queue, struct SilcTaskStruct, next);
+  silc_gettimeofday(&schedule->wheel_epoch);
+  silc_atomic_init_pointer(&schedule->post_queue, NULL);
+  silc_timer_stats_init(&schedule->loop_stats);
+
   silc_list_init(schedule->free_tasks, struct SilcTaskStruct, next);
+  silc_list_init(schedule->free_fd_tasks, struct SilcTaskStruct, next);
 
   /* Get the parent */
   if (parent && parent->parent)
@@ -438,6 +933,21 @@ SilcBool silc_schedule_uninit(SilcSchedule schedule)
   if (schedule->valid == TRUE)
     return FALSE;
 
+  /* Stop child schedulers if they are still running */
+  silc_schedule_stop_children(schedule);
+
+  /* Free tasks that were posted but never dispatched */
+  {
+    SilcSchedulePost post, next;
+    post = silc_atomic_get_pointer(&schedule->post_queue);
+    while (post) {
+      next = post->next;
+      silc_free(post);
+      post = next;
+    }
+    silc_atomic_uninit_pointer(&schedule->post_queue);
+  }
+
   /* Dispatch all timeouts before going away */
   SILC_SCHEDULE_LOCK(schedule);
   silc_schedule_dispatch_timeout(schedule, TRUE);
@@ -461,6 +971,23 @@ SilcBool silc_schedule_uninit(SilcSchedule schedule)
   /* Unregister all task queues */
   silc_hash_table_free(schedule->fd_queue);
 
+  /* Free the fd event mirror and its retired arrays */
+  while (schedule->fd_mirror) {
+    SilcScheduleFdMirror m = schedule->fd_mirror;
+    SilcUInt32 i;
+    schedule->fd_mirror = m->retired;
+    for (i = 0; i < m->size; i++)
+      silc_atomic_uninit32(&m->masks[i]);
+    silc_free(m);
+  }
+
+  /* Delete fd task freelist */
+  while ((task = silc_list_pop(schedule->free_fd_tasks)))
+    silc_free(task);
+
+  /* Free task statistics */
+  silc_schedule_stats_stop(schedule);
+
   /* Uninit the platform specific scheduler. */
   schedule_ops.uninit(schedule, schedule->internal);
 
@@ -488,11 +1015,25 @@ void silc_schedule_stop(SilcSchedule schedule)
 static SilcBool silc_schedule_iterate(SilcSchedule schedule, int timeout_usecs)
 {
   struct timeval timeout;
+  SilcUInt64 iter_start;
   int ret;
 
   do {
     SILC_LOG_DEBUG(("In scheduler loop"));
 
+    schedule->iterations++;
+    iter_start = silc_time_monotonic_nsec();
+
+    /* Refresh the coarse timestamp cache */
+    silc_time_update_coarse();
+
+    /* Dispatch tasks posted from other threads */
+    silc_schedule_drain_posted(schedule);
+
+    /* Dispatch immediate tasks */
+    if (silc_list_count(schedule->immediate_queue))
+      silc_schedule_dispatch_immediate(schedule);
+
     /* Deliver signals if any has been set to be called */
     if (silc_unlikely(schedule->signal_tasks)) {
       SILC_SCHEDULE_UNLOCK(schedule);
@@ -525,24 +1066,36 @@ static SilcBool silc_schedule_iterate(SilcSchedule schedule, int timeout_usecs)
       schedule->has_timeout = TRUE;
     }
 
+    /* Record the non-blocking part of the iteration to the loop
+       latency histogram; the select sleep below is excluded. */
+    silc_timer_stats_record(&schedule->loop_stats,
+			    silc_time_monotonic_nsec() - iter_start);
+
     /* This is the main silc_select(). The program blocks here until some
        of the selected file descriptors change status or the selected
        timeout expires. */
     SILC_LOG_DEBUG(("Select"));
+    SILC_TRACE1(schedule_wait, schedule);
     ret = schedule_ops.schedule(schedule, schedule->internal);
+    SILC_TRACE2(schedule_wake, schedule, ret);
 
     if (silc_likely(ret == 0)) {
       /* Timeout */
       SILC_LOG_DEBUG(("Running timeout tasks"));
-      if (silc_likely(silc_list_count(schedule->timeout_queue)))
+      if (silc_likely(schedule->timeout_count))
 	silc_schedule_dispatch_timeout(schedule, FALSE);
       continue;
 
     } else if (silc_likely(ret > 0)) {
       /* There is some data available now */
       SILC_LOG_DEBUG(("Running fd tasks"));
+      schedule->dispatched_fd += ret;
       silc_schedule_dispatch_fd(schedule);
 
+      /* Dispatch immediate tasks queued during the fd pass */
+      if (silc_list_count(schedule->immediate_queue))
+	silc_schedule_dispatch_immediate(schedule);
+
       /* If timeout was very short, dispatch also timeout tasks */
       if (schedule->has_timeout && schedule->timeout.tv_sec == 0 &&
 	  schedule->timeout.tv_usec < 50000)
@@ -602,6 +1155,7 @@ void silc_schedule_wakeup(SilcSchedule schedule)
 #ifdef SILC_THREADS
   SILC_LOG_DEBUG(("Wakeup scheduler"));
   SILC_SCHEDULE_LOCK(schedule);
+  schedule->wakeups++;
   schedule_ops.wakeup(schedule, schedule->internal);
   SILC_SCHEDULE_UNLOCK(schedule);
 #endif
@@ -614,6 +1168,186 @@ SilcSchedule silc_schedule_get_parent(SilcSchedule schedule)
   return schedule->parent ? schedule->parent : schedule;
 }
 
+#ifdef SILC_THREADS
+
+/* Child scheduler thread */
+
+static void *silc_schedule_child_thread(void *context)
+{
+  SilcSchedule schedule = context;
+
+  silc_schedule_set_global(schedule);
+  silc_schedule(schedule);
+
+  return NULL;
+}
+
+#endif /* SILC_THREADS */
+
+/* Start child schedulers, one per thread */
+
+SilcBool silc_schedule_start_children(SilcSchedule schedule,
+				      SilcUInt32 num_children)
+{
+#ifdef SILC_THREADS
+  SilcUInt32 i;
+
+  SILC_VERIFY(schedule);
+
+  if (!num_children || schedule->parent || schedule->num_children) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  SILC_LOG_DEBUG(("Starting %d child schedulers", num_children));
+
+  schedule->children = silc_calloc(num_children,
+				   sizeof(*schedule->children));
+  if (!schedule->children)
+    return FALSE;
+  schedule->child_threads = silc_calloc(num_children,
+					sizeof(*schedule->child_threads));
+  if (!schedule->child_threads) {
+    silc_free(schedule->children);
+    schedule->children = NULL;
+    return FALSE;
+  }
+
+  for (i = 0; i < num_children; i++) {
+    schedule->children[i] = silc_schedule_init(schedule->max_tasks,
+					       schedule->app_context,
+					       NULL, schedule);
+    if (!schedule->children[i])
+      break;
+    schedule->child_threads[i] =
+      silc_thread_create(silc_schedule_child_thread,
+			 schedule->children[i], TRUE);
+    if (!schedule->child_threads[i]) {
+      silc_schedule_stop(schedule->children[i]);
+      silc_schedule_uninit(schedule->children[i]);
+      break;
+    }
+    schedule->num_children++;
+  }
+
+  if (silc_unlikely(!schedule->num_children)) {
+    silc_free(schedule->children);
+    silc_free(schedule->child_threads);
+    schedule->children = NULL;
+    schedule->child_threads = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* SILC_THREADS */
+}
+
+/* Stop child schedulers */
+
+void silc_schedule_stop_children(SilcSchedule schedule)
+{
+#ifdef SILC_THREADS
+  SilcUInt32 i;
+
+  SILC_VERIFY(schedule);
+
+  if (!schedule->num_children)
+    return;
+
+  SILC_LOG_DEBUG(("Stopping %d child schedulers", schedule->num_children));
+
+  for (i = 0; i < schedule->num_children; i++) {
+    silc_schedule_stop(schedule->children[i]);
+    silc_schedule_wakeup(schedule->children[i]);
+  }
+  for (i = 0; i < schedule->num_children; i++) {
+    silc_thread_wait(schedule->child_threads[i], NULL);
+    silc_schedule_uninit(schedule->children[i]);
+  }
+
+  silc_free(schedule->children);
+  silc_free(schedule->child_threads);
+  schedule->children = NULL;
+  schedule->child_threads = NULL;
+  schedule->num_children = 0;
+#endif /* SILC_THREADS */
+}
+
+/* Returns the number of child schedulers */
+
+SilcUInt32 silc_schedule_get_num_children(SilcSchedule schedule)
+{
+  return silc_schedule_get_parent(schedule)->num_children;
+}
+
+/* Returns the next child scheduler, balancing over the children */
+
+SilcSchedule silc_schedule_get_child(SilcSchedule schedule)
+{
+  SilcSchedule parent, child;
+
+  SILC_VERIFY(schedule);
+
+  parent = silc_schedule_get_parent(schedule);
+  if (!parent->num_children)
+    return schedule;
+
+  SILC_SCHEDULE_LOCK(parent);
+  child = parent->children[parent->child_rr++ % parent->num_children];
+  SILC_SCHEDULE_UNLOCK(parent);
+
+  return child;
+}
+
+/* Transfer fd task to another scheduler */
+
+SilcBool silc_schedule_transfer_fd(SilcSchedule schedule, SilcSchedule to,
+				   SilcUInt32 fd)
+{
+  SilcTaskFd task = NULL;
+  SilcTaskCallback callback;
+  SilcTaskEvent events;
+  void *context;
+
+  SILC_VERIFY(schedule && to);
+
+  if (schedule == to)
+    return TRUE;
+
+  SILC_LOG_DEBUG(("Transfer fd %d from schedule %p to %p", fd, schedule,
+		  to));
+
+  /* Get the task state */
+  SILC_SCHEDULE_LOCK(schedule);
+  if (!silc_hash_table_find(schedule->fd_queue, SILC_32_TO_PTR(fd),
+			    NULL, (void *)&task) || !task->header.valid) {
+    SILC_SCHEDULE_UNLOCK(schedule);
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+  callback = task->header.callback;
+  context = task->header.context;
+  events = task->events;
+  SILC_SCHEDULE_UNLOCK(schedule);
+
+  /* Unschedule and invalidate the task in the old scheduler */
+  silc_schedule_unset_listen_fd(schedule, fd);
+  silc_schedule_task_del_by_fd(schedule, fd);
+
+  /* Add the fd to the new scheduler and wake it up */
+  if (!silc_schedule_task_add(to, fd, callback, context, 0, 0,
+			      SILC_TASK_FD))
+    return FALSE;
+  if (events)
+    silc_schedule_set_listen_fd(to, fd, events, FALSE);
+  silc_schedule_wakeup(to);
+
+  return TRUE;
+}
+
 /* Returns the application specific context that was saved into the
    scheduler in silc_schedule_init function.  The context is also
    returned to application in task callback functions, but this function
@@ -699,23 +1433,35 @@ SilcTask silc_schedule_task_add(SilcSchedule schedule, SilcUInt32 fd,
   SILC_SCHEDULE_LOCK(schedule);
 
   if (silc_likely(type == SILC_TASK_TIMEOUT)) {
-    SilcTaskTimeout tmp, prev, ttask;
-    SilcList list;
+    SilcTaskTimeout ttask;
 
-    silc_list_start(schedule->free_tasks);
-    ttask = silc_list_get(schedule->free_tasks);
+    ttask = silc_list_pop(schedule->free_tasks);
     if (silc_unlikely(!ttask)) {
       ttask = silc_calloc(1, sizeof(*ttask));
       if (silc_unlikely(!ttask))
 	goto out;
-    } else
-      silc_list_del(schedule->free_tasks, ttask);
+    }
 
     ttask->header.type = 1;
     ttask->header.callback = callback;
     ttask->header.context = context;
     ttask->header.valid = TRUE;
 
+    /* Zero timeout tasks go to the immediate queue, bypassing the timer
+       wheel and time computations entirely. */
+    if ((seconds | useconds) == 0) {
+      SILC_LOG_DEBUG(("New immediate task %p", ttask));
+      silc_list_add(schedule->immediate_queue, ttask);
+      task = (SilcTask)ttask;
+      silc_schedule_ctx_link(schedule, task);
+
+      /* Call notify callback */
+      if (schedule->notify)
+	schedule->notify(schedule, TRUE, task, FALSE, 0, 0, 0, 0,
+			 schedule->notify_context);
+      goto out;
+    }
+
     /* Add timeout */
     silc_gettimeofday(&ttask->timeout);
     if ((seconds + useconds) > 0) {
@@ -727,110 +1473,308 @@ SilcTask silc_schedule_task_add(SilcSchedule schedule, SilcUInt32 fd,
       }
     }
 
-    SILC_LOG_DEBUG(("New timeout task %p: sec=%d, usec=%d", ttask,
-		    seconds, useconds));
+    SILC_LOG_DEBUG(("New timeout task %p: sec=%d, usec=%d", ttask,
+		    seconds, useconds));
+
+    /* Compute the expiry tick, rounding up so that the task never fires
+       before its timeout, and arm it in the timer wheel. */
+    ttask->expiry = (SilcUInt64)(((ttask->timeout.tv_sec -
+				   schedule->wheel_epoch.tv_sec) *
+				  (SilcInt64)1000000 +
+				  (ttask->timeout.tv_usec -
+				   schedule->wheel_epoch.tv_usec) +
+				  999) / 1000);
+    silc_schedule_wheel_add(schedule, ttask);
+    schedule->timeout_count++;
+
+    task = (SilcTask)ttask;
+    silc_schedule_ctx_link(schedule, task);
+
+    /* Call notify callback */
+    if (schedule->notify)
+      schedule->notify(schedule, TRUE, task, FALSE, 0, 0, seconds, useconds,
+		       schedule->notify_context);
+
+  } else if (silc_likely(type == SILC_TASK_FD)) {
+    SilcTaskFd ftask;
+
+    /* Check if fd is already added */
+    if (silc_unlikely(silc_hash_table_find(schedule->fd_queue,
+					   SILC_32_TO_PTR(fd),
+					   NULL, (void *)&task))) {
+      if (task->valid)
+        goto out;
+
+      /* Remove invalid task.  We must have unique fd key to hash table. */
+      silc_schedule_task_remove(schedule, task);
+    }
+
+    /* Check max tasks */
+    if (silc_unlikely(schedule->max_tasks > 0 &&
+		      silc_hash_table_count(schedule->fd_queue) >=
+		      schedule->max_tasks)) {
+      SILC_LOG_WARNING(("Scheduler task limit reached: cannot add new task"));
+      task = NULL;
+      silc_set_errno(SILC_ERR_LIMIT);
+      goto out;
+    }
+
+    ftask = silc_list_pop(schedule->free_fd_tasks);
+    if (silc_likely(ftask))
+      memset(ftask, 0, sizeof(*ftask));
+    else {
+      ftask = silc_calloc(1, sizeof(*ftask));
+      if (silc_unlikely(!ftask)) {
+	task = NULL;
+	goto out;
+      }
+    }
+
+    SILC_LOG_DEBUG(("New fd task %p fd=%d", ftask, fd));
+
+    ftask->header.type = 0;
+    ftask->header.callback = callback;
+    ftask->header.context = context;
+    ftask->header.valid = TRUE;
+    ftask->events = SILC_TASK_READ;
+    ftask->fd = fd;
+    silc_schedule_fd_mirror_set(schedule, fd, SILC_TASK_READ);
+
+    /* Add task and schedule it */
+    if (!silc_hash_table_add(schedule->fd_queue, SILC_32_TO_PTR(fd), ftask)) {
+      silc_free(ftask);
+      task = NULL;
+      goto out;
+    }
+    if (!schedule_ops.schedule_fd(schedule, schedule->internal,
+				  ftask, ftask->events)) {
+      silc_hash_table_del(schedule->fd_queue, SILC_32_TO_PTR(fd));
+      task = NULL;
+      goto out;
+    }
+
+    task = (SilcTask)ftask;
+    silc_schedule_ctx_link(schedule, task);
+
+    /* Call notify callback */
+    if (schedule->notify)
+      schedule->notify(schedule, TRUE, task, TRUE, ftask->fd,
+		       SILC_TASK_READ, 0, 0, schedule->notify_context);
+
+  } else if (silc_unlikely(type == SILC_TASK_SIGNAL)) {
+    SILC_SCHEDULE_UNLOCK(schedule);
+    schedule_ops.signal_register(schedule, schedule->internal, fd,
+				 callback, context);
+    return NULL;
+  }
+
+ out:
+  SILC_SCHEDULE_UNLOCK(schedule);
+
+#ifdef SILC_SYMBIAN
+  /* On symbian we wakeup scheduler immediately after adding timeout task
+     in case the task is added outside the scheduler loop (in some active
+     object). */
+  if (task && task->type == 1)
+    silc_schedule_wakeup(schedule);
+#endif /* SILC_SYMBIAN */
+
+  return task;
+}
+
+/* Task statistics hash table destructor */
+
+static void silc_schedule_stats_destructor(void *key, void *context,
+					   void *user_context)
+{
+  silc_free(context);
+}
+
+/* Start recording task callback statistics */
+
+SilcBool silc_schedule_stats_start(SilcSchedule schedule)
+{
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return FALSE;
+    }
+  }
+
+  SILC_SCHEDULE_LOCK(schedule);
+
+  if (!schedule->task_stats) {
+    schedule->task_stats =
+      silc_hash_table_alloc(NULL, 0, silc_hash_ptr, NULL, NULL, NULL,
+			    silc_schedule_stats_destructor, NULL, TRUE);
+    if (!schedule->task_stats) {
+      SILC_SCHEDULE_UNLOCK(schedule);
+      return FALSE;
+    }
+  }
+
+  SILC_SCHEDULE_UNLOCK(schedule);
+
+  return TRUE;
+}
+
+/* Stop recording task callback statistics */
+
+void silc_schedule_stats_stop(SilcSchedule schedule)
+{
+  SilcHashTable task_stats;
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule)
+      return;
+  }
+
+  SILC_SCHEDULE_LOCK(schedule);
+  task_stats = schedule->task_stats;
+  schedule->task_stats = NULL;
+  SILC_SCHEDULE_UNLOCK(schedule);
+
+  if (task_stats)
+    silc_hash_table_free(task_stats);
+}
+
+/* Return recorded task callback statistics */
+
+SilcScheduleTaskStats silc_schedule_stats_get(SilcSchedule schedule,
+					      SilcUInt32 *ret_count)
+{
+  SilcScheduleTaskStats stats, entry;
+  SilcHashTableList htl;
+  SilcUInt32 count, i, k;
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return NULL;
+    }
+  }
+
+  SILC_SCHEDULE_LOCK(schedule);
+
+  if (!schedule->task_stats) {
+    SILC_SCHEDULE_UNLOCK(schedule);
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return NULL;
+  }
+
+  count = silc_hash_table_count(schedule->task_stats);
+  if (!count) {
+    SILC_SCHEDULE_UNLOCK(schedule);
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  stats = silc_calloc(count, sizeof(*stats));
+  if (!stats) {
+    SILC_SCHEDULE_UNLOCK(schedule);
+    return NULL;
+  }
 
-    /* Add task to correct spot so that the first task in the list has
-       the earliest timeout. */
-    list = schedule->timeout_queue;
-    silc_list_start(list);
-    prev = NULL;
-    while ((tmp = silc_list_get(list)) != SILC_LIST_END) {
-      /* If we have shorter timeout, we have found our spot */
-      if (silc_compare_timeval(&ttask->timeout, &tmp->timeout) < 0) {
-	silc_list_insert(schedule->timeout_queue, prev, ttask);
+  /* Copy the entries, sorted by cumulative runtime, slowest first */
+  i = 0;
+  silc_hash_table_list(schedule->task_stats, &htl);
+  while (silc_hash_table_get(&htl, NULL, (void *)&entry)) {
+    for (k = i; k > 0; k--) {
+      if (stats[k - 1].total_usec >= entry->total_usec)
 	break;
-      }
-      prev = tmp;
+      stats[k] = stats[k - 1];
     }
-    if (!tmp)
-      silc_list_add(schedule->timeout_queue, ttask);
+    stats[k] = *entry;
+    i++;
+  }
+  silc_hash_table_list_reset(&htl);
 
-    task = (SilcTask)ttask;
+  SILC_SCHEDULE_UNLOCK(schedule);
 
-    /* Call notify callback */
-    if (schedule->notify)
-      schedule->notify(schedule, TRUE, task, FALSE, 0, 0, seconds, useconds,
-		       schedule->notify_context);
+  if (ret_count)
+    *ret_count = count;
 
-  } else if (silc_likely(type == SILC_TASK_FD)) {
-    SilcTaskFd ftask;
+  return stats;
+}
 
-    /* Check if fd is already added */
-    if (silc_unlikely(silc_hash_table_find(schedule->fd_queue,
-					   SILC_32_TO_PTR(fd),
-					   NULL, (void *)&task))) {
-      if (task->valid)
-        goto out;
+/* Capture scheduler state snapshot */
 
-      /* Remove invalid task.  We must have unique fd key to hash table. */
-      silc_schedule_task_remove(schedule, task);
-    }
+void silc_schedule_snapshot(SilcSchedule schedule,
+			    SilcScheduleSnapshot snapshot)
+{
+  SilcUInt32 i;
 
-    /* Check max tasks */
-    if (silc_unlikely(schedule->max_tasks > 0 &&
-		      silc_hash_table_count(schedule->fd_queue) >=
-		      schedule->max_tasks)) {
-      SILC_LOG_WARNING(("Scheduler task limit reached: cannot add new task"));
-      task = NULL;
-      silc_set_errno(SILC_ERR_LIMIT);
-      goto out;
-    }
+  if (!schedule || !snapshot)
+    return;
 
-    ftask = silc_calloc(1, sizeof(*ftask));
-    if (silc_unlikely(!ftask)) {
-      task = NULL;
-      goto out;
-    }
+  SILC_SCHEDULE_LOCK(schedule);
 
-    SILC_LOG_DEBUG(("New fd task %p fd=%d", ftask, fd));
+  memset(snapshot, 0, sizeof(*snapshot));
+  snapshot->fd_tasks = silc_hash_table_count(schedule->fd_queue);
+  snapshot->timeout_tasks = schedule->timeout_count;
+  snapshot->immediate_tasks = silc_list_count(schedule->immediate_queue);
+  for (i = 0; i < SILC_WHEEL_SLOTS; i++)
+    if (silc_list_count(schedule->wheel[i]))
+      snapshot->wheel_slots_used++;
+  snapshot->iterations = schedule->iterations;
+  snapshot->dispatched_fd = schedule->dispatched_fd;
+  snapshot->dispatched_timeout = schedule->dispatched_timeout;
+  snapshot->wakeups = schedule->wakeups;
+  snapshot->loop_latency = schedule->loop_stats;
 
-    ftask->header.type = 0;
-    ftask->header.callback = callback;
-    ftask->header.context = context;
-    ftask->header.valid = TRUE;
-    ftask->events = SILC_TASK_READ;
-    ftask->fd = fd;
+  SILC_SCHEDULE_UNLOCK(schedule);
+}
 
-    /* Add task and schedule it */
-    if (!silc_hash_table_add(schedule->fd_queue, SILC_32_TO_PTR(fd), ftask)) {
-      silc_free(ftask);
-      task = NULL;
-      goto out;
-    }
-    if (!schedule_ops.schedule_fd(schedule, schedule->internal,
-				  ftask, ftask->events)) {
-      silc_hash_table_del(schedule->fd_queue, SILC_32_TO_PTR(fd));
-      task = NULL;
-      goto out;
-    }
+/* Post task from another thread */
 
-    task = (SilcTask)ftask;
+SilcBool silc_schedule_task_post(SilcSchedule schedule,
+				 SilcTaskCallback callback, void *context,
+				 long seconds, long useconds)
+{
+  SilcSchedulePost post;
+  void *head;
 
-    /* Call notify callback */
-    if (schedule->notify)
-      schedule->notify(schedule, TRUE, task, TRUE, ftask->fd,
-		       SILC_TASK_READ, 0, 0, schedule->notify_context);
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return FALSE;
+    }
+  }
 
-  } else if (silc_unlikely(type == SILC_TASK_SIGNAL)) {
-    SILC_SCHEDULE_UNLOCK(schedule);
-    schedule_ops.signal_register(schedule, schedule->internal, fd,
-				 callback, context);
-    return NULL;
+  if (silc_unlikely(!schedule->valid)) {
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return FALSE;
   }
 
- out:
-  SILC_SCHEDULE_UNLOCK(schedule);
+  post = silc_calloc(1, sizeof(*post));
+  if (silc_unlikely(!post))
+    return FALSE;
 
-#ifdef SILC_SYMBIAN
-  /* On symbian we wakeup scheduler immediately after adding timeout task
-     in case the task is added outside the scheduler loop (in some active
-     object). */
-  if (task && task->type == 1)
+  post->callback = callback;
+  post->context = context;
+  post->seconds = seconds;
+  post->useconds = useconds;
+
+  /* Push to the MPSC queue */
+  do {
+    head = silc_atomic_get_pointer(&schedule->post_queue);
+    post->next = head;
+  } while (!silc_atomic_cas_pointer(&schedule->post_queue, head, post));
+
+  /* Only the first producer into an empty queue wakes up the scheduler;
+     later posts in the same burst ride on the same wakeup. */
+  if (!head)
     silc_schedule_wakeup(schedule);
-#endif /* SILC_SYMBIAN */
 
-  return task;
+  return TRUE;
 }
 
 /* Invalidates task */
@@ -868,16 +1812,8 @@ SilcBool silc_schedule_task_del(SilcSchedule schedule, SilcTask task)
     }
     silc_hash_table_list_reset(&htl);
 
-    /* Delete from timeout queue */
-    silc_list_start(schedule->timeout_queue);
-    while ((task = (SilcTask)silc_list_get(schedule->timeout_queue))) {
-      task->valid = FALSE;
-
-      /* Call notify callback */
-      if (schedule->notify)
-	schedule->notify(schedule, FALSE, task, FALSE, 0, 0, 0, 0,
-			 schedule->notify_context);
-    }
+    /* Delete from the timer wheel */
+    silc_schedule_invalidate_timeouts(schedule, NULL, NULL, FALSE, FALSE);
 
     /* Delete even tasks */
     parent = silc_schedule_get_parent(schedule);
@@ -967,7 +1903,6 @@ SilcBool silc_schedule_task_del_by_callback(SilcSchedule schedule,
 {
   SilcTask task;
   SilcHashTableList htl;
-  SilcList list;
   SilcBool ret = FALSE;
 
   SILC_LOG_DEBUG(("Unregister task by callback"));
@@ -999,20 +1934,10 @@ SilcBool silc_schedule_task_del_by_callback(SilcSchedule schedule,
   }
   silc_hash_table_list_reset(&htl);
 
-  /* Delete from timeout queue */
-  list = schedule->timeout_queue;
-  silc_list_start(list);
-  while ((task = (SilcTask)silc_list_get(list))) {
-    if (task->callback == callback) {
-      task->valid = FALSE;
-
-      /* Call notify callback */
-      if (schedule->notify)
-	schedule->notify(schedule, FALSE, task, FALSE, 0, 0, 0, 0,
-			 schedule->notify_context);
-      ret = TRUE;
-    }
-  }
+  /* Delete from the timer wheel */
+  if (silc_schedule_invalidate_timeouts(schedule, callback, NULL,
+					TRUE, FALSE))
+    ret = TRUE;
 
   SILC_SCHEDULE_UNLOCK(schedule);
 
@@ -1029,7 +1954,6 @@ SilcBool silc_schedule_task_del_by_context(SilcSchedule schedule,
 {
   SilcTask task;
   SilcHashTableList htl;
-  SilcList list;
   SilcBool ret = FALSE;
 
   SILC_LOG_DEBUG(("Unregister task by context"));
@@ -1045,6 +1969,32 @@ SilcBool silc_schedule_task_del_by_context(SilcSchedule schedule,
 
   SILC_SCHEDULE_LOCK(schedule);
 
+  /* All tasks of a context are on its own list; invalidate the list
+     instead of scanning the whole scheduler. */
+  if (schedule->ctx_table) {
+    if (silc_hash_table_find(schedule->ctx_table, context, NULL,
+			     (void *)&task)) {
+      for (; task; task = task->ctx_next) {
+	task->valid = FALSE;
+
+	/* Call notify callback */
+	if (schedule->notify)
+	  schedule->notify(schedule, FALSE, task,
+			   task->type == SILC_TASK_FD,
+			   task->type == SILC_TASK_FD ?
+			   ((SilcTaskFd)task)->fd : 0, 0, 0, 0,
+			   schedule->notify_context);
+	ret = TRUE;
+      }
+    }
+    SILC_SCHEDULE_UNLOCK(schedule);
+
+    if (ret == FALSE)
+      silc_set_errno(SILC_ERR_NOT_FOUND);
+
+    return ret;
+  }
+
   /* Delete from fd queue */
   silc_hash_table_list(schedule->fd_queue, &htl);
   while (silc_hash_table_get(&htl, NULL, (void *)&task)) {
@@ -1061,20 +2011,10 @@ SilcBool silc_schedule_task_del_by_context(SilcSchedule schedule,
   }
   silc_hash_table_list_reset(&htl);
 
-  /* Delete from timeout queue */
-  list = schedule->timeout_queue;
-  silc_list_start(list);
-  while ((task = (SilcTask)silc_list_get(list))) {
-    if (task->context == context) {
-      task->valid = FALSE;
-
-      /* Call notify callback */
-      if (schedule->notify)
-	schedule->notify(schedule, FALSE, task, FALSE, 0, 0, 0, 0,
-			 schedule->notify_context);
-      ret = TRUE;
-    }
-  }
+  /* Delete from the timer wheel */
+  if (silc_schedule_invalidate_timeouts(schedule, NULL, context,
+					FALSE, TRUE))
+    ret = TRUE;
 
   SILC_SCHEDULE_UNLOCK(schedule);
 
@@ -1090,8 +2030,6 @@ SilcBool silc_schedule_task_del_by_all(SilcSchedule schedule, int fd,
 				       SilcTaskCallback callback,
 				       void *context)
 {
-  SilcTask task;
-  SilcList list;
   SilcBool ret = FALSE;
 
   SILC_LOG_DEBUG(("Unregister task by fd, callback and context"));
@@ -1111,20 +2049,10 @@ SilcBool silc_schedule_task_del_by_all(SilcSchedule schedule, int fd,
 
   SILC_SCHEDULE_LOCK(schedule);
 
-  /* Delete from timeout queue */
-  list = schedule->timeout_queue;
-  silc_list_start(list);
-  while ((task = (SilcTask)silc_list_get(list))) {
-    if (task->callback == callback && task->context == context) {
-      task->valid = FALSE;
-
-      /* Call notify callback */
-      if (schedule->notify)
-	schedule->notify(schedule, FALSE, task, FALSE, 0, 0, 0, 0,
-			 schedule->notify_context);
-      ret = TRUE;
-    }
-  }
+  /* Delete from the timer wheel */
+  if (silc_schedule_invalidate_timeouts(schedule, callback, context,
+					TRUE, TRUE))
+    ret = TRUE;
 
   SILC_SCHEDULE_UNLOCK(schedule);
 
@@ -1166,6 +2094,7 @@ SilcBool silc_schedule_set_listen_fd(SilcSchedule schedule, SilcUInt32 fd,
       return FALSE;
     }
     task->events = mask;
+    silc_schedule_fd_mirror_set(schedule, fd, mask);
     if (silc_unlikely(send_events) && mask) {
       task->revents = mask;
       silc_schedule_dispatch_fd(schedule);
@@ -1183,6 +2112,37 @@ SilcBool silc_schedule_set_listen_fd(SilcSchedule schedule, SilcUInt32 fd,
   return TRUE;
 }
 
+/* Set fd task dispatch priority */
+
+SilcBool silc_schedule_set_fd_priority(SilcSchedule schedule, SilcUInt32 fd,
+				       SilcBool high_priority)
+{
+  SilcTaskFd task;
+  SilcBool ret = FALSE;
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return FALSE;
+    }
+  }
+
+  SILC_SCHEDULE_LOCK(schedule);
+  if (silc_hash_table_find(schedule->fd_queue, SILC_32_TO_PTR(fd),
+			   NULL, (void *)&task)) {
+    task->prio = high_priority;
+    ret = TRUE;
+  }
+  SILC_SCHEDULE_UNLOCK(schedule);
+
+  if (!ret)
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+
+  return ret;
+}
+
 /* Returns the file descriptor's current requested event mask. */
 
 SilcTaskEvent silc_schedule_get_fd_events(SilcSchedule schedule,
@@ -1205,6 +2165,14 @@ SilcTaskEvent silc_schedule_get_fd_events(SilcSchedule schedule,
     return 0;
   }
 
+  /* Wait-free fast path from the mirror; never contends with the
+     dispatch loop. */
+  {
+    SilcScheduleFdMirror m = schedule->fd_mirror;
+    if (silc_likely(m && fd < m->size))
+      return (SilcTaskEvent)silc_atomic_get_int32(&m->masks[fd]);
+  }
+
   SILC_SCHEDULE_LOCK(schedule);
   if (silc_hash_table_find(schedule->fd_queue, SILC_32_TO_PTR(fd),
 			   NULL, (void *)&task))
@@ -1504,21 +2472,51 @@ SilcBool silc_schedule_event_signal(SilcSchedule schedule, const char *event,
 
   va_start(ap, task);
 
-  /* Deliver the signal */
-  silc_list_start(etask->connections);
-  while ((conn = silc_list_get(etask->connections))) {
+  /* Snapshot the receiver list under the lock, then deliver in one
+     tight loop without re-taking the lock per receiver.  The arguments
+     themselves are shared; va_copy copies only the cursor. */
+  {
+    struct SilcScheduleEventConnectionStruct
+      conns[SILC_SCHEDULE_EVENT_BATCH], *more = NULL;
+    SilcUInt32 num = 0, total, i;
+
+    total = silc_list_count(etask->connections);
+    if (silc_unlikely(total > SILC_SCHEDULE_EVENT_BATCH)) {
+      more = silc_malloc(total * sizeof(*more));
+      if (!more) {
+	va_end(ap);
+	SILC_SCHEDULE_UNLOCK(parent);
+	return FALSE;
+      }
+    }
+
+    silc_list_start(etask->connections);
+    while ((conn = silc_list_get(etask->connections)) && num < total)
+      (more ? more : conns)[num++] = *conn;
+
+    etask->signals++;
+
     SILC_SCHEDULE_UNLOCK(parent);
 
-    silc_va_copy(cp, ap);
-    stop = conn->callback(conn->schedule, conn->schedule->app_context,
-			  task, conn->context, cp);
-    va_end(cp);
+    for (i = 0; i < num; i++) {
+      conn = more ? &more[i] : &conns[i];
 
-    SILC_SCHEDULE_LOCK(parent);
+      silc_va_copy(cp, ap);
+      stop = conn->callback(conn->schedule, conn->schedule->app_context,
+			    task, conn->context, cp);
+      va_end(cp);
 
-    /* Stop signal if wanted or if the task was deleted */
-    if (!stop || !task->valid)
-      break;
+      /* Stop signal if wanted or if the task was deleted meanwhile */
+      if (!stop || !task->valid) {
+	i++;
+	break;
+      }
+    }
+
+    silc_free(more);
+
+    SILC_SCHEDULE_LOCK(parent);
+    etask->deliveries += i;
   }
 
   va_end(ap);
@@ -1528,6 +2526,71 @@ SilcBool silc_schedule_event_signal(SilcSchedule schedule, const char *event,
   return TRUE;
 }
 
+/* Set busy-poll window */
+
+SilcBool silc_schedule_set_busy_poll(SilcSchedule schedule,
+				     SilcUInt32 usec)
+{
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return FALSE;
+    }
+  }
+
+  schedule->busy_poll_usec = usec;
+  silc_schedule_wakeup(schedule);
+
+  return TRUE;
+}
+
+/* Return event delivery statistics */
+
+SilcBool silc_schedule_event_stats(SilcSchedule schedule, const char *event,
+				   SilcUInt64 *ret_signals,
+				   SilcUInt64 *ret_deliveries)
+{
+  SilcSchedule parent;
+  SilcEventTask etask;
+  SilcTask task;
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    SILC_VERIFY(schedule);
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return FALSE;
+    }
+  }
+
+  if (!event) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  parent = silc_schedule_get_parent(schedule);
+
+  SILC_SCHEDULE_LOCK(parent);
+
+  if (!silc_hash_table_find(parent->events, (void *)event, NULL,
+			    (void *)&task)) {
+    SILC_SCHEDULE_UNLOCK(parent);
+    return FALSE;
+  }
+  etask = (SilcEventTask)task;
+
+  if (ret_signals)
+    *ret_signals = etask->signals;
+  if (ret_deliveries)
+    *ret_deliveries = etask->deliveries;
+
+  SILC_SCHEDULE_UNLOCK(parent);
+
+  return TRUE;
+}
+
 /* Delete event */
 
 SilcBool silc_schedule_task_del_event(SilcSchedule schedule, const char *event)
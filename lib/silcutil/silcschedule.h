@@ -444,6 +444,96 @@ void silc_schedule_wakeup(SilcSchedule schedule);
  ***/
 SilcSchedule silc_schedule_get_parent(SilcSchedule schedule);
 
+/****f* silcutil/silc_schedule_start_children
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_start_children(SilcSchedule schedule,
+ *                                          SilcUInt32 num_children);
+ *
+ * DESCRIPTION
+ *
+ *    Starts `num_children' child schedulers for the parent scheduler
+ *    `schedule', each running its own scheduler loop in a dedicated
+ *    thread.  Typically one child is started per processor core.  Fd
+ *    tasks may be handed off to the children with the
+ *    silc_schedule_transfer_fd, balancing the load over all cores while
+ *    the parent keeps dispatching its own tasks normally.  Returns FALSE
+ *    if the children could not be started or if threads support is not
+ *    compiled in.  The children are stopped by calling the
+ *    silc_schedule_stop_children or automatically when the parent is
+ *    uninitialized.
+ *
+ ***/
+SilcBool silc_schedule_start_children(SilcSchedule schedule,
+				      SilcUInt32 num_children);
+
+/****f* silcutil/silc_schedule_stop_children
+ *
+ * SYNOPSIS
+ *
+ *    void silc_schedule_stop_children(SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Stops the child schedulers started with the
+ *    silc_schedule_start_children and waits for their threads to finish.
+ *    Tasks still scheduled in the children are unregistered.
+ *
+ ***/
+void silc_schedule_stop_children(SilcSchedule schedule);
+
+/****f* silcutil/silc_schedule_get_num_children
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_schedule_get_num_children(SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of child schedulers started with the
+ *    silc_schedule_start_children, or zero if none have been started.
+ *
+ ***/
+SilcUInt32 silc_schedule_get_num_children(SilcSchedule schedule);
+
+/****f* silcutil/silc_schedule_get_child
+ *
+ * SYNOPSIS
+ *
+ *    SilcSchedule silc_schedule_get_child(SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the next child scheduler of the parent of `schedule',
+ *    balancing round-robin over all started children.  If child
+ *    schedulers have not been started this returns the `schedule' itself.
+ *
+ ***/
+SilcSchedule silc_schedule_get_child(SilcSchedule schedule);
+
+/****f* silcutil/silc_schedule_transfer_fd
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_transfer_fd(SilcSchedule schedule,
+ *                                       SilcSchedule to, SilcUInt32 fd);
+ *
+ * DESCRIPTION
+ *
+ *    Transfers the fd task of the file descriptor `fd' from the scheduler
+ *    `schedule' to the scheduler `to', preserving the task callback,
+ *    context and requested events.  The fd is unscheduled from `schedule'
+ *    and `to' is woken up to start dispatching the fd.  This is used to
+ *    hand off connections to child schedulers started with the
+ *    silc_schedule_start_children, typically from the callback that
+ *    accepted the connection.  Returns FALSE if the fd task does not
+ *    exist in `schedule'.
+ *
+ ***/
+SilcBool silc_schedule_transfer_fd(SilcSchedule schedule, SilcSchedule to,
+				   SilcUInt32 fd);
+
 /****f* silcutil/silc_schedule_get_context
  *
  * SYNOPSIS
@@ -586,6 +676,32 @@ SilcSchedule silc_schedule_get_global(void);
   silc_schedule_task_add(schedule, 0, callback, context, s, u,		\
                          SILC_TASK_TIMEOUT)
 
+/****f* silcutil/silc_schedule_task_post
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_task_post(SilcSchedule schedule,
+ *                                     SilcTaskCallback callback,
+ *                                     void *context,
+ *                                     long seconds, long useconds);
+ *
+ * DESCRIPTION
+ *
+ *    Adds a timeout task to the scheduler from another thread.  This is
+ *    functionally equivalent to silc_schedule_task_add_timeout but does
+ *    not take the scheduler lock; the task is pushed to a lock-free
+ *    submission queue and the scheduler is woken up at most once per
+ *    burst of posted tasks.  Use this when posting large numbers of
+ *    tasks to a scheduler running in another thread, for example
+ *    completion callbacks from worker threads.  The task cannot be
+ *    deleted before it has been dispatched.  Returns FALSE if the task
+ *    could not be posted.
+ *
+ ***/
+SilcBool silc_schedule_task_post(SilcSchedule schedule,
+				 SilcTaskCallback callback, void *context,
+				 long seconds, long useconds);
+
 /****f* silcutil/silc_schedule_task_add_signal
  *
  * SYNOPSIS
@@ -855,6 +971,27 @@ SilcBool silc_schedule_task_del_event(SilcSchedule schedule,
 SilcBool silc_schedule_set_listen_fd(SilcSchedule schedule, SilcUInt32 fd,
 				     SilcTaskEvent mask, SilcBool send_events);
 
+/****f* silcutil/silc_schedule_set_fd_priority
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_set_fd_priority(SilcSchedule schedule,
+ *                                           SilcUInt32 fd,
+ *                                           SilcBool high_priority);
+ *
+ * DESCRIPTION
+ *
+ *    Marks the fd task of `fd' as high priority.  Each scheduler
+ *    iteration dispatches a bounded number of fd events; high priority
+ *    tasks (listeners accepting connections, control channels) are
+ *    dispatched before normal ones, and events past the budget carry
+ *    over to the following iterations so a firehose socket cannot
+ *    monopolize the loop while timers wait.
+ *
+ ***/
+SilcBool silc_schedule_set_fd_priority(SilcSchedule schedule, SilcUInt32 fd,
+				       SilcBool high_priority);
+
 /****f* silcutil/silc_schedule_get_fd_events
  *
  * SYNOPSIS
@@ -986,4 +1123,165 @@ SilcBool silc_schedule_event_disconnect(SilcSchedule schedule,
 SilcBool silc_schedule_event_signal(SilcSchedule schedule, const char *event,
 				    SilcTask task, ...);
 
+/****f* silcutil/silc_schedule_set_busy_poll
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_set_busy_poll(SilcSchedule schedule,
+ *                                         SilcUInt32 usec);
+ *
+ * DESCRIPTION
+ *
+ *    Enables busy-poll mode on the scheduler: before sleeping, the
+ *    event loop spins on a zero-timeout poll for up to `usec'
+ *    microseconds, cutting the sleep/wake cost out of event-to-callback
+ *    latency.  Intended for latency-critical loops pinned to dedicated
+ *    cores (see silc_thread_pool_set_affinity); a spinning loop burns its
+ *    whole core.  Zero (the default) disables spinning.  Currently
+ *    effective on the epoll backends.
+ *
+ ***/
+SilcBool silc_schedule_set_busy_poll(SilcSchedule schedule, SilcUInt32 usec);
+
+/****f* silcutil/silc_schedule_event_stats
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_event_stats(SilcSchedule schedule,
+ *                                       const char *event,
+ *                                       SilcUInt64 *ret_signals,
+ *                                       SilcUInt64 *ret_deliveries);
+ *
+ * DESCRIPTION
+ *
+ *    Returns delivery statistics of the named `event': how many times
+ *    it has been signalled and how many receiver invocations those
+ *    signals have made in total.  Returns FALSE if the event does not
+ *    exist.
+ *
+ ***/
+SilcBool silc_schedule_event_stats(SilcSchedule schedule, const char *event,
+				   SilcUInt64 *ret_signals,
+				   SilcUInt64 *ret_deliveries);
+
+/****s* silcutil/SilcScheduleSnapshot
+ *
+ * NAME
+ *
+ *    typedef struct SilcScheduleSnapshotStruct *SilcScheduleSnapshot;
+ *
+ * DESCRIPTION
+ *
+ *    A point-in-time snapshot of scheduler state and activity captured
+ *    by silc_schedule_snapshot: task counts by type, timer wheel
+ *    occupancy, cumulative iteration/dispatch/wakeup counters and the
+ *    loop iteration latency histogram (the non-sleeping part of each
+ *    iteration).  Cheap enough to poll periodically.
+ *
+ * SOURCE
+ */
+typedef struct SilcScheduleSnapshotStruct {
+  SilcUInt32 fd_tasks;		     /* Number of fd tasks */
+  SilcUInt32 timeout_tasks;	     /* Number of armed timeouts */
+  SilcUInt32 immediate_tasks;	     /* Number of queued immediates */
+  SilcUInt32 wheel_slots_used;	     /* Occupied timer wheel slots */
+  SilcUInt64 iterations;	     /* Loop iterations so far */
+  SilcUInt64 dispatched_fd;	     /* Dispatched fd events */
+  SilcUInt64 dispatched_timeout;     /* Dispatched timeout tasks */
+  SilcUInt64 wakeups;		     /* Explicit scheduler wakeups */
+  SilcTimerStatsStruct loop_latency; /* Iteration latency histogram */
+} *SilcScheduleSnapshot, SilcScheduleSnapshotStruct;
+/***/
+
+/****f* silcutil/silc_schedule_snapshot
+ *
+ * SYNOPSIS
+ *
+ *    void silc_schedule_snapshot(SilcSchedule schedule,
+ *                                SilcScheduleSnapshot snapshot);
+ *
+ * DESCRIPTION
+ *
+ *    Captures the current scheduler state into the caller's `snapshot'
+ *    so operations can see what an event loop is doing without a
+ *    debugger.
+ *
+ ***/
+void silc_schedule_snapshot(SilcSchedule schedule,
+			    SilcScheduleSnapshot snapshot);
+
+/****s* silcutil/SilcScheduleTaskStats
+ *
+ * NAME
+ *
+ *    typedef struct SilcScheduleTaskStatsStruct { ... }
+ *                     *SilcScheduleTaskStats;
+ *
+ * DESCRIPTION
+ *
+ *    Task callback statistics context, recorded when statistics recording
+ *    has been started with silc_schedule_stats_start.
+ *
+ * SOURCE
+ */
+typedef struct SilcScheduleTaskStatsStruct {
+  SilcTaskCallback callback;	     /* The task callback */
+  SilcUInt64 dispatched;	     /* Number of dispatched calls */
+  SilcUInt64 total_usec;	     /* Cumulative runtime, microseconds */
+  SilcUInt64 max_usec;		     /* Longest single runtime */
+} *SilcScheduleTaskStats;
+/***/
+
+/****f* silcutil/silc_schedule_stats_start
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_schedule_stats_start(SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Starts recording per-task-callback dispatch statistics in the
+ *    `schedule'.  For each distinct task callback the number of
+ *    dispatches, the cumulative runtime and the longest single runtime
+ *    are recorded.  This makes it possible to find callbacks that block
+ *    the scheduler loop without attaching an external profiler.
+ *    Recording adds a small overhead to task dispatching.  Returns FALSE
+ *    if recording could not be started.
+ *
+ ***/
+SilcBool silc_schedule_stats_start(SilcSchedule schedule);
+
+/****f* silcutil/silc_schedule_stats_stop
+ *
+ * SYNOPSIS
+ *
+ *    void silc_schedule_stats_stop(SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Stops statistics recording started with silc_schedule_stats_start
+ *    and frees all recorded statistics.
+ *
+ ***/
+void silc_schedule_stats_stop(SilcSchedule schedule);
+
+/****f* silcutil/silc_schedule_stats_get
+ *
+ * SYNOPSIS
+ *
+ *    SilcScheduleTaskStats silc_schedule_stats_get(SilcSchedule schedule,
+ *                                                  SilcUInt32 *ret_count);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the statistics recorded since silc_schedule_stats_start was
+ *    called as an array of `ret_count' entries, sorted by cumulative
+ *    runtime so that the slowest callback is first.  The caller must free
+ *    the returned array with silc_free.  Returns NULL if statistics
+ *    recording is not enabled or nothing has been recorded yet.
+ *
+ ***/
+SilcScheduleTaskStats silc_schedule_stats_get(SilcSchedule schedule,
+					      SilcUInt32 *ret_count);
+
 #endif
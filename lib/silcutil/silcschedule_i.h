@@ -52,6 +52,8 @@ typedef enum {
 /* Task header */
 struct SilcTaskStruct {
   struct SilcTaskStruct *next;
+  struct SilcTaskStruct *ctx_next;   /* Same-context task list */
+  struct SilcTaskStruct *ctx_prev;
   SilcTaskCallback callback;
   void *context;
   unsigned int type    : 2;	/* SilcTaskType */
@@ -62,6 +64,7 @@ struct SilcTaskStruct {
 typedef struct SilcTaskTimeoutStruct {
   struct SilcTaskStruct header;
   struct timeval timeout;
+  SilcUInt64 expiry;		   /* Expiry tick in the timer wheel */
 } *SilcTaskTimeout;
 
 /* Fd task */
@@ -70,19 +73,63 @@ typedef struct SilcTaskFdStruct {
   unsigned int scheduled  : 1;
   unsigned int events     : 14;
   unsigned int revents    : 14;
+  unsigned int in_ready   : 1;	/* Set if task is in readiness cache */
+  unsigned int ready      : 14;	/* Cached readiness (edge-triggered mode) */
+  unsigned int prio       : 1;	/* High priority dispatch class */
+  unsigned int dispatched : 1;	/* Dispatched in this iteration */
   SilcUInt32 fd;
 } *SilcTaskFd;
 
+/* Posted task.  Tasks posted from other threads are pushed to a lock-free
+   MPSC queue on the scheduler and moved to the timer wheel by the
+   scheduler thread. */
+typedef struct SilcSchedulePostStruct {
+  struct SilcSchedulePostStruct *next;
+  SilcTaskCallback callback;
+  void *context;
+  long seconds;
+  long useconds;
+} *SilcSchedulePost;
+
 /* Event task */
 typedef struct SilcEventTaskStruct {
   struct SilcTaskStruct header;
   char *event;
   SilcList connections;
+  SilcUInt64 signals;		        /* Times the event was signalled */
+  SilcUInt64 deliveries;	        /* Receiver invocations in total */
 } *SilcEventTask;
 
+/* Timer wheel.  Timeout tasks are kept in a hashed hierarchical timer
+   wheel; arming and cancelling a timeout is O(1) regardless of the number
+   of armed timeouts.  The wheel resolution is one millisecond; the lowest
+   level spans 256 ms and each of the three upper levels multiplies the
+   span by 64.  Tasks in upper levels cascade towards the lowest level as
+   the wheel turns. */
+#define SILC_WHEEL_L0_BITS   8		  /* 256 slots of 1 ms */
+#define SILC_WHEEL_LN_BITS   6		  /* 64 slots per upper level */
+#define SILC_WHEEL_LEVELS    4
+#define SILC_WHEEL_L0_SIZE   (1 << SILC_WHEEL_L0_BITS)
+#define SILC_WHEEL_LN_SIZE   (1 << SILC_WHEEL_LN_BITS)
+#define SILC_WHEEL_SLOTS     (SILC_WHEEL_L0_SIZE +			\
+			      (SILC_WHEEL_LEVELS - 1) * SILC_WHEEL_LN_SIZE)
+
 /* Scheduler context */
+/* Lock-free mirror of per-fd event masks.  Readers load the pointer
+   and then index it; the array is replaced as a whole when it grows
+   and retired arrays are freed when the scheduler is uninitialized. */
+typedef struct SilcScheduleFdMirrorStruct {
+  struct SilcScheduleFdMirrorStruct *retired; /* Previous, smaller arrays */
+  SilcUInt32 size;			/* Number of mask slots */
+  SilcAtomic32 masks[1];		/* Mask per fd, tail allocated */
+} *SilcScheduleFdMirror;
+
 struct SilcScheduleStruct {
   SilcSchedule parent;		   /* Parent scheduler */
+  SilcSchedule *children;	   /* Child schedulers */
+  void **child_threads;		   /* Child scheduler SilcThreads */
+  SilcUInt32 num_children;	   /* Number of child schedulers */
+  SilcUInt32 child_rr;		   /* Round-robin child index */
   void *internal;
   void *app_context;		   /* Application specific context */
   SilcTaskNotifyCb notify;	   /* Notify callback */
@@ -90,9 +137,25 @@ struct SilcScheduleStruct {
   SilcStack stack;		   /* Stack */
   SilcHashTable events;		   /* Event tasks */
   SilcHashTable fd_queue;	   /* FD task queue */
+  SilcScheduleFdMirror fd_mirror;  /* Lock-free fd event mask mirror */
+  SilcUInt32 busy_poll_usec;	   /* Busy-poll window before sleeping */
   SilcList fd_dispatch;		   /* Dispatched FDs */
-  SilcList timeout_queue;	   /* Timeout queue */
+  SilcList wheel[SILC_WHEEL_SLOTS];/* Timeout task timer wheel */
+  SilcList expired_queue;	   /* Expired timeout tasks */
+  SilcList immediate_queue;	   /* Zero timeout tasks (FIFO) */
+  struct timeval wheel_epoch;	   /* Timer wheel time origin */
+  SilcUInt64 wheel_now;		   /* Current timer wheel tick */
+  SilcUInt32 timeout_count;	   /* Number of timeout tasks */
+  SilcAtomicPointer post_queue;	   /* Posted tasks (lock-free MPSC) */
+  SilcHashTable task_stats;	   /* Task callback statistics */
+  SilcHashTable ctx_table;	   /* Context to task list */
+  SilcUInt64 iterations;	   /* Number of loop iterations */
+  SilcUInt64 dispatched_fd;	   /* Number of dispatched fd events */
+  SilcUInt64 dispatched_timeout;   /* Number of dispatched timeouts */
+  SilcUInt64 wakeups;		   /* Number of explicit wakeups */
+  SilcTimerStatsStruct loop_stats; /* Loop iteration latency histogram */
   SilcList free_tasks;		   /* Timeout task freelist */
+  SilcList free_fd_tasks;	   /* Fd task freelist */
   SilcMutex lock;		   /* Scheduler lock */
   struct timeval timeout;	   /* Current timeout */
   unsigned int max_tasks     : 29; /* Max FD tasks */
@@ -655,6 +655,27 @@ static void fmtfp (char *buffer, size_t *currlen, size_t maxlen,
   }
 
 
+  if (ufvalue < 9.2e18) {
+    /* The value fits 64-bit integers; generate all digits with integer
+       arithmetic instead of a floating point modf per digit. */
+    SilcUInt64 ip = (SilcUInt64)intpart;
+    SilcUInt64 fp = (SilcUInt64)fracpart;
+
+    do {
+      iconvert[iplace++] = '0' + (char)(ip % 10);
+      ip /= 10;
+    } while (ip && iplace < 311);
+    iconvert[iplace] = 0;
+
+    if (fp) {
+      do {
+	fconvert[fplace++] = '0' + (char)(fp % 10);
+	fp /= 10;
+      } while (fp && fplace < 311);
+    }
+    fconvert[fplace] = 0;
+  } else {
+
   /* Convert integer part */
   do {
     temp = intpart*0.1;
@@ -683,6 +704,7 @@ static void fmtfp (char *buffer, size_t *currlen, size_t maxlen,
       if (fplace == 311) fplace--;
     }
   fconvert[fplace] = 0;
+  }
 
   /* -1 for decimal point, another -1 if we are printing a sign */
   padlen = min - iplace - max - 1 - ((signvalue) ? 1 : 0);
@@ -744,6 +766,117 @@ static void dopr_outch(char *buffer, size_t *currlen, size_t maxlen, char c)
   (*currlen)++;
 }
 
+/* Fast path for simple format strings.  Handles plain characters and
+   the bare %s, %d, %u, %x, %p, %c and %% conversions (no flags, width
+   or precision) with dedicated inline converters; anything else makes
+   this return -1 and the caller falls through to the full formatter.
+   Most logging and message formats are of this simple shape. */
+
+static int silc_snprintf_fast(char *str, size_t count, const char *fmt,
+			      va_list args)
+{
+  size_t j = 0;
+  const char *p = fmt, *sv;
+  char tmp[24];
+  unsigned long uv;
+  long v;
+  int i, neg, base;
+
+  if (!count)
+    return -1;
+  count--;			       /* Room for the NUL */
+
+  while (*p) {
+    if (*p != '%') {
+      if (j < count)
+	str[j] = *p;
+      j++;
+      p++;
+      continue;
+    }
+
+    p++;
+    base = 10;
+    switch (*p++) {
+    case 's':
+      sv = va_arg(args, const char *);
+      if (!sv)
+	sv = "(null)";
+      while (*sv) {
+	if (j < count)
+	  str[j] = *sv;
+	j++;
+	sv++;
+      }
+      break;
+
+    case 'c':
+      if (j < count)
+	str[j] = (char)va_arg(args, int);
+      j++;
+      break;
+
+    case '%':
+      if (j < count)
+	str[j] = '%';
+      j++;
+      break;
+
+    case 'd':
+      v = (long)va_arg(args, int);
+      neg = v < 0;
+      uv = neg ? (unsigned long)-v : (unsigned long)v;
+      goto emit_int;
+
+    case 'u':
+      uv = (unsigned long)va_arg(args, unsigned int);
+      neg = 0;
+      goto emit_int;
+
+    case 'x':
+      uv = (unsigned long)va_arg(args, unsigned int);
+      neg = 0;
+      base = 16;
+      goto emit_int;
+
+    case 'p':
+      uv = (unsigned long)va_arg(args, void *);
+      neg = 0;
+      base = 16;
+      if (j < count)
+	str[j] = '0';
+      j++;
+      if (j < count)
+	str[j] = 'x';
+      j++;
+
+    emit_int:
+      i = 0;
+      do {
+	tmp[i++] = "0123456789abcdef"[uv % base];
+	uv /= base;
+      } while (uv);
+      if (neg)
+	tmp[i++] = '-';
+      while (i > 0) {
+	char c = tmp[--i];
+	if (j < count)
+	  str[j] = c;
+	j++;
+      }
+      break;
+
+    default:
+      /* Not a simple format; use the full formatter */
+      return -1;
+    }
+  }
+
+  /* Like the full formatter, return the untruncated length */
+  str[j < count ? j : count] = '\0';
+  return (int)j;
+}
+
 int silc_vsnprintf(char *str, size_t count, const char *fmt, va_list args)
 {
   if (str != NULL)
@@ -753,15 +886,47 @@ int silc_vsnprintf(char *str, size_t count, const char *fmt, va_list args)
 
 int silc_snprintf(char *str, size_t count, const char *fmt, ...)
 {
-  size_t ret;
+  int ret;
   va_list ap;
 
+  /* Try the simple-format fast path first */
+  va_start(ap, fmt);
+  ret = silc_snprintf_fast(str, count, fmt, ap);
+  va_end(ap);
+  if (ret >= 0)
+    return ret;
+
   va_start(ap, fmt);
   ret = silc_vsnprintf(str, count, fmt, ap);
   va_end(ap);
   return ret;
 }
 
+/* Format to a string allocated from `stack' */
+
+char *silc_ssnprintf(SilcStack stack, const char *fmt, ...)
+{
+  char *str;
+  int len;
+  va_list ap, cp;
+
+  va_start(ap, fmt);
+  silc_va_copy(cp, ap);
+  len = silc_vsnprintf(NULL, 0, fmt, cp);
+  va_end(cp);
+
+  str = silc_smalloc(stack, len + 1);
+  if (!str) {
+    va_end(ap);
+    return NULL;
+  }
+
+  silc_vsnprintf(str, len + 1, fmt, ap);
+  va_end(ap);
+
+  return str;
+}
+
 int silc_vasprintf(char **ptr, const char *format, va_list ap)
 {
   int ret;
@@ -794,3 +959,85 @@ int silc_asprintf(char **ptr, const char *format, ...)
 
   return ret;
 }
+
+/* Formats a double with integer digit generation.  The hot path for
+   metrics emitters; falls back to the generic formatter for values
+   that do not fit 64-bit integer arithmetic. */
+
+int silc_dtoa(double value, int precision, char *str, SilcUInt32 str_size)
+{
+  char ibuf[24], fbuf[24];
+  SilcUInt64 ip, fp, scale;
+  double ufvalue, frac;
+  int i = 0, f = 0, n = 0, trim;
+  SilcBool neg = value < 0;
+
+  if (!str || !str_size) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -1;
+  }
+
+  /* Not-a-number and infinities */
+  if (value != value)
+    return silc_snprintf(str, str_size, "nan");
+  if (value > 1.7e308 || value < -1.7e308)
+    return silc_snprintf(str, str_size, "%sinf", value < 0 ? "-" : "");
+
+  trim = precision < 0;
+  if (precision < 0)
+    precision = 17;
+  if (precision > 17)
+    precision = 17;
+
+  ufvalue = neg ? -value : value;
+  if (ufvalue >= 9.2e18)
+    return silc_snprintf(str, str_size, "%.*f", precision, value);
+
+  ip = (SilcUInt64)ufvalue;
+  frac = ufvalue - (double)ip;
+
+  scale = 1;
+  for (i = 0; i < precision; i++)
+    scale *= 10;
+  fp = (SilcUInt64)(frac * (double)scale + 0.5);
+  if (fp >= scale) {
+    ip++;
+    fp -= scale;
+  }
+
+  /* Integer digits, reversed */
+  i = 0;
+  do {
+    ibuf[i++] = '0' + (char)(ip % 10);
+    ip /= 10;
+  } while (ip);
+
+  /* Fraction digits, fixed width, reversed */
+  for (f = 0; f < precision; f++) {
+    fbuf[f] = '0' + (char)(fp % 10);
+    fp /= 10;
+  }
+
+  if (trim) {
+    /* Drop trailing zeros (the fraction is reversed in fbuf, so they
+       are at its start), and the whole fraction if it is zero */
+    f = 0;
+    while (f < precision && fbuf[f] == '0')
+      f++;
+    memmove(fbuf, fbuf + f, precision - f);
+    precision -= f;
+  }
+
+  if (neg && n < (int)str_size - 1)
+    str[n++] = '-';
+  while (i && n < (int)str_size - 1)
+    str[n++] = ibuf[--i];
+  if (precision && n < (int)str_size - 1) {
+    str[n++] = '.';
+    while (precision && n < (int)str_size - 1)
+      str[n++] = fbuf[--precision];
+  }
+  str[n] = '\0';
+
+  return n;
+}
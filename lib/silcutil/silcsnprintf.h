@@ -119,4 +119,38 @@ int silc_asprintf(char **ptr, const char *format, ...);
  ***/
 int silc_vasprintf(char **ptr, const char *format, va_list ap);
 
+/****f* silcutil/silc_ssnprintf
+ *
+ * SYNOPSIS
+ *
+ *    char *silc_ssnprintf(SilcStack stack, const char *fmt, ...);
+ *
+ * DESCRIPTION
+ *
+ *    Formats the string into a buffer of exactly the needed size
+ *    allocated from `stack' (or the heap if `stack' is NULL) and
+ *    returns it.  Returns NULL on allocation error.
+ *
+ ***/
+char *silc_ssnprintf(SilcStack stack, const char *fmt, ...);
+
+/****f* silcutil/silc_dtoa
+ *
+ * SYNOPSIS
+ *
+ *    int silc_dtoa(double value, int precision, char *str,
+ *                  SilcUInt32 str_size);
+ *
+ * DESCRIPTION
+ *
+ *    Formats the double `value' into `str' with `precision' fraction
+ *    digits (maximum 17), generating all digits with integer
+ *    arithmetic; roughly an order of magnitude faster than the %f
+ *    path for metrics-style output.  A negative `precision' uses 17
+ *    digits and trims trailing zeros.  NaN and infinities format as
+ *    "nan" and "[-]inf".  Returns the length written or -1 on error.
+ *
+ ***/
+int silc_dtoa(double value, int precision, char *str, SilcUInt32 str_size);
+
 #endif /* SILCSNPRINTF_H */
@@ -19,6 +19,19 @@
 
 #include "silcruntime.h"
 
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+#include <sys/sendfile.h>
+#endif
+
+#if defined(SILC_LINUX) || defined(__linux__)
+#include <linux/errqueue.h>
+#endif
+
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+#define SILC_HAVE_MSG_ZEROCOPY 1
+#endif
+
 /************************** Types and definitions ***************************/
 
 /* Stream operation functions (platform specific) */
@@ -26,6 +39,8 @@ int silc_socket_stream_read(SilcStream stream, unsigned char *buf,
 			    SilcUInt32 buf_len);
 int silc_socket_stream_write(SilcStream stream, const unsigned char *data,
 			     SilcUInt32 data_len);
+int silc_socket_stream_writev(SilcStream stream, SilcStreamIOVec *iov,
+			      SilcUInt32 iov_count);
 SilcBool silc_socket_stream_close(SilcStream stream);
 void silc_socket_stream_destroy(SilcStream stream);
 int silc_socket_udp_stream_read(SilcStream stream, unsigned char *buf,
@@ -148,6 +163,21 @@ silc_socket_tcp_stream_create(SilcSocket sock, SilcBool lookup,
 			      SilcSchedule schedule,
 			      SilcSocketStreamCallback callback,
 			      void *context)
+{
+  return silc_socket_tcp_stream_create_stack(NULL, sock, lookup,
+					     require_fqdn, schedule,
+					     callback, context);
+}
+
+/* Creates TCP socket stream from stack */
+
+SilcAsyncOperation
+silc_socket_tcp_stream_create_stack(SilcStack stack, SilcSocket sock,
+				    SilcBool lookup,
+				    SilcBool require_fqdn,
+				    SilcSchedule schedule,
+				    SilcSocketStreamCallback callback,
+				    void *context)
 {
   SilcSocketStream stream;
   SilcSocketHostLookup l;
@@ -169,7 +199,7 @@ silc_socket_tcp_stream_create(SilcSocket sock, SilcBool lookup,
     return NULL;
   }
 
-  stream = silc_calloc(1, sizeof(*stream));
+  stream = silc_scalloc(stack, 1, sizeof(*stream));
   if (!stream) {
     if (callback)
       callback(silc_errno, NULL, context);
@@ -179,13 +209,14 @@ silc_socket_tcp_stream_create(SilcSocket sock, SilcBool lookup,
   SILC_LOG_DEBUG(("Creating TCP socket stream %p, sock %lu", stream, sock));
 
   stream->ops = &silc_socket_stream_ops;
+  stream->stack = stack;
   stream->sock = sock;
   stream->schedule = schedule;
   stream->connected = TRUE;
 
   l = silc_calloc(1, sizeof(*l));
   if (!l) {
-    silc_free(stream);
+    silc_sfree(stack, stream);
     if (callback)
       callback(silc_errno, NULL, context);
     return NULL;
@@ -200,7 +231,7 @@ silc_socket_tcp_stream_create(SilcSocket sock, SilcBool lookup,
     /* Start asynchronous IP, hostname and port lookup process */
     l->op = silc_async_alloc(silc_socket_host_lookup_abort, NULL, l);
     if (!l->op) {
-      silc_free(stream);
+      silc_sfree(stack, stream);
       silc_free(l);
       if (callback)
 	callback(silc_errno, NULL, context);
@@ -328,6 +359,15 @@ SilcBool silc_socket_stream_set_info(SilcStream stream,
       if (!socket_stream->hostname)
 	return FALSE;
     }
+
+    /* Cache the binary form; ACL checks and repeated conversions read
+       it with silc_socket_stream_get_ip_bin instead of re-parsing. */
+    if (silc_net_parse_ip4(ip, socket_stream->ip_bin))
+      socket_stream->ip_bin_len = 4;
+    else if (silc_net_parse_ip6(ip, socket_stream->ip_bin))
+      socket_stream->ip_bin_len = 16;
+    else
+      socket_stream->ip_bin_len = 0;
   }
   if (port)
     socket_stream->port = port;
@@ -397,6 +437,808 @@ SilcSchedule silc_socket_stream_get_schedule(SilcStream stream)
   return socket_stream->schedule;
 }
 
+/* Set adaptive read buffer sizing */
+
+SilcBool silc_socket_stream_set_read_buffer(SilcStream stream,
+					    SilcUInt32 low_watermark,
+					    SilcUInt32 high_watermark)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream) &&
+      !SILC_IS_SOCKET_STREAM_UDP(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!low_watermark || !high_watermark) {
+    /* Disable adaptive sizing */
+    socket_stream->read_size = 0;
+    socket_stream->read_low = 0;
+    socket_stream->read_high = 0;
+    return TRUE;
+  }
+
+  if (low_watermark > high_watermark) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  socket_stream->read_low = low_watermark;
+  socket_stream->read_high = high_watermark;
+  socket_stream->read_size = low_watermark;
+
+  return TRUE;
+}
+
+/* Return current adaptive read size */
+
+SilcUInt32 silc_socket_stream_get_read_size(SilcStream stream)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream) &&
+      !SILC_IS_SOCKET_STREAM_UDP(socket_stream))
+    return 0;
+
+  return socket_stream->read_size;
+}
+
+/* Coalesced QoS tick.  All throttled streams of a scheduler are serviced
+   from one timeout task instead of one timeout per stream. */
+
+typedef struct {
+  SilcSocketQos throttled;	/* Throttled streams */
+  SilcBool armed;		/* Set when the tick timeout is armed */
+} SilcSocketQosTick;
+
+/* Tick interval in microseconds */
+#define SILC_SOCKET_QOS_TICK 20000
+
+SILC_TASK_CALLBACK(silc_socket_stream_qos_tick)
+{
+  SilcSocketQosTick *tick = silc_global_get_var("srtqostick", TRUE);
+  SilcSocketQos qos, next;
+
+  if (!tick)
+    return;
+
+  tick->armed = FALSE;
+  qos = tick->throttled;
+  tick->throttled = NULL;
+
+  while (qos) {
+    next = qos->tnext;
+    qos->tnext = NULL;
+    qos->throttled = FALSE;
+
+    /* Refill the bucket */
+    silc_socket_stream_qos_refill(qos);
+
+    if (qos->tokens) {
+      /* Resume reading */
+      silc_schedule_set_listen_fd(qos->sock->schedule, qos->sock->sock,
+				  silc_schedule_get_fd_events(
+					qos->sock->schedule,
+					qos->sock->sock) | SILC_TASK_READ,
+				  FALSE);
+    } else {
+      /* Still empty, wait for the next tick */
+      silc_socket_stream_qos_throttle(qos->sock);
+    }
+
+    qos = next;
+  }
+}
+
+/* Refills the token bucket from elapsed time (internal) */
+
+void silc_socket_stream_qos_refill(SilcSocketQos qos)
+{
+  struct timeval now;
+  SilcUInt64 add;
+
+  silc_gettimeofday(&now);
+
+  add = ((SilcUInt64)(now.tv_sec - qos->last_refill.tv_sec) * 1000000 +
+	 (now.tv_usec - qos->last_refill.tv_usec));
+  add = add * qos->rate / 1000000;
+  if (add) {
+    qos->last_refill = now;
+    qos->tokens = (qos->tokens + add > qos->burst ? qos->burst :
+		   qos->tokens + (SilcUInt32)add);
+  }
+}
+
+/* Throttle `sock' until the next QoS tick */
+
+void silc_socket_stream_qos_throttle(SilcSocketStream sock)
+{
+  SilcSocketQosTick *tick = silc_global_get_var("srtqostick", TRUE);
+  SilcSocketQos qos = sock->qos;
+
+  if (!tick)
+    tick = silc_global_set_var("srtqostick", sizeof(*tick), NULL, TRUE);
+  if (!tick)
+    return;
+
+  if (!qos->throttled) {
+    qos->tnext = tick->throttled;
+    tick->throttled = qos;
+    qos->throttled = TRUE;
+  }
+
+  /* Stop reading until the bucket refills */
+  silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+			      silc_schedule_get_fd_events(sock->schedule,
+							  sock->sock) &
+			      ~SILC_TASK_READ, FALSE);
+
+  if (!tick->armed) {
+    tick->armed = TRUE;
+    silc_schedule_task_add_timeout(sock->schedule,
+				   silc_socket_stream_qos_tick, NULL,
+				   0, SILC_SOCKET_QOS_TICK);
+  }
+}
+
+/* Remove `sock' from the throttled list */
+
+void silc_socket_stream_qos_unthrottle(SilcSocketStream sock)
+{
+  SilcSocketQosTick *tick = silc_global_get_var("srtqostick", TRUE);
+  SilcSocketQos q, prev = NULL;
+
+  if (!tick || !sock->qos || !sock->qos->throttled)
+    return;
+
+  for (q = tick->throttled; q; prev = q, q = q->tnext)
+    if (q == sock->qos) {
+      if (prev)
+	prev->tnext = q->tnext;
+      else
+	tick->throttled = q->tnext;
+      q->tnext = NULL;
+      q->throttled = FALSE;
+      break;
+    }
+}
+
+/* Set token bucket rate limiting */
+
+SilcBool silc_socket_stream_set_rate(SilcStream stream, SilcUInt32 rate,
+				     SilcUInt32 burst)
+{
+  SilcSocketStream socket_stream = stream;
+  SilcSocketQos qos;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream) &&
+      !SILC_IS_SOCKET_STREAM_UDP(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!rate) {
+    /* Disable rate limiting */
+    if (socket_stream->qos) {
+      silc_socket_stream_qos_unthrottle(socket_stream);
+      socket_stream->qos->rate = 0;
+      if (!socket_stream->qos->read_rate && !socket_stream->qos->buffer) {
+	silc_free(socket_stream->qos);
+	socket_stream->qos = NULL;
+      }
+    }
+    return TRUE;
+  }
+
+  qos = socket_stream->qos;
+  if (!qos) {
+    qos = silc_calloc(1, sizeof(*qos));
+    if (!qos)
+      return FALSE;
+    qos->sock = socket_stream;
+    socket_stream->qos = qos;
+  }
+
+  qos->rate = rate;
+  qos->burst = burst ? burst : rate;
+  qos->tokens = qos->burst;
+  silc_gettimeofday(&qos->last_refill);
+
+  return TRUE;
+}
+
+/* Size of one loaned read buffer */
+#define SILC_SOCKET_LOAN_SIZE 32768
+
+/* Maximum buffers kept in a thread's read slab */
+#define SILC_SOCKET_SLAB_MAX 64
+
+/* Shared read buffer slab, one per scheduler thread.  All socket
+   streams of the thread borrow read buffers from it, so buffer memory
+   scales with concurrently active reads, not with connection count. */
+typedef struct {
+  SilcSocketLoanBuf free_bufs;	       /* Free buffers */
+  SilcUInt32 count;		       /* Number of free buffers */
+} SilcSocketReadSlab;
+
+/* Returns the calling thread's read slab */
+
+static SilcSocketReadSlab *silc_socket_read_slab(void)
+{
+  SilcSocketReadSlab *slab;
+
+  slab = silc_global_get_var("srtreadslab", TRUE);
+  if (!slab)
+    slab = silc_global_set_var("srtreadslab", sizeof(*slab), NULL, TRUE);
+
+  return slab;
+}
+
+/* Read data into a loaned buffer */
+
+SilcBuffer silc_socket_stream_read_loan(SilcStream stream)
+{
+  SilcSocketStream socket_stream = stream;
+  SilcSocketLoanBuf lb;
+  SilcSocketReadSlab *slab;
+  int len;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  /* Borrow a buffer from the thread's shared slab, allocating a new
+     one only when the slab is empty.  The buffer is shared between all
+     streams of this scheduler thread over time. */
+  slab = silc_socket_read_slab();
+  lb = slab ? slab->free_bufs : NULL;
+  if (lb) {
+    slab->free_bufs = lb->next;
+    slab->count--;
+  } else {
+    lb = silc_malloc(sizeof(*lb) + SILC_SOCKET_LOAN_SIZE);
+    if (!lb)
+      return NULL;
+    memset(lb, 0, sizeof(*lb));
+    silc_atomic_init32(&lb->refcnt, 0);
+  }
+  lb->sock = socket_stream;
+
+  lb->buf.head = (unsigned char *)lb + sizeof(*lb);
+  lb->buf.end = lb->buf.head + SILC_SOCKET_LOAN_SIZE;
+
+  len = silc_socket_stream_read(stream, lb->buf.head,
+				SILC_SOCKET_LOAN_SIZE);
+  if (len <= 0) {
+    /* Return to the slab */
+    if (slab && slab->count < SILC_SOCKET_SLAB_MAX) {
+      lb->next = slab->free_bufs;
+      slab->free_bufs = lb;
+      slab->count++;
+    } else {
+      silc_free(lb);
+    }
+    if (len == 0)
+      silc_set_errno(SILC_ERR_EOF);
+    return NULL;
+  }
+
+  lb->buf.data = lb->buf.head;
+  lb->buf.tail = lb->buf.head + len;
+  silc_atomic_set_int32(&lb->refcnt, 1);
+
+  return (SilcBuffer)lb;
+}
+
+/* Take a reference to a loaned buffer */
+
+void silc_socket_stream_loan_ref(SilcBuffer buffer)
+{
+  SilcSocketLoanBuf lb = (SilcSocketLoanBuf)buffer;
+  silc_atomic_add_int32(&lb->refcnt, 1);
+}
+
+/* Release a reference to a loaned buffer, returning it to the pool when
+   the last reference goes away */
+
+void silc_socket_stream_loan_release(SilcBuffer buffer)
+{
+  SilcSocketLoanBuf lb = (SilcSocketLoanBuf)buffer;
+  SilcSocketReadSlab *slab;
+
+  if (silc_atomic_sub_int32(&lb->refcnt, 1) > 0)
+    return;
+
+  /* Return to the releasing thread's slab; buffers migrate freely
+     between the threads' slabs. */
+  slab = silc_socket_read_slab();
+  if (slab && slab->count < SILC_SOCKET_SLAB_MAX) {
+    lb->next = slab->free_bufs;
+    slab->free_bufs = lb;
+    slab->count++;
+    return;
+  }
+
+  silc_free(lb);
+}
+
+/* Deferred hostname resolution context */
+typedef struct {
+  SilcSocketStream sock;
+  SilcSocketStreamResolved callback;
+  void *context;
+} *SilcSocketStreamResolve;
+
+/* Deferred hostname resolution completion */
+
+static void silc_socket_stream_resolved(const char *result, void *context)
+{
+  SilcSocketStreamResolve r = context;
+
+  if (result) {
+    silc_free(r->sock->hostname);
+    r->sock->hostname = silc_strdup(result);
+  }
+
+  if (r->callback)
+    r->callback((SilcStream)r->sock, r->context);
+
+  silc_free(r);
+}
+
+/* Resolve the hostname of the stream's remote IP asynchronously */
+
+SilcBool silc_socket_stream_resolve(SilcStream stream,
+				    SilcSocketStreamResolved callback,
+				    void *context)
+{
+  SilcSocketStream socket_stream = stream;
+  SilcSocketStreamResolve r;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream) || !socket_stream->ip) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  r = silc_calloc(1, sizeof(*r));
+  if (!r)
+    return FALSE;
+  r->sock = socket_stream;
+  r->callback = callback;
+  r->context = context;
+
+  silc_net_gethostbyaddr_async(socket_stream->ip, socket_stream->schedule,
+			       silc_socket_stream_resolved, r);
+
+  return TRUE;
+}
+
+#ifdef SILC_HAVE_MSG_ZEROCOPY
+
+/* Drains zerocopy completion notifications from the socket error queue
+   and releases the buffer references the kernel no longer needs. */
+
+static void silc_socket_stream_zerocopy_reap(SilcSocketStream sock)
+{
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  struct sock_extended_err *serr;
+  unsigned char control[128];
+  SilcSocketZcPending p;
+  SilcUInt32 lo, hi;
+
+  while (sock->zc_pending) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(sock->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      return;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+      if (serr->ee_errno != 0 ||
+	  serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+	continue;
+
+      /* Completed sends [ee_info, ee_data]; release their buffers */
+      lo = serr->ee_info;
+      hi = serr->ee_data;
+      while (sock->zc_pending &&
+	     sock->zc_pending->seq - lo <= hi - lo) {
+	p = sock->zc_pending;
+	sock->zc_pending = p->next;
+	silc_buffer_unref(p->buffer);
+	silc_free(p);
+      }
+    }
+  }
+}
+
+#endif /* SILC_HAVE_MSG_ZEROCOPY */
+
+/* Enable MSG_ZEROCOPY transmission */
+
+SilcBool silc_socket_stream_set_zerocopy(SilcStream stream,
+					 SilcUInt32 threshold)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+#ifdef SILC_HAVE_MSG_ZEROCOPY
+  if (silc_net_set_socket_opt(socket_stream->sock, SOL_SOCKET,
+			      SO_ZEROCOPY, 1) != 0)
+    return FALSE;
+
+  socket_stream->zc_threshold = threshold ? threshold : 16384;
+
+  SILC_LOG_DEBUG(("Enabled zerocopy on stream %p, threshold %u",
+		  socket_stream, socket_stream->zc_threshold));
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* SILC_HAVE_MSG_ZEROCOPY */
+}
+
+/* Write buffer with MSG_ZEROCOPY.  The buffer reference is held until
+   the kernel signals completion through the error queue. */
+
+int silc_socket_stream_write_zerocopy(SilcStream stream, SilcBuffer buffer)
+{
+  SilcSocketStream sock = stream;
+
+  if (silc_unlikely(!SILC_IS_SOCKET_STREAM(sock)) || !buffer) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -2;
+  }
+
+#ifdef SILC_HAVE_MSG_ZEROCOPY
+  if (sock->zc_threshold &&
+      silc_buffer_len(buffer) >= sock->zc_threshold) {
+    SilcSocketZcPending p, *pp;
+    int ret;
+
+    /* Release buffers of completed sends first */
+    silc_socket_stream_zerocopy_reap(sock);
+
+    ret = send(sock->sock, silc_buffer_data(buffer),
+	       silc_buffer_len(buffer), MSG_ZEROCOPY);
+    if (ret < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				    SILC_TASK_READ | SILC_TASK_WRITE,
+				    FALSE);
+	return -1;
+      }
+      if (errno == ENOBUFS) {
+	/* Kernel cannot pin more pages; send copied instead */
+	return silc_stream_write(stream, silc_buffer_data(buffer),
+				 silc_buffer_len(buffer));
+      }
+      silc_set_errno_posix(errno);
+      return -2;
+    }
+
+    /* The kernel pinned the sent bytes; hold a reference until the
+       completion notification arrives. */
+    p = silc_calloc(1, sizeof(*p));
+    if (p) {
+      p->buffer = silc_buffer_ref(buffer);
+      p->seq = sock->zc_seq;
+      for (pp = &sock->zc_pending; *pp; pp = &(*pp)->next)
+	;
+      *pp = p;
+    }
+    sock->zc_seq++;
+
+    return ret;
+  }
+#endif /* SILC_HAVE_MSG_ZEROCOPY */
+
+  /* Below threshold or not supported; ordinary copied write */
+  return silc_stream_write(stream, silc_buffer_data(buffer),
+			   silc_buffer_len(buffer));
+}
+
+/* Return per-connection transport metrics */
+
+SilcBool silc_socket_stream_get_metrics(SilcStream stream,
+					SilcSocketStreamMetrics *ret_metrics)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if ((!SILC_IS_SOCKET_STREAM(socket_stream) &&
+       !SILC_IS_SOCKET_STREAM_UDP(socket_stream)) || !ret_metrics) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  memset(ret_metrics, 0, sizeof(*ret_metrics));
+  ret_metrics->bytes_in = socket_stream->bytes_in;
+  ret_metrics->bytes_out = socket_stream->bytes_out;
+  ret_metrics->ops_in = socket_stream->ops_in;
+  ret_metrics->ops_out = socket_stream->ops_out;
+  ret_metrics->last_activity = socket_stream->last_activity;
+
+#if defined(SILC_LINUX) || defined(__linux__)
+  {
+    /* On-demand kernel view of the connection; one syscall here
+       instead of ss/netstat scraping, and nothing on the data path. */
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+
+    if (getsockopt(socket_stream->sock, IPPROTO_TCP, TCP_INFO, &info,
+		   &len) == 0) {
+      ret_metrics->rtt_usec = info.tcpi_rtt;
+      ret_metrics->cwnd = info.tcpi_snd_cwnd;
+      ret_metrics->retransmits = info.tcpi_total_retrans;
+    }
+  }
+#endif /* SILC_LINUX || __linux__ */
+
+  return TRUE;
+}
+
+/* Return cached binary IP address */
+
+const unsigned char *silc_socket_stream_get_ip_bin(SilcStream stream,
+						   SilcUInt32 *ret_len)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream) &&
+      !SILC_IS_SOCKET_STREAM_UDP(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  if (!socket_stream->ip_bin_len) {
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  if (ret_len)
+    *ret_len = socket_stream->ip_bin_len;
+
+  return socket_stream->ip_bin;
+}
+
+/* Return number of datagrams dropped by rate shaping */
+
+SilcUInt64 silc_socket_stream_get_qos_drops(SilcStream stream)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream) &&
+      !SILC_IS_SOCKET_STREAM_UDP(socket_stream))
+    return 0;
+
+  return socket_stream->qos ? socket_stream->qos->dropped : 0;
+}
+
+/* Set TCP_NODELAY */
+
+SilcBool silc_socket_stream_set_nodelay(SilcStream stream, SilcBool nodelay)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+#if defined(IPPROTO_TCP) && defined(TCP_NODELAY)
+  return silc_net_set_socket_opt(socket_stream->sock, IPPROTO_TCP,
+				 TCP_NODELAY, nodelay ? 1 : 0) == 0;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* IPPROTO_TCP && TCP_NODELAY */
+}
+
+/* Timeout callback that ends a write burst */
+
+SILC_TASK_CALLBACK(silc_socket_stream_uncork_cb)
+{
+  silc_socket_stream_uncork(context);
+}
+
+/* Start small-write coalescing burst */
+
+SilcBool silc_socket_stream_cork(SilcStream stream)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (socket_stream->corked)
+    return TRUE;
+
+#if defined(IPPROTO_TCP) && (defined(TCP_CORK) || defined(TCP_NOPUSH))
+#if defined(TCP_CORK)
+  if (silc_net_set_socket_opt(socket_stream->sock, IPPROTO_TCP,
+			      TCP_CORK, 1) != 0)
+    return FALSE;
+#else
+  if (silc_net_set_socket_opt(socket_stream->sock, IPPROTO_TCP,
+			      TCP_NOPUSH, 1) != 0)
+    return FALSE;
+#endif /* TCP_CORK */
+
+  socket_stream->corked = TRUE;
+
+  /* End the burst automatically on the next scheduler tick in case the
+     caller does not uncork explicitly. */
+  if (socket_stream->schedule)
+    silc_schedule_task_add_timeout(socket_stream->schedule,
+				   silc_socket_stream_uncork_cb,
+				   socket_stream, 0, 0);
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* IPPROTO_TCP && (TCP_CORK || TCP_NOPUSH) */
+}
+
+/* End small-write coalescing burst, flushing the coalesced data */
+
+SilcBool silc_socket_stream_uncork(SilcStream stream)
+{
+  SilcSocketStream socket_stream = stream;
+
+  if (!SILC_IS_SOCKET_STREAM(socket_stream)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!socket_stream->corked)
+    return TRUE;
+
+  socket_stream->corked = FALSE;
+
+#if defined(IPPROTO_TCP) && (defined(TCP_CORK) || defined(TCP_NOPUSH))
+#if defined(TCP_CORK)
+  return silc_net_set_socket_opt(socket_stream->sock, IPPROTO_TCP,
+				 TCP_CORK, 0) == 0;
+#else
+  return silc_net_set_socket_opt(socket_stream->sock, IPPROTO_TCP,
+				 TCP_NOPUSH, 0) == 0;
+#endif /* TCP_CORK */
+#else
+  return TRUE;
+#endif /* IPPROTO_TCP && (TCP_CORK || TCP_NOPUSH) */
+}
+
+/* Send file contents to the socket.  Uses zero-copy sendfile(2) when
+   available and falls back to a read/write loop. */
+
+int silc_socket_stream_sendfile(SilcStream stream, SilcStream fd_stream,
+				SilcUInt64 *offset, SilcUInt32 size)
+{
+  SilcSocketStream sock = stream;
+  int fd, ret;
+
+  if (silc_unlikely(!SILC_IS_SOCKET_STREAM(sock))) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -2;
+  }
+
+  if (silc_unlikely(!silc_fd_stream_get_info(fd_stream, &fd, NULL))) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -2;
+  }
+
+  SILC_LOG_DEBUG(("Sending %d bytes from fd %d to socket %d at offset %llu",
+		  size, fd, sock->sock, *offset));
+
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+  {
+    off_t off = (off_t)*offset;
+
+    ret = sendfile(sock->sock, fd, &off, size);
+    if (ret < 0) {
+      if (errno == EAGAIN || errno == EINTR) {
+	SILC_LOG_DEBUG(("Could not send immediately, will do it later"));
+	silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				    SILC_TASK_READ | SILC_TASK_WRITE, FALSE);
+	return -1;
+      }
+      if (errno != EINVAL && errno != ENOSYS) {
+	silc_set_errno_posix(errno);
+	return -2;
+      }
+      /* Fall back to the read/write loop below */
+    } else {
+      *offset = (SilcUInt64)off;
+      if (silc_schedule_get_fd_events(sock->schedule, sock->sock) &
+	  SILC_TASK_WRITE)
+	silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				    SILC_TASK_READ, FALSE);
+      return ret;
+    }
+  }
+#endif /* HAVE_SYS_SENDFILE_H && HAVE_SENDFILE */
+
+#if defined(SILC_WIN32)
+  {
+    /* Zero-copy file send with TransmitFile.  No OVERLAPPED is passed:
+       winsock sockets are overlapped by default and a stack OVERLAPPED
+       could still be pending when this frame returns.  With a NULL
+       lpOverlapped the call is synchronous and sends from the file
+       pointer, so the offset is seeked first. */
+    HANDLE fh = (HANDLE)_get_osfhandle(fd);
+    LARGE_INTEGER li;
+    int error;
+
+    if (fh != INVALID_HANDLE_VALUE) {
+      li.QuadPart = (LONGLONG)*offset;
+      if (SetFilePointerEx(fh, li, NULL, FILE_BEGIN)) {
+	if (TransmitFile((SOCKET)sock->sock, fh, size, 0, NULL, NULL, 0)) {
+	  *offset += size;
+	  return (int)size;
+	}
+
+	error = WSAGetLastError();
+	if (error == WSAEWOULDBLOCK || error == WSA_IO_PENDING ||
+	    error == ERROR_IO_PENDING) {
+	  /* Nothing was taken synchronously; retry when writable */
+	  silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				      SILC_TASK_READ | SILC_TASK_WRITE,
+				      FALSE);
+	  return -1;
+	}
+	/* Fall back to the read/write loop below */
+      }
+    }
+  }
+#endif /* SILC_WIN32 */
+
+  /* Read/write loop fallback */
+  {
+    unsigned char buf[8192];
+    SilcUInt32 len;
+    int total = 0, wret;
+
+    while (size) {
+      len = size > sizeof(buf) ? sizeof(buf) : size;
+
+      if (silc_unlikely(lseek(fd, (off_t)*offset, SEEK_SET) < 0)) {
+	silc_set_errno_posix(errno);
+	return total ? total : -2;
+      }
+
+      ret = silc_stream_read(fd_stream, buf, len);
+      if (ret <= 0)
+	return total ? total : ret;
+
+      wret = silc_stream_write(stream, buf, ret);
+      if (wret <= 0)
+	return total ? total : wret;
+
+      *offset += wret;
+      total += wret;
+      size -= wret;
+
+      if (wret < ret)
+	break;
+    }
+
+    return total;
+  }
+}
+
 /* SILC Socket Stream ops.  Functions are implemented under the
    platform specific subdirectories. */
 const SilcStreamOps silc_socket_stream_ops =
@@ -407,6 +1249,7 @@ const SilcStreamOps silc_socket_stream_ops =
   silc_socket_stream_destroy,
   silc_socket_stream_notifier,
   silc_socket_stream_get_schedule,
+  silc_socket_stream_writev,
 };
 const SilcStreamOps silc_socket_udp_stream_ops =
 {
@@ -416,4 +1259,5 @@ const SilcStreamOps silc_socket_udp_stream_ops =
   silc_socket_stream_destroy,
   silc_socket_stream_notifier,
   silc_socket_stream_get_schedule,
+  NULL,				/* Gather list goes through write op */
 };
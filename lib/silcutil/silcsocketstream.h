@@ -104,6 +104,35 @@ silc_socket_tcp_stream_create(SilcSocket sock, SilcBool lookup,
 			      SilcSocketStreamCallback callback,
 			      void *context);
 
+/****f* silcutil/silc_socket_tcp_stream_create_stack
+ *
+ * SYNOPSIS
+ *
+ *    SilcAsyncOperation
+ *    silc_socket_tcp_stream_create_stack(SilcStack stack, SilcSocket sock,
+ *                                        SilcBool lookup,
+ *                                        SilcBool require_fqdn,
+ *                                        SilcSchedule schedule,
+ *                                        SilcSocketStreamCallback callback,
+ *                                        void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Same as silc_socket_tcp_stream_create but allocates the stream
+ *    context from `stack', so a connection's stream can live in the
+ *    same arena as the rest of its state and be released in one
+ *    silc_stack_pop after the stream is destroyed.  If `stack' is NULL
+ *    this is equivalent to silc_socket_tcp_stream_create.
+ *
+ ***/
+SilcAsyncOperation
+silc_socket_tcp_stream_create_stack(SilcStack stack, SilcSocket sock,
+				    SilcBool lookup,
+				    SilcBool require_fqdn,
+				    SilcSchedule schedule,
+				    SilcSocketStreamCallback callback,
+				    void *context);
+
 /****f* silcutil/silc_socket_udp_stream_create
  *
  * SYNOPSIS
@@ -210,6 +239,364 @@ SilcBool silc_socket_stream_set_info(SilcStream stream,
 				     const char *hostname,
 				     const char *ip, SilcUInt16 port);
 
+/****f* silcutil/silc_socket_stream_read_loan
+ *
+ * SYNOPSIS
+ *
+ *    SilcBuffer silc_socket_stream_read_loan(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Reads data from the socket stream `stream' into a reference-counted
+ *    buffer loaned from a per-stream pool backed by the scheduler stack,
+ *    avoiding the copy into a caller-provided buffer.  The returned
+ *    buffer holds one reference; the application parses the data in
+ *    place and releases it with silc_socket_stream_loan_release, which
+ *    returns the buffer to the pool.  Additional references may be taken
+ *    with silc_socket_stream_loan_ref if the data must outlive the
+ *    parsing.  All loans must be released before the stream is
+ *    destroyed.
+ *
+ *    Returns NULL if data could not be read; silc_errno is
+ *    SILC_ERR_WOULD_BLOCK when reading would block (the stream notifier
+ *    signals when data arrives), SILC_ERR_EOF on end of stream, or the
+ *    read error.
+ *
+ ***/
+SilcBuffer silc_socket_stream_read_loan(SilcStream stream);
+
+/****f* silcutil/silc_socket_stream_loan_ref
+ *
+ * SYNOPSIS
+ *
+ *    void silc_socket_stream_loan_ref(SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Takes an additional reference to the loaned buffer `buffer'
+ *    returned by silc_socket_stream_read_loan.
+ *
+ ***/
+void silc_socket_stream_loan_ref(SilcBuffer buffer);
+
+/****f* silcutil/silc_socket_stream_loan_release
+ *
+ * SYNOPSIS
+ *
+ *    void silc_socket_stream_loan_release(SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Releases a reference to the loaned buffer `buffer'.  When the last
+ *    reference is released the buffer returns to the loan pool for
+ *    reuse.
+ *
+ ***/
+void silc_socket_stream_loan_release(SilcBuffer buffer);
+
+/****f* silcutil/SilcSocketStreamResolved
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcSocketStreamResolved)(SilcStream stream,
+ *                                             void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Completion callback of silc_socket_stream_resolve, called when the
+ *    hostname of the stream has been resolved and set to the stream.
+ *
+ ***/
+typedef void (*SilcSocketStreamResolved)(SilcStream stream, void *context);
+
+/****f* silcutil/silc_socket_stream_resolve
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool
+ *    silc_socket_stream_resolve(SilcStream stream,
+ *                               SilcSocketStreamResolved callback,
+ *                               void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Resolves the hostname of the stream's remote IP address
+ *    asynchronously and updates it to the stream, after which
+ *    silc_socket_stream_get_info returns the hostname.  Use together
+ *    with silc_net_listener_set_deferred_lookup, which delivers accepted
+ *    streams immediately with IP information only instead of stalling
+ *    accepts on reverse DNS.  The stream must stay valid until the
+ *    `callback' is called.
+ *
+ ***/
+SilcBool silc_socket_stream_resolve(SilcStream stream,
+				    SilcSocketStreamResolved callback,
+				    void *context);
+
+/****s* silcutil/SilcSocketStreamMetrics
+ *
+ * NAME
+ *
+ *    typedef struct SilcSocketStreamMetricsStruct
+ *                     SilcSocketStreamMetrics;
+ *
+ * DESCRIPTION
+ *
+ *    Per-connection transport metrics returned by
+ *    silc_socket_stream_get_metrics.  The byte/operation counters and
+ *    the coarse-clock last-activity stamp are maintained on the data
+ *    path for free; the TCP fields come from an on-demand TCP_INFO
+ *    query and are zero on platforms without it or on UDP streams.
+ *
+ * SOURCE
+ */
+typedef struct SilcSocketStreamMetricsStruct {
+  SilcUInt64 bytes_in;		       /* Bytes read from the socket */
+  SilcUInt64 bytes_out;		       /* Bytes written to the socket */
+  SilcUInt64 ops_in;		       /* Successful read calls */
+  SilcUInt64 ops_out;		       /* Successful write calls */
+  SilcUInt64 last_activity;	       /* Coarse usec of last I/O */
+  SilcUInt32 rtt_usec;		       /* Smoothed RTT, microseconds */
+  SilcUInt32 cwnd;		       /* Congestion window, segments */
+  SilcUInt32 retransmits;	       /* Total retransmitted segments */
+} SilcSocketStreamMetrics;
+/***/
+
+/****f* silcutil/silc_socket_stream_get_metrics
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool
+ *    silc_socket_stream_get_metrics(SilcStream stream,
+ *                                   SilcSocketStreamMetrics *ret_metrics);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the stream's transport metrics, so a balancer can steer
+ *    by measured connection quality without out-of-band scraping.
+ *    The TCP_INFO query costs one syscall per call; the counters cost
+ *    nothing beyond the data path's own work.
+ *
+ ***/
+SilcBool silc_socket_stream_get_metrics(SilcStream stream,
+					SilcSocketStreamMetrics *ret_metrics);
+
+/****f* silcutil/silc_socket_stream_get_ip_bin
+ *
+ * SYNOPSIS
+ *
+ *    const unsigned char *
+ *    silc_socket_stream_get_ip_bin(SilcStream stream,
+ *                                  SilcUInt32 *ret_len);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the binary form of the stream's IP address, cached when
+ *    the address was set with silc_socket_stream_set_info; 4 bytes for
+ *    IPv4 and 16 for IPv6, network byte order.  ACL checks use this
+ *    with silc_ip_tree_find_bin without re-parsing the address per
+ *    evaluation.  Returns NULL if no address is cached.
+ *
+ ***/
+const unsigned char *silc_socket_stream_get_ip_bin(SilcStream stream,
+						   SilcUInt32 *ret_len);
+
+/****f* silcutil/silc_socket_stream_set_nodelay
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_socket_stream_set_nodelay(SilcStream stream,
+ *                                            SilcBool nodelay);
+ *
+ * DESCRIPTION
+ *
+ *    Enables or disables the TCP_NODELAY option on the socket stream
+ *    `stream', disabling or enabling the Nagle algorithm.  Returns FALSE
+ *    if the option could not be set or is not supported on the platform.
+ *
+ ***/
+SilcBool silc_socket_stream_set_nodelay(SilcStream stream, SilcBool nodelay);
+
+/****f* silcutil/silc_socket_stream_cork
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_socket_stream_cork(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Starts a small-write coalescing burst on the socket stream `stream'.
+ *    Data written with silc_stream_write while the stream is corked is
+ *    coalesced by the kernel into full-sized segments instead of going
+ *    out as one packet per write.  The burst is ended by calling the
+ *    silc_socket_stream_uncork, or automatically on the next scheduler
+ *    tick.  Returns FALSE if corking is not supported on the platform.
+ *
+ ***/
+SilcBool silc_socket_stream_cork(SilcStream stream);
+
+/****f* silcutil/silc_socket_stream_uncork
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_socket_stream_uncork(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Ends a small-write coalescing burst started with the
+ *    silc_socket_stream_cork, flushing the coalesced data to the wire.
+ *
+ ***/
+SilcBool silc_socket_stream_uncork(SilcStream stream);
+
+/****f* silcutil/silc_socket_stream_set_read_buffer
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool
+ *    silc_socket_stream_set_read_buffer(SilcStream stream,
+ *                                       SilcUInt32 low_watermark,
+ *                                       SilcUInt32 high_watermark);
+ *
+ * DESCRIPTION
+ *
+ *    Enables adaptive read sizing on the socket stream indicated by
+ *    `stream'.  Reads start at `low_watermark' bytes; the size grows
+ *    towards `high_watermark' while reads keep filling it (bulk
+ *    transfers) and shrinks back towards `low_watermark' when only
+ *    little data arrives (idle or small-message connections), so mostly
+ *    idle connections do not pin large read buffers.  The application
+ *    can size its receive buffers with silc_socket_stream_get_read_size.
+ *    Setting either watermark to zero disables adaptive sizing.
+ *
+ ***/
+SilcBool silc_socket_stream_set_read_buffer(SilcStream stream,
+					    SilcUInt32 low_watermark,
+					    SilcUInt32 high_watermark);
+
+/****f* silcutil/silc_socket_stream_get_read_size
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_socket_stream_get_read_size(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the current recommended read size of the socket stream
+ *    `stream' when adaptive read sizing has been enabled with the
+ *    silc_socket_stream_set_read_buffer, or zero if it is not enabled.
+ *
+ ***/
+SilcUInt32 silc_socket_stream_get_read_size(SilcStream stream);
+
+/****f* silcutil/silc_socket_stream_sendfile
+ *
+ * SYNOPSIS
+ *
+ *    int silc_socket_stream_sendfile(SilcStream stream,
+ *                                    SilcStream fd_stream,
+ *                                    SilcUInt64 *offset, SilcUInt32 size);
+ *
+ * DESCRIPTION
+ *
+ *    Sends `size' bytes of the file represented by the fd stream
+ *    `fd_stream' (see silc_fd_stream_file) starting at `offset' to the
+ *    socket stream `stream'.  On platforms with sendfile(2) the data is
+ *    copied inside the kernel without passing through user space; on
+ *    other platforms a read/write loop is used.  The `offset' is updated
+ *    by the amount of data sent.  Returns the amount of data sent, -1 if
+ *    the data could not be sent at this moment (the stream notifier will
+ *    be called with SILC_STREAM_CAN_WRITE when sending can continue), or
+ *    -2 on error.  Note that less than `size' bytes may be sent; the
+ *    caller should call this again until the whole file range has been
+ *    sent.
+ *
+ ***/
+int silc_socket_stream_sendfile(SilcStream stream, SilcStream fd_stream,
+				SilcUInt64 *offset, SilcUInt32 size);
+
+/****f* silcutil/silc_socket_stream_get_qos_drops
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_socket_stream_get_qos_drops(SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the number of datagrams the rate shaper has dropped on
+ *    this stream (UDP sends over the configured rate).
+ *
+ ***/
+SilcUInt64 silc_socket_stream_get_qos_drops(SilcStream stream);
+
+/****f* silcutil/silc_socket_stream_set_zerocopy
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_socket_stream_set_zerocopy(SilcStream stream,
+ *                                             SilcUInt32 threshold);
+ *
+ * DESCRIPTION
+ *
+ *    Enables zero-copy transmission (Linux MSG_ZEROCOPY) on the TCP
+ *    socket stream.  Writes made with
+ *    silc_socket_stream_write_zerocopy of at least `threshold' bytes
+ *    (16384 if 0) are sent without copying the payload into the
+ *    kernel.  Returns FALSE if the platform does not support zero-copy
+ *    transmission.  Zero-copy pays off for large writes only; small
+ *    writes cost more through this path than through the copying one.
+ *
+ ***/
+SilcBool silc_socket_stream_set_zerocopy(SilcStream stream,
+					 SilcUInt32 threshold);
+
+/****f* silcutil/silc_socket_stream_write_zerocopy
+ *
+ * SYNOPSIS
+ *
+ *    int silc_socket_stream_write_zerocopy(SilcStream stream,
+ *                                          SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Writes the `buffer' to the stream, using zero-copy transmission
+ *    when it is enabled and the buffer meets the threshold.  The
+ *    `buffer' MUST be a reference counted buffer from
+ *    silc_buffer_ref_create (or a slice of one); a reference is held
+ *    until the kernel reports it has released the pages, so the caller
+ *    may silc_buffer_unref its own reference immediately after this
+ *    call.  Return values are those of silc_stream_write.
+ *
+ ***/
+int silc_socket_stream_write_zerocopy(SilcStream stream, SilcBuffer buffer);
+
+/****f* silcutil/silc_socket_stream_set_rate
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_socket_stream_set_rate(SilcStream stream,
+ *                                         SilcUInt32 rate,
+ *                                         SilcUInt32 burst);
+ *
+ * DESCRIPTION
+ *
+ *    Sets token bucket based read rate limiting on the socket stream
+ *    `stream'.  Reading is limited to `rate' bytes per second with
+ *    bursts of up to `burst' bytes (if `burst' is zero it defaults to
+ *    `rate').  When the bucket runs empty the stream stops reading until
+ *    a coalesced per-scheduler tick refills the buckets of all throttled
+ *    streams; one tick services any number of shaped streams, so large
+ *    numbers of rate-limited connections do not flood the scheduler with
+ *    per-stream timers.  Setting `rate' to zero disables the limiting.
+ *
+    With UDP streams, datagrams sent over the budget are dropped and
+ *    counted (see silc_socket_stream_get_qos_drops) and received data
+ *    consumes the budget with reading paused until the next refill.
+ *
+ ***/
+SilcBool silc_socket_stream_set_rate(SilcStream stream, SilcUInt32 rate,
+				     SilcUInt32 burst);
+
 /****f* silcutil/silc_socket_stream_set_qos
  *
  * SYNOPSIS
@@ -38,27 +38,79 @@ typedef struct SilcSocketQosStruct {
   SilcUInt32 data_len;
   unsigned char *buffer;
   SilcSocketStream sock;
+
+  /* Token bucket engine */
+  SilcUInt32 rate;		    /* Rate, bytes per second */
+  SilcUInt32 burst;		    /* Bucket size, bytes */
+  SilcUInt32 tokens;		    /* Available tokens */
+  struct timeval last_refill;	    /* Last bucket refill time */
+  struct SilcSocketQosStruct *tnext;/* Throttled list linkage */
+  SilcUInt64 dropped;		    /* Datagrams dropped by shaping */
+  unsigned int throttled : 1;	    /* Set when waiting for the QoS tick */
 } *SilcSocketQos;
 
+/* In-flight MSG_ZEROCOPY send.  The buffer reference is held until the
+   kernel's completion notification for `seq' arrives from the error
+   queue. */
+typedef struct SilcSocketZcPendingStruct {
+  struct SilcSocketZcPendingStruct *next;
+  SilcBuffer buffer;		    /* Referenced caller buffer */
+  SilcUInt32 seq;		    /* Zerocopy sequence number */
+} *SilcSocketZcPending;
+
+/* Loaned read buffer.  The SilcBufferStruct is first so that the loan
+   can be used as a SilcBuffer. */
+typedef struct SilcSocketLoanBufStruct {
+  SilcBufferStruct buf;
+  SilcAtomic32 refcnt;
+  SilcSocketStream sock;
+  struct SilcSocketLoanBufStruct *next;
+} *SilcSocketLoanBuf;
+
 /* SILC Socket Stream context */
 struct SilcSocketStreamStruct {
   const SilcStreamOps *ops;
   SilcSchedule schedule;
+  SilcStack stack;		    /* Context allocation stack, may be NULL */
   SilcSocket sock;
   char *hostname;
   char *ip;
   SilcSocketQos qos;
   SilcStreamNotifier notifier;
   void *notifier_context;
+  SilcSocketZcPending zc_pending;   /* In-flight zerocopy sends */
+  unsigned char ip_bin[16];	    /* Cached binary IP */
+  SilcUInt8 ip_bin_len;		    /* Binary IP length, 0 not cached */
+  SilcUInt64 bytes_in;		    /* Bytes read from the socket */
+  SilcUInt64 bytes_out;		    /* Bytes written to the socket */
+  SilcUInt64 ops_in;		    /* Successful reads */
+  SilcUInt64 ops_out;		    /* Successful writes */
+  SilcUInt64 last_activity;	    /* Coarse usec of last I/O */
+  SilcUInt32 zc_threshold;	    /* Zerocopy min write size, 0 off */
+  SilcUInt32 zc_seq;		    /* Next zerocopy sequence number */
+  SilcUInt32 read_size;		    /* Current adaptive read size */
+  SilcUInt32 read_low;		    /* Read size low watermark */
+  SilcUInt32 read_high;		    /* Read size high watermark */
   SilcUInt16 port;
   unsigned int ipv6      : 1;       /* UDP IPv6 */
   unsigned int connected : 1;	    /* UDP connected state */
+  unsigned int corked    : 1;	    /* Small-write coalescing active */
 };
 
 #define SILC_IS_SOCKET_STREAM(s) (s && s->ops == &silc_socket_stream_ops)
 #define SILC_IS_SOCKET_STREAM_UDP(s) (s && s->ops == &silc_socket_udp_stream_ops)
 
 extern const SilcStreamOps silc_socket_stream_ops;
+
+/* Throttle `sock' until the coalesced per-scheduler QoS tick refills its
+   token bucket (internal) */
+void silc_socket_stream_qos_throttle(SilcSocketStream sock);
+
+/* Remove `sock' from the throttled list (internal) */
+void silc_socket_stream_qos_unthrottle(SilcSocketStream sock);
+
+/* Refill `qos' token bucket from elapsed time (internal) */
+void silc_socket_stream_qos_refill(SilcSocketQos qos);
 extern const SilcStreamOps silc_socket_udp_stream_ops;
 
 /* Backwards support */
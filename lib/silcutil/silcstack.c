@@ -19,8 +19,22 @@
 
 #include "silcruntime.h"
 
+#if defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif /* HAVE_SYS_MMAN_H */
+
 /************************** Types and definitions ***************************/
 
+/* Record of a memory mapped stack block */
+typedef struct SilcStackMmapStruct {
+  struct SilcStackMmapStruct *next;
+  void *ptr;
+  SilcUInt32 len;
+} *SilcStackMmap;
+
 /* The SilcStack context */
 struct SilcStackStruct {
   SilcStack parent;			      /* Parent stack */
@@ -33,6 +47,12 @@ struct SilcStackStruct {
   void *oom_context;			      /* OOM handler context */
   SilcUInt32 stack_size;		      /* Default stack size */
   SilcUInt32 alignment;			      /* Memory alignment */
+  SilcStackMmap mmaps;			      /* Memory mapped blocks */
+  SilcUInt32 prefault;			      /* Bytes to prefault per block */
+  unsigned int use_mmap : 1;		      /* Back blocks with mmap */
+  SilcUInt32 susage;			      /* Bytes currently in use */
+  SilcUInt32 shwm;			      /* Usage high watermark */
+  SilcUInt32 snum_children;		      /* Blocks taken from parent */
   SilcAtomic32 refcnt;			      /* Reference counter */
 #ifdef SILC_DIST_INPLACE
   /* Statistics */
@@ -44,6 +64,98 @@ struct SilcStackStruct {
 
 /************************ Static utility functions **************************/
 
+/* Returns the root stack that owns all block memory */
+
+#define SILC_STACK_ROOT(stack, root)		\
+do {						\
+  (root) = (stack);				\
+  while ((root)->parent)			\
+    (root) = (root)->parent;			\
+} while(0)
+
+/* Allocates stack block memory.  With mmap backing enabled the block
+   comes from an anonymous mapping with huge pages (MAP_HUGETLB when
+   available, transparent huge pages advised otherwise) and is prefaulted
+   up to the configured amount so steady-state allocations do not fault. */
+
+static void *silc_stack_block_alloc(SilcStack stack, SilcUInt32 size)
+{
+  SilcStack root;
+
+  SILC_STACK_ROOT(stack, root);
+
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+  if (root->use_mmap) {
+    SilcStackMmap rec;
+    SilcUInt32 len = SILC_STACK_ALIGN(size, 4096);
+    void *ptr = MAP_FAILED;
+    volatile unsigned char *touch;
+    SilcUInt32 i;
+
+#if defined(MAP_HUGETLB)
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif /* MAP_HUGETLB */
+    if (ptr == MAP_FAILED) {
+      ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED)
+	return silc_malloc(size);
+#if defined(MADV_HUGEPAGE)
+      madvise(ptr, len, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+    }
+
+    rec = silc_malloc(sizeof(*rec));
+    if (!rec) {
+      munmap(ptr, len);
+      return silc_malloc(size);
+    }
+    rec->ptr = ptr;
+    rec->len = len;
+    rec->next = root->mmaps;
+    root->mmaps = rec;
+
+    /* Prefault */
+    touch = ptr;
+    for (i = 0; i < len && i < root->prefault; i += 4096)
+      touch[i] = 0;
+
+    return ptr;
+  }
+#endif /* HAVE_SYS_MMAN_H && MAP_ANONYMOUS */
+
+  return silc_malloc(size);
+}
+
+/* Frees stack block memory allocated with silc_stack_block_alloc */
+
+static void silc_stack_block_free(SilcStack stack, void *ptr)
+{
+  SilcStack root;
+  SilcStackMmap rec, prev = NULL;
+
+  if (!ptr)
+    return;
+
+  SILC_STACK_ROOT(stack, root);
+
+  for (rec = root->mmaps; rec; prev = rec, rec = rec->next)
+    if (rec->ptr == ptr) {
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+      munmap(rec->ptr, rec->len);
+#endif /* HAVE_SYS_MMAN_H && MAP_ANONYMOUS */
+      if (prev)
+	prev->next = rec->next;
+      else
+	root->mmaps = rec->next;
+      silc_free(rec);
+      return;
+    }
+
+  silc_free(ptr);
+}
+
 /* Compute stack block index for the `size'. */
 
 static SilcUInt32 silc_stack_get_index(SilcUInt32 size, SilcUInt32 *ret_bsize)
@@ -99,6 +211,8 @@ static SilcStackDataEntry silc_stack_ref_stack(SilcStack stack,
   silc_mutex_unlock(stack->lock);
 
   /* If we are child, get block from parent */
+  if (stack->parent)
+    stack->snum_children++;
   if (stack->parent)
     return silc_stack_ref_stack(stack->parent, size, ret_si, ret_bsize);
 
@@ -108,8 +222,9 @@ static SilcStackDataEntry silc_stack_ref_stack(SilcStack stack,
   e = silc_calloc(1, sizeof(*e));
   if (!e)
     return NULL;
-  e->data[si] = silc_malloc(bsize + SILC_STACK_ALIGN(sizeof(*e->data[0]),
-						     stack->alignment));
+  e->data[si] = silc_stack_block_alloc(stack, bsize +
+				       SILC_STACK_ALIGN(sizeof(*e->data[0]),
+							stack->alignment));
   if (!e->data[si]) {
     silc_free(e);
     return NULL;
@@ -237,7 +352,7 @@ SilcStack silc_stack_alloc(SilcUInt32 stack_size, SilcStack parent)
       return NULL;
     }
     stack->stack->data[0] =
-      silc_malloc(stack->stack_size +
+      silc_stack_block_alloc(stack, stack->stack_size +
 		  SILC_STACK_ALIGN(sizeof(*stack->stack->data[0]),
 				   stack->alignment));
     if (!stack->stack->data[0]) {
@@ -254,7 +369,7 @@ SilcStack silc_stack_alloc(SilcUInt32 stack_size, SilcStack parent)
 					   SILC_STACK_DEFAULT_NUM,
 					   sizeof(*stack->frames));
     if (!stack->frames) {
-      silc_free(stack->stack->data[0]);
+      silc_stack_block_free(stack, stack->stack->data[0]);
       silc_free(stack->stack);
       silc_free(stack);
       return NULL;
@@ -300,12 +415,12 @@ void silc_stack_free(SilcStack stack)
     silc_list_start(stack->stacks);
     while ((e = silc_list_get(stack->stacks))) {
       for (i = 0; i < SILC_STACK_BLOCK_NUM; i++)
-	silc_free(e->data[i]);
+	silc_stack_block_free(stack, e->data[i]);
       silc_free(e);
     }
 
     for (i = 0; i < SILC_STACK_BLOCK_NUM; i++)
-      silc_free(stack->stack->data[i]);
+      silc_stack_block_free(stack, stack->stack->data[i]);
     silc_free(stack->stack);
 
     if (stack->lock)
@@ -362,7 +477,7 @@ SilcUInt32 silc_stack_push(SilcStack stack, SilcStackFrame *frame)
 
 SilcUInt32 silc_stack_pop(SilcStack stack)
 {
-  SilcUInt32 si;
+  SilcUInt32 si, released = 0;
 
   if (!stack || !stack->frame->prev)
     return 0;
@@ -370,12 +485,18 @@ SilcUInt32 silc_stack_pop(SilcStack stack)
   /* Pop */
   si = stack->frame->si;
   while (si > stack->frame->prev->si) {
-    if (stack->stack->data[si])
+    if (stack->stack->data[si]) {
+      released += SILC_STACK_BLOCK_SIZE(stack, si) -
+	stack->stack->data[si]->bytes_left;
       stack->stack->data[si]->bytes_left = SILC_STACK_BLOCK_SIZE(stack, si);
+    }
     si--;
   }
+  released += stack->frame->bytes_used -
+    stack->stack->data[si]->bytes_left;
   stack->stack->data[si]->bytes_left = stack->frame->bytes_used;
   stack->frame = stack->frame->prev;
+  stack->susage -= released;
 
   SILC_ST_DEBUG(("Pop %p: sp %d -> %d, si %d", stack, stack->frame->sp + 1,
 		 stack->frame->sp, stack->frame->si));
@@ -385,6 +506,82 @@ SilcUInt32 silc_stack_pop(SilcStack stack)
 
 /* Allocate memory.  Returns pointer to the memory or NULL on error. */
 
+/* Capture a checkpoint of the current allocation state */
+
+void silc_stack_checkpoint(SilcStack stack, SilcStackCheckpoint *checkpoint)
+{
+  if (!stack || !checkpoint)
+    return;
+
+  checkpoint->sp = stack->frame->sp;
+  checkpoint->si = stack->frame->si;
+  checkpoint->bytes_left = stack->stack->data[checkpoint->si]->bytes_left;
+}
+
+/* Release everything allocated since the checkpoint */
+
+SilcBool silc_stack_rollback(SilcStack stack, SilcStackCheckpoint *checkpoint)
+{
+  SilcUInt32 si, released = 0;
+
+  if (!stack || !checkpoint)
+    return FALSE;
+
+  /* The checkpoint is valid only at the frame depth it was taken at */
+  if (stack->frame->sp != checkpoint->sp ||
+      stack->frame->si < checkpoint->si) {
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return FALSE;
+  }
+
+  si = stack->frame->si;
+  while (si > checkpoint->si) {
+    if (stack->stack->data[si]) {
+      released += SILC_STACK_BLOCK_SIZE(stack, si) -
+	stack->stack->data[si]->bytes_left;
+      stack->stack->data[si]->bytes_left = SILC_STACK_BLOCK_SIZE(stack, si);
+    }
+    si--;
+  }
+  released += checkpoint->bytes_left -
+    stack->stack->data[si]->bytes_left;
+  stack->stack->data[si]->bytes_left = checkpoint->bytes_left;
+  stack->frame->si = checkpoint->si;
+  stack->susage -= released;
+
+  return TRUE;
+}
+
+/* Promote the latest allocation to the enclosing frame */
+
+SilcBool silc_stack_promote(SilcStack stack, void *ptr, SilcUInt32 size)
+{
+  SilcUInt32 si, bsize;
+
+  if (!stack || !ptr || !stack->frame->prev) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* The region must be the latest allocation: it ends at the block's
+     current allocation front. */
+  si = stack->frame->si;
+  bsize = SILC_STACK_BLOCK_SIZE(stack, si);
+  size = SILC_STACK_ALIGN(size, stack->alignment);
+  if ((unsigned char *)ptr + size != SILC_STACK_DATA(stack, si, bsize)) {
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return FALSE;
+  }
+
+  /* Move the enclosing frame's restore point past the region so the
+     coming pop keeps it (and everything before it in this block). */
+  stack->frame->prev->si = si;
+  stack->frame->bytes_used = stack->stack->data[si]->bytes_left;
+  stack->frame->si = si;
+
+  return TRUE;
+}
+
 void *silc_stack_malloc(SilcStack stack, SilcUInt32 size)
 {
   void *ptr;
@@ -422,6 +619,9 @@ void *silc_stack_malloc(SilcStack stack, SilcUInt32 size)
     ptr = SILC_STACK_DATA(stack, si, bsize);
     stack->stack->data[si]->bytes_left -= size;
     SILC_STACK_STAT(stack, bytes_malloc, size);
+    stack->susage += size;
+    if (stack->susage > stack->shwm)
+      stack->shwm = stack->susage;
     return ptr;
   }
 
@@ -449,9 +649,9 @@ void *silc_stack_malloc(SilcStack stack, SilcUInt32 size)
   if (!stack->stack->data[si]) {
     SILC_ST_DEBUG(("Allocating new stack block, %d bytes", bsize2));
     stack->stack->data[si] =
-      silc_malloc(bsize2 +
-		  SILC_STACK_ALIGN(sizeof(**stack->stack->data),
-				   stack->alignment));
+      silc_stack_block_alloc(stack, bsize2 +
+			     SILC_STACK_ALIGN(sizeof(**stack->stack->data),
+					      stack->alignment));
     if (silc_unlikely(!stack->stack->data[si])) {
       SILC_STACK_STAT(stack, num_errors, 1);
       if (stack->oom_handler)
@@ -468,6 +668,9 @@ void *silc_stack_malloc(SilcStack stack, SilcUInt32 size)
   stack->stack->data[si]->bytes_left -= size;
   stack->frame->si = si;
   SILC_STACK_STAT(stack, bytes_malloc, size);
+  stack->susage += size;
+  if (stack->susage > stack->shwm)
+    stack->shwm = stack->susage;
 
   return ptr;
 }
@@ -582,7 +785,7 @@ SilcBool silc_stack_purge(SilcStack stack)
 	stack->stack->data[i]->bytes_left == SILC_STACK_BLOCK_SIZE(stack, i)) {
       SILC_LOG_DEBUG(("Purge %d bytes",
 		      SILC_STACK_BLOCK_SIZE(stack, i)));
-      silc_free(stack->stack->data[i]);
+      silc_stack_block_free(stack, stack->stack->data[i]);
       stack->stack->data[i] = NULL;
       ret = TRUE;
     }
@@ -600,7 +803,7 @@ SilcBool silc_stack_purge(SilcStack stack)
     ret = TRUE;
 
     for (i = 0; i < SILC_STACK_BLOCK_NUM; i++)
-      silc_free(e->data[i]);
+      silc_stack_block_free(stack, e->data[i]);
     silc_free(e);
   }
 
@@ -611,7 +814,7 @@ SilcBool silc_stack_purge(SilcStack stack)
       if (e->data[i]) {
 	SILC_LOG_DEBUG(("Purge %d bytes",
 			SILC_STACK_BLOCK_SIZE(stack, i)));
-	silc_free(e->data[i]);
+	silc_stack_block_free(stack, e->data[i]);
 	e->data[i] = NULL;
 	ret = TRUE;
       }
@@ -623,6 +826,59 @@ SilcBool silc_stack_purge(SilcStack stack)
   return ret;
 }
 
+/* Enable memory mapped block backing */
+
+SilcBool silc_stack_set_mmap(SilcStack stack, SilcUInt32 prefault_bytes)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+  SilcStack root;
+
+  if (!stack)
+    return FALSE;
+
+  SILC_STACK_ROOT(stack, root);
+  root->use_mmap = TRUE;
+  root->prefault = prefault_bytes;
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* HAVE_SYS_MMAN_H && MAP_ANONYMOUS */
+}
+
+/* Return stack statistics */
+
+SilcBool silc_stack_get_stats(SilcStack stack, SilcStackStats stats)
+{
+  SilcUInt32 i;
+
+  if (!stack || !stats)
+    return FALSE;
+
+  silc_mutex_lock(stack->lock);
+
+  memset(stats, 0, sizeof(*stats));
+  stats->bytes_used = stack->susage;
+  stats->bytes_hwm = stack->shwm;
+  stats->num_parent_blocks = stack->snum_children;
+  stats->num_frames = stack->frame ? stack->frame->sp : 0;
+
+  for (i = 0; i < SILC_STACK_BLOCK_NUM; i++) {
+    if (!stack->stack->data[i])
+      continue;
+    stats->block_size[i] = SILC_STACK_BLOCK_SIZE(stack, i);
+    stats->block_used[i] = (SILC_STACK_BLOCK_SIZE(stack, i) -
+			    stack->stack->data[i]->bytes_left);
+    stats->bytes_total += stats->block_size[i];
+    stats->num_blocks++;
+  }
+
+  silc_mutex_unlock(stack->lock);
+
+  return TRUE;
+}
+
 /* Set global stack */
 
 void silc_stack_set_global(SilcStack stack)
@@ -640,6 +896,33 @@ void silc_stack_set_global(SilcStack stack)
   tls->stack = stack;
 }
 
+/* Return thread-specific default stack, creating it if needed */
+
+SilcStack silc_stack_tls(SilcUInt32 stack_size)
+{
+  SilcTls tls = silc_thread_get_tls();
+  SilcStack stack;
+
+  if (!tls) {
+    /* Try to initialize Tls */
+    tls = silc_thread_tls_init();
+    SILC_VERIFY(tls);
+    if (!tls)
+      return NULL;
+  }
+
+  if (tls->stack)
+    return tls->stack;
+
+  /* Create the default stack for this thread */
+  stack = silc_stack_alloc(stack_size, NULL);
+  if (!stack)
+    return NULL;
+  tls->stack = stack;
+
+  return stack;
+}
+
 /* Return global stack */
 
 SilcStack silc_stack_get_global(void)
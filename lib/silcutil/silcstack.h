@@ -250,6 +250,93 @@ SilcUInt32 silc_stack_push(SilcStack stack, SilcStackFrame *frame);
  ***/
 SilcUInt32 silc_stack_pop(SilcStack stack);
 
+/****s* silcutil/SilcStackCheckpoint
+ *
+ * NAME
+ *
+ *    typedef struct SilcStackCheckpointStruct SilcStackCheckpoint;
+ *
+ * DESCRIPTION
+ *
+ *    A checkpoint of the stack's allocation state, captured with
+ *    silc_stack_checkpoint and restored with silc_stack_rollback.  The
+ *    structure is allocated by the caller (usually on the C stack) and
+ *    its contents are internal.
+ *
+ * SOURCE
+ */
+typedef struct SilcStackCheckpointStruct {
+  SilcUInt32 sp;			      /* Internal */
+  SilcUInt32 si;			      /* Internal */
+  SilcUInt32 bytes_left;		      /* Internal */
+} SilcStackCheckpoint;
+/***/
+
+/****f* silcutil/silc_stack_checkpoint
+ *
+ * SYNOPSIS
+ *
+ *    void silc_stack_checkpoint(SilcStack stack,
+ *                               SilcStackCheckpoint *checkpoint);
+ *
+ * DESCRIPTION
+ *
+ *    Captures the stack's current allocation state into `checkpoint'
+ *    without pushing a frame.  Unlike silc_stack_push/silc_stack_pop,
+ *    checkpoints need no pairing: any number may be captured and each
+ *    may be rolled back (in any order back to front) or simply
+ *    forgotten.  Used for releasing a sub-parse's temporaries without
+ *    forcing the surrounding code into a frame structure.
+ *
+ ***/
+void silc_stack_checkpoint(SilcStack stack, SilcStackCheckpoint *checkpoint);
+
+/****f* silcutil/silc_stack_rollback
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_stack_rollback(SilcStack stack,
+ *                                 SilcStackCheckpoint *checkpoint);
+ *
+ * DESCRIPTION
+ *
+ *    Releases everything allocated from the stack after `checkpoint'
+ *    was captured.  The checkpoint is valid only at the same frame
+ *    depth it was captured at; rolling back across a push or pop fails
+ *    with FALSE and leaves the stack untouched.  The checkpoint may be
+ *    rolled back to repeatedly.
+ *
+ ***/
+SilcBool silc_stack_rollback(SilcStack stack,
+			     SilcStackCheckpoint *checkpoint);
+
+/****f* silcutil/silc_stack_promote
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_stack_promote(SilcStack stack, void *ptr,
+ *                                SilcUInt32 size);
+ *
+ * DESCRIPTION
+ *
+ *    Moves the latest allocation `ptr' of `size' bytes out of the
+ *    current frame so that the coming silc_stack_pop keeps it, without
+ *    copying it.  The allocation must be the latest made from the
+ *    stack.  Everything allocated before it in the same stack block is
+ *    retained with it until the enclosing frame pops; promote the
+ *    final result of a sub-parse, not intermediate values.  Returns
+ *    FALSE if `ptr' is not the latest allocation.
+ *
+ * EXAMPLE
+ *
+ *    silc_stack_push(stack, NULL);
+ *    node = silc_foo_parse_subtree(stack);     // temps + final node
+ *    silc_stack_promote(stack, node, sizeof(*node));
+ *    silc_stack_pop(stack);                    // node survives
+ *
+ ***/
+SilcBool silc_stack_promote(SilcStack stack, void *ptr, SilcUInt32 size);
+
 /****f* silcutil/silc_stack_malloc
  *
  * SYNOPSIS
@@ -405,6 +492,124 @@ SilcBool silc_stack_purge(SilcStack stack);
  ***/
 void silc_stack_set_global(SilcStack stack);
 
+/****f* silcutil/silc_stack_set_mmap
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_stack_set_mmap(SilcStack stack,
+ *                                 SilcUInt32 prefault_bytes);
+ *
+ * DESCRIPTION
+ *
+ *    Backs new stack blocks of the `stack' (the root stack of a child
+ *    stack) with anonymous memory mappings instead of heap allocations.
+ *    Huge pages are used when the system provides them (MAP_HUGETLB, or
+ *    transparent huge pages advised with madvise), reducing TLB pressure
+ *    of large stacks, and each new block is prefaulted up to
+ *    `prefault_bytes' so steady-state stack allocations do not take page
+ *    faults.  Blocks allocated before this call keep their original
+ *    backing.  Returns FALSE if memory mapping is not supported on the
+ *    platform.
+ *
+ ***/
+SilcBool silc_stack_set_mmap(SilcStack stack, SilcUInt32 prefault_bytes);
+
+/****s* silcutil/SilcStackStats
+ *
+ * NAME
+ *
+ *    typedef struct SilcStackStatsStruct { ... }
+ *                     *SilcStackStats, SilcStackStatsStruct;
+ *
+ * DESCRIPTION
+ *
+ *    SilcStack statistics returned by the silc_stack_get_stats.
+ *
+ * SOURCE
+ */
+#define SILC_STACK_STATS_BLOCKS 21	  /* Number of stack block slots */
+
+typedef struct SilcStackStatsStruct {
+  SilcUInt32 bytes_total;		  /* Total size of all blocks */
+  SilcUInt32 bytes_used;		  /* Bytes currently in use */
+  SilcUInt32 bytes_hwm;			  /* Usage high watermark */
+  SilcUInt32 num_blocks;		  /* Number of allocated blocks */
+  SilcUInt32 num_frames;		  /* Current frame depth */
+  SilcUInt32 num_parent_blocks;		  /* Blocks taken from the parent */
+  SilcUInt32 block_size[SILC_STACK_STATS_BLOCKS];  /* Size per block */
+  SilcUInt32 block_used[SILC_STACK_STATS_BLOCKS];  /* Used bytes per block */
+} *SilcStackStats, SilcStackStatsStruct;
+/***/
+
+/****f* silcutil/silc_stack_get_stats
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_stack_get_stats(SilcStack stack, SilcStackStats stats);
+ *
+ * DESCRIPTION
+ *
+ *    Returns usage statistics of the `stack' to `stats': the current and
+ *    peak bytes in use, the total size and per-block-index sizes and
+ *    usage of the allocated blocks, the current frame depth and the
+ *    number of blocks a child stack has taken from its parent.  This
+ *    makes it possible to size stacks from measured data instead of
+ *    guessing.  Returns FALSE on error.
+ *
+ ***/
+SilcBool silc_stack_get_stats(SilcStack stack, SilcStackStats stats);
+
+/****f* silcutil/silc_stack_tls
+ *
+ * SYNOPSIS
+ *
+ *    SilcStack silc_stack_tls(SilcUInt32 stack_size);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the calling thread's default stack, creating one of
+ *    `stack_size' bytes (0 for default size) if the thread does not have
+ *    a stack yet.  This gives every thread, for example thread pool
+ *    workers, an allocation-free default stack without plumbing a
+ *    SilcStack through every call; the returned stack is the same one
+ *    silc_stack_get_global returns.  The thread should free the stack
+ *    with silc_stack_free before it exits if it created one.
+ *
+ * EXAMPLE
+ *
+ *    // Allocation-free temporary memory in a worker thread
+ *    SilcStack stack = silc_stack_tls(0);
+ *    SILC_STACK_FRAME_BEGIN(stack);
+ *    buf = silc_smalloc(stack, 1024);
+ *    ...
+ *    SILC_STACK_FRAME_END(stack);
+ *
+ ***/
+SilcStack silc_stack_tls(SilcUInt32 stack_size);
+
+/****d* silcutil/SILC_STACK_FRAME_BEGIN
+ *
+ * NAME
+ *
+ *    #define SILC_STACK_FRAME_BEGIN(stack) ...
+ *    #define SILC_STACK_FRAME_END(stack) ...
+ *
+ * DESCRIPTION
+ *
+ *    Scoped stack frame helpers that pair silc_stack_push and
+ *    silc_stack_pop around a block of code.  Everything allocated from
+ *    the `stack' between SILC_STACK_FRAME_BEGIN and SILC_STACK_FRAME_END
+ *    is released at SILC_STACK_FRAME_END.  The frame structure lives on
+ *    the C stack, so the pair is allocation free.  The macros must be
+ *    used in the same scope.
+ *
+ * SOURCE
+ */
+#define SILC_STACK_FRAME_BEGIN(stack)		do {						  SilcStackFrame __silc_stack_frame;		  silc_stack_push((stack), &__silc_stack_frame)
+
+#define SILC_STACK_FRAME_END(stack)		  silc_stack_pop(stack);			} while(0)
+/***/
+
 /****f* silcutil/silc_stack_get_global
  *
  * SYNOPSIS
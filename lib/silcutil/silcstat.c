@@ -0,0 +1,362 @@
+/*
+
+  silcstat.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+/* Number of counter shards.  Each shard takes one cache line; a thread
+   updates the shard picked from its thread identity. */
+#define SILC_STAT_SHARDS 16
+
+/* One shard, padded to a cache line so neighbouring shards do not share
+   one.  SILC_ALIGNMENT is too small for this purpose; 64 bytes covers
+   the common line size. */
+typedef struct {
+  SilcAtomic64 value;
+  unsigned char pad[64 - sizeof(SilcAtomic64) > 0 ?
+		    64 - sizeof(SilcAtomic64) : 1];
+} SilcStatShardStruct;
+
+/* Statistics counter */
+struct SilcStatCounterStruct {
+  struct SilcStatCounterStruct *next;  /* Registration order list */
+  char *name;			       /* Counter name */
+  SilcStatShardStruct shard[SILC_STAT_SHARDS];
+};
+
+/* Counter registry */
+typedef struct {
+  SilcMutex lock;		       /* Registry lock */
+  SilcStatCounter head;		       /* Registration order */
+  SilcStatCounter tail;
+} *SilcStatRegistry;
+
+/* Returns the global registry, allocating it on first use */
+
+static SilcStatRegistry silc_stat_registry(void)
+{
+  SilcStatRegistry reg;
+
+  reg = silc_global_get_var("srtstat", FALSE);
+  if (!reg) {
+    reg = silc_global_set_var("srtstat", sizeof(*reg), NULL, FALSE);
+    if (!reg)
+      return NULL;
+    if (!silc_mutex_alloc(&reg->lock))
+      return NULL;
+  }
+
+  return reg;
+}
+
+/* Returns the calling thread's shard index */
+
+static SilcUInt32 silc_stat_shard(void)
+{
+  SilcUInt64 t = SILC_PTR_TO_64(silc_thread_self());
+
+  /* Mix the thread identity; pointers share low and high bits */
+  t ^= t >> 33;
+  t *= (SilcUInt64)0xff51afd7ed558ccdLL;
+  t ^= t >> 33;
+
+  return (SilcUInt32)t & (SILC_STAT_SHARDS - 1);
+}
+
+/* Register counter */
+
+SilcStatCounter silc_stat_register(const char *name)
+{
+  SilcStatRegistry reg = silc_stat_registry();
+  SilcStatCounter c;
+  int i;
+
+  if (!reg || !name)
+    return NULL;
+
+  silc_mutex_lock(reg->lock);
+
+  /* Return existing counter of the same name */
+  for (c = reg->head; c; c = c->next)
+    if (!strcmp(c->name, name)) {
+      silc_mutex_unlock(reg->lock);
+      return c;
+    }
+
+  c = silc_calloc(1, sizeof(*c));
+  if (!c) {
+    silc_mutex_unlock(reg->lock);
+    return NULL;
+  }
+
+  c->name = silc_strdup(name);
+  if (!c->name) {
+    silc_free(c);
+    silc_mutex_unlock(reg->lock);
+    return NULL;
+  }
+
+  for (i = 0; i < SILC_STAT_SHARDS; i++)
+    silc_atomic_init64(&c->shard[i].value, 0);
+
+  if (reg->tail)
+    reg->tail->next = c;
+  else
+    reg->head = c;
+  reg->tail = c;
+
+  silc_mutex_unlock(reg->lock);
+
+  SILC_LOG_DEBUG(("Registered stat counter '%s' %p", name, c));
+
+  return c;
+}
+
+/* Find counter by name */
+
+SilcStatCounter silc_stat_find(const char *name)
+{
+  SilcStatRegistry reg = silc_stat_registry();
+  SilcStatCounter c;
+
+  if (!reg || !name)
+    return NULL;
+
+  silc_mutex_lock(reg->lock);
+  for (c = reg->head; c; c = c->next)
+    if (!strcmp(c->name, name))
+      break;
+  silc_mutex_unlock(reg->lock);
+
+  return c;
+}
+
+/* Add to counter */
+
+void silc_stat_add(SilcStatCounter counter, SilcInt64 value)
+{
+  if (!counter)
+    return;
+  silc_atomic_add_int64(&counter->shard[silc_stat_shard()].value, value);
+}
+
+/* Increment counter */
+
+void silc_stat_inc(SilcStatCounter counter)
+{
+  silc_stat_add(counter, 1);
+}
+
+/* Sum shards */
+
+SilcUInt64 silc_stat_get(SilcStatCounter counter)
+{
+  SilcUInt64 sum = 0;
+  int i;
+
+  if (!counter)
+    return 0;
+
+  for (i = 0; i < SILC_STAT_SHARDS; i++)
+    sum += silc_atomic_get_int64(&counter->shard[i].value);
+
+  return sum;
+}
+
+/* Return counter name */
+
+const char *silc_stat_name(SilcStatCounter counter)
+{
+  return counter ? counter->name : NULL;
+}
+
+/* Enumerate counters */
+
+void silc_stat_foreach(SilcStatForeach foreach, void *context)
+{
+  SilcStatRegistry reg = silc_stat_registry();
+  SilcStatCounter c;
+
+  if (!reg || !foreach)
+    return;
+
+  /* Counters are never unregistered, so the list can be walked without
+     the lock once the head is read; only registration mutates it. */
+  silc_mutex_lock(reg->lock);
+  c = reg->head;
+  silc_mutex_unlock(reg->lock);
+
+  for (; c; c = c->next)
+    foreach(c, c->name, silc_stat_get(c), context);
+}
+
+/* Free all counters.  For leak-clean process shutdown; counters are
+   otherwise immortal.  The caller must make sure no thread updates
+   counters any more. */
+
+void silc_stat_uninit(void)
+{
+  SilcStatRegistry reg;
+  SilcStatCounter c, next;
+  int i;
+
+  reg = silc_global_get_var("srtstat", FALSE);
+  if (!reg)
+    return;
+
+  for (c = reg->head; c; c = next) {
+    next = c->next;
+    for (i = 0; i < SILC_STAT_SHARDS; i++)
+      silc_atomic_uninit64(&c->shard[i].value);
+    silc_free(c->name);
+    silc_free(c);
+  }
+
+  silc_mutex_free(reg->lock);
+  silc_global_del_var("srtstat", FALSE);
+}
+
+/***************************** Stats export ********************************/
+
+/* Export service context */
+typedef struct {
+  SilcSchedule schedule;
+  SilcNetListener listener;
+} *SilcStatExport;
+
+/* Renders one counter into the dump */
+
+static void silc_stat_export_foreach(SilcStatCounter counter,
+				     const char *name, SilcUInt64 value,
+				     void *context)
+{
+  SilcBuffer buf = context;
+  char line[192];
+  SilcUInt32 len;
+
+  len = silc_snprintf(line, sizeof(line), "stat %s %llu\n", name,
+		      (unsigned long long)value);
+  if (silc_buffer_taillen(buf) < len)
+    if (!silc_buffer_realloc(buf, silc_buffer_truelen(buf) + len + 1024))
+      return;
+  memcpy(buf->tail, line, len);
+  silc_buffer_pull_tail(buf, len);
+}
+
+/* Serves one monitoring request: any input triggers a full dump */
+
+static void silc_stat_export_io(SilcStream stream, SilcStreamStatus status,
+				void *context)
+{
+  SilcStatExport e = context;
+  SilcScheduleSnapshotStruct snap;
+  unsigned char tmp[256];
+  SilcBufferStruct buf;
+  char line[256];
+  SilcUInt32 len;
+  int ret;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  ret = silc_stream_read(stream, tmp, sizeof(tmp));
+  if (ret == 0 || ret == -2) {
+    silc_stream_destroy(stream);
+    return;
+  }
+  if (ret == -1)
+    return;
+
+  memset(&buf, 0, sizeof(buf));
+  if (!silc_buffer_realloc(&buf, 4096))
+    return;
+
+  /* Scheduler state */
+  silc_schedule_snapshot(e->schedule, &snap);
+  len = silc_snprintf(line, sizeof(line),
+		      "sched fd_tasks %u\nsched timeouts %u\n"
+		      "sched iterations %llu\nsched dispatched_fd %llu\n"
+		      "sched dispatched_timeout %llu\nsched wakeups %llu\n",
+		      snap.fd_tasks, snap.timeout_tasks,
+		      (unsigned long long)snap.iterations,
+		      (unsigned long long)snap.dispatched_fd,
+		      (unsigned long long)snap.dispatched_timeout,
+		      (unsigned long long)snap.wakeups);
+  memcpy(buf.tail, line, len);
+  silc_buffer_pull_tail(&buf, len);
+
+  /* All registered counters */
+  silc_stat_foreach(silc_stat_export_foreach, &buf);
+
+  if (silc_buffer_taillen(&buf) < 4)
+    silc_buffer_realloc(&buf, silc_buffer_truelen(&buf) + 4);
+  memcpy(buf.tail, "END\n", 4);
+  silc_buffer_pull_tail(&buf, 4);
+
+  silc_stream_write(stream, silc_buffer_data(&buf), silc_buffer_len(&buf));
+  silc_buffer_purge(&buf);
+}
+
+/* Accepts a monitoring connection */
+
+static void silc_stat_export_accept(SilcResult status, SilcStream stream,
+				    void *context)
+{
+  SilcStatExport e = context;
+
+  if (status != SILC_OK)
+    return;
+
+  silc_stream_set_notifier(stream, e->schedule, silc_stat_export_io, e);
+}
+
+/* Start statistics export service */
+
+SilcBool silc_stat_export_start(const char *filepath, SilcSchedule schedule)
+{
+  SilcStatExport e;
+
+  if (!filepath) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return FALSE;
+    }
+  }
+
+  e = silc_calloc(1, sizeof(*e));
+  if (!e)
+    return FALSE;
+
+  e->schedule = schedule;
+  e->listener = silc_local_net_create_listener(filepath, 0, schedule,
+					       silc_stat_export_accept, e);
+  if (!e->listener) {
+    silc_free(e);
+    return FALSE;
+  }
+
+  SILC_LOG_DEBUG(("Started stats export at %s", filepath));
+
+  return TRUE;
+}
@@ -0,0 +1,207 @@
+/*
+
+  silcstat.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Statistics Counter Interface
+ *
+ * DESCRIPTION
+ *
+ * Cheap named statistics counters for hot paths.  Each counter is
+ * sharded over several cache-line-sized slots; a thread updates the
+ * shard picked by its thread identity, so concurrent updates from
+ * different cores do not ping-pong one cache line the way a single
+ * shared atomic does.  Reading a counter sums the shards, making reads
+ * the expensive operation and updates the cheap one, which matches how
+ * statistics are used.
+ *
+ * Counters are registered by name and live until the process exits;
+ * monitoring code can enumerate all registered counters generically.
+ * All operations are thread safe.
+ *
+ ***/
+
+#ifndef SILCSTAT_H
+#define SILCSTAT_H
+
+/****s* silcutil/SilcStatCounter
+ *
+ * NAME
+ *
+ *    typedef struct SilcStatCounterStruct *SilcStatCounter;
+ *
+ * DESCRIPTION
+ *
+ *    A registered statistics counter, returned by silc_stat_register.
+ *
+ ***/
+typedef struct SilcStatCounterStruct *SilcStatCounter;
+
+/****f* silcutil/silc_stat_register
+ *
+ * SYNOPSIS
+ *
+ *    SilcStatCounter silc_stat_register(const char *name);
+ *
+ * DESCRIPTION
+ *
+ *    Registers statistics counter `name' and returns it.  If a counter
+ *    with the same name is already registered the existing counter is
+ *    returned, so modules sharing a counter name share the counter.
+ *    Returns NULL on memory allocation error.  The returned counter
+ *    cannot be freed; counters live until the process exits.
+ *
+ ***/
+SilcStatCounter silc_stat_register(const char *name);
+
+/****f* silcutil/silc_stat_find
+ *
+ * SYNOPSIS
+ *
+ *    SilcStatCounter silc_stat_find(const char *name);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the counter registered with `name' or NULL if no such
+ *    counter has been registered.
+ *
+ ***/
+SilcStatCounter silc_stat_find(const char *name);
+
+/****f* silcutil/silc_stat_add
+ *
+ * SYNOPSIS
+ *
+ *    void silc_stat_add(SilcStatCounter counter, SilcInt64 value);
+ *
+ * DESCRIPTION
+ *
+ *    Adds `value' (which may be negative) to the counter.  This is the
+ *    hot path operation: one atomic add to the calling thread's shard.
+ *
+ ***/
+void silc_stat_add(SilcStatCounter counter, SilcInt64 value);
+
+/****f* silcutil/silc_stat_inc
+ *
+ * SYNOPSIS
+ *
+ *    void silc_stat_inc(SilcStatCounter counter);
+ *
+ * DESCRIPTION
+ *
+ *    Increments the counter by one.
+ *
+ ***/
+void silc_stat_inc(SilcStatCounter counter);
+
+/****f* silcutil/silc_stat_get
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_stat_get(SilcStatCounter counter);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the current value of the counter by summing its shards.
+ *    The value is a consistent snapshot only in the absence of
+ *    concurrent updates; with concurrent updaters it is the exact value
+ *    the counter had at some instant during the call.
+ *
+ ***/
+SilcUInt64 silc_stat_get(SilcStatCounter counter);
+
+/****f* silcutil/silc_stat_name
+ *
+ * SYNOPSIS
+ *
+ *    const char *silc_stat_name(SilcStatCounter counter);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the name the counter was registered with.
+ *
+ ***/
+const char *silc_stat_name(SilcStatCounter counter);
+
+/****f* silcutil/SilcStatForeach
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcStatForeach)(SilcStatCounter counter,
+ *                                    const char *name, SilcUInt64 value,
+ *                                    void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Callback function given to silc_stat_foreach, called once for each
+ *    registered counter.
+ *
+ ***/
+typedef void (*SilcStatForeach)(SilcStatCounter counter, const char *name,
+				SilcUInt64 value, void *context);
+
+/****f* silcutil/silc_stat_foreach
+ *
+ * SYNOPSIS
+ *
+ *    void silc_stat_foreach(SilcStatForeach foreach, void *context);
+ *
+ * DESCRIPTION
+ *
+ *    Calls `foreach' for every registered counter, in registration
+ *    order, with the counter's name and current summed value.  Used by
+ *    monitoring and snapshot code to dump all statistics generically.
+ *
+ ***/
+void silc_stat_foreach(SilcStatForeach foreach, void *context);
+
+/****f* silcutil/silc_stat_uninit
+ *
+ * SYNOPSIS
+ *
+ *    void silc_stat_uninit(void);
+ *
+ * DESCRIPTION
+ *
+ *    Frees all registered counters and the registry, releasing the
+ *    shard atomics' resources.  Counters are otherwise immortal; call
+ *    this only at process shutdown, after every thread that updates
+ *    counters has stopped.  Registered counter handles become invalid.
+ *
+ ***/
+void silc_stat_uninit(void);
+
+/****f* silcutil/silc_stat_export_start
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_stat_export_start(const char *filepath,
+ *                                    SilcSchedule schedule);
+ *
+ * DESCRIPTION
+ *
+ *    Starts a statistics export service at the local network stream
+ *    listener `filepath'.  A monitoring client (the srtmon tool)
+ *    connects to it and each request it sends is answered with a text
+ *    dump of the scheduler snapshot and all registered counters,
+ *    terminated by an "END" line.  Returns FALSE on error.
+ *
+ ***/
+SilcBool silc_stat_export_start(const char *filepath, SilcSchedule schedule);
+
+#endif /* SILCSTAT_H */
@@ -95,6 +95,26 @@ typedef void (*SilcStreamNotifier)(SilcStream stream,
 				   SilcStreamStatus status,
 				   void *context);
 
+/****s* silcutil/SilcStreamIOVec
+ *
+ * NAME
+ *
+ *    typedef struct SilcStreamIOVecStruct { ... } SilcStreamIOVec;
+ *
+ * DESCRIPTION
+ *
+ *    An I/O vector segment for gather writing with silc_stream_writev.
+ *    An array of these describes the data segments to be written as one
+ *    logical write.
+ *
+ * SOURCE
+ */
+typedef struct SilcStreamIOVecStruct {
+  unsigned char *data;		/* Data segment */
+  SilcUInt32 data_len;		/* Length of the segment */
+} SilcStreamIOVec;
+/***/
+
 /****s* silcutil/SilcStreamOps
  *
  * NAME
@@ -154,6 +174,13 @@ typedef struct {
   /* This is called to return the associated scheduler, if set.  This is
      called when silc_stream_get_schedule was called. */
   SilcSchedule (*get_schedule)(SilcStream stream);
+
+  /* This is called to write a gather list of data segments to the stream
+     as one logical write.  This is called when silc_stream_writev function
+     was called.  This operation is optional; if it is NULL the
+     silc_stream_writev writes the segments with the write operation. */
+  int (*writev)(SilcStream stream, SilcStreamIOVec *iov,
+		SilcUInt32 iov_count);
 } SilcStreamOps;
 /***/
 
@@ -216,6 +243,99 @@ int silc_stream_write(SilcStream stream, const unsigned char *data,
   return h->ops->write(stream, data, data_len);
 }
 
+/****f* silcutil/silc_stream_writev
+ *
+ * SYNOPSIS
+ *
+ *    int silc_stream_writev(SilcStream stream, SilcStreamIOVec *iov,
+ *                           SilcUInt32 iov_count);
+ *
+ * DESCRIPTION
+ *
+ *    Writes the `iov_count' data segments in the gather list `iov' to the
+ *    stream indicated by `stream' as one logical write, without coalescing
+ *    the segments into one buffer.  Returns the total amount of data
+ *    written, zero (0) if end of stream occurred, -1 if data could not be
+ *    written at this moment, or -2 if error occurred.  If -1 is returned
+ *    the notifier callback will later be called with SILC_STREAM_CAN_WRITE
+ *    status when stream is again ready for writing.  Note that less data
+ *    than the sum of the segment lengths may be written.
+ *
+ *    If the stream implementation does not support gather writing the
+ *    segments are written with consecutive silc_stream_write calls.
+ *
+ *    If error occurred the error code can be retrieved with silc_errno.
+ *
+ ***/
+static inline
+int silc_stream_writev(SilcStream stream, SilcStreamIOVec *iov,
+		       SilcUInt32 iov_count)
+{
+  SilcStreamHeader h = stream;
+  int ret, total = 0;
+  SilcUInt32 i;
+
+  if (h->ops->writev)
+    return h->ops->writev(stream, iov, iov_count);
+
+  /* Emulate with consecutive writes */
+  for (i = 0; i < iov_count; i++) {
+    ret = h->ops->write(stream, iov[i].data, iov[i].data_len);
+    if (ret <= 0) {
+      if (total)
+	return total;
+      return ret;
+    }
+    total += ret;
+    if ((SilcUInt32)ret < iov[i].data_len)
+      break;
+  }
+
+  return total;
+}
+
+/****f* silcutil/silc_stream_write_chain
+ *
+ * SYNOPSIS
+ *
+ *    int silc_stream_write_chain(SilcStream stream, SilcBufferChain chain);
+ *
+ * DESCRIPTION
+ *
+ *    Writes the segments of the buffer chain `chain' to the stream
+ *    `stream' as a gather list with silc_stream_writev, and pulls the
+ *    written data from the chain, freeing fully written segments.  The
+ *    return values are those of silc_stream_writev; after a partial
+ *    write or -1 the remaining data stays in the chain and this can be
+ *    called again when the stream is writable.
+ *
+ ***/
+static inline
+int silc_stream_write_chain(SilcStream stream, SilcBufferChain chain)
+{
+  SilcStreamIOVec iov[32];
+  SilcBufferChainEntry e;
+  SilcUInt32 count = 0;
+  int ret;
+
+  for (e = chain->head; e && count < 32; e = e->next) {
+    if (!silc_buffer_len(e->buffer))
+      continue;
+    iov[count].data = silc_buffer_data(e->buffer);
+    iov[count].data_len = silc_buffer_len(e->buffer);
+    count++;
+  }
+
+  if (!count)
+    return 0;
+
+  ret = silc_stream_writev(stream, iov, count);
+  if (ret > 0)
+    silc_buffer_chain_pull(chain, ret, TRUE);
+
+  return ret;
+}
+
 /****f* silcutil/silc_stream_close
  *
  * SYNOPSIS
@@ -138,6 +138,57 @@ const Stringprep_profile stringprep_silc_casefold_prep[] =
 };
 
 
+/* ASCII fast path.  All four profiles are, over plain ASCII, just a
+   lowercasing pass plus per-profile prohibited characters: the B.1/B.2
+   mapping tables only lowercase in this range, NFKC is the identity, and
+   of the prohibit tables only C.1.1 (space), C.2.1 (controls) and our
+   Appendix C reach below 0x80.  Handles the string without touching the
+   rfc3454 tables; returns -1 if the input is not plain ASCII and the
+   general path must run. */
+
+static int silc_stringprep_ascii(const unsigned char *bin, SilcUInt32 bin_len,
+				 const char *profile_name,
+				 unsigned char **out, SilcUInt32 *out_len)
+{
+  SilcBool prohibit_sp = FALSE, prohibit_silc = FALSE;
+  unsigned char *s, c;
+  SilcUInt32 i;
+
+  if (!strcmp(profile_name, SILC_IDENTIFIER_PREP))
+    prohibit_sp = prohibit_silc = TRUE;
+  else if (!strcmp(profile_name, SILC_IDENTIFIER_CH_PREP))
+    prohibit_sp = TRUE;
+  else if (strcmp(profile_name, SILC_IDENTIFIERC_PREP) &&
+	   strcmp(profile_name, SILC_CASEFOLD_PREP))
+    return -1;
+
+  for (i = 0; i < bin_len; i++) {
+    c = bin[i];
+    if (c & 0x80)
+      return -1;
+    if (c < 0x20 || c == 0x7f)
+      return SILC_STRINGPREP_ERR_PROHIBITED;
+    if (prohibit_sp && c == ' ')
+      return SILC_STRINGPREP_ERR_PROHIBITED;
+    if (prohibit_silc && (c == '!' || c == '*' || c == ',' ||
+			  c == '?' || c == '@'))
+      return SILC_STRINGPREP_ERR_PROHIBITED;
+  }
+
+  if (out && out_len) {
+    s = silc_malloc(bin_len + 1);
+    if (!s)
+      return SILC_STRINGPREP_ERR_OUT_OF_MEMORY;
+    for (i = 0; i < bin_len; i++)
+      s[i] = bin[i] >= 'A' && bin[i] <= 'Z' ? bin[i] + 32 : bin[i];
+    s[bin_len] = '\0';
+    *out = s;
+    *out_len = bin_len;
+  }
+
+  return SILC_STRINGPREP_OK;
+}
+
 /* Prepares string according to the profile */
 
 SilcStringprepStatus
@@ -152,6 +203,8 @@ silc_stringprep(const unsigned char *bin, SilcUInt32 bin_len,
   const Stringprep_profile *profile;
   unsigned char *utf8s;
   SilcUInt32 utf8s_len;
+  SilcStack stack = silc_stack_tls(0);
+  SilcStackFrame frame;
   int ret;
 
   SILC_LOG_DEBUG(("Preparing string"));
@@ -159,13 +212,25 @@ silc_stringprep(const unsigned char *bin, SilcUInt32 bin_len,
   if (!bin || !bin_len || !profile_name)
     return SILC_STRINGPREP_ERR;
 
-  /* Convert string to UTF-8 */
+  /* Plain ASCII input needs no table work at all */
+  if (bin_encoding == SILC_STRING_ASCII || bin_encoding == SILC_STRING_UTF8 ||
+      bin_encoding == SILC_STRING_LOCALE) {
+    ret = silc_stringprep_ascii(bin, bin_len, profile_name, out, out_len);
+    if (ret != -1)
+      return (SilcStringprepStatus)ret;
+  }
+
+  /* Convert string to UTF-8.  The work buffer lives in the thread's
+     stack; only the final result is heap allocated for the caller. */
   utf8s_len = silc_utf8_encoded_len(bin, bin_len, bin_encoding);
   if (!utf8s_len)
     return SILC_STRINGPREP_ERR_ENCODING;
-  utf8s = silc_calloc(utf8s_len + 1, sizeof(*utf8s));
-  if (!utf8s)
+  silc_stack_push(stack, &frame);
+  utf8s = silc_scalloc(stack, utf8s_len + 1, sizeof(*utf8s));
+  if (!utf8s) {
+    silc_stack_pop(stack);
     return SILC_STRINGPREP_ERR_OUT_OF_MEMORY;
+  }
   silc_utf8_encode(bin, bin_len, bin_encoding, utf8s, utf8s_len);
 
   /* Check profile. */
@@ -177,8 +242,10 @@ silc_stringprep(const unsigned char *bin, SilcUInt32 bin_len,
     profile = stringprep_silc_identifierc_prep;
   else if (!strcmp(profile_name, SILC_CASEFOLD_PREP))
     profile = stringprep_silc_casefold_prep;
-  else
+  else {
+    silc_stack_pop(stack);
     return SILC_STRINGPREP_ERR_UNSUP_PROFILE;
+  }
 
   /* Translate flags */
   if (!(flags & SILC_STRINGPREP_ALLOW_UNASSIGNED))
@@ -193,9 +260,12 @@ silc_stringprep(const unsigned char *bin, SilcUInt32 bin_len,
      much space we must have for the conversion.  Allocate more if it
      fails, and try again. */
   if (ret == STRINGPREP_TOO_SMALL_BUFFER) {
-    utf8s = silc_realloc(utf8s, sizeof(*utf8s) * ((utf8s_len * 2) + 1));
-    if (!utf8s)
+    utf8s = silc_srealloc(stack, utf8s_len + 1, utf8s,
+			  sizeof(*utf8s) * ((utf8s_len * 2) + 1));
+    if (!utf8s) {
+      silc_stack_pop(stack);
       return SILC_STRINGPREP_ERR_OUT_OF_MEMORY;
+    }
     memset(utf8s + utf8s_len + 1, 0, utf8s_len);
     ret = stringprep((char *)utf8s, utf8s_len * 2, f, profile);
     SILC_LOG_DEBUG(("stringprep() return %d", ret));
@@ -262,7 +332,7 @@ silc_stringprep(const unsigned char *bin, SilcUInt32 bin_len,
     }
   }
 
-  silc_free(utf8s);
+  silc_stack_pop(stack);
 
   return (SilcStringprepStatus)ret;
 }
@@ -247,11 +247,33 @@ char *silc_string_regex_combine(const char *string1, const char *string2)
   return tmp;
 }
 
+/* Compiled pattern cache entry for silc_string_match */
+typedef struct {
+  SilcRegexStruct reg;		       /* Compiled pattern */
+  char *pattern;		       /* The original pattern */
+} *SilcStringMatchCacheEntry;
+
+/* Maximum number of cached compiled patterns per thread */
+#define SILC_STRING_MATCH_CACHE_MAX 64
+
+/* Cache entry destructor */
+
+static void silc_string_match_cache_destructor(void *key, void *context,
+					       void *user_context)
+{
+  SilcStringMatchCacheEntry e = context;
+  silc_regex_free(&e->reg);
+  silc_free(e->pattern);
+  silc_free(e);
+}
+
 /* Do regex match to the two strings `string1' and `string2'. If the
    `string2' matches the `string1' this returns TRUE. */
 
 int silc_string_match(const char *string1, const char *string2)
 {
+  SilcHashTable *cache;
+  SilcStringMatchCacheEntry e;
   char *s1;
   int ret = FALSE;
 
@@ -260,9 +282,133 @@ int silc_string_match(const char *string1, const char *string2)
     return ret;
   }
 
+  /* Serve the compiled pattern from the per-thread cache; matching the
+     same patterns repeatedly no longer compiles per call. */
+  cache = silc_global_get_var("srtsmcache", TRUE);
+  if (!cache)
+    cache = silc_global_set_var("srtsmcache", sizeof(*cache), NULL, TRUE);
+  if (cache && !*cache)
+    *cache = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+				   silc_hash_string_compare, NULL,
+				   silc_string_match_cache_destructor,
+				   NULL, TRUE);
+
+  if (cache && *cache &&
+      silc_hash_table_find(*cache, (void *)string1, NULL, (void *)&e))
+    return silc_regex_match(&e->reg, string2, strlen(string2), 0, NULL, 0);
+
+  e = silc_calloc(1, sizeof(*e));
+  if (e) {
+    e->pattern = silc_strdup(string1);
+
+    s1 = silc_string_regexify(string1);
+    if (!s1 || !e->pattern || !silc_regex_compile(&e->reg, s1, 0)) {
+      silc_free(s1);
+      silc_free(e->pattern);
+      silc_free(e);
+      return FALSE;
+    }
+    silc_free(s1);
+
+    ret = silc_regex_match(&e->reg, string2, strlen(string2), 0, NULL, 0);
+
+    if (cache && *cache) {
+      /* Flush the cache when it fills; the hot patterns re-enter */
+      if (silc_hash_table_count(*cache) >= SILC_STRING_MATCH_CACHE_MAX) {
+	silc_hash_table_free(*cache);
+	*cache = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+				       silc_hash_string_compare, NULL,
+				       silc_string_match_cache_destructor,
+				       NULL, TRUE);
+      }
+      if (*cache &&
+	  silc_hash_table_add(*cache, e->pattern, e))
+	return ret;
+    }
+
+    /* Not cached */
+    silc_regex_free(&e->reg);
+    silc_free(e->pattern);
+    silc_free(e);
+    return ret;
+  }
+
+  /* Fallback without caching */
   s1 = silc_string_regexify(string1);
   ret = silc_string_regex_match(s1, string2);
   silc_free(s1);
 
   return ret;
 }
+
+/****************************** Tokenizer ***********************************/
+
+/* Init tokenizer */
+
+void silc_tokenizer_init(SilcTokenizer tokenizer, const char *string,
+			 SilcUInt32 string_len, const char *delims)
+{
+  tokenizer->str = string;
+  tokenizer->len = string_len ? string_len :
+    (string ? strlen(string) : 0);
+  tokenizer->pos = 0;
+  tokenizer->delims = delims ? delims : " \t";
+}
+
+/* Return next token as a slice of the original string */
+
+SilcBool silc_tokenizer_next(SilcTokenizer tokenizer,
+			     const char **ret_token,
+			     SilcUInt32 *ret_token_len)
+{
+  const char *s = tokenizer->str;
+  SilcUInt32 i = tokenizer->pos, len = tokenizer->len;
+
+  if (!s)
+    return FALSE;
+
+  /* Skip leading delimiters */
+  while (i < len && strchr(tokenizer->delims, s[i]))
+    i++;
+  if (i >= len) {
+    tokenizer->pos = len;
+    return FALSE;
+  }
+
+  if (ret_token)
+    *ret_token = s + i;
+
+  while (i < len && !strchr(tokenizer->delims, s[i]))
+    i++;
+
+  if (ret_token_len)
+    *ret_token_len = (SilcUInt32)((s + i) - *ret_token);
+
+  tokenizer->pos = i;
+
+  return TRUE;
+}
+
+/* Return next token as a NUL terminated copy from `stack' */
+
+char *silc_tokenizer_next_s(SilcTokenizer tokenizer, SilcStack stack,
+			    SilcUInt32 *ret_token_len)
+{
+  const char *token;
+  SilcUInt32 len;
+  char *copy;
+
+  if (!silc_tokenizer_next(tokenizer, &token, &len))
+    return NULL;
+
+  copy = silc_smalloc(stack, len + 1);
+  if (!copy)
+    return NULL;
+  memcpy(copy, token, len);
+  copy[len] = '\0';
+
+  if (ret_token_len)
+    *ret_token_len = len;
+
+  return copy;
+}
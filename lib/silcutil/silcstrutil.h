@@ -142,4 +142,91 @@ int silc_string_compare(char *string1, char *string2);
  ***/
 char **silc_string_split(const char *string, char ch, int *ret_count);
 
+/****s* silcutil/SilcTokenizer
+ *
+ * NAME
+ *
+ *    typedef struct SilcTokenizerStruct *SilcTokenizer, SilcTokenizerStruct;
+ *
+ * DESCRIPTION
+ *
+ *    Non-allocating string tokenizer.  Unlike silc_string_split the
+ *    tokenizer yields pointer and length slices over the original
+ *    string without copying or modifying it.  Initialized with
+ *    silc_tokenizer_init.
+ *
+ * EXAMPLE
+ *
+ *    SilcTokenizerStruct t;
+ *    const char *tok;
+ *    SilcUInt32 tok_len;
+ *
+ *    silc_tokenizer_init(&t, line, 0, " \t");
+ *    while (silc_tokenizer_next(&t, &tok, &tok_len))
+ *      ...
+ *
+ * SOURCE
+ */
+typedef struct SilcTokenizerStruct {
+  const char *str;		       /* The tokenized string */
+  const char *delims;		       /* Delimiter characters */
+  SilcUInt32 len;		       /* Length of the string */
+  SilcUInt32 pos;		       /* Current position */
+} *SilcTokenizer, SilcTokenizerStruct;
+/***/
+
+/****f* silcutil/silc_tokenizer_init
+ *
+ * SYNOPSIS
+ *
+ *    void silc_tokenizer_init(SilcTokenizer tokenizer, const char *string,
+ *                             SilcUInt32 string_len, const char *delims);
+ *
+ * DESCRIPTION
+ *
+ *    Initializes the tokenizer over `string' of `string_len' bytes (zero
+ *    to use strlen) with the delimiter characters `delims' (NULL for
+ *    whitespace).  The string is not copied and must stay valid while
+ *    tokens are used.
+ *
+ ***/
+void silc_tokenizer_init(SilcTokenizer tokenizer, const char *string,
+			 SilcUInt32 string_len, const char *delims);
+
+/****f* silcutil/silc_tokenizer_next
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_tokenizer_next(SilcTokenizer tokenizer,
+ *                                 const char **ret_token,
+ *                                 SilcUInt32 *ret_token_len);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the next token as a pointer into the original string and
+ *    its length, without allocating.  Returns FALSE when there are no
+ *    more tokens.
+ *
+ ***/
+SilcBool silc_tokenizer_next(SilcTokenizer tokenizer,
+			     const char **ret_token,
+			     SilcUInt32 *ret_token_len);
+
+/****f* silcutil/silc_tokenizer_next_s
+ *
+ * SYNOPSIS
+ *
+ *    char *silc_tokenizer_next_s(SilcTokenizer tokenizer, SilcStack stack,
+ *                                SilcUInt32 *ret_token_len);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_tokenizer_next but returns the token as a NUL terminated
+ *    copy allocated from `stack', for callers that genuinely need
+ *    terminated strings.  Returns NULL when there are no more tokens.
+ *
+ ***/
+char *silc_tokenizer_next_s(SilcTokenizer tokenizer, SilcStack stack,
+			    SilcUInt32 *ret_token_len);
+
 #endif /* SILCSTRUTIL_H */
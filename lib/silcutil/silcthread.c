@@ -19,6 +19,10 @@
 
 #include "silcruntime.h"
 
+#if defined(SILC_UNIX) && defined(HAVE_SCHED_SETAFFINITY)
+#include <sched.h>
+#endif
+
 /***************************** Thread Pool API *****************************/
 
 /* Explanation of the thread pool execution.
@@ -59,7 +63,15 @@ typedef struct SilcThreadPoolThreadStruct {
   SilcTaskCallback completion;	    /* The current Completion function */
   void *run_context;
   void *completion_context;
+  SilcUInt32 num_executed;	    /* Number of executed calls */
+  SilcUInt32 num_stolen;	    /* Calls stolen from other threads */
+  SilcUInt16 index;		    /* Worker index in the pool */
+  SilcUInt16 affinity_gen;	    /* Applied affinity generation */
+  struct timeval queued_time;	    /* When a queued call was queued */
+  SilcUInt8 prio_streak;	    /* Consecutive high priority picks */
   unsigned int stop        : 1;	    /* Set to stop the thread */
+  unsigned int high_prio   : 1;	    /* Queued call is high priority */
+  unsigned int retired     : 1;	    /* Stopping due to idle retirement */
 } *SilcThreadPoolThread;
 
 /* Thread pool context */
@@ -72,6 +84,14 @@ struct SilcThreadPoolStruct {
   SilcUInt16 min_threads;	    /* Minimum threads in the pool */
   SilcUInt16 max_threads;	    /* Maximum threads in the pool */
   SilcUInt16 refcnt;		    /* Reference counter */
+  SilcUInt32 num_queued;	    /* Calls queued past busy threads */
+  SilcUInt32 *cpus;		    /* Processors to pin workers to */
+  SilcUInt32 num_cpus;		    /* Number of entries in cpus */
+  SilcUInt16 num_created;	    /* Number of created threads */
+  SilcUInt16 affinity_gen;	    /* Affinity setting generation */
+  SilcUInt32 wait_hist[5];	    /* Queue wait histogram */
+  SilcUInt32 idle_grace_ms;	    /* Idle retire grace period, 0 off */
+  SilcUInt32 num_retired;	    /* Workers retired when idle */
   unsigned int destroy       : 1;   /* Set when pool is to be destroyed */
 };
 
@@ -98,6 +118,7 @@ static void silc_thread_pool_unref(SilcThreadPool tp)
     silc_mutex_unlock(tp->lock);
     silc_mutex_free(tp->lock);
     silc_cond_free(tp->pool_signal);
+    silc_sfree(stack, tp->cpus);
     silc_sfree(stack, tp);
     silc_stack_free(stack);
     return;
@@ -105,6 +126,93 @@ static void silc_thread_pool_unref(SilcThreadPool tp)
   silc_mutex_unlock(tp->lock);
 }
 
+/* Applies the pool's processor affinity to the calling worker thread */
+
+static void silc_thread_pool_apply_affinity(SilcThreadPool tp,
+					    SilcThreadPoolThread t)
+{
+#if defined(SILC_UNIX) && defined(HAVE_SCHED_SETAFFINITY)
+  cpu_set_t set;
+
+  if (!tp->num_cpus)
+    return;
+
+  CPU_ZERO(&set);
+  CPU_SET(tp->cpus[t->index % tp->num_cpus], &set);
+  sched_setaffinity(0, sizeof(set), &set);
+#endif /* SILC_UNIX && HAVE_SCHED_SETAFFINITY */
+}
+
+/* Number of consecutive high priority picks before a low priority call
+   is taken even when high priority calls are queued, preventing
+   starvation. */
+#define SILC_THREAD_POOL_PRIO_STREAK 8
+
+/* Records the queue wait time of a dequeued call to the pool's
+   histogram.  Buckets: <1ms, <10ms, <100ms, <1s, >=1s. */
+
+static void silc_thread_pool_record_wait(SilcThreadPool tp,
+					 struct timeval *queued)
+{
+  struct timeval now;
+  SilcUInt64 usec;
+
+  if (!queued->tv_sec && !queued->tv_usec)
+    return;
+
+  silc_gettimeofday(&now);
+  usec = ((SilcUInt64)(now.tv_sec - queued->tv_sec) * 1000000 +
+	  (now.tv_usec - queued->tv_usec));
+
+  if (usec < 1000)
+    tp->wait_hist[0]++;
+  else if (usec < 10000)
+    tp->wait_hist[1]++;
+  else if (usec < 100000)
+    tp->wait_hist[2]++;
+  else if (usec < 1000000)
+    tp->wait_hist[3]++;
+  else
+    tp->wait_hist[4]++;
+}
+
+/* Picks the next call from the queue of `t', preferring high priority
+   calls but taking a low priority one after a streak of high priority
+   picks so bulk work cannot be starved.  Must be called with the
+   thread's lock held; returns NULL if the queue is empty. */
+
+static SilcThreadPoolThread silc_thread_pool_pick(SilcThreadPoolThread from,
+						  SilcThreadPoolThread t)
+{
+  SilcThreadPoolThread q, high = NULL, low = NULL;
+
+  silc_list_start(from->queue);
+  while ((q = silc_list_get(from->queue))) {
+    if (q->high_prio && !high)
+      high = q;
+    if (!q->high_prio)
+      low = q;	  /* Oldest low priority is last in the LIFO list */
+    if (high && low)
+      break;
+  }
+
+  if (high && (!low || t->prio_streak < SILC_THREAD_POOL_PRIO_STREAK)) {
+    t->prio_streak++;
+    q = high;
+  } else {
+    t->prio_streak = 0;
+    q = low ? low : high;
+  }
+
+  if (q) {
+    silc_thread_pool_record_wait(from->tp, &q->queued_time);
+    silc_list_del(from->queue, q);
+    silc_list_add(from->free_queue, q);
+  }
+
+  return q;
+}
+
 /* The thread executor.  Each thread in the pool is run here.  They wait
    here for something to do which is given to them by silc_thread_pool_run. */
 
@@ -118,19 +226,53 @@ static void *silc_thread_pool_run_thread(void *context)
   silc_mutex_lock(lock);
 
   while (1) {
+    /* Apply processor affinity if it has changed */
+    if (silc_unlikely(t->affinity_gen != tp->affinity_gen)) {
+      t->affinity_gen = tp->affinity_gen;
+      silc_thread_pool_apply_affinity(tp, t);
+    }
+
     /* Wait here for code to execute */
-    while (!t->run && !t->stop)
-      silc_cond_wait(thread_signal, lock);
+    while (!t->run && !t->stop) {
+      if (!tp->idle_grace_ms) {
+	silc_cond_wait(thread_signal, lock);
+	continue;
+      }
 
-    if (t->stop)
-      goto stop;
+      silc_cond_timedwait(thread_signal, lock, tp->idle_grace_ms);
+      if (t->run || t->stop)
+	break;
+
+      /* Idle past the grace period; retire if the pool is above its
+	 minimum.  The count is read unlocked, so several idle workers
+	 retiring at once can briefly undershoot the minimum, which the
+	 on-demand spawn corrects. */
+      if (silc_list_count(tp->threads) > tp->min_threads) {
+	t->stop = TRUE;
+	t->retired = TRUE;
+      }
+    }
+
+    if (t->stop) {
+      if (t->retired && t->run) {
+	/* A call was assigned between the retire decision and now;
+	   stay alive and run it. */
+	t->stop = FALSE;
+	t->retired = FALSE;
+      } else {
+	goto stop;
+      }
+    }
 
     /* Execute code */
     silc_mutex_unlock(lock);
   execute:
     SILC_LOG_DEBUG(("Execute call %p, context %p, thread %p", t->run,
 		    t->run_context, t));
+    t->num_executed++;
+    SILC_TRACE2(thread_pool_start, t, t->run);
     t->run(t->schedule, t->run_context);
+    SILC_TRACE2(thread_pool_finish, t, t->run);
 
     /* If scheduler is NULL, call completion directly from here.  Otherwise
        it is called through the scheduler in the thread where the scheduler
@@ -158,8 +300,7 @@ static void *silc_thread_pool_run_thread(void *context)
        call since new ones are added at the start of the list. */
     if (silc_list_count(t->queue) > 0) {
     execute_queue:
-      silc_list_start(t->queue);
-      q = silc_list_get(t->queue);
+      q = silc_thread_pool_pick(t, t);
 
       SILC_LOG_DEBUG(("Execute call from queue"));
 
@@ -170,8 +311,6 @@ static void *silc_thread_pool_run_thread(void *context)
       t->completion_context = q->completion_context;
       t->schedule = q->schedule;
 
-      silc_list_del(t->queue, q);
-      silc_list_add(t->free_queue, q);
       silc_mutex_unlock(lock);
       goto execute;
     }
@@ -196,11 +335,12 @@ static void *silc_thread_pool_run_thread(void *context)
 
     if (o) {
       silc_mutex_unlock(tp->lock);
-      silc_list_start(o->queue);
-      q = silc_list_get(o->queue);
+      q = silc_thread_pool_pick(o, t);
 
       SILC_LOG_DEBUG(("Execute call from queue from thread %p", o));
 
+      t->num_stolen++;
+
       /* Execute this call now */
       t->run = q->run;
       t->run_context = q->run_context;
@@ -208,8 +348,6 @@ static void *silc_thread_pool_run_thread(void *context)
       t->completion_context = q->completion_context;
       t->schedule = q->schedule;
 
-      silc_list_del(o->queue, q);
-      silc_list_add(o->free_queue, q);
       silc_mutex_unlock(o->lock);
       goto execute;
     }
@@ -244,7 +382,12 @@ static void *silc_thread_pool_run_thread(void *context)
   silc_mutex_lock(tp->lock);
 
   silc_list_del(tp->threads, t);
+  silc_list_del(tp->free_threads, t);
   silc_list_start(tp->threads);
+  if (t->retired) {
+    tp->num_retired++;
+    SILC_LOG_DEBUG(("Thread %p retired idle", t));
+  }
 
   /* Clear thread's call queue. */
   silc_list_start(t->queue);
@@ -291,6 +434,7 @@ static SilcThreadPoolThread silc_thread_pool_new_thread(SilcThreadPool tp)
   }
 
   t->tp = tp;
+  t->index = tp->num_created++;
   silc_list_init(t->queue, struct SilcThreadPoolThreadStruct, next);
   silc_list_init(t->free_queue, struct SilcThreadPoolThreadStruct, next);
 
@@ -403,13 +547,14 @@ void silc_thread_pool_free(SilcThreadPool tp, SilcBool wait_unfinished)
 
 /* Execute code in a thread in the pool */
 
-SilcBool silc_thread_pool_run(SilcThreadPool tp,
-			      SilcBool queuable,
-			      SilcSchedule schedule,
-			      SilcThreadPoolFunc run,
-			      void *run_context,
-			      SilcTaskCallback completion,
-			      void *completion_context)
+SilcBool silc_thread_pool_run_prio(SilcThreadPool tp,
+				   SilcBool queuable,
+				   SilcBool high_priority,
+				   SilcSchedule schedule,
+				   SilcThreadPoolFunc run,
+				   void *run_context,
+				   SilcTaskCallback completion,
+				   void *completion_context)
 {
   SilcThreadPoolThread t, q;
 
@@ -421,6 +566,7 @@ SilcBool silc_thread_pool_run(SilcThreadPool tp,
     return FALSE;
   }
 
+ again:
   /* Get free thread */
   silc_list_start(tp->free_threads);
   t = silc_list_get(tp->free_threads);
@@ -466,10 +612,17 @@ SilcBool silc_thread_pool_run(SilcThreadPool tp,
       q->completion = completion;
       q->completion_context = completion_context;
       q->schedule = schedule;
+      q->high_prio = high_priority;
+      silc_gettimeofday(&q->queued_time);
 
       /* Add at the start of the list.  It gets executed first. */
       silc_list_insert(t->queue, NULL, q);
       silc_mutex_unlock(t->lock);
+
+      silc_mutex_lock(tp->lock);
+      tp->num_queued++;
+      silc_mutex_unlock(tp->lock);
+      SILC_TRACE2(thread_pool_enqueue, tp, run);
       return TRUE;
     } else {
       /* Create new thread */
@@ -488,6 +641,14 @@ SilcBool silc_thread_pool_run(SilcThreadPool tp,
 
   silc_mutex_lock(t->lock);
 
+  if (silc_unlikely(t->stop)) {
+    /* The thread retired between the free list pop and here; pick
+       another one. */
+    silc_mutex_unlock(t->lock);
+    silc_mutex_lock(tp->lock);
+    goto again;
+  }
+
   /* Mark this call to be executed in this thread */
   t->run = run;
   t->run_context = run_context;
@@ -502,6 +663,41 @@ SilcBool silc_thread_pool_run(SilcThreadPool tp,
   return TRUE;
 }
 
+/* Run call in a thread, normal priority */
+
+SilcBool silc_thread_pool_run(SilcThreadPool tp,
+			      SilcBool queuable,
+			      SilcSchedule schedule,
+			      SilcThreadPoolFunc run,
+			      void *run_context,
+			      SilcTaskCallback completion,
+			      void *completion_context)
+{
+  return silc_thread_pool_run_prio(tp, queuable, FALSE, schedule, run,
+				   run_context, completion,
+				   completion_context);
+}
+
+/* Set idle worker retirement */
+
+void silc_thread_pool_set_autoscale(SilcThreadPool tp,
+				    SilcUInt32 idle_grace_ms)
+{
+  SilcThreadPoolThread t;
+
+  SILC_LOG_DEBUG(("Set thread pool %p idle grace to %u ms", tp,
+		  idle_grace_ms));
+
+  silc_mutex_lock(tp->lock);
+  tp->idle_grace_ms = idle_grace_ms;
+
+  /* Wake idle workers so they pick up the new grace period */
+  silc_list_start(tp->free_threads);
+  while ((t = silc_list_get(tp->free_threads)))
+    silc_cond_signal(t->thread_signal);
+  silc_mutex_unlock(tp->lock);
+}
+
 /* Set maximum threads in the pool */
 
 void silc_thread_pool_set_max_threads(SilcThreadPool tp,
@@ -516,6 +712,186 @@ void silc_thread_pool_set_max_threads(SilcThreadPool tp,
 
 /* Get maximum threads in the pool */
 
+/* Set processor affinity for pool workers */
+
+SilcBool silc_thread_pool_set_affinity(SilcThreadPool tp,
+				       const SilcUInt32 *cpus,
+				       SilcUInt32 num_cpus)
+{
+#if defined(SILC_UNIX) && defined(HAVE_SCHED_SETAFFINITY)
+  SilcUInt32 *c = NULL;
+  SilcThreadPoolThread t;
+
+  if (num_cpus) {
+    c = silc_scalloc(tp->stack, num_cpus, sizeof(*c));
+    if (!c)
+      return FALSE;
+    memcpy(c, cpus, num_cpus * sizeof(*c));
+  }
+
+  silc_mutex_lock(tp->lock);
+
+  silc_sfree(tp->stack, tp->cpus);
+  tp->cpus = c;
+  tp->num_cpus = num_cpus;
+  tp->affinity_gen++;
+
+  /* Wake idle workers so they apply the new affinity */
+  silc_list_start(tp->threads);
+  while ((t = silc_list_get(tp->threads)))
+    silc_cond_signal(t->thread_signal);
+
+  silc_mutex_unlock(tp->lock);
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* SILC_UNIX && HAVE_SCHED_SETAFFINITY */
+}
+
+/* Run call in a specific pool worker */
+
+SilcBool silc_thread_pool_run_on(SilcThreadPool tp, SilcUInt32 index,
+				 SilcSchedule schedule,
+				 SilcThreadPoolFunc run,
+				 void *run_context,
+				 SilcTaskCallback completion,
+				 void *completion_context)
+{
+  SilcThreadPoolThread t, q;
+
+  silc_mutex_lock(tp->lock);
+
+  if (tp->destroy) {
+    silc_mutex_unlock(tp->lock);
+    silc_set_errno(SILC_ERR_NOT_VALID);
+    return FALSE;
+  }
+
+  if (index >= tp->max_threads) {
+    silc_mutex_unlock(tp->lock);
+    silc_set_errno(SILC_ERR_LIMIT);
+    return FALSE;
+  }
+
+  /* Create workers up to the wanted index */
+  while (tp->num_created <= index)
+    if (!silc_thread_pool_new_thread(tp)) {
+      silc_mutex_unlock(tp->lock);
+      return FALSE;
+    }
+
+  /* Find the worker */
+  silc_list_start(tp->threads);
+  while ((t = silc_list_get(tp->threads)))
+    if (t->index == index)
+      break;
+  if (!t || t->stop) {
+    silc_mutex_unlock(tp->lock);
+    silc_set_errno(SILC_ERR_NOT_FOUND);
+    return FALSE;
+  }
+
+  silc_list_del(tp->free_threads, t);
+  silc_mutex_unlock(tp->lock);
+
+  SILC_LOG_DEBUG(("Run call %p, context %p on thread %p (%d)", run,
+		  run_context, t, index));
+
+  silc_mutex_lock(t->lock);
+
+  if (!t->run) {
+    /* Worker is idle, run directly */
+    t->run = run;
+    t->run_context = run_context;
+    t->completion = completion;
+    t->completion_context = completion_context;
+    t->schedule = schedule;
+    silc_cond_signal(t->thread_signal);
+    silc_mutex_unlock(t->lock);
+    return TRUE;
+  }
+
+  /* Worker is busy, queue to its queue */
+  silc_list_start(t->free_queue);
+  q = silc_list_get(t->free_queue);
+  if (!q) {
+    q = silc_scalloc(tp->stack, 1, sizeof(*q));
+    if (!q) {
+      silc_mutex_unlock(t->lock);
+      return FALSE;
+    }
+  } else {
+    silc_list_del(t->free_queue, q);
+  }
+
+  q->run = run;
+  q->run_context = run_context;
+  q->completion = completion;
+  q->completion_context = completion_context;
+  q->schedule = schedule;
+  q->high_prio = FALSE;
+  silc_gettimeofday(&q->queued_time);
+
+  silc_list_insert(t->queue, NULL, q);
+  silc_mutex_unlock(t->lock);
+
+  return TRUE;
+}
+
+/* Return queue wait time histogram */
+
+void silc_thread_pool_get_wait_histogram(SilcThreadPool tp,
+					 SilcUInt32 ret_hist[5])
+{
+  silc_mutex_lock(tp->lock);
+  memcpy(ret_hist, tp->wait_hist, sizeof(tp->wait_hist));
+  silc_mutex_unlock(tp->lock);
+}
+
+/* Return thread pool counters */
+
+void silc_thread_pool_get_stats(SilcThreadPool tp,
+				SilcUInt32 *ret_executed,
+				SilcUInt32 *ret_stolen,
+				SilcUInt32 *ret_queued)
+{
+  SilcThreadPoolThread t;
+  SilcUInt32 executed = 0, stolen = 0;
+
+  silc_mutex_lock(tp->lock);
+
+  silc_list_start(tp->threads);
+  while ((t = silc_list_get(tp->threads))) {
+    executed += t->num_executed;
+    stolen += t->num_stolen;
+  }
+
+  if (ret_executed)
+    *ret_executed = executed;
+  if (ret_stolen)
+    *ret_stolen = stolen;
+  if (ret_queued)
+    *ret_queued = tp->num_queued;
+
+  silc_mutex_unlock(tp->lock);
+}
+
+/* Return scaling state */
+
+void silc_thread_pool_get_scale(SilcThreadPool tp,
+				SilcUInt32 *ret_threads,
+				SilcUInt32 *ret_retired)
+{
+  silc_mutex_lock(tp->lock);
+  if (ret_threads)
+    *ret_threads = silc_list_count(tp->threads);
+  if (ret_retired)
+    *ret_retired = tp->num_retired;
+  silc_mutex_unlock(tp->lock);
+}
+
 SilcUInt32 silc_thread_pool_get_max_threads(SilcThreadPool tp)
 {
   SilcUInt32 max_threads;
@@ -583,6 +959,175 @@ void silc_thread_pool_purge(SilcThreadPool tp)
   silc_mutex_unlock(tp->lock);
 }
 
+/************************ Barrier and Countdown Latch ***********************/
+
+/* Number of spins on the generation before parking in barrier wait */
+#define SILC_BARRIER_SPIN_COUNT 1000
+
+/* Barrier context */
+struct SilcBarrierStruct {
+  SilcAtomic32 count;		    /* Parties still to arrive */
+  SilcAtomic32 generation;	    /* Barrier cycle */
+  SilcUInt32 total;		    /* Number of parties */
+  SilcMutex lock;
+  SilcCond cond;
+};
+
+/* Allocate barrier */
+
+SilcBool silc_barrier_alloc(SilcBarrier *barrier, SilcUInt32 count)
+{
+  SilcBarrier b;
+
+  if (!barrier || !count) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  b = silc_calloc(1, sizeof(*b));
+  if (!b)
+    return FALSE;
+
+  if (!silc_mutex_alloc(&b->lock)) {
+    silc_free(b);
+    return FALSE;
+  }
+  if (!silc_cond_alloc(&b->cond)) {
+    silc_mutex_free(b->lock);
+    silc_free(b);
+    return FALSE;
+  }
+
+  silc_atomic_init32(&b->count, count);
+  silc_atomic_init32(&b->generation, 0);
+  b->total = count;
+
+  *barrier = b;
+  return TRUE;
+}
+
+/* Free barrier */
+
+void silc_barrier_free(SilcBarrier barrier)
+{
+  if (!barrier)
+    return;
+  silc_cond_free(barrier->cond);
+  silc_mutex_free(barrier->lock);
+  silc_atomic_uninit32(&barrier->count);
+  silc_atomic_uninit32(&barrier->generation);
+  silc_free(barrier);
+}
+
+/* Wait on barrier.  The arrival is one atomic decrement; only parties
+   that must wait for the others park. */
+
+SilcBool silc_barrier_wait(SilcBarrier barrier)
+{
+  SilcUInt32 gen, i;
+
+  gen = silc_atomic_get_int32(&barrier->generation);
+
+  if (silc_atomic_sub_int32(&barrier->count, 1) == 0) {
+    /* Last arriver opens the barrier for the next cycle */
+    silc_mutex_lock(barrier->lock);
+    silc_atomic_set_int32(&barrier->count, barrier->total);
+    silc_atomic_set_int32(&barrier->generation, gen + 1);
+    silc_cond_broadcast(barrier->cond);
+    silc_mutex_unlock(barrier->lock);
+    return TRUE;
+  }
+
+  /* Spin briefly; phases that complete quickly never park */
+  for (i = 0; i < SILC_BARRIER_SPIN_COUNT; i++)
+    if (silc_atomic_get_int32(&barrier->generation) != gen)
+      return FALSE;
+
+  silc_mutex_lock(barrier->lock);
+  while (silc_atomic_get_int32(&barrier->generation) == gen)
+    silc_cond_wait(barrier->cond, barrier->lock);
+  silc_mutex_unlock(barrier->lock);
+
+  return FALSE;
+}
+
+/* Countdown latch context */
+struct SilcCountdownLatchStruct {
+  SilcAtomic32 count;		    /* Events still to happen */
+  SilcMutex lock;
+  SilcCond cond;
+};
+
+/* Allocate countdown latch */
+
+SilcBool silc_latch_alloc(SilcCountdownLatch *latch, SilcUInt32 count)
+{
+  SilcCountdownLatch l;
+
+  if (!latch || !count) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  l = silc_calloc(1, sizeof(*l));
+  if (!l)
+    return FALSE;
+
+  if (!silc_mutex_alloc(&l->lock)) {
+    silc_free(l);
+    return FALSE;
+  }
+  if (!silc_cond_alloc(&l->cond)) {
+    silc_mutex_free(l->lock);
+    silc_free(l);
+    return FALSE;
+  }
+
+  silc_atomic_init32(&l->count, count);
+
+  *latch = l;
+  return TRUE;
+}
+
+/* Free countdown latch */
+
+void silc_latch_free(SilcCountdownLatch latch)
+{
+  if (!latch)
+    return;
+  silc_cond_free(latch->cond);
+  silc_mutex_free(latch->lock);
+  silc_atomic_uninit32(&latch->count);
+  silc_free(latch);
+}
+
+/* Count down the latch; one atomic per event */
+
+void silc_latch_count_down(SilcCountdownLatch latch)
+{
+  if (silc_atomic_sub_int32(&latch->count, 1) == 0) {
+    silc_mutex_lock(latch->lock);
+    silc_cond_broadcast(latch->cond);
+    silc_mutex_unlock(latch->lock);
+  }
+}
+
+/* Wait until the latch reaches zero */
+
+void silc_latch_wait(SilcCountdownLatch latch)
+{
+  SilcUInt32 i;
+
+  for (i = 0; i < SILC_BARRIER_SPIN_COUNT; i++)
+    if (!silc_atomic_get_int32(&latch->count))
+      return;
+
+  silc_mutex_lock(latch->lock);
+  while (silc_atomic_get_int32(&latch->count))
+    silc_cond_wait(latch->cond, latch->lock);
+  silc_mutex_unlock(latch->lock);
+}
+
 /*************************** Thread-local Storage ***************************/
 
 /* Set Tls context */
@@ -610,3 +1155,77 @@ void *silc_thread_tls_get(void)
     return NULL;
   return tls->thread_context;
 }
+
+/* Keyed Tls slot registry.  Keys are process global; values live in fast
+   per-thread slots indexed directly by the key. */
+static SilcTlsDestructor silc_tls_destructors[SILC_TLS_SLOTS];
+static SilcUInt32 silc_tls_num_keys = 0;
+
+/* Create new Tls key */
+
+SilcBool silc_thread_tls_key_create(SilcUInt32 *ret_key,
+				    SilcTlsDestructor destructor)
+{
+  SilcTls tls = silc_thread_tls_init();
+  SilcUInt32 key;
+
+  if (!tls || !ret_key) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  silc_mutex_lock(tls->lock);
+  if (silc_tls_num_keys >= SILC_TLS_SLOTS) {
+    silc_mutex_unlock(tls->lock);
+    silc_set_errno(SILC_ERR_LIMIT);
+    return FALSE;
+  }
+  key = silc_tls_num_keys++;
+  silc_tls_destructors[key] = destructor;
+  silc_mutex_unlock(tls->lock);
+
+  *ret_key = key;
+  return TRUE;
+}
+
+/* Set keyed Tls slot value */
+
+SilcBool silc_thread_tls_key_set(SilcUInt32 key, void *value)
+{
+  SilcTls tls = silc_thread_tls_init();
+
+  if (!tls || key >= SILC_TLS_SLOTS) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  tls->tls_slots[key] = value;
+  return TRUE;
+}
+
+/* Get keyed Tls slot value */
+
+void *silc_thread_tls_key_get(SilcUInt32 key)
+{
+  SilcTls tls = silc_thread_get_tls();
+
+  if (!tls || key >= SILC_TLS_SLOTS)
+    return NULL;
+
+  return tls->tls_slots[key];
+}
+
+/* Run slot destructors; called when a thread's Tls goes away */
+
+void silc_thread_tls_run_destructors(SilcTls tls)
+{
+  SilcUInt32 i;
+  void *value;
+
+  for (i = 0; i < SILC_TLS_SLOTS; i++) {
+    value = tls->tls_slots[i];
+    tls->tls_slots[i] = NULL;
+    if (value && silc_tls_destructors[i])
+      silc_tls_destructors[i](value);
+  }
+}
@@ -310,6 +310,168 @@ SilcBool silc_thread_pool_run(SilcThreadPool tp,
 void silc_thread_pool_set_max_threads(SilcThreadPool tp,
 				      SilcUInt32 max_threads);
 
+/****f* silcutil/silc_thread_pool_run_prio
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_thread_pool_run_prio(SilcThreadPool tp,
+ *                                       SilcBool queuable,
+ *                                       SilcBool high_priority,
+ *                                       SilcSchedule schedule,
+ *                                       SilcThreadPoolFunc run,
+ *                                       void *run_context,
+ *                                       SilcTaskCallback completion,
+ *                                       void *completion_context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_thread_pool_run but with a priority lane.  When calls are
+ *    queued because all threads are busy, high priority calls are
+ *    dequeued before normal ones, so latency-sensitive work does not
+ *    wait behind queued bulk jobs.  The scheduling is starvation proof:
+ *    after a streak of high priority picks a normal priority call is
+ *    taken even when high priority calls remain.
+ *
+ ***/
+SilcBool silc_thread_pool_run_prio(SilcThreadPool tp,
+				   SilcBool queuable,
+				   SilcBool high_priority,
+				   SilcSchedule schedule,
+				   SilcThreadPoolFunc run,
+				   void *run_context,
+				   SilcTaskCallback completion,
+				   void *completion_context);
+
+/****f* silcutil/silc_thread_pool_get_wait_histogram
+ *
+ * SYNOPSIS
+ *
+ *    void silc_thread_pool_get_wait_histogram(SilcThreadPool tp,
+ *                                             SilcUInt32 ret_hist[5]);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the histogram of how long queued calls waited before a
+ *    worker picked them up.  The buckets are <1ms, <10ms, <100ms, <1s
+ *    and >=1s.  Calls that ran without queueing are not counted.
+ *
+ ***/
+void silc_thread_pool_get_wait_histogram(SilcThreadPool tp,
+					 SilcUInt32 ret_hist[5]);
+
+/****f* silcutil/silc_thread_pool_set_affinity
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_thread_pool_set_affinity(SilcThreadPool tp,
+ *                                           const SilcUInt32 *cpus,
+ *                                           SilcUInt32 num_cpus);
+ *
+ * DESCRIPTION
+ *
+ *    Pins the pool workers to the processors listed in `cpus'; worker i
+ *    is pinned to cpus[i % num_cpus], so giving one entry per processor
+ *    gives one worker per core.  Affects running and future workers.
+ *    Setting `num_cpus' to zero removes the pinning preference for
+ *    workers created later.  Returns FALSE if affinity control is not
+ *    supported on the platform.
+ *
+ ***/
+SilcBool silc_thread_pool_set_affinity(SilcThreadPool tp,
+				       const SilcUInt32 *cpus,
+				       SilcUInt32 num_cpus);
+
+/****f* silcutil/silc_thread_pool_run_on
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_thread_pool_run_on(SilcThreadPool tp, SilcUInt32 index,
+ *                                     SilcSchedule schedule,
+ *                                     SilcThreadPoolFunc run,
+ *                                     void *run_context,
+ *                                     SilcTaskCallback completion,
+ *                                     void *completion_context);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_thread_pool_run but runs the call in the specific pool
+ *    worker `index' (creating workers up to that index if needed),
+ *    queuing behind its current work if it is busy.  With workers
+ *    pinned by silc_thread_pool_set_affinity this keeps cache-hot
+ *    per-connection work on one core.  Returns FALSE if `index' is
+ *    beyond the pool maximum.
+ *
+ ***/
+SilcBool silc_thread_pool_run_on(SilcThreadPool tp, SilcUInt32 index,
+				 SilcSchedule schedule,
+				 SilcThreadPoolFunc run,
+				 void *run_context,
+				 SilcTaskCallback completion,
+				 void *completion_context);
+
+/****f* silcutil/silc_thread_pool_set_autoscale
+ *
+ * SYNOPSIS
+ *
+ *    void silc_thread_pool_set_autoscale(SilcThreadPool tp,
+ *                                        SilcUInt32 idle_grace_ms);
+ *
+ * DESCRIPTION
+ *
+ *    Enables demand-based scaling of the pool.  The pool already
+ *    spawns workers on demand up to its maximum; with this set,
+ *    workers idle for longer than `idle_grace_ms' milliseconds also
+ *    retire until the pool is back at its minimum, so a burst does
+ *    not leave its worker count pinned until process exit.  Zero
+ *    (the default) keeps spawned workers forever.  Retirements are
+ *    counted in silc_thread_pool_get_scale.
+ *
+ ***/
+void silc_thread_pool_set_autoscale(SilcThreadPool tp,
+				    SilcUInt32 idle_grace_ms);
+
+/****f* silcutil/silc_thread_pool_get_scale
+ *
+ * SYNOPSIS
+ *
+ *    void silc_thread_pool_get_scale(SilcThreadPool tp,
+ *                                    SilcUInt32 *ret_threads,
+ *                                    SilcUInt32 *ret_retired);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the current worker count and the total number of workers
+ *    retired by autoscaling.  Either pointer may be NULL.
+ *
+ ***/
+void silc_thread_pool_get_scale(SilcThreadPool tp,
+				SilcUInt32 *ret_threads,
+				SilcUInt32 *ret_retired);
+
+/****f* silcutil/silc_thread_pool_get_stats
+ *
+ * SYNOPSIS
+ *
+ *    void silc_thread_pool_get_stats(SilcThreadPool tp,
+ *                                    SilcUInt32 *ret_executed,
+ *                                    SilcUInt32 *ret_stolen,
+ *                                    SilcUInt32 *ret_queued);
+ *
+ * DESCRIPTION
+ *
+ *    Returns thread pool counters: the total number of executed calls,
+ *    the number of calls workers stole from other workers' queues, and
+ *    the number of calls that had to be queued because all threads were
+ *    busy (overflow).  A high stolen count indicates imbalanced
+ *    production; a high queued count indicates the pool is too small.
+ *    Any of the return pointers may be NULL.
+ *
+ ***/
+void silc_thread_pool_get_stats(SilcThreadPool tp,
+				SilcUInt32 *ret_executed,
+				SilcUInt32 *ret_stolen,
+				SilcUInt32 *ret_queued);
+
 /****f* silcutil/silc_thread_pool_get_max_threads
  *
  * SYNOPSIS
@@ -352,6 +514,198 @@ SilcUInt32 silc_thread_pool_num_free_threads(SilcThreadPool tp);
  ***/
 void silc_thread_pool_purge(SilcThreadPool tp);
 
+/****s* silcutil/SilcBarrier
+ *
+ * NAME
+ *
+ *    typedef struct SilcBarrierStruct *SilcBarrier;
+ *
+ * DESCRIPTION
+ *
+ *    Barrier for phase synchronization between threads.  All parties
+ *    call silc_barrier_wait; each proceeds when the last one arrives.
+ *    The barrier is cyclic and can be reused for the next phase.
+ *
+ ***/
+typedef struct SilcBarrierStruct *SilcBarrier;
+
+/****s* silcutil/SilcCountdownLatch
+ *
+ * NAME
+ *
+ *    typedef struct SilcCountdownLatchStruct *SilcCountdownLatch;
+ *
+ * DESCRIPTION
+ *
+ *    One-shot countdown latch.  Waiters block in silc_latch_wait until
+ *    silc_latch_count_down has been called the initial count times.
+ *
+ ***/
+typedef struct SilcCountdownLatchStruct *SilcCountdownLatch;
+
+/****f* silcutil/silc_barrier_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_barrier_alloc(SilcBarrier *barrier, SilcUInt32 count);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates a barrier for `count' parties.  Freed with
+ *    silc_barrier_free when no thread waits on it anymore.
+ *
+ ***/
+SilcBool silc_barrier_alloc(SilcBarrier *barrier, SilcUInt32 count);
+
+/****f* silcutil/silc_barrier_wait
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_barrier_wait(SilcBarrier barrier);
+ *
+ * DESCRIPTION
+ *
+ *    Waits until all parties have arrived at the barrier.  Arrival
+ *    costs one atomic operation; a party that must wait spins briefly
+ *    and then parks.  Returns TRUE in exactly one of the parties per
+ *    cycle (the last arriver), which can be used for per-phase
+ *    housekeeping.
+ *
+ ***/
+SilcBool silc_barrier_wait(SilcBarrier barrier);
+
+/****f* silcutil/silc_barrier_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_barrier_free(SilcBarrier barrier);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the barrier.
+ *
+ ***/
+void silc_barrier_free(SilcBarrier barrier);
+
+/****f* silcutil/silc_latch_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_latch_alloc(SilcCountdownLatch *latch,
+ *                              SilcUInt32 count);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates a one-shot countdown latch of `count' events.  Freed
+ *    with silc_latch_free.
+ *
+ ***/
+SilcBool silc_latch_alloc(SilcCountdownLatch *latch, SilcUInt32 count);
+
+/****f* silcutil/silc_latch_count_down
+ *
+ * SYNOPSIS
+ *
+ *    void silc_latch_count_down(SilcCountdownLatch latch);
+ *
+ * DESCRIPTION
+ *
+ *    Counts down one event; one atomic operation.  When the count
+ *    reaches zero all waiters are released.
+ *
+ ***/
+void silc_latch_count_down(SilcCountdownLatch latch);
+
+/****f* silcutil/silc_latch_wait
+ *
+ * SYNOPSIS
+ *
+ *    void silc_latch_wait(SilcCountdownLatch latch);
+ *
+ * DESCRIPTION
+ *
+ *    Waits until the latch has counted down to zero, spinning briefly
+ *    before parking.
+ *
+ ***/
+void silc_latch_wait(SilcCountdownLatch latch);
+
+/****f* silcutil/silc_latch_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_latch_free(SilcCountdownLatch latch);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the countdown latch.
+ *
+ ***/
+void silc_latch_free(SilcCountdownLatch latch);
+
+/****f* silcutil/SilcTlsDestructor
+ *
+ * SYNOPSIS
+ *
+ *    typedef void (*SilcTlsDestructor)(void *value);
+ *
+ * DESCRIPTION
+ *
+ *    Destructor callback for keyed Tls slot values, called with the
+ *    thread's slot value when the thread's Tls is uninitialized (for
+ *    example when a pool thread exits), if the value is non-NULL.
+ *
+ ***/
+typedef void (*SilcTlsDestructor)(void *value);
+
+/****f* silcutil/silc_thread_tls_key_create
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_thread_tls_key_create(SilcUInt32 *ret_key,
+ *                                        SilcTlsDestructor destructor);
+ *
+ * DESCRIPTION
+ *
+ *    Creates a new process-global Tls key with an optional `destructor'
+ *    and returns it to `ret_key'.  Each thread has its own value for
+ *    the key, accessed in O(1) through a static per-thread slot array
+ *    with silc_thread_tls_key_set and silc_thread_tls_key_get.  The
+ *    number of keys is limited; returns FALSE when the slots run out.
+ *
+ ***/
+SilcBool silc_thread_tls_key_create(SilcUInt32 *ret_key,
+				    SilcTlsDestructor destructor);
+
+/****f* silcutil/silc_thread_tls_key_set
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_thread_tls_key_set(SilcUInt32 key, void *value);
+ *
+ * DESCRIPTION
+ *
+ *    Sets the calling thread's value for the Tls `key'.  The previous
+ *    value is not destructed; the destructor runs only at thread Tls
+ *    uninitialization.
+ *
+ ***/
+SilcBool silc_thread_tls_key_set(SilcUInt32 key, void *value);
+
+/****f* silcutil/silc_thread_tls_key_get
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_thread_tls_key_get(SilcUInt32 key);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the calling thread's value for the Tls `key', or NULL if
+ *    it has not been set.
+ *
+ ***/
+void *silc_thread_tls_key_get(SilcUInt32 key);
+
 /****f* silcutil/silc_thread_tls_set
  *
  * SYNOPSIS
@@ -28,13 +28,19 @@
    Tls if the SILC Tls API is used.  This structure must be allocatable
    with silc_calloc and freeable with silc_free, and must also be able to
    pre-allocate from stack. */
+/* Number of fast keyed Tls slots */
+#define SILC_TLS_SLOTS 16
+
 typedef struct SilcTlsObject {
   SilcMutex lock;			    /* Global lock, shared */
   SilcHashTable variables;		    /* Global variables, shared */
   SilcHashTable tls_variables;	            /* Tls variables */
+  SilcHashTable var_cache;		    /* Global variable read cache */
+  SilcUInt32 var_cache_gen;		    /* Cache generation */
   SilcStack stack;			    /* Thread's stack */
   SilcSchedule schedule;		    /* Thread's scheduler */
   void *thread_context;		            /* Context set with SILC Tls API */
+  void *tls_slots[SILC_TLS_SLOTS];	    /* Keyed Tls slot values */
   void *platform_context;	            /* Platform specific context */
   char error_reason[256];		    /* Reason for the error */
   char filename[256];			    /* File where error occurred */
@@ -45,6 +51,10 @@ typedef struct SilcTlsObject {
 					       threads in the Tls. */
 } *SilcTls, SilcTlsStruct;
 
+/* Runs the keyed Tls slot destructors of `tls'.  Called from the
+   platform specific Tls uninitialization. */
+void silc_thread_tls_run_destructors(SilcTls tls);
+
 /* The internal Tls API.  Implementation is platform specific. */
 
 /* Initializes Tls for current thread.  Must be called for each thread to
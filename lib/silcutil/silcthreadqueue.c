@@ -27,22 +27,125 @@ typedef struct SilcThreadQueueDataStruct {
   void *data;			/* User data */
 } *SilcThreadQueueData;
 
+/* Ring buffer cell.  The sequence number tells whether the cell is free
+   for the producer (seq == position) or holds data for the consumer
+   (seq == position + 1). */
+typedef struct SilcThreadQueueCellStruct {
+  SilcAtomic32 seq;		/* Cell sequence number */
+  void *data;			/* User data */
+} SilcThreadQueueCell;
+
 /* Pipe */
 typedef struct SilcThreadQueuePipeStruct {
   SilcList queue;		/* The queue */
   SilcList freelist;		/* Free list of queue data contexts */
   SilcMutex lock;		/* Queue lock */
   SilcCond cond;		/* Condition for waiting */
+  SilcThreadQueueCell *cells;	/* Ring mode: the ring */
+  SilcUInt32 ring_size;		/* Ring mode: ring size (power of two) */
+  SilcAtomic32 enq;		/* Ring mode: enqueue position */
+  SilcAtomic32 deq;		/* Ring mode: dequeue position */
 } *SilcThreadQueuePipe;
 
 /* Thread queue context */
 struct SilcThreadQueueStruct {
   SilcThreadQueuePipe pipes;	/* Queue pipes */
   SilcAtomic32 connected;	/* Number of connected threads */
-  unsigned int num_pipes  : 31;	/* Number of pipes */
+  unsigned int num_pipes  : 30;	/* Number of pipes */
   unsigned int fifo       : 1;	/* FIFO */
+  unsigned int ring       : 1;	/* Lock-free bounded ring mode */
 };
 
+/************************ Static utility functions **************************/
+
+/* Pushes `data' to ring pipe.  Spins when the ring is full. */
+
+static void silc_thread_queue_ring_push(SilcThreadQueuePipe pipe, void *data)
+{
+  SilcThreadQueueCell *cell;
+  SilcUInt32 pos;
+  SilcInt32 dif;
+
+  pos = silc_atomic_get_int32(&pipe->enq);
+  for (;;) {
+    cell = &pipe->cells[pos & (pipe->ring_size - 1)];
+    dif = (SilcInt32)(silc_atomic_get_int32(&cell->seq) - pos);
+
+    if (dif == 0) {
+      /* Cell is free, claim it */
+      if (silc_atomic_cas32(&pipe->enq, pos, pos + 1)) {
+	cell->data = data;
+	silc_atomic_set_int32(&cell->seq, pos + 1);
+	return;
+      }
+      pos = silc_atomic_get_int32(&pipe->enq);
+    } else if (dif < 0) {
+      /* Ring is full, wait for the consumer */
+      silc_thread_yield();
+      pos = silc_atomic_get_int32(&pipe->enq);
+    } else {
+      pos = silc_atomic_get_int32(&pipe->enq);
+    }
+  }
+}
+
+/* Pops data from ring pipe.  Returns FALSE if the ring is empty. */
+
+static SilcBool silc_thread_queue_ring_pop(SilcThreadQueuePipe pipe,
+					   void **ret_data)
+{
+  SilcThreadQueueCell *cell;
+  SilcUInt32 pos;
+  SilcInt32 dif;
+
+  pos = silc_atomic_get_int32(&pipe->deq);
+  for (;;) {
+    cell = &pipe->cells[pos & (pipe->ring_size - 1)];
+    dif = (SilcInt32)(silc_atomic_get_int32(&cell->seq) - (pos + 1));
+
+    if (dif == 0) {
+      /* Cell has data, claim it */
+      if (silc_atomic_cas32(&pipe->deq, pos, pos + 1)) {
+	*ret_data = cell->data;
+	silc_atomic_set_int32(&cell->seq, pos + pipe->ring_size);
+	return TRUE;
+      }
+      pos = silc_atomic_get_int32(&pipe->deq);
+    } else if (dif < 0) {
+      /* Ring is empty */
+      return FALSE;
+    } else {
+      pos = silc_atomic_get_int32(&pipe->deq);
+    }
+  }
+}
+
+/* Pops from ring pipe, spinning adaptively when the ring is empty and
+   blocking is wanted.  The spin first busy polls, then yields the
+   processor and finally sleeps shortly, so an idle consumer does not
+   burn a core while a loaded one never sleeps. */
+
+static void *silc_thread_queue_ring_pop_block(SilcThreadQueuePipe pipe,
+					      SilcBool block)
+{
+  void *data;
+  SilcUInt32 spin = 0;
+
+  while (!silc_thread_queue_ring_pop(pipe, &data)) {
+    if (!block)
+      return NULL;
+    if (++spin < 100)
+      continue;
+    if (spin < 1000) {
+      silc_thread_yield();
+      continue;
+    }
+    silc_usleep(200);
+  }
+
+  return data;
+}
+
 /************************** SILC Thread Queue API ***************************/
 
 /* Allocate thread queue */
@@ -84,6 +187,59 @@ SilcThreadQueue silc_thread_queue_alloc(int num_pipes, SilcBool fifo)
   return queue;
 }
 
+/* Allocate thread queue in bounded lock-free ring mode */
+
+SilcThreadQueue silc_thread_queue_alloc_ring(int num_pipes,
+					     SilcUInt32 ring_size)
+{
+  SilcThreadQueue queue;
+  SilcUInt32 i, k, size = 16;
+
+  if (!num_pipes)
+    num_pipes = 1;
+
+  /* Round ring size up to a power of two */
+  while (size < ring_size)
+    size <<= 1;
+
+  queue = silc_calloc(1, sizeof(*queue));
+  if (!queue)
+    return NULL;
+
+  SILC_LOG_DEBUG(("Allocated thread queue %p, %d pipes, ring size %d",
+		  queue, num_pipes, size));
+
+  queue->pipes = silc_calloc(num_pipes, sizeof(*queue->pipes));
+  if (!queue->pipes) {
+    silc_free(queue);
+    return NULL;
+  }
+  queue->num_pipes = num_pipes;
+  queue->fifo = TRUE;
+  queue->ring = TRUE;
+
+  for (i = 0; i < num_pipes; i++) {
+    queue->pipes[i].cells = silc_calloc(size,
+					sizeof(*queue->pipes[i].cells));
+    if (!queue->pipes[i].cells) {
+      while (i-- > 0)
+	silc_free(queue->pipes[i].cells);
+      silc_free(queue->pipes);
+      silc_free(queue);
+      return NULL;
+    }
+    queue->pipes[i].ring_size = size;
+    for (k = 0; k < size; k++)
+      silc_atomic_init32(&queue->pipes[i].cells[k].seq, k);
+    silc_atomic_init32(&queue->pipes[i].enq, 0);
+    silc_atomic_init32(&queue->pipes[i].deq, 0);
+  }
+
+  silc_atomic_init32(&queue->connected, 1);
+
+  return queue;
+}
+
 /* Connect current thread to queue */
 
 void silc_thread_queue_connect(SilcThreadQueue queue)
@@ -108,6 +264,10 @@ SilcBool silc_thread_queue_disconnect(SilcThreadQueue queue)
   SILC_LOG_DEBUG(("Free thread queue %p", queue));
 
   for (i = 0; i < queue->num_pipes; i++) {
+    if (queue->ring) {
+      silc_free(queue->pipes[i].cells);
+      continue;
+    }
     silc_cond_free(queue->pipes[i].cond);
     silc_mutex_free(queue->pipes[i].lock);
     silc_list_start(queue->pipes[i].queue);
@@ -141,6 +301,15 @@ void silc_thread_queue_push(SilcThreadQueue queue, int pipe_index, void *data,
   SILC_LOG_DEBUG(("Push data %p to thread queue %p, pipe %d, demux %s",
 		  data, queue, pipe_index, demux ? "yes" : "no"));
 
+  if (queue->ring) {
+    if (demux)
+      for (i = 0; i < queue->num_pipes; i++)
+	silc_thread_queue_ring_push(&queue->pipes[i], data);
+    else
+      silc_thread_queue_ring_push(&queue->pipes[pipe_index], data);
+    return;
+  }
+
   silc_mutex_lock(queue->pipes[pipe_index].lock);
 
   d = silc_list_pop(queue->pipes[pipe_index].freelist);
@@ -169,6 +338,65 @@ void silc_thread_queue_push(SilcThreadQueue queue, int pipe_index, void *data,
   silc_mutex_unlock(queue->pipes[pipe_index].lock);
 }
 
+/* Push multiple data items to queue with one lock and one wakeup */
+
+void silc_thread_queue_push_multi(SilcThreadQueue queue, int pipe_index,
+				  void **data, SilcUInt32 count,
+				  SilcBool demux)
+{
+  SilcThreadQueueData d;
+  SilcUInt32 i, k;
+
+  if (silc_unlikely(!data || !count))
+    return;
+
+  SILC_ASSERT(pipe_index < queue->num_pipes);
+
+  SILC_LOG_DEBUG(("Push %d data to thread queue %p, pipe %d, demux %s",
+		  count, queue, pipe_index, demux ? "yes" : "no"));
+
+  if (queue->ring) {
+    for (k = 0; k < count; k++) {
+      if (demux)
+	for (i = 0; i < queue->num_pipes; i++)
+	  silc_thread_queue_ring_push(&queue->pipes[i], data[k]);
+      else
+	silc_thread_queue_ring_push(&queue->pipes[pipe_index], data[k]);
+    }
+    return;
+  }
+
+  silc_mutex_lock(queue->pipes[pipe_index].lock);
+
+  for (k = 0; k < count; k++) {
+    d = silc_list_pop(queue->pipes[pipe_index].freelist);
+    if (!d) {
+      d = silc_calloc(1, sizeof(*d));
+      if (!d)
+	break;
+    }
+    d->data = data[k];
+
+    if (demux) {
+      for (i = 0; i < queue->num_pipes; i++) {
+	if (queue->fifo)
+	  silc_list_add(queue->pipes[i].queue, d);
+	else
+	  silc_list_insert(queue->pipes[i].queue, NULL, d);
+      }
+    } else {
+      if (queue->fifo)
+	silc_list_add(queue->pipes[pipe_index].queue, d);
+      else
+	silc_list_insert(queue->pipes[pipe_index].queue, NULL, d);
+    }
+  }
+
+  /* One wakeup for the whole batch */
+  silc_cond_broadcast(queue->pipes[pipe_index].cond);
+  silc_mutex_unlock(queue->pipes[pipe_index].lock);
+}
+
 /* Get data or wait if wanted or return NULL. */
 
 void *silc_thread_queue_pop(SilcThreadQueue queue, int pipe_index,
@@ -179,6 +407,10 @@ void *silc_thread_queue_pop(SilcThreadQueue queue, int pipe_index,
 
   SILC_ASSERT(pipe_index < queue->num_pipes);
 
+  if (queue->ring)
+    return silc_thread_queue_ring_pop_block(&queue->pipes[pipe_index],
+					    block);
+
   silc_mutex_lock(queue->pipes[pipe_index].lock);
 
   if (block) {
@@ -216,6 +448,18 @@ void *silc_thread_queue_timed_pop(SilcThreadQueue queue, int pipe_index,
 
   SILC_ASSERT(pipe_index < queue->num_pipes);
 
+  if (queue->ring) {
+    int waited = 0;
+
+    while (!silc_thread_queue_ring_pop(&queue->pipes[pipe_index], &data)) {
+      if (waited >= timeout_msec)
+	return NULL;
+      silc_usleep(1000);
+      waited++;
+    }
+    return data;
+  }
+
   silc_mutex_lock(queue->pipes[pipe_index].lock);
 
   while ((d = silc_list_pop(queue->pipes[pipe_index].queue)) == NULL)
@@ -246,6 +490,26 @@ SilcDList silc_thread_queue_pop_list(SilcThreadQueue queue, int pipe_index,
 
   SILC_ASSERT(pipe_index < queue->num_pipes);
 
+  if (queue->ring) {
+    void *data;
+
+    list = silc_dlist_init();
+    if (!list)
+      return NULL;
+
+    /* Wait for the first and then drain everything pending */
+    data = silc_thread_queue_ring_pop_block(&queue->pipes[pipe_index],
+					    block);
+    if (data) {
+      silc_dlist_add(list, data);
+      while (silc_thread_queue_ring_pop(&queue->pipes[pipe_index], &data))
+	silc_dlist_add(list, data);
+    }
+
+    silc_dlist_start(list);
+    return list;
+  }
+
   silc_mutex_lock(queue->pipes[pipe_index].lock);
 
   if (block)
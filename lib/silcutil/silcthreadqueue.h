@@ -95,6 +95,29 @@ typedef struct SilcThreadQueueStruct *SilcThreadQueue;
  ***/
 SilcThreadQueue silc_thread_queue_alloc(int num_pipes, SilcBool fifo);
 
+/****f* silcutil/silc_thread_queue_alloc_ring
+ *
+ * SYNOPSIS
+ *
+ *    SilcThreadQueue silc_thread_queue_alloc_ring(int num_pipes,
+ *                                                 SilcUInt32 ring_size);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_thread_queue_alloc but allocates the queue in bounded
+ *    lock-free ring mode.  Each pipe is a fixed ring of `ring_size'
+ *    entries (rounded up to a power of two) operated with atomic
+ *    sequence numbers; pushing and popping take no locks and no
+ *    condition variable wakeups, which removes the futex cost at high
+ *    message rates.  Pushing to a full ring waits for the consumer.  A
+ *    blocking pop busy polls briefly, then yields and finally sleeps in
+ *    short intervals, so an idle consumer does not burn the processor.
+ *    Ring queues are always FIFO.
+ *
+ ***/
+SilcThreadQueue silc_thread_queue_alloc_ring(int num_pipes,
+					     SilcUInt32 ring_size);
+
 /****f* silcutil/silc_thread_queue_connect
  *
  * SYNOPSIS
@@ -152,6 +175,28 @@ SilcBool silc_thread_queue_disconnect(SilcThreadQueue queue);
 void silc_thread_queue_push(SilcThreadQueue queue, int pipe_index, void *data,
 			    SilcBool demux);
 
+/****f* silcutil/silc_thread_queue_push_multi
+ *
+ * SYNOPSIS
+ *
+ *    void silc_thread_queue_push_multi(SilcThreadQueue queue,
+ *                                      int pipe_index, void **data,
+ *                                      SilcUInt32 count, SilcBool demux);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_thread_queue_push but pushes `count' data items from the
+ *    array `data' with one lock acquisition and one consumer wakeup for
+ *    the whole batch, instead of a lock and a signal per item.  A
+ *    producer batching its items this way together with a consumer
+ *    draining with silc_thread_queue_pop_list moves a pipeline burst
+ *    with one wakeup at each end.
+ *
+ ***/
+void silc_thread_queue_push_multi(SilcThreadQueue queue, int pipe_index,
+				  void **data, SilcUInt32 count,
+				  SilcBool demux);
+
 /****f* silcutil/silc_thread_queue_pop
  *
  * SYNOPSIS
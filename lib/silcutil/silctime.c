@@ -222,16 +222,47 @@ SilcBool silc_timezone(char *timezone, SilcUInt32 timezone_size)
 
 /* Returns time from universal time string into SilcTime */
 
+/* Parses `num' digit pairs from `s' into `vals'.  All characters are
+   checked in one pass accumulating a validity flag, so the common
+   all-valid case runs without branches per digit. */
+
+static SilcBool silc_time_pairs(const char *s, int num, unsigned int *vals)
+{
+  unsigned int bad = 0, hi, lo;
+  int i;
+
+  for (i = 0; i < num; i++) {
+    hi = (unsigned int)(s[i * 2] - '0');
+    lo = (unsigned int)(s[i * 2 + 1] - '0');
+    bad |= (hi > 9) | (lo > 9);
+    vals[i] = hi * 10 + lo;
+  }
+
+  return !bad;
+}
+
 SilcBool silc_time_universal(const char *universal_time, SilcTime ret_time)
 {
   int ret;
   unsigned int year, month, day, hour = 0, minute = 0, second = 0;
+  unsigned int v[6];
   unsigned char z = 0;
 
   if (!ret_time)
     return TRUE;
   memset(ret_time, 0, sizeof(*ret_time));
 
+  /* Fixed-layout fast path: YYMMDDHHMMSSZ, by far the common form */
+  if (universal_time[0] && silc_time_pairs(universal_time, 6, v) &&
+      universal_time[12] == 'Z' && !universal_time[13]) {
+    if (!silc_time_fill(ret_time, v[0], v[1], v[2], v[3], v[4], v[5], 0))
+      return FALSE;
+    ret_time->year += 1900;
+    if (ret_time->year < 1950)
+      ret_time->year += 100;
+    return TRUE;
+  }
+
   /* Parse the time string */
   ret = sscanf(universal_time, "%02u%02u%02u%02u%02u%02u%c", &year, &month,
 	       &day, &hour, &minute, &second, &z);
@@ -250,7 +281,8 @@ SilcBool silc_time_universal(const char *universal_time, SilcTime ret_time)
 
   /* Check timezone */
   if (z == '-' || z == '+') {
-    ret = sscanf(universal_time + (ret * 2) + 1, "%02u%02u", &hour, &minute);
+    /* The zone designator follows the twelve digits parsed above */
+    ret = sscanf(universal_time + 12 + 1, "%02u%02u", &hour, &minute);
     if (ret != 2) {
       SILC_LOG_DEBUG(("Malformed UTC time string"));
       silc_set_errno_reason(SILC_ERR_BAD_TIME, "Malformed UTC time string");
@@ -319,12 +351,19 @@ SilcBool silc_time_generalized(const char *generalized_time, SilcTime ret_time)
   int ret, i;
   unsigned int year, month, day, hour = 0, minute = 0, second = 0;
   unsigned int msecond = 0;
+  unsigned int v[7];
   unsigned char z = 0;
 
   if (!ret_time)
     return TRUE;
   memset(ret_time, 0, sizeof(*ret_time));
 
+  /* Fixed-layout fast path: YYYYMMDDHHMMSSZ */
+  if (generalized_time[0] && silc_time_pairs(generalized_time, 7, v) &&
+      generalized_time[14] == 'Z' && !generalized_time[15])
+    return silc_time_fill(ret_time, v[0] * 100 + v[1], v[2], v[3], v[4],
+			  v[5], v[6], 0);
+
   /* Parse the time string */
   ret = sscanf(generalized_time, "%04u%02u%02u%02u%02u%02u", &year, &month,
 	       &day, &hour, &minute, &second);
@@ -341,8 +380,9 @@ SilcBool silc_time_generalized(const char *generalized_time, SilcTime ret_time)
     return FALSE;
   }
 
-  /* Check fractions of second and/or timezone */
-  i = ret * 4;
+  /* Check fractions of second and/or timezone; they follow the
+     fourteen digits parsed above */
+  i = 14;
   ret = sscanf(generalized_time + i, "%c", &z);
   if (ret != 1) {
     SILC_LOG_DEBUG(("Malformed generalized time string"));
@@ -397,6 +437,32 @@ SilcBool silc_time_generalized(const char *generalized_time, SilcTime ret_time)
   return TRUE;
 }
 
+/* Bulk parse of fixed-layout timestamps */
+
+SilcUInt32 silc_time_parse_bulk(const char **times, SilcUInt32 num_times,
+				SilcBool generalized,
+				SilcTimeStruct *ret_times)
+{
+  SilcUInt32 i;
+
+  if (!times || !ret_times) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return 0;
+  }
+
+  for (i = 0; i < num_times; i++) {
+    if (generalized) {
+      if (!silc_time_generalized(times[i], &ret_times[i]))
+	break;
+    } else {
+      if (!silc_time_universal(times[i], &ret_times[i]))
+	break;
+    }
+  }
+
+  return i;
+}
+
 /* Encode generalized time string */
 
 SilcBool silc_time_generalized_string(SilcTime time_val, char *ret_string,
@@ -447,3 +513,54 @@ int silc_compare_timeval(struct timeval *t1, struct timeval *t2)
     return t1->tv_usec - t2->tv_usec;
   return s;
 }
+
+/**************************** Monotonic time ********************************/
+
+/* Return monotonic time in nanoseconds */
+
+SilcUInt64 silc_time_monotonic_nsec(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+    return (SilcUInt64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif /* HAVE_CLOCK_GETTIME && CLOCK_MONOTONIC */
+
+  /* Fall back to wall clock */
+  return silc_time_usec() * 1000;
+}
+
+/* Return monotonic time in microseconds */
+
+SilcUInt64 silc_time_monotonic_usec(void)
+{
+  return silc_time_monotonic_nsec() / 1000;
+}
+
+/* Return monotonic time in milliseconds */
+
+SilcUInt64 silc_time_monotonic_msec(void)
+{
+  return silc_time_monotonic_nsec() / 1000000;
+}
+
+/* Coarse cached time, updated by the scheduler on every loop tick so
+   per-packet timestamping does not take a system call. */
+
+static volatile SilcUInt64 silc_time_coarse_cache = 0;
+
+/* Update the coarse time.  Called from the scheduler loop. */
+
+void silc_time_update_coarse(void)
+{
+  silc_time_coarse_cache = silc_time_monotonic_usec();
+}
+
+/* Return the coarse monotonic time in microseconds */
+
+SilcUInt64 silc_time_coarse_usec(void)
+{
+  SilcUInt64 t = silc_time_coarse_cache;
+  return t ? t : silc_time_monotonic_usec();
+}
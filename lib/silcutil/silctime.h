@@ -299,4 +299,80 @@ int silc_compare_timeval(struct timeval *t1, struct timeval *t2);
  ***/
 int silc_gettimeofday(struct timeval *p);
 
+/****f* silcutil/silc_time_monotonic_msec
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_time_monotonic_msec(void);
+ *    SilcUInt64 silc_time_monotonic_usec(void);
+ *    SilcUInt64 silc_time_monotonic_nsec(void);
+ *
+ * DESCRIPTION
+ *
+ *    Return monotonic time in milliseconds, microseconds or
+ *    nanoseconds.  Unlike silc_time_msec and silc_time_usec the
+ *    monotonic clock is unaffected by wall clock steps (NTP), so it is
+ *    the right time base for timeouts and intervals.  Falls back to
+ *    the wall clock on systems without a monotonic clock.
+ *
+ ***/
+SilcUInt64 silc_time_monotonic_msec(void);
+SilcUInt64 silc_time_monotonic_usec(void);
+SilcUInt64 silc_time_monotonic_nsec(void);
+
+/****f* silcutil/silc_time_coarse_usec
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_time_coarse_usec(void);
+ *
+ * DESCRIPTION
+ *
+ *    Returns a coarse monotonic timestamp in microseconds without a
+ *    system call.  The value is cached and refreshed by the scheduler
+ *    on every loop iteration (see silc_time_update_coarse), so its
+ *    resolution is one scheduler tick; use for per-packet timestamping
+ *    where that is enough.
+ *
+ ***/
+SilcUInt64 silc_time_coarse_usec(void);
+
+/****f* silcutil/silc_time_update_coarse
+ *
+ * SYNOPSIS
+ *
+ *    void silc_time_update_coarse(void);
+ *
+ * DESCRIPTION
+ *
+ *    Refreshes the coarse timestamp cache.  The scheduler calls this on
+ *    every loop iteration; applications with their own loops may call
+ *    it as well.
+ *
+ ***/
+void silc_time_update_coarse(void);
+
+/****f* silcutil/silc_time_parse_bulk
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt32 silc_time_parse_bulk(const char **times,
+ *                                    SilcUInt32 num_times,
+ *                                    SilcBool generalized,
+ *                                    SilcTimeStruct *ret_times);
+ *
+ * DESCRIPTION
+ *
+ *    Parses `num_times' timestamp strings into `ret_times', using the
+ *    generalized format when `generalized' is TRUE and the universal
+ *    format otherwise.  Fixed-layout timestamps ("YYMMDDHHMMSSZ",
+ *    "YYYYMMDDHHMMSSZ") take the validated single-pass fast path.
+ *    Returns the number of timestamps parsed; parsing stops at the
+ *    first invalid string.
+ *
+ ***/
+SilcUInt32 silc_time_parse_bulk(const char **times, SilcUInt32 num_times,
+				SilcBool generalized,
+				SilcTimeStruct *ret_times);
+
 #endif /* SILCTIME_H */
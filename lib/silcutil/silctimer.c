@@ -129,29 +129,204 @@ SilcBool silc_timer_is_running(SilcTimer timer)
   return timer->running;
 }
 
+/* Nanoseconds of the wait left for spinning; the kernel commonly
+   wakes a sleeper this much late, so the tail is met by polling the
+   monotonic clock instead */
+#define SILC_SLEEP_SPIN_NSEC 50000
+
+/* Processor pause hint for the spin loop */
+
+static void silc_sleep_pause(void)
+{
+#if defined(SILC_I486) || defined(SILC_X86_64)
+  __asm __volatile("pause");
+#elif defined(__aarch64__)
+  __asm __volatile("yield");
+#endif
+}
+
+/* Sleep until a monotonic deadline */
+
+void silc_sleep_until(SilcUInt64 deadline_nsec)
+{
+  SilcUInt64 now = silc_time_monotonic_nsec();
+
+  /* Sleep the bulk of the wait, leaving the tail for the spin */
+  while (now + SILC_SLEEP_SPIN_NSEC < deadline_nsec) {
+#if defined(SILC_UNIX) && defined(HAVE_NANOSLEEP)
+    SilcUInt64 left = deadline_nsec - now - SILC_SLEEP_SPIN_NSEC;
+    struct timespec tv;
+    tv.tv_sec = left / 1000000000;
+    tv.tv_nsec = left % 1000000000;
+    nanosleep(&tv, NULL);
+#elif defined(SILC_WIN32)
+    Sleep((DWORD)((deadline_nsec - now - SILC_SLEEP_SPIN_NSEC) / 1000000));
+#else
+    usleep((deadline_nsec - now - SILC_SLEEP_SPIN_NSEC) / 1000);
+#endif
+    now = silc_time_monotonic_nsec();
+  }
+
+  /* Spin out the tail for microsecond arrival */
+  while (silc_time_monotonic_nsec() < deadline_nsec)
+    silc_sleep_pause();
+}
+
 /* Delay execution */
 
 void silc_usleep(unsigned long microseconds)
 {
-#ifdef SILC_UNIX
-#ifdef HAVE_NANOSLEEP
-  struct timespec tv;
-  tv.tv_sec = 0;
-  tv.tv_nsec = microseconds * 1000;
-#endif /* HAVE_NANOSLEEP */
-#endif /* SILC_UNIX */
-
-#ifdef SILC_UNIX
-#ifdef HAVE_NANOSLEEP
-  nanosleep(&tv, NULL);
-#else
-  usleep(microseconds);
-#endif /* HAVE_NANOSLEEP */
-#endif /* SILC_UNIX */
-#ifdef SILC_WIN32
-  Sleep(microseconds / 1000);
-#endif /* SILC_WIN32 */
 #ifdef SILC_SYMBIAN
   silc_symbian_usleep(microseconds);
+#else
+  /* Hybrid sleep/spin; a plain quantum sleep arrives tens of
+     microseconds late, which breaks pacing loops */
+  silc_sleep_until(silc_time_monotonic_nsec() +
+		   (SilcUInt64)microseconds * 1000);
 #endif /* SILC_SYMBIAN */
 }
+
+/*************************** High-resolution timer **************************/
+
+/* Reads the processor cycle counter, or 0 if not available */
+
+static SilcUInt64 silc_timer_cycles(void)
+{
+#if defined(SILC_I486) || defined(SILC_X86_64)
+  SilcUInt32 lo, hi;
+  __asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((SilcUInt64)hi << 32) | lo;
+#elif defined(__aarch64__)
+  SilcUInt64 v;
+  __asm __volatile("mrs %0, cntvct_el0" : "=r" (v));
+  return v;
+#else
+  return 0;
+#endif
+}
+
+/* Cycle counter frequency, calibrated on first use */
+static SilcUInt64 silc_timer_cycle_hz = 0;
+static SilcBool silc_timer_cycle_checked = FALSE;
+
+/* Calibrates the cycle counter against the monotonic clock */
+
+static void silc_timer_calibrate(void)
+{
+  SilcUInt64 c1, c2, t1, t2;
+
+  silc_timer_cycle_checked = TRUE;
+
+  c1 = silc_timer_cycles();
+  if (!c1)
+    return;
+
+  t1 = silc_time_monotonic_nsec();
+  silc_usleep(10000);
+  c2 = silc_timer_cycles();
+  t2 = silc_time_monotonic_nsec();
+
+  if (c2 <= c1 || t2 <= t1)
+    return;
+
+  silc_timer_cycle_hz = (c2 - c1) * 1000000000 / (t2 - t1);
+}
+
+/* Return high-resolution timestamp in nanoseconds */
+
+SilcUInt64 silc_timer_nsec(void)
+{
+  if (silc_unlikely(!silc_timer_cycle_checked))
+    silc_timer_calibrate();
+
+  if (silc_timer_cycle_hz)
+    return silc_timer_cycles() * 1000000000 / silc_timer_cycle_hz;
+
+  return silc_time_monotonic_nsec();
+}
+
+/**************************** Timer statistics ******************************/
+
+/* Init timer statistics */
+
+void silc_timer_stats_init(SilcTimerStats stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  stats->min = (SilcUInt64)-1;
+}
+
+/* Record a value in nanoseconds.  The histogram buckets are powers of
+   two, giving bounded memory and better than 2x value resolution. */
+
+void silc_timer_stats_record(SilcTimerStats stats, SilcUInt64 nsec)
+{
+  int b = 0;
+  SilcUInt64 v = nsec;
+
+  while (v >>= 1)
+    b++;
+  if (b >= SILC_TIMER_STATS_BUCKETS)
+    b = SILC_TIMER_STATS_BUCKETS - 1;
+
+  stats->buckets[b]++;
+  stats->count++;
+  stats->sum += nsec;
+  if (nsec < stats->min)
+    stats->min = nsec;
+  if (nsec > stats->max)
+    stats->max = nsec;
+}
+
+/* Record a stopped timer's elapsed time */
+
+void silc_timer_stats_record_timer(SilcTimerStats stats, SilcTimer timer)
+{
+  SilcUInt64 sec;
+  SilcUInt32 usec;
+
+  silc_timer_value(timer, &sec, &usec);
+  silc_timer_stats_record(stats, sec * 1000000000 +
+			  (SilcUInt64)usec * 1000);
+}
+
+/* Merge statistics of `src' into `dst' */
+
+void silc_timer_stats_merge(SilcTimerStats dst, SilcTimerStats src)
+{
+  int i;
+
+  for (i = 0; i < SILC_TIMER_STATS_BUCKETS; i++)
+    dst->buckets[i] += src->buckets[i];
+  dst->count += src->count;
+  dst->sum += src->sum;
+  if (src->count && src->min < dst->min)
+    dst->min = src->min;
+  if (src->max > dst->max)
+    dst->max = src->max;
+}
+
+/* Return the approximate value in nanoseconds at the given percentile
+   (0-100).  The value is the upper bound of the histogram bucket the
+   percentile falls in. */
+
+SilcUInt64 silc_timer_stats_percentile(SilcTimerStats stats,
+				       SilcUInt32 percentile)
+{
+  SilcUInt64 target, c = 0;
+  int i;
+
+  if (!stats->count)
+    return 0;
+  if (percentile > 100)
+    percentile = 100;
+
+  target = (stats->count * percentile + 99) / 100;
+
+  for (i = 0; i < SILC_TIMER_STATS_BUCKETS; i++) {
+    c += stats->buckets[i];
+    if (c >= target)
+      return ((SilcUInt64)2 << i) - 1;
+  }
+
+  return stats->max;
+}
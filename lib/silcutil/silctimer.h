@@ -323,4 +323,149 @@ void silc_timer_synchronize(SilcTimer timer)
  ***/
 void silc_usleep(unsigned long microseconds);
 
+/****f* silcutil/silc_sleep_until
+ *
+ * SYNOPSIS
+ *
+ *    void silc_sleep_until(SilcUInt64 deadline_nsec);
+ *
+ * DESCRIPTION
+ *
+ *    Sleeps until the monotonic clock (silc_time_monotonic_nsec)
+ *    reaches `deadline_nsec'.  The bulk of the wait sleeps in the
+ *    kernel and the last tens of microseconds are spun on the clock,
+ *    so arrival is microsecond-accurate instead of a scheduler
+ *    quantum late.  silc_usleep is built on this; rate-controlled
+ *    transmit loops should compute successive absolute deadlines and
+ *    call this directly so pacing error does not accumulate.
+ *
+ ***/
+void silc_sleep_until(SilcUInt64 deadline_nsec);
+
+/****f* silcutil/silc_sleep_until
+ *
+ * SYNOPSIS
+ *
+ *    void silc_sleep_until(SilcUInt64 deadline_nsec);
+ *
+ * DESCRIPTION
+ *
+ *    Sleeps until the monotonic clock (silc_time_monotonic_nsec)
+ *    reaches `deadline_nsec'.  The bulk of the wait sleeps in the
+ *    kernel and the last tens of microseconds are spun on the clock,
+ *    so arrival is microsecond-accurate instead of a scheduler
+ *    quantum late.  silc_usleep is built on this; rate-controlled
+ *    transmit loops should compute successive absolute deadlines and
+ *    call this directly so pacing error does not accumulate.
+ *
+ ***/
+void silc_sleep_until(SilcUInt64 deadline_nsec);
+
+/****f* silcutil/silc_timer_nsec
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_timer_nsec(void);
+ *
+ * DESCRIPTION
+ *
+ *    Returns a high-resolution timestamp in nanoseconds read from the
+ *    processor cycle counter (TSC on x86, the virtual counter on ARM),
+ *    calibrated against the monotonic clock on first use.  The cost is
+ *    a few nanoseconds, suitable for instrumenting short functions.
+ *    Falls back to the monotonic clock when no cycle counter is
+ *    available.  The value is a time base of its own; compare only
+ *    silc_timer_nsec values with each other.
+ *
+ ***/
+SilcUInt64 silc_timer_nsec(void);
+
+/****s* silcutil/SilcTimerStats
+ *
+ * NAME
+ *
+ *    typedef struct SilcTimerStatsStruct *SilcTimerStats,
+ *                                         SilcTimerStatsStruct;
+ *
+ * DESCRIPTION
+ *
+ *    Bounded-memory latency statistics: a power-of-two bucket histogram
+ *    of recorded nanosecond values with count, sum, minimum and
+ *    maximum.  Cheap enough to record per request; separate contexts
+ *    (for example per thread) can be merged for aggregation and
+ *    percentiles queried at any time.
+ *
+ * SOURCE
+ */
+#define SILC_TIMER_STATS_BUCKETS 64
+
+typedef struct SilcTimerStatsStruct {
+  SilcUInt32 buckets[SILC_TIMER_STATS_BUCKETS]; /* log2 histogram */
+  SilcUInt64 count;		       /* Number of recorded values */
+  SilcUInt64 sum;		       /* Sum of recorded values */
+  SilcUInt64 min;		       /* Smallest recorded value */
+  SilcUInt64 max;		       /* Largest recorded value */
+} *SilcTimerStats, SilcTimerStatsStruct;
+/***/
+
+/****f* silcutil/silc_timer_stats_init
+ *
+ * SYNOPSIS
+ *
+ *    void silc_timer_stats_init(SilcTimerStats stats);
+ *
+ * DESCRIPTION
+ *
+ *    Initializes (or resets) the statistics context.
+ *
+ ***/
+void silc_timer_stats_init(SilcTimerStats stats);
+
+/****f* silcutil/silc_timer_stats_record
+ *
+ * SYNOPSIS
+ *
+ *    void silc_timer_stats_record(SilcTimerStats stats, SilcUInt64 nsec);
+ *    void silc_timer_stats_record_timer(SilcTimerStats stats,
+ *                                       SilcTimer timer);
+ *
+ * DESCRIPTION
+ *
+ *    Records a value in nanoseconds, or a stopped timer's elapsed time,
+ *    to the histogram.  Recording is a few arithmetic operations.
+ *
+ ***/
+void silc_timer_stats_record(SilcTimerStats stats, SilcUInt64 nsec);
+void silc_timer_stats_record_timer(SilcTimerStats stats, SilcTimer timer);
+
+/****f* silcutil/silc_timer_stats_merge
+ *
+ * SYNOPSIS
+ *
+ *    void silc_timer_stats_merge(SilcTimerStats dst, SilcTimerStats src);
+ *
+ * DESCRIPTION
+ *
+ *    Merges the statistics of `src' into `dst'.
+ *
+ ***/
+void silc_timer_stats_merge(SilcTimerStats dst, SilcTimerStats src);
+
+/****f* silcutil/silc_timer_stats_percentile
+ *
+ * SYNOPSIS
+ *
+ *    SilcUInt64 silc_timer_stats_percentile(SilcTimerStats stats,
+ *                                           SilcUInt32 percentile);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the approximate value at the given percentile (for example
+ *    50, 99) in nanoseconds; the upper bound of the histogram bucket the
+ *    percentile falls in.
+ *
+ ***/
+SilcUInt64 silc_timer_stats_percentile(SilcTimerStats stats,
+				       SilcUInt32 percentile);
+
 #endif /* SILCTIMER_H */
@@ -0,0 +1,56 @@
+/*
+
+  silctrace.h
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+/****h* silcutil/Static Tracepoint Interface
+ *
+ * DESCRIPTION
+ *
+ * Compiled-in static tracepoints (USDT) under the "srt" provider, for
+ * tracing live processes with perf, bpftrace or SystemTap without
+ * recompiling or enabling debug logging.  An unprobed tracepoint is a
+ * single nop instruction, so the points are left in production builds.
+ * On platforms without <sys/sdt.h> the macros compile to nothing.
+ *
+ * Probe points are placed at the runtime's key transitions: scheduler
+ * dispatch entry/exit and event wait wake, thread pool call
+ * enqueue/start/finish, and socket stream read/write boundaries.
+ *
+ ***/
+
+#ifndef SILCTRACE_H
+#define SILCTRACE_H
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define SILC_TRACE(name) DTRACE_PROBE(srt, name)
+#define SILC_TRACE1(name, a) DTRACE_PROBE1(srt, name, (a))
+#define SILC_TRACE2(name, a, b) DTRACE_PROBE2(srt, name, (a), (b))
+#define SILC_TRACE3(name, a, b, c) DTRACE_PROBE3(srt, name, (a), (b), (c))
+
+#else
+
+#define SILC_TRACE(name) do { } while(0)
+#define SILC_TRACE1(name, a) do { } while(0)
+#define SILC_TRACE2(name, a, b) do { } while(0)
+#define SILC_TRACE3(name, a, b, c) do { } while(0)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif /* SILCTRACE_H */
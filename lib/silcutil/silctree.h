@@ -86,7 +86,8 @@ typedef struct SilcTreeHeaderStruct SilcTreeHeader;
 typedef enum {
   /* AVL Tree.  Automatically balancing binary search tree that provides
      excellent performance. */
-  SILC_TREE_AVL    = 0,
+  SILC_TREE_AVL    = 0,	     /* AVL tree (binary tree) */
+  SILC_TREE_BTREE  = 1,	     /* B-tree (multi-entry nodes) */
 } SilcTreeType;
 /***/
 
@@ -94,6 +95,7 @@ typedef enum {
 
 /* Tree implementations */
 extern DLLAPI const struct SilcTreeOpsStruct silc_tree_avl_ops;
+extern DLLAPI const struct SilcTreeOpsStruct silc_tree_btree_ops;
 
 /****f* silcutil/silc_tree_init
  *
@@ -153,12 +155,20 @@ SilcBool __silc_tree_init(SilcTree *tree,
     tree->ops = &silc_tree_avl_ops;
     break;
 
+  case SILC_TREE_BTREE:
+    /* The B-tree does not support duplicate values */
+    if (duplicates)
+      return FALSE;
+    tree->ops = &silc_tree_btree_ops;
+    break;
+
   default:
     return FALSE;
     break;
   }
 
   tree->root = NULL;
+  tree->internal = NULL;
   tree->compare = compare;
   tree->context = context;
   tree->count = 0;
@@ -272,6 +282,153 @@ SilcBool __silc_tree_init(SilcTree *tree,
 #define silc_tree_find_ext(tree, e, compare, context) \
   (tree).ops->find(&(tree), (e), (compare), (context))
 
+/****f* silcutil/silc_tree_load
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_tree_load(SilcTree *tree, void **entries,
+ *                            SilcUInt32 count);
+ *
+ * DESCRIPTION
+ *
+ *    Adds the `count' entries in the array `entries' to the `tree'.  The
+ *    array must be pre-sorted in ascending order according to the tree's
+ *    comparison function and the tree must be empty.  The tree is built
+ *    balanced bottom-up in O(n) instead of O(n log n) with a rebalance
+ *    per insert, which makes large startup-time index builds several
+ *    times faster.  Entries with equal values are added as separate
+ *    nodes even when duplicates are enabled.  Returns FALSE on error.
+ *
+ ***/
+#define silc_tree_load(tree, entries, count) \
+  __silc_tree_load(&(tree), (entries), (count))
+static inline
+SilcBool __silc_tree_load(SilcTree *tree, void **entries, SilcUInt32 count)
+{
+  SilcUInt32 i;
+
+  if (tree->ops->load && !tree->count)
+    return tree->ops->load(tree, entries, count);
+
+  for (i = 0; i < count; i++)
+    if (!tree->ops->add(tree, entries[i]))
+      return FALSE;
+
+  return TRUE;
+}
+
+/****f* silcutil/silc_tree_export
+ *
+ * SYNOPSIS
+ *
+ *    void **silc_tree_export(SilcTree *tree, SilcUInt32 *ret_count);
+ *
+ * DESCRIPTION
+ *
+ *    Returns all entries of the `tree' in ascending order as an array of
+ *    `ret_count' entries.  The returned array can be given to
+ *    silc_tree_load to rebuild the tree.  The caller must free the array
+ *    with silc_free.  Returns NULL on error or if the tree is empty.
+ *
+ ***/
+#define silc_tree_export(tree, ret_count) \
+  __silc_tree_export(&(tree), (ret_count))
+static inline void *__silc_tree_enumerate(SilcTree *tree, void *at);
+static inline
+void **__silc_tree_export(SilcTree *tree, SilcUInt32 *ret_count)
+{
+  void **entries;
+  void *e;
+  SilcUInt32 i = 0;
+
+  if (!tree->count) {
+    silc_set_errno_nofail(SILC_ERR_NOT_FOUND);
+    return NULL;
+  }
+
+  entries = silc_calloc(tree->count, sizeof(*entries));
+  if (!entries)
+    return NULL;
+
+  for (e = __silc_tree_enumerate(tree, NULL); e;
+       e = __silc_tree_enumerate(tree, e))
+    entries[i++] = e;
+
+  if (ret_count)
+    *ret_count = i;
+
+  return entries;
+}
+
+/****f* silcutil/silc_tree_find_ge
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_tree_find_ge(SilcTree *tree, void *entry);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the smallest entry of the tree that is greater than or
+ *    equal to `entry', seeking in O(log n), or NULL if all entries are
+ *    smaller.  This is the starting point for range enumeration.
+ *
+ ***/
+#define silc_tree_find_ge(tree, e) __silc_tree_find_ge(&(tree), (e))
+static inline
+void *__silc_tree_find_ge(SilcTree *tree, void *entry)
+{
+  if (tree->ops->find_ge)
+    return tree->ops->find_ge(tree, entry);
+  return NULL;
+}
+
+/****f* silcutil/silc_tree_enumerate_range
+ *
+ * SYNOPSIS
+ *
+ *    void *silc_tree_enumerate_range(SilcTree *tree, void *at,
+ *                                    void *start, void *end);
+ *
+ * DESCRIPTION
+ *
+ *    Enumerates the entries whose values are between `start' and `end'
+ *    (inclusive), in ascending order.  When `at' is NULL the
+ *    enumeration seeks to the first entry of the range in O(log n);
+ *    the found entry is given as `at' on the next call to continue.
+ *    Returns NULL at the end of the range.  Only the entries in the
+ *    range are visited.
+ *
+ * EXAMPLE
+ *
+ *    probe1.time = t1; probe2.time = t2;
+ *    for (e = silc_tree_enumerate_range(tree, NULL, &probe1, &probe2);
+ *         e; e = silc_tree_enumerate_range(tree, e, &probe1, &probe2))
+ *      ...
+ *
+ ***/
+#define silc_tree_enumerate_range(tree, at, start, end) \
+  __silc_tree_enumerate_range(&(tree), (at), (start), (end))
+static inline void *__silc_tree_enumerate(SilcTree *tree, void *at);
+static inline
+void *__silc_tree_enumerate_range(SilcTree *tree, void *at, void *start,
+				  void *end)
+{
+  if (!at)
+    at = tree->ops->find_ge ? tree->ops->find_ge(tree, start) :
+      __silc_tree_enumerate(tree, NULL);
+  else
+    at = __silc_tree_enumerate(tree, at);
+
+  if (!at)
+    return NULL;
+
+  /* Stop past the end of the range */
+  if (end && tree->compare(end, at, tree->context) < 0)
+    return NULL;
+
+  return at;
+}
+
 /****f* silcutil/silc_tree_count
  *
  * SYNOPSIS
@@ -30,6 +30,15 @@ struct SilcTreeOpsStruct {
   SilcBool (*del)(SilcTree *tree, void *entry);
   void *(*find)(SilcTree *tree, void *entry, SilcCompare compare,
 		void *context);
+
+  /* Optional bottom-up bulk load of a pre-sorted entry array.  May be
+     NULL in which case the entries are added one by one. */
+  SilcBool (*load)(SilcTree *tree, void **entries, SilcUInt32 count);
+
+  /* Optional find of the smallest entry greater than or equal to
+     `entry'.  May be NULL in which case range enumeration starts from
+     the beginning of the tree. */
+  void *(*find_ge)(SilcTree *tree, void *entry);
 };
 
 /* Generic tree header, present in each entry in tree */
@@ -48,6 +57,7 @@ struct SilcTreeStruct {
   SilcTreeHeader *root;
   SilcCompare compare;
   void *context;
+  void *internal;			   /* Tree backend internal context */
   SilcUInt32 count;
   unsigned int offset      : 31;
   unsigned int duplicates  : 1;
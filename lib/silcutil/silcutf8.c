@@ -19,6 +19,10 @@
 
 #include "silcruntime.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
 /* Encodes the string `bin' of which encoding is `bin_encoding' to the
    UTF-8 encoding into the buffer `utf8' which is of size of `utf8_size'.
    Returns the length of the UTF-8 encoded string, or zero (0) on error.
@@ -626,9 +630,56 @@ SilcUInt32 silc_utf8_decoded_len(const unsigned char *bin, SilcUInt32 bin_len,
 /* Returns TRUE if the `utf8' string of length of `utf8_len' is valid
    UTF-8 encoded string, FALSE if it is not UTF-8 encoded string. */
 
+/* Returns the length of the pure ASCII prefix of `s'.  Scans a vector
+   or a machine word at a time; most protocol traffic is ASCII and never
+   reaches the byte-at-a-time decoder. */
+
+static SilcUInt32 silc_utf8_ascii_prefix(const unsigned char *s,
+					 SilcUInt32 len)
+{
+  SilcUInt32 i = 0;
+  SilcUInt64 w;
+
+#if defined(__SSE2__)
+  if (silc_cpuid_features() & SILC_CPUID_SSE2) {
+    while (i + 16 <= len) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+      if (_mm_movemask_epi8(v))
+	break;
+      i += 16;
+    }
+  }
+#endif /* __SSE2__ */
+
+  /* Whole machine words */
+  while (i + sizeof(w) <= len) {
+    memcpy(&w, s + i, sizeof(w));
+    if (w & (SilcUInt64)0x8080808080808080LL)
+      break;
+    i += sizeof(w);
+  }
+
+  while (i < len && !(s[i] & 0x80))
+    i++;
+
+  return i;
+}
+
 SilcBool silc_utf8_valid(const unsigned char *utf8, SilcUInt32 utf8_len)
 {
-  return silc_utf8_decode(utf8, utf8_len, 0, NULL, 0) != 0;
+  SilcUInt32 i;
+
+  if (!utf8 || !utf8_len)
+    return FALSE;
+
+  /* Skip the ASCII prefix; ASCII is always valid UTF-8.  The first
+     non-ASCII byte starts a multibyte sequence (the prefix cannot end
+     inside one), so the decoder validates the rest from there. */
+  i = silc_utf8_ascii_prefix(utf8, utf8_len);
+  if (i == utf8_len)
+    return TRUE;
+
+  return silc_utf8_decode(utf8 + i, utf8_len - i, 0, NULL, 0) != 0;
 }
 
 /* Pretty close strcasecmp */
@@ -645,6 +696,50 @@ SilcBool silc_utf8_strcasecmp(const char *s1, const char *s2)
 
 /* Pretty close strcasecmp */
 
+/* ASCII case-insensitive equality over `n' bytes.  Sixteen bytes per
+   iteration with SSE2; both inputs are known to be plain ASCII. */
+
+static SilcBool silc_utf8_ascii_casecmp(const unsigned char *s1,
+					const unsigned char *s2,
+					SilcUInt32 n)
+{
+  SilcUInt32 i = 0;
+  unsigned char a, b;
+
+#if defined(__SSE2__)
+  __m128i ca = _mm_set1_epi8('A' - 1), cz = _mm_set1_epi8('Z' + 1);
+  __m128i sp = _mm_set1_epi8(0x20);
+
+  while (i + 16 <= n) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(s1 + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(s2 + i));
+
+    /* Lowercase the A-Z lanes of both */
+    __m128i mx = _mm_and_si128(_mm_cmpgt_epi8(x, ca), _mm_cmplt_epi8(x, cz));
+    __m128i my = _mm_and_si128(_mm_cmpgt_epi8(y, ca), _mm_cmplt_epi8(y, cz));
+    x = _mm_add_epi8(x, _mm_and_si128(mx, sp));
+    y = _mm_add_epi8(y, _mm_and_si128(my, sp));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff)
+      return FALSE;
+    i += 16;
+  }
+#endif /* __SSE2__ */
+
+  for (; i < n; i++) {
+    a = s1[i];
+    b = s2[i];
+    if (a >= 'A' && a <= 'Z')
+      a += 0x20;
+    if (b >= 'A' && b <= 'Z')
+      b += 0x20;
+    if (a != b)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 SilcBool silc_utf8_strncasecmp(const char *s1, const char *s2, SilcUInt32 n)
 {
   unsigned char *s1u, *s2u;
@@ -655,6 +750,12 @@ SilcBool silc_utf8_strncasecmp(const char *s1, const char *s2, SilcUInt32 n)
   if (s1 == s2)
     return TRUE;
 
+  /* Plain ASCII inputs compare without the casefold machinery */
+  if (silc_utf8_ascii_prefix((const unsigned char *)s1, n) == n &&
+      silc_utf8_ascii_prefix((const unsigned char *)s2, n) == n)
+    return silc_utf8_ascii_casecmp((const unsigned char *)s1,
+				   (const unsigned char *)s2, n);
+
   /* Casefold and normalize */
   status = silc_stringprep(s1, n, SILC_STRING_UTF8,
 			   SILC_IDENTIFIERC_PREP, 0, &s1u,
@@ -676,3 +777,122 @@ SilcBool silc_utf8_strncasecmp(const char *s1, const char *s2, SilcUInt32 n)
 
   return ret;
 }
+
+/* Incremental UTF-8 validation.  Validates the byte structure of UTF-8
+   across chunk boundaries, carrying the remaining continuation byte
+   count of a split sequence in the context. */
+
+void silc_utf8_valid_init(SilcUTF8Valid ctx)
+{
+  ctx->need = 0;
+}
+
+SilcBool silc_utf8_valid_update(SilcUTF8Valid ctx,
+				const unsigned char *data,
+				SilcUInt32 data_len)
+{
+  SilcUInt32 i = 0;
+
+  while (i < data_len) {
+    if (ctx->need) {
+      if ((data[i] & 0xc0) != 0x80)
+	return FALSE;
+      ctx->need--;
+      i++;
+      continue;
+    }
+
+    /* Skip an ASCII run */
+    if (!(data[i] & 0x80)) {
+      i += silc_utf8_ascii_prefix(data + i, data_len - i);
+      continue;
+    }
+
+    if ((data[i] & 0xe0) == 0xc0 && (data[i] & 0xfe) != 0xc0)
+      ctx->need = 1;
+    else if ((data[i] & 0xf0) == 0xe0)
+      ctx->need = 2;
+    else if ((data[i] & 0xf8) == 0xf0 && data[i] < 0xf5)
+      ctx->need = 3;
+    else
+      return FALSE;
+    i++;
+  }
+
+  return TRUE;
+}
+
+SilcBool silc_utf8_valid_final(SilcUTF8Valid ctx)
+{
+  return ctx->need == 0;
+}
+
+/* Encode to UTF-8 into a buffer in one pass.  Room for the worst case
+   expansion is reserved up front, so the input is not scanned twice;
+   on a reused buffer the reservation is free after warmup. */
+
+SilcBool silc_utf8_encode_buffer(const unsigned char *bin,
+				 SilcUInt32 bin_len,
+				 SilcStringEncoding bin_encoding,
+				 SilcBuffer dest, SilcUInt32 *ret_encoded)
+{
+  SilcUInt32 need, len;
+
+  if (!bin || !dest) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* Worst case expansion of the supported encodings is four output
+     bytes per input byte */
+  need = bin_len * 4 + 1;
+  if (silc_buffer_taillen(dest) < need)
+    if (!silc_buffer_realloc(dest, silc_buffer_truelen(dest) +
+			     (need - silc_buffer_taillen(dest))))
+      return FALSE;
+
+  len = silc_utf8_encode(bin, bin_len, bin_encoding, dest->tail,
+			 silc_buffer_taillen(dest));
+  if (!len && bin_len)
+    return FALSE;
+  silc_buffer_pull_tail(dest, len);
+
+  if (ret_encoded)
+    *ret_encoded = len;
+
+  return TRUE;
+}
+
+/* Decode from UTF-8 into a buffer in one pass */
+
+SilcBool silc_utf8_decode_buffer(const unsigned char *utf8,
+				 SilcUInt32 utf8_len,
+				 SilcStringEncoding bin_encoding,
+				 SilcBuffer dest, SilcUInt32 *ret_decoded)
+{
+  SilcUInt32 need, len;
+
+  if (!utf8 || !dest) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* Worst case is four output bytes per input byte (UCS-4 from
+     one-byte characters) */
+  need = utf8_len * 4 + 1;
+  if (silc_buffer_taillen(dest) < need)
+    if (!silc_buffer_realloc(dest, silc_buffer_truelen(dest) +
+			     (need - silc_buffer_taillen(dest))))
+      return FALSE;
+
+  len = silc_utf8_decode(utf8, utf8_len, bin_encoding, dest->tail,
+			 silc_buffer_taillen(dest));
+  if (!len && utf8_len)
+    return FALSE;
+  silc_buffer_pull_tail(dest, len);
+
+  if (ret_decoded)
+    *ret_decoded = len;
+
+  return TRUE;
+}
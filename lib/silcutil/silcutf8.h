@@ -208,4 +208,107 @@ SilcBool silc_utf8_strcasecmp(const char *s1, const char *s2);
  ***/
 SilcBool silc_utf8_strncasecmp(const char *s1, const char *s2, SilcUInt32 n);
 
+/****s* silcutil/SilcUTF8Valid
+ *
+ * NAME
+ *
+ *    typedef struct SilcUTF8ValidStruct *SilcUTF8Valid, SilcUTF8ValidStruct;
+ *
+ * DESCRIPTION
+ *
+ *    Incremental UTF-8 validation context for validating data arriving
+ *    in chunks without buffering it whole.  A multibyte sequence split
+ *    across chunks is carried in the context.  Initialize with
+ *    silc_utf8_valid_init, feed chunks with silc_utf8_valid_update and
+ *    finish with silc_utf8_valid_final.
+ *
+ * SOURCE
+ */
+typedef struct SilcUTF8ValidStruct {
+  SilcUInt32 need;		   /* Continuation bytes still expected */
+} *SilcUTF8Valid, SilcUTF8ValidStruct;
+/***/
+
+/****f* silcutil/silc_utf8_valid_init
+ *
+ * SYNOPSIS
+ *
+ *    void silc_utf8_valid_init(SilcUTF8Valid ctx);
+ *
+ * DESCRIPTION
+ *
+ *    Initializes the incremental UTF-8 validation context.
+ *
+ ***/
+void silc_utf8_valid_init(SilcUTF8Valid ctx);
+
+/****f* silcutil/silc_utf8_valid_update
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_utf8_valid_update(SilcUTF8Valid ctx,
+ *                                    const unsigned char *data,
+ *                                    SilcUInt32 data_len);
+ *
+ * DESCRIPTION
+ *
+ *    Validates one chunk of UTF-8 data, carrying sequences split at the
+ *    chunk boundary to the next call.  Returns FALSE as soon as the
+ *    data cannot be valid UTF-8.
+ *
+ ***/
+SilcBool silc_utf8_valid_update(SilcUTF8Valid ctx,
+				const unsigned char *data,
+				SilcUInt32 data_len);
+
+/****f* silcutil/silc_utf8_valid_final
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_utf8_valid_final(SilcUTF8Valid ctx);
+ *
+ * DESCRIPTION
+ *
+ *    Finishes incremental validation.  Returns FALSE if the data ended
+ *    in the middle of a multibyte sequence.
+ *
+ ***/
+SilcBool silc_utf8_valid_final(SilcUTF8Valid ctx);
+
+/****f* silcutil/silc_utf8_encode_buffer
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_utf8_encode_buffer(const unsigned char *bin,
+ *                                     SilcUInt32 bin_len,
+ *                                     SilcStringEncoding bin_encoding,
+ *                                     SilcBuffer dest,
+ *                                     SilcUInt32 *ret_encoded);
+ *    SilcBool silc_utf8_decode_buffer(const unsigned char *utf8,
+ *                                     SilcUInt32 utf8_len,
+ *                                     SilcStringEncoding bin_encoding,
+ *                                     SilcBuffer dest,
+ *                                     SilcUInt32 *ret_decoded);
+ *
+ * DESCRIPTION
+ *
+ *    Single-pass conversion variants of silc_utf8_encode and
+ *    silc_utf8_decode.  Instead of computing the converted length
+ *    with a separate scan first, worst-case room is reserved in the
+ *    destination buffer (which may be heap or stack backed) and the
+ *    conversion appends to it in one pass, returning the produced
+ *    byte count into `ret_encoded'/`ret_decoded'.  On a reused
+ *    per-connection buffer the reservation costs nothing after the
+ *    first message, halving the transcoding work per message.
+ *
+ ***/
+SilcBool silc_utf8_encode_buffer(const unsigned char *bin,
+				 SilcUInt32 bin_len,
+				 SilcStringEncoding bin_encoding,
+				 SilcBuffer dest, SilcUInt32 *ret_encoded);
+SilcBool silc_utf8_decode_buffer(const unsigned char *utf8,
+				 SilcUInt32 utf8_len,
+				 SilcStringEncoding bin_encoding,
+				 SilcBuffer dest, SilcUInt32 *ret_decoded);
+
 #endif /* SILCUTF8_H */
@@ -386,63 +386,52 @@ char *silc_get_input(const char *prompt, SilcBool echo_off)
 void silc_hexdump(const unsigned char *data, SilcUInt32 data_len,
 		  FILE *output)
 {
-  int i, k;
-  int off, pos, count;
-  int len = data_len;
-
-  k = 0;
-  pos = 0;
-  count = 16;
-  off = len % 16;
-  while (1) {
-    if (off) {
-      if ((len - pos) < 16 && (len - pos <= len - off))
-	count = off;
-    } else {
-      if (pos == len)
-	count = 0;
-    }
-    if (off == len)
-      count = len;
+  static const char hexd[] = "0123456789ABCDEF";
+  char line[80], *p;
+  SilcUInt32 pos = 0, count, i, off;
+
+  /* Each line is composed into one buffer with table driven nibble
+     expansion and written with a single fwrite, instead of a formatted
+     print per byte. */
+  while (pos < data_len || (!pos && !data_len)) {
+    if (!data_len)
+      break;
 
-    if (count)
-      fprintf(output, "%08X  ", k++ * 16);
+    count = data_len - pos < 16 ? data_len - pos : 16;
+    p = line;
 
-    for (i = 0; i < count; i++) {
-      fprintf(output, "%02X ", data[pos + i]);
+    /* Offset */
+    off = pos;
+    for (i = 0; i < 8; i++)
+      *p++ = hexd[(off >> (28 - i * 4)) & 0xf];
+    *p++ = ' ';
+    *p++ = ' ';
 
+    /* Hex bytes in groups of four */
+    for (i = 0; i < count; i++) {
+      *p++ = hexd[data[pos + i] >> 4];
+      *p++ = hexd[data[pos + i] & 0xf];
+      *p++ = ' ';
       if ((i + 1) % 4 == 0)
-	fprintf(output, " ");
+	*p++ = ' ';
     }
-
-    if (count && count < 16) {
-      int j;
-
-      for (j = 0; j < 16 - count; j++) {
-	fprintf(output, "   ");
-
-	if ((j + count + 1) % 4 == 0)
-	  fprintf(output, " ");
-      }
+    for (i = count; i < 16; i++) {
+      *p++ = ' ';
+      *p++ = ' ';
+      *p++ = ' ';
+      if ((i + 1) % 4 == 0)
+	*p++ = ' ';
     }
 
+    /* ASCII */
     for (i = 0; i < count; i++) {
-      char ch;
-
-      if (data[pos] < 32 || data[pos] >= 127)
-	ch = '.';
-      else
-	ch = data[pos];
-
-      fprintf(output, "%c", ch);
-      pos++;
+      unsigned char ch = data[pos + i];
+      *p++ = (ch < 32 || ch >= 127) ? '.' : (char)ch;
     }
+    *p++ = '\n';
 
-    if (count)
-      fprintf(output, "\n");
-
-    if (count < 16)
-      break;
+    fwrite(line, 1, p - line, output);
+    pos += count;
   }
 }
 
@@ -19,12 +19,25 @@
 
 #include <silcruntime.h>
 
+/* Queued pull parser event */
+typedef struct SilcXMLEventInternalStruct {
+  struct SilcXMLEventInternalStruct *next;
+  SilcXMLEventStruct event;
+} *SilcXMLEventInternal;
+
 /* XML parser context */
 struct SilcXMLParserStruct {
   void *parser;			       /* Parser implementation */
   SilcXMLParserHandlerStruct handler;  /* Handler */
   void *context;		       /* User context */
   SilcXMLParamsStruct params;	       /* Parser parameters */
+  SilcHashTable attrs;		       /* Reused attribute table */
+  SilcStack stack;		       /* Pull mode event stack */
+  SilcStackFrame frame;		       /* Current event batch frame */
+  SilcXMLEventInternal events;	       /* Queued events, head */
+  SilcXMLEventInternal events_tail;    /* Queued events, tail */
+  unsigned int pull         : 1;       /* Pull mode parser */
+  unsigned int frame_pushed : 1;       /* Event batch frame is pushed */
 };
 
 #ifdef HAVE_EXPAT_H
@@ -70,13 +83,18 @@ static void silc_xml_expat_start_element(void *userData,
   int i;
 
   if (atts && atts[0]) {
-    t = silc_hash_table_alloc(NULL, 0, silc_hash_utf8_string, NULL,
-			      silc_hash_utf8_compare, NULL,
-			      NULL, NULL, TRUE);
-    if (!t) {
-      XML_StopParser(parser->parser, FALSE);
-      return;
+    /* The attribute table is reused between elements; with the entry
+       node recycler an element costs no allocations after warmup. */
+    if (!parser->attrs) {
+      parser->attrs = silc_hash_table_alloc(NULL, 0, silc_hash_utf8_string,
+					    NULL, silc_hash_utf8_compare,
+					    NULL, NULL, NULL, TRUE);
+      if (!parser->attrs) {
+	XML_StopParser(parser->parser, FALSE);
+	return;
+      }
     }
+    t = parser->attrs;
 
     for (i = 0; atts[i]; i += 2)
       silc_hash_table_add(t, (void *)atts[i], (void *)atts[i + 1]);
@@ -86,7 +104,8 @@ static void silc_xml_expat_start_element(void *userData,
     parser->handler.start_element(parser, name, t, parser->context);
 
   if (t)
-    silc_hash_table_free(t);
+    for (i = 0; atts[i]; i += 2)
+      silc_hash_table_del(t, (void *)atts[i]);
 }
 
 /* End element */
@@ -182,11 +201,59 @@ void silc_xml_parser_free(SilcXMLParser parser)
 
   if (parser->parser)
     XML_ParserFree(parser->parser);
+  if (parser->attrs)
+    silc_hash_table_free(parser->attrs);
+  if (parser->stack) {
+    if (parser->frame_pushed)
+      silc_stack_pop(parser->stack);
+    silc_stack_free(parser->stack);
+  }
   silc_free(parser);
 }
 
 /* Parse */
 
+/* Parse XML data from a stream in chunks */
+
+SilcBool silc_xml_parse_stream(SilcXMLParser parser, SilcStream stream)
+{
+  unsigned char buf[8192];
+  int ret, len;
+
+  SILC_LOG_DEBUG(("Parse XML stream with parser %p", parser));
+
+  if (!parser || !stream) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* Feed the parser a chunk at a time; the whole document is never
+     buffered in memory. */
+  for (;;) {
+    len = silc_stream_read(stream, buf, sizeof(buf));
+    if (len == -1) {
+      /* The stream must be readable to the end without blocking */
+      silc_set_errno(SILC_ERR_WOULD_BLOCK);
+      return FALSE;
+    }
+    if (len == -2)
+      return FALSE;
+
+    ret = XML_Parse(parser->parser, (const char *)buf,
+		    len > 0 ? len : 0, len == 0);
+    if (!ret) {
+      silc_set_errno_reason(silc_xml_expat_error(parser->parser),
+			    silc_xml_get_error(parser));
+      return FALSE;
+    }
+
+    if (len == 0)
+      break;
+  }
+
+  return TRUE;
+}
+
 SilcBool silc_xml_parse(SilcXMLParser parser,
 			const unsigned char *data,
 			SilcUInt32 data_len)
@@ -247,6 +314,216 @@ SilcBool silc_xml_parse_file(SilcXMLParser parser,
   return ret;
 }
 
+/***************************** Pull parser **********************************/
+
+/* Queues a pull event.  The event and all its strings live in the
+   parser's stack until the next silc_xml_pull_feed call. */
+
+static SilcXMLEvent silc_xml_pull_queue(SilcXMLParser parser,
+					SilcXMLEventType type)
+{
+  SilcXMLEventInternal e;
+
+  e = silc_scalloc(parser->stack, 1, sizeof(*e));
+  if (!e) {
+    XML_StopParser(parser->parser, FALSE);
+    return NULL;
+  }
+
+  e->event.type = type;
+
+  if (parser->events_tail)
+    parser->events_tail->next = e;
+  else
+    parser->events = e;
+  parser->events_tail = e;
+
+  return &e->event;
+}
+
+/* Start element, pull mode */
+
+static void silc_xml_pull_start_element(void *userData,
+					const XML_Char *name,
+					const XML_Char **atts)
+{
+  SilcXMLParser parser = userData;
+  SilcXMLEvent event;
+  SilcUInt32 i, c;
+  const char **attrs;
+
+  event = silc_xml_pull_queue(parser, SILC_XML_EVENT_START_ELEMENT);
+  if (!event)
+    return;
+
+  event->name = silc_sstrdup(parser->stack, (char *)name);
+
+  if (atts && atts[0]) {
+    for (c = 0; atts[c]; c++)
+      ;
+    attrs = silc_scalloc(parser->stack, c + 1, sizeof(*attrs));
+    if (attrs) {
+      for (i = 0; i < c; i++)
+	attrs[i] = silc_sstrdup(parser->stack, (char *)atts[i]);
+      event->attributes = attrs;
+    }
+  }
+}
+
+/* End element, pull mode */
+
+static void silc_xml_pull_end_element(void *userData, const XML_Char *name)
+{
+  SilcXMLParser parser = userData;
+  SilcXMLEvent event;
+
+  event = silc_xml_pull_queue(parser, SILC_XML_EVENT_END_ELEMENT);
+  if (!event)
+    return;
+
+  event->name = silc_sstrdup(parser->stack, (char *)name);
+}
+
+/* Character data, pull mode */
+
+static void silc_xml_pull_data(void *userData, const XML_Char *s, int len)
+{
+  SilcXMLParser parser = userData;
+  SilcXMLEvent event;
+
+  event = silc_xml_pull_queue(parser, SILC_XML_EVENT_DATA);
+  if (!event)
+    return;
+
+  event->data = silc_smemdup(parser->stack, s, len);
+  event->data_len = (SilcUInt32)len;
+}
+
+/* Processing instruction, pull mode */
+
+static void silc_xml_pull_pi(void *userData, const XML_Char *target,
+			     const XML_Char *data)
+{
+  SilcXMLParser parser = userData;
+  SilcXMLEvent event;
+
+  event = silc_xml_pull_queue(parser, SILC_XML_EVENT_PI);
+  if (!event)
+    return;
+
+  event->pi_target = silc_sstrdup(parser->stack, (char *)target);
+  event->pi_data = silc_sstrdup(parser->stack, (char *)data);
+}
+
+/* Create pull parser */
+
+SilcXMLParser silc_xml_parser_create_pull(SilcXMLParams params)
+{
+  SilcXMLParser parser;
+  XML_Parser ep = NULL;
+
+  parser = silc_calloc(1, sizeof(*parser));
+  if (!parser)
+    return NULL;
+
+  SILC_LOG_DEBUG(("Allocated XML pull parser %p", parser));
+
+  if (params)
+    parser->params = *params;
+  parser->pull = TRUE;
+
+  parser->stack = silc_stack_alloc(0, NULL);
+  if (!parser->stack) {
+    silc_free(parser);
+    return NULL;
+  }
+
+  if (parser->params.no_namespace)
+    ep = XML_ParserCreate("UTF-8");
+  else
+    ep = XML_ParserCreateNS("UTF-8", '\0');
+
+  if (!ep) {
+    silc_set_errno(SILC_ERR_OUT_OF_MEMORY);
+    silc_stack_free(parser->stack);
+    silc_free(parser);
+    return NULL;
+  }
+
+  parser->parser = ep;
+
+  XML_SetUserData(ep, parser);
+  XML_SetElementHandler(ep, silc_xml_pull_start_element,
+			silc_xml_pull_end_element);
+  XML_SetCharacterDataHandler(ep, silc_xml_pull_data);
+  XML_SetProcessingInstructionHandler(ep, silc_xml_pull_pi);
+
+  return parser;
+}
+
+/* Feed data to pull parser */
+
+SilcBool silc_xml_pull_feed(SilcXMLParser parser,
+			    const unsigned char *data,
+			    SilcUInt32 data_len, SilcBool final)
+{
+  int ret;
+
+  if (!parser || !parser->pull || (!data && data_len)) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  /* Events of the previous batch have been consumed; release their
+     memory and start a new batch. */
+  if (!parser->events && parser->frame_pushed) {
+    silc_stack_pop(parser->stack);
+    parser->frame_pushed = FALSE;
+  }
+  if (!parser->frame_pushed) {
+    silc_stack_push(parser->stack, &parser->frame);
+    parser->frame_pushed = TRUE;
+  }
+
+  ret = XML_Parse(parser->parser, (const char *)data, (int)data_len,
+		  final);
+  if (!ret) {
+    silc_set_errno_reason(silc_xml_expat_error(parser->parser),
+			  silc_xml_get_error(parser));
+    return FALSE;
+  }
+
+  if (final)
+    silc_xml_pull_queue(parser, SILC_XML_EVENT_END_DOCUMENT);
+
+  return TRUE;
+}
+
+/* Return next event */
+
+SilcXMLEvent silc_xml_next(SilcXMLParser parser)
+{
+  SilcXMLEventInternal e;
+
+  if (!parser || !parser->pull) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  e = parser->events;
+  if (!e) {
+    /* All buffered events consumed; caller feeds more data */
+    silc_set_errno(SILC_ERR_EOF);
+    return NULL;
+  }
+
+  parser->events = e->next;
+  if (!parser->events)
+    parser->events_tail = NULL;
+
+  return &e->event;
+}
+
 /* Get attribute */
 
 const char *silc_xml_get_attribute(SilcXMLParser parser,
@@ -277,3 +554,221 @@ void silc_xml_current_location(SilcXMLParser parser,
 }
 
 #endif /* HAVE_EXPAT_H */
+
+/****************************** XML writer *********************************/
+
+/* Entity escaping table; nonzero entries need escaping */
+static const char * const silc_xml_entities[256] = {
+  ['&'] = "&amp;", ['<'] = "&lt;", ['>'] = "&gt;",
+  ['"'] = "&quot;", ['\''] = "&apos;",
+};
+
+/* XML writer context */
+struct SilcXMLWriterStruct {
+  SilcBuffer buffer;		       /* Output buffer */
+  char **stack;		               /* Open element names */
+  SilcUInt32 depth;		       /* Open element count */
+  SilcUInt32 stack_size;	       /* Allocated stack entries */
+  unsigned int in_tag : 1;	       /* Start tag is still open */
+};
+
+/* Appends raw bytes to the output */
+
+static SilcBool silc_xml_writer_put(SilcXMLWriter writer,
+				    const char *data, SilcUInt32 data_len)
+{
+  SilcBuffer buf = writer->buffer;
+
+  if (silc_buffer_taillen(buf) < data_len)
+    if (!silc_buffer_realloc(buf, silc_buffer_truelen(buf) + data_len +
+			     1024))
+      return FALSE;
+  memcpy(buf->tail, data, data_len);
+  silc_buffer_pull_tail(buf, data_len);
+
+  return TRUE;
+}
+
+/* Appends escaped text: clean spans are bulk copied and only the five
+   special characters go through the entity table. */
+
+static SilcBool silc_xml_writer_escape(SilcXMLWriter writer,
+				       const unsigned char *data,
+				       SilcUInt32 data_len)
+{
+  SilcUInt32 i, span = 0;
+  const char *ent;
+
+  for (i = 0; i < data_len; i++) {
+    ent = silc_xml_entities[data[i]];
+    if (!ent) {
+      span++;
+      continue;
+    }
+    if (span && !silc_xml_writer_put(writer,
+				     (const char *)data + i - span, span))
+      return FALSE;
+    if (!silc_xml_writer_put(writer, ent, strlen(ent)))
+      return FALSE;
+    span = 0;
+  }
+
+  if (span)
+    return silc_xml_writer_put(writer, (const char *)data + data_len - span,
+			       span);
+
+  return TRUE;
+}
+
+/* Closes a pending start tag */
+
+static SilcBool silc_xml_writer_close_tag(SilcXMLWriter writer)
+{
+  if (!writer->in_tag)
+    return TRUE;
+  writer->in_tag = FALSE;
+  return silc_xml_writer_put(writer, ">", 1);
+}
+
+/* Allocate writer */
+
+SilcXMLWriter silc_xml_writer_alloc(SilcBuffer buffer)
+{
+  SilcXMLWriter writer;
+
+  if (!buffer) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  writer = silc_calloc(1, sizeof(*writer));
+  if (!writer)
+    return NULL;
+
+  writer->buffer = buffer;
+
+  return writer;
+}
+
+/* Free writer */
+
+void silc_xml_writer_free(SilcXMLWriter writer)
+{
+  SilcUInt32 i;
+
+  if (!writer)
+    return;
+
+  for (i = 0; i < writer->depth; i++)
+    silc_free(writer->stack[i]);
+  silc_free(writer->stack);
+  silc_free(writer);
+}
+
+/* Open element */
+
+SilcBool silc_xml_writer_start_element(SilcXMLWriter writer,
+				       const char *name)
+{
+  if (!writer || !name) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!silc_xml_writer_close_tag(writer))
+    return FALSE;
+
+  if (writer->depth == writer->stack_size) {
+    char **ns = silc_realloc(writer->stack,
+			     (writer->stack_size + 16) * sizeof(*ns));
+    if (!ns)
+      return FALSE;
+    writer->stack = ns;
+    writer->stack_size += 16;
+  }
+
+  writer->stack[writer->depth] = silc_strdup(name);
+  if (!writer->stack[writer->depth])
+    return FALSE;
+  writer->depth++;
+
+  if (!silc_xml_writer_put(writer, "<", 1) ||
+      !silc_xml_writer_put(writer, name, strlen(name)))
+    return FALSE;
+  writer->in_tag = TRUE;
+
+  return TRUE;
+}
+
+/* Emit attribute; valid only right after silc_xml_writer_start_element */
+
+SilcBool silc_xml_writer_attribute(SilcXMLWriter writer, const char *name,
+				   const char *value)
+{
+  if (!writer || !name || !value || !writer->in_tag) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!silc_xml_writer_put(writer, " ", 1) ||
+      !silc_xml_writer_put(writer, name, strlen(name)) ||
+      !silc_xml_writer_put(writer, "=\"", 2) ||
+      !silc_xml_writer_escape(writer, (const unsigned char *)value,
+			      strlen(value)) ||
+      !silc_xml_writer_put(writer, "\"", 1))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Emit escaped character data */
+
+SilcBool silc_xml_writer_data(SilcXMLWriter writer,
+			      const unsigned char *data,
+			      SilcUInt32 data_len)
+{
+  if (!writer || !data) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (!silc_xml_writer_close_tag(writer))
+    return FALSE;
+
+  return silc_xml_writer_escape(writer, data, data_len);
+}
+
+/* Close the innermost open element */
+
+SilcBool silc_xml_writer_end_element(SilcXMLWriter writer)
+{
+  char *name;
+
+  if (!writer || !writer->depth) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  name = writer->stack[--writer->depth];
+
+  if (writer->in_tag) {
+    /* Nothing was written inside; emit the empty element form */
+    writer->in_tag = FALSE;
+    if (!silc_xml_writer_put(writer, "/>", 2)) {
+      silc_free(name);
+      return FALSE;
+    }
+    silc_free(name);
+    return TRUE;
+  }
+
+  if (!silc_xml_writer_put(writer, "</", 2) ||
+      !silc_xml_writer_put(writer, name, strlen(name)) ||
+      !silc_xml_writer_put(writer, ">", 1)) {
+    silc_free(name);
+    return FALSE;
+  }
+
+  silc_free(name);
+  return TRUE;
+}
@@ -242,4 +242,248 @@ void silc_xml_current_location(SilcXMLParser parser,
 			       SilcUInt32 *current_line,
 			       SilcUInt32 *current_column);
 
+/****f* silcutil/silc_xml_parse_stream
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_xml_parse_stream(SilcXMLParser parser,
+ *                                   SilcStream stream);
+ *
+ * DESCRIPTION
+ *
+ *    As silc_xml_parse but reads the document from `stream' in fixed
+ *    size chunks until end of stream, so arbitrarily large documents
+ *    parse with bounded memory.  The stream must be readable to its end
+ *    without blocking (for example a file fd stream).  Returns FALSE on
+ *    parse or stream error.
+ *
+ ***/
+SilcBool silc_xml_parse_stream(SilcXMLParser parser, SilcStream stream);
+
+/****d* silcutil/SilcXMLEventType
+ *
+ * NAME
+ *
+ *    typedef enum { ... } SilcXMLEventType;
+ *
+ * DESCRIPTION
+ *
+ *    Pull parser event types returned by silc_xml_next.
+ *
+ * SOURCE
+ */
+typedef enum {
+  SILC_XML_EVENT_START_ELEMENT,	       /* Start of element */
+  SILC_XML_EVENT_END_ELEMENT,	       /* End of element */
+  SILC_XML_EVENT_DATA,		       /* Character data */
+  SILC_XML_EVENT_PI,		       /* Processing instruction */
+  SILC_XML_EVENT_END_DOCUMENT,	       /* End of document */
+} SilcXMLEventType;
+/***/
+
+/****s* silcutil/SilcXMLEvent
+ *
+ * NAME
+ *
+ *    typedef struct SilcXMLEventObject { ... }
+ *                                 *SilcXMLEvent, SilcXMLEventStruct;
+ *
+ * DESCRIPTION
+ *
+ *    One pull parser event.  Which fields are valid depends on the
+ *    event type: `name' for elements, `attributes' (a NULL-terminated
+ *    list of name/value string pairs, or NULL) for start of element,
+ *    `data' and `data_len' for character data, `pi_target' and
+ *    `pi_data' for processing instructions.  The event and all strings
+ *    in it are valid only until the next silc_xml_pull_feed call.
+ *
+ * SOURCE
+ */
+typedef struct SilcXMLEventObject {
+  SilcXMLEventType type;	       /* Event type */
+  const char *name;		       /* Element name */
+  const char **attributes;	       /* Attribute name/value pairs */
+  const unsigned char *data;	       /* Character data */
+  SilcUInt32 data_len;		       /* Character data length */
+  const char *pi_target;	       /* Processing instruction target */
+  const char *pi_data;		       /* Processing instruction data */
+} *SilcXMLEvent, SilcXMLEventStruct;
+/***/
+
+/****f* silcutil/silc_xml_parser_create_pull
+ *
+ * SYNOPSIS
+ *
+ *    SilcXMLParser silc_xml_parser_create_pull(SilcXMLParams params);
+ *
+ * DESCRIPTION
+ *
+ *    Creates an XML pull parser.  Instead of delivering the document
+ *    through callbacks the parser is fed data with silc_xml_pull_feed
+ *    and parsed events are read back with silc_xml_next, which suits
+ *    protocol code that wants to drive the parse itself.  All event
+ *    data is allocated from an internal per-document stack, not the
+ *    heap.  Freed with silc_xml_parser_free.
+ *
+ ***/
+SilcXMLParser silc_xml_parser_create_pull(SilcXMLParams params);
+
+/****f* silcutil/silc_xml_pull_feed
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_xml_pull_feed(SilcXMLParser parser,
+ *                                const unsigned char *data,
+ *                                SilcUInt32 data_len, SilcBool final);
+ *
+ * DESCRIPTION
+ *
+ *    Feeds the next chunk of the document to a pull parser; `final'
+ *    is TRUE with the last chunk.  The parse is resumable across
+ *    chunks: elements may be split at any byte boundary.  Feeding
+ *    releases the events of the previous chunk, so all events must
+ *    have been read with silc_xml_next before the next feed.  Returns
+ *    FALSE on parse error.
+ *
+ ***/
+SilcBool silc_xml_pull_feed(SilcXMLParser parser,
+			    const unsigned char *data,
+			    SilcUInt32 data_len, SilcBool final);
+
+/****f* silcutil/silc_xml_next
+ *
+ * SYNOPSIS
+ *
+ *    SilcXMLEvent silc_xml_next(SilcXMLParser parser);
+ *
+ * DESCRIPTION
+ *
+ *    Returns the next parsed event, or NULL with silc_errno set to
+ *    SILC_ERR_EOF when all events of the fed data have been consumed
+ *    and more data must be fed.  After the SILC_XML_EVENT_END_DOCUMENT
+ *    event the document is complete.  The returned event is valid
+ *    until the next silc_xml_pull_feed call.
+ *
+ ***/
+SilcXMLEvent silc_xml_next(SilcXMLParser parser);
+
+/****s* silcutil/SilcXMLWriter
+ *
+ * NAME
+ *
+ *    typedef struct SilcXMLWriterStruct *SilcXMLWriter;
+ *
+ * DESCRIPTION
+ *
+ *    An XML writer allocated by silc_xml_writer_alloc.  The writer
+ *    appends well-formed XML to a caller buffer with element push/pop
+ *    calls; all text and attribute values are entity escaped, with
+ *    clean spans bulk copied so escaping is not the bottleneck of
+ *    large exports.
+ *
+ * EXAMPLE
+ *
+ *    writer = silc_xml_writer_alloc(buf);
+ *    silc_xml_writer_start_element(writer, "record");
+ *    silc_xml_writer_attribute(writer, "id", "42");
+ *    silc_xml_writer_data(writer, data, data_len);
+ *    silc_xml_writer_end_element(writer);
+ *    silc_xml_writer_free(writer);
+ *
+ ***/
+typedef struct SilcXMLWriterStruct *SilcXMLWriter;
+
+/****f* silcutil/silc_xml_writer_alloc
+ *
+ * SYNOPSIS
+ *
+ *    SilcXMLWriter silc_xml_writer_alloc(SilcBuffer buffer);
+ *
+ * DESCRIPTION
+ *
+ *    Allocates an XML writer appending to `buffer', which must remain
+ *    valid for the writer's lifetime.  Freed with
+ *    silc_xml_writer_free; the buffer is the caller's.
+ *
+ ***/
+SilcXMLWriter silc_xml_writer_alloc(SilcBuffer buffer);
+
+/****f* silcutil/silc_xml_writer_free
+ *
+ * SYNOPSIS
+ *
+ *    void silc_xml_writer_free(SilcXMLWriter writer);
+ *
+ * DESCRIPTION
+ *
+ *    Frees the writer.  Elements still open are not closed.
+ *
+ ***/
+void silc_xml_writer_free(SilcXMLWriter writer);
+
+/****f* silcutil/silc_xml_writer_start_element
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_xml_writer_start_element(SilcXMLWriter writer,
+ *                                           const char *name);
+ *
+ * DESCRIPTION
+ *
+ *    Opens element `name'.  Attributes may be emitted until the first
+ *    child element or character data.  Returns FALSE on memory
+ *    allocation error.
+ *
+ ***/
+SilcBool silc_xml_writer_start_element(SilcXMLWriter writer,
+				       const char *name);
+
+/****f* silcutil/silc_xml_writer_attribute
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_xml_writer_attribute(SilcXMLWriter writer,
+ *                                       const char *name,
+ *                                       const char *value);
+ *
+ * DESCRIPTION
+ *
+ *    Emits an attribute on the element just opened.  The value is
+ *    entity escaped.
+ *
+ ***/
+SilcBool silc_xml_writer_attribute(SilcXMLWriter writer, const char *name,
+				   const char *value);
+
+/****f* silcutil/silc_xml_writer_data
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_xml_writer_data(SilcXMLWriter writer,
+ *                                  const unsigned char *data,
+ *                                  SilcUInt32 data_len);
+ *
+ * DESCRIPTION
+ *
+ *    Emits entity-escaped character data inside the open element.
+ *
+ ***/
+SilcBool silc_xml_writer_data(SilcXMLWriter writer,
+			      const unsigned char *data,
+			      SilcUInt32 data_len);
+
+/****f* silcutil/silc_xml_writer_end_element
+ *
+ * SYNOPSIS
+ *
+ *    SilcBool silc_xml_writer_end_element(SilcXMLWriter writer);
+ *
+ * DESCRIPTION
+ *
+ *    Closes the innermost open element, using the empty element form
+ *    when nothing was written inside it.
+ *
+ ***/
+SilcBool silc_xml_writer_end_element(SilcXMLWriter writer);
+
 #endif /* SILCXML_H */
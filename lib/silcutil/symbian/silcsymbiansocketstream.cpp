@@ -319,6 +319,30 @@ int silc_socket_stream_write(SilcStream stream, const unsigned char *data,
   return ret_len();
 }
 
+/* Stream writev operation.  Writes the segments with consecutive
+   silc_socket_stream_write calls. */
+
+int silc_socket_stream_writev(SilcStream stream, SilcStreamIOVec *iov,
+			      SilcUInt32 iov_count)
+{
+  int ret, total = 0;
+  SilcUInt32 i;
+
+  for (i = 0; i < iov_count; i++) {
+    ret = silc_socket_stream_write(stream, iov[i].data, iov[i].data_len);
+    if (ret <= 0) {
+      if (total)
+	return total;
+      return ret;
+    }
+    total += ret;
+    if ((SilcUInt32)ret < iov[i].data_len)
+      break;
+  }
+
+  return total;
+}
+
 /* Receive UDP packet, connected socket. */
 
 int silc_socket_udp_stream_read(SilcStream stream, unsigned char *buf,
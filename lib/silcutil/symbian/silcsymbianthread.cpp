@@ -212,6 +212,11 @@ SilcBool silc_mutex_alloc(SilcMutex *mutex)
 #endif /* SILC_THREADS */
 }
 
+SilcBool silc_mutex_alloc_adaptive(SilcMutex *mutex)
+{
+  return silc_mutex_alloc(mutex);
+}
+
 void silc_mutex_free(SilcMutex mutex)
 {
 #ifdef SILC_THREADS
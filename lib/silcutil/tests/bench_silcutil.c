@@ -0,0 +1,190 @@
+/* SILC Runtime Toolkit microbenchmarks */
+
+#include "silcruntime.h"
+
+int rounds = 1000000;
+
+/* Returns nanoseconds per operation */
+
+static double bench_report(const char *name, SilcTimer timer, int ops)
+{
+  SilcUInt64 sec;
+  SilcUInt32 usec;
+  double ns;
+
+  silc_timer_value(timer, &sec, &usec);
+  ns = ((double)sec * 1000000000.0 + (double)usec * 1000.0) / (double)ops;
+  fprintf(stderr, "%-28s %10.1f ns/op  %12.0f ops/s\n", name, ns,
+	  1000000000.0 / ns);
+  return ns;
+}
+
+static void bench_snprintf(void)
+{
+  SilcTimerStruct timer;
+  char buf[128];
+  int i;
+
+  silc_timer_start(&timer);
+  for (i = 0; i < rounds; i++)
+    silc_snprintf(buf, sizeof(buf), "fd=%d err=%s count=%u", i, "none",
+		  (unsigned int)i);
+  silc_timer_stop(&timer);
+  bench_report("silc_snprintf simple", &timer, rounds);
+}
+
+static void bench_hash_table(void)
+{
+  SilcTimerStruct timer;
+  SilcHashTable t;
+  void *val;
+  int i;
+
+  t = silc_hash_table_alloc(NULL, 0, silc_hash_uint, NULL, NULL, NULL,
+			    NULL, NULL, TRUE);
+
+  silc_timer_start(&timer);
+  for (i = 0; i < rounds; i++)
+    silc_hash_table_add(t, SILC_32_TO_PTR(i + 1), SILC_32_TO_PTR(i));
+  silc_timer_stop(&timer);
+  bench_report("hash table add", &timer, rounds);
+
+  silc_timer_start(&timer);
+  for (i = 0; i < rounds; i++)
+    silc_hash_table_find(t, SILC_32_TO_PTR(i + 1), NULL, &val);
+  silc_timer_stop(&timer);
+  bench_report("hash table find", &timer, rounds);
+
+  silc_hash_table_free(t);
+
+  t = silc_hash_table_alloc_flat(NULL, 0, silc_hash_uint, NULL, NULL, NULL,
+				 NULL, NULL);
+
+  silc_timer_start(&timer);
+  for (i = 0; i < rounds; i++)
+    silc_hash_table_add(t, SILC_32_TO_PTR(i + 1), SILC_32_TO_PTR(i));
+  silc_timer_stop(&timer);
+  bench_report("flat hash table add", &timer, rounds);
+
+  silc_timer_start(&timer);
+  for (i = 0; i < rounds; i++)
+    silc_hash_table_find(t, SILC_32_TO_PTR(i + 1), NULL, &val);
+  silc_timer_stop(&timer);
+  bench_report("flat hash table find", &timer, rounds);
+
+  silc_hash_table_free(t);
+}
+
+static void bench_buffer_format(void)
+{
+  SilcTimerStruct timer;
+  SilcBufferFormat fmt;
+  SilcBufferStruct buf;
+  unsigned char data[16], payload[32];
+  int i;
+
+  memset(payload, 0xaa, sizeof(payload));
+  memset(&buf, 0, sizeof(buf));
+
+  silc_timer_start(&timer);
+  for (i = 0; i < rounds; i++) {
+    silc_buffer_set(&buf, data, sizeof(data));
+    silc_buffer_format(&buf,
+		       SILC_STR_UINT32(i),
+		       SILC_STR_UINT32(i + 1),
+		       SILC_STR_UINT16(7),
+		       SILC_STR_END);
+  }
+  silc_timer_stop(&timer);
+  bench_report("silc_buffer_format", &timer, rounds);
+
+  fmt = silc_buffer_format_compile(SILC_PARAM_UINT32, SILC_PARAM_UINT32,
+				   SILC_PARAM_UINT16, SILC_PARAM_END);
+  if (fmt) {
+    SilcBuffer b = silc_buffer_alloc(4096);
+
+    silc_timer_start(&timer);
+    for (i = 0; i < rounds; i++) {
+      silc_buffer_reset(b);
+      silc_buffer_format_exec(fmt, b, (SilcUInt32)i, (SilcUInt32)i + 1,
+			      (SilcUInt32)7);
+    }
+    silc_timer_stop(&timer);
+    bench_report("compiled format exec", &timer, rounds);
+
+    silc_buffer_free(b);
+    silc_buffer_format_free_compiled(fmt);
+  }
+}
+
+SILC_TASK_CALLBACK(bench_timeout_cb)
+{
+  /* Nothing */
+}
+
+static void bench_schedule(void)
+{
+  SilcTimerStruct timer;
+  SilcSchedule schedule;
+  SilcTask task;
+  int i, n = rounds / 10;
+
+  schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!schedule)
+    return;
+
+  silc_timer_start(&timer);
+  for (i = 0; i < n; i++) {
+    task = silc_schedule_task_add_timeout(schedule, bench_timeout_cb, NULL,
+					  10, 0);
+    if (task)
+      silc_schedule_task_del(schedule, task);
+  }
+  silc_timer_stop(&timer);
+  bench_report("timeout task add+del", &timer, n);
+
+  silc_schedule_stop(schedule);
+  silc_schedule_uninit(schedule);
+}
+
+static void bench_rand(void)
+{
+  SilcTimerStruct timer;
+  SilcRandGen rng;
+  unsigned char buf[64];
+  int i, n = rounds / 10;
+
+  silc_timer_start(&timer);
+  for (i = 0; i < n; i++)
+    silc_rand_bytes(buf, sizeof(buf));
+  silc_timer_stop(&timer);
+  bench_report("silc_rand_bytes 64B", &timer, n);
+
+  rng = silc_rand_alloc(1);
+  if (rng) {
+    silc_timer_start(&timer);
+    for (i = 0; i < n; i++)
+      silc_rand_gen_bytes(rng, buf, sizeof(buf));
+    silc_timer_stop(&timer);
+    bench_report("silc_rand_gen_bytes 64B", &timer, n);
+    silc_rand_free(rng);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+    rounds = atoi(argv[1]);
+
+  silc_runtime_init();
+
+  bench_snprintf();
+  bench_hash_table();
+  bench_buffer_format();
+  bench_schedule();
+  bench_rand();
+
+  silc_runtime_uninit();
+
+  return 0;
+}
@@ -0,0 +1,66 @@
+/* Bloom filter tests */
+
+#include "silcruntime.h"
+
+#define NUM_KEYS 10000
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcBloom bloom;
+  char key[32];
+  int i, fp = 0;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*bloom*");
+  }
+
+  bloom = silc_bloom_alloc(NUM_KEYS, 100);
+  if (!bloom)
+    goto err;
+
+  SILC_LOG_DEBUG(("Add %d keys", NUM_KEYS));
+  for (i = 0; i < NUM_KEYS; i++) {
+    silc_snprintf(key, sizeof(key), "key%d", i);
+    silc_bloom_add(bloom, key, strlen(key));
+  }
+
+  /* No false negatives, ever */
+  for (i = 0; i < NUM_KEYS; i++) {
+    silc_snprintf(key, sizeof(key), "key%d", i);
+    if (!silc_bloom_check(bloom, key, strlen(key)))
+      goto err;
+  }
+
+  /* False positive rate must be in the vicinity of the requested
+     1/100; allow generous slack */
+  for (i = 0; i < NUM_KEYS; i++) {
+    silc_snprintf(key, sizeof(key), "other%d", i);
+    if (silc_bloom_check(bloom, key, strlen(key)))
+      fp++;
+  }
+  SILC_LOG_DEBUG(("%d false positives of %d", fp, NUM_KEYS));
+  if (fp > NUM_KEYS / 20)
+    goto err;
+
+  SILC_LOG_DEBUG(("Clear filter"));
+  silc_bloom_clear(bloom);
+  if (silc_bloom_check(bloom, "key1", 4))
+    goto err;
+
+  silc_bloom_free(bloom);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
@@ -0,0 +1,102 @@
+/* LRU cache tests */
+
+#include "silcruntime.h"
+
+int destroyed = 0;
+
+static void destructor(SilcCache cache, const void *key, SilcUInt32 key_len,
+		       void *value, void *context)
+{
+  destroyed++;
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcCache cache;
+  char key[16];
+  void *val;
+  int i;
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_debug_hexdump(TRUE);
+    silc_log_set_debug_string("*cache*");
+  }
+
+  SILC_LOG_DEBUG(("Allocating cache, count cap 3"));
+  cache = silc_cache_alloc("test", 3, 0, 0, destructor, NULL);
+  if (!cache)
+    goto err;
+
+  if (!silc_cache_put(cache, "a", 1, SILC_32_TO_PTR(1), 0))
+    goto err;
+  if (!silc_cache_put(cache, "b", 1, SILC_32_TO_PTR(2), 0))
+    goto err;
+  if (!silc_cache_put(cache, "c", 1, SILC_32_TO_PTR(3), 0))
+    goto err;
+
+  SILC_LOG_DEBUG(("Touch 'a', insert fourth, 'b' must be evicted"));
+  if (!silc_cache_get(cache, "a", 1, &val) || SILC_PTR_TO_32(val) != 1)
+    goto err;
+  if (!silc_cache_put(cache, "d", 1, SILC_32_TO_PTR(4), 0))
+    goto err;
+  if (silc_cache_get(cache, "b", 1, &val))
+    goto err;
+  if (destroyed != 1)
+    goto err;
+  if (silc_cache_count(cache) != 3)
+    goto err;
+
+  SILC_LOG_DEBUG(("Replace existing key"));
+  if (!silc_cache_put(cache, "a", 1, SILC_32_TO_PTR(10), 0))
+    goto err;
+  if (!silc_cache_get(cache, "a", 1, &val) || SILC_PTR_TO_32(val) != 10)
+    goto err;
+  if (destroyed != 2)
+    goto err;
+
+  SILC_LOG_DEBUG(("Delete and flush"));
+  if (!silc_cache_del(cache, "c", 1))
+    goto err;
+  if (silc_cache_del(cache, "nosuch", 6))
+    goto err;
+  silc_cache_flush(cache);
+  if (silc_cache_count(cache) != 0)
+    goto err;
+
+  silc_cache_free(cache);
+
+  SILC_LOG_DEBUG(("Size-capped cache"));
+  destroyed = 0;
+  cache = silc_cache_alloc(NULL, 0, 100, 0, destructor, NULL);
+  if (!cache)
+    goto err;
+
+  for (i = 0; i < 200; i++) {
+    silc_snprintf(key, sizeof(key), "key%d", i);
+    if (!silc_cache_put(cache, key, strlen(key), SILC_32_TO_PTR(i + 1), 1))
+      goto err;
+  }
+  if (silc_cache_count(cache) != 100)
+    goto err;
+  if (destroyed != 100)
+    goto err;
+
+  /* The newest 100 must be present, the oldest evicted */
+  if (silc_cache_get(cache, "key0", 4, &val))
+    goto err;
+  if (!silc_cache_get(cache, "key199", 6, &val) ||
+      SILC_PTR_TO_32(val) != 200)
+    goto err;
+
+  silc_cache_free(cache);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  return !success;
+}
@@ -0,0 +1,124 @@
+/* Compression stream tests */
+
+#include "silcruntime.h"
+
+#define TEST_FILE "/tmp/test_silccompressstream.z"
+#define DATA_LEN 100000
+
+SilcSchedule schedule;
+
+/* File streams are always ready; the notifier is needed only so the
+   streams are scheduled */
+
+static void stream_notifier(SilcStream stream, SilcStreamStatus status,
+			    void *context)
+{
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcStream fd_stream, stream;
+  unsigned char *data = NULL, *plain = NULL;
+  SilcUInt32 i, off;
+  int fd, ret;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*compress*,*stream*");
+  }
+
+  unlink(TEST_FILE);
+
+  schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!schedule)
+    goto err;
+  silc_schedule_set_global(schedule);
+
+  /* Compressible test data */
+  data = silc_malloc(DATA_LEN);
+  plain = silc_malloc(DATA_LEN);
+  if (!data || !plain)
+    goto err;
+  for (i = 0; i < DATA_LEN; i++)
+    data[i] = "abcdefgh"[i % 8] + (i % 3);
+
+  SILC_LOG_DEBUG(("Compress to file"));
+  fd = silc_file_open_mode(TEST_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    goto err;
+  fd_stream = silc_fd_stream_create(fd, NULL);
+  if (!fd_stream)
+    goto err;
+  stream = silc_compress_stream_create(fd_stream, 6, NULL, 0);
+  if (!stream)
+    goto err;
+  silc_stream_set_notifier(stream, schedule, stream_notifier, NULL);
+
+  for (off = 0; off < DATA_LEN; off += 4096) {
+    ret = silc_stream_write(stream, data + off,
+			    DATA_LEN - off > 4096 ? 4096 : DATA_LEN - off);
+    if (ret <= 0)
+      goto err;
+  }
+  if (!silc_compress_stream_flush(stream))
+    goto err;
+  silc_stream_close(stream);
+  silc_stream_destroy(stream);
+  silc_stream_destroy(fd_stream);
+  silc_file_close(fd);
+
+  /* The file must be (much) smaller than the input */
+  if (silc_file_size(TEST_FILE) >= DATA_LEN / 2)
+    goto err;
+
+  SILC_LOG_DEBUG(("Decompress and compare"));
+  fd = silc_file_open(TEST_FILE, O_RDONLY);
+  if (fd < 0)
+    goto err;
+  fd_stream = silc_fd_stream_create(fd, NULL);
+  if (!fd_stream)
+    goto err;
+  stream = silc_compress_stream_create(fd_stream, 0, NULL, 0);
+  if (!stream)
+    goto err;
+  silc_stream_set_notifier(stream, schedule, stream_notifier, NULL);
+
+  off = 0;
+  while (off < DATA_LEN) {
+    ret = silc_stream_read(stream, plain + off, DATA_LEN - off);
+    if (ret == 0)
+      break;
+    if (ret < 0)
+      goto err;
+    off += ret;
+  }
+
+  if (off != DATA_LEN)
+    goto err;
+  if (memcmp(plain, data, DATA_LEN))
+    goto err;
+
+  silc_stream_destroy(stream);
+  silc_stream_destroy(fd_stream);
+  silc_file_close(fd);
+
+  silc_free(data);
+  silc_free(plain);
+  unlink(TEST_FILE);
+
+  silc_schedule_uninit(schedule);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
@@ -0,0 +1,99 @@
+/* Concurrent hash table tests */
+
+#include "silcruntime.h"
+#include "silcconcurrenthashtable.h"
+
+#define NUM_THREADS 4
+#define NUM_KEYS 2000
+
+SilcConcurrentHashTable t;
+
+static void *writer_thread(void *context)
+{
+  int id = SILC_PTR_TO_32(context), i;
+
+  for (i = 0; i < NUM_KEYS; i++)
+    silc_concurrent_hash_table_add(t, SILC_32_TO_PTR(id * NUM_KEYS + i + 1),
+				   SILC_32_TO_PTR(i + 1));
+
+  return NULL;
+}
+
+static void *reader_thread(void *context)
+{
+  int id = SILC_PTR_TO_32(context), i;
+  void *val;
+
+  for (i = 0; i < NUM_KEYS; i++)
+    silc_concurrent_hash_table_find(t,
+				    SILC_32_TO_PTR(id * NUM_KEYS + i + 1),
+				    NULL, &val);
+
+  return NULL;
+}
+
+static void foreach_count(void *key, void *context, void *user_context)
+{
+  (*(int *)user_context)++;
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcThread w[NUM_THREADS], r[NUM_THREADS];
+  void *val;
+  int i, c = 0;
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*table*");
+  }
+
+  silc_runtime_init();
+
+  t = silc_concurrent_hash_table_alloc(NULL, 0, 0, silc_hash_ptr, NULL,
+				       NULL, NULL, NULL, NULL);
+  if (!t)
+    goto err;
+
+  /* Concurrent writers and readers */
+  for (i = 0; i < NUM_THREADS; i++)
+    w[i] = silc_thread_create(writer_thread, SILC_32_TO_PTR(i), TRUE);
+  for (i = 0; i < NUM_THREADS; i++)
+    r[i] = silc_thread_create(reader_thread, SILC_32_TO_PTR(i), TRUE);
+  for (i = 0; i < NUM_THREADS; i++) {
+    silc_thread_wait(w[i], NULL);
+    silc_thread_wait(r[i], NULL);
+  }
+
+  if (silc_concurrent_hash_table_count(t) != NUM_THREADS * NUM_KEYS)
+    goto err;
+
+  /* All keys must be there */
+  for (i = 0; i < NUM_THREADS * NUM_KEYS; i++)
+    if (!silc_concurrent_hash_table_find(t, SILC_32_TO_PTR(i + 1),
+					 NULL, &val))
+      goto err;
+
+  silc_concurrent_hash_table_foreach(t, foreach_count, &c);
+  if (c != NUM_THREADS * NUM_KEYS)
+    goto err;
+
+  /* Delete half */
+  for (i = 0; i < NUM_THREADS * NUM_KEYS; i += 2)
+    if (!silc_concurrent_hash_table_del(t, SILC_32_TO_PTR(i + 1)))
+      goto err;
+  if (silc_concurrent_hash_table_count(t) != (NUM_THREADS * NUM_KEYS) / 2)
+    goto err;
+
+  silc_concurrent_hash_table_free(t);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  return !success;
+}
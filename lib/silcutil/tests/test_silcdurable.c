@@ -0,0 +1,112 @@
+/* Durable writer tests */
+
+#include "silcruntime.h"
+
+#define TEST_FILE "/tmp/test_silcdurable.log"
+#define NUM_WRITES 50
+
+SilcSchedule schedule;
+int completed = 0;
+
+/* Counts durable-completion callbacks */
+
+SILC_TASK_CALLBACK(write_done)
+{
+  completed++;
+  if (completed == NUM_WRITES)
+    silc_schedule_stop(schedule);
+}
+
+/* Safety stop if completions never arrive */
+
+SILC_TASK_CALLBACK(give_up)
+{
+  silc_schedule_stop(schedule);
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcDurableWriter writer;
+  char msg[32], *data;
+  SilcUInt32 data_len;
+  int i;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*durable*");
+  }
+
+  unlink(TEST_FILE);
+
+  schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!schedule)
+    goto err;
+  silc_schedule_set_global(schedule);
+
+  writer = silc_durable_writer_create(TEST_FILE, schedule, 5, FALSE);
+  if (!writer)
+    goto err;
+
+  SILC_LOG_DEBUG(("Write %d records", NUM_WRITES));
+  for (i = 0; i < NUM_WRITES; i++) {
+    silc_snprintf(msg, sizeof(msg), "record %04d\n", i);
+    if (!silc_durable_writer_write(writer, (unsigned char *)msg,
+				   strlen(msg), write_done, NULL))
+      goto err;
+  }
+  if (!silc_durable_writer_flush(writer))
+    goto err;
+
+  /* Completions arrive through the scheduler after the batch is
+     durable */
+  silc_schedule_task_add_timeout(schedule, give_up, NULL, 5, 0);
+  silc_schedule(schedule);
+
+  if (completed != NUM_WRITES)
+    goto err;
+
+  silc_durable_writer_destroy(writer);
+
+  SILC_LOG_DEBUG(("Verify file contents"));
+  data = silc_file_readfile(TEST_FILE, &data_len, NULL);
+  if (!data)
+    goto err;
+  if (data_len != (SilcUInt32)NUM_WRITES * strlen("record 0000\n"))
+    goto err;
+  if (memcmp(data, "record 0000\n", 12) ||
+      memcmp(data + data_len - 12, "record 0049\n", 12))
+    goto err;
+  silc_free(data);
+
+  /* Reopening appends */
+  writer = silc_durable_writer_create(TEST_FILE, schedule, 5, FALSE);
+  if (!writer)
+    goto err;
+  if (!silc_durable_writer_write(writer, (unsigned char *)"tail\n", 5,
+				 NULL, NULL))
+    goto err;
+  silc_durable_writer_destroy(writer);
+
+  data = silc_file_readfile(TEST_FILE, &data_len, NULL);
+  if (!data)
+    goto err;
+  if (memcmp(data + data_len - 5, "tail\n", 5))
+    goto err;
+  silc_free(data);
+
+  unlink(TEST_FILE);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
@@ -0,0 +1,76 @@
+/* Flight recorder tests */
+
+#include "silcruntime.h"
+
+#define TEST_FILE "/tmp/test_silcflight.dump"
+#define NUM_EVENTS 100
+
+static void *record_thread(void *context)
+{
+  int i;
+
+  for (i = 0; i < NUM_EVENTS; i++)
+    silc_flight_record(SILC_FLIGHT_APP + 1, i, 0xbeef);
+
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcThread t;
+  char *data;
+  SilcUInt32 data_len;
+  int i;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*flight*");
+  }
+
+  unlink(TEST_FILE);
+
+  SILC_LOG_DEBUG(("Record events from two threads"));
+  for (i = 0; i < NUM_EVENTS; i++)
+    silc_flight_record(SILC_FLIGHT_APP, i, 0xcafe);
+
+  t = silc_thread_create(record_thread, NULL, TRUE);
+  if (t)
+    silc_thread_wait(t, NULL);
+
+  SILC_LOG_DEBUG(("Dump to file"));
+  if (!silc_flight_dump(TEST_FILE))
+    goto err;
+
+  data = silc_file_readfile(TEST_FILE, &data_len, NULL);
+  if (!data)
+    goto err;
+
+  /* Both threads' rings must appear, with our event ids */
+  if (!strstr(data, "thread "))
+    goto err;
+  if (!strstr(data, "cafe"))
+    goto err;
+  if (!strstr(data, "beef"))
+    goto err;
+  silc_free(data);
+
+  /* Dump to an unwritable path must fail cleanly */
+  if (silc_flight_dump("/nonexistent/dir/dump"))
+    goto err;
+
+  unlink(TEST_FILE);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
@@ -0,0 +1,83 @@
+/* IP prefix tree tests */
+
+#include "silcruntime.h"
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcIpTree tree;
+  const char *cidrs[] = { "172.16.0.0/12", "192.168.0.0/16" };
+  void *val;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*iptree*");
+  }
+
+  tree = silc_ip_tree_alloc();
+  if (!tree)
+    goto err;
+
+  SILC_LOG_DEBUG(("Add prefixes"));
+  if (!silc_ip_tree_add(tree, "10.0.0.0/8", SILC_32_TO_PTR(1)))
+    goto err;
+  if (!silc_ip_tree_add(tree, "10.1.0.0/16", SILC_32_TO_PTR(2)))
+    goto err;
+  if (!silc_ip_tree_add(tree, "10.1.2.3", SILC_32_TO_PTR(3)))
+    goto err;
+  if (!silc_ip_tree_add(tree, "0.0.0.0/0", SILC_32_TO_PTR(9)))
+    goto err;
+  if (!silc_ip_tree_add(tree, "fd00::/8", SILC_32_TO_PTR(6)))
+    goto err;
+
+  SILC_LOG_DEBUG(("Longest prefix matches"));
+  if (!silc_ip_tree_find(tree, "10.2.3.4", &val) || SILC_PTR_TO_32(val) != 1)
+    goto err;
+  if (!silc_ip_tree_find(tree, "10.1.9.9", &val) || SILC_PTR_TO_32(val) != 2)
+    goto err;
+  if (!silc_ip_tree_find(tree, "10.1.2.3", &val) || SILC_PTR_TO_32(val) != 3)
+    goto err;
+  if (!silc_ip_tree_find(tree, "192.0.2.1", &val) ||
+      SILC_PTR_TO_32(val) != 9)
+    goto err;
+  if (!silc_ip_tree_find(tree, "fd12::1", &val) || SILC_PTR_TO_32(val) != 6)
+    goto err;
+  if (silc_ip_tree_find(tree, "2001:db8::1", &val))
+    goto err;
+
+  SILC_LOG_DEBUG(("Delete prefix"));
+  if (!silc_ip_tree_del(tree, "10.1.0.0/16"))
+    goto err;
+  if (!silc_ip_tree_find(tree, "10.1.9.9", &val) || SILC_PTR_TO_32(val) != 1)
+    goto err;
+  if (silc_ip_tree_del(tree, "10.99.0.0/16"))
+    goto err;
+
+  SILC_LOG_DEBUG(("Bulk load"));
+  if (!silc_ip_tree_load(tree, cidrs, 2, SILC_32_TO_PTR(7)))
+    goto err;
+  if (!silc_ip_tree_find(tree, "172.20.1.1", &val) ||
+      SILC_PTR_TO_32(val) != 7)
+    goto err;
+
+  SILC_LOG_DEBUG(("Reject malformed prefixes"));
+  if (silc_ip_tree_add(tree, "notanip/8", NULL))
+    goto err;
+  if (silc_ip_tree_add(tree, "10.0.0.0/33", NULL))
+    goto err;
+
+  silc_ip_tree_free(tree);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
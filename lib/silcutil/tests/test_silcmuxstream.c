@@ -0,0 +1,125 @@
+/* Mux stream tests */
+
+#include "silcruntime.h"
+#include <sys/socket.h>
+
+SilcSchedule schedule;
+SilcStream ch1, ch2;
+char recv1[64], recv2[64];
+int recv1_len = 0, recv2_len = 0;
+
+/* Channel readers; stop the scheduler when both channels have data */
+
+static void channel_notifier(SilcStream stream, SilcStreamStatus status,
+			     void *context)
+{
+  int id = SILC_PTR_TO_32(context), ret;
+
+  if (status != SILC_STREAM_CAN_READ)
+    return;
+
+  if (id == 1) {
+    ret = silc_stream_read(stream, (unsigned char *)recv1 + recv1_len,
+			   sizeof(recv1) - recv1_len);
+    if (ret > 0)
+      recv1_len += ret;
+  } else {
+    ret = silc_stream_read(stream, (unsigned char *)recv2 + recv2_len,
+			   sizeof(recv2) - recv2_len);
+    if (ret > 0)
+      recv2_len += ret;
+  }
+
+  if (recv1_len >= 9 && recv2_len >= 9)
+    silc_schedule_stop(schedule);
+}
+
+/* Safety stop */
+
+SILC_TASK_CALLBACK(give_up)
+{
+  silc_schedule_stop(schedule);
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcStream stream1, stream2, sch1, sch2;
+  SilcMuxStream mux1, mux2;
+  int socks[2];
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*mux*,*stream*");
+  }
+
+  schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!schedule)
+    goto err;
+  silc_schedule_set_global(schedule);
+
+  /* Connected stream pair */
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) != 0)
+    goto err;
+  stream1 = silc_fd_stream_create(socks[0], NULL);
+  stream2 = silc_fd_stream_create(socks[1], NULL);
+  if (!stream1 || !stream2)
+    goto err;
+
+  SILC_LOG_DEBUG(("Create muxes and open channels"));
+  mux1 = silc_mux_stream_create(stream1, schedule);
+  mux2 = silc_mux_stream_create(stream2, schedule);
+  if (!mux1 || !mux2)
+    goto err;
+
+  sch1 = silc_mux_stream_open(mux1, 1);
+  sch2 = silc_mux_stream_open(mux1, 2);
+  ch1 = silc_mux_stream_open(mux2, 1);
+  ch2 = silc_mux_stream_open(mux2, 2);
+  if (!sch1 || !sch2 || !ch1 || !ch2)
+    goto err;
+
+  /* Opening the same channel twice must fail */
+  if (silc_mux_stream_open(mux1, 1))
+    goto err;
+
+  silc_stream_set_notifier(ch1, schedule, channel_notifier,
+			   SILC_32_TO_PTR(1));
+  silc_stream_set_notifier(ch2, schedule, channel_notifier,
+			   SILC_32_TO_PTR(2));
+
+  SILC_LOG_DEBUG(("Send on both channels"));
+  if (silc_stream_write(sch1, (unsigned char *)"channel-1", 9) != 9)
+    goto err;
+  if (silc_stream_write(sch2, (unsigned char *)"channel-2", 9) != 9)
+    goto err;
+
+  silc_schedule_task_add_timeout(schedule, give_up, NULL, 5, 0);
+  silc_schedule(schedule);
+
+  /* Each channel must have received exactly its own data */
+  if (recv1_len != 9 || memcmp(recv1, "channel-1", 9))
+    goto err;
+  if (recv2_len != 9 || memcmp(recv2, "channel-2", 9))
+    goto err;
+
+  silc_mux_stream_destroy(mux1);
+  silc_mux_stream_destroy(mux2);
+  silc_stream_destroy(stream1);
+  silc_stream_destroy(stream2);
+
+  silc_schedule_uninit(schedule);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
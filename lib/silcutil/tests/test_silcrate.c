@@ -0,0 +1,88 @@
+/* Rate governor tests */
+
+#include "silcruntime.h"
+
+SilcSchedule schedule;
+SilcRateBucket bucket;
+SilcBool refilled = FALSE;
+
+/* Waits for the governor tick to refill the drained bucket */
+
+SILC_TASK_CALLBACK(check_refill)
+{
+  if (silc_rate_bucket_available(bucket) > 0) {
+    refilled = TRUE;
+    silc_schedule_stop(schedule);
+    return;
+  }
+
+  silc_schedule_task_add_timeout(schedule, check_refill, NULL, 0, 50000);
+}
+
+/* Safety stop if the refill never happens */
+
+SILC_TASK_CALLBACK(give_up)
+{
+  silc_schedule_stop(schedule);
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*rate*,*sched*");
+  }
+
+  schedule = silc_schedule_init(0, NULL, NULL, NULL);
+  if (!schedule)
+    goto err;
+  silc_schedule_set_global(schedule);
+
+  SILC_LOG_DEBUG(("Register bucket, 1000/s burst 100"));
+  bucket = silc_rate_bucket_register(schedule, 1000, 100);
+  if (!bucket)
+    goto err;
+
+  if (silc_rate_bucket_available(bucket) != 100)
+    goto err;
+
+  SILC_LOG_DEBUG(("Consume the burst"));
+  if (!silc_rate_bucket_consume(bucket, 60))
+    goto err;
+  if (!silc_rate_bucket_consume(bucket, 40))
+    goto err;
+  /* Over-consuming must not take anything */
+  if (silc_rate_bucket_consume(bucket, 1))
+    goto err;
+  if (silc_rate_bucket_available(bucket) != 0)
+    goto err;
+
+  silc_rate_bucket_set_rate(bucket, 1000, 200);
+
+  SILC_LOG_DEBUG(("Wait for the tick to refill"));
+  silc_schedule_task_add_timeout(schedule, check_refill, NULL, 0, 50000);
+  silc_schedule_task_add_timeout(schedule, give_up, NULL, 5, 0);
+  silc_schedule(schedule);
+
+  if (!refilled)
+    goto err;
+
+  silc_rate_bucket_unregister(bucket);
+
+  silc_schedule_uninit(schedule);
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
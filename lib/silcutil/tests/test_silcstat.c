@@ -0,0 +1,91 @@
+/* Statistics counter tests */
+
+#include "silcruntime.h"
+
+#define NUM_THREADS 4
+#define NUM_ADDS 10000
+
+SilcStatCounter counter;
+
+static void *add_thread(void *context)
+{
+  int i;
+
+  for (i = 0; i < NUM_ADDS; i++)
+    silc_stat_inc(counter);
+
+  return NULL;
+}
+
+static void foreach_count(SilcStatCounter c, const char *name,
+			  SilcUInt64 value, void *context)
+{
+  (*(int *)context)++;
+}
+
+int main(int argc, char **argv)
+{
+  SilcBool success = FALSE;
+  SilcThread t[NUM_THREADS];
+  SilcStatCounter c2;
+  int i, count = 0;
+
+  silc_runtime_init();
+
+  if (argc > 1 && !strcmp(argv[1], "-d")) {
+    silc_log_debug(TRUE);
+    silc_log_quick(TRUE);
+    silc_log_set_debug_string("*stat*");
+  }
+
+  SILC_LOG_DEBUG(("Register counters"));
+  counter = silc_stat_register("test.counter");
+  if (!counter)
+    goto err;
+
+  /* Registering the same name returns the same counter */
+  if (silc_stat_register("test.counter") != counter)
+    goto err;
+  if (strcmp(silc_stat_name(counter), "test.counter"))
+    goto err;
+
+  c2 = silc_stat_register("test.other");
+  if (!c2 || c2 == counter)
+    goto err;
+
+  if (silc_stat_find("test.other") != c2)
+    goto err;
+  if (silc_stat_find("test.nosuch"))
+    goto err;
+
+  SILC_LOG_DEBUG(("Add and read"));
+  silc_stat_add(c2, 100);
+  silc_stat_add(c2, -40);
+  if (silc_stat_get(c2) != 60)
+    goto err;
+
+  SILC_LOG_DEBUG(("Concurrent increments"));
+  for (i = 0; i < NUM_THREADS; i++)
+    t[i] = silc_thread_create(add_thread, NULL, TRUE);
+  for (i = 0; i < NUM_THREADS; i++)
+    silc_thread_wait(t[i], NULL);
+
+  if (silc_stat_get(counter) != NUM_THREADS * NUM_ADDS)
+    goto err;
+
+  silc_stat_foreach(foreach_count, &count);
+  if (count != 2)
+    goto err;
+
+  silc_stat_uninit();
+
+  success = TRUE;
+
+ err:
+  SILC_LOG_DEBUG(("Testing was %s", success ? "SUCCESS" : "FAILURE"));
+  fprintf(stderr, "Testing was %s\n", success ? "SUCCESS" : "FAILURE");
+
+  silc_runtime_uninit();
+
+  return !success;
+}
@@ -114,6 +114,106 @@ int main(int argc, char **argv)
   if (silc_tree_count(tree) != 0)
     goto err;
 
+  /* B-tree backend; same operations through the same interface.  The
+     B-tree does not support duplicates. */
+  SILC_LOG_DEBUG(("Create B-tree"));
+  if (silc_tree_init(tree, SILC_TREE_BTREE, compare, NULL,
+		     silc_offsetof(Foo, header), TRUE))
+    goto err;
+  if (!silc_tree_init(tree, SILC_TREE_BTREE, compare, NULL,
+		      silc_offsetof(Foo, header), FALSE))
+    goto err;
+
+  SILC_LOG_DEBUG(("Populate tree, %d entries", NUM));
+  for (i = 0; i < NUM; i++)
+    if (!silc_tree_add(tree, &foo[i]))
+      goto err;
+  if (silc_tree_count(tree) != NUM)
+    goto err;
+
+  /* Find all */
+  for (i = 0; i < NUM; i++) {
+    tmp.id = i + 1;
+    if ((entry = silc_tree_find(tree, &tmp)) == NULL)
+      goto err;
+    if (entry->id != i + 1)
+      goto err;
+  }
+
+  /* Find non-existing */
+  tmp.id = NUM + 100;
+  if (silc_tree_find(tree, &tmp))
+    goto err;
+
+  /* Enumerate must return ascending order */
+  i = 0;
+  for (entry = silc_tree_enumerate(tree, NULL);
+       entry;
+       entry = silc_tree_enumerate(tree, entry)) {
+    if (entry->id != ++i)
+      goto err;
+  }
+  if (i != NUM)
+    goto err;
+
+  /* Seek and range enumeration */
+  tmp.id = NUM / 2;
+  if ((entry = silc_tree_find_ge(tree, &tmp)) == NULL)
+    goto err;
+  if (entry->id != NUM / 2)
+    goto err;
+
+  {
+    Foo start, end;
+    start.id = 10;
+    end.id = 20;
+    i = 9;
+    for (entry = silc_tree_enumerate_range(tree, NULL, &start, &end);
+	 entry;
+	 entry = silc_tree_enumerate_range(tree, entry, &start, &end)) {
+      if (entry->id != ++i)
+	goto err;
+    }
+    if (i != 20)
+      goto err;
+  }
+
+  /* Export, rebuild with bulk load, verify */
+  {
+    void **entries;
+    SilcUInt32 count;
+    SilcTree tree2;
+
+    entries = silc_tree_export(tree, &count);
+    if (!entries || count != NUM)
+      goto err;
+
+    if (!silc_tree_init(tree2, SILC_TREE_BTREE, compare, NULL,
+			silc_offsetof(Foo, header), FALSE))
+      goto err;
+    if (!silc_tree_load(tree2, entries, count))
+      goto err;
+    silc_free(entries);
+
+    if (silc_tree_count(tree2) != NUM)
+      goto err;
+    for (i = 0; i < NUM; i++) {
+      tmp.id = i + 1;
+      if (!silc_tree_find(tree2, &tmp))
+	goto err;
+    }
+  }
+
+  /* Delete all */
+  for (i = 0; i < NUM; i++) {
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.id = i + 1;
+    if (!silc_tree_del(tree, &tmp))
+      goto err;
+  }
+  if (silc_tree_count(tree) != 0)
+    goto err;
+
   success = TRUE;
 
  err:
@@ -56,6 +56,118 @@ static SilcXMLParserHandlerStruct handler =
   xml_pi
 };
 
+/* Pull parser test; the document is fed in two chunks and the typed
+   events are read back */
+
+static SilcBool test_pull_parser(void)
+{
+  const char *doc =
+    "<?xml version=\"1.0\"?>"
+    "<root a=\"1\" b=\"2\"><child>hello</child><empty/></root>";
+  SilcXMLParser pull;
+  SilcXMLEvent event;
+  SilcUInt32 half = strlen(doc) / 2;
+  int starts = 0, ends = 0, data = 0, end_doc = 0, i;
+
+  pull = silc_xml_parser_create_pull(NULL);
+  if (!pull)
+    return FALSE;
+
+  if (!silc_xml_pull_feed(pull, (const unsigned char *)doc, half, FALSE))
+    goto err;
+  if (!silc_xml_pull_feed(pull, (const unsigned char *)doc + half,
+			  strlen(doc) - half, TRUE))
+    goto err;
+
+  while ((event = silc_xml_next(pull))) {
+    switch (event->type) {
+    case SILC_XML_EVENT_START_ELEMENT:
+      starts++;
+      if (!strcmp(event->name, "root")) {
+	if (!event->attributes)
+	  goto err;
+	for (i = 0; event->attributes[i]; i += 2)
+	  ;
+	if (i != 4)
+	  goto err;
+      }
+      break;
+    case SILC_XML_EVENT_END_ELEMENT:
+      ends++;
+      break;
+    case SILC_XML_EVENT_DATA:
+      if (event->data_len == 5 && !memcmp(event->data, "hello", 5))
+	data++;
+      break;
+    case SILC_XML_EVENT_END_DOCUMENT:
+      end_doc++;
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (starts != 3 || ends != 3 || data != 1 || end_doc != 1)
+    goto err;
+
+  silc_xml_parser_free(pull);
+  return TRUE;
+
+ err:
+  silc_xml_parser_free(pull);
+  return FALSE;
+}
+
+/* Writer test; entity escaping and element nesting */
+
+static SilcBool test_writer(void)
+{
+  const char *expect =
+    "<export version=\"1 &amp; &quot;2&quot;\">"
+    "<rec>a&lt;b&gt;&amp;c&apos;d</rec><empty/></export>";
+  SilcBufferStruct buf;
+  SilcXMLWriter writer;
+
+  memset(&buf, 0, sizeof(buf));
+  writer = silc_xml_writer_alloc(&buf);
+  if (!writer)
+    return FALSE;
+
+  if (!silc_xml_writer_start_element(writer, "export"))
+    goto err;
+  if (!silc_xml_writer_attribute(writer, "version", "1 & \"2\""))
+    goto err;
+  if (!silc_xml_writer_start_element(writer, "rec"))
+    goto err;
+  if (!silc_xml_writer_data(writer, (const unsigned char *)"a<b>&c'd", 8))
+    goto err;
+  if (!silc_xml_writer_end_element(writer))
+    goto err;
+  if (!silc_xml_writer_start_element(writer, "empty"))
+    goto err;
+  if (!silc_xml_writer_end_element(writer))
+    goto err;
+  if (!silc_xml_writer_end_element(writer))
+    goto err;
+
+  /* Nothing left open */
+  if (silc_xml_writer_end_element(writer))
+    goto err;
+
+  if (silc_buffer_len(&buf) != strlen(expect) ||
+      memcmp(silc_buffer_data(&buf), expect, strlen(expect)))
+    goto err;
+
+  silc_xml_writer_free(writer);
+  silc_buffer_purge(&buf);
+  return TRUE;
+
+ err:
+  silc_xml_writer_free(writer);
+  silc_buffer_purge(&buf);
+  return FALSE;
+}
+
 int main(int argc, char **argv)
 {
   SilcXMLParamsStruct params;
@@ -64,23 +176,28 @@ int main(int argc, char **argv)
 
   silc_runtime_init();
 
-  if (argc != 2) {
-    fprintf(stderr, "Usage: test_silcxml <filename>\n");
-    goto err;
+  if (argc == 2) {
+    memset(&params, 0, sizeof(params));
+    parser = silc_xml_parser_create(&params, &handler, NULL);
+    if (!parser)
+      goto err;
+
+    if (!silc_xml_parse_file(parser, argv[1])) {
+      silc_errno_location(&file, &cur_line, NULL);
+      fprintf(stderr, "%s:%d: %s\n", file, cur_line, silc_errno_reason());
+      goto err;
+    }
+
+    silc_xml_parser_free(parser);
   }
 
-  memset(&params, 0, sizeof(params));
-  parser = silc_xml_parser_create(&params, &handler, NULL);
-  if (!parser)
+  SILC_LOG_DEBUG(("Pull parser"));
+  if (!test_pull_parser())
     goto err;
 
-  if (!silc_xml_parse_file(parser, argv[1])) {
-    silc_errno_location(&file, &cur_line, NULL);
-    fprintf(stderr, "%s:%d: %s\n", file, cur_line, silc_errno_reason());
+  SILC_LOG_DEBUG(("Writer"));
+  if (!test_writer())
     goto err;
-  }
-
-  silc_xml_parser_free(parser);
 
   success = TRUE;
 
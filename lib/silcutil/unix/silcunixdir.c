@@ -19,6 +19,10 @@
 
 #include "silcruntime.h"
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif /* __linux__ */
+
 /************************** Types and definitions ***************************/
 
 /* Directory entry context */
@@ -32,6 +36,9 @@ struct SilcDirStruct {
   DIR *dir;			          /* Directory */
   char *name;				  /* Directory name */
   struct SilcDirEntryStruct entry;	  /* Current entry */
+  char *bulk_buf;			  /* Bulk read buffer */
+  int bulk_len;				  /* Data in the bulk buffer */
+  int bulk_pos;				  /* Position in the bulk buffer */
 };
 
 /****************************** SILC Dir API ********************************/
@@ -83,6 +90,7 @@ void silc_dir_close(SilcDir dir)
   SILC_LOG_DEBUG(("Close directory '%s'", dir->name));
 
   closedir(dir->dir);
+  silc_free(dir->bulk_buf);
   silc_free(dir->name);
   silc_free(dir);
 }
@@ -151,3 +159,108 @@ const char *silc_dir_entry_name(SilcDirEntry entry)
 
   return (const char *)entry->entry->d_name;
 }
+
+/* Maps a dirent type to SilcDirEntryType */
+
+static SilcDirEntryType silc_dir_entry_type(unsigned char d_type)
+{
+  switch (d_type) {
+#if defined(DT_REG)
+  case DT_REG:
+    return SILC_DIR_ENTRY_FILE;
+  case DT_DIR:
+    return SILC_DIR_ENTRY_DIR;
+  case DT_LNK:
+    return SILC_DIR_ENTRY_SYMLINK;
+  case DT_UNKNOWN:
+    return SILC_DIR_ENTRY_UNKNOWN;
+#endif /* DT_REG */
+  default:
+    return d_type ? SILC_DIR_ENTRY_OTHER : SILC_DIR_ENTRY_UNKNOWN;
+  }
+}
+
+/* Read directory entries in bulk */
+
+int silc_dir_read_bulk(SilcDir dir, SilcDirBulkEntry *entries,
+		       SilcUInt32 num_entries)
+{
+  SilcUInt32 n = 0;
+
+  if (!dir || !entries || !num_entries) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return -1;
+  }
+
+#if defined(__linux__) && defined(SYS_getdents64)
+  {
+    /* Batched getdents64; one system call fills tens of entries */
+    struct linux_dirent64 {
+      SilcUInt64 d_ino;
+      SilcInt64 d_off;
+      unsigned short d_reclen;
+      unsigned char d_type;
+      char d_name[1];
+    } *d;
+
+    if (!dir->bulk_buf) {
+      dir->bulk_buf = silc_malloc(65536);
+      if (!dir->bulk_buf)
+	return -1;
+      dir->bulk_len = dir->bulk_pos = 0;
+    }
+
+    while (n < num_entries) {
+      if (dir->bulk_pos >= dir->bulk_len) {
+	dir->bulk_len = syscall(SYS_getdents64, dirfd(dir->dir),
+				dir->bulk_buf, 65536);
+	dir->bulk_pos = 0;
+	if (dir->bulk_len < 0) {
+	  silc_set_errno_posix(errno);
+	  return n ? (int)n : -1;
+	}
+	if (dir->bulk_len == 0)
+	  break;
+      }
+
+      d = (struct linux_dirent64 *)(dir->bulk_buf + dir->bulk_pos);
+      silc_snprintf(entries[n].name, sizeof(entries[n].name), "%s",
+		    d->d_name);
+      entries[n].ino = d->d_ino;
+      entries[n].type = silc_dir_entry_type(d->d_type);
+      n++;
+      dir->bulk_pos += d->d_reclen;
+    }
+
+    return (int)n;
+  }
+#else
+  {
+    struct dirent *e;
+
+    while (n < num_entries) {
+      errno = 0;
+      e = readdir(dir->dir);
+      if (!e) {
+	if (errno) {
+	  silc_set_errno_posix(errno);
+	  return n ? (int)n : -1;
+	}
+	break;
+      }
+
+      silc_snprintf(entries[n].name, sizeof(entries[n].name), "%s",
+		    e->d_name);
+      entries[n].ino = (SilcUInt64)e->d_ino;
+#if defined(_DIRENT_HAVE_D_TYPE)
+      entries[n].type = silc_dir_entry_type(e->d_type);
+#else
+      entries[n].type = SILC_DIR_ENTRY_UNKNOWN;
+#endif /* _DIRENT_HAVE_D_TYPE */
+      n++;
+    }
+
+    return (int)n;
+  }
+#endif /* __linux__ && SYS_getdents64 */
+}
@@ -0,0 +1,334 @@
+/*
+
+  silcunixdirwatch.c
+
+  Author: Pekka Riikonen <priikone@silcnet.org>
+
+  Copyright (C) 2008 Pekka Riikonen
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+*/
+
+#include "silcruntime.h"
+
+#if defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#define SILC_DIR_WATCH_INOTIFY 1
+#elif defined(HAVE_KQUEUE)
+#include <sys/event.h>
+#define SILC_DIR_WATCH_KQUEUE 1
+#endif
+
+/* Scan interval of the polling fallback, milliseconds */
+#define SILC_DIR_WATCH_POLL_MSEC 1000
+
+/* Directory watch context */
+struct SilcDirWatchStruct {
+  SilcSchedule schedule;
+  SilcDirWatchCallback callback;
+  void *context;
+  char *dir;			       /* Watched directory */
+  SilcHashTable files;		       /* Scan snapshot (scan modes) */
+  int fd;			       /* inotify/kqueue fd, -1 if polling */
+  int dirfd;			       /* Directory fd (kqueue) */
+};
+
+/* Scan snapshot entry */
+typedef struct {
+  SilcUInt64 sig;		       /* Size and mtime signature */
+  unsigned int seen : 1;	       /* Present in current scan */
+} *SilcDirWatchFile;
+
+/************************ Static utility functions **************************/
+
+#if !defined(SILC_DIR_WATCH_INOTIFY)
+
+/* Snapshot entry destructor */
+
+static void silc_dir_watch_file_destructor(void *key, void *context,
+					   void *user_context)
+{
+  silc_free(key);
+  silc_free(context);
+}
+
+/* Scans the directory and synthesizes events from the differences to
+   the previous scan.  Used by the polling fallback, and by the kqueue
+   mode when the kernel reports the directory changed. */
+
+static void silc_dir_watch_scan(SilcDirWatch watch, SilcBool initial)
+{
+  SilcDir dir;
+  SilcDirEntry entry;
+  SilcHashTableList htl;
+  SilcDirWatchFile f;
+  struct stat st;
+  char path[512], *name, **del = NULL;
+  SilcUInt64 sig;
+  SilcUInt32 num_del = 0, i;
+
+  dir = silc_dir_open(watch->dir);
+  if (!dir)
+    return;
+
+  while ((entry = silc_dir_read(dir, NULL))) {
+    name = (char *)silc_dir_entry_name(entry);
+    if (!strcmp(name, ".") || !strcmp(name, ".."))
+      continue;
+
+    silc_snprintf(path, sizeof(path), "%s/%s", watch->dir, name);
+    if (stat(path, &st) != 0)
+      continue;
+    sig = ((SilcUInt64)st.st_mtime << 20) ^ (SilcUInt64)st.st_size;
+
+    if (silc_hash_table_find(watch->files, name, NULL, (void *)&f)) {
+      f->seen = TRUE;
+      if (f->sig != sig) {
+	f->sig = sig;
+	if (!initial)
+	  watch->callback(watch, SILC_DIR_WATCH_MODIFY, name,
+			  watch->context);
+      }
+      continue;
+    }
+
+    f = silc_calloc(1, sizeof(*f));
+    if (!f)
+      continue;
+    f->sig = sig;
+    f->seen = TRUE;
+    if (!silc_hash_table_add(watch->files, silc_strdup(name), f)) {
+      silc_free(f);
+      continue;
+    }
+
+    if (!initial)
+      watch->callback(watch, SILC_DIR_WATCH_CREATE, name, watch->context);
+  }
+
+  silc_dir_close(dir);
+
+  /* Entries not seen in this scan have been deleted */
+  silc_hash_table_list(watch->files, &htl);
+  while (silc_hash_table_get(&htl, (void *)&name, (void *)&f)) {
+    if (f->seen) {
+      f->seen = FALSE;
+      continue;
+    }
+    del = silc_realloc(del, sizeof(*del) * (num_del + 1));
+    if (del)
+      del[num_del++] = name;
+  }
+  silc_hash_table_list_reset(&htl);
+
+  for (i = 0; i < num_del; i++) {
+    if (!initial)
+      watch->callback(watch, SILC_DIR_WATCH_DELETE, del[i], watch->context);
+    silc_hash_table_del(watch->files, del[i]);
+  }
+  silc_free(del);
+}
+
+#endif /* !SILC_DIR_WATCH_INOTIFY */
+
+#if defined(SILC_DIR_WATCH_INOTIFY)
+
+/* Reads and dispatches inotify events */
+
+SILC_TASK_CALLBACK(silc_dir_watch_io)
+{
+  SilcDirWatch watch = context;
+  unsigned char buf[4096];
+  struct inotify_event *ev;
+  int len, off;
+
+  for (;;) {
+    len = read(watch->fd, buf, sizeof(buf));
+    if (len <= 0)
+      return;
+
+    for (off = 0; off < len; off += sizeof(*ev) + ev->len) {
+      ev = (struct inotify_event *)(buf + off);
+      if (!ev->len)
+	continue;
+
+      if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+	watch->callback(watch, SILC_DIR_WATCH_CREATE, ev->name,
+			watch->context);
+      else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+	watch->callback(watch, SILC_DIR_WATCH_DELETE, ev->name,
+			watch->context);
+      else if (ev->mask & IN_CLOSE_WRITE)
+	watch->callback(watch, SILC_DIR_WATCH_MODIFY, ev->name,
+			watch->context);
+    }
+  }
+}
+
+#elif defined(SILC_DIR_WATCH_KQUEUE)
+
+/* The kqueue fd signals the directory changed; rescan for the names */
+
+SILC_TASK_CALLBACK(silc_dir_watch_io)
+{
+  SilcDirWatch watch = context;
+  struct kevent ev;
+  struct timespec ts;
+
+  memset(&ts, 0, sizeof(ts));
+  while (kevent(watch->fd, NULL, 0, &ev, 1, &ts) > 0)
+    ;
+
+  silc_dir_watch_scan(watch, FALSE);
+}
+
+#else
+
+/* Polling fallback; rescan on a timer */
+
+SILC_TASK_CALLBACK(silc_dir_watch_poll)
+{
+  SilcDirWatch watch = context;
+
+  silc_dir_watch_scan(watch, FALSE);
+
+  silc_schedule_task_add_timeout(watch->schedule, silc_dir_watch_poll,
+				 watch, SILC_DIR_WATCH_POLL_MSEC / 1000,
+				 (SILC_DIR_WATCH_POLL_MSEC % 1000) * 1000);
+}
+
+#endif /* SILC_DIR_WATCH_INOTIFY */
+
+/****************************** Public API **********************************/
+
+/* Start directory watch */
+
+SilcDirWatch silc_dir_watch_start(const char *dir, SilcSchedule schedule,
+				  SilcDirWatchCallback callback,
+				  void *context)
+{
+  SilcDirWatch watch;
+
+  if (!dir || !callback) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return NULL;
+    }
+  }
+
+  watch = silc_calloc(1, sizeof(*watch));
+  if (!watch)
+    return NULL;
+
+  watch->schedule = schedule;
+  watch->callback = callback;
+  watch->context = context;
+  watch->fd = -1;
+  watch->dirfd = -1;
+  watch->dir = silc_strdup(dir);
+  if (!watch->dir) {
+    silc_free(watch);
+    return NULL;
+  }
+
+#if defined(SILC_DIR_WATCH_INOTIFY)
+  watch->fd = inotify_init1(IN_NONBLOCK);
+  if (watch->fd < 0) {
+    silc_set_errno_posix(errno);
+    goto err;
+  }
+  if (inotify_add_watch(watch->fd, dir,
+			IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+			IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+    silc_set_errno_posix(errno);
+    goto err;
+  }
+
+  silc_schedule_task_add_fd(schedule, watch->fd, silc_dir_watch_io, watch);
+  silc_schedule_set_listen_fd(schedule, watch->fd, SILC_TASK_READ, FALSE);
+#else
+  watch->files = silc_hash_table_alloc(NULL, 0, silc_hash_string, NULL,
+				       silc_hash_string_compare, NULL,
+				       silc_dir_watch_file_destructor,
+				       NULL, TRUE);
+  if (!watch->files)
+    goto err;
+
+  /* Take the initial snapshot without delivering events */
+  silc_dir_watch_scan(watch, TRUE);
+
+#if defined(SILC_DIR_WATCH_KQUEUE)
+  {
+    struct kevent ev;
+
+    watch->dirfd = open(dir, O_RDONLY);
+    watch->fd = kqueue();
+    if (watch->dirfd < 0 || watch->fd < 0) {
+      silc_set_errno_posix(errno);
+      goto err;
+    }
+
+    EV_SET(&ev, watch->dirfd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+	   NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+    if (kevent(watch->fd, &ev, 1, NULL, 0, NULL) < 0) {
+      silc_set_errno_posix(errno);
+      goto err;
+    }
+
+    silc_schedule_task_add_fd(schedule, watch->fd, silc_dir_watch_io,
+			      watch);
+    silc_schedule_set_listen_fd(schedule, watch->fd, SILC_TASK_READ, FALSE);
+  }
+#else
+  silc_schedule_task_add_timeout(schedule, silc_dir_watch_poll, watch,
+				 SILC_DIR_WATCH_POLL_MSEC / 1000,
+				 (SILC_DIR_WATCH_POLL_MSEC % 1000) * 1000);
+#endif /* SILC_DIR_WATCH_KQUEUE */
+#endif /* SILC_DIR_WATCH_INOTIFY */
+
+  SILC_LOG_DEBUG(("Started directory watch %p on %s", watch, dir));
+
+  return watch;
+
+ err:
+  silc_dir_watch_stop(watch);
+  return NULL;
+}
+
+/* Stop directory watch */
+
+void silc_dir_watch_stop(SilcDirWatch watch)
+{
+  if (!watch)
+    return;
+
+  SILC_LOG_DEBUG(("Stopping directory watch %p", watch));
+
+  if (watch->fd >= 0) {
+    silc_schedule_task_del_by_fd(watch->schedule, watch->fd);
+    close(watch->fd);
+  }
+  if (watch->dirfd >= 0)
+    close(watch->dirfd);
+
+  silc_schedule_task_del_by_context(watch->schedule, watch);
+
+  if (watch->files)
+    silc_hash_table_free(watch->files);
+  silc_free(watch->dir);
+  silc_free(watch);
+}
@@ -19,6 +19,10 @@
 
 #include "silcruntime.h"
 
+#if defined(SILC_LINUX) || defined(__linux__)
+#include <netinet/udp.h>
+#endif
+
 /************************** Types and definitions ***************************/
 
 #ifdef HAVE_IPV6
@@ -97,32 +101,87 @@ static void silc_net_accept_stream(SilcResult status,
 {
   SilcNetListener listener = context;
 
+  if (listener->pending)
+    listener->pending--;
+
   if (status != SILC_OK)
     return;
 
   listener->callback(SILC_OK, stream, listener->context);
 }
 
+/* Re-enable a listener throttled by the accept limits */
+
+SILC_TASK_CALLBACK(silc_net_accept_resume)
+{
+  SilcNetListener listener = context;
+  SilcSchedule s;
+  int i;
+
+  for (i = 0; i < listener->socks_count; i++) {
+    s = listener->shard_schedules && listener->shard_schedules[i] ?
+      listener->shard_schedules[i] : listener->schedule;
+    silc_schedule_set_listen_fd(s, listener->socks[i], SILC_TASK_READ,
+				FALSE);
+  }
+}
+
 /* Accept incoming connection and notify upper layer */
 
 SILC_TASK_CALLBACK(silc_net_accept)
 {
   SilcNetListener listener = context;
-  int sock;
+  int sock, count = 0;
 
   SILC_LOG_DEBUG(("Accepting new connection"));
 
-  sock = silc_net_accept_connection(fd);
-  if (sock < 0)
-    return;
-
-  /* Set socket options */
-  silc_net_set_socket_opt(sock, SOL_SOCKET, SO_REUSEADDR, 1);
+  /* Accept every pending connection from this readiness event, bounded
+     so that an accept storm cannot monopolize the loop. */
+  while (count++ < 64) {
+    /* Leave connections in the kernel backlog when over the accept
+       rate or the undelivered-accept cap; accepting them would only
+       turn backlog into unbounded process memory. */
+    if (listener->max_pending && listener->pending >= listener->max_pending)
+      goto throttle;
+    if (listener->accept_limit) {
+      SilcInt64 now = silc_time();
+      if (now != listener->accept_refill) {
+	listener->accept_refill = now;
+	listener->accept_tokens = listener->accept_limit;
+      }
+      if (!listener->accept_tokens)
+	goto throttle;
+      listener->accept_tokens--;
+    }
 
-  /* Create socket stream */
-  silc_socket_tcp_stream_create(sock, listener->lookup,
-				listener->require_fqdn, schedule,
-				silc_net_accept_stream, listener);
+    sock = silc_net_accept_connection(fd);
+    if (sock < 0)
+      return;
+
+    /* Set socket options */
+    silc_net_set_socket_opt(sock, SOL_SOCKET, SO_REUSEADDR, 1);
+    if (listener->has_profile)
+      silc_net_set_socket_profile(sock, FALSE, &listener->profile);
+
+    /* Create socket stream.  In deferred lookup mode the stream is
+       delivered immediately with IP information only; the application
+       resolves the hostname later with silc_socket_stream_resolve. */
+    silc_socket_tcp_stream_create(sock,
+				  listener->deferred ? FALSE :
+				  listener->lookup,
+				  listener->require_fqdn, schedule,
+				  silc_net_accept_stream, listener);
+    listener->pending++;
+  }
+  return;
+
+ throttle:
+  /* Stop listening for a moment instead of spinning on the readable
+     fd; the resume timeout re-enables the listener. */
+  listener->overflow_count++;
+  silc_schedule_unset_listen_fd(schedule, fd);
+  silc_schedule_task_add_timeout(schedule, silc_net_accept_resume,
+				 listener, 0, 200000);
 }
 
 /* Create TCP network listener */
@@ -242,6 +301,216 @@ silc_net_tcp_create_listener(const char **local_ip_addr,
   return NULL;
 }
 
+/* Apply declarative socket option profile */
+
+SilcBool silc_net_set_socket_profile(int sock, SilcBool listener,
+				     SilcNetSocketProfile *profile)
+{
+  if (!profile) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  if (listener) {
+#if defined(TCP_FASTOPEN)
+    if (profile->fastopen)
+      silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_FASTOPEN, 16);
+#endif /* TCP_FASTOPEN */
+#if defined(TCP_DEFER_ACCEPT)
+    if (profile->defer_accept)
+      silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, 1);
+#endif /* TCP_DEFER_ACCEPT */
+  }
+
+#if defined(TCP_USER_TIMEOUT)
+  if (profile->user_timeout)
+    silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_USER_TIMEOUT,
+			    profile->user_timeout);
+#endif /* TCP_USER_TIMEOUT */
+
+  if (profile->keepalive_idle || profile->keepalive_interval ||
+      profile->keepalive_count) {
+    silc_net_set_socket_opt(sock, SOL_SOCKET, SO_KEEPALIVE, 1);
+#if defined(TCP_KEEPIDLE)
+    if (profile->keepalive_idle)
+      silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_KEEPIDLE,
+			      profile->keepalive_idle);
+#endif /* TCP_KEEPIDLE */
+#if defined(TCP_KEEPINTVL)
+    if (profile->keepalive_interval)
+      silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_KEEPINTVL,
+			      profile->keepalive_interval);
+#endif /* TCP_KEEPINTVL */
+#if defined(TCP_KEEPCNT)
+    if (profile->keepalive_count)
+      silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_KEEPCNT,
+			      profile->keepalive_count);
+#endif /* TCP_KEEPCNT */
+  }
+
+  return TRUE;
+}
+
+/* Set socket option profile on listener */
+
+void silc_net_listener_set_profile(SilcNetListener listener,
+				   SilcNetSocketProfile *profile)
+{
+  int i;
+
+  if (!profile)
+    return;
+
+  listener->profile = *profile;
+  listener->has_profile = TRUE;
+
+  /* Apply the listener side options now */
+  for (i = 0; i < listener->socks_count; i++)
+    silc_net_set_socket_profile(listener->socks[i], TRUE,
+				&listener->profile);
+}
+
+/* Set accept rate and pending caps */
+
+SilcBool silc_net_listener_set_accept_limits(SilcNetListener listener,
+					     SilcUInt32 max_per_sec,
+					     SilcUInt32 max_pending)
+{
+  if (!listener) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return FALSE;
+  }
+
+  listener->accept_limit = max_per_sec;
+  listener->accept_tokens = max_per_sec;
+  listener->accept_refill = silc_time();
+  listener->max_pending = max_pending;
+
+  return TRUE;
+}
+
+/* Return count of throttled accepts */
+
+SilcUInt64 silc_net_listener_get_overflow(SilcNetListener listener)
+{
+  return listener ? listener->overflow_count : 0;
+}
+
+/* Set deferred hostname lookup mode on listener */
+
+void silc_net_listener_set_deferred_lookup(SilcNetListener listener,
+					   SilcBool deferred)
+{
+  listener->deferred = deferred;
+}
+
+/* Create sharded TCP listener; one SO_REUSEPORT socket per scheduler */
+
+SilcNetListener
+silc_net_tcp_create_listener_shard(const char *local_ip_addr, int port,
+				   SilcBool lookup, SilcBool require_fqdn,
+				   SilcSchedule schedule,
+				   SilcNetCallback callback, void *context)
+{
+#if defined(SO_REUSEPORT)
+  SilcNetListener listener = NULL;
+  SilcSockaddr server;
+  SilcSchedule sched;
+  SilcUInt32 i, num;
+  int sock, rval;
+
+  SILC_LOG_DEBUG(("Creating sharded TCP listener"));
+
+  if (!schedule) {
+    schedule = silc_schedule_get_global();
+    if (!schedule) {
+      silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+      return NULL;
+    }
+  }
+
+  if (port < 0 || !callback) {
+    silc_set_errno(SILC_ERR_INVALID_ARGUMENT);
+    return NULL;
+  }
+
+  /* One shard for the parent and one for each child scheduler.  The
+     kernel balances incoming connections over the shards. */
+  num = silc_schedule_get_num_children(schedule) + 1;
+
+  listener = silc_calloc(1, sizeof(*listener));
+  if (!listener)
+    return NULL;
+  listener->schedule = schedule;
+  listener->callback = callback;
+  listener->context = context;
+  listener->require_fqdn = require_fqdn;
+  listener->lookup = lookup;
+
+  listener->socks = silc_calloc(num, sizeof(*listener->socks));
+  listener->shard_schedules = silc_calloc(num,
+					  sizeof(*listener->shard_schedules));
+  if (!listener->socks || !listener->shard_schedules)
+    goto err;
+
+  for (i = 0; i < num; i++) {
+    if (!silc_net_set_sockaddr(&server,
+			       local_ip_addr ? local_ip_addr : "0.0.0.0",
+			       port))
+      goto err;
+
+    sock = socket(server.sin.sin_family, SOCK_STREAM, 0);
+    if (sock < 0) {
+      silc_set_errno_posix(errno);
+      goto err;
+    }
+
+    silc_net_set_socket_opt(sock, SOL_SOCKET, SO_REUSEADDR, 1);
+    rval = silc_net_set_socket_opt(sock, SOL_SOCKET, SO_REUSEPORT, 1);
+    if (rval < 0) {
+      SILC_LOG_ERROR(("Cannot set SO_REUSEPORT: %s", strerror(errno)));
+      close(sock);
+      goto err;
+    }
+
+    rval = bind(sock, &server.sa, SIZEOF_SOCKADDR(server));
+    if (rval < 0) {
+      silc_set_errno_posix(errno);
+      close(sock);
+      goto err;
+    }
+
+    rval = listen(sock, 64);
+    if (rval < 0) {
+      silc_set_errno_posix(errno);
+      close(sock);
+      goto err;
+    }
+
+    silc_net_set_socket_nonblock(sock);
+
+    /* First shard accepts in the parent, the rest in the children */
+    sched = i == 0 ? schedule : silc_schedule_get_child(schedule);
+    silc_schedule_task_add_fd(sched, sock, silc_net_accept, listener);
+
+    SILC_LOG_DEBUG(("TCP listener shard created, fd=%d", sock));
+    listener->socks[i] = sock;
+    listener->shard_schedules[i] = sched;
+    listener->socks_count++;
+  }
+
+  return listener;
+
+ err:
+  if (listener)
+    silc_net_close_listener(listener);
+  return NULL;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return NULL;
+#endif /* SO_REUSEPORT */
+}
+
 /* Create TCP listener, multiple ports */
 
 SilcNetListener
@@ -385,12 +654,15 @@ void silc_net_close_listener(SilcNetListener listener)
   SILC_LOG_DEBUG(("Closing network listener"));
 
   for (i = 0; i < listener->socks_count; i++) {
-    silc_schedule_task_del_by_fd(listener->schedule, listener->socks[i]);
+    silc_schedule_task_del_by_fd(listener->shard_schedules ?
+				 listener->shard_schedules[i] :
+				 listener->schedule, listener->socks[i]);
     shutdown(listener->socks[i], 2);
     close(listener->socks[i]);
   }
 
   silc_free(listener->socks);
+  silc_free(listener->shard_schedules);
   silc_free(listener);
 }
 
@@ -560,6 +832,17 @@ int silc_net_udp_receive(SilcStream stream, char *remote_ip_addr,
   if (!len)
     silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
 
+  /* Delivery pacing: consume read budget and pause reading until the
+     QoS tick refills the bucket */
+  if (sock->qos && sock->qos->rate && len > 0) {
+    if (sock->qos->tokens > (SilcUInt32)len)
+      sock->qos->tokens -= len;
+    else
+      sock->qos->tokens = 0;
+    if (!sock->qos->tokens)
+      silc_socket_stream_qos_throttle(sock);
+  }
+
   /* Return remote address */
   if (remote_ip_addr && remote_port) {
     if (sock->ipv6) {
@@ -594,6 +877,18 @@ int silc_net_udp_send(SilcStream stream,
 
   SILC_LOG_DEBUG(("Sending data to UDP socket %d", sock->sock));
 
+  /* Rate shaping: a datagram over the budget is dropped and counted,
+     not queued; pacing UDP by queueing would only move the burst. */
+  if (sock->qos && sock->qos->rate) {
+    silc_socket_stream_qos_refill(sock->qos);
+    if (sock->qos->tokens < data_len) {
+      sock->qos->dropped++;
+      silc_set_errno(SILC_ERR_LIMIT);
+      return (int)data_len;
+    }
+    sock->qos->tokens -= data_len;
+  }
+
   /* Set sockaddr */
   if (!silc_net_set_sockaddr(&remote, remote_ip_addr, remote_port))
     return -2;
@@ -623,6 +918,213 @@ int silc_net_udp_send(SilcStream stream,
   return ret;
 }
 
+/* Maximum number of datagrams in one batched receive/send call */
+#define SILC_NET_UDP_BATCH_MAX 32
+
+/* Set UDP generic segmentation offload */
+
+SilcBool silc_net_udp_set_gso(SilcStream stream, SilcUInt32 segment_size)
+{
+#if defined(UDP_SEGMENT)
+  SilcSocketStream sock = stream;
+
+  if (silc_net_set_socket_opt(sock->sock, IPPROTO_UDP, UDP_SEGMENT,
+			      segment_size) != 0)
+    return FALSE;
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* UDP_SEGMENT */
+}
+
+/* Set UDP generic receive offload */
+
+SilcBool silc_net_udp_set_gro(SilcStream stream, SilcBool enable)
+{
+#if defined(UDP_GRO)
+  SilcSocketStream sock = stream;
+
+  if (silc_net_set_socket_opt(sock->sock, IPPROTO_UDP, UDP_GRO,
+			      enable ? 1 : 0) != 0)
+    return FALSE;
+
+  return TRUE;
+#else
+  silc_set_errno(SILC_ERR_NOT_SUPPORTED);
+  return FALSE;
+#endif /* UDP_GRO */
+}
+
+/* Receive multiple UDP packets */
+
+int silc_net_udp_receive_multi(SilcStream stream,
+			       SilcNetUdpDatagram *packets,
+			       SilcUInt32 num_packets)
+{
+  SilcSocketStream sock = stream;
+  int ret;
+  SilcUInt32 i;
+
+  SILC_LOG_DEBUG(("Reading up to %d datagrams from UDP socket %d",
+		  num_packets, sock->sock));
+
+#if defined(HAVE_RECVMMSG)
+  {
+    struct mmsghdr msgs[SILC_NET_UDP_BATCH_MAX];
+    struct iovec iovs[SILC_NET_UDP_BATCH_MAX];
+    struct sockaddr_storage froms[SILC_NET_UDP_BATCH_MAX];
+    SilcUInt32 count;
+
+    count = num_packets > SILC_NET_UDP_BATCH_MAX ?
+      SILC_NET_UDP_BATCH_MAX : num_packets;
+
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (i = 0; i < count; i++) {
+      iovs[i].iov_base = packets[i].data;
+      iovs[i].iov_len = packets[i].data_size;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &froms[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(froms[i]);
+    }
+
+    ret = recvmmsg(sock->sock, msgs, count, 0, NULL);
+    if (ret < 0) {
+      silc_set_errno_posix(errno);
+      if (errno == EAGAIN || errno == EINTR) {
+	silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				    SILC_TASK_READ, FALSE);
+	return -1;
+      }
+      SILC_LOG_DEBUG(("Cannot read from UDP socket: %d:%s",
+		      sock->sock, strerror(errno)));
+      silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
+      return -2;
+    }
+
+    for (i = 0; i < (SilcUInt32)ret; i++) {
+      packets[i].data_len = msgs[i].msg_len;
+      packets[i].port = 0;
+      packets[i].ip_addr[0] = '\0';
+      if (froms[i].ss_family == AF_INET) {
+	struct sockaddr_in *sin = (struct sockaddr_in *)&froms[i];
+	packets[i].port = ntohs(sin->sin_port);
+	inet_ntop(AF_INET, &sin->sin_addr, packets[i].ip_addr,
+		  sizeof(packets[i].ip_addr));
+      }
+#ifdef HAVE_IPV6
+      else if (froms[i].ss_family == AF_INET6) {
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&froms[i];
+	packets[i].port = ntohs(sin6->sin6_port);
+	inet_ntop(AF_INET6, &sin6->sin6_addr, packets[i].ip_addr,
+		  sizeof(packets[i].ip_addr));
+      }
+#endif /* HAVE_IPV6 */
+    }
+
+    SILC_LOG_DEBUG(("Read %d datagrams", ret));
+    return ret;
+  }
+#else
+  /* Receive one at a time */
+  for (i = 0; i < num_packets; i++) {
+    ret = silc_net_udp_receive(stream, packets[i].ip_addr,
+			       sizeof(packets[i].ip_addr),
+			       &packets[i].port, packets[i].data,
+			       packets[i].data_size);
+    if (ret < 0) {
+      if (i)
+	return i;
+      return ret;
+    }
+    packets[i].data_len = ret;
+  }
+
+  return num_packets;
+#endif /* HAVE_RECVMMSG */
+}
+
+/* Send multiple UDP packets */
+
+int silc_net_udp_send_multi(SilcStream stream,
+			    SilcNetUdpDatagram *packets,
+			    SilcUInt32 num_packets)
+{
+  SilcSocketStream sock = stream;
+  int ret;
+  SilcUInt32 i;
+
+  SILC_LOG_DEBUG(("Sending %d datagrams to UDP socket %d", num_packets,
+		  sock->sock));
+
+#if defined(HAVE_SENDMMSG)
+  {
+    struct mmsghdr msgs[SILC_NET_UDP_BATCH_MAX];
+    struct iovec iovs[SILC_NET_UDP_BATCH_MAX];
+    SilcSockaddr remotes[SILC_NET_UDP_BATCH_MAX];
+    SilcUInt32 count;
+
+    count = num_packets > SILC_NET_UDP_BATCH_MAX ?
+      SILC_NET_UDP_BATCH_MAX : num_packets;
+
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (i = 0; i < count; i++) {
+      iovs[i].iov_base = packets[i].data;
+      iovs[i].iov_len = packets[i].data_len;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      if (!sock->connected) {
+	if (!silc_net_set_sockaddr(&remotes[i], packets[i].ip_addr,
+				   packets[i].port))
+	  return -2;
+	msgs[i].msg_hdr.msg_name = &remotes[i].sa;
+	msgs[i].msg_hdr.msg_namelen = SIZEOF_SOCKADDR(remotes[i]);
+      }
+    }
+
+    ret = sendmmsg(sock->sock, msgs, count, 0);
+    if (ret < 0) {
+      silc_set_errno_posix(errno);
+      if (errno == EAGAIN || errno == EINTR) {
+	SILC_LOG_DEBUG(("Could not send immediately, will do it later"));
+	silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				    SILC_TASK_READ | SILC_TASK_WRITE, FALSE);
+	return -1;
+      }
+      SILC_LOG_DEBUG(("Cannot send to UDP socket: %s", strerror(errno)));
+      silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
+      return -2;
+    }
+
+    SILC_LOG_DEBUG(("Sent %d datagrams", ret));
+    if (silc_schedule_get_fd_events(sock->schedule, sock->sock) &
+	SILC_TASK_WRITE)
+      silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				  SILC_TASK_READ, FALSE);
+
+    return ret;
+  }
+#else
+  /* Send one at a time */
+  for (i = 0; i < num_packets; i++) {
+    if (!sock->connected)
+      ret = silc_net_udp_send(stream, packets[i].ip_addr, packets[i].port,
+			      packets[i].data, packets[i].data_len);
+    else
+      ret = silc_stream_write(stream, packets[i].data, packets[i].data_len);
+    if (ret < 0) {
+      if (i)
+	return i;
+      return ret;
+    }
+  }
+
+  return num_packets;
+#endif /* HAVE_SENDMMSG */
+}
+
 /******************************* TCP Stream *********************************/
 
 /* Asynchronous TCP/IP connecting */
@@ -637,7 +1139,10 @@ typedef struct {
   char *local_ip;
   char *remote;
   char ip_addr[64];
+  char ip_addr2[64];		  /* Other address family (happy eyeballs) */
   int sock;
+  int sock2;			  /* Secondary staggered attempt */
+  int ready_sock;		  /* The attempt that became ready */
   SilcNetCallback callback;
   void *context;
   unsigned int port     : 24;
@@ -653,9 +1158,59 @@ SILC_FSM_STATE(silc_net_connect_st_finish);
 SILC_TASK_CALLBACK(silc_net_connect_wait)
 {
   SilcNetConnect conn = context;
+  conn->ready_sock = fd;
   SILC_FSM_EVENT_SIGNAL(&conn->event);
 }
 
+/* Starts the staggered secondary connection attempt to the other address
+   family if the primary attempt has not completed yet (RFC 8305 style
+   happy eyeballs). */
+
+SILC_TASK_CALLBACK(silc_net_connect_he_start)
+{
+  SilcNetConnect conn = context;
+  SilcSockaddr desthost;
+  int sock, rval;
+
+  if (conn->aborted || conn->ready_sock || conn->sock2 ||
+      !conn->ip_addr2[0])
+    return;
+
+  SILC_LOG_DEBUG(("Starting secondary connection attempt to %s",
+		  conn->ip_addr2));
+
+  if (!silc_net_set_sockaddr(&desthost, conn->ip_addr2, conn->port))
+    return;
+
+  sock = socket(desthost.sin.sin_family, SOCK_STREAM, 0);
+  if (sock < 0)
+    return;
+
+  if (conn->local_ip) {
+    SilcSockaddr local;
+    if (silc_net_set_sockaddr(&local, conn->local_ip, 0))
+      bind(sock, &local.sa, SIZEOF_SOCKADDR(local));
+  }
+
+  silc_net_set_socket_nonblock(sock);
+
+  rval = connect(sock, &desthost.sa, SIZEOF_SOCKADDR(desthost));
+  if (rval < 0 && errno != EINPROGRESS) {
+    shutdown(sock, 2);
+    close(sock);
+    return;
+  }
+
+#if defined(TCP_NODELAY)
+  silc_net_set_socket_opt(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+#endif
+  silc_net_set_socket_opt(sock, SOL_SOCKET, SO_KEEPALIVE, 1);
+
+  conn->sock2 = sock;
+  silc_schedule_task_add_fd(schedule, sock, silc_net_connect_wait, conn);
+  silc_schedule_set_listen_fd(schedule, sock, SILC_TASK_WRITE, FALSE);
+}
+
 SILC_FSM_STATE(silc_net_connect_st_start)
 {
   SilcNetConnect conn = fsm_context;
@@ -749,6 +1304,24 @@ SILC_FSM_STATE(silc_net_connect_st_start)
   SILC_LOG_DEBUG(("Connection operation in progress"));
 
   conn->sock = sock;
+  conn->sock2 = 0;
+  conn->ready_sock = 0;
+
+  /* Resolve the other address family for a staggered parallel attempt;
+     if the primary is slow to connect the secondary starts after a short
+     delay and whichever completes first wins. */
+  conn->ip_addr2[0] = '\0';
+  if (prefer_ipv6 && silc_net_is_ip6(conn->ip_addr)) {
+    if (silc_net_gethostbyname(conn->remote, FALSE, conn->ip_addr2,
+			       sizeof(conn->ip_addr2)))
+      if (silc_net_is_ip6(conn->ip_addr2) ||
+	  !strcmp(conn->ip_addr2, conn->ip_addr))
+	conn->ip_addr2[0] = '\0';
+  }
+  if (conn->ip_addr2[0])
+    silc_schedule_task_add_timeout(silc_fsm_get_schedule(fsm),
+				   silc_net_connect_he_start, conn,
+				   0, 250000);
 
   /** Wait for connection */
   silc_fsm_next(fsm, silc_net_connect_st_connected);
@@ -775,21 +1348,54 @@ SILC_FSM_STATE(silc_net_connect_st_connected)
 {
   SilcNetConnect conn = fsm_context;
   SilcSchedule schedule = silc_fsm_get_schedule(fsm);
-  int opt = EINVAL, optlen = sizeof(opt), ret;
+  int opt = EINVAL, optlen = sizeof(opt), ret, winner;
+
+  /* Cancel the staggered secondary attempt timer */
+  silc_schedule_task_del_by_all(schedule, 0, silc_net_connect_he_start,
+				conn);
 
   if (conn->aborted) {
     /** Aborted */
     silc_schedule_unset_listen_fd(schedule, conn->sock);
     silc_schedule_task_del_by_fd(schedule, conn->sock);
+    if (conn->sock2) {
+      silc_schedule_unset_listen_fd(schedule, conn->sock2);
+      silc_schedule_task_del_by_fd(schedule, conn->sock2);
+      silc_net_close_connection(conn->sock2);
+      conn->sock2 = 0;
+    }
     silc_fsm_next(fsm, silc_net_connect_st_finish);
     return SILC_FSM_CONTINUE;
   }
 
-  ret = silc_net_get_socket_opt(conn->sock, SOL_SOCKET, SO_ERROR,
+  /* The attempt that signalled readiness wins */
+  winner = conn->ready_sock ? conn->ready_sock : conn->sock;
+
+  ret = silc_net_get_socket_opt(winner, SOL_SOCKET, SO_ERROR,
 				&opt, &optlen);
 
   silc_schedule_unset_listen_fd(schedule, conn->sock);
   silc_schedule_task_del_by_fd(schedule, conn->sock);
+  if (conn->sock2) {
+    silc_schedule_unset_listen_fd(schedule, conn->sock2);
+    silc_schedule_task_del_by_fd(schedule, conn->sock2);
+  }
+
+  if (ret == 0 && opt == 0) {
+    /* Close the losing attempt */
+    if (conn->sock2 && winner == conn->sock2) {
+      SILC_LOG_DEBUG(("Secondary connection attempt won"));
+      silc_net_close_connection(conn->sock);
+      conn->sock = conn->sock2;
+      memcpy(conn->ip_addr, conn->ip_addr2, sizeof(conn->ip_addr));
+    } else if (conn->sock2) {
+      silc_net_close_connection(conn->sock2);
+    }
+    conn->sock2 = 0;
+  } else if (conn->sock2) {
+    silc_net_close_connection(conn->sock2);
+    conn->sock2 = 0;
+  }
 
   if (ret != 0 || opt != 0) {
     if (conn->retry) {
@@ -970,6 +1576,13 @@ SilcBool silc_net_addr2bin(const char *addr, void *bin, SilcUInt32 bin_len)
 {
   int ret = 0;
 
+  /* One-pass parsers handle well-formed addresses without library
+     round trips */
+  if (bin_len >= 4 && silc_net_parse_ip4(addr, bin))
+    return TRUE;
+  if (bin_len >= 16 && silc_net_parse_ip6(addr, bin))
+    return TRUE;
+
   if (silc_net_is_ip4(addr)) {
     /* IPv4 address */
     struct in_addr tmp;
@@ -19,20 +19,60 @@
 
 #include "silcruntime.h"
 
+#if defined(HAVE_IO_URING) && defined(HAVE_EPOLL_WAIT)
+#include <liburing.h>
+#include <poll.h>
+#endif
 #if defined(HAVE_EPOLL_WAIT)
 #include <sys/epoll.h>
 #elif defined(HAVE_POLL) && defined(HAVE_SETRLIMIT) && defined(RLIMIT_NOFILE)
 #include <poll.h>
 #endif
 
+#if defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_EVENTFD)
+#define SILC_EVENTFD
+#include <sys/eventfd.h>
+#endif
+#if defined(HAVE_SYS_SIGNALFD_H) && defined(HAVE_SIGNALFD)
+#define SILC_SIGNALFD
+#include <sys/signalfd.h>
+#endif
+#if defined(HAVE_SYS_TIMERFD_H) && defined(HAVE_TIMERFD_CREATE) && \
+  defined(HAVE_EPOLL_WAIT)
+#define SILC_TIMERFD
+#include <sys/timerfd.h>
+#endif
+
 const SilcScheduleOps schedule_ops;
 
+/* Number of submission entries in the io_uring.  This is only staging
+   space; any number of fds may be polled through the ring. */
+#define SILC_URING_ENTRIES 4096
+
+typedef struct {
+  SilcUInt32 sig;
+  SilcTaskCallback callback;
+  void *context;
+  SilcBool call;
+  SilcSchedule schedule;
+} SilcUnixSignal;
+
+#define SIGNAL_COUNT 32
+
 /* Internal context. */
 typedef struct {
 #if defined(HAVE_EPOLL_WAIT)
   struct epoll_event *fds;
   SilcUInt32 fds_count;
+  SilcTaskFd *ready;
+  SilcUInt32 ready_count;
+  SilcUInt32 ready_size;
   int epfd;
+  unsigned int edge_trigger  : 1;
+#if defined(HAVE_IO_URING)
+  struct io_uring ring;
+  unsigned int ring_enabled  : 1;
+#endif /* HAVE_IO_URING */
 #elif defined(HAVE_POLL) && defined(HAVE_SETRLIMIT) && defined(RLIMIT_NOFILE)
   struct rlimit nofile;
   struct pollfd *fds;
@@ -41,23 +81,55 @@ typedef struct {
   void *app_context;
   int wakeup_pipe[2];
   SilcTask wakeup_task;
+#if defined(SILC_TIMERFD)
+  int tfd;
+  SilcTask timer_task;
+  unsigned int tfd_armed     : 1;
+#endif /* SILC_TIMERFD */
+#if defined(SILC_EVENTFD)
+  unsigned int wakeup_eventfd : 1;
+#endif /* SILC_EVENTFD */
+#if defined(SILC_SIGNALFD)
+  int sigfd;
+  SilcTask sigfd_task;
+  SilcUnixSignal sigcall[SIGNAL_COUNT];
+#endif /* SILC_SIGNALFD */
   sigset_t signals;
   sigset_t signals_blocked;
 } *SilcUnixScheduler;
 
-typedef struct {
-  SilcUInt32 sig;
-  SilcTaskCallback callback;
-  void *context;
-  SilcBool call;
-  SilcSchedule schedule;
-} SilcUnixSignal;
-
-#define SIGNAL_COUNT 32
+void silc_schedule_internal_wakeup(SilcSchedule schedule, void *context);
 
 #if defined(HAVE_EPOLL_WAIT)
 
-/* Linux's fast epoll system (level triggered) */
+/* Linux's fast epoll system (level triggered by default, edge triggered
+   with readiness caching when SILC_SCHEDULER=epoll-et) */
+
+/* Add `task' to the readiness cache.  In edge-triggered mode the kernel
+   reports an fd only on readiness transitions; the cache carries the
+   reported readiness on the task until it has been delivered to the task
+   callback, so re-enabling interest on a hot fd costs neither an epoll_ctl
+   nor a redundant kernel report. */
+
+static void silc_epoll_ready_add(SilcUnixScheduler internal, SilcTaskFd task)
+{
+  SilcTaskFd *ready;
+
+  if (task->in_ready)
+    return;
+
+  if (internal->ready_count >= internal->ready_size) {
+    ready = silc_realloc(internal->ready, sizeof(*internal->ready) *
+			 (internal->ready_size + 16));
+    if (silc_unlikely(!ready))
+      return;
+    internal->ready = ready;
+    internal->ready_size += 16;
+  }
+
+  internal->ready[internal->ready_count++] = task;
+  task->in_ready = TRUE;
+}
 
 int silc_epoll(SilcSchedule schedule, void *context)
 {
@@ -78,18 +150,104 @@ int silc_epoll(SilcSchedule schedule, void *context)
     }
   }
 
+#if defined(SILC_TIMERFD)
+  if (internal->tfd >= 0) {
+    /* The earliest timeout is armed in the kernel timer with exact
+       precision; epoll_wait itself sleeps without a timeout. */
+    struct itimerspec its;
+
+    if (schedule->has_timeout &&
+	(schedule->timeout.tv_sec || schedule->timeout.tv_usec)) {
+      memset(&its, 0, sizeof(its));
+      its.it_value.tv_sec = schedule->timeout.tv_sec;
+      its.it_value.tv_nsec = schedule->timeout.tv_usec * 1000;
+      timerfd_settime(internal->tfd, 0, &its, NULL);
+      internal->tfd_armed = TRUE;
+    } else if (!schedule->has_timeout && internal->tfd_armed) {
+      memset(&its, 0, sizeof(its));
+      timerfd_settime(internal->tfd, 0, &its, NULL);
+      internal->tfd_armed = FALSE;
+    }
+    if (schedule->has_timeout &&
+	!schedule->timeout.tv_sec && !schedule->timeout.tv_usec)
+      timeout = 0;
+  } else
+#endif /* SILC_TIMERFD */
   if (schedule->has_timeout)
     timeout = ((schedule->timeout.tv_sec * 1000) +
 	       (schedule->timeout.tv_usec / 1000));
 
   SILC_SCHEDULE_UNLOCK(schedule);
-  ret = epoll_wait(internal->epfd, fds, fds_count, timeout);
+  if (schedule->busy_poll_usec && timeout != 0) {
+    /* Busy-poll mode: spin on a zero-timeout poll for the configured
+       window before paying the sleep/wake cost.  Timer expiry ends the
+       spin through the timerfd like any other event. */
+    SilcUInt64 end = silc_time_monotonic_usec() + schedule->busy_poll_usec;
+
+    do
+      ret = epoll_wait(internal->epfd, fds, fds_count, 0);
+    while (ret == 0 && schedule->valid &&
+	   silc_time_monotonic_usec() < end);
+
+    if (ret == 0)
+      ret = epoll_wait(internal->epfd, fds, fds_count, timeout);
+  } else {
+    ret = epoll_wait(internal->epfd, fds, fds_count, timeout);
+  }
   SILC_SCHEDULE_LOCK(schedule);
-  if (ret <= 0)
+  if (ret < 0)
     return ret;
+  if (ret == 0 && silc_likely(!internal->ready_count))
+    return 0;
 
   silc_list_init(schedule->fd_dispatch, struct SilcTaskStruct, next);
 
+  if (internal->edge_trigger) {
+    SilcUInt32 k, count = 0;
+
+    /* Merge newly reported readiness into the per-fd cache */
+    for (i = 0; i < ret; i++) {
+      task = fds[i].data.ptr;
+      if (!task->header.valid) {
+	epoll_ctl(internal->epfd, EPOLL_CTL_DEL, task->fd, &fds[i]);
+	task->scheduled = FALSE;
+	continue;
+      }
+      if (fds[i].events & (EPOLLIN | EPOLLPRI | EPOLLHUP | EPOLLERR))
+	task->ready |= SILC_TASK_READ;
+      if (fds[i].events & EPOLLOUT)
+	task->ready |= SILC_TASK_WRITE;
+      silc_epoll_ready_add(internal, task);
+    }
+
+    /* Dispatch from the cache.  Readiness the task is not interested in
+       remains cached; the kernel will not report it again. */
+    for (k = 0; k < internal->ready_count; ) {
+      task = internal->ready[k];
+
+      if (!task->header.valid)
+	task->ready = 0;
+
+      task->revents = task->ready & task->events;
+      if (task->revents) {
+	/* The task callback must consume the fd until it would block;
+	   delivered readiness is dropped from the cache. */
+	task->ready &= ~task->revents;
+	silc_list_add(schedule->fd_dispatch, task);
+	count++;
+      }
+
+      if (!task->ready) {
+	internal->ready[k] = internal->ready[--internal->ready_count];
+	task->in_ready = FALSE;
+	continue;
+      }
+      k++;
+    }
+
+    return count ? (int)count : ret;
+  }
+
   for (i = 0; i < ret; i++) {
     task = fds[i].data.ptr;
     task->revents = 0;
@@ -107,6 +265,121 @@ int silc_epoll(SilcSchedule schedule, void *context)
   return ret;
 }
 
+#if defined(HAVE_IO_URING)
+
+/* Linux io_uring system.  All readiness events are delivered in one batch
+   through the completion ring and polls are armed through the submission
+   ring, with a single io_uring_submit per loop iteration instead of a
+   syscall per fd.  Falls back to epoll at runtime on kernels without
+   io_uring support. */
+
+static unsigned int silc_io_uring_poll_mask(SilcTaskEvent event_mask)
+{
+  unsigned int mask = 0;
+
+  if (event_mask & SILC_TASK_READ)
+    mask |= (POLLIN | POLLPRI);
+  if (event_mask & SILC_TASK_WRITE)
+    mask |= POLLOUT;
+
+  return mask;
+}
+
+/* Arm one-shot poll for `task' in the submission ring */
+
+static SilcBool silc_io_uring_arm(SilcUnixScheduler internal, SilcTaskFd task,
+				  SilcTaskEvent event_mask)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = io_uring_get_sqe(&internal->ring);
+  if (silc_unlikely(!sqe)) {
+    /* Submission ring is full, flush it and retry once */
+    io_uring_submit(&internal->ring);
+    sqe = io_uring_get_sqe(&internal->ring);
+    if (!sqe)
+      return FALSE;
+  }
+
+  io_uring_prep_poll_add(sqe, task->fd, silc_io_uring_poll_mask(event_mask));
+  io_uring_sqe_set_data(sqe, task);
+
+  return TRUE;
+}
+
+int silc_io_uring(SilcSchedule schedule, void *context)
+{
+  SilcUnixScheduler internal = context;
+  SilcTaskFd task;
+  struct io_uring_cqe *cqe;
+  struct __kernel_timespec ts, *tsp = NULL;
+  unsigned int head, nr = 0;
+  int ret;
+
+  if (!internal->ring_enabled)
+    return silc_epoll(schedule, context);
+
+  if (schedule->has_timeout) {
+    ts.tv_sec = schedule->timeout.tv_sec;
+    ts.tv_nsec = schedule->timeout.tv_usec * 1000;
+    tsp = &ts;
+  }
+
+  SILC_SCHEDULE_UNLOCK(schedule);
+  ret = io_uring_submit(&internal->ring);
+  if (silc_likely(ret >= 0))
+    ret = io_uring_wait_cqe_timeout(&internal->ring, &cqe, tsp);
+  SILC_SCHEDULE_LOCK(schedule);
+
+  if (ret == -ETIME)
+    return 0;
+  if (silc_unlikely(ret < 0)) {
+    errno = -ret;
+    return -1;
+  }
+
+  silc_list_init(schedule->fd_dispatch, struct SilcTaskStruct, next);
+
+  /* Harvest all completions in one batch */
+  io_uring_for_each_cqe(&internal->ring, head, cqe) {
+    task = io_uring_cqe_get_data(cqe);
+    nr++;
+
+    /* Poll removals carry no task */
+    if (silc_unlikely(!task))
+      continue;
+
+    /* A cancelled completion is from a poll we already disarmed; it must
+       not touch the state of the currently armed poll. */
+    if (silc_unlikely(cqe->res == -ECANCELED))
+      continue;
+
+    /* Polls are one-shot; completion disarms the task */
+    task->scheduled = FALSE;
+
+    if (silc_unlikely(cqe->res < 0))
+      continue;
+    if (silc_unlikely(!task->header.valid || !task->events))
+      continue;
+
+    task->revents = 0;
+    if (cqe->res & (POLLIN | POLLPRI | POLLHUP | POLLERR))
+      task->revents |= SILC_TASK_READ;
+    if (cqe->res & POLLOUT)
+      task->revents |= SILC_TASK_WRITE;
+    silc_list_add(schedule->fd_dispatch, task);
+
+    /* Re-arm for the next loop iteration */
+    if (silc_likely(silc_io_uring_arm(internal, task, task->events)))
+      task->scheduled = TRUE;
+  }
+  io_uring_cq_advance(&internal->ring, nr);
+
+  return nr;
+}
+
+#endif /* HAVE_IO_URING */
+
 #elif defined(HAVE_POLL) && defined(HAVE_SETRLIMIT) && defined(RLIMIT_NOFILE)
 
 /* Calls normal poll() system call. */
@@ -274,6 +547,84 @@ SilcBool silc_schedule_internal_schedule_fd(SilcSchedule schedule,
 
   SILC_LOG_DEBUG(("Scheduling fd %lu, mask %x", task->fd, event_mask));
 
+#if defined(HAVE_IO_URING)
+  if (internal->ring_enabled) {
+    struct io_uring_sqe *sqe;
+
+    /* Disarm pending poll before removing or changing the mask */
+    if (task->scheduled) {
+      sqe = io_uring_get_sqe(&internal->ring);
+      if (silc_unlikely(!sqe)) {
+	io_uring_submit(&internal->ring);
+	sqe = io_uring_get_sqe(&internal->ring);
+	if (!sqe)
+	  return FALSE;
+      }
+      io_uring_prep_poll_remove(sqe, SILC_PTR_TO_64(task));
+      io_uring_sqe_set_data(sqe, NULL);
+      task->scheduled = FALSE;
+    }
+
+    /* Zero mask unschedules task */
+    if (silc_unlikely(!event_mask))
+      return TRUE;
+
+    if (silc_unlikely(!silc_io_uring_arm(internal, task, event_mask)))
+      return FALSE;
+    task->scheduled = TRUE;
+    return TRUE;
+  }
+#endif /* HAVE_IO_URING */
+
+  if (internal->edge_trigger) {
+    /* Edge-triggered mode.  The fd is registered once for all events;
+       interest changes are filtered at dispatch from the readiness cache
+       and cost no epoll_ctl. */
+    if (silc_unlikely(!event_mask)) {
+      task->ready = 0;
+
+      /* Purge from the readiness cache; the task may be freed after this */
+      if (task->in_ready) {
+	SilcUInt32 k;
+	for (k = 0; k < internal->ready_count; k++)
+	  if (internal->ready[k] == task) {
+	    internal->ready[k] = internal->ready[--internal->ready_count];
+	    break;
+	  }
+	task->in_ready = FALSE;
+      }
+
+      if (task->scheduled) {
+	memset(&event, 0, sizeof(event));
+	if (epoll_ctl(internal->epfd, EPOLL_CTL_DEL, task->fd, &event)) {
+	  SILC_LOG_DEBUG(("epoll_ctl (DEL): %s", strerror(errno)));
+	  return FALSE;
+	}
+	task->scheduled = FALSE;
+      }
+      return TRUE;
+    }
+
+    if (silc_unlikely(!task->scheduled)) {
+      memset(&event, 0, sizeof(event));
+      event.events = (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLET);
+      event.data.ptr = task;
+      if (epoll_ctl(internal->epfd, EPOLL_CTL_ADD, task->fd, &event)) {
+	SILC_LOG_DEBUG(("epoll_ctl (ADD): %s", strerror(errno)));
+	return FALSE;
+      }
+      task->scheduled = TRUE;
+      return TRUE;
+    }
+
+    /* If cached readiness matches the new interest the kernel will not
+       report it again; wake up the scheduler to dispatch from the cache. */
+    if (task->ready & event_mask)
+      silc_schedule_internal_wakeup(schedule, internal);
+
+    return TRUE;
+  }
+
   memset(&event, 0, sizeof(event));
   if (event_mask & SILC_TASK_READ)
     event.events |= (EPOLLIN | EPOLLPRI);
@@ -320,6 +671,13 @@ SILC_TASK_CALLBACK(silc_schedule_wakeup_cb)
 
   SILC_LOG_DEBUG(("Wokeup"));
 
+#if defined(SILC_EVENTFD)
+  if (internal->wakeup_eventfd) {
+    SilcUInt64 w;
+    (void)read(internal->wakeup_pipe[0], &w, sizeof(w));
+    return;
+  }
+#endif /* SILC_EVENTFD */
   (void)read(internal->wakeup_pipe[0], &c, 1);
 }
 
@@ -342,6 +700,99 @@ SILC_TASK_CALLBACK(silc_schedule_wakeup_init)
 }
 #endif /* SILC_THREADS */
 
+#if defined(SILC_TIMERFD)
+
+/* The timer fd has expired.  The expired timeout tasks are dispatched by
+   the scheduler loop; here the timer is only consumed. */
+
+SILC_TASK_CALLBACK(silc_schedule_timerfd_cb)
+{
+  SilcUnixScheduler internal = (SilcUnixScheduler)context;
+  SilcUInt64 expirations;
+
+  (void)read(internal->tfd, &expirations, sizeof(expirations));
+  internal->tfd_armed = FALSE;
+}
+
+SILC_TASK_CALLBACK(silc_schedule_timerfd_init)
+{
+  SilcUnixScheduler internal = schedule->internal;
+
+  internal->timer_task =
+    silc_schedule_task_add(schedule, internal->tfd,
+			   silc_schedule_timerfd_cb, internal,
+			   0, 0, SILC_TASK_FD);
+  if (!internal->timer_task) {
+    SILC_LOG_WARNING(("Could not add timer task, using timeout argument"));
+    close(internal->tfd);
+    internal->tfd = -1;
+    return;
+  }
+  silc_schedule_internal_schedule_fd(schedule, internal,
+				     (SilcTaskFd)internal->timer_task,
+				     SILC_TASK_READ);
+}
+
+#endif /* SILC_TIMERFD */
+
+#if defined(SILC_SIGNALFD)
+
+/* Deliver signals read from the signal fd.  Registered signals are
+   blocked and delivered here as normal fd events, so no global signal
+   bookkeeping or signal masking is needed in the dispatch path. */
+
+SILC_TASK_CALLBACK(silc_schedule_signalfd_cb)
+{
+  SilcUnixScheduler internal = (SilcUnixScheduler)context;
+  struct signalfd_siginfo si[16];
+  ssize_t len;
+  int i, k;
+
+  for (;;) {
+    len = read(internal->sigfd, si, sizeof(si));
+    if (len <= 0)
+      break;
+
+    for (i = 0; i < len / (int)sizeof(si[0]); i++) {
+      for (k = 0; k < SIGNAL_COUNT; k++) {
+	if (internal->sigcall[k].sig == si[i].ssi_signo &&
+	    internal->sigcall[k].callback) {
+	  SILC_LOG_DEBUG(("Dispatching signal %d", si[i].ssi_signo));
+	  internal->sigcall[k].callback(schedule, internal->app_context,
+					SILC_TASK_INTERRUPT,
+					si[i].ssi_signo,
+					internal->sigcall[k].context);
+	  break;
+	}
+      }
+    }
+
+    if (len < (int)sizeof(si))
+      break;
+  }
+}
+
+SILC_TASK_CALLBACK(silc_schedule_signalfd_init)
+{
+  SilcUnixScheduler internal = schedule->internal;
+
+  internal->sigfd_task =
+    silc_schedule_task_add(schedule, internal->sigfd,
+			   silc_schedule_signalfd_cb, internal,
+			   0, 0, SILC_TASK_FD);
+  if (!internal->sigfd_task) {
+    SILC_LOG_WARNING(("Could not add signal fd task, using signal handler"));
+    close(internal->sigfd);
+    internal->sigfd = -1;
+    return;
+  }
+  silc_schedule_internal_schedule_fd(schedule, internal,
+				     (SilcTaskFd)internal->sigfd_task,
+				     SILC_TASK_READ);
+}
+
+#endif /* SILC_SIGNALFD */
+
 /* Initializes the platform specific scheduler.  This for example initializes
    the wakeup mechanism of the scheduler.  In multi-threaded environment
    the scheduler needs to be woken up when tasks are added or removed from
@@ -359,14 +810,41 @@ void *silc_schedule_internal_init(SilcSchedule schedule,
     return NULL;
 
 #if defined(HAVE_EPOLL_WAIT)
+  /* SILC_SCHEDULER in the environment selects the backend explicitly:
+     "io_uring", "epoll" (level triggered) or "epoll-et" (edge triggered
+     with readiness caching). */
+  {
+    const char *backend = silc_getenv("SILC_SCHEDULER");
+
+#if defined(HAVE_IO_URING)
+    /* Prefer io_uring when the kernel supports it */
+    if (!backend || !strcmp(backend, "io_uring")) {
+      if (!io_uring_queue_init(SILC_URING_ENTRIES, &internal->ring, 0))
+	internal->ring_enabled = TRUE;
+      else
+	SILC_LOG_DEBUG(("io_uring not available, using epoll"));
+    }
+#endif /* HAVE_IO_URING */
+
+    if (backend && !strcmp(backend, "epoll-et"))
+      internal->edge_trigger = TRUE;
+  }
   internal->epfd = epoll_create(4);
   if (internal->epfd < 0) {
     SILC_LOG_ERROR(("epoll_create() failed: %s", strerror(errno)));
+#if defined(HAVE_IO_URING)
+    if (internal->ring_enabled)
+      io_uring_queue_exit(&internal->ring);
+#endif /* HAVE_IO_URING */
     return NULL;
   }
   internal->fds = silc_calloc(4, sizeof(*internal->fds));
   if (!internal->fds) {
     close(internal->epfd);
+#if defined(HAVE_IO_URING)
+    if (internal->ring_enabled)
+      io_uring_queue_exit(&internal->ring);
+#endif /* HAVE_IO_URING */
     return NULL;
   }
   internal->fds_count = 4;
@@ -392,6 +870,14 @@ void *silc_schedule_internal_init(SilcSchedule schedule,
   sigemptyset(&internal->signals);
 
 #ifdef SILC_THREADS
+#if defined(SILC_EVENTFD)
+  /* One eventfd replaces the wakeup pipe pair */
+  internal->wakeup_pipe[0] = internal->wakeup_pipe[1] =
+    eventfd(0, EFD_NONBLOCK);
+  if (internal->wakeup_pipe[0] >= 0) {
+    internal->wakeup_eventfd = TRUE;
+  } else
+#endif /* SILC_EVENTFD */
   if (pipe(internal->wakeup_pipe)) {
     SILC_LOG_ERROR(("pipe() fails: %s", strerror(errno)));
     return NULL;
@@ -401,8 +887,27 @@ void *silc_schedule_internal_init(SilcSchedule schedule,
 				 internal, 0, 0);
 #endif /* SILC_THREADS */
 
+#if defined(SILC_TIMERFD)
+  /* Kernel timer delivers the earliest timeout with exact precision */
+  internal->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  if (internal->tfd >= 0)
+    silc_schedule_task_add_timeout(schedule, silc_schedule_timerfd_init,
+				   internal, 0, 0);
+#endif /* SILC_TIMERFD */
+
   internal->app_context = app_context;
 
+#if defined(SILC_SIGNALFD)
+  /* Signals are delivered through a signal fd as normal fd events.  The
+     global signal handler bookkeeping below is only a fallback. */
+  internal->sigfd = signalfd(-1, &internal->signals, SFD_NONBLOCK);
+  if (internal->sigfd >= 0) {
+    silc_schedule_task_add_timeout(schedule, silc_schedule_signalfd_init,
+				   internal, 0, 0);
+    return (void *)internal;
+  }
+#endif /* SILC_SIGNALFD */
+
   signal_call = silc_global_get_var("srtsignals", TRUE);
   if (!signal_call)
     signal_call = silc_global_set_var("srtsignals",
@@ -435,12 +940,32 @@ void silc_schedule_internal_uninit(SilcSchedule schedule, void *context)
 
 #ifdef SILC_THREADS
   close(internal->wakeup_pipe[0]);
-  close(internal->wakeup_pipe[1]);
+#if defined(SILC_EVENTFD)
+  if (!internal->wakeup_eventfd)
+#endif /* SILC_EVENTFD */
+    close(internal->wakeup_pipe[1]);
 #endif
 
+#if defined(SILC_TIMERFD)
+  if (internal->tfd >= 0)
+    close(internal->tfd);
+#endif /* SILC_TIMERFD */
+
+#if defined(SILC_SIGNALFD)
+  if (internal->sigfd >= 0) {
+    sigprocmask(SIG_UNBLOCK, &internal->signals, NULL);
+    close(internal->sigfd);
+  }
+#endif /* SILC_SIGNALFD */
+
 #if defined(HAVE_EPOLL_WAIT)
+#if defined(HAVE_IO_URING)
+  if (internal->ring_enabled)
+    io_uring_queue_exit(&internal->ring);
+#endif /* HAVE_IO_URING */
   close(internal->epfd);
   silc_free(internal->fds);
+  silc_free(internal->ready);
 #elif defined(HAVE_POLL) && defined(HAVE_SETRLIMIT) && defined(RLIMIT_NOFILE)
   silc_free(internal->fds);
 #endif /* HAVE_POLL && HAVE_SETRLIMIT && RLIMIT_NOFILE */
@@ -460,6 +985,13 @@ void silc_schedule_internal_wakeup(SilcSchedule schedule, void *context)
 
   SILC_LOG_DEBUG(("Wakeup"));
 
+#if defined(SILC_EVENTFD)
+  if (internal->wakeup_eventfd) {
+    SilcUInt64 w = 1;
+    (void)write(internal->wakeup_pipe[1], &w, sizeof(w));
+    return;
+  }
+#endif /* SILC_EVENTFD */
   (void)write(internal->wakeup_pipe[1], "!", 1);
 #endif
 }
@@ -497,11 +1029,38 @@ void silc_schedule_internal_signal_register(SilcSchedule schedule,
   SilcUnixSignal *signal_call = silc_global_get_var("srtsignals", TRUE);
   int i;
 
-  if (!internal || !signal_call)
+  if (!internal)
     return;
 
   SILC_LOG_DEBUG(("Registering signal %d", sig));
 
+#if defined(SILC_SIGNALFD)
+  if (internal->sigfd >= 0) {
+    sigset_t set;
+
+    for (i = 0; i < SIGNAL_COUNT; i++) {
+      if (!internal->sigcall[i].sig) {
+	internal->sigcall[i].sig = sig;
+	internal->sigcall[i].callback = callback;
+	internal->sigcall[i].context = callback_context;
+	internal->sigcall[i].schedule = schedule;
+	break;
+      }
+    }
+
+    /* Block the signal and add it to the signal fd mask */
+    sigaddset(&internal->signals, sig);
+    sigemptyset(&set);
+    sigaddset(&set, sig);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+    signalfd(internal->sigfd, &internal->signals, SFD_NONBLOCK);
+    return;
+  }
+#endif /* SILC_SIGNALFD */
+
+  if (!signal_call)
+    return;
+
   silc_schedule_internal_signals_block(schedule, context);
 
   for (i = 0; i < SIGNAL_COUNT; i++) {
@@ -528,11 +1087,37 @@ void silc_schedule_internal_signal_unregister(SilcSchedule schedule,
   SilcUnixSignal *signal_call = silc_global_get_var("srtsignals", TRUE);
   int i;
 
-  if (!internal || !signal_call)
+  if (!internal)
     return;
 
   SILC_LOG_DEBUG(("Unregistering signal %d", sig));
 
+#if defined(SILC_SIGNALFD)
+  if (internal->sigfd >= 0) {
+    sigset_t set;
+
+    for (i = 0; i < SIGNAL_COUNT; i++) {
+      if (internal->sigcall[i].sig == sig) {
+	internal->sigcall[i].sig = 0;
+	internal->sigcall[i].callback = NULL;
+	internal->sigcall[i].context = NULL;
+	internal->sigcall[i].schedule = NULL;
+      }
+    }
+
+    /* Remove from the signal fd mask and unblock */
+    sigdelset(&internal->signals, sig);
+    signalfd(internal->sigfd, &internal->signals, SFD_NONBLOCK);
+    sigemptyset(&set);
+    sigaddset(&set, sig);
+    sigprocmask(SIG_UNBLOCK, &set, NULL);
+    return;
+  }
+#endif /* SILC_SIGNALFD */
+
+  if (!signal_call)
+    return;
+
   silc_schedule_internal_signals_block(schedule, context);
 
   for (i = 0; i < SIGNAL_COUNT; i++) {
@@ -563,6 +1148,12 @@ void silc_schedule_internal_signals_call(SilcSchedule schedule, void *context)
   if (!internal || !signal_call)
     return;
 
+#if defined(SILC_SIGNALFD)
+  /* Signals are dispatched from the signal fd task */
+  if (internal->sigfd >= 0)
+    return;
+#endif /* SILC_SIGNALFD */
+
   silc_schedule_internal_signals_block(schedule, context);
 
   for (i = 0; i < SIGNAL_COUNT; i++) {
@@ -592,6 +1183,13 @@ void silc_schedule_internal_signals_block(SilcSchedule schedule, void *context)
   if (!internal)
     return;
 
+#if defined(SILC_SIGNALFD)
+  /* Registered signals are permanently blocked and delivered through the
+     signal fd; no masking is needed around the dispatch path. */
+  if (internal->sigfd >= 0)
+    return;
+#endif /* SILC_SIGNALFD */
+
   sigprocmask(SIG_BLOCK, &internal->signals, &internal->signals_blocked);
 }
 
@@ -605,6 +1203,11 @@ void silc_schedule_internal_signals_unblock(SilcSchedule schedule,
   if (!internal)
     return;
 
+#if defined(SILC_SIGNALFD)
+  if (internal->sigfd >= 0)
+    return;
+#endif /* SILC_SIGNALFD */
+
   sigprocmask(SIG_SETMASK, &internal->signals_blocked, NULL);
 }
 
@@ -613,7 +1216,11 @@ const SilcScheduleOps schedule_ops =
   silc_schedule_internal_init,
   silc_schedule_internal_uninit,
 #if defined(HAVE_EPOLL_WAIT)
+#if defined(HAVE_IO_URING)
+  silc_io_uring,
+#else
   silc_epoll,
+#endif /* HAVE_IO_URING */
 #elif defined(HAVE_POLL) && defined(HAVE_SETRLIMIT) && defined(RLIMIT_NOFILE)
   silc_poll,
 #else
@@ -18,6 +18,10 @@
 */
 
 #include "silcruntime.h"
+#include <sys/uio.h>
+
+/* Maximum number of segments in one writev call */
+#define SILC_SOCKET_STREAM_IOV_MAX 32
 
 /************************ Static utility functions **************************/
 
@@ -72,8 +76,14 @@ int silc_socket_stream_read(SilcStream stream, unsigned char *buf,
 
   SILC_LOG_DEBUG(("Reading data from socket %d", sock->sock));
 
+  SILC_TRACE2(stream_read, sock->sock, buf_len);
+
   /* Handle the simple non-QoS reading. */
   if (!sock->qos) {
+    /* With adaptive read sizing read at most the current read size */
+    if (sock->read_size && buf_len > sock->read_size)
+      buf_len = sock->read_size;
+
     len = read(sock->sock, buf, buf_len);
     if (len < 0) {
       silc_set_errno_posix(errno);
@@ -96,6 +106,66 @@ int silc_socket_stream_read(SilcStream stream, unsigned char *buf,
     if (!len)
       silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
 
+    if (len > 0) {
+      sock->bytes_in += len;
+      sock->ops_in++;
+      sock->last_activity = silc_time_coarse_usec();
+    }
+
+    /* Adapt the read size; grow on full reads, shrink on small ones */
+    if (sock->read_size) {
+      if (len == (int)buf_len && sock->read_size < sock->read_high) {
+	sock->read_size <<= 1;
+	if (sock->read_size > sock->read_high)
+	  sock->read_size = sock->read_high;
+      } else if (len > 0 && len < (int)(sock->read_size >> 2) &&
+		 sock->read_size > sock->read_low) {
+	sock->read_size >>= 1;
+	if (sock->read_size < sock->read_low)
+	  sock->read_size = sock->read_low;
+      }
+    }
+
+    return len;
+  }
+
+  /* Token bucket rate limiting */
+  if (sock->qos->rate) {
+    SilcUInt32 limit = buf_len;
+
+    if (sock->qos->tokens < limit)
+      limit = sock->qos->tokens;
+    if (!limit) {
+      /* Bucket is empty; wait for the coalesced QoS tick to refill it */
+      silc_socket_stream_qos_throttle(sock);
+      silc_set_errno(SILC_ERR_WOULD_BLOCK);
+      return -1;
+    }
+
+    len = read(sock->sock, buf, limit);
+    if (len < 0) {
+      silc_set_errno_posix(errno);
+      if (errno == EAGAIN || errno == EINTR) {
+	SILC_LOG_DEBUG(("Could not read immediately, will do it later"));
+	silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				    silc_schedule_get_fd_events(sock->schedule,
+								sock->sock) |
+				    SILC_TASK_READ, FALSE);
+	return -1;
+      }
+      SILC_LOG_DEBUG(("Cannot read from socket: %d:%s",
+		      sock->sock, strerror(errno)));
+      silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
+      return -2;
+    }
+
+    SILC_LOG_DEBUG(("Read %d bytes", len));
+
+    if (!len)
+      silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
+    else
+      sock->qos->tokens -= len;
+
     return len;
   }
 
@@ -185,7 +255,62 @@ int silc_socket_stream_write(SilcStream stream, const unsigned char *data,
 
   SILC_LOG_DEBUG(("Writing data to socket %d", sock->sock));
 
+  SILC_TRACE2(stream_write, sock->sock, data_len);
+
   ret = write(sock->sock, data, data_len);
+  if (ret > 0) {
+    sock->bytes_out += ret;
+    sock->ops_out++;
+    sock->last_activity = silc_time_coarse_usec();
+  }
+  if (ret < 0) {
+    silc_set_errno_posix(errno);
+    if (errno == EAGAIN || errno == EINTR) {
+      SILC_LOG_DEBUG(("Could not write immediately, will do it later"));
+      silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				  SILC_TASK_READ | SILC_TASK_WRITE, FALSE);
+      return -1;
+    }
+    SILC_LOG_DEBUG(("Cannot write to socket: %s", strerror(errno)));
+    silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
+    return -2;
+  }
+
+  SILC_LOG_DEBUG(("Wrote data %d bytes", ret));
+  if (silc_schedule_get_fd_events(sock->schedule, sock->sock) &
+      SILC_TASK_WRITE)
+    silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				SILC_TASK_READ, FALSE);
+
+  return ret;
+}
+
+/* Stream writev operation */
+
+int silc_socket_stream_writev(SilcStream stream, SilcStreamIOVec *iov,
+			      SilcUInt32 iov_count)
+{
+  SilcSocketStream sock = stream;
+  struct iovec vec[SILC_SOCKET_STREAM_IOV_MAX];
+  SilcUInt32 i, count;
+  int ret;
+
+  SILC_LOG_DEBUG(("Writing data to socket %d, %d segments", sock->sock,
+		  iov_count));
+
+  count = iov_count > SILC_SOCKET_STREAM_IOV_MAX ?
+    SILC_SOCKET_STREAM_IOV_MAX : iov_count;
+  for (i = 0; i < count; i++) {
+    vec[i].iov_base = iov[i].data;
+    vec[i].iov_len = iov[i].data_len;
+  }
+
+  ret = writev(sock->sock, vec, count);
+  if (ret > 0) {
+    sock->bytes_out += ret;
+    sock->ops_out++;
+    sock->last_activity = silc_time_coarse_usec();
+  }
   if (ret < 0) {
     silc_set_errno_posix(errno);
     if (errno == EAGAIN || errno == EINTR) {
@@ -257,10 +382,17 @@ void silc_socket_stream_destroy(SilcStream stream)
   silc_socket_stream_close(socket_stream);
   silc_free(socket_stream->ip);
   silc_free(socket_stream->hostname);
-  if (socket_stream->schedule)
+  if (socket_stream->schedule) {
     silc_schedule_task_del_by_fd(socket_stream->schedule, socket_stream->sock);
 
+    /* Delete pending uncork timeout */
+    if (socket_stream->corked)
+      silc_schedule_task_del_by_context(socket_stream->schedule,
+					socket_stream);
+  }
+
   if (socket_stream->qos) {
+    silc_socket_stream_qos_unthrottle(socket_stream);
     silc_schedule_task_del_by_context(socket_stream->schedule,
 				      socket_stream->qos);
     if (socket_stream->qos->buffer) {
@@ -271,10 +403,19 @@ void silc_socket_stream_destroy(SilcStream stream)
     silc_free(socket_stream->qos);
   }
 
+  /* Release buffers of zerocopy sends still in flight; the stream is
+     going away so the completions can no longer be reaped. */
+  while (socket_stream->zc_pending) {
+    SilcSocketZcPending p = socket_stream->zc_pending;
+    socket_stream->zc_pending = p->next;
+    silc_buffer_unref(p->buffer);
+    silc_free(p);
+  }
+
   if (socket_stream->schedule)
     silc_schedule_wakeup(socket_stream->schedule);
 
-  silc_free(socket_stream);
+  silc_sfree(socket_stream->stack, socket_stream);
 }
 
 /* Sets stream notification callback for the stream */
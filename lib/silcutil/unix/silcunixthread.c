@@ -149,7 +149,8 @@ struct SilcMutexStruct {
 #ifdef SILC_THREADS
   pthread_mutex_t mutex;
 #endif /* SILC_THREADS */
-  unsigned int locked : 1;
+  unsigned int locked   : 1;
+  unsigned int adaptive : 1;	/* Spin before parking */
 };
 
 SilcBool silc_mutex_alloc(SilcMutex *mutex)
@@ -170,6 +171,19 @@ SilcBool silc_mutex_alloc(SilcMutex *mutex)
 #endif /* SILC_THREADS */
 }
 
+/* Number of trylock spins before an adaptive mutex parks */
+#define SILC_MUTEX_SPIN_COUNT 200
+
+SilcBool silc_mutex_alloc_adaptive(SilcMutex *mutex)
+{
+  if (!silc_mutex_alloc(mutex))
+    return FALSE;
+#ifdef SILC_THREADS
+  (*mutex)->adaptive = TRUE;
+#endif /* SILC_THREADS */
+  return TRUE;
+}
+
 void silc_mutex_free(SilcMutex mutex)
 {
 #ifdef SILC_THREADS
@@ -184,6 +198,20 @@ void silc_mutex_lock(SilcMutex mutex)
 {
 #ifdef SILC_THREADS
   if (mutex) {
+    if (mutex->adaptive) {
+      /* Spin briefly before parking; a short critical section usually
+	 releases the lock within the spin and the futex round trip is
+	 avoided entirely. */
+      int i;
+      for (i = 0; i < SILC_MUTEX_SPIN_COUNT; i++) {
+	if (pthread_mutex_trylock(&mutex->mutex) == 0) {
+	  mutex->locked = TRUE;
+	  return;
+	}
+	if ((i & 63) == 63)
+	  sched_yield();
+      }
+    }
     SILC_VERIFY(pthread_mutex_lock(&mutex->mutex) == 0);
     mutex->locked = TRUE;
   }
@@ -370,9 +398,14 @@ static void silc_thread_tls_destructor(void *context)
 {
   SilcTls tls = context;
 
+  silc_thread_tls_run_destructors(tls);
+
   if (tls->tls_variables)
     silc_hash_table_free(tls->tls_variables);
   tls->tls_variables = NULL;
+  if (tls->var_cache)
+    silc_hash_table_free(tls->var_cache);
+  tls->var_cache = NULL;
 
   silc_free(tls);
 }
@@ -424,10 +457,13 @@ static SilcTls silc_thread_tls_init_shared(SilcTls other)
   }
   pthread_setspecific(key, tls);
 
-  /* Take shared data */
-  tls->shared_data = 1;
-  tls->lock = other->lock;
-  tls->variables = other->variables;
+  /* Take shared data.  The creator may not have initialized its own
+     Tls yet; then there is nothing to share. */
+  if (other) {
+    tls->shared_data = 1;
+    tls->lock = other->lock;
+    tls->variables = other->variables;
+  }
 
   return tls;
 }
@@ -447,6 +483,9 @@ void silc_thread_tls_uninit(void)
     return;
 
   /* Main thread cleanup */
+  silc_thread_tls_run_destructors(tls);
+  if (tls->var_cache)
+    silc_hash_table_free(tls->var_cache);
   if (tls->tls_variables)
     silc_hash_table_free(tls->tls_variables);
   if (tls->variables)
@@ -489,12 +528,17 @@ SilcTls silc_thread_get_tls(void)
 
 void silc_thread_tls_uninit(void)
 {
+  /* Called both from silc_runtime_uninit and the atexit handler; clear
+     the pointers so the second call is a no-op. */
   if (tls.tls_variables)
     silc_hash_table_free(tls.tls_variables);
   if (tls.variables)
     silc_hash_table_free(tls.variables);
   if (tls.lock)
     silc_mutex_free(tls.lock);
+  tls.tls_variables = NULL;
+  tls.variables = NULL;
+  tls.lock = NULL;
 }
 
 #endif
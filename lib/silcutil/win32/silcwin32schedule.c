@@ -27,9 +27,111 @@ typedef struct {
   HWND window;			/* Hidden window for receiving socket events */
   WNDCLASS wclass;		/* Window class */
   HANDLE wakeup_sema;		/* Scheduler wakeup semaphore */
+#if defined(POLLRDNORM)
+  WSAPOLLFD *pfds;		/* WSAPoll backend fd table */
+  SilcUInt32 pfds_count;
+  SOCKET wakeup_sock;		/* WSAPoll backend wakeup socket */
+  SOCKET wakeup_send;		/* Socket to write wakeups to */
+  unsigned int use_poll	     : 1; /* Use the WSAPoll backend */
+#endif /* POLLRDNORM */
   unsigned int in_schedule   : 1;
 } *SilcWin32Scheduler;
 
+#if defined(POLLRDNORM)
+
+/* WSAPoll based waiter.  Unlike the message window based waiter below
+   this scales past MAXIMUM_WAIT_OBJECTS and does one readiness system
+   call per iteration, at the cost of not pumping window messages; it is
+   selected with SILC_SCHEDULER=wsapoll for service-style processes.
+   Wakeups arrive through a loopback datagram socket. */
+
+static int silc_select_wsapoll(SilcSchedule schedule,
+			       SilcWin32Scheduler internal)
+{
+  SilcHashTableList htl;
+  SilcTaskFd task;
+  WSAPOLLFD *fds;
+  SilcUInt32 fds_count, num_fds, i = 0;
+  INT timeo = -1;
+  void *fdp;
+  int ret, fd;
+  char c[16];
+
+  /* Allocate fd table */
+  fds_count = silc_hash_table_count(schedule->fd_queue) + 1;
+  if (fds_count > internal->pfds_count) {
+    fds = silc_realloc(internal->pfds, sizeof(*fds) * (fds_count + 16));
+    if (!fds)
+      return -1;
+    internal->pfds = fds;
+    internal->pfds_count = fds_count + 16;
+  }
+  fds = internal->pfds;
+
+  /* Wakeup socket */
+  fds[i].fd = internal->wakeup_sock;
+  fds[i].events = POLLRDNORM;
+  fds[i].revents = 0;
+  i++;
+
+  silc_hash_table_list(schedule->fd_queue, &htl);
+  while (silc_hash_table_get(&htl, &fdp, (void *)&task)) {
+    if (!task->events)
+      continue;
+    fds[i].fd = (SOCKET)SILC_PTR_TO_32(fdp);
+    fds[i].events = 0;
+    fds[i].revents = 0;
+    if (task->events & SILC_TASK_READ)
+      fds[i].events |= POLLRDNORM;
+    if (task->events & SILC_TASK_WRITE)
+      fds[i].events |= POLLWRNORM;
+    task->revents = 0;
+    i++;
+  }
+  silc_hash_table_list_reset(&htl);
+  num_fds = i;
+  silc_list_init(schedule->fd_dispatch, struct SilcTaskStruct, next);
+
+  if (schedule->has_timeout)
+    timeo = ((schedule->timeout.tv_sec * 1000) +
+	     (schedule->timeout.tv_usec / 1000));
+
+  SILC_SCHEDULE_UNLOCK(schedule);
+  ret = WSAPoll(fds, num_fds, timeo);
+  SILC_SCHEDULE_LOCK(schedule);
+  if (ret <= 0)
+    return ret;
+
+  /* Drain wakeups */
+  if (fds[0].revents & POLLRDNORM)
+    recv(internal->wakeup_sock, c, sizeof(c), 0);
+
+  /* Harvest only the entries filled above; tasks without events were
+     skipped, so the fd queue count can exceed the filled range and the
+     slots past it hold stale revents from earlier rounds. */
+  for (i = 1; i < num_fds; i++) {
+    if (!fds[i].revents)
+      continue;
+    if (!silc_hash_table_find(schedule->fd_queue,
+			      SILC_32_TO_PTR((SilcUInt32)fds[i].fd),
+			      NULL, (void *)&task))
+      continue;
+    if (!task->header.valid || !task->events)
+      continue;
+
+    fd = fds[i].revents;
+    if (fd & (POLLRDNORM | POLLERR | POLLHUP))
+      task->revents |= SILC_TASK_READ;
+    if (fd & POLLWRNORM)
+      task->revents |= SILC_TASK_WRITE;
+    silc_list_add(schedule->fd_dispatch, task);
+  }
+
+  return ret;
+}
+
+#endif /* POLLRDNORM */
+
 /* Our select() call.  This simply waits for some events to happen.  It also
    dispatches window messages so it can be used as the main loop of Windows
    application.  This doesn't wait for fds or sockets but does receive
@@ -46,6 +148,11 @@ int silc_select(SilcSchedule schedule, void *context)
   MSG msg;
   int nhandles = 0;
 
+#if defined(POLLRDNORM)
+  if (internal->use_poll)
+    return silc_select_wsapoll(schedule, internal);
+#endif /* POLLRDNORM */
+
   if (!internal->in_schedule) {
     internal->in_schedule = TRUE;
     silc_list_init(schedule->fd_dispatch, struct SilcTaskStruct, next);
@@ -249,6 +356,41 @@ void *silc_schedule_internal_init(SilcSchedule schedule, void *app_context)
 
   schedule->max_tasks = MAXIMUM_WAIT_OBJECTS;
 
+#if defined(POLLRDNORM)
+  /* SILC_SCHEDULER=wsapoll selects the WSAPoll backend, which scales
+     past MAXIMUM_WAIT_OBJECTS for service-style processes that do not
+     pump window messages. */
+  if (silc_getenv("SILC_SCHEDULER") &&
+      !strcmp(silc_getenv("SILC_SCHEDULER"), "wsapoll")) {
+    struct sockaddr_in sin;
+    int slen = sizeof(sin);
+
+    internal->wakeup_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    internal->wakeup_send = socket(AF_INET, SOCK_DGRAM, 0);
+    if (internal->wakeup_sock != INVALID_SOCKET &&
+	internal->wakeup_send != INVALID_SOCKET) {
+      memset(&sin, 0, sizeof(sin));
+      sin.sin_family = AF_INET;
+      sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (!bind(internal->wakeup_sock, (struct sockaddr *)&sin,
+		sizeof(sin)) &&
+	  !getsockname(internal->wakeup_sock, (struct sockaddr *)&sin,
+		       &slen) &&
+	  !connect(internal->wakeup_send, (struct sockaddr *)&sin,
+		   sizeof(sin))) {
+	internal->use_poll = TRUE;
+	schedule->max_tasks = 0;
+      }
+    }
+    if (!internal->use_poll) {
+      if (internal->wakeup_sock != INVALID_SOCKET)
+	closesocket(internal->wakeup_sock);
+      if (internal->wakeup_send != INVALID_SOCKET)
+	closesocket(internal->wakeup_send);
+    }
+  }
+#endif /* POLLRDNORM */
+
   /* Create hidden window.  We need window so that we can use WSAAsyncSelect
      to set socket events.  */
   silc_snprintf(n, sizeof(n), "SilcSchedule-%p", schedule);
@@ -284,6 +426,17 @@ void *silc_schedule_internal_init(SilcSchedule schedule, void *app_context)
 
 void silc_schedule_internal_uninit(SilcSchedule schedule, void *context)
 {
+#if defined(POLLRDNORM)
+  {
+    SilcWin32Scheduler in2 = (SilcWin32Scheduler)context;
+    if (in2 && in2->use_poll) {
+      closesocket(in2->wakeup_sock);
+      closesocket(in2->wakeup_send);
+      silc_free(in2->pfds);
+    }
+  }
+#endif /* POLLRDNORM */
+
   SilcWin32Scheduler internal = (SilcWin32Scheduler)context;
   char n[32];
 
@@ -334,6 +487,14 @@ void silc_schedule_internal_wakeup(SilcSchedule schedule, void *context)
 {
 #ifdef SILC_THREADS
   SilcWin32Scheduler internal = (SilcWin32Scheduler)context;
+
+#if defined(POLLRDNORM)
+  if (internal->use_poll) {
+    send(internal->wakeup_send, "!", 1, 0);
+    return;
+  }
+#endif /* POLLRDNORM */
+
   ReleaseSemaphore(internal->wakeup_sema, 1, NULL);
 #endif /* SILC_THREADS */
 }
@@ -133,6 +133,50 @@ int silc_socket_stream_write(SilcStream stream, const unsigned char *data,
   return ret;
 }
 
+/* Stream writev operation */
+
+int silc_socket_stream_writev(SilcStream stream, SilcStreamIOVec *iov,
+			      SilcUInt32 iov_count)
+{
+  SilcSocketStream sock = stream;
+  SOCKET fd = sock->sock;
+  WSABUF bufs[32];
+  DWORD written = 0;
+  SilcUInt32 i, count;
+  int ret;
+
+  SILC_LOG_DEBUG(("Writing data to socket %d, %d segments", fd, iov_count));
+
+  count = iov_count > 32 ? 32 : iov_count;
+  for (i = 0; i < count; i++) {
+    bufs[i].buf = (char *)iov[i].data;
+    bufs[i].len = iov[i].data_len;
+  }
+
+  ret = WSASend(fd, bufs, count, &written, 0, NULL, NULL);
+  if (ret == SOCKET_ERROR) {
+    ret = WSAGetLastError();
+    silc_set_errno_posix(ret);
+    if (ret == WSAEWOULDBLOCK) {
+      SILC_LOG_DEBUG(("Could not write immediately, will do it later"));
+      silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				  SILC_TASK_READ | SILC_TASK_WRITE, FALSE);
+      return -1;
+    }
+    SILC_LOG_DEBUG(("Cannot write to socket"));
+    silc_schedule_unset_listen_fd(sock->schedule, sock->sock);
+    return -2;
+  }
+
+  SILC_LOG_DEBUG(("Wrote data %d bytes", (int)written));
+  if (silc_schedule_get_fd_events(sock->schedule, sock->sock) &
+      SILC_TASK_WRITE)
+    silc_schedule_set_listen_fd(sock->schedule, sock->sock,
+				SILC_TASK_READ, FALSE);
+
+  return (int)written;
+}
+
 /* Receive UDP packet.  QoS is not supported. */
 
 int silc_socket_udp_stream_read(SilcStream stream, unsigned char *buf,
@@ -188,7 +232,7 @@ void silc_socket_stream_destroy(SilcStream stream)
   if (socket_stream->schedule)
     silc_schedule_wakeup(socket_stream->schedule);
 
-  silc_free(socket_stream);
+  silc_sfree(socket_stream->stack, socket_stream);
 }
 
 /* Sets stream notification callback for the stream */
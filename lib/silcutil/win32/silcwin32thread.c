@@ -191,6 +191,12 @@ SilcBool silc_mutex_alloc(SilcMutex *mutex)
 #endif /* SILC_THREADS */
 }
 
+SilcBool silc_mutex_alloc_adaptive(SilcMutex *mutex)
+{
+  /* The critical section based mutex already spins before parking */
+  return silc_mutex_alloc(mutex);
+}
+
 void silc_mutex_free(SilcMutex mutex)
 {
 #ifdef SILC_THREADS
@@ -469,10 +475,13 @@ static SilcTls silc_thread_tls_init_shared(SilcTls other)
   }
   TlsSetValue(silc_tls, tls);
 
-  /* Take shared data */
-  tls->shared_data = 1;
-  tls->lock = other->lock;
-  tls->variables = other->variables;
+  /* Take shared data.  The creator may not have initialized its own
+     Tls yet; then there is nothing to share. */
+  if (other) {
+    tls->shared_data = 1;
+    tls->lock = other->lock;
+    tls->variables = other->variables;
+  }
 
   return tls;
 }
@@ -486,6 +495,9 @@ void silc_thread_tls_uninit(void)
 {
   SilcTls tls = silc_thread_get_tls();
 
+  if (tls)
+    silc_thread_tls_run_destructors(tls);
+
   if (!tls || tls->shared_data)
     return;
 